@@ -0,0 +1,402 @@
+// Benchmark for the portable core of FlyNativeLibHeif/ApngDecoder and ApngCompositor.
+//
+// Builds large APNGs in memory with zlib, choosing each row's filter with libpng's
+// minimum-sum heuristic so all five filter types occur (a photographic clip of full RGB frames,
+// a screen recording of small RGBA patches blended over, and a sticker whose frames restore
+// to the previous canvas), and plays each one through. Reported per clip:
+// - decode of all frames: the path PngAnimator used to take (each frame re-assembled into a
+//   standalone PNG with fresh CRCs, then decoded by libpng) against ApngDecoder::DecodeFrame,
+//   with the scalar and the SSE2 unfilter kernels,
+// - bytes uploaded per frame: the dirty rectangles against the whole canvas.
+// Every frame decoded natively is checked to match libpng's, premultiplied the same way.
+// Also reported: unfilter throughput per filter type, scalar against SSE2.
+//
+// Build and run: see README.md in this folder.
+
+#include "ApngCompositor.h"
+#include "ApngDecoder.h"
+#include "CpuFeatures.h"
+
+#include <png.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double MsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    uint32_t Rand(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // --- Writer ---------------------------------------------------------------------------
+
+    struct Patch {
+        int x, y, width, height;
+        int dispose, blend;
+        std::vector<uint8_t> pixels;    // RGB or RGBA, packed.
+    };
+
+    struct Clip {
+        std::string name;
+        int width, height;
+        int channels;
+        std::vector<Patch> patches;
+    };
+
+    void PutU32(std::vector<uint8_t>& out, uint32_t v) {
+        const uint8_t bytes[4] = {static_cast<uint8_t>(v >> 24), static_cast<uint8_t>(v >> 16),
+                                  static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v)};
+        out.insert(out.end(), bytes, bytes + 4);
+    }
+
+    void PutChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size) {
+        PutU32(out, static_cast<uint32_t>(size));
+        const size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        if (size) out.insert(out.end(), data, data + size);
+        PutU32(out, static_cast<uint32_t>(crc32(0, out.data() + start, static_cast<uInt>(size + 4))));
+    }
+
+    int Paeth(int a, int b, int c) {
+        const int p = a + b - c;
+        const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+        return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+    }
+
+    /// Filters every row with the type whose output has the smallest sum of absolute values.
+    std::vector<uint8_t> FilterRows(const Patch& patch, int bpp) {
+        const size_t row_bytes = static_cast<size_t>(patch.width) * bpp;
+        const std::vector<uint8_t> zero(row_bytes, 0);
+        std::vector<uint8_t> out;
+        out.reserve((row_bytes + 1) * patch.height);
+        std::vector<uint8_t> candidate(row_bytes), best(row_bytes);
+        for (int y = 0; y < patch.height; ++y) {
+            const uint8_t* row = patch.pixels.data() + y * row_bytes;
+            const uint8_t* prev = y ? row - row_bytes : zero.data();
+            uint64_t best_sum = ~0ull;
+            int best_type = 0;
+            for (int type = 0; type < 5; ++type) {
+                uint64_t sum = 0;
+                for (size_t i = 0; i < row_bytes; ++i) {
+                    const int a = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+                    const int b = prev[i];
+                    const int c = i >= static_cast<size_t>(bpp) ? prev[i - bpp] : 0;
+                    const int predictor = type == 0 ? 0 : type == 1 ? a : type == 2 ? b : type == 3 ? (a + b) / 2 : Paeth(a, b, c);
+                    candidate[i] = static_cast<uint8_t>(row[i] - predictor);
+                    sum += candidate[i] < 128 ? candidate[i] : 256 - candidate[i];
+                }
+                if (sum < best_sum) {
+                    best_sum = sum;
+                    best_type = type;
+                    best.swap(candidate);
+                }
+            }
+            out.push_back(static_cast<uint8_t>(best_type));
+            out.insert(out.end(), best.begin(), best.end());
+        }
+        return out;
+    }
+
+    std::vector<uint8_t> WriteApng(const Clip& clip) {
+        std::vector<uint8_t> out = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+        std::vector<uint8_t> body;
+        PutU32(body, clip.width);
+        PutU32(body, clip.height);
+        body.push_back(8);
+        body.push_back(clip.channels == 4 ? 6 : 2);
+        body.insert(body.end(), {0, 0, 0});
+        PutChunk(out, "IHDR", body.data(), body.size());
+        body.clear();
+        PutU32(body, static_cast<uint32_t>(clip.patches.size()));
+        PutU32(body, 0);
+        PutChunk(out, "acTL", body.data(), body.size());
+
+        uint32_t sequence = 0;
+        for (size_t f = 0; f < clip.patches.size(); ++f) {
+            const Patch& patch = clip.patches[f];
+            body.clear();
+            PutU32(body, sequence++);
+            PutU32(body, patch.width);
+            PutU32(body, patch.height);
+            PutU32(body, patch.x);
+            PutU32(body, patch.y);
+            body.insert(body.end(), {0, 4, 0, 100});    // 40 ms
+            body.push_back(static_cast<uint8_t>(patch.dispose));
+            body.push_back(static_cast<uint8_t>(patch.blend));
+            PutChunk(out, "fcTL", body.data(), body.size());
+
+            const std::vector<uint8_t> filtered = FilterRows(patch, clip.channels);
+            uLongf packed_size = compressBound(static_cast<uLong>(filtered.size()));
+            std::vector<uint8_t> packed(packed_size);
+            compress2(packed.data(), &packed_size, filtered.data(), static_cast<uLong>(filtered.size()), 6);
+
+            // Split into 64 KB chunks, as most encoders do.
+            for (size_t offset = 0; offset < packed_size; offset += 65536) {
+                const size_t n = std::min<size_t>(65536, packed_size - offset);
+                if (f == 0) {
+                    PutChunk(out, "IDAT", packed.data() + offset, n);
+                } else {
+                    body.clear();
+                    PutU32(body, sequence++);
+                    body.insert(body.end(), packed.begin() + offset, packed.begin() + offset + n);
+                    PutChunk(out, "fdAT", body.data(), body.size());
+                }
+            }
+        }
+        PutChunk(out, "IEND", nullptr, 0);
+        return out;
+    }
+
+    /// Full frames of a moving gradient with grain.
+    Clip PhotoClip(int width, int height, int frames) {
+        Clip clip{"photo", width, height, 3, {}};
+        uint32_t state = 0x9E3779B9u;
+        for (int f = 0; f < frames; ++f) {
+            Patch p{0, 0, width, height, 0, 0, std::vector<uint8_t>(static_cast<size_t>(width) * height * 3)};
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const int grain = static_cast<int>(Rand(state) & 15) - 8;
+                    uint8_t* px = &p.pixels[(static_cast<size_t>(y) * width + x) * 3];
+                    px[0] = static_cast<uint8_t>(std::clamp(x * 255 / width + f * 3 + grain, 0, 255));
+                    px[1] = static_cast<uint8_t>(std::clamp(y * 255 / height + grain, 0, 255));
+                    px[2] = static_cast<uint8_t>(std::clamp(128 + ((x + y + f * 7) & 63) + grain, 0, 255));
+                }
+            }
+            clip.patches.push_back(std::move(p));
+        }
+        return clip;
+    }
+
+    /// A full first frame, then small translucent patches (cursor, text, a progress bar) blended over it.
+    Clip ScreenClip(int width, int height, int frames) {
+        Clip clip{"screen", width, height, 4, {}};
+        uint32_t state = 0x1234567u;
+        for (int f = 0; f < frames; ++f) {
+            Patch p{};
+            if (f == 0) {
+                p = Patch{0, 0, width, height, 0, 0, {}};
+            } else {
+                const int w = 40 + static_cast<int>(Rand(state) % 200), h = 16 + static_cast<int>(Rand(state) % 80);
+                p = Patch{static_cast<int>(Rand(state) % (width - w)), static_cast<int>(Rand(state) % (height - h)), w, h, 0, 1, {}};
+            }
+            p.pixels.resize(static_cast<size_t>(p.width) * p.height * 4);
+            for (int y = 0; y < p.height; ++y) {
+                for (int x = 0; x < p.width; ++x) {
+                    uint8_t* px = &p.pixels[(static_cast<size_t>(y) * p.width + x) * 4];
+                    const bool ink = f == 0 ? ((x / 8 + y / 16) % 9 == 0) : ((x * 7 + y * 3 + f) % 11 < 4);
+                    px[0] = ink ? 30 : 240;
+                    px[1] = ink ? 30 : 242;
+                    px[2] = ink ? 40 : 245;
+                    px[3] = f == 0 ? 255 : ink ? 255 : ((x + y) % 5 == 0 ? 96 : 0);
+                }
+            }
+            clip.patches.push_back(std::move(p));
+        }
+        return clip;
+    }
+
+    /// A soft-edged sprite moving over a transparent canvas; every frame restores to the previous canvas.
+    Clip StickerClip(int size, int frames) {
+        Clip clip{"sticker", size, size, 4, {}};
+        const int sprite = size / 2;
+        for (int f = 0; f < frames; ++f) {
+            const int ox = (f * 13) % (size - sprite), oy = (f * 7) % (size - sprite);
+            Patch p{ox, oy, sprite, sprite, f == 0 ? 0 : 2, 1, std::vector<uint8_t>(static_cast<size_t>(sprite) * sprite * 4)};
+            for (int y = 0; y < sprite; ++y) {
+                for (int x = 0; x < sprite; ++x) {
+                    const int dx = x - sprite / 2, dy = y - sprite / 2;
+                    const int d = dx * dx + dy * dy, r = sprite * sprite / 4;
+                    uint8_t* px = &p.pixels[(static_cast<size_t>(y) * sprite + x) * 4];
+                    px[0] = static_cast<uint8_t>(255 - x * 255 / sprite);
+                    px[1] = static_cast<uint8_t>((f * 9 + y) & 255);
+                    px[2] = static_cast<uint8_t>(x * 255 / sprite);
+                    px[3] = static_cast<uint8_t>(d >= r ? 0 : std::min(255, (r - d) * 1024 / r));
+                }
+            }
+            clip.patches.push_back(std::move(p));
+        }
+        return clip;
+    }
+
+    // --- Baseline: re-assemble each frame and decode it with libpng -----------------------
+
+    struct FrameChunks {
+        uint32_t width, height;
+        std::vector<std::pair<size_t, size_t>> data;    // Offset and size of each payload.
+    };
+
+    uint32_t GetU32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+
+    /// The parse PngAnimator ran once per file: fcTL sizes and the payloads of each frame.
+    std::vector<FrameChunks> ParseFrames(const std::vector<uint8_t>& file, std::vector<uint8_t>& ihdr) {
+        std::vector<FrameChunks> frames;
+        for (size_t pos = 8; pos + 12 <= file.size();) {
+            const uint32_t length = GetU32(&file[pos]);
+            const uint8_t* type = &file[pos + 4];
+            const uint8_t* data = &file[pos + 8];
+            if (!memcmp(type, "IHDR", 4)) ihdr.assign(data, data + length);
+            if (!memcmp(type, "fcTL", 4)) frames.push_back(FrameChunks{GetU32(data + 4), GetU32(data + 8), {}});
+            if (!memcmp(type, "IDAT", 4) && !frames.empty()) frames.back().data.emplace_back(pos + 8, length);
+            if (!memcmp(type, "fdAT", 4)) frames.back().data.emplace_back(pos + 12, length - 4);
+            pos += 12 + length;
+        }
+        return frames;
+    }
+
+    /// Writes a standalone PNG for one frame and decodes it with libpng to premultiplied BGRA.
+    void ReassembleAndDecode(const std::vector<uint8_t>& file, std::vector<uint8_t> ihdr, const FrameChunks& frame,
+                             std::vector<uint8_t>& png, std::vector<uint32_t>& out) {
+        png.assign({0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A});
+        for (int i = 0; i < 4; ++i) {
+            ihdr[i] = static_cast<uint8_t>(frame.width >> (24 - i * 8));
+            ihdr[4 + i] = static_cast<uint8_t>(frame.height >> (24 - i * 8));
+        }
+        PutChunk(png, "IHDR", ihdr.data(), ihdr.size());
+        for (const auto& [offset, size] : frame.data) PutChunk(png, "IDAT", file.data() + offset, size);
+        PutChunk(png, "IEND", nullptr, 0);
+
+        png_image image{};
+        image.version = PNG_IMAGE_VERSION;
+        png_image_begin_read_from_memory(&image, png.data(), png.size());
+        image.format = PNG_FORMAT_BGRA;
+        out.resize(static_cast<size_t>(image.width) * image.height);
+        png_image_finish_read(&image, nullptr, out.data(), 0, nullptr);
+        for (uint32_t& px : out) {
+            const uint32_t a = px >> 24;
+            if (a == 255) continue;
+            uint32_t premultiplied = a << 24;
+            for (int shift = 0; shift < 24; shift += 8) {
+                const uint32_t v = ((px >> shift) & 0xFF) * a + 128;
+                premultiplied |= ((v + (v >> 8)) >> 8) << shift;
+            }
+            px = premultiplied;
+        }
+    }
+
+    // --- Unfilter throughput --------------------------------------------------------------
+
+    void BenchUnfilter(int runs) {
+        const size_t row_bytes = 1920 * 4;
+        const int rows = 1080;
+        std::vector<uint8_t> source(row_bytes * rows), work(row_bytes * rows);
+        uint32_t state = 0xC0FFEEu;
+        for (uint8_t& b : source) b = static_cast<uint8_t>(Rand(state));
+
+        ApngDecoder decoder;
+        printf("\nunfilter MB/s, 1920x1080\n%-8s %4s %8s %8s %8s %8s\n", "kernel", "bpp", "Sub", "Up", "Avg", "Paeth");
+        for (size_t bpp : {size_t{3}, size_t{4}}) {
+            for (int simd = 0; simd < 2; ++simd) {
+                decoder.SetSimd(simd == 1);
+                printf("%-8s %4zu", simd ? "sse2" : "scalar", bpp);
+                for (int filter = 1; filter < 5; ++filter) {
+                    const ApngDecoder::UnfilterFn fn = decoder.Unfilter(filter, bpp);
+                    const size_t length = row_bytes / 4 * bpp;
+                    double best = 1e30;
+                    for (int run = 0; run < runs; ++run) {
+                        work = source;
+                        const auto start = Clock::now();
+                        for (int y = 1; y < rows; ++y) fn(work.data() + y * row_bytes, work.data() + (y - 1) * row_bytes, length, bpp);
+                        best = std::min(best, MsSince(start));
+                    }
+                    printf(" %8.0f", static_cast<double>(length) * rows / 1048576.0 / (best / 1000.0));
+                }
+                printf("\n");
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const int scale = argc > 1 ? std::max(1, atoi(argv[1])) : 1;
+    const int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 3;
+
+    std::vector<Clip> clips;
+    clips.push_back(PhotoClip(960, 540, 20 * scale));
+    clips.push_back(ScreenClip(1920, 1080, 100 * scale));
+    clips.push_back(StickerClip(512, 60 * scale));
+
+    printf("unfilter: %s\n", CpuFeatures::Name(CpuFeatures::Level()));
+    printf("%-8s %6s %9s %8s | %12s %10s %10s %7s | %12s %12s\n", "clip", "frames", "canvas", "file MB", "reassemble ms",
+           "scalar ms", "sse2 ms", "speed", "dirty KB/fr", "full KB/fr");
+
+    int failures = 0;
+    for (const Clip& clip : clips) {
+        const std::vector<uint8_t> file = WriteApng(clip);
+
+        ApngCompositor compositor;
+        if (!compositor.Open(file.data(), file.size()) || compositor.Decoder().FrameCount() != static_cast<int>(clip.patches.size())) {
+            printf("%s: failed to open\n", clip.name.c_str());
+            return 1;
+        }
+        ApngDecoder& decoder = compositor.Decoder();
+        std::vector<uint8_t> ihdr, png;
+        const std::vector<FrameChunks> chunks = ParseFrames(file, ihdr);
+
+        double baseline_ms = 1e30, scalar_ms = 1e30, simd_ms = 1e30;
+        std::vector<uint32_t> reference, native;
+        for (int run = 0; run < runs; ++run) {
+            auto start = Clock::now();
+            for (const FrameChunks& frame : chunks) ReassembleAndDecode(file, ihdr, frame, png, reference);
+            baseline_ms = std::min(baseline_ms, MsSince(start));
+
+            for (int simd = 0; simd < 2; ++simd) {
+                decoder.SetSimd(simd == 1);
+                start = Clock::now();
+                for (int f = 0; f < decoder.FrameCount(); ++f) {
+                    native.resize(static_cast<size_t>(decoder.Frame(f).width) * decoder.Frame(f).height);
+                    decoder.DecodeFrame(f, native.data());
+                }
+                double& best = simd ? simd_ms : scalar_ms;
+                best = std::min(best, MsSince(start));
+            }
+        }
+
+        // Both kernels must match libpng on every frame.
+        for (int simd = 0; simd < 2 && !failures; ++simd) {
+            decoder.SetSimd(simd == 1);
+            for (int f = 0; f < decoder.FrameCount(); ++f) {
+                ReassembleAndDecode(file, ihdr, chunks[f], png, reference);
+                native.resize(reference.size());
+                if (!decoder.DecodeFrame(f, native.data()) || native != reference) {
+                    printf("%s: frame %d differs from libpng (%s)\n", clip.name.c_str(), f, simd ? "sse2" : "scalar");
+                    ++failures;
+                    break;
+                }
+            }
+        }
+
+        uint64_t dirty_bytes = 0;
+        FrameRect dirty;
+        for (int f = 0; f < decoder.FrameCount(); ++f) {
+            compositor.RenderTo(f, dirty);
+            dirty_bytes += static_cast<uint64_t>(dirty.width) * dirty.height * 4;
+        }
+
+        const int frames = decoder.FrameCount();
+        char canvas[32];
+        snprintf(canvas, sizeof(canvas), "%dx%d", clip.width, clip.height);
+        printf("%-8s %6d %9s %8.1f | %12.1f %10.1f %10.1f %6.2fx | %12.0f %12.0f\n", clip.name.c_str(), frames, canvas,
+               file.size() / 1048576.0, baseline_ms, scalar_ms, simd_ms, baseline_ms / simd_ms, dirty_bytes / 1024.0 / frames,
+               static_cast<double>(clip.width) * clip.height * 4 / 1024.0);
+    }
+
+    BenchUnfilter(runs);
+    return failures ? 1 : 0;
+}
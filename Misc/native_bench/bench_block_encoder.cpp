@@ -0,0 +1,253 @@
+// Benchmark for the portable core of FlyNativeLibHeif/BlockEncoder.
+//
+// Compares the block-compressed preview format with the JPEG blobs it replaced in the
+// thumbnail cache, on a synthetic 800 px preview (gradients, texture and hard edges):
+//   encode  - BlockEncoder::EncodePreview vs a libjpeg quality 90 encode.
+//   hit     - what a cache hit costs before the GPU upload: copying the blocks out (BC) vs a
+//             full JPEG decode to BGRA.
+//   size    - bytes per preview, and the ratio to raw BGRA.
+//   psnr    - quality of each format against the source, decoded on the CPU.
+// A second table covers the level chain: encoding the preview with its halvings and the
+// 128 px strip tile, and what the strip pays per thumbnail with and without the stored tile.
+//
+// Build and run: see README.md in this folder.
+
+#include "BlockEncoder.h"
+#include "ImageReducer.h"
+
+#include <cstdio>
+#include <jpeglib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double Ms(Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    void MakeImage(std::vector<uint8_t>& bgra, int w, int h, bool alpha) {
+        bgra.resize(static_cast<size_t>(w) * h * 4);
+        uint32_t noise = 12345;
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                noise = noise * 1664525u + 1013904223u;
+                const int n = static_cast<int>((noise >> 24) & 15) - 8;
+                uint8_t* p = &bgra[(static_cast<size_t>(y) * w + x) * 4];
+                const bool edge = ((x / 37) + (y / 53)) % 5 == 0;
+                int b = x * 255 / w, g = y * 255 / h, r = static_cast<int>(128 + 100 * std::sin(x * 0.05) * std::cos(y * 0.03));
+                if (edge) { b = 255 - b; r = 30; }
+                p[0] = static_cast<uint8_t>(std::clamp(b + n, 0, 255));
+                p[1] = static_cast<uint8_t>(std::clamp(g + n, 0, 255));
+                p[2] = static_cast<uint8_t>(std::clamp(r + n, 0, 255));
+                p[3] = 255;
+                if (alpha) {
+                    // Premultiplied, with a soft vignette.
+                    const double dx = (x - w / 2.0) / (w / 2.0), dy = (y - h / 2.0) / (h / 2.0);
+                    const int a = static_cast<int>(255 * std::clamp(1.3 - std::sqrt(dx * dx + dy * dy), 0.0, 1.0));
+                    for (int c = 0; c < 3; ++c) p[c] = static_cast<uint8_t>(p[c] * a / 255);
+                    p[3] = static_cast<uint8_t>(a);
+                }
+            }
+        }
+    }
+
+    void Expand565(uint16_t c, int* out) {
+        const int r5 = (c >> 11) & 31, g6 = (c >> 5) & 63, b5 = c & 31;
+        out[0] = (b5 << 3) | (b5 >> 2);
+        out[1] = (g6 << 2) | (g6 >> 4);
+        out[2] = (r5 << 3) | (r5 >> 2);
+    }
+
+    /// Reference decoder for the two formats, as the GPU samples them (4-colour mode only).
+    void DecodeBlocks(const uint8_t* blocks, bool bc3, int w, int h, std::vector<uint8_t>& bgra) {
+        bgra.assign(static_cast<size_t>(w) * h * 4, 0);
+        const int bw = (w + 3) / 4, bh = (h + 3) / 4;
+        for (int by = 0; by < bh; ++by) {
+            for (int bx = 0; bx < bw; ++bx) {
+                int alpha[16];
+                for (int i = 0; i < 16; ++i) alpha[i] = 255;
+                if (bc3) {
+                    const int a0 = blocks[0], a1 = blocks[1];
+                    int table[8] = { a0, a1 };
+                    for (int k = 1; k < 7; ++k) table[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+                    uint64_t bits = 0;
+                    for (int k = 0; k < 6; ++k) bits |= static_cast<uint64_t>(blocks[2 + k]) << (8 * k);
+                    for (int i = 0; i < 16; ++i) alpha[i] = table[(bits >> (3 * i)) & 7];
+                    blocks += 8;
+                }
+                const uint16_t c0 = static_cast<uint16_t>(blocks[0] | (blocks[1] << 8));
+                const uint16_t c1 = static_cast<uint16_t>(blocks[2] | (blocks[3] << 8));
+                const uint32_t idx = blocks[4] | (blocks[5] << 8) | (blocks[6] << 16) | (static_cast<uint32_t>(blocks[7]) << 24);
+                int pal[4][3];
+                Expand565(c0, pal[0]);
+                Expand565(c1, pal[1]);
+                for (int c = 0; c < 3; ++c) {
+                    pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+                    pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+                }
+                blocks += 8;
+                for (int i = 0; i < 16; ++i) {
+                    const int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+                    if (x >= w || y >= h) continue;
+                    uint8_t* p = &bgra[(static_cast<size_t>(y) * w + x) * 4];
+                    const int* c = pal[(idx >> (2 * i)) & 3];
+                    p[0] = static_cast<uint8_t>(c[0]);
+                    p[1] = static_cast<uint8_t>(c[1]);
+                    p[2] = static_cast<uint8_t>(c[2]);
+                    p[3] = static_cast<uint8_t>(alpha[i]);
+                }
+            }
+        }
+    }
+
+    double Psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int channels) {
+        double sse = 0;
+        size_t n = 0;
+        for (size_t i = 0; i < a.size(); i += 4) {
+            for (int c = 0; c < channels; ++c, ++n) {
+                const double d = static_cast<double>(a[i + c]) - b[i + c];
+                sse += d * d;
+            }
+        }
+        return sse == 0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 * n / sse);
+    }
+
+    std::vector<uint8_t> EncodeJpeg(const std::vector<uint8_t>& bgra, int w, int h) {
+        jpeg_compress_struct cinfo;
+        jpeg_error_mgr jerr;
+        cinfo.err = jpeg_std_error(&jerr);
+        jpeg_create_compress(&cinfo);
+        unsigned char* mem = nullptr;
+        unsigned long mem_size = 0;
+        jpeg_mem_dest(&cinfo, &mem, &mem_size);
+        cinfo.image_width = w;
+        cinfo.image_height = h;
+        cinfo.input_components = 3;
+        cinfo.in_color_space = JCS_RGB;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality(&cinfo, 90, TRUE);
+        jpeg_start_compress(&cinfo, TRUE);
+        std::vector<uint8_t> row(static_cast<size_t>(w) * 3);
+        while (cinfo.next_scanline < cinfo.image_height) {
+            const uint8_t* src = &bgra[static_cast<size_t>(cinfo.next_scanline) * w * 4];
+            for (int x = 0; x < w; ++x) {
+                row[x * 3] = src[x * 4 + 2];
+                row[x * 3 + 1] = src[x * 4 + 1];
+                row[x * 3 + 2] = src[x * 4];
+            }
+            JSAMPROW rows[1] = { row.data() };
+            jpeg_write_scanlines(&cinfo, rows, 1);
+        }
+        jpeg_finish_compress(&cinfo);
+        std::vector<uint8_t> out(mem, mem + mem_size);
+        jpeg_destroy_compress(&cinfo);
+        free(mem);
+        return out;
+    }
+
+    void DecodeJpeg(const std::vector<uint8_t>& jpeg, std::vector<uint8_t>& bgra) {
+        jpeg_decompress_struct cinfo;
+        jpeg_error_mgr jerr;
+        cinfo.err = jpeg_std_error(&jerr);
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo, jpeg.data(), static_cast<unsigned long>(jpeg.size()));
+        jpeg_read_header(&cinfo, TRUE);
+        cinfo.out_color_space = JCS_RGB;
+        jpeg_start_decompress(&cinfo);
+        const int w = static_cast<int>(cinfo.output_width);
+        bgra.resize(static_cast<size_t>(w) * cinfo.output_height * 4);
+        std::vector<uint8_t> row(static_cast<size_t>(w) * 3);
+        while (cinfo.output_scanline < cinfo.output_height) {
+            uint8_t* dst = &bgra[static_cast<size_t>(cinfo.output_scanline) * w * 4];
+            JSAMPROW rows[1] = { row.data() };
+            jpeg_read_scanlines(&cinfo, rows, 1);
+            for (int x = 0; x < w; ++x) {
+                dst[x * 4] = row[x * 3 + 2];
+                dst[x * 4 + 1] = row[x * 3 + 1];
+                dst[x * 4 + 2] = row[x * 3];
+                dst[x * 4 + 3] = 255;
+            }
+        }
+        jpeg_finish_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+    }
+
+    template <typename F>
+    double TimeMs(int iterations, F&& body) {
+        const auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) body();
+        return Ms(Clock::now() - start) / iterations;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int w = argc > 1 ? atoi(argv[1]) : 800;
+    const int h = argc > 2 ? atoi(argv[2]) : 600;
+    const int iterations = argc > 3 ? atoi(argv[3]) : 50;
+    const double raw = static_cast<double>(w) * h * 4;
+    const double mp = w * static_cast<double>(h) / 1e6;
+
+    printf("%dx%d preview, %d iterations\n\n", w, h, iterations);
+    printf("%-6s %12s %12s %12s %12s %9s %9s\n", "", "encode ms", "MP/s", "hit ms", "bytes", "vs BGRA", "psnr dB");
+
+    std::vector<uint8_t> image, preview, decoded, copy;
+    for (const bool alpha : { false, true }) {
+        MakeImage(image, w, h, alpha);
+        const double encode = TimeMs(iterations, [&] { BlockEncoder::EncodePreview(image.data(), w, h, w * 4, 0, preview); });
+        BlockPreviewHeader header;
+        if (!BlockEncoder::ParsePreview(preview.data(), preview.size(), header)) {
+            fprintf(stderr, "preview did not parse\n");
+            return 1;
+        }
+        BlockPreviewLevel level;
+        BlockEncoder::GetLevel(preview.data(), header, 0, level);
+        const double hit = TimeMs(iterations, [&] {
+            copy.assign(preview.begin() + level.offset, preview.begin() + level.offset + level.size);
+        });
+        DecodeBlocks(preview.data() + level.offset, header.format == 3, w, h, decoded);
+        printf("%-6s %12.2f %12.1f %12.3f %12zu %8.1fx %9.2f\n", alpha ? "BC3" : "BC1", encode, mp / (encode / 1000.0), hit,
+               preview.size(), raw / preview.size(), Psnr(image, decoded, alpha ? 4 : 3));
+    }
+
+    MakeImage(image, w, h, false);
+    std::vector<uint8_t> jpeg;
+    const double encode = TimeMs(iterations, [&] { jpeg = EncodeJpeg(image, w, h); });
+    const double hit = TimeMs(iterations, [&] { DecodeJpeg(jpeg, decoded); });
+    printf("%-6s %12.2f %12.1f %12.3f %12zu %8.1fx %9.2f\n", "JPEG", encode, mp / (encode / 1000.0), hit, jpeg.size(),
+           raw / jpeg.size(), Psnr(image, decoded, 3));
+
+    // Level chain. "tile ms" is a copy of the stored tile's blocks, against scaling the
+    // centre of the preview to 128 px, which is what the strip did before (on the GPU).
+    const int tile = 128;
+    std::vector<uint8_t> single, chain, scaled(static_cast<size_t>(tile) * tile * 4);
+    BlockEncoder::EncodePreview(image.data(), w, h, w * 4, 0, single);
+    const double chain_encode = TimeMs(iterations, [&] { BlockEncoder::EncodePreview(image.data(), w, h, w * 4, tile, chain); });
+    BlockPreviewLevel tile_level;
+    if (!BlockEncoder::FindLevel(chain.data(), chain.size(), 0, true, tile_level)) {
+        fprintf(stderr, "chain has no tile\n");
+        return 1;
+    }
+    const double tile_hit = TimeMs(iterations * 20, [&] {
+        copy.assign(chain.begin() + tile_level.offset, chain.begin() + tile_level.offset + tile_level.size);
+    });
+    const int side = std::min(w, h);
+    const double tile_scale = TimeMs(iterations, [&] {
+        ImageReducer::Resample(&image[(static_cast<size_t>(h - side) / 2 * w + (w - side) / 2) * 4], side, side, w * 4,
+                               scaled.data(), tile, tile, tile * 4);
+    });
+    BlockPreviewHeader header;
+    BlockEncoder::ParsePreview(chain.data(), chain.size(), header);
+    printf("\n%u levels: encode %.2f ms (single level %.2f ms), %zu bytes (+%.0f%%)\n", header.level_count, chain_encode,
+           TimeMs(iterations, [&] { BlockEncoder::EncodePreview(image.data(), w, h, w * 4, 0, single); }),
+           chain.size(), 100.0 * (static_cast<double>(chain.size()) / single.size() - 1.0));
+    printf("tile ms: stored %.4f, scaled from preview %.3f\n", tile_hit, tile_scale);
+    return 0;
+}
@@ -0,0 +1,274 @@
+// Benchmark for the portable core of FlyNativeLibHeif/DdsDecoder.
+//
+// Writes DDS textures in memory, one per pixel format the viewer meets most (BC1-BC7, RGBA8,
+// a legacy 16-bit bit-mask format and RGBA16F), filled with random blocks or pixels so that
+// every block mode and palette case occurs. Reported per format:
+// - decode speed of the top level on one thread with the scalar and the SSE2 kernels, and
+//   with the SSE2 kernels on every core, in megapixels per second.
+// All three outputs must be identical. Then, for a large BC7 texture with a full mip chain,
+// the time to show it at preview size from the mip SelectMip() picks, against decoding the
+// top level.
+//
+// Correctness against an independent decoder: `--write DIR` saves small textures of every
+// format, with sizes that are not multiples of 4; reference decodes are saved next to them as
+// raw RGBA (see README.md); `--check DIR` compares the two.
+//
+// Build and run: see README.md in this folder.
+
+#include "CpuFeatures.h"
+#include "DdsDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double MsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    uint32_t Rand(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    constexpr uint32_t FourCc(const char* s) {
+        return static_cast<uint32_t>(s[0]) | (static_cast<uint32_t>(s[1]) << 8) | (static_cast<uint32_t>(s[2]) << 16) |
+               (static_cast<uint32_t>(s[3]) << 24);
+    }
+
+    struct Format {
+        const char* name;
+        uint32_t fourcc;                // 0 for a legacy bit-mask header.
+        uint32_t dxgi;                  // With fourcc "DX10".
+        int block_bytes;                // 0 for uncompressed.
+        int pixel_bits;
+        uint32_t pf_flags;              // Legacy bit-mask header.
+        uint32_t masks[4];              // R, G, B, A.
+    };
+
+    const Format kFormats[] = {
+        {"dxt1", FourCc("DXT1"), 0, 8, 0, 0, {}},
+        {"dxt3", FourCc("DXT3"), 0, 16, 0, 0, {}},
+        {"dxt5", FourCc("DXT5"), 0, 16, 0, 0, {}},
+        {"ati1", FourCc("ATI1"), 0, 8, 0, 0, {}},
+        {"ati2", FourCc("ATI2"), 0, 16, 0, 0, {}},
+        {"bc5s", FourCc("DX10"), 84, 16, 0, 0, {}},
+        {"bc6h", FourCc("DX10"), 95, 16, 0, 0, {}},
+        {"bc7", FourCc("DX10"), 98, 16, 0, 0, {}},
+        {"rgba8", FourCc("DX10"), 28, 0, 32, 0, {}},
+        {"bgra8", 0, 0, 0, 32, 0x41, {0xFF0000, 0xFF00, 0xFF, 0xFF000000}},
+        {"bgr565", 0, 0, 0, 16, 0x40, {0xF800, 0x07E0, 0x001F, 0}},
+        {"rgba16f", FourCc("DX10"), 10, 0, 64, 0, {}},
+    };
+
+    const Format* Find(const char* name) {
+        for (const Format& f : kFormats)
+            if (!strcmp(f.name, name)) return &f;
+        return nullptr;
+    }
+
+    size_t LevelBytes(const Format& f, int width, int height) {
+        if (f.block_bytes) return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * f.block_bytes;
+        return static_cast<size_t>(width) * height * f.pixel_bits / 8;
+    }
+
+    void Put32(std::vector<uint8_t>& out, size_t at, uint32_t v) {
+        for (int i = 0; i < 4; ++i) out[at + i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    /// A texture of random blocks or pixels with `mips` levels. Random half floats are kept
+    /// mostly in [0, 1] so that RGBA16F is not all black or white. BC7's reserved mode, which
+    /// decoders disagree on (the specification says transparent black), is left out.
+    std::vector<uint8_t> WriteDds(const Format& f, int width, int height, int mips, uint32_t seed) {
+        const bool dx10 = f.fourcc == FourCc("DX10");
+        size_t payload = 0;
+        for (int level = 0; level < mips; ++level) payload += LevelBytes(f, std::max(1, width >> level), std::max(1, height >> level));
+        const size_t header = dx10 ? 148 : 128;
+        std::vector<uint8_t> out(header + payload);
+        Put32(out, 0, FourCc("DDS "));
+        Put32(out, 4, 124);
+        Put32(out, 8, 0x1 | 0x2 | 0x4 | 0x1000 | (mips > 1 ? 0x20000 : 0));
+        Put32(out, 12, static_cast<uint32_t>(height));
+        Put32(out, 16, static_cast<uint32_t>(width));
+        Put32(out, 28, static_cast<uint32_t>(mips));
+        Put32(out, 76, 32);
+        if (f.fourcc) {
+            Put32(out, 80, 0x4);
+            Put32(out, 84, f.fourcc);
+        } else {
+            Put32(out, 80, f.pf_flags);
+            Put32(out, 88, static_cast<uint32_t>(f.pixel_bits));
+            for (int c = 0; c < 4; ++c) Put32(out, 92 + 4 * c, f.masks[c]);
+        }
+        Put32(out, 108, 0x1000 | (mips > 1 ? 0x400008 : 0));
+        if (dx10) {
+            Put32(out, 128, f.dxgi);
+            Put32(out, 132, 3);
+            Put32(out, 140, 1);
+        }
+        for (size_t i = header; i < out.size(); ++i) out[i] = static_cast<uint8_t>(Rand(seed) >> 7);
+        if (f.dxgi == 10)
+            for (size_t i = header; i + 1 < out.size(); i += 2) out[i + 1] = static_cast<uint8_t>(out[i + 1] % 0x3C);
+        if (f.dxgi == 98)
+            for (size_t i = header; i < out.size(); i += 16) out[i] |= out[i] ? 0 : 0x40;
+        return out;
+    }
+
+    bool ReadFile(const std::string& path, std::vector<uint8_t>& out) {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) return false;
+        fseek(f, 0, SEEK_END);
+        out.resize(static_cast<size_t>(ftell(f)));
+        fseek(f, 0, SEEK_SET);
+        const bool ok = fread(out.data(), 1, out.size(), f) == out.size();
+        fclose(f);
+        return ok;
+    }
+
+    int Write(const std::string& dir) {
+        uint32_t seed = 12345;
+        for (const Format& f : kFormats) {
+            const std::vector<uint8_t> file = WriteDds(f, 250, 130, 3, Rand(seed));
+            const std::string path = dir + "/" + f.name + ".dds";
+            FILE* out = fopen(path.c_str(), "wb");
+            if (!out || fwrite(file.data(), 1, file.size(), out) != file.size()) {
+                printf("cannot write %s\n", path.c_str());
+                return 1;
+            }
+            fclose(out);
+        }
+        printf("wrote %zu textures to %s\n", sizeof(kFormats) / sizeof(kFormats[0]), dir.c_str());
+        return 0;
+    }
+
+    /// Compares each texture's top level with `<name>.rgba`, straight RGBA from another decoder,
+    /// after premultiplying it. BC1-BC5 palettes may round differently by 1-2; BC7 and the
+    /// uncompressed formats should match exactly.
+    int Check(const std::string& dir) {
+        printf("%-8s %9s %9s %10s\n", "format", "max diff", "off by >1", "pixels");
+        int failures = 0;
+        for (const Format& f : kFormats) {
+            std::vector<uint8_t> file, reference;
+            if (!ReadFile(dir + "/" + f.name + ".dds", file)) continue;
+            if (!ReadFile(dir + "/" + f.name + ".rgba", reference)) {
+                printf("%-8s %9s\n", f.name, "no reference");
+                continue;
+            }
+            DdsDecoder decoder;
+            if (!decoder.Open(file.data(), file.size())) {
+                printf("%-8s failed to open\n", f.name);
+                ++failures;
+                continue;
+            }
+            const int width = decoder.Info().width, height = decoder.Info().height;
+            std::vector<uint8_t> bgra(static_cast<size_t>(width) * height * 4);
+            if (reference.size() != bgra.size() || !decoder.Decode(0, 0, bgra.data(), static_cast<size_t>(width) * 4)) {
+                printf("%-8s failed to decode\n", f.name);
+                ++failures;
+                continue;
+            }
+            int max_diff = 0;
+            size_t off = 0;
+            for (size_t p = 0; p < bgra.size(); p += 4) {
+                const uint32_t a = reference[p + 3];
+                const uint8_t expected[4] = {static_cast<uint8_t>((reference[p + 2] * a + 127) / 255),
+                                             static_cast<uint8_t>((reference[p + 1] * a + 127) / 255),
+                                             static_cast<uint8_t>((reference[p] * a + 127) / 255), static_cast<uint8_t>(a)};
+                for (int c = 0; c < 4; ++c) {
+                    const int diff = std::abs(static_cast<int>(bgra[p + c]) - expected[c]);
+                    max_diff = std::max(max_diff, diff);
+                    if (diff > 1) ++off;
+                }
+            }
+            const bool block = f.block_bytes && f.dxgi < 94;
+            const bool ok = max_diff <= (block ? 2 : 1);
+            failures += ok ? 0 : 1;
+            printf("%-8s %9d %9zu %10zu%s\n", f.name, max_diff, off, bgra.size() / 4, ok ? "" : "  FAILED");
+        }
+        return failures ? 1 : 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 2 && !strcmp(argv[1], "--write")) return Write(argv[2]);
+    if (argc > 2 && !strcmp(argv[1], "--check")) return Check(argv[2]);
+
+    const int scale = argc > 1 ? std::max(1, atoi(argv[1])) : 1;
+    const int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 3;
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+    printf("kernels: %s, %u cores\n", CpuFeatures::Name(CpuFeatures::Level()), cores);
+    printf("%-8s %10s %8s | %11s %10s %12s\n", "format", "size", "file MB", "scalar MP/s", "sse2 MP/s", "threads MP/s");
+
+    uint32_t seed = 99;
+    const int side = 2048 * scale;
+    for (const Format& f : kFormats) {
+        if (!strcmp(f.name, "dxt3") || !strcmp(f.name, "bgra8")) continue;
+        const std::vector<uint8_t> file = WriteDds(f, side, side, 1, Rand(seed));
+        DdsDecoder decoder;
+        if (!decoder.Open(file.data(), file.size()) || !decoder.Info().can_decode) {
+            printf("%s: failed to open\n", f.name);
+            return 1;
+        }
+        const size_t stride = static_cast<size_t>(side) * 4;
+        std::vector<uint8_t> out[3];
+        double ms[3] = {1e30, 1e30, 1e30};
+        for (std::vector<uint8_t>& o : out) o.assign(stride * side, 0);
+        // The passes take turns within each run, so clock and thermal drift over the run does
+        // not favour whichever pass would otherwise come first.
+        for (int run = 0; run < runs; ++run) {
+            for (int pass = 0; pass < 3; ++pass) {
+                decoder.SetSimd(pass > 0);
+                const auto start = Clock::now();
+                decoder.Decode(0, 0, out[pass].data(), stride, pass == 2 ? 0 : 1);
+                ms[pass] = std::min(ms[pass], MsSince(start));
+            }
+        }
+        if (out[0] != out[1] || out[0] != out[2]) {
+            printf("%s: outputs differ (sse2 %s, threads %s)\n", f.name, out[0] == out[1] ? "same" : "differs",
+                   out[1] == out[2] ? "same" : "differs");
+            return 1;
+        }
+        const double megapixels = static_cast<double>(side) * side / 1e6;
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", side, side);
+        printf("%-8s %10s %8.1f | %11.0f %10.0f %12.0f\n", f.name, size, file.size() / 1048576.0, megapixels / ms[0] * 1000,
+               megapixels / ms[1] * 1000, megapixels / ms[2] * 1000);
+    }
+
+    // A large texture shown at preview size: the mip chain does the downscaling.
+    const int large = 8192 * scale;
+    int mips = 1;
+    while ((large >> mips) > 0) ++mips;
+    const std::vector<uint8_t> file = WriteDds(*Find("bc7"), large, large, mips, Rand(seed));
+    double preview_ms = 1e30, top_ms = 1e30;
+    DdsMip mip{};
+    for (int run = 0; run < runs; ++run) {
+        DdsDecoder decoder;
+        auto start = Clock::now();
+        decoder.Open(file.data(), file.size());
+        mip = decoder.SelectMip(800);
+        std::vector<uint8_t> preview(static_cast<size_t>(mip.width) * mip.height * 4);
+        decoder.Decode(0, mip.level, preview.data(), static_cast<size_t>(mip.width) * 4);
+        preview_ms = std::min(preview_ms, MsSince(start));
+
+        std::vector<uint8_t> top(static_cast<size_t>(large) * large * 4);
+        start = Clock::now();
+        decoder.Decode(0, 0, top.data(), static_cast<size_t>(large) * 4);
+        top_ms = std::min(top_ms, MsSince(start));
+    }
+    printf("\nbc7 %dx%d, %d levels, %.0f MB: preview from level %d (%dx%d) in %.2f ms; top level in %.1f ms\n", large, large, mips,
+           file.size() / 1048576.0, mip.level, mip.width, mip.height, preview_ms, top_ms);
+    return 0;
+}
@@ -0,0 +1,138 @@
+// Benchmark for the portable core of FlyNativeLib/DirectoryScanner.
+//
+// Creates a synthetic folder, then compares:
+//   scanner   - DirectoryScanner::Scan: readdir + extension filter + one natural-sort key
+//               per name + memcmp sort + packing into one buffer.
+//   baseline  - what FileDiscovery did: enumerate, filter, then std::sort calling a
+//               natural string comparison on every comparison (StrCmpLogicalW stand-in).
+//
+// Build and run: see README.md in this folder.
+
+#include "DirectoryScanner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	// Natural comparison evaluated from scratch on every call, like StrCmpLogicalW.
+	int NaturalCompare(const std::string& a, const std::string& b)
+	{
+		size_t i = 0, j = 0;
+		while (i < a.size() && j < b.size())
+		{
+			const bool da = isdigit(static_cast<unsigned char>(a[i])) != 0;
+			const bool db = isdigit(static_cast<unsigned char>(b[j])) != 0;
+			if (da && db)
+			{
+				size_t ei = i, ej = j;
+				while (ei < a.size() && isdigit(static_cast<unsigned char>(a[ei]))) ++ei;
+				while (ej < b.size() && isdigit(static_cast<unsigned char>(b[ej]))) ++ej;
+				size_t si = i, sj = j;
+				while (si + 1 < ei && a[si] == '0') ++si;
+				while (sj + 1 < ej && b[sj] == '0') ++sj;
+				if (ei - si != ej - sj) return (ei - si) < (ej - sj) ? -1 : 1;
+				const int cmp = a.compare(si, ei - si, b, sj, ej - sj);
+				if (cmp != 0) return cmp;
+				i = ei;
+				j = ej;
+				continue;
+			}
+			const int ca = tolower(static_cast<unsigned char>(a[i]));
+			const int cb = tolower(static_cast<unsigned char>(b[j]));
+			if (ca != cb) return ca < cb ? -1 : 1;
+			++i;
+			++j;
+		}
+		if (a.size() - i != b.size() - j) return (a.size() - i) < (b.size() - j) ? -1 : 1;
+		return a.compare(b);
+	}
+
+	double Ms(std::chrono::steady_clock::duration d)
+	{
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int count = argc > 1 ? atoi(argv[1]) : 50000;
+	const fs::path dir = fs::temp_directory_path() / "fly_bench_scan";
+	const char* extensions = ".jpg,.jpeg,.png,.heic,.webp,.gif,.tif,.cr2,.nef,.arw";
+
+	// Populate once; reused across runs.
+	if (!fs::exists(dir / ".populated") || argc > 2)
+	{
+		fs::remove_all(dir);
+		fs::create_directories(dir);
+		std::mt19937 rng(42);
+		const char* stems[] = { "IMG_", "DSC", "Photo (", "holiday-", "Scan_00" };
+		const char* exts[] = { ".jpg", ".JPG", ".png", ".heic", ".txt", ".xmp" };
+		for (int i = 0; i < count; ++i)
+		{
+			const char* stem = stems[rng() % 5];
+			std::string name = std::string(stem) + std::to_string(rng() % (count * 4));
+			if (stem[6] == '(') name += ")";
+			name += exts[rng() % 6];
+			std::ofstream(dir / name).put('x');
+		}
+		std::ofstream(dir / ".populated");
+	}
+
+	DirectoryScanner scanner;
+	scanner.SetExtensions(extensions);
+
+	const int runs = 5;
+	double best_scanner = 1e9, best_baseline = 1e9;
+	PackedPathList<char> packed;
+	std::vector<std::string> baseline;
+	size_t comparisons = 0;
+
+	for (int r = 0; r < runs; ++r)
+	{
+		auto t0 = std::chrono::steady_clock::now();
+		scanner.Scan(dir.string(), packed);
+		best_scanner = std::min(best_scanner, Ms(std::chrono::steady_clock::now() - t0));
+
+		t0 = std::chrono::steady_clock::now();
+		baseline.clear();
+		for (const auto& entry : fs::directory_iterator(dir))
+		{
+			if (!entry.is_regular_file()) continue;
+			std::string ext = entry.path().extension().string();
+			for (auto& c : ext) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+			if (ext.empty() || std::string(extensions).find(ext) == std::string::npos) continue;
+			baseline.push_back(entry.path().string());
+		}
+		comparisons = 0;
+		std::sort(baseline.begin(), baseline.end(), [&](const std::string& a, const std::string& b)
+		{
+			++comparisons;
+			return NaturalCompare(a, b) < 0;
+		});
+		best_baseline = std::min(best_baseline, Ms(std::chrono::steady_clock::now() - t0));
+	}
+
+	// Both orders must agree.
+	size_t mismatches = 0;
+	for (size_t i = 0; i < packed.Count() && i < baseline.size(); ++i)
+	{
+		const std::string path(packed.Chars.data() + packed.Offsets[i], packed.Offsets[i + 1] - packed.Offsets[i]);
+		if (path != baseline[i]) ++mismatches;
+	}
+
+	printf("files matched      : %zu (baseline %zu)\n", packed.Count(), baseline.size());
+	printf("scanner (best of %d): %8.2f ms\n", runs, best_scanner);
+	printf("baseline (best of %d): %7.2f ms  (%zu comparisons)\n", runs, best_baseline, comparisons);
+	printf("order mismatches   : %zu\n", mismatches);
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+// Benchmark for the portable core of FlyNativeLibHeif/FrameDiff.
+//
+// Builds three sequences of whole frames in memory, the way libheif hands AVIF sequence frames
+// to AvifAnimationSource: a screen recording of a static desktop with a blinking caret and a
+// small region that redraws, a sprite moving over a still photograph, and a video clip with
+// film grain, where every pixel changes. Each frame is compared with the one before it.
+// Reported per clip:
+// - compare time for all frames with the scalar and the SSE2 kernels, against one memcpy of
+//   each whole frame (about what uploading it costs the CPU before the bus),
+// - bytes uploaded per frame for the changed rectangle against the whole canvas.
+// Every rectangle must match one found by comparing every pixel.
+//
+// Build and run: see README.md in this folder.
+
+#include "CpuFeatures.h"
+#include "FrameDiff.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double MsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    uint32_t Rand(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    struct Clip {
+        std::string name;
+        int width, height;
+        std::vector<std::vector<uint32_t>> frames;
+    };
+
+    void FillRect(std::vector<uint32_t>& frame, int width, int x, int y, int w, int h, uint32_t colour) {
+        for (int row = y; row < y + h; ++row) std::fill_n(frame.begin() + static_cast<size_t>(row) * width + x, w, colour);
+    }
+
+    /// A smooth photograph-like background: gradients with a little noise.
+    std::vector<uint32_t> Background(int width, int height, uint32_t seed) {
+        std::vector<uint32_t> frame(static_cast<size_t>(width) * height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const uint32_t r = (x * 255 / width + (Rand(seed) & 7)) & 0xFF;
+                const uint32_t g = (y * 255 / height + (Rand(seed) & 7)) & 0xFF;
+                frame[static_cast<size_t>(y) * width + x] = 0xFF000000u | (r << 16) | (g << 8) | 0x80;
+            }
+        }
+        return frame;
+    }
+
+    Clip ScreenClip(int width, int height, int count) {
+        Clip clip{"screen", width, height, {}};
+        std::vector<uint32_t> frame(static_cast<size_t>(width) * height, 0xFFF0F0F0u);
+        FillRect(frame, width, 0, 0, width, 40, 0xFF2B579Au);
+        uint32_t seed = 7;
+        for (int f = 0; f < count; ++f) {
+            FillRect(frame, width, 300, 400, 2, 18, (f / 15) % 2 ? 0xFF000000u : 0xFFF0F0F0u);
+            if (f % 3 == 0) {
+                for (int i = 0; i < 40; ++i) FillRect(frame, width, 1400 + (Rand(seed) % 300), 600 + (Rand(seed) % 200), 12, 12, Rand(seed) | 0xFF000000u);
+            }
+            clip.frames.push_back(frame);
+        }
+        return clip;
+    }
+
+    Clip SpriteClip(int width, int height, int count) {
+        Clip clip{"sprite", width, height, {}};
+        const std::vector<uint32_t> background = Background(width, height, 11);
+        for (int f = 0; f < count; ++f) {
+            std::vector<uint32_t> frame = background;
+            FillRect(frame, width, (f * 7) % (width - 96), height / 2 - 48 + (f % 20), 96, 96, 0xFFE03030u);
+            clip.frames.push_back(std::move(frame));
+        }
+        return clip;
+    }
+
+    Clip VideoClip(int width, int height, int count) {
+        Clip clip{"video", width, height, {}};
+        for (int f = 0; f < count; ++f) clip.frames.push_back(Background(width, height, 100 + f));
+        return clip;
+    }
+
+    /// The changed rectangle found by comparing every pixel.
+    FrameRect Reference(const uint32_t* before, const uint32_t* after, int width, int height) {
+        FrameRect rect{};
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const size_t i = static_cast<size_t>(y) * width + x;
+                if (before[i] != after[i]) rect.Unite(FrameRect{x, y, 1, 1});
+            }
+        }
+        return rect;
+    }
+
+    bool Same(const FrameRect& a, const FrameRect& b) {
+        return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int scale = argc > 1 ? std::max(1, atoi(argv[1])) : 1;
+    const int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 3;
+
+    std::vector<Clip> clips;
+    clips.push_back(ScreenClip(1920, 1080, 60 * scale));
+    clips.push_back(SpriteClip(1280, 720, 60 * scale));
+    clips.push_back(VideoClip(960, 540, 30 * scale));
+
+    printf("compare: %s\n", CpuFeatures::Name(CpuFeatures::Level()));
+    printf("%-8s %6s %10s | %10s %10s %10s | %12s %12s\n", "clip", "frames", "canvas", "memcpy ms", "scalar ms", "sse2 ms",
+           "dirty KB/fr", "full KB/fr");
+
+    FrameDiff diff;
+    for (const Clip& clip : clips) {
+        const int frames = static_cast<int>(clip.frames.size());
+        const size_t pixels = static_cast<size_t>(clip.width) * clip.height;
+        const std::vector<uint32_t> blank(pixels, 0);
+
+        for (int f = 0; f < frames; ++f) {
+            const uint32_t* before = f ? clip.frames[f - 1].data() : blank.data();
+            const FrameRect expected = Reference(before, clip.frames[f].data(), clip.width, clip.height);
+            for (int simd = 0; simd < 2; ++simd) {
+                diff.SetSimd(simd == 1);
+                if (!Same(diff.Compare(before, clip.frames[f].data(), clip.width, clip.height), expected)) {
+                    printf("%s: frame %d: rectangle differs from the reference (%s)\n", clip.name.c_str(), f, simd ? "sse2" : "scalar");
+                    return 1;
+                }
+            }
+        }
+
+        double copy_ms = 1e30, scalar_ms = 1e30, simd_ms = 1e30;
+        uint64_t dirty_bytes = 0;
+        std::vector<uint32_t> upload(pixels);
+        for (int run = 0; run < runs; ++run) {
+            auto start = Clock::now();
+            for (int f = 0; f < frames; ++f) std::memcpy(upload.data(), clip.frames[f].data(), pixels * 4);
+            copy_ms = std::min(copy_ms, MsSince(start));
+
+            for (int simd = 0; simd < 2; ++simd) {
+                diff.SetSimd(simd == 1);
+                uint64_t bytes = 0;
+                start = Clock::now();
+                for (int f = 0; f < frames; ++f) {
+                    const uint32_t* before = f ? clip.frames[f - 1].data() : blank.data();
+                    const FrameRect dirty = diff.Compare(before, clip.frames[f].data(), clip.width, clip.height);
+                    bytes += static_cast<uint64_t>(dirty.width) * dirty.height * 4;
+                }
+                double& best = simd ? simd_ms : scalar_ms;
+                best = std::min(best, MsSince(start));
+                dirty_bytes = bytes;
+            }
+        }
+
+        char canvas[32];
+        snprintf(canvas, sizeof(canvas), "%dx%d", clip.width, clip.height);
+        printf("%-8s %6d %10s | %10.1f %10.1f %10.1f | %12.0f %12.0f\n", clip.name.c_str(), frames, canvas, copy_ms, scalar_ms,
+               simd_ms, dirty_bytes / 1024.0 / frames, pixels * 4 / 1024.0);
+    }
+    return 0;
+}
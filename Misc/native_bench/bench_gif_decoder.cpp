@@ -0,0 +1,442 @@
+// Benchmark for the portable core of FlyNativeLibHeif/GifDecoder and GifCompositor.
+//
+// Builds large animated GIFs in memory with a small LZW encoder (a photographic clip, a screen
+// recording of small transparent patches, and flat full-frame cartoon frames) and plays each
+// one through, the way NativeAnimator does: every frame composited in order. Reported per clip:
+// - LZW decode of all frames: GifDecoder against a decoder in the classic style (codes read
+//   a byte at a time from the sub-blocks, strings rebuilt through a prefix chain and a stack),
+//   which is how giflib's DGifDecompressLine works; with -DWITH_GIFLIB, also giflib itself,
+// - compositing with the scalar and the AVX2 row expansion,
+// - bytes uploaded per frame: the dirty rectangles against the whole canvas.
+// The decoders' indices are checked to be identical.
+//
+// Build and run: see README.md in this folder.
+
+#include "GifCompositor.h"
+#include "GifDecoder.h"
+#include "CpuFeatures.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef WITH_GIFLIB
+#include <gif_lib.h>
+#endif
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double MsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    uint32_t Rand(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // --- Writer ---------------------------------------------------------------------------
+
+    struct Patch {
+        int x, y, width, height;
+        int disposal;
+        int transparent;                // -1 for none
+        bool interlaced;
+        std::vector<uint8_t> indices;   // In canvas row order.
+    };
+
+    /// LZW encoder with giflib's code-size and table-reset rules.
+    class LzwWriter {
+    public:
+        LzwWriter(std::vector<uint8_t>& out, int min_code_size) : out_(out), min_code_size_(min_code_size) {}
+
+        void Encode(const uint8_t* indices, size_t count) {
+            const uint32_t clear = 1u << min_code_size_;
+            table_.assign(static_cast<size_t>(4096) * 256, 0);
+            Reset();
+            Emit(clear);
+            uint32_t prefix = indices[0];
+            for (size_t i = 1; i < count; ++i) {
+                const uint8_t c = indices[i];
+                const size_t key = static_cast<size_t>(prefix) * 256 + c;
+                if (table_[key] != 0 && stamp_[prefix] == generation_) {
+                    prefix = table_[key];
+                    continue;
+                }
+                Emit(prefix);
+                if (next_ >= 4095) {
+                    Emit(clear);
+                    Reset();
+                } else {
+                    if (stamp_[prefix] != generation_) {
+                        std::memset(&table_[static_cast<size_t>(prefix) * 256], 0, 256 * sizeof(uint16_t));
+                        stamp_[prefix] = generation_;
+                    }
+                    table_[key] = static_cast<uint16_t>(next_++);
+                }
+                prefix = c;
+            }
+            Emit(prefix);
+            Emit(clear + 1);
+            if (bit_count_ > 0) bytes_.push_back(static_cast<uint8_t>(bits_));
+            out_.push_back(static_cast<uint8_t>(min_code_size_));
+            for (size_t i = 0; i < bytes_.size(); i += 255) {
+                const size_t n = std::min<size_t>(255, bytes_.size() - i);
+                out_.push_back(static_cast<uint8_t>(n));
+                out_.insert(out_.end(), bytes_.begin() + i, bytes_.begin() + i + n);
+            }
+            out_.push_back(0);
+        }
+
+    private:
+        void Reset() {
+            next_ = (1u << min_code_size_) + 2;
+            code_bits_ = min_code_size_ + 1;
+            ++generation_;
+        }
+
+        void Emit(uint32_t code) {
+            bits_ |= code << bit_count_;
+            bit_count_ += code_bits_;
+            while (bit_count_ >= 8) {
+                bytes_.push_back(static_cast<uint8_t>(bits_));
+                bits_ >>= 8;
+                bit_count_ -= 8;
+            }
+            if (next_ >= (1u << code_bits_) && code_bits_ < 12) ++code_bits_;
+        }
+
+        std::vector<uint8_t>& out_;
+        int min_code_size_;
+        std::vector<uint16_t> table_;   // (prefix, index) -> code; a row is valid if its stamp is current.
+        uint32_t stamp_[4096] = {};
+        uint32_t generation_ = 0;
+        uint32_t next_ = 0;
+        int code_bits_ = 0;
+        uint32_t bits_ = 0;
+        int bit_count_ = 0;
+        std::vector<uint8_t> bytes_;
+    };
+
+    void Put16(std::vector<uint8_t>& out, int v) {
+        out.push_back(static_cast<uint8_t>(v));
+        out.push_back(static_cast<uint8_t>(v >> 8));
+    }
+
+    std::vector<uint8_t> WriteGif(int width, int height, const uint8_t palette[768], const std::vector<Patch>& patches,
+                                  std::vector<size_t>& lzw_offsets) {
+        std::vector<uint8_t> out = {'G', 'I', 'F', '8', '9', 'a'};
+        Put16(out, width);
+        Put16(out, height);
+        out.push_back(0xF7);            // Global table of 256 entries.
+        out.push_back(0);
+        out.push_back(0);
+        out.insert(out.end(), palette, palette + 768);
+        const uint8_t loop[] = {0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1, 0, 0, 0};
+        out.insert(out.end(), loop, loop + sizeof(loop));
+
+        std::vector<uint8_t> stored;
+        for (const Patch& p : patches) {
+            out.insert(out.end(), {0x21, 0xF9, 4});
+            out.push_back(static_cast<uint8_t>((p.disposal << 2) | (p.transparent >= 0 ? 1 : 0)));
+            Put16(out, 4);
+            out.push_back(static_cast<uint8_t>(p.transparent >= 0 ? p.transparent : 0));
+            out.push_back(0);
+            out.push_back(0x2C);
+            Put16(out, p.x);
+            Put16(out, p.y);
+            Put16(out, p.width);
+            Put16(out, p.height);
+            out.push_back(p.interlaced ? 0x40 : 0);
+
+            const uint8_t* indices = p.indices.data();
+            if (p.interlaced) {
+                stored.resize(p.indices.size());
+                for (int r = 0; r < p.height; ++r) {
+                    std::memcpy(&stored[static_cast<size_t>(r) * p.width],
+                                &p.indices[static_cast<size_t>(GifDecoder::InterlacedRow(r, p.height)) * p.width], p.width);
+                }
+                indices = stored.data();
+            }
+            lzw_offsets.push_back(out.size());
+            LzwWriter(out, 8).Encode(indices, p.indices.size());
+        }
+        out.push_back(0x3B);
+        return out;
+    }
+
+    // --- Clips ----------------------------------------------------------------------------
+
+    struct Clip {
+        std::string name;
+        int width, height;
+        std::vector<Patch> patches;
+    };
+
+    /// Smooth moving gradients with film grain: long runs are rare, as in a converted video.
+    Clip PhotoClip(int width, int height, int frames) {
+        Clip clip{"photo", width, height, {}};
+        uint32_t seed = 7;
+        for (int f = 0; f < frames; ++f) {
+            Patch p{0, 0, width, height, 1, -1, false, {}};
+            p.indices.resize(static_cast<size_t>(width) * height);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const int r = (x * 5 / width + f / 8) % 6, g = (y * 6 / height + (x + f * 9) / 300) % 7;
+                    const int b = ((x + y + f * 13) / 97 + static_cast<int>(Rand(seed) % 3 == 0)) % 6;
+                    p.indices[static_cast<size_t>(y) * width + x] = static_cast<uint8_t>(r * 42 + g * 6 + b);
+                }
+            }
+            clip.patches.push_back(std::move(p));
+        }
+        return clip;
+    }
+
+    /// A static desktop, then small patches where the cursor and a text caret move, unchanged
+    /// pixels made transparent as optimising encoders do.
+    Clip ScreenClip(int width, int height, int frames) {
+        Clip clip{"screen", width, height, {}};
+        Patch first{0, 0, width, height, 1, -1, false, {}};
+        first.indices.resize(static_cast<size_t>(width) * height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                uint8_t v = (y / 40) % 2 ? 250 : 251;
+                if (x > 300 && x < 1600 && y > 100 && y < 950) v = (y % 24 < 14 && (x / 7) % 5 != 0) ? 12 : 255;
+                first.indices[static_cast<size_t>(y) * width + x] = v;
+            }
+        }
+        clip.patches.push_back(std::move(first));
+        uint32_t seed = 11;
+        for (int f = 1; f < frames; ++f) {
+            const int w = 64 + static_cast<int>(Rand(seed) % 320), h = 24 + static_cast<int>(Rand(seed) % 180);
+            Patch p{static_cast<int>(Rand(seed) % (width - w)), static_cast<int>(Rand(seed) % (height - h)), w, h, 1, 0, false, {}};
+            p.indices.resize(static_cast<size_t>(w) * h);
+            for (int y = 0; y < h; ++y) {
+                for (int x = 0; x < w; ++x) {
+                    p.indices[static_cast<size_t>(y) * w + x] = (y % 24 < 14 && (x + f) % 9 < 6) ? 12 : 0;
+                }
+            }
+            clip.patches.push_back(std::move(p));
+        }
+        return clip;
+    }
+
+    /// Flat moving shapes on full frames, every other frame cleared to the background and interlaced.
+    Clip CartoonClip(int width, int height, int frames) {
+        Clip clip{"cartoon", width, height, {}};
+        for (int f = 0; f < frames; ++f) {
+            Patch p{0, 0, width, height, f % 2 ? 2 : 1, 3, f % 2 == 1, {}};
+            p.indices.resize(static_cast<size_t>(width) * height);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const int dx = x - (width / 2 + (f * 17) % 200 - 100), dy = y - height / 2;
+                    uint8_t v = static_cast<uint8_t>(40 + (y / 60) * 3);
+                    if (dx * dx + dy * dy < 150 * 150) v = static_cast<uint8_t>(100 + (dx > 0) + 2 * (dy > 0));
+                    if (std::abs(x - (f * 23) % width) < 30 && y > 400) v = 3;
+                    p.indices[static_cast<size_t>(y) * width + x] = v;
+                }
+            }
+            clip.patches.push_back(std::move(p));
+        }
+        return clip;
+    }
+
+    // --- Classic decoder ------------------------------------------------------------------
+
+    /// Reads codes a byte at a time across the sub-blocks and rebuilds each string by walking
+    /// its prefix chain onto a stack, as giflib does.
+    size_t ClassicDecode(const uint8_t* data, size_t size, size_t offset, uint8_t* out, size_t capacity) {
+        static uint16_t prefix[4096];
+        static uint8_t suffix[4096];
+        static uint8_t stack[4097];
+        const int min_code_size = data[offset++];
+        const uint32_t clear = 1u << min_code_size, end = clear + 1;
+        uint32_t next = clear + 2, code_bits = min_code_size + 1, old = 0xFFFF;
+        uint8_t first = 0;
+        uint32_t shift = 0;
+        int shift_bits = 0;
+        size_t block_left = 0, pos = 0;
+
+        while (pos < capacity) {
+            while (shift_bits < static_cast<int>(code_bits)) {
+                if (block_left == 0) {
+                    if (offset >= size || data[offset] == 0) return pos;
+                    block_left = data[offset++];
+                }
+                shift |= static_cast<uint32_t>(data[offset++]) << shift_bits;
+                shift_bits += 8;
+                --block_left;
+            }
+            uint32_t code = shift & ((1u << code_bits) - 1);
+            shift >>= code_bits;
+            shift_bits -= code_bits;
+
+            if (code == clear) {
+                next = clear + 2;
+                code_bits = min_code_size + 1;
+                old = 0xFFFF;
+                continue;
+            }
+            if (code == end) break;
+            if (old == 0xFFFF) {
+                out[pos++] = first = static_cast<uint8_t>(code);
+                old = code;
+                continue;
+            }
+            const uint32_t in = code;
+            size_t sp = 0;
+            if (code >= next) {
+                stack[sp++] = first;
+                code = old;
+            }
+            while (code >= clear) {
+                stack[sp++] = suffix[code];
+                code = prefix[code];
+            }
+            first = static_cast<uint8_t>(code);
+            stack[sp++] = first;
+            if (next < 4096) {
+                prefix[next] = static_cast<uint16_t>(old);
+                suffix[next] = first;
+                if (++next > (1u << code_bits) - 1 && code_bits < 12) ++code_bits;
+            }
+            while (sp > 0 && pos < capacity) out[pos++] = stack[--sp];
+            old = in;
+        }
+        return pos;
+    }
+
+#ifdef WITH_GIFLIB
+    struct MemoryReader {
+        const uint8_t* data;
+        size_t size, pos;
+    };
+
+    int ReadMemory(GifFileType* gif, GifByteType* buffer, int length) {
+        auto* reader = static_cast<MemoryReader*>(gif->UserData);
+        const size_t n = std::min<size_t>(length, reader->size - reader->pos);
+        std::memcpy(buffer, reader->data + reader->pos, n);
+        reader->pos += n;
+        return static_cast<int>(n);
+    }
+
+    /// DGifSlurp decodes every frame to indices; returns the time, or -1 on failure.
+    double GiflibDecode(const std::vector<uint8_t>& file) {
+        MemoryReader reader{file.data(), file.size(), 0};
+        const auto start = Clock::now();
+        int error = 0;
+        GifFileType* gif = DGifOpen(&reader, &ReadMemory, &error);
+        if (!gif) return -1;
+        const bool ok = DGifSlurp(gif) == GIF_OK;
+        const double ms = MsSince(start);
+        DGifCloseFile(gif, &error);
+        return ok ? ms : -1;
+    }
+#endif
+}
+
+int main(int argc, char** argv) {
+    const int scale = argc > 1 ? std::max(1, atoi(argv[1])) : 1;
+    const int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 3;
+
+    uint8_t palette[768];
+    for (int i = 0; i < 256; ++i) {
+        palette[i * 3] = static_cast<uint8_t>((i / 42) * 51);
+        palette[i * 3 + 1] = static_cast<uint8_t>(((i / 6) % 7) * 42);
+        palette[i * 3 + 2] = static_cast<uint8_t>((i % 6) * 51);
+    }
+
+    std::vector<Clip> clips;
+    clips.push_back(PhotoClip(960, 540, 40 * scale));
+    clips.push_back(ScreenClip(1920, 1080, 200 * scale));
+    clips.push_back(CartoonClip(1280, 720, 60 * scale));
+
+    printf("row expansion: %s\n", CpuFeatures::Name(CpuFeatures::Level()));
+    printf("%-8s %6s %9s %8s | %10s %10s %7s", "clip", "frames", "canvas", "file MB", "classic ms", "native ms", "speed");
+#ifdef WITH_GIFLIB
+    printf(" %10s", "giflib ms");
+#endif
+    printf(" | %10s %10s | %12s %12s\n", "scalar ms", "simd ms", "dirty KB/fr", "full KB/fr");
+
+    int failures = 0;
+    for (const Clip& clip : clips) {
+        std::vector<size_t> offsets;
+        const std::vector<uint8_t> file = WriteGif(clip.width, clip.height, palette, clip.patches, offsets);
+
+        GifCompositor compositor;
+        if (!compositor.Open(file.data(), file.size()) || compositor.Decoder().FrameCount() != static_cast<int>(clip.patches.size())) {
+            printf("%s: failed to open\n", clip.name.c_str());
+            return 1;
+        }
+        GifDecoder decoder;
+        decoder.Open(file.data(), file.size());
+
+        double classic_ms = 1e30, native_ms = 1e30, scalar_ms = 1e30, simd_ms = 1e30;
+        std::vector<uint8_t> native_out, classic_out;
+        for (int run = 0; run < runs; ++run) {
+            auto start = Clock::now();
+            for (size_t f = 0; f < clip.patches.size(); ++f) {
+                const size_t area = clip.patches[f].indices.size();
+                classic_out.resize(area);
+                ClassicDecode(file.data(), file.size(), offsets[f], classic_out.data(), area);
+            }
+            classic_ms = std::min(classic_ms, MsSince(start));
+
+            start = Clock::now();
+            for (int f = 0; f < decoder.FrameCount(); ++f) decoder.DecodeIndices(f, native_out);
+            native_ms = std::min(native_ms, MsSince(start));
+        }
+
+        // The two decoders must agree on every frame.
+        for (size_t f = 0; f < clip.patches.size(); ++f) {
+            const size_t area = clip.patches[f].indices.size();
+            classic_out.resize(area);
+            const size_t a = ClassicDecode(file.data(), file.size(), offsets[f], classic_out.data(), area);
+            const size_t b = decoder.DecodeIndices(static_cast<int>(f), native_out);
+            if (a != area || b != area || std::memcmp(classic_out.data(), native_out.data(), area) != 0) {
+                printf("%s: frame %zu differs\n", clip.name.c_str(), f);
+                ++failures;
+                break;
+            }
+        }
+
+        uint64_t dirty_bytes = 0;
+        for (int run = 0; run < runs; ++run) {
+            for (int simd = 0; simd < 2; ++simd) {
+                compositor.SetSimd(simd == 1);
+                compositor.Reset();
+                uint64_t bytes = 0;
+                FrameRect dirty;
+                const auto start = Clock::now();
+                for (int f = 0; f < compositor.Decoder().FrameCount(); ++f) {
+                    compositor.RenderTo(f, dirty);
+                    bytes += static_cast<uint64_t>(dirty.width) * dirty.height * 4;
+                }
+                double& best = simd ? simd_ms : scalar_ms;
+                best = std::min(best, MsSince(start));
+                dirty_bytes = bytes;
+            }
+        }
+
+        const int frames = compositor.Decoder().FrameCount();
+        char canvas[32];
+        snprintf(canvas, sizeof(canvas), "%dx%d", clip.width, clip.height);
+        printf("%-8s %6d %9s %8.1f | %10.1f %10.1f %6.2fx", clip.name.c_str(), frames, canvas, file.size() / 1048576.0,
+               classic_ms, native_ms, classic_ms / native_ms);
+#ifdef WITH_GIFLIB
+        double giflib_ms = 1e30;
+        for (int run = 0; run < runs; ++run) giflib_ms = std::min(giflib_ms, GiflibDecode(file));
+        printf(" %10.1f", giflib_ms);
+#endif
+        printf(" | %10.1f %10.1f | %12.0f %12.0f\n", scalar_ms, simd_ms, dirty_bytes / 1024.0 / frames,
+               static_cast<double>(clip.width) * clip.height * 4 / 1024.0);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,297 @@
+// Benchmark for the portable core of FlyNativeLibHeif/IcoDecoder.
+//
+// Writes an icon in memory the way icon editors do: DIB entries of every bit depth from 16x16 to
+// 256x256, each with an AND mask (one 32-bit entry with an all-zero alpha channel, so the mask
+// is what makes it transparent), and a 1024x1024 PNG entry. Reported:
+// - decode time of each entry,
+// - Open() plus SelectEntry() for several display sizes, against decoding every entry.
+// Every entry decoded must match the pixels it was written from, premultiplied.
+//
+// Build and run: see README.md in this folder.
+
+#include "IcoDecoder.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double MsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    uint32_t Rand(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    void Put16(std::vector<uint8_t>& out, uint32_t v) {
+        out.push_back(static_cast<uint8_t>(v));
+        out.push_back(static_cast<uint8_t>(v >> 8));
+    }
+
+    void Put32(std::vector<uint8_t>& out, uint32_t v) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    void PutBE32(std::vector<uint8_t>& out, uint32_t v) {
+        for (int i = 3; i >= 0; --i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    uint32_t Premultiply(uint32_t c, uint32_t a) {
+        const uint32_t v = c * a + 128;
+        return (v + (v >> 8)) >> 8;
+    }
+
+    uint32_t Pack(uint32_t b, uint32_t g, uint32_t r, uint32_t a) {
+        return (a << 24) | (Premultiply(r, a) << 16) | (Premultiply(g, a) << 8) | Premultiply(b, a);
+    }
+
+    struct Image {
+        const char* name;
+        int size;
+        int bits;                       // 0 for PNG.
+        bool zero_alpha;                // 32-bit with an all-zero alpha channel.
+        std::vector<uint8_t> data;      // The DIB or PNG.
+        std::vector<uint32_t> expected; // Premultiplied BGRA, top row first.
+    };
+
+    /// A smooth picture with noise, so palette indices and PNG rows are not all alike.
+    void Colour(int x, int y, int size, uint32_t& seed, uint32_t& b, uint32_t& g, uint32_t& r) {
+        b = (x * 255 / size + (Rand(seed) & 15)) & 255;
+        g = (y * 255 / size + (Rand(seed) & 15)) & 255;
+        r = ((x + y) * 127 / size) & 255;
+    }
+
+    Image WriteDib(const char* name, int size, int bits, bool zero_alpha, uint32_t seed) {
+        Image image{name, size, bits, zero_alpha, {}, {}};
+        const size_t stride = (static_cast<size_t>(size) * bits + 31) / 32 * 4;
+        const size_t mask_stride = (static_cast<size_t>(size) + 31) / 32 * 4;
+        const int colors = bits <= 8 ? 1 << bits : 0;
+
+        std::vector<uint8_t>& out = image.data;
+        Put32(out, 40);
+        Put32(out, static_cast<uint32_t>(size));
+        Put32(out, static_cast<uint32_t>(size * 2));
+        Put16(out, 1);
+        Put16(out, static_cast<uint32_t>(bits));
+        for (int i = 0; i < 6; ++i) Put32(out, 0);
+
+        std::vector<uint32_t> palette(colors);
+        for (int i = 0; i < colors; ++i) {
+            palette[i] = Rand(seed) & 0xFFFFFF;
+            Put32(out, palette[i]);
+        }
+
+        std::vector<uint8_t> pixels(stride * size), mask(mask_stride * size);
+        image.expected.resize(static_cast<size_t>(size) * size);
+        for (int y = 0; y < size; ++y) {
+            // Rows are stored bottom-up.
+            uint8_t* row = pixels.data() + stride * (size - 1 - y);
+            uint8_t* mask_row = mask.data() + mask_stride * (size - 1 - y);
+            for (int x = 0; x < size; ++x) {
+                // A transparent disc corner, as icons have.
+                const bool transparent = (x - size / 2) * (x - size / 2) + (y - size / 2) * (y - size / 2) > size * size / 4;
+                if (transparent) mask_row[x >> 3] |= static_cast<uint8_t>(0x80 >> (x & 7));
+                uint32_t b, g, r, a = 255;
+                Colour(x, y, size, seed, b, g, r);
+                switch (bits) {
+                case 1:
+                case 4:
+                case 8: {
+                    const uint32_t index = Rand(seed) % colors;
+                    if (bits == 1) row[x >> 3] |= static_cast<uint8_t>(index << (7 - (x & 7)));
+                    if (bits == 4) row[x >> 1] |= static_cast<uint8_t>(index << ((x & 1) ? 0 : 4));
+                    if (bits == 8) row[x] = static_cast<uint8_t>(index);
+                    b = palette[index] & 255;
+                    g = (palette[index] >> 8) & 255;
+                    r = (palette[index] >> 16) & 255;
+                    break;
+                }
+                case 16: {
+                    const uint32_t v = ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+                    row[x * 2] = static_cast<uint8_t>(v);
+                    row[x * 2 + 1] = static_cast<uint8_t>(v >> 8);
+                    // Scaled to 8 bits with rounding.
+                    b = ((b >> 3) * 510 + 31) / 62;
+                    g = ((g >> 3) * 510 + 31) / 62;
+                    r = ((r >> 3) * 510 + 31) / 62;
+                    break;
+                }
+                case 24:
+                    row[x * 3] = static_cast<uint8_t>(b);
+                    row[x * 3 + 1] = static_cast<uint8_t>(g);
+                    row[x * 3 + 2] = static_cast<uint8_t>(r);
+                    break;
+                default:
+                    a = zero_alpha ? 0 : transparent ? 0 : (x * 7 + y * 3) & 255;
+                    row[x * 4] = static_cast<uint8_t>(b);
+                    row[x * 4 + 1] = static_cast<uint8_t>(g);
+                    row[x * 4 + 2] = static_cast<uint8_t>(r);
+                    row[x * 4 + 3] = static_cast<uint8_t>(a);
+                    break;
+                }
+                const bool use_alpha = bits == 32 && !zero_alpha;
+                if (!use_alpha) a = transparent ? 0 : 255;
+                image.expected[static_cast<size_t>(y) * size + x] = a ? Pack(b, g, r, a) : 0;
+            }
+        }
+        out.insert(out.end(), pixels.begin(), pixels.end());
+        out.insert(out.end(), mask.begin(), mask.end());
+        return image;
+    }
+
+    void PutChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& body) {
+        PutBE32(out, static_cast<uint32_t>(body.size()));
+        const size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), body.begin(), body.end());
+        PutBE32(out, static_cast<uint32_t>(crc32(0, out.data() + start, static_cast<uInt>(out.size() - start))));
+    }
+
+    Image WritePng(const char* name, int size, uint32_t seed) {
+        Image image{name, size, 0, false, {}, {}};
+        image.expected.resize(static_cast<size_t>(size) * size);
+        std::vector<uint8_t> raw;
+        raw.reserve(static_cast<size_t>(size) * (size * 4 + 1));
+        for (int y = 0; y < size; ++y) {
+            raw.push_back(0);
+            for (int x = 0; x < size; ++x) {
+                uint32_t b, g, r;
+                Colour(x, y, size, seed, b, g, r);
+                const uint32_t a = (x + y) * 255 / (2 * size - 2);
+                raw.push_back(static_cast<uint8_t>(r));
+                raw.push_back(static_cast<uint8_t>(g));
+                raw.push_back(static_cast<uint8_t>(b));
+                raw.push_back(static_cast<uint8_t>(a));
+                image.expected[static_cast<size_t>(y) * size + x] = a ? Pack(b, g, r, a) : 0;
+            }
+        }
+        uLongf packed_size = compressBound(static_cast<uLong>(raw.size()));
+        std::vector<uint8_t> packed(packed_size);
+        compress2(packed.data(), &packed_size, raw.data(), static_cast<uLong>(raw.size()), 6);
+        packed.resize(packed_size);
+
+        static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+        std::vector<uint8_t>& out = image.data;
+        out.assign(kSignature, kSignature + 8);
+        std::vector<uint8_t> ihdr;
+        PutBE32(ihdr, static_cast<uint32_t>(size));
+        PutBE32(ihdr, static_cast<uint32_t>(size));
+        ihdr.insert(ihdr.end(), {8, 6, 0, 0, 0});
+        PutChunk(out, "IHDR", ihdr);
+        PutChunk(out, "IDAT", packed);
+        PutChunk(out, "IEND", {});
+        return image;
+    }
+
+    std::vector<uint8_t> WriteIco(const std::vector<Image>& images) {
+        std::vector<uint8_t> out;
+        Put16(out, 0);
+        Put16(out, 1);
+        Put16(out, static_cast<uint32_t>(images.size()));
+        uint32_t offset = static_cast<uint32_t>(6 + 16 * images.size());
+        for (const Image& image : images) {
+            out.push_back(static_cast<uint8_t>(image.size >= 256 ? 0 : image.size));
+            out.push_back(static_cast<uint8_t>(image.size >= 256 ? 0 : image.size));
+            out.push_back(0);
+            out.push_back(0);
+            Put16(out, 1);
+            Put16(out, static_cast<uint32_t>(image.bits ? image.bits : 32));
+            Put32(out, static_cast<uint32_t>(image.data.size()));
+            Put32(out, offset);
+            offset += static_cast<uint32_t>(image.data.size());
+        }
+        for (const Image& image : images) out.insert(out.end(), image.data.begin(), image.data.end());
+        return out;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int runs = argc > 1 ? std::max(1, atoi(argv[1])) : 200;
+
+    // In the order icon editors write them: largest PNG last, as Windows' own icons do.
+    std::vector<Image> images;
+    images.push_back(WriteDib("16 1-bit", 16, 1, false, 1));
+    images.push_back(WriteDib("32 4-bit", 32, 4, false, 2));
+    images.push_back(WriteDib("48 8-bit", 48, 8, false, 3));
+    images.push_back(WriteDib("48 16-bit", 48, 16, false, 4));
+    images.push_back(WriteDib("64 24-bit", 64, 24, false, 5));
+    images.push_back(WriteDib("64 32-bit mask", 64, 32, true, 6));
+    images.push_back(WriteDib("128 32-bit", 128, 32, false, 7));
+    images.push_back(WriteDib("256 32-bit", 256, 32, false, 8));
+    images.push_back(WritePng("1024 PNG", 1024, 9));
+    const std::vector<uint8_t> file = WriteIco(images);
+    printf("icon: %zu entries, %.1f KB\n\n", images.size(), file.size() / 1024.0);
+
+    IcoDecoder decoder;
+    if (!decoder.Open(file.data(), file.size())) {
+        printf("Open() failed\n");
+        return 1;
+    }
+
+    int failures = 0;
+    std::vector<uint32_t> out;
+    printf("%-16s %10s %10s %8s\n", "entry", "size", "decode us", "MP/s");
+    double decode_all_ms = 0;
+    for (int32_t i = 0; i < decoder.EntryCount(); ++i) {
+        const IcoEntry& entry = decoder.Entry(i);
+        const Image& image = images[i];
+        if (entry.width != image.size || entry.height != image.size || !entry.can_decode) {
+            printf("%-16s entry reads as %dx%d, can_decode %d\n", image.name, entry.width, entry.height, entry.can_decode);
+            ++failures;
+            continue;
+        }
+        out.assign(static_cast<size_t>(entry.width) * entry.height, 0xDEADBEEF);
+        const int entry_runs = std::max(1, runs * 64 * 64 / (entry.width * entry.height));
+        double best = 1e30;
+        for (int run = 0; run < entry_runs; ++run) {
+            const auto start = Clock::now();
+            const bool ok = decoder.Decode(i, out.data());
+            best = std::min(best, MsSince(start));
+            if (!ok) {
+                printf("%-16s Decode() failed\n", image.name);
+                ++failures;
+                break;
+            }
+        }
+        if (out != image.expected) {
+            size_t first = 0;
+            while (out[first] == image.expected[first]) ++first;
+            printf("%-16s pixel %zu is %08X, expected %08X\n", image.name, first, out[first], image.expected[first]);
+            ++failures;
+        }
+        decode_all_ms += best;
+        printf("%-16s %5dx%-4d %10.1f %8.0f\n", image.name, entry.width, entry.height, best * 1000,
+               entry.width * entry.height / (best * 1000));
+    }
+
+    printf("\n%-28s %10s %12s\n", "display size", "entry", "open+select us");
+    for (int32_t size : {16, 40, 100, 256, 800}) {
+        double best = 1e30;
+        int32_t selected = -1;
+        for (int run = 0; run < runs; ++run) {
+            const auto start = Clock::now();
+            IcoDecoder d;
+            d.Open(file.data(), file.size());
+            selected = d.SelectEntry(size);
+            best = std::min(best, MsSince(start));
+        }
+        printf("%-28d %10s %12.2f\n", size, selected >= 0 ? images[selected].name : "none", best * 1000);
+    }
+    printf("decoding every entry: %.1f us\n", decode_all_ms * 1000);
+
+    if (failures) printf("\n%d FAILURES\n", failures);
+    return failures ? 1 : 0;
+}
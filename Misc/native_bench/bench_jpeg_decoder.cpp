@@ -0,0 +1,404 @@
+// Benchmark for the portable core of FlyNativeLibHeif/JpegDecoder.
+//
+// Encodes synthetic photos in memory with libjpeg: 4:2:0, 4:2:2, 4:4:4 and greyscale, with a
+// restart marker every MCU row, every 2 rows, every 7 MCUs (so only some markers start a row),
+// none, and progressive. Some carry an EXIF block with an orientation and a JPEG thumbnail.
+// Reported:
+// - correctness: every layout at every IDCT scale, decoded in bands, against one serial
+//   libjpeg pass; and every EXIF orientation against the serial pass turned by hand,
+// - preview: the scale SelectScale(800) picks, against a full decode then a box downscale to
+//   the same size, as a resize-after-decode pipeline does,
+// - the EXIF thumbnail path when the thumbnail covers the preview size,
+// - HQ: a full decode serially and in restart-marker bands.
+//
+// Build and run: see README.md in this folder.
+
+#include "JpegDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <jpeglib.h>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double MsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    uint32_t Rand(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    /// A photo-like RGB image: smooth gradients, a few hard edges and some sensor noise.
+    std::vector<uint8_t> Photo(int width, int height, uint32_t seed) {
+        std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+        uint32_t state = seed | 1;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                uint8_t* p = &rgb[(static_cast<size_t>(y) * width + x) * 3];
+                const int band = ((x / 97) + (y / 61)) & 3;
+                const int noise = static_cast<int>(Rand(state) % 13) - 6;
+                const int base[3] = {x * 255 / width, y * 255 / height, (x + y) * 127 / (width + height) + 64 * band};
+                for (int c = 0; c < 3; ++c) p[c] = static_cast<uint8_t>(std::clamp(base[c] + noise, 0, 255));
+            }
+        }
+        return rgb;
+    }
+
+    /// Box-filters packed `channels`-byte pixels to `out_width` x `out_height`.
+    std::vector<uint8_t> Downscale(const uint8_t* src, int width, int height, int channels, int out_width, int out_height) {
+        std::vector<uint8_t> out(static_cast<size_t>(out_width) * out_height * channels);
+        for (int oy = 0; oy < out_height; ++oy) {
+            const int y0 = static_cast<int>(static_cast<int64_t>(oy) * height / out_height);
+            const int y1 = std::max(y0 + 1, static_cast<int>(static_cast<int64_t>(oy + 1) * height / out_height));
+            for (int ox = 0; ox < out_width; ++ox) {
+                const int x0 = static_cast<int>(static_cast<int64_t>(ox) * width / out_width);
+                const int x1 = std::max(x0 + 1, static_cast<int>(static_cast<int64_t>(ox + 1) * width / out_width));
+                for (int c = 0; c < channels; ++c) {
+                    uint32_t sum = 0;
+                    for (int y = y0; y < y1; ++y) {
+                        const uint8_t* row = src + (static_cast<size_t>(y) * width + x0) * channels + c;
+                        for (int x = x0; x < x1; ++x, row += channels) sum += *row;
+                    }
+                    const uint32_t count = static_cast<uint32_t>((y1 - y0) * (x1 - x0));
+                    out[(static_cast<size_t>(oy) * out_width + ox) * channels + c] = static_cast<uint8_t>((sum + count / 2) / count);
+                }
+            }
+        }
+        return out;
+    }
+
+    struct ErrorManager {
+        jpeg_error_mgr base;
+        jmp_buf jump;
+    };
+
+    void ErrorExit(j_common_ptr cinfo) { longjmp(reinterpret_cast<ErrorManager*>(cinfo->err)->jump, 1); }
+
+    struct EncodeOptions {
+        int h = 2, v = 2;               // Luma sampling factors; 0 for greyscale.
+        int restart_rows = 0;           // Restart marker every this many MCU rows...
+        int restart_mcus = 0;           // ...or every this many MCUs.
+        bool progressive = false;
+        int quality = 90;
+        std::vector<uint8_t> app1;      // Written as an APP1 segment if not empty.
+    };
+
+    std::vector<uint8_t> Encode(const std::vector<uint8_t>& rgb, int width, int height, const EncodeOptions& options) {
+        jpeg_compress_struct cinfo;
+        jpeg_error_mgr error;
+        cinfo.err = jpeg_std_error(&error);
+        jpeg_create_compress(&cinfo);
+        unsigned char* buffer = nullptr;
+        unsigned long size = 0;
+        jpeg_mem_dest(&cinfo, &buffer, &size);
+
+        const bool grey = options.h == 0;
+        std::vector<uint8_t> luma;
+        if (grey) {
+            luma.resize(static_cast<size_t>(width) * height);
+            for (size_t i = 0; i < luma.size(); ++i) luma[i] = static_cast<uint8_t>((rgb[i * 3] * 77 + rgb[i * 3 + 1] * 150 + rgb[i * 3 + 2] * 29) >> 8);
+        }
+        cinfo.image_width = static_cast<JDIMENSION>(width);
+        cinfo.image_height = static_cast<JDIMENSION>(height);
+        cinfo.input_components = grey ? 1 : 3;
+        cinfo.in_color_space = grey ? JCS_GRAYSCALE : JCS_RGB;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality(&cinfo, options.quality, TRUE);
+        if (!grey) {
+            cinfo.comp_info[0].h_samp_factor = options.h;
+            cinfo.comp_info[0].v_samp_factor = options.v;
+        }
+        cinfo.restart_in_rows = options.restart_rows;
+        cinfo.restart_interval = static_cast<unsigned int>(options.restart_mcus);
+        if (options.progressive) jpeg_simple_progression(&cinfo);
+        jpeg_start_compress(&cinfo, TRUE);
+        if (!options.app1.empty()) {
+            jpeg_write_marker(&cinfo, JPEG_APP0 + 1, options.app1.data(), static_cast<unsigned int>(options.app1.size()));
+        }
+        const uint8_t* pixels = grey ? luma.data() : rgb.data();
+        const size_t pitch = static_cast<size_t>(width) * (grey ? 1 : 3);
+        while (cinfo.next_scanline < cinfo.image_height) {
+            JSAMPROW row = const_cast<JSAMPROW>(pixels + pitch * cinfo.next_scanline);
+            jpeg_write_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+        std::vector<uint8_t> out(buffer, buffer + size);
+        free(buffer);
+        return out;
+    }
+
+    void Put16(std::vector<uint8_t>& out, uint32_t v) {
+        out.push_back(static_cast<uint8_t>(v));
+        out.push_back(static_cast<uint8_t>(v >> 8));
+    }
+
+    void Put32(std::vector<uint8_t>& out, uint32_t v) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    void PutEntry(std::vector<uint8_t>& out, uint16_t tag, uint16_t type, uint32_t value) {
+        Put16(out, tag);
+        Put16(out, type);
+        Put32(out, 1);
+        Put32(out, value);
+    }
+
+    /// An APP1 "Exif" payload: IFD0 with the orientation, and IFD1 pointing at `thumbnail`.
+    std::vector<uint8_t> Exif(int orientation, const std::vector<uint8_t>& thumbnail) {
+        std::vector<uint8_t> out = {'E', 'x', 'i', 'f', 0, 0};
+        std::vector<uint8_t> tiff = {'I', 'I', 42, 0};
+        Put32(tiff, 8);
+        Put16(tiff, 1);
+        PutEntry(tiff, 0x0112, 3, static_cast<uint32_t>(orientation));
+        Put32(tiff, thumbnail.empty() ? 0 : 26);                    // IFD1 follows IFD0.
+        if (!thumbnail.empty()) {
+            Put16(tiff, 3);
+            PutEntry(tiff, 0x0103, 3, 6);
+            PutEntry(tiff, 0x0201, 4, 26 + 2 + 3 * 12 + 4);
+            PutEntry(tiff, 0x0202, 4, static_cast<uint32_t>(thumbnail.size()));
+            Put32(tiff, 0);
+            tiff.insert(tiff.end(), thumbnail.begin(), thumbnail.end());
+        }
+        out.insert(out.end(), tiff.begin(), tiff.end());
+        return out;
+    }
+
+    /// A serial decode with libjpeg alone, as stored: the reference.
+    bool Reference(const std::vector<uint8_t>& jpeg, int denominator, std::vector<uint8_t>& bgra, int& width, int& height) {
+        jpeg_decompress_struct cinfo;
+        ErrorManager error;
+        cinfo.err = jpeg_std_error(&error.base);
+        error.base.error_exit = ErrorExit;
+        if (setjmp(error.jump)) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo, jpeg.data(), static_cast<unsigned long>(jpeg.size()));
+        jpeg_read_header(&cinfo, TRUE);
+        cinfo.out_color_space = JCS_EXT_BGRA;
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = static_cast<unsigned int>(denominator);
+        jpeg_start_decompress(&cinfo);
+        width = static_cast<int>(cinfo.output_width);
+        height = static_cast<int>(cinfo.output_height);
+        bgra.resize(static_cast<size_t>(width) * height * 4);
+        while (cinfo.output_scanline < cinfo.output_height) {
+            JSAMPROW row = bgra.data() + static_cast<size_t>(cinfo.output_scanline) * width * 4;
+            jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+        return true;
+    }
+
+    /// Turns a stored image to EXIF `orientation` one pixel at a time.
+    std::vector<uint8_t> Turn(const std::vector<uint8_t>& src, int width, int height, int orientation) {
+        const bool swap = orientation >= 5;
+        const int out_width = swap ? height : width, out_height = swap ? width : height;
+        std::vector<uint8_t> out(src.size());
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                int ox = x, oy = y;
+                switch (orientation) {
+                case 2: ox = width - 1 - x; break;
+                case 3: ox = width - 1 - x; oy = height - 1 - y; break;
+                case 4: oy = height - 1 - y; break;
+                case 5: ox = y; oy = x; break;
+                case 6: ox = height - 1 - y; oy = x; break;
+                case 7: ox = height - 1 - y; oy = width - 1 - x; break;
+                case 8: ox = y; oy = width - 1 - x; break;
+                default: break;
+                }
+                std::memcpy(&out[(static_cast<size_t>(oy) * out_width + ox) * 4], &src[(static_cast<size_t>(y) * width + x) * 4], 4);
+            }
+        }
+        (void)out_height;
+        return out;
+    }
+
+    bool DecodeWith(const std::vector<uint8_t>& jpeg, const JpegScale& scale, unsigned threads, std::vector<uint8_t>& out) {
+        JpegDecoder decoder;
+        if (!decoder.Open(jpeg.data(), jpeg.size())) return false;
+        out.assign(static_cast<size_t>(scale.width) * scale.height * 4, 0);
+        return decoder.Decode(scale, out.data(), static_cast<size_t>(scale.width) * 4, threads);
+    }
+
+    template <typename Fn>
+    double Best(int runs, Fn&& fn) {
+        double best = 1e30;
+        for (int r = 0; r < runs; ++r) {
+            const auto start = Clock::now();
+            fn();
+            best = std::min(best, MsSince(start));
+        }
+        return best;
+    }
+
+    struct Layout {
+        const char* name;
+        EncodeOptions options;
+    };
+
+    EncodeOptions Options(int h, int v, int restart_rows, int restart_mcus, bool progressive = false) {
+        EncodeOptions options;
+        options.h = h;
+        options.v = v;
+        options.restart_rows = restart_rows;
+        options.restart_mcus = restart_mcus;
+        options.progressive = progressive;
+        return options;
+    }
+
+    int CheckLayouts() {
+        const int width = 2501, height = 1703;
+        const std::vector<uint8_t> rgb = Photo(width, height, 7);
+        const Layout layouts[] = {
+            {"4:2:0, restart every row", Options(2, 2, 1, 0)},
+            {"4:2:2, restart every row", Options(2, 1, 1, 0)},
+            {"4:4:4, restart every row", Options(1, 1, 1, 0)},
+            {"grey, restart every row", Options(0, 0, 1, 0)},
+            {"4:2:0, restart every 7 MCUs", Options(2, 2, 0, 7)},
+            {"4:2:0, restart every 2 rows", Options(2, 2, 2, 0)},
+            {"4:2:0, no restart markers", Options(2, 2, 0, 0)},
+            {"4:2:0, progressive", Options(2, 2, 0, 0, true)},
+        };
+
+        int failures = 0, checks = 0;
+        for (const Layout& layout : layouts) {
+            const std::vector<uint8_t> jpeg = Encode(rgb, width, height, layout.options);
+            JpegDecoder decoder;
+            if (!decoder.Open(jpeg.data(), jpeg.size()) || !decoder.Info().can_decode) {
+                std::printf("FAIL %s: not opened\n", layout.name);
+                ++failures;
+                continue;
+            }
+            for (int denominator : {1, 2, 4, 8}) {
+                std::vector<uint8_t> expected, banded, serial;
+                int w = 0, h = 0;
+                const JpegScale scale = decoder.Resolve(0, denominator);
+                const bool ok = Reference(jpeg, denominator, expected, w, h) && w == scale.width && h == scale.height &&
+                                DecodeWith(jpeg, scale, 4, banded) && DecodeWith(jpeg, scale, 1, serial);
+                ++checks;
+                if (!ok || banded != expected || serial != expected) {
+                    size_t diff = 0;
+                    for (size_t i = 0; ok && i < expected.size(); ++i) diff += banded[i] != expected[i];
+                    std::printf("FAIL %s at 1/%d: %zu bytes differ\n", layout.name, denominator, diff);
+                    ++failures;
+                }
+            }
+        }
+
+        // Orientation, on a small image with an EXIF thumbnail that has to be turned too.
+        const int tw = 641, th = 427;
+        const std::vector<uint8_t> small = Photo(tw, th, 3);
+        const std::vector<uint8_t> thumb_rgb = Downscale(small.data(), tw, th, 3, 160, 107);
+        const std::vector<uint8_t> thumbnail = Encode(thumb_rgb, 160, 107, Options(2, 2, 0, 0));
+        for (int orientation = 1; orientation <= 8; ++orientation) {
+            EncodeOptions options = Options(2, 2, 1, 0);
+            options.app1 = Exif(orientation, thumbnail);
+            const std::vector<uint8_t> jpeg = Encode(small, tw, th, options);
+            JpegDecoder decoder;
+            ++checks;
+            if (!decoder.Open(jpeg.data(), jpeg.size()) || decoder.Info().orientation != orientation ||
+                decoder.Info().thumbnail_width != (orientation >= 5 ? 107 : 160)) {
+                std::printf("FAIL orientation %d: header\n", orientation);
+                ++failures;
+                continue;
+            }
+            for (int thumb : {0, 1}) {
+                std::vector<uint8_t> stored, decoded;
+                int w = 0, h = 0;
+                const JpegScale scale = decoder.Resolve(thumb, thumb ? 1 : 2);
+                const bool ok = Reference(thumb ? thumbnail : jpeg, thumb ? 1 : 2, stored, w, h) &&
+                                DecodeWith(jpeg, scale, 4, decoded);
+                if (!ok || decoded != Turn(stored, w, h, orientation)) {
+                    std::printf("FAIL orientation %d, %s\n", orientation, thumb ? "thumbnail" : "1/2");
+                    ++failures;
+                }
+            }
+        }
+        std::printf("%d checks, %d failures\n\n", checks, failures);
+        return failures;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int runs = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+    const int width = argc > 2 ? std::atoi(argv[2]) : 6000;
+    const int height = width * 2 / 3;
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+    const int failures = CheckLayouts();
+
+    const std::vector<uint8_t> rgb = Photo(width, height, 11);
+    const std::vector<uint8_t> plain = Encode(rgb, width, height, Options(2, 2, 0, 0));
+    const std::vector<uint8_t> restart = Encode(rgb, width, height, Options(2, 2, 1, 0));
+    const std::vector<uint8_t> progressive = Encode(rgb, width, height, Options(2, 2, 0, 0, true));
+
+    std::printf("%dx%d 4:2:0 q90, 800px preview     file MB  scaled decode  decode + box scale  speed-up\n", width, height);
+    for (const auto& [name, jpeg] : {std::pair<const char*, const std::vector<uint8_t>*>{"baseline", &plain},
+                                     {"progressive", &progressive}}) {
+        JpegDecoder decoder;
+        decoder.Open(jpeg->data(), jpeg->size());
+        const JpegScale scale = decoder.SelectScale(800);
+        const JpegScale full = decoder.SelectScale(0);
+        std::vector<uint8_t> out(static_cast<size_t>(scale.width) * scale.height * 4);
+        std::vector<uint8_t> big(static_cast<size_t>(full.width) * full.height * 4);
+        const double scaled = Best(runs, [&] { decoder.Decode(scale, out.data(), static_cast<size_t>(scale.width) * 4, 1); });
+        const double resized = Best(runs, [&] {
+            decoder.Decode(full, big.data(), static_cast<size_t>(full.width) * 4, 1);
+            out = Downscale(big.data(), full.width, full.height, 4, scale.width, scale.height);
+        });
+        std::printf("%-12s 1/%d -> %4dx%-4d        %6.1f  %10.1fms  %16.1fms  %7.1fx\n", name, scale.denominator, scale.width,
+                    scale.height, jpeg->size() / 1e6, scaled, resized, resized / scaled);
+    }
+
+    // A camera-style EXIF thumbnail large enough for the preview.
+    {
+        const std::vector<uint8_t> thumb_rgb = Downscale(rgb.data(), width, height, 3, 1024, 1024 * height / width);
+        EncodeOptions options = Options(2, 2, 0, 0);
+        // APP1 is limited to 64 KB, so the thumbnail is compressed harder, as cameras do.
+        EncodeOptions thumb_options = Options(2, 2, 0, 0);
+        thumb_options.quality = 50;
+        options.app1 = Exif(1, Encode(thumb_rgb, 1024, 1024 * height / width, thumb_options));
+        const std::vector<uint8_t> jpeg = Encode(rgb, width, height, options);
+        JpegDecoder decoder;
+        decoder.Open(jpeg.data(), jpeg.size());
+        const JpegScale scale = decoder.SelectScale(800);
+        std::vector<uint8_t> out(static_cast<size_t>(scale.width) * scale.height * 4);
+        const double ms = Best(runs, [&] { decoder.Decode(scale, out.data(), static_cast<size_t>(scale.width) * 4, 1); });
+        std::printf("%-12s %s %4dx%-4d               %10.1fms\n", "EXIF thumb", scale.thumbnail ? "thumbnail" : "main image",
+                    scale.width, scale.height, ms);
+    }
+
+    std::printf("\nfull decode                      1 thread  %u-band  all cores   (%u cores)\n", 4u, cores);
+    for (const auto& [name, jpeg] : {std::pair<const char*, const std::vector<uint8_t>*>{"no restart markers", &plain},
+                                     {"restart every MCU row", &restart},
+                                     {"progressive", &progressive}}) {
+        JpegDecoder decoder;
+        decoder.Open(jpeg->data(), jpeg->size());
+        const JpegScale full = decoder.SelectScale(0);
+        std::vector<uint8_t> out(static_cast<size_t>(full.width) * full.height * 4);
+        const size_t stride = static_cast<size_t>(full.width) * 4;
+        const double one = Best(runs, [&] { decoder.Decode(full, out.data(), stride, 1); });
+        const double four = Best(runs, [&] { decoder.Decode(full, out.data(), stride, 4); });
+        const double all = Best(runs, [&] { decoder.Decode(full, out.data(), stride, 0); });
+        std::printf("%-28s %9.1fms %7.1fms %8.1fms\n", name, one, four, all);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,337 @@
+// Replay harness for FlyNativeLibHeif/NavigationPredictor.
+//
+// Replays navigation traces against the real PrefetchScheduler twice: once with the symmetric
+// window PrefetchCache used before, once with the window shaped by NavigationPredictor's plan.
+// Loads sleep for a synthetic decode cost while holding one of a fixed number of simulated
+// cores. Reports how often the photo navigated to already had its preview and its HQ bitmap on
+// arrival, how often the HQ bitmap was ready before the user moved on, the HQ decodes spent on
+// photos never shown, and the peak memory held.
+//
+// A trace is a text file of "time_ms position kind" lines, kind being step, repeat or jump;
+// '#' starts a comment. Without a file, four synthetic sessions are replayed: steady stepping,
+// fast culling, a held key, and jumps around the thumbnail strip.
+//
+// Build and run: see README.md in this folder.
+
+#include "NavigationPredictor.h"
+#include "PrefetchScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    struct Trace {
+        std::string name;
+        std::vector<NavigationEvent> events;
+    };
+
+    /// A fixed number of cores every synthetic load must hold while it "decodes".
+    class SimulatedCpu {
+    public:
+        explicit SimulatedCpu(int cores) : free_(cores) {}
+
+        void Run(std::chrono::microseconds cost) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return free_ > 0; });
+                --free_;
+            }
+            std::this_thread::sleep_for(cost);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++free_;
+            }
+            cv_.notify_one();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        int free_;
+    };
+
+    /// Photo state behind the scheduler's hooks.
+    struct Library {
+        Library(int photos, int cores, double speed)
+            : cpu(cores), speed(speed), preview(photos), hq(photos), hq_decoded(photos) {}
+
+        SimulatedCpu cpu;
+        double speed;
+        int preview_us = 8000;
+        int hq_us = 350000;
+        uint64_t preview_bytes = 2ull << 20;
+        uint64_t hq_bytes = 64ull << 20;
+        std::vector<std::atomic<bool>> preview;
+        std::vector<std::atomic<bool>> hq;
+        std::vector<std::atomic<bool>> hq_decoded;
+        std::atomic<uint64_t> resident{ 0 };
+        std::atomic<uint64_t> peak{ 0 };
+
+        /// Costs vary by key so loads finish out of order.
+        std::chrono::microseconds Cost(int key, int base) const {
+            return std::chrono::microseconds(static_cast<int64_t>((base / 2 + (key * 7919 % 100) * base / 100) / speed));
+        }
+
+        void Hold(uint64_t bytes) {
+            const uint64_t now = resident += bytes;
+            uint64_t prev = peak.load();
+            while (now > prev && !peak.compare_exchange_weak(prev, now)) {}
+        }
+
+        uint64_t Load(int key, PrefetchTier tier) {
+            if (tier == PrefetchTier::Preview) {
+                cpu.Run(Cost(key, preview_us));
+                preview[key] = true;
+                Hold(preview_bytes);
+                return preview_bytes;
+            }
+            if (tier == PrefetchTier::Hq) {
+                cpu.Run(Cost(key, hq_us));
+                hq[key] = true;
+                hq_decoded[key] = true;
+                Hold(hq_bytes);
+                return hq_bytes;
+            }
+            return 0;
+        }
+
+        void Release(int key, PrefetchTier tier) {
+            auto& flag = tier == PrefetchTier::Hq ? hq[key] : preview[key];
+            if (flag.exchange(false)) resident -= tier == PrefetchTier::Hq ? hq_bytes : preview_bytes;
+        }
+    };
+
+    struct Result {
+        int arrivals = 0, preview_hits = 0, hq_hits = 0, hq_ready = 0, settled = 0, wasted_hq = 0;
+        uint64_t peak = 0;
+    };
+
+    /// Drives one scheduler through a trace the way PrefetchCache does.
+    class Player {
+    public:
+        Player(Library& library, int photos, int cores, uint64_t budget, bool predict, int preview_radius, int hq_radius)
+            : library_(library), photos_(photos), predict_(predict), predictor_(preview_radius, hq_radius),
+              preview_radius_(preview_radius), hq_radius_(hq_radius) {
+            const PrefetchHooks hooks{ &LoadHook, &ReleaseHook, nullptr, this };
+            PrefetchOptions options{};
+            options.threads = cores;
+            options.memory_budget = budget;
+            options.preview_estimate = library.preview_bytes;
+            options.hq_estimate = library.hq_bytes;
+            scheduler_ = std::make_unique<PrefetchScheduler>(hooks, options);
+            scheduler_->Start();
+        }
+
+        Result Replay(const std::vector<NavigationEvent>& events) {
+            Result r;
+            std::vector<char> shown(photos_);
+            for (size_t i = 0; i < events.size(); ++i) {
+                const NavigationEvent& e = events[i];
+                const int centre = std::clamp(e.position, 0, photos_ - 1);
+                const bool burst = e.kind == static_cast<int32_t>(NavigationKind::Repeat);
+                shown[centre] = 1;
+                if (i > 0) {
+                    ++r.arrivals;
+                    if (library_.preview[centre]) ++r.preview_hits;
+                    if (library_.hq[centre]) ++r.hq_hits;
+                }
+                Move(e, centre, burst);
+
+                const int64_t dwell = i + 1 < events.size() ? events[i + 1].time_ms - e.time_ms : 500;
+                std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(dwell * 1000 / library_.speed)));
+                if (!burst && i > 0) {
+                    ++r.settled;
+                    if (library_.hq[centre]) ++r.hq_ready;
+                }
+                // PrefetchCache ends the burst once the key is released.
+                if (burst && (i + 1 == events.size() || events[i + 1].kind != e.kind)) scheduler_->EndBurst();
+            }
+            scheduler_->Stop();
+            for (int key = 0; key < photos_; ++key) {
+                if (library_.hq_decoded[key] && !shown[key]) ++r.wasted_hq;
+            }
+            r.peak = library_.peak;
+            return r;
+        }
+
+    private:
+        void Move(const NavigationEvent& e, int centre, bool burst) {
+            PrefetchWindow window{};
+            window.centre = centre;
+            window.burst = burst ? 1 : 0;
+            window.preview_radius = window.preview_behind = preview_radius_;
+            window.hq_radius = window.hq_behind = hq_radius_;
+            const PrefetchPlan plan = predictor_.Record(e);
+            if (predict_) {
+                window.direction = plan.direction;
+                window.preview_radius = plan.preview_ahead;
+                window.preview_behind = plan.preview_behind;
+                window.hq_radius = plan.hq_ahead;
+                window.hq_behind = plan.hq_behind;
+                window.behind_weight = plan.behind_weight;
+            }
+            const int back = std::max(window.preview_behind, window.hq_behind);
+            const int ahead = std::max(window.preview_radius, window.hq_radius);
+            const int left = window.direction > 0 ? back : ahead;
+            const int right = window.direction < 0 ? back : ahead;
+            window.first = std::max(0, centre - left);
+            const int last = std::min(photos_ - 1, centre + right);
+            keys_.clear();
+            for (int key = window.first; key <= last; ++key) keys_.push_back(key);
+            scheduler_->MoveWindow(window, keys_.data(), static_cast<int32_t>(keys_.size()));
+        }
+
+        static int64_t LoadHook(void* context, int32_t key, int32_t tier) {
+            auto* self = static_cast<Player*>(context);
+            return static_cast<int64_t>(self->library_.Load(key, static_cast<PrefetchTier>(tier)));
+        }
+
+        static void ReleaseHook(void* context, int32_t key, int32_t tier) {
+            static_cast<Player*>(context)->library_.Release(key, static_cast<PrefetchTier>(tier));
+        }
+
+        Library& library_;
+        int photos_;
+        bool predict_;
+        NavigationPredictor predictor_;
+        int preview_radius_, hq_radius_;
+        std::vector<int32_t> keys_;
+        std::unique_ptr<PrefetchScheduler> scheduler_;
+    };
+
+    NavigationEvent Event(int64_t t, int position, NavigationKind kind) {
+        return NavigationEvent{ t, position, static_cast<int32_t>(kind) };
+    }
+
+    /// Synthetic sessions over a folder of `photos`, from a fixed seed.
+    std::vector<Trace> SyntheticTraces(int photos) {
+        std::mt19937 rng(1234);
+        auto uniform = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+        std::vector<Trace> traces;
+
+        // Steady stepping, looking at each photo for a while, sometimes one back.
+        Trace steady{ "steady", {} };
+        int64_t t = 0;
+        int pos = photos / 4;
+        steady.events.push_back(Event(t, pos, NavigationKind::Jump));
+        for (int i = 0; i < 60; ++i) {
+            t += uniform(500, 1500);
+            pos += uniform(0, 9) == 0 ? -1 : 1;
+            steady.events.push_back(Event(t, pos, NavigationKind::Step));
+        }
+        traces.push_back(steady);
+
+        // Culling: stepping faster than an HQ decode, forward only.
+        Trace culling{ "culling", {} };
+        t = 0;
+        pos = photos / 4;
+        culling.events.push_back(Event(t, pos, NavigationKind::Jump));
+        for (int i = 0; i < 80; ++i) {
+            t += uniform(150, 300);
+            culling.events.push_back(Event(t, ++pos, NavigationKind::Step));
+        }
+        traces.push_back(culling);
+
+        // Held key: runs of repeats, a look at where it stopped, then a few steps.
+        Trace held{ "held key", {} };
+        t = 0;
+        pos = photos / 4;
+        held.events.push_back(Event(t, pos, NavigationKind::Jump));
+        for (int run = 0; run < 4; ++run) {
+            const int direction = run == 2 ? -1 : 1;
+            for (int i = 0; i < 25; ++i) held.events.push_back(Event(t += 33, pos += direction, NavigationKind::Repeat));
+            for (int i = 0; i < 6; ++i) held.events.push_back(Event(t += uniform(600, 1200), pos += direction, NavigationKind::Step));
+        }
+        traces.push_back(held);
+
+        // Jumping around the thumbnail strip, with a step either way now and then.
+        Trace jumps{ "jumps", {} };
+        t = 0;
+        pos = photos / 2;
+        jumps.events.push_back(Event(t, pos, NavigationKind::Jump));
+        for (int i = 0; i < 50; ++i) {
+            t += uniform(600, 1400);
+            if (uniform(0, 3) == 0) {
+                pos += uniform(0, 1) ? 1 : -1;
+                jumps.events.push_back(Event(t, pos, NavigationKind::Step));
+            } else {
+                pos = std::clamp(pos + uniform(-4, 4), 0, photos - 1);
+                jumps.events.push_back(Event(t, pos, NavigationKind::Jump));
+            }
+        }
+        traces.push_back(jumps);
+        return traces;
+    }
+
+    bool LoadTrace(const char* path, Trace& trace) {
+        FILE* f = std::fopen(path, "r");
+        if (!f) return false;
+        trace.name = path;
+        char line[256];
+        while (std::fgets(line, sizeof(line), f)) {
+            long long time_ms = 0;
+            int position = 0;
+            char kind[32] = {};
+            if (line[0] == '#' || std::sscanf(line, "%lld %d %31s", &time_ms, &position, kind) != 3) continue;
+            const NavigationKind k = std::strcmp(kind, "repeat") == 0 ? NavigationKind::Repeat
+                : std::strcmp(kind, "jump") == 0 ? NavigationKind::Jump : NavigationKind::Step;
+            trace.events.push_back(Event(time_ms, position, k));
+        }
+        std::fclose(f);
+        return !trace.events.empty();
+    }
+
+    void Print(const char* name, const Result& r) {
+        std::printf("  %-10s %8.1f%% %9.1f%% %9.1f%% %9d %9.0f\n", name, 100.0 * r.preview_hits / std::max(1, r.arrivals),
+                    100.0 * r.hq_hits / std::max(1, r.arrivals), 100.0 * r.hq_ready / std::max(1, r.settled), r.wasted_hq,
+                    r.peak / 1048576.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    const int cores = argc > 1 ? atoi(argv[1]) : 2;
+    const double speed = argc > 2 ? atof(argv[2]) : 8.0;
+    const int preview_radius = 200;
+    const int hq_radius = 2;
+    const uint64_t budget = 2048ull << 20;
+
+    std::vector<Trace> traces;
+    int photos = 2000;
+    if (argc > 3) {
+        Trace trace;
+        if (!LoadTrace(argv[3], trace)) {
+            std::fprintf(stderr, "cannot read trace %s\n", argv[3]);
+            return 1;
+        }
+        for (const NavigationEvent& e : trace.events) photos = std::max(photos, e.position + 1);
+        traces.push_back(trace);
+    } else {
+        traces = SyntheticTraces(photos);
+    }
+
+    std::printf("%d cores, replay x%.1f, preview radius %d, HQ radius %d, budget %llu MB\n\n", cores, speed,
+                preview_radius, hq_radius, static_cast<unsigned long long>(budget >> 20));
+    for (const Trace& trace : traces) {
+        std::printf("%s (%zu events)\n", trace.name.c_str(), trace.events.size());
+        std::printf("  %-10s %9s %10s %10s %9s %9s\n", "", "prev hit", "HQ hit", "HQ ready", "HQ waste", "peak MB");
+        for (bool predict : { false, true }) {
+            Library library(photos, cores, speed);
+            Player player(library, photos, cores, budget, predict, preview_radius, hq_radius);
+            Print(predict ? "predicted" : "symmetric", player.Replay(trace.events));
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,370 @@
+// Benchmark for the portable core of FlyNativeLibHeif/PrefetchScheduler.
+//
+// Replays a navigation session against synthetic loads, the way PrefetchCache drives the
+// scheduler: steady stepping forward, a held key (burst), a pause, then stepping back. Loads
+// sleep for a synthetic decode cost while holding one of a fixed number of simulated cores,
+// so every tier competes for the same CPU as in the app. Reports how often the photo on
+// screen already had its preview on arrival, how often its HQ bitmap was ready before the
+// next step, HQ loads started during the burst, time to the HQ bitmap after the burst, and
+// the peak memory held against the budget. A final run of quick clicks back over the photos
+// just viewed reports how often the HQ bitmap was still resident on arrival. With "mixed",
+// every fifth photo is a 400 MB panorama.
+//
+// The same session runs against a model of the former C# scheduler: one LIFO stack per tier
+// refilled centre-outwards on every move, each tier with its own count throttle, no memory
+// limit and no notion of direction.
+//
+// Build and run: see README.md in this folder.
+
+#include "PrefetchScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    /// A fixed number of cores every synthetic load must hold while it "decodes".
+    class SimulatedCpu {
+    public:
+        explicit SimulatedCpu(int cores) : free_(cores) {}
+
+        void Run(std::chrono::microseconds cost) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return free_ > 0; });
+                --free_;
+            }
+            std::this_thread::sleep_for(cost);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++free_;
+            }
+            cv_.notify_one();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        int free_;
+    };
+
+    struct Costs {
+        int preview_us = 6000;
+        int hq_us = 45000;
+        int disk_us = 2000;
+        uint64_t preview_bytes = 2ull << 20;
+        uint64_t hq_bytes = 64ull << 20;
+        uint64_t panorama_bytes = 400ull << 20;
+        bool mixed = false;
+    };
+
+    /// Photo state shared by both schedulers' hooks.
+    struct Library {
+        Library(int photos, int cores) : cpu(cores), preview(photos), hq(photos) {}
+
+        SimulatedCpu cpu;
+        Costs costs;
+        std::vector<std::atomic<bool>> preview;
+        std::vector<std::atomic<bool>> hq;
+        std::atomic<uint64_t> resident{ 0 };
+        std::atomic<uint64_t> peak{ 0 };
+        std::atomic<int> burst{ 0 };
+        std::atomic<int> hq_in_burst{ 0 };
+        std::atomic<uint64_t> hq_peak{ 0 };
+        std::atomic<uint64_t> hq_resident{ 0 };
+
+        /// Costs vary by key so loads finish out of order.
+        std::chrono::microseconds Cost(int key, int base) const {
+            return std::chrono::microseconds(base / 2 + (key * 7919 % 100) * base / 100);
+        }
+
+        uint64_t HqBytes(int key) const {
+            return costs.mixed && key % 5 == 0 ? costs.panorama_bytes : costs.hq_bytes;
+        }
+
+        static void Raise(std::atomic<uint64_t>& high, uint64_t now) {
+            uint64_t prev = high.load();
+            while (now > prev && !high.compare_exchange_weak(prev, now)) {}
+        }
+
+        void Hold(uint64_t bytes) { Raise(peak, resident += bytes); }
+
+        uint64_t Load(int key, PrefetchTier tier) {
+            switch (tier) {
+            case PrefetchTier::Preview:
+                cpu.Run(Cost(key, costs.preview_us));
+                preview[key] = true;
+                Hold(costs.preview_bytes);
+                return costs.preview_bytes;
+            case PrefetchTier::Hq:
+                if (burst) ++hq_in_burst;
+                cpu.Run(Cost(key, costs.hq_us));
+                hq[key] = true;
+                Hold(HqBytes(key));
+                Raise(hq_peak, hq_resident += HqBytes(key));
+                return HqBytes(key);
+            default:
+                cpu.Run(Cost(key, costs.disk_us));
+                return 0;
+            }
+        }
+
+        void Release(int key, PrefetchTier tier) {
+            if (tier == PrefetchTier::Hq) {
+                if (hq[key].exchange(false)) {
+                    resident -= HqBytes(key);
+                    hq_resident -= HqBytes(key);
+                }
+            } else if (preview[key].exchange(false)) {
+                resident -= costs.preview_bytes;
+            }
+        }
+    };
+
+    /// PrefetchScheduler behind the interface the replay uses.
+    class NativeModel {
+    public:
+        NativeModel(Library& library, int threads, uint64_t budget) : library_(library) {
+            const PrefetchHooks hooks{ &LoadHook, &ReleaseHook, nullptr, this };
+            PrefetchOptions options{};
+            options.threads = threads;
+            options.memory_budget = budget;
+            options.preview_estimate = library.costs.preview_bytes;
+            options.hq_estimate = library.costs.hq_bytes;
+            scheduler_ = std::make_unique<PrefetchScheduler>(hooks, options);
+            scheduler_->Start();
+        }
+
+        void Move(int centre, int photos, int preview_radius, int hq_radius, bool burst) {
+            const int first = std::max(0, centre - preview_radius);
+            const int last = std::min(photos - 1, centre + preview_radius);
+            keys_.clear();
+            for (int i = first; i <= last; ++i) keys_.push_back(i);
+            PrefetchWindow window{};
+            window.centre = centre;
+            window.first = first;
+            window.preview_radius = preview_radius;
+            window.hq_radius = hq_radius;
+            window.burst = burst ? 1 : 0;
+            scheduler_->MoveWindow(window, keys_.data(), static_cast<int32_t>(keys_.size()));
+        }
+
+        void EndBurst() { scheduler_->EndBurst(); }
+
+    private:
+        static int64_t LoadHook(void* context, int32_t key, int32_t tier) {
+            auto* self = static_cast<NativeModel*>(context);
+            const auto t = static_cast<PrefetchTier>(tier);
+            const uint64_t bytes = self->library_.Load(key, t);
+            if (t == PrefetchTier::Preview) {
+                // The app learns the full size from the preview's metadata.
+                self->scheduler_->SetHqSizeHint(key, self->library_.HqBytes(key));
+                self->scheduler_->QueueDiskWrite(key);
+            }
+            return static_cast<int64_t>(bytes);
+        }
+
+        static void ReleaseHook(void* context, int32_t key, int32_t tier) {
+            static_cast<NativeModel*>(context)->library_.Release(key, static_cast<PrefetchTier>(tier));
+        }
+
+        Library& library_;
+        std::vector<int32_t> keys_;
+        std::unique_ptr<PrefetchScheduler> scheduler_;
+    };
+
+    /// The former PrefetchCache: a stack, dispatcher and count throttle per tier.
+    class LegacyModel {
+    public:
+        LegacyModel(Library& library, int threads) : library_(library) {
+            for (int tier = 0; tier < 3; ++tier) {
+                for (int i = 0; i < threads; ++i) workers_.emplace_back(&LegacyModel::Worker, this, tier);
+            }
+        }
+
+        ~LegacyModel() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cv_.notify_all();
+            for (std::thread& t : workers_) t.join();
+        }
+
+        void Move(int centre, int photos, int preview_radius, int hq_radius, bool burst) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            burst_ = burst;
+            Sync(centre, photos, preview_radius, PrefetchTier::Preview);
+            Sync(centre, photos, hq_radius, PrefetchTier::Hq);
+            cv_.notify_all();
+        }
+
+        void EndBurst() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            burst_ = false;
+            cv_.notify_all();
+        }
+
+    private:
+        struct Tier {
+            std::vector<int> stack;
+            std::vector<char> state;    // 0 none, 1 in flight, 2 done
+        };
+
+        void Sync(int centre, int photos, int radius, PrefetchTier tier) {
+            Tier& t = tiers_[static_cast<int>(tier)];
+            t.state.resize(photos);
+            for (int key = 0; key < photos; ++key) {
+                if (t.state[key] == 2 && std::abs(key - centre) > radius) {
+                    library_.Release(key, tier);
+                    t.state[key] = 0;
+                }
+            }
+            // FindNeighborKeys order pushed onto a stack: far pairs first, the centre last.
+            t.stack.clear();
+            for (int i = radius; i >= 1; --i) {
+                for (int key : { centre + i, centre - i }) {
+                    if (key >= 0 && key < photos && t.state[key] == 0) t.stack.push_back(key);
+                }
+            }
+            if (t.state[centre] == 0) t.stack.push_back(centre);
+        }
+
+        void Worker(int tier) {
+            Tier& t = tiers_[tier];
+            Tier& previews = tiers_[static_cast<int>(PrefetchTier::Preview)];
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (;;) {
+                cv_.wait(lock, [&] {
+                    if (stop_) return true;
+                    if (tier == static_cast<int>(PrefetchTier::Hq) && burst_) return false;
+                    if (tier == static_cast<int>(PrefetchTier::DiskWrite)) return !disk_.empty() && previews.stack.empty();
+                    return !t.stack.empty();
+                });
+                if (stop_) return;
+                if (tier == static_cast<int>(PrefetchTier::DiskWrite)) {
+                    const int key = disk_.back();
+                    disk_.pop_back();
+                    lock.unlock();
+                    library_.Load(key, PrefetchTier::DiskWrite);
+                    lock.lock();
+                    continue;
+                }
+                const int key = t.stack.back();
+                t.stack.pop_back();
+                t.state[key] = 1;
+                lock.unlock();
+                library_.Load(key, static_cast<PrefetchTier>(tier));
+                lock.lock();
+                t.state[key] = 2;
+                if (tier == static_cast<int>(PrefetchTier::Preview)) disk_.push_back(key);
+                cv_.notify_all();
+            }
+        }
+
+        Library& library_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        Tier tiers_[2];
+        std::vector<int> disk_;
+        bool burst_ = false;
+        bool stop_ = false;
+        std::vector<std::thread> workers_;
+    };
+
+    struct Result {
+        int steps = 0, preview_hits = 0, settled_steps = 0, hq_ready = 0;
+        int hq_in_burst = 0, back_steps = 0, hq_on_return = 0;
+        double hq_after_burst_ms = 0;
+        uint64_t peak = 0, hq_peak = 0;
+    };
+
+    template <typename Model>
+    Result Replay(Model& model, Library& library, int photos, int preview_radius, int hq_radius) {
+        Result r;
+        int centre = photos / 4;
+        auto step = [&](int to, bool burst, int dwell_ms) {
+            centre = to;
+            ++r.steps;
+            if (library.preview[centre]) ++r.preview_hits;
+            library.burst = burst ? 1 : 0;
+            model.Move(centre, photos, preview_radius, hq_radius, burst);
+            std::this_thread::sleep_for(std::chrono::milliseconds(dwell_ms));
+            if (!burst) {
+                ++r.settled_steps;
+                if (library.hq[centre]) ++r.hq_ready;
+            }
+        };
+
+        step(centre, false, 300);
+        for (int i = 0; i < 60; ++i) step(centre + 1, false, 40);
+        for (int i = 0; i < 80; ++i) step(centre + 1, true, 8);
+        r.hq_in_burst = library.hq_in_burst;
+
+        library.burst = 0;
+        const auto released = Clock::now();
+        model.EndBurst();
+        while (!library.hq[centre]) std::this_thread::sleep_for(std::chrono::microseconds(200));
+        r.hq_after_burst_ms = std::chrono::duration<double, std::milli>(Clock::now() - released).count();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        for (int i = 0; i < 30; ++i) step(centre - 1, false, 40);
+
+        // Quick clicks back over the photos just viewed: only retained HQ bitmaps are ready.
+        for (int i = 0; i < 20; ++i) {
+            ++r.back_steps;
+            if (library.hq[centre + 1]) ++r.hq_on_return;
+            step(centre + 1, false, 8);
+        }
+        r.peak = library.peak;
+        r.hq_peak = library.hq_peak;
+        return r;
+    }
+
+    void Print(const char* name, const Result& r, uint64_t budget) {
+        std::printf("%-8s %8.1f%% %9.1f%% %8.1f%% %9d %11.1f %10.0f %10.0f %s\n", name,
+                    100.0 * r.preview_hits / r.steps, 100.0 * r.hq_ready / r.settled_steps,
+                    100.0 * r.hq_on_return / r.back_steps, r.hq_in_burst, r.hq_after_burst_ms,
+                    r.peak / 1048576.0, r.hq_peak / 1048576.0, budget && r.peak > budget ? "(over budget)" : "");
+    }
+}
+
+int main(int argc, char** argv) {
+    const int cores = argc > 1 ? atoi(argv[1]) : 8;
+    const int preview_radius = argc > 2 ? atoi(argv[2]) : 200;
+    const uint64_t budget_mb = argc > 3 ? strtoull(argv[3], nullptr, 10) : 1024;
+    const bool mixed = argc > 4 && std::string(argv[4]) == "mixed";
+    const int hq_radius = 2;
+    const int photos = 2000;
+    const uint64_t budget = budget_mb << 20;
+
+    std::printf("%d cores, preview radius %d, HQ radius %d, budget %llu MB%s\n\n", cores, preview_radius, hq_radius,
+                static_cast<unsigned long long>(budget_mb), mixed ? ", mixed sizes" : "");
+    std::printf("%-8s %9s %10s %9s %9s %11s %10s %10s\n", "", "prev hit", "HQ ready", "HQ back", "HQ burst",
+                "HQ after ms", "peak MB", "HQ peak");
+
+    {
+        Library library(photos, cores);
+        library.costs.mixed = mixed;
+        LegacyModel model(library, cores);
+        Print("legacy", Replay(model, library, photos, preview_radius, hq_radius), 0);
+    }
+    {
+        Library library(photos, cores);
+        library.costs.mixed = mixed;
+        NativeModel model(library, cores, budget);
+        Print("native", Replay(model, library, photos, preview_radius, hq_radius), budget);
+    }
+    return 0;
+}
@@ -0,0 +1,309 @@
+// Benchmark for the portable core of FlyNativeLibHeif/PsdDecoder.
+//
+// Writes PSDs and PSBs in memory: an 8-bit RGB document with transparency and a large layer
+// section, a 16-bit grayscale one stored raw, an 8-bit CMYK one, and a PSB of a poster with
+// flat areas. Reported per file:
+// - Open() time (header, resources and layer-section length walk) against searching the file
+//   byte by byte for the thumbnail resource, as PsdReader did; files without a thumbnail are
+//   searched to the end,
+// - composite decode time with the scalar and the SSE2 kernels, in megapixels per second.
+// Every composite must match a reference built from the channel planes the file was written
+// from, and the scalar and SSE2 outputs must be identical.
+//
+// Build and run: see README.md in this folder.
+
+#include "CpuFeatures.h"
+#include "PsdDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double MsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    uint32_t Rand(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // --- Writer ---------------------------------------------------------------------------
+
+    struct Document {
+        std::string name;
+        int version;                    // 1 PSD, 2 PSB.
+        int width, height, depth, mode; // mode: 1 grayscale, 3 RGB, 4 CMYK.
+        int channels;
+        bool rle, merged_alpha, thumbnail;
+        size_t layer_bytes;             // Filler standing in for the layer records.
+        std::vector<std::vector<uint16_t>> planes;  // Samples per channel, 0-255 or 0-65535.
+    };
+
+    void Put16(std::vector<uint8_t>& out, uint32_t v) {
+        out.push_back(static_cast<uint8_t>(v >> 8));
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    void Put32(std::vector<uint8_t>& out, uint32_t v) {
+        Put16(out, v >> 16);
+        Put16(out, v & 0xFFFF);
+    }
+
+    void PutLength(std::vector<uint8_t>& out, uint64_t v, bool wide) {
+        if (wide) Put32(out, static_cast<uint32_t>(v >> 32));
+        Put32(out, static_cast<uint32_t>(v));
+    }
+
+    void PutResource(std::vector<uint8_t>& out, uint16_t id, const std::vector<uint8_t>& data) {
+        out.insert(out.end(), {'8', 'B', 'I', 'M'});
+        Put16(out, id);
+        Put16(out, 0);                  // Empty name, padded to even.
+        Put32(out, static_cast<uint32_t>(data.size()));
+        out.insert(out.end(), data.begin(), data.end());
+        if (data.size() & 1) out.push_back(0);
+    }
+
+    /// PackBits as Photoshop writes it: runs of 3 or more, literals of up to 128 bytes otherwise.
+    void PackBits(const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+        size_t i = 0;
+        while (i < size) {
+            size_t run = 1;
+            while (i + run < size && run < 128 && src[i + run] == src[i]) ++run;
+            if (run >= 3) {
+                out.push_back(static_cast<uint8_t>(1 - static_cast<int>(run)));
+                out.push_back(src[i]);
+                i += run;
+                continue;
+            }
+            size_t literal = 0;
+            while (i + literal < size && literal < 128) {
+                if (i + literal + 2 < size && src[i + literal] == src[i + literal + 1] && src[i + literal] == src[i + literal + 2]) break;
+                ++literal;
+            }
+            out.push_back(static_cast<uint8_t>(literal - 1));
+            out.insert(out.end(), src + i, src + i + literal);
+            i += literal;
+        }
+    }
+
+    std::vector<uint8_t> WritePsd(const Document& doc) {
+        const bool psb = doc.version == 2;
+        std::vector<uint8_t> out = {'8', 'B', 'P', 'S'};
+        Put16(out, doc.version);
+        out.insert(out.end(), 6, 0);
+        Put16(out, doc.channels);
+        Put32(out, doc.height);
+        Put32(out, doc.width);
+        Put16(out, doc.depth);
+        Put16(out, doc.mode);
+        Put32(out, 0);                  // Colour mode data.
+
+        std::vector<uint8_t> resources;
+        PutResource(resources, 1005, std::vector<uint8_t>(16, 0));
+        PutResource(resources, 1057, {0, 0, 0, 1, 1, 0, 0, 0, 0});
+        if (doc.thumbnail) {
+            std::vector<uint8_t> thumbnail;
+            Put32(thumbnail, 1);
+            Put32(thumbnail, 160);
+            Put32(thumbnail, 120);
+            thumbnail.insert(thumbnail.end(), 16, 0);
+            thumbnail.insert(thumbnail.end(), {0xFF, 0xD8, 0xFF, 0xD9});
+            PutResource(resources, 1036, thumbnail);
+        }
+        Put32(out, static_cast<uint32_t>(resources.size()));
+        out.insert(out.end(), resources.begin(), resources.end());
+
+        // Layer info holding just the count and filler, then an empty global mask.
+        const uint64_t layer_info = 2 + doc.layer_bytes;
+        PutLength(out, (psb ? 8 : 4) + layer_info + 4, psb);
+        PutLength(out, layer_info, psb);
+        Put16(out, static_cast<uint16_t>(doc.merged_alpha ? -3 : 3));
+        out.insert(out.end(), doc.layer_bytes, 0);
+        Put32(out, 0);
+
+        Put16(out, doc.rle ? 1 : 0);
+        const size_t row_bytes = static_cast<size_t>(doc.width) * (doc.depth / 8);
+        std::vector<uint8_t> row(row_bytes);
+        std::vector<std::vector<uint8_t>> packed;
+        for (int c = 0; c < doc.channels; ++c) {
+            for (int y = 0; y < doc.height; ++y) {
+                for (int x = 0; x < doc.width; ++x) {
+                    const uint16_t v = doc.planes[c][static_cast<size_t>(y) * doc.width + x];
+                    if (doc.depth == 8) {
+                        row[x] = static_cast<uint8_t>(v);
+                    } else {
+                        row[x * 2] = static_cast<uint8_t>(v >> 8);
+                        row[x * 2 + 1] = static_cast<uint8_t>(v);
+                    }
+                }
+                if (doc.rle) {
+                    packed.emplace_back();
+                    PackBits(row.data(), row_bytes, packed.back());
+                } else {
+                    out.insert(out.end(), row.begin(), row.end());
+                }
+            }
+        }
+        if (doc.rle) {
+            for (const auto& p : packed) psb ? Put32(out, static_cast<uint32_t>(p.size())) : Put16(out, static_cast<uint32_t>(p.size()));
+            for (const auto& p : packed) out.insert(out.end(), p.begin(), p.end());
+        }
+        return out;
+    }
+
+    // --- Documents ------------------------------------------------------------------------
+
+    /// Smooth gradients with grain, flat bands and a soft-edged transparent border.
+    Document MakeDocument(std::string name, int version, int width, int height, int depth, int mode, bool rle, bool alpha,
+                          size_t layer_bytes, bool flat) {
+        const int base = mode == 3 ? 3 : mode == 4 ? 4 : 1;
+        Document doc{std::move(name), version, width, height, depth, mode, base + (alpha ? 1 : 0) + 1, rle, alpha, true,
+                     layer_bytes, {}};
+        const uint32_t max = depth == 8 ? 255 : 65535;
+        uint32_t seed = 12345;
+        doc.planes.resize(doc.channels);
+        for (int c = 0; c < doc.channels; ++c) {
+            doc.planes[c].resize(static_cast<size_t>(width) * height);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    uint32_t v;
+                    if (c == base && alpha) {
+                        const int edge = std::min(std::min(x, width - 1 - x), std::min(y, height - 1 - y));
+                        v = edge >= 32 ? max : edge * max / 32;
+                    } else if (flat && (y / 64) % 2 == 0) {
+                        v = ((x / 200) * 60 + c * 40) % 256 * max / 255;
+                    } else {
+                        v = ((x + y * (c + 1)) % 256 * max / 255 + (Rand(seed) % 8) * (max / 255)) % (max + 1);
+                    }
+                    doc.planes[c][static_cast<size_t>(y) * width + x] = static_cast<uint16_t>(v);
+                }
+            }
+        }
+        return doc;
+    }
+
+    uint8_t Scale(uint32_t c, uint32_t a) { return static_cast<uint8_t>((c * a + 127) / 255); }
+
+    /// The composite straight from the planes, premultiplied BGRA.
+    std::vector<uint8_t> Reference(const Document& doc) {
+        const int base = doc.mode == 3 ? 3 : doc.mode == 4 ? 4 : 1;
+        std::vector<uint8_t> out(static_cast<size_t>(doc.width) * doc.height * 4);
+        auto sample = [&](int c, size_t i) -> uint32_t {
+            const uint32_t v = doc.planes[c][i];
+            return doc.depth == 8 ? v : (v * 255 + 32767) / 65535;
+        };
+        for (size_t i = 0; i < static_cast<size_t>(doc.width) * doc.height; ++i) {
+            uint32_t r, g, b;
+            if (doc.mode == 4) {
+                const uint32_t k = sample(3, i);
+                r = Scale(sample(0, i), k);
+                g = Scale(sample(1, i), k);
+                b = Scale(sample(2, i), k);
+            } else if (base == 1) {
+                r = g = b = sample(0, i);
+            } else {
+                r = sample(0, i);
+                g = sample(1, i);
+                b = sample(2, i);
+            }
+            const uint32_t a = doc.merged_alpha ? sample(base, i) : 255;
+            out[i * 4] = Scale(b, a);
+            out[i * 4 + 1] = Scale(g, a);
+            out[i * 4 + 2] = Scale(r, a);
+            out[i * 4 + 3] = static_cast<uint8_t>(a);
+        }
+        return out;
+    }
+
+    volatile long long found_sink = 0;
+
+    /// PsdReader's old search: the file in 4 KB reads, each compared byte by byte with the marker.
+    long long FindMarker(const std::vector<uint8_t>& file, const uint8_t* marker, size_t length) {
+        const size_t buffer = 4096;
+        for (size_t pos = 0; pos < file.size(); pos += buffer - (length - 1)) {
+            const size_t end = std::min(file.size(), pos + buffer);
+            for (size_t i = pos; i + length <= end; ++i) {
+                if (std::memcmp(file.data() + i, marker, length) == 0) return static_cast<long long>(i);
+            }
+            if (end == file.size()) break;
+        }
+        return -1;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int scale = argc > 1 ? std::max(1, atoi(argv[1])) : 1;
+    const int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 3;
+
+    std::vector<Document> docs;
+    docs.push_back(MakeDocument("rgba8", 1, 2000 * scale, 1500, 8, 3, true, true, 200u << 20, false));
+    docs.push_back(MakeDocument("gray16", 1, 1500 * scale, 1000, 16, 1, false, false, 0, false));
+    docs.push_back(MakeDocument("cmyk8", 1, 1600 * scale, 1200, 8, 4, true, false, 0, false));
+    docs.push_back(MakeDocument("poster", 2, 3000 * scale, 2000, 8, 3, true, false, 0, true));
+    docs.back().thumbnail = false;
+
+    printf("kernels: %s\n", CpuFeatures::Name(CpuFeatures::Level()));
+    printf("%-7s %10s %8s | %8s %10s | %11s %10s %9s\n", "file", "size", "file MB", "open us", "search ms", "scalar MP/s",
+           "sse2 MP/s", "speed-up");
+
+    for (const Document& doc : docs) {
+        const std::vector<uint8_t> file = WritePsd(doc);
+        const std::vector<uint8_t> expected = Reference(doc);
+
+        PsdDecoder decoder;
+        double open_ms = 1e30, search_ms = 1e30;
+        for (int run = 0; run < runs; ++run) {
+            auto start = Clock::now();
+            const bool opened = decoder.Open(file.data(), file.size());
+            open_ms = std::min(open_ms, MsSince(start));
+            if (!opened || !decoder.Info().can_decode || (decoder.Info().thumbnail_size != 0) != doc.thumbnail) {
+                printf("%s: failed to open\n", doc.name.c_str());
+                return 1;
+            }
+
+            const uint8_t v5[] = {'8', 'B', 'I', 'M', 0x04, 0x0C};
+            const uint8_t v4[] = {'8', 'B', 'I', 'M', 0x04, 0x09};
+            start = Clock::now();
+            long long found = FindMarker(file, v5, sizeof(v5));
+            if (found < 0) found = FindMarker(file, v4, sizeof(v4));
+            search_ms = std::min(search_ms, MsSince(start));
+            found_sink = found_sink + found;
+        }
+
+        const size_t stride = static_cast<size_t>(doc.width) * 4;
+        std::vector<uint8_t> out[2];
+        double decode_ms[2] = {1e30, 1e30};
+        for (int simd = 0; simd < 2; ++simd) {
+            decoder.SetSimd(simd == 1);
+            out[simd].assign(stride * doc.height, 0);
+            for (int run = 0; run < runs; ++run) {
+                const auto start = Clock::now();
+                decoder.Decode(out[simd].data(), stride);
+                decode_ms[simd] = std::min(decode_ms[simd], MsSince(start));
+            }
+        }
+        if (out[0] != expected || out[1] != expected) {
+            printf("%s: composite differs from the reference (scalar %s, sse2 %s)\n", doc.name.c_str(),
+                   out[0] == expected ? "ok" : "differs", out[1] == expected ? "ok" : "differs");
+            return 1;
+        }
+
+        const double megapixels = static_cast<double>(doc.width) * doc.height / 1e6;
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", doc.width, doc.height);
+        printf("%-7s %10s %8.1f | %8.1f %10.1f | %11.0f %10.0f %8.2fx\n", doc.name.c_str(), size, file.size() / 1048576.0, open_ms * 1000,
+               search_ms, megapixels / decode_ms[0] * 1000, megapixels / decode_ms[1] * 1000, decode_ms[0] / decode_ms[1]);
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+// Benchmark for the portable core of FlyNativeLibHeif/ThumbnailAtlas.
+//
+// Simulates the thumbnail strip sliding one photo at a time through a large folder, the way
+// ThumbNailController drives the atlas: every rebuild looks up the slot of each photo in the
+// rendered range, inserts the ones that are missing, then uploads the dirty rectangles.
+// Reports, per rebuild, the bytes uploaded against re-uploading the whole strip, and the CPU
+// time of the atlas work. Thumbnails are 128 px BGRA buffers, as Photo generates them.
+//
+// Build and run: see README.md in this folder.
+
+#include "ThumbnailAtlas.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int kThumbSize = 128;
+}
+
+int main(int argc, char** argv) {
+    const int photos = argc > 1 ? atoi(argv[1]) : 10000;
+    const int half_range = argc > 2 ? atoi(argv[2]) : 13;      // visible boxes per side + slide margin
+    const int slot_size = argc > 3 ? atoi(argv[3]) : 96;
+    const int range = 2 * half_range + 1;
+    const int columns = 16, rows = (2 * range + columns - 1) / columns;
+
+    std::vector<std::vector<uint8_t>> thumbs(64);
+    for (size_t i = 0; i < thumbs.size(); ++i) {
+        thumbs[i].resize(static_cast<size_t>(kThumbSize) * kThumbSize * 4);
+        for (size_t j = 0; j < thumbs[i].size(); ++j) thumbs[i][j] = static_cast<uint8_t>(i * 31 + j);
+    }
+
+    ThumbnailAtlas atlas(slot_size, columns, rows);
+    atlas.TakeDirty();   // The initial full texture upload.
+    std::vector<uint8_t> upload;
+    uint64_t uploaded = 0, rects = 0, inserts = 0;
+    double atlas_ms = 0;
+
+    for (int current = 0; current < photos; ++current) {
+        const auto start = Clock::now();
+        for (int i = -half_range; i <= half_range; ++i) {
+            const int position = current + i;
+            if (position < 0 || position >= photos) continue;
+            if (atlas.Find(position) < 0) {
+                const auto& t = thumbs[position % thumbs.size()];
+                atlas.Insert(position, t.data(), kThumbSize, kThumbSize, kThumbSize * 4);
+                ++inserts;
+            }
+        }
+        for (const AtlasRect& r : atlas.TakeDirty()) {
+            upload.resize(static_cast<size_t>(r.width) * r.height * 4);
+            atlas.CopyRect(r, upload.data(), upload.size());
+            uploaded += upload.size();
+            ++rects;
+        }
+        atlas_ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    const double full = static_cast<double>(range) * slot_size * slot_size * 4;
+    printf("%d photos, %d slots rendered, %d px slots, atlas %dx%d\n", photos, range, slot_size, atlas.Width(), atlas.Height());
+    printf("inserts       %llu (%.2f per step)\n", static_cast<unsigned long long>(inserts), static_cast<double>(inserts) / photos);
+    printf("upload/step   %.1f KB in %.2f rects (whole strip: %.1f KB)\n", uploaded / 1024.0 / photos,
+           static_cast<double>(rects) / photos, full / 1024.0);
+    printf("atlas ms/step %.4f\n", atlas_ms / photos);
+    return 0;
+}
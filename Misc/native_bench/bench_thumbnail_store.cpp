@@ -0,0 +1,258 @@
+// Benchmark for the portable core of FlyNativeLibHeif/ThumbnailStore.
+//
+// Fills a store with synthetic thumbnails, then compares against the SQLite cache it
+// replaced (same schema, pragmas and statements as DiskCacherWithSqlite):
+//   put       - insert every entry (store: Put + one Flush; SQLite: one upsert per entry,
+//               autocommit, as the managed cache issued them).
+//   get       - random lookups. Store: Get, touch the blob, Release. SQLite: SELECT, copy the
+//               blob out (the managed cache copied it into a pooled buffer), UPDATE lastAccessed.
+//   get xN    - the same from N threads. The SQLite side is serialised by one mutex, like
+//               the SemaphoreSlim in front of the managed connection.
+//   reopen    - close and open again, then one lookup.
+//
+// Build and run: see README.md in this folder.
+
+#include "ThumbnailStore.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double Ms(Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    std::string PathOf(int i) {
+        return "C:\\Users\\someone\\Pictures\\Holiday 2024\\IMG_" + std::to_string(100000 + i) + ".JPG";
+    }
+
+    /// Blob sizes vary around the mean like real 800 px JPEG thumbnails do.
+    size_t BlobSize(int i, size_t mean) {
+        return mean / 2 + static_cast<size_t>((static_cast<uint64_t>(i) * 2654435761u) % mean);
+    }
+
+    void FillBlob(std::vector<uint8_t>& blob, int i, size_t size) {
+        blob.resize(size);
+        for (size_t k = 0; k < size; ++k) blob[k] = static_cast<uint8_t>(i * 131 + k);
+    }
+
+    std::vector<int> Shuffled(int count, unsigned seed) {
+        std::vector<int> order(count);
+        for (int i = 0; i < count; ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+        return order;
+    }
+
+    void Exec(sqlite3* db, const char* sql) {
+        char* error = nullptr;
+        if (sqlite3_exec(db, sql, nullptr, nullptr, &error) != SQLITE_OK) {
+            fprintf(stderr, "sqlite: %s\n", error ? error : "?");
+            sqlite3_free(error);
+            exit(1);
+        }
+    }
+
+    /// The schema, pragmas and statements of the former managed SQLite cache.
+    struct SqliteCache {
+        sqlite3* db = nullptr;
+        sqlite3_stmt* select = nullptr;
+        sqlite3_stmt* touch = nullptr;
+        sqlite3_stmt* upsert = nullptr;
+        std::mutex gate;
+
+        explicit SqliteCache(const fs::path& file) {
+            if (sqlite3_open(file.string().c_str(), &db) != SQLITE_OK) exit(1);
+            Exec(db, "PRAGMA journal_mode=WAL; PRAGMA synchronous=OFF; PRAGMA temp_store=MEMORY;"
+                     "PRAGMA mmap_size=268435456;"
+                     "CREATE TABLE IF NOT EXISTS images (id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                     " filePath TEXT NOT NULL UNIQUE, imageData BLOB NOT NULL, lastAccessed INTEGER NOT NULL,"
+                     " lastModified TEXT NOT NULL, actualWidth INTEGER NOT NULL, actualHeight INTEGER NOT NULL);"
+                     "CREATE INDEX IF NOT EXISTS idx_lastAccessed ON images(lastAccessed);");
+            sqlite3_prepare_v2(db, "SELECT imageData, lastModified, actualWidth, actualHeight FROM images WHERE filePath = ?1", -1, &select, nullptr);
+            sqlite3_prepare_v2(db, "UPDATE images SET lastAccessed = ?1 WHERE filePath = ?2", -1, &touch, nullptr);
+            sqlite3_prepare_v2(db, "INSERT INTO images (filePath, imageData, lastAccessed, lastModified, actualWidth, actualHeight)"
+                                   " VALUES (?1, ?2, ?3, ?4, ?5, ?6) ON CONFLICT(filePath) DO UPDATE SET"
+                                   " imageData = excluded.imageData, lastAccessed = excluded.lastAccessed,"
+                                   " lastModified = excluded.lastModified, actualWidth = excluded.actualWidth,"
+                                   " actualHeight = excluded.actualHeight;", -1, &upsert, nullptr);
+        }
+
+        ~SqliteCache() {
+            sqlite3_finalize(select);
+            sqlite3_finalize(touch);
+            sqlite3_finalize(upsert);
+            sqlite3_close(db);
+        }
+
+        void Put(const std::string& path, const std::vector<uint8_t>& blob, const char* mtime) {
+            std::lock_guard<std::mutex> lock(gate);
+            sqlite3_bind_text(upsert, 1, path.c_str(), static_cast<int>(path.size()), SQLITE_STATIC);
+            sqlite3_bind_blob(upsert, 2, blob.data(), static_cast<int>(blob.size()), SQLITE_STATIC);
+            sqlite3_bind_int64(upsert, 3, time(nullptr));
+            sqlite3_bind_text(upsert, 4, mtime, -1, SQLITE_STATIC);
+            sqlite3_bind_int(upsert, 5, 4000);
+            sqlite3_bind_int(upsert, 6, 3000);
+            sqlite3_step(upsert);
+            sqlite3_reset(upsert);
+        }
+
+        bool Get(const std::string& path, const char* mtime, std::vector<uint8_t>& out) {
+            std::lock_guard<std::mutex> lock(gate);
+            bool hit = false;
+            sqlite3_bind_text(select, 1, path.c_str(), static_cast<int>(path.size()), SQLITE_STATIC);
+            if (sqlite3_step(select) == SQLITE_ROW &&
+                strcmp(reinterpret_cast<const char*>(sqlite3_column_text(select, 1)), mtime) == 0) {
+                const int size = sqlite3_column_bytes(select, 0);
+                const auto* data = static_cast<const uint8_t*>(sqlite3_column_blob(select, 0));
+                out.assign(data, data + size);
+                hit = true;
+            }
+            sqlite3_reset(select);
+            if (hit) {
+                sqlite3_bind_int64(touch, 1, time(nullptr));
+                sqlite3_bind_text(touch, 2, path.c_str(), static_cast<int>(path.size()), SQLITE_STATIC);
+                sqlite3_step(touch);
+                sqlite3_reset(touch);
+            }
+            return hit;
+        }
+    };
+
+    void Report(const char* what, int ops, double store_ms, double sqlite_ms) {
+        printf("%-10s %10.1f ms %9.2f us/op %12.1f ms %9.2f us/op %8.1fx\n", what, store_ms, store_ms * 1000.0 / ops,
+               sqlite_ms, sqlite_ms * 1000.0 / ops, sqlite_ms / store_ms);
+    }
+}
+
+int main(int argc, char** argv) {
+    const int count = argc > 1 ? atoi(argv[1]) : 100000;
+    const size_t mean_blob = argc > 2 ? static_cast<size_t>(atoi(argv[2])) * 1024 : 16 * 1024;
+    const int threads = argc > 3 ? atoi(argv[3]) : static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+    const fs::path root = fs::temp_directory_path() / "fly_bench_thumbnail_store";
+    fs::remove_all(root);
+    fs::create_directories(root);
+
+    printf("%d entries, mean blob %zu KB, %d reader threads\n\n", count, mean_blob / 1024, threads);
+    printf("%-10s %13s %15s %15s %15s %9s\n", "", "store", "", "sqlite", "", "speedup");
+
+    const uint64_t kMaxBytes = 64ull << 30;   // Large enough that nothing is evicted.
+    const int64_t mtime = 133000000000000000;
+    const char* mtime_text = "20240101120000";
+    std::vector<uint8_t> blob;
+
+    ThumbnailStore store;
+    if (!store.Open(root / "store", kMaxBytes, static_cast<uint32_t>(count))) {
+        fprintf(stderr, "could not open the store\n");
+        return 1;
+    }
+    SqliteCache sqlite(root / "cache.db");
+
+    // put
+    auto t0 = Clock::now();
+    for (int i = 0; i < count; ++i) {
+        FillBlob(blob, i, BlobSize(i, mean_blob));
+        while (!store.Put(PathOf(i), mtime, blob.data(), blob.size(), 4000, 3000)) std::this_thread::yield();
+    }
+    store.Flush();
+    const double store_put = Ms(Clock::now() - t0);
+    t0 = Clock::now();
+    for (int i = 0; i < count; ++i) {
+        FillBlob(blob, i, BlobSize(i, mean_blob));
+        sqlite.Put(PathOf(i), blob, mtime_text);
+    }
+    const double sqlite_put = Ms(Clock::now() - t0);
+    Report("put", count, store_put, sqlite_put);
+
+    // get, one thread. Paths are built up front so only the lookups are timed.
+    const std::vector<int> order = Shuffled(count, 42);
+    std::vector<std::string> paths(count);
+    for (int i = 0; i < count; ++i) paths[i] = PathOf(order[i]);
+
+    uint64_t sink = 0;
+    int misses = 0;
+    t0 = Clock::now();
+    for (const std::string& path : paths) {
+        ThumbnailView view;
+        if (!store.Get(path, mtime, view)) { misses++; continue; }
+        sink += view.data[0] + view.data[view.size - 1];
+        store.Release(view);
+    }
+    const double store_get = Ms(Clock::now() - t0);
+    t0 = Clock::now();
+    for (const std::string& path : paths) {
+        if (!sqlite.Get(path, mtime_text, blob)) { misses++; continue; }
+        sink += blob[0] + blob.back();
+    }
+    const double sqlite_get = Ms(Clock::now() - t0);
+    Report("get", count, store_get, sqlite_get);
+
+    // get, N threads over disjoint slices.
+    auto run_threads = [&](auto&& body) {
+        std::vector<std::thread> pool;
+        const int slice = count / threads;
+        const auto start = Clock::now();
+        for (int t = 0; t < threads; ++t) pool.emplace_back(body, t * slice, t == threads - 1 ? count : (t + 1) * slice);
+        for (auto& th : pool) th.join();
+        return Ms(Clock::now() - start);
+    };
+    std::atomic<uint64_t> shared_sink{ 0 };
+    const double store_mt = run_threads([&](int begin, int end) {
+        uint64_t local = 0;
+        for (int i = begin; i < end; ++i) {
+            ThumbnailView view;
+            if (!store.Get(paths[i], mtime, view)) continue;
+            local += view.data[0];
+            store.Release(view);
+        }
+        shared_sink += local;
+    });
+    const double sqlite_mt = run_threads([&](int begin, int end) {
+        uint64_t local = 0;
+        std::vector<uint8_t> buffer;
+        for (int i = begin; i < end; ++i) {
+            if (sqlite.Get(paths[i], mtime_text, buffer)) local += buffer[0];
+        }
+        shared_sink += local;
+    });
+    char label[16];
+    snprintf(label, sizeof(label), "get x%d", threads);
+    Report(label, count, store_mt, sqlite_mt);
+
+    // reopen
+    ThumbnailStoreStats stats;
+    store.GetStats(stats);
+    store.Close();
+    t0 = Clock::now();
+    ThumbnailStore reopened;
+    reopened.Open(root / "store", kMaxBytes, static_cast<uint32_t>(count));
+    ThumbnailView view;
+    if (reopened.Get(paths[0], mtime, view)) reopened.Release(view); else misses++;
+    printf("\nreopen + first get: %.1f ms\n", Ms(Clock::now() - t0));
+
+    printf("store: %llu entries, %llu MB live, %u segments, %llu commits for %llu puts\n",
+           static_cast<unsigned long long>(stats.entries), static_cast<unsigned long long>(stats.live_bytes >> 20),
+           stats.segments, static_cast<unsigned long long>(stats.commits), static_cast<unsigned long long>(stats.puts));
+    printf("misses: %d (expected 0), checksum %llu\n", misses,
+           static_cast<unsigned long long>(sink + shared_sink.load()));
+
+    reopened.Close();
+    fs::remove_all(root);
+    return misses == 0 ? 0 : 1;
+}
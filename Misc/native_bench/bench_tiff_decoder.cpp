@@ -0,0 +1,697 @@
+// Benchmark for the portable core of FlyNativeLibHeif/TiffDecoder.
+//
+// Writes TIFFs in memory the way scanners and image editors do - strips and tiles, chunky and
+// planar, uncompressed, PackBits, LZW and Deflate, with and without the horizontal predictor,
+// in both byte orders - and checks that every one decodes to the pixels it was written from,
+// with the SSE2 kernels and without. Reported:
+// - the predictor kernels, scalar against SSE2, through decodes that are mostly predictor,
+// - decode time of a 12 MP photo in each compression, on one thread and on every core,
+// - a 300-page scanned document: indexing every page, then turning to any one page,
+// - a page with reduced-resolution SubIFDs: the preview level against the full page.
+//
+// Build and run: see README.md in this folder.
+
+#include "TiffDecoder.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double MsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    uint32_t Premultiply(uint32_t c, uint32_t a) {
+        const uint32_t v = c * a + 128;
+        return (v + (v >> 8)) >> 8;
+    }
+
+    enum Compression : uint16_t { kNone = 1, kLzw = 5, kDeflate = 8, kPackBits = 32773 };
+
+    /// One image to write: how it is stored, and where its pixels come from.
+    struct Spec {
+        const char* name;
+        uint32_t width;
+        uint32_t height;
+        uint16_t bits;
+        uint16_t samples;
+        uint16_t photometric;
+        uint16_t compression;
+        uint16_t predictor;
+        uint16_t planar;
+        uint16_t extra;                 // ExtraSamples: 0, 1 associated or 2 unassociated alpha.
+        uint32_t rows_per_strip;        // 0 for tiles.
+        uint32_t tile;
+        bool big_endian;
+        uint32_t seed;
+        bool document;                  // A scanned page: mostly paper, some text.
+    };
+
+    /// Sample `s` of pixel (x, y), in [0, 2^bits): smooth ramps with some noise, as a photo has.
+    uint32_t SampleAt(const Spec& spec, uint32_t x, uint32_t y, uint32_t s) {
+        const uint32_t max = (1u << spec.bits) - 1;
+        uint32_t h = (x * 73856093u) ^ (y * 19349663u) ^ (s * 83492791u) ^ spec.seed;
+        h ^= h >> 13;
+        h *= 0x5bd1e995u;
+        h ^= h >> 15;
+        if (spec.document) {
+            // Lines of "text": dark runs on some rows, paper everywhere else.
+            const bool ink = (y / 8) % 3 == 1 && (x / 5) % 7 < 5 && (h & 7) < 5;
+            return ink ? 0 : max;
+        }
+        const uint32_t ramp = (x * 2 + y + s * 64) & 0xFF;
+        const uint32_t v8 = std::min<uint32_t>(255, ramp + (h & 7));
+        if (spec.bits == 16) return v8 * 257 ^ (h >> 20 & 0xFF);
+        if (spec.bits < 8) return v8 >> (8 - spec.bits);
+        return v8;
+    }
+
+    /// What the decoder should produce for pixel (x, y): worked out straight from the spec.
+    uint32_t Expected(const Spec& spec, uint32_t x, uint32_t y) {
+        auto hi = [&](uint32_t s) { return spec.bits == 16 ? SampleAt(spec, x, y, s) >> 8 : SampleAt(spec, x, y, s); };
+        uint32_t r, g, b;
+        int32_t alpha = -1;
+        switch (spec.photometric) {
+            case 0:
+            case 1: {
+                uint32_t v = spec.bits < 8 ? SampleAt(spec, x, y, 0) * (255 / ((1u << spec.bits) - 1)) : hi(0);
+                if (spec.photometric == 0) v = 255 - v;
+                r = g = b = v;
+                if (spec.samples >= 2 && spec.extra) alpha = 1;
+                break;
+            }
+            case 3: {
+                const uint32_t v = SampleAt(spec, x, y, 0);
+                r = v * 255 / ((1u << spec.bits) - 1);
+                g = 255 - r;
+                b = (r * 7) & 0xFF;
+                break;
+            }
+            case 5: {
+                const uint32_t k = 255 - hi(3);
+                r = Premultiply(255 - hi(0), k);
+                g = Premultiply(255 - hi(1), k);
+                b = Premultiply(255 - hi(2), k);
+                if (spec.samples >= 5 && spec.extra) alpha = 4;
+                break;
+            }
+            default:
+                r = hi(0);
+                g = hi(1);
+                b = hi(2);
+                if (spec.samples >= 4 && spec.extra) alpha = 3;
+                break;
+        }
+        if (alpha < 0) return 0xFF000000u | (r << 16) | (g << 8) | b;
+        const uint32_t a = hi(alpha);
+        if (a == 255) return 0xFF000000u | (r << 16) | (g << 8) | b;
+        if (spec.extra == 2) return (a << 24) | (Premultiply(r, a) << 16) | (Premultiply(g, a) << 8) | Premultiply(b, a);
+        return (a << 24) | (std::min(r, a) << 16) | (std::min(g, a) << 8) | std::min(b, a);
+    }
+
+    // --- Compressors ---
+
+    std::vector<uint8_t> PackBits(const std::vector<uint8_t>& in) {
+        std::vector<uint8_t> out;
+        size_t i = 0;
+        while (i < in.size()) {
+            size_t run = 1;
+            while (i + run < in.size() && run < 128 && in[i + run] == in[i]) ++run;
+            if (run >= 3) {
+                out.push_back(static_cast<uint8_t>(1 - static_cast<int>(run)));
+                out.push_back(in[i]);
+                i += run;
+                continue;
+            }
+            size_t literal = 0;
+            while (i + literal < in.size() && literal < 128) {
+                if (i + literal + 2 < in.size() && in[i + literal] == in[i + literal + 1] && in[i + literal] == in[i + literal + 2]) break;
+                ++literal;
+            }
+            out.push_back(static_cast<uint8_t>(literal - 1));
+            out.insert(out.end(), in.begin() + i, in.begin() + i + literal);
+            i += literal;
+        }
+        return out;
+    }
+
+    /// As libtiff writes it: MSB-first codes, the width growing as the table passes 2^n, and a
+    /// clear code when the table fills.
+    std::vector<uint8_t> Lzw(const std::vector<uint8_t>& in) {
+        std::vector<uint8_t> out;
+        uint64_t bits = 0;
+        int count = 0;
+        int width = 9;
+        auto put = [&](uint32_t code) {
+            bits = (bits << width) | code;
+            count += width;
+            while (count >= 8) {
+                count -= 8;
+                out.push_back(static_cast<uint8_t>(bits >> count));
+            }
+        };
+        static std::vector<int16_t> child(4096 * 256, -1);
+        std::vector<uint32_t> used;
+        auto reset = [&]() {
+            for (uint32_t i : used) child[i] = -1;
+            used.clear();
+        };
+        uint32_t next = 258;
+        put(256);
+        if (in.empty()) {
+            put(257);
+        } else {
+            uint32_t w = in[0];
+            for (size_t i = 1; i < in.size(); ++i) {
+                const uint8_t c = in[i];
+                const int16_t existing = child[w * 256 + c];
+                if (existing >= 0) {
+                    w = static_cast<uint32_t>(existing);
+                    continue;
+                }
+                put(w);
+                child[w * 256 + c] = static_cast<int16_t>(next++);
+                used.push_back(w * 256 + c);
+                if (next == 4094) {
+                    put(256);
+                    reset();
+                    next = 258;
+                    width = 9;
+                } else if (next > (1u << width) - 1) {
+                    ++width;
+                }
+                w = c;
+            }
+            put(w);
+            if (++next > (1u << width) - 1 && width < 12) ++width;
+            put(257);
+        }
+        reset();
+        if (count) out.push_back(static_cast<uint8_t>(bits << (8 - count)));
+        return out;
+    }
+
+    std::vector<uint8_t> Deflate(const std::vector<uint8_t>& in) {
+        uLongf size = compressBound(static_cast<uLong>(in.size()));
+        std::vector<uint8_t> out(size);
+        compress2(out.data(), &size, in.data(), static_cast<uLong>(in.size()), 6);
+        out.resize(size);
+        return out;
+    }
+
+    // --- Writer ---
+
+    class Writer {
+    public:
+        explicit Writer(bool big_endian) : big_endian_(big_endian) {
+            out_.push_back(big_endian ? 'M' : 'I');
+            out_.push_back(big_endian ? 'M' : 'I');
+            Put16(42);
+            next_link_ = out_.size();
+            Put32(0);
+        }
+
+        /// The compressed strips or tiles of an image, plane after plane.
+        std::vector<std::vector<uint8_t>> Encode(const Spec& spec) const {
+            const bool tiled = spec.rows_per_strip == 0;
+            const uint32_t cw = tiled ? spec.tile : spec.width;
+            const uint32_t ch = tiled ? spec.tile : std::min(spec.rows_per_strip, spec.height);
+            const uint32_t across = (spec.width + cw - 1) / cw;
+            const uint32_t down = (spec.height + ch - 1) / ch;
+            const uint32_t planes = spec.planar == 2 ? spec.samples : 1;
+            std::vector<std::vector<uint8_t>> chunks;
+            for (uint32_t p = 0; p < planes; ++p) {
+                for (uint32_t c = 0; c < across * down; ++c) {
+                    const uint32_t y0 = c / across * ch;
+                    chunks.push_back(Compress(spec, Chunk(spec, c % across * cw, y0, cw, tiled ? ch : std::min(ch, spec.height - y0), p)));
+                }
+            }
+            return chunks;
+        }
+
+        uint32_t Add(const Spec& spec, uint32_t subfile_type, const std::vector<uint32_t>& sub_ifds, bool chain) {
+            return Add(spec, Encode(spec), subfile_type, sub_ifds, chain);
+        }
+
+        /// Appends an image and links it into the main chain, or just returns its offset for a SubIFD.
+        uint32_t Add(const Spec& spec, const std::vector<std::vector<uint8_t>>& chunks, uint32_t subfile_type,
+                     const std::vector<uint32_t>& sub_ifds, bool chain) {
+            const bool tiled = spec.rows_per_strip == 0;
+            const uint32_t cw = tiled ? spec.tile : spec.width;
+            const uint32_t ch = tiled ? spec.tile : std::min(spec.rows_per_strip, spec.height);
+
+            std::vector<uint32_t> offsets, counts;
+            for (const std::vector<uint8_t>& chunk : chunks) {
+                Align();
+                offsets.push_back(static_cast<uint32_t>(out_.size()));
+                counts.push_back(static_cast<uint32_t>(chunk.size()));
+                out_.insert(out_.end(), chunk.begin(), chunk.end());
+            }
+
+            std::vector<Entry> entries;
+            if (subfile_type) entries.push_back(Long(254, {subfile_type}));
+            entries.push_back(Long(256, {spec.width}));
+            entries.push_back(Long(257, {spec.height}));
+            entries.push_back(Short(258, std::vector<uint32_t>(spec.samples, spec.bits)));
+            entries.push_back(Short(259, {spec.compression}));
+            entries.push_back(Short(262, {spec.photometric}));
+            if (!tiled) entries.push_back(Long(273, offsets));
+            entries.push_back(Short(277, {spec.samples}));
+            if (!tiled) {
+                entries.push_back(Long(278, {ch}));
+                entries.push_back(Long(279, counts));
+            }
+            entries.push_back(Short(284, {spec.planar}));
+            if (spec.predictor != 1) entries.push_back(Short(317, {spec.predictor}));
+            if (spec.photometric == 3) {
+                const uint32_t n = 1u << spec.bits;
+                std::vector<uint32_t> map(n * 3);
+                for (uint32_t i = 0; i < n; ++i) {
+                    const uint32_t r = i * 255 / (n - 1);
+                    map[i] = r * 257;
+                    map[n + i] = (255 - r) * 257;
+                    map[2 * n + i] = ((r * 7) & 0xFF) * 257;
+                }
+                entries.push_back(Short(320, map));
+            }
+            if (tiled) {
+                entries.push_back(Long(322, {cw}));
+                entries.push_back(Long(323, {ch}));
+                entries.push_back(Long(324, offsets));
+                entries.push_back(Long(325, counts));
+            }
+            if (!sub_ifds.empty()) entries.push_back(Long(330, sub_ifds));
+            if (spec.extra) entries.push_back(Short(338, {spec.extra}));
+
+            // Arrays too long for their entry first, then the directory itself.
+            for (Entry& e : entries) {
+                if (e.bytes.size() > 4) {
+                    Align();
+                    e.offset = static_cast<uint32_t>(out_.size());
+                    out_.insert(out_.end(), e.bytes.begin(), e.bytes.end());
+                }
+            }
+            Align();
+            const uint32_t ifd = static_cast<uint32_t>(out_.size());
+            Put16(static_cast<uint32_t>(entries.size()));
+            for (const Entry& e : entries) {
+                Put16(e.tag);
+                Put16(e.type);
+                Put32(e.count);
+                if (e.bytes.size() > 4) {
+                    Put32(e.offset);
+                } else {
+                    std::vector<uint8_t> field(e.bytes);
+                    field.resize(4, 0);
+                    out_.insert(out_.end(), field.begin(), field.end());
+                }
+            }
+            const size_t link = out_.size();
+            Put32(0);
+            if (chain) {
+                Patch32(next_link_, ifd);
+                next_link_ = link;
+            }
+            return ifd;
+        }
+
+        const std::vector<uint8_t>& Bytes() const { return out_; }
+
+    private:
+        struct Entry {
+            uint16_t tag;
+            uint16_t type;
+            uint32_t count;
+            std::vector<uint8_t> bytes;
+            uint32_t offset;
+        };
+
+        Entry Short(uint16_t tag, const std::vector<uint32_t>& values) {
+            Entry e{tag, 3, static_cast<uint32_t>(values.size()), {}, 0};
+            for (uint32_t v : values) Append(e.bytes, v, 2);
+            return e;
+        }
+
+        Entry Long(uint16_t tag, const std::vector<uint32_t>& values) {
+            Entry e{tag, 4, static_cast<uint32_t>(values.size()), {}, 0};
+            for (uint32_t v : values) Append(e.bytes, v, 4);
+            return e;
+        }
+
+        void Append(std::vector<uint8_t>& out, uint32_t v, int size) const {
+            for (int i = 0; i < size; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * (big_endian_ ? size - 1 - i : i))));
+        }
+
+        void Put16(uint32_t v) { Append(out_, v, 2); }
+        void Put32(uint32_t v) { Append(out_, v, 4); }
+
+        void Patch32(size_t at, uint32_t v) {
+            std::vector<uint8_t> bytes;
+            Append(bytes, v, 4);
+            std::copy(bytes.begin(), bytes.end(), out_.begin() + at);
+        }
+
+        void Align() {
+            if (out_.size() & 1) out_.push_back(0);
+        }
+
+        /// The uncompressed bytes of one chunk (of plane `plane` if planar), predictor applied.
+        std::vector<uint8_t> Chunk(const Spec& spec, uint32_t x0, uint32_t y0, uint32_t w, uint32_t h, uint32_t plane) const {
+            const uint32_t per_pixel = spec.planar == 2 ? 1 : spec.samples;
+            const uint32_t mask = spec.bits == 16 ? 0xFFFF : (1u << spec.bits) - 1;
+            std::vector<uint8_t> out;
+            std::vector<uint32_t> row(static_cast<size_t>(w) * per_pixel);
+            for (uint32_t y = y0; y < y0 + h; ++y) {
+                for (uint32_t x = 0; x < w; ++x)
+                    for (uint32_t s = 0; s < per_pixel; ++s)
+                        row[x * per_pixel + s] = x0 + x < spec.width && y < spec.height
+                                                     ? SampleAt(spec, x0 + x, y, spec.planar == 2 ? plane : s)
+                                                     : 0;
+                if (spec.predictor == 2) {
+                    for (size_t i = row.size(); i-- > per_pixel;) row[i] = (row[i] - row[i - per_pixel]) & mask;
+                }
+                if (spec.bits == 16) {
+                    for (uint32_t v : row) Append(out, v, 2);
+                } else if (spec.bits == 8) {
+                    for (uint32_t v : row) out.push_back(static_cast<uint8_t>(v));
+                } else {
+                    uint32_t acc = 0, filled = 0;
+                    for (uint32_t v : row) {
+                        acc = (acc << spec.bits) | v;
+                        filled += spec.bits;
+                        if (filled == 8) {
+                            out.push_back(static_cast<uint8_t>(acc));
+                            acc = filled = 0;
+                        }
+                    }
+                    if (filled) out.push_back(static_cast<uint8_t>(acc << (8 - filled)));
+                }
+            }
+            return out;
+        }
+
+        static std::vector<uint8_t> Compress(const Spec& spec, const std::vector<uint8_t>& raw) {
+            switch (spec.compression) {
+                case kPackBits: return PackBits(raw);
+                case kLzw: return Lzw(raw);
+                case kDeflate: return Deflate(raw);
+                default: return raw;
+            }
+        }
+
+        bool big_endian_;
+        std::vector<uint8_t> out_;
+        size_t next_link_ = 0;
+    };
+
+    std::vector<uint8_t> WriteSingle(const Spec& spec) {
+        Writer writer(spec.big_endian);
+        writer.Add(spec, 0, {}, true);
+        return writer.Bytes();
+    }
+
+    bool Check(TiffDecoder& decoder, const Spec& spec, int32_t page, int32_t level, unsigned threads, const char* label) {
+        const TiffLevel info = decoder.Level(page, level);
+        if (info.width != static_cast<int32_t>(spec.width) || info.height != static_cast<int32_t>(spec.height) || !info.can_decode) {
+            printf("%-28s %s: level reads as %dx%d, can_decode %d\n", spec.name, label, info.width, info.height, info.can_decode);
+            return false;
+        }
+        std::vector<uint32_t> out(static_cast<size_t>(spec.width) * spec.height, 0xDEADBEEF);
+        if (!decoder.Decode(page, level, reinterpret_cast<uint8_t*>(out.data()), spec.width * 4, threads)) {
+            printf("%-28s %s: Decode() failed\n", spec.name, label);
+            return false;
+        }
+        for (uint32_t y = 0; y < spec.height; ++y) {
+            for (uint32_t x = 0; x < spec.width; ++x) {
+                const uint32_t expected = Expected(spec, x, y);
+                if (out[static_cast<size_t>(y) * spec.width + x] != expected) {
+                    printf("%-28s %s: pixel (%u, %u) is %08X, expected %08X\n", spec.name, label, x, y,
+                           out[static_cast<size_t>(y) * spec.width + x], expected);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    Spec Photo(const char* name, uint16_t compression, uint16_t predictor, uint32_t rows_per_strip, uint32_t tile) {
+        return Spec{name, 4000, 3000, 8, 3, 2, compression, predictor, 1, 0, rows_per_strip, tile, false, 99, false};
+    }
+
+    /// A little-endian gray8 IFD with the given size and one strip or tile of 16 bytes, as a fuzzer
+    /// would write it: the size fields are not checked against the data. Tiled if `tile_width` is set.
+    std::vector<uint8_t> HeaderOnly(uint32_t width, uint32_t height, uint32_t tile_width, uint32_t tile_height) {
+        std::vector<uint8_t> out = {'I', 'I', 42, 0, 8, 0, 0, 0};
+        auto put = [&out](uint32_t value, int bytes) {
+            for (int i = 0; i < bytes; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        };
+        std::vector<std::pair<uint16_t, uint32_t>> tags = {{256, width}, {257, height}, {258, 8}, {259, kNone}, {262, 1}};
+        const uint32_t data = 8 + 2 + (tile_width ? 10 : 9) * 12 + 4;
+        if (tile_width) {
+            tags.insert(tags.end(), {{277, 1}, {322, tile_width}, {323, tile_height}, {324, data}, {325, 16}});
+        } else {
+            tags.insert(tags.end(), {{273, data}, {277, 1}, {278, height}, {279, 16}});
+        }
+        put(static_cast<uint32_t>(tags.size()), 2);
+        for (const auto& [tag, value] : tags) {
+            put(tag, 2);
+            put(4, 2);                  // LONG
+            put(1, 4);
+            put(value, 4);
+        }
+        put(0, 4);
+        out.resize(data + 16, 0x80);
+        return out;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int runs = argc > 1 ? std::max(1, atoi(argv[1])) : 5;
+    int failures = 0;
+
+    // --- Correctness: every layout and compression, both kernel sets, one thread and many ---
+    const std::vector<Spec> specs = {
+        {"rgb8 none strips", 301, 97, 8, 3, 2, kNone, 1, 1, 0, 16, 0, false, 1, false},
+        {"rgb8 lzw pred", 301, 97, 8, 3, 2, kLzw, 2, 1, 0, 7, 0, false, 2, false},
+        {"rgb8 lzw pred BE", 301, 97, 8, 3, 2, kLzw, 2, 1, 0, 7, 0, true, 3, false},
+        {"rgba8 deflate pred assoc", 257, 130, 8, 4, 2, kDeflate, 2, 1, 1, 32, 0, false, 4, false},
+        {"rgba8 packbits straight", 257, 130, 8, 4, 2, kPackBits, 1, 1, 2, 32, 0, false, 5, false},
+        {"rgb8 lzw tiles", 300, 200, 8, 3, 2, kLzw, 2, 1, 0, 0, 64, false, 6, false},
+        {"rgb8 planar deflate", 211, 99, 8, 3, 2, kDeflate, 2, 2, 0, 10, 0, false, 7, false},
+        {"rgba8 planar tiles", 211, 99, 8, 4, 2, kLzw, 2, 2, 2, 0, 32, true, 8, false},
+        {"rgb16 lzw pred LE", 203, 77, 16, 3, 2, kLzw, 2, 1, 0, 9, 0, false, 9, false},
+        {"rgb16 deflate pred BE", 203, 77, 16, 3, 2, kDeflate, 2, 1, 0, 9, 0, true, 10, false},
+        {"rgba16 planar BE", 203, 77, 16, 4, 2, kDeflate, 2, 2, 2, 0, 48, true, 11, false},
+        {"gray8 min-is-white", 333, 111, 8, 1, 0, kPackBits, 1, 1, 0, 5, 0, false, 12, false},
+        {"gray8 lzw pred", 333, 111, 8, 1, 1, kLzw, 2, 1, 0, 5, 0, false, 13, false},
+        {"gray8+alpha deflate", 333, 111, 8, 2, 1, kDeflate, 2, 1, 2, 5, 0, false, 14, false},
+        {"gray16 lzw pred BE", 333, 111, 16, 1, 1, kLzw, 2, 1, 0, 5, 0, true, 15, false},
+        {"bilevel packbits", 1001, 307, 1, 1, 0, kPackBits, 1, 1, 0, 64, 0, false, 16, true},
+        {"bilevel lzw", 1001, 307, 1, 1, 1, kLzw, 1, 1, 0, 64, 0, true, 17, true},
+        {"gray4 none", 333, 111, 4, 1, 1, kNone, 1, 1, 0, 20, 0, false, 18, false},
+        {"gray2 deflate", 333, 111, 2, 1, 1, kDeflate, 1, 1, 0, 20, 0, false, 19, false},
+        {"palette8 lzw", 333, 111, 8, 1, 3, kLzw, 1, 1, 0, 20, 0, false, 20, false},
+        {"palette4 packbits", 333, 111, 4, 1, 3, kPackBits, 1, 1, 0, 20, 0, true, 21, false},
+        {"cmyk8 lzw pred", 255, 99, 8, 4, 5, kLzw, 2, 1, 0, 16, 0, false, 22, false},
+        {"cmyk16 deflate", 255, 99, 16, 4, 5, kDeflate, 1, 1, 0, 16, 0, false, 23, false},
+        {"rgb8 big lzw 1 strip", 1500, 900, 8, 3, 2, kLzw, 2, 1, 0, 900, 0, false, 24, false},
+    };
+    for (const Spec& spec : specs) {
+        const std::vector<uint8_t> file = WriteSingle(spec);
+        TiffDecoder decoder;
+        if (!decoder.Open(file.data(), file.size()) || decoder.PageCount() != 1) {
+            printf("%-28s Open() failed\n", spec.name);
+            ++failures;
+            continue;
+        }
+        for (bool simd : {false, true}) {
+            decoder.SetSimd(simd);
+            for (unsigned threads : {1u, 4u}) {
+                char label[32];
+                snprintf(label, sizeof label, "%s, %u thread%s", simd ? "sse2" : "scalar", threads, threads > 1 ? "s" : "");
+                if (!Check(decoder, spec, 0, 0, threads, label)) ++failures;
+            }
+        }
+    }
+    printf("%zu layouts checked, %d failures\n\n", specs.size(), failures);
+
+    // --- Predictor kernels, through decodes that are mostly predictor ---
+    printf("%-28s %10s %10s\n", "uncompressed + predictor", "scalar MP/s", "sse2 MP/s");
+    const std::vector<Spec> predicted = {
+        {"gray8", 4000, 3000, 8, 1, 1, kNone, 2, 1, 0, 16, 0, false, 31, false},
+        {"rgb8", 4000, 3000, 8, 3, 2, kNone, 2, 1, 0, 16, 0, false, 32, false},
+        {"rgba8", 4000, 3000, 8, 4, 2, kNone, 2, 1, 2, 16, 0, false, 33, false},
+        {"rgb16", 4000, 3000, 16, 3, 2, kNone, 2, 1, 0, 16, 0, false, 34, false},
+    };
+    std::vector<uint32_t> out;
+    for (const Spec& spec : predicted) {
+        const std::vector<uint8_t> file = WriteSingle(spec);
+        TiffDecoder decoder;
+        decoder.Open(file.data(), file.size());
+        out.resize(static_cast<size_t>(spec.width) * spec.height);
+        double best[2] = {1e30, 1e30};
+        for (int simd = 0; simd < 2; ++simd) {
+            decoder.SetSimd(simd != 0);
+            for (int run = 0; run < runs; ++run) {
+                const auto start = Clock::now();
+                decoder.Decode(0, 0, reinterpret_cast<uint8_t*>(out.data()), spec.width * 4, 1);
+                best[simd] = std::min(best[simd], MsSince(start));
+            }
+        }
+        printf("%-28s %10.0f %10.0f\n", spec.name, spec.width * spec.height / (best[0] * 1000),
+               spec.width * spec.height / (best[1] * 1000));
+    }
+
+    // --- A 12 MP photo in each compression ---
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    printf("\n%-28s %9s %10s %10s   (%u cores)\n", "4000x3000 rgb8", "file MB", "1 thread", "all cores", cores);
+    const std::vector<Spec> photos = {
+        Photo("none, 16-row strips", kNone, 1, 16, 0),
+        Photo("packbits, 16-row strips", kPackBits, 1, 16, 0),
+        Photo("lzw+pred, 16-row strips", kLzw, 2, 16, 0),
+        Photo("deflate+pred, 16-row strips", kDeflate, 2, 16, 0),
+        Photo("lzw+pred, 256 tiles", kLzw, 2, 0, 256),
+        Photo("lzw+pred, one strip", kLzw, 2, 3000, 0),
+    };
+    for (const Spec& spec : photos) {
+        const std::vector<uint8_t> file = WriteSingle(spec);
+        TiffDecoder decoder;
+        decoder.Open(file.data(), file.size());
+        out.resize(static_cast<size_t>(spec.width) * spec.height);
+        double best[2] = {1e30, 1e30};
+        const unsigned threads[2] = {1, 0};
+        for (int t = 0; t < 2; ++t) {
+            for (int run = 0; run < runs; ++run) {
+                const auto start = Clock::now();
+                decoder.Decode(0, 0, reinterpret_cast<uint8_t*>(out.data()), spec.width * 4, threads[t]);
+                best[t] = std::min(best[t], MsSince(start));
+            }
+        }
+        printf("%-28s %9.1f %8.1fms %8.1fms\n", spec.name, file.size() / 1e6, best[0], best[1]);
+    }
+
+    // --- A 300-page scanned document ---
+    {
+        constexpr int kPages = 300;
+        constexpr int kDistinct = 10;
+        Spec page{"A4 page, 1-bit lzw", 2480, 3508, 1, 1, 0, kLzw, 1, 1, 0, 64, 0, false, 0, true};
+        Writer writer(false);
+        std::vector<std::vector<std::vector<uint8_t>>> encoded;
+        for (int i = 0; i < kDistinct; ++i) {
+            page.seed = 1000 + i;
+            encoded.push_back(writer.Encode(page));
+        }
+        for (int i = 0; i < kPages; ++i) writer.Add(page, encoded[i % kDistinct], 2, {}, true);
+        const std::vector<uint8_t>& file = writer.Bytes();
+
+        double open_ms = 1e30;
+        TiffDecoder decoder;
+        for (int run = 0; run < runs; ++run) {
+            const auto start = Clock::now();
+            TiffDecoder d;
+            d.Open(file.data(), file.size());
+            open_ms = std::min(open_ms, MsSince(start));
+        }
+        decoder.Open(file.data(), file.size());
+        printf("\n%d-page scan, %ux%u 1-bit LZW, %.1f MB: %d pages indexed in %.2f ms\n", kPages, page.width, page.height,
+               file.size() / 1e6, decoder.PageCount(), open_ms);
+        if (decoder.PageCount() != kPages) ++failures;
+
+        out.resize(static_cast<size_t>(page.width) * page.height);
+        double page_ms = 1e30;
+        for (int run = 0; run < runs; ++run) {
+            const auto start = Clock::now();
+            decoder.Decode(217, 0, reinterpret_cast<uint8_t*>(out.data()), page.width * 4, 0);
+            page_ms = std::min(page_ms, MsSince(start));
+        }
+        page.seed = 1000 + 217 % kDistinct;
+        if (!Check(decoder, page, 217, 0, 0, "page 218")) ++failures;
+        const auto start = Clock::now();
+        for (int i = 0; i < kPages; ++i) decoder.Decode(i, 0, reinterpret_cast<uint8_t*>(out.data()), page.width * 4, 0);
+        printf("turning to page 218: %.1f ms; decoding every page: %.0f ms\n", page_ms, MsSince(start));
+    }
+
+    // --- Reduced-resolution levels, in SubIFDs and in the main chain ---
+    {
+        Writer writer(true);
+        const Spec full = Photo("full", kDeflate, 2, 16, 0);
+        Spec half = full, quarter = full, eighth = full;
+        half.width = 1000, half.height = 750, half.seed = 41;
+        quarter.width = 500, quarter.height = 375, quarter.seed = 42;
+        eighth.width = 250, eighth.height = 188, eighth.seed = 43;
+        const uint32_t sub_half = writer.Add(half, 1, {}, false);
+        const uint32_t sub_eighth = writer.Add(eighth, 1, {}, false);
+        writer.Add(full, 0, {sub_eighth, sub_half}, true);
+        Spec second = full;
+        second.width = 640, second.height = 480, second.seed = 44;
+        writer.Add(second, 2, {}, true);
+        writer.Add(quarter, 1, {}, true);
+        const std::vector<uint8_t>& file = writer.Bytes();
+
+        TiffDecoder decoder;
+        if (!decoder.Open(file.data(), file.size()) || decoder.PageCount() != 2 || decoder.PageInfo(0).level_count != 3 ||
+            decoder.PageInfo(1).level_count != 2) {
+            printf("\nreduced levels: %d pages, level counts %d and %d\n", decoder.PageCount(), decoder.PageInfo(0).level_count,
+                   decoder.PageInfo(1).level_count);
+            ++failures;
+        } else {
+            if (!Check(decoder, full, 0, 0, 0, "level 0")) ++failures;
+            if (!Check(decoder, half, 0, 1, 0, "level 1")) ++failures;
+            if (!Check(decoder, eighth, 0, 2, 0, "level 2")) ++failures;
+            if (!Check(decoder, quarter, 1, 1, 0, "page 2 level 1")) ++failures;
+            const TiffLevel preview = decoder.SelectLevel(0, 800);
+            if (preview.level != 1 || decoder.SelectLevel(0, 100).level != 2 || decoder.SelectLevel(0, 0).level != 0 ||
+                decoder.SelectLevel(1, 800).level != 0) {
+                printf("\nSelectLevel() picked the wrong levels\n");
+                ++failures;
+            }
+            double best[2] = {1e30, 1e30};
+            for (int l = 0; l < 2; ++l) {
+                const TiffLevel level = l ? preview : decoder.Level(0, 0);
+                out.resize(static_cast<size_t>(level.width) * level.height);
+                for (int run = 0; run < runs; ++run) {
+                    const auto start = Clock::now();
+                    decoder.Decode(0, level.level, reinterpret_cast<uint8_t*>(out.data()), level.width * 4, 0);
+                    best[l] = std::min(best[l], MsSince(start));
+                }
+            }
+            printf("\n800px preview from the %dx%d SubIFD: %.2f ms; from the full page: %.1f ms\n", preview.width,
+                   preview.height, best[1], best[0]);
+        }
+    }
+
+    // --- Sizes near 2^32, which once overflowed the pixel-count checks (fuzzer seeds) ---
+    {
+        struct Case {
+            const char* name;
+            uint32_t width, height, tile_width, tile_height;
+        };
+        const Case cases[] = {
+            {"0xFFFFFFFF x 0xFFFFFFFF strips", 0xFFFFFFFFu, 0xFFFFFFFFu, 0, 0},
+            {"0xFFFFFFFE x 3388997655 strips", 0xFFFFFFFEu, 3388997655u, 0, 0},
+            {"64x64, 0xFFFFFFFF x 0xFFFFFFFF tiles", 64, 64, 0xFFFFFFFFu, 0xFFFFFFFFu},
+        };
+        for (const Case& c : cases) {
+            const std::vector<uint8_t> file = HeaderOnly(c.width, c.height, c.tile_width, c.tile_height);
+            TiffDecoder decoder;
+            if (decoder.Open(file.data(), file.size()) && decoder.PageCount() > 0 && decoder.PageInfo(0).can_decode) {
+                printf("\n%s: reported as decodable\n", c.name);
+                ++failures;
+            }
+        }
+    }
+
+    if (failures) printf("\n%d FAILURES\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,301 @@
+// Benchmark for the portable core of FlyNativeLibHeif/WebpDecoder and WebpCompositor.
+//
+// Encodes frames with libwebp and wraps them in ANMF chunks to build animated WebPs in memory (a
+// sticker of a soft-edged sprite blended over a transparent canvas, a screen recording of small
+// opaque patches over a lossy first frame, and a cross-fade of translucent full-canvas frames
+// with a key frame every eight), then plays each one through, the way NativeAnimator does.
+// Reported per clip:
+// - libwebp decode of all frames alone, then decode plus compositing with the scalar and the
+//   SSE2 blend; the difference is the time spent premultiplying and blending,
+// - with -DWITH_WEBPDEMUX, libwebp's WebPAnimDecoder playing the same file, and the largest
+//   difference between its canvases and ours (it blends with a slightly different rounding),
+// - frames decoded per random seek, replaying from the nearest key frame against from frame 0,
+// - bytes uploaded per frame: the dirty rectangles against the whole canvas.
+//
+// Build and run: see README.md in this folder.
+
+#include "CpuFeatures.h"
+#include "WebpCompositor.h"
+#include "WebpDecoder.h"
+
+#include <webp/encode.h>
+#ifdef WITH_WEBPDEMUX
+#include <webp/demux.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double MsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    uint32_t Rand(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // --- Writer ---------------------------------------------------------------------------
+
+    struct Patch {
+        int x, y, width, height;        // x and y even, as ANMF stores them halved.
+        bool dispose, blend, lossless;
+        std::vector<uint32_t> pixels;   // Straight-alpha BGRA.
+    };
+
+    struct Clip {
+        std::string name;
+        int width, height;
+        std::vector<Patch> patches;
+    };
+
+    void Put24(std::vector<uint8_t>& out, uint32_t v) {
+        out.insert(out.end(), {static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v >> 16)});
+    }
+
+    void Put32(std::vector<uint8_t>& out, uint32_t v) {
+        Put24(out, v);
+        out.push_back(static_cast<uint8_t>(v >> 24));
+    }
+
+    void PutChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size) {
+        out.insert(out.end(), type, type + 4);
+        Put32(out, static_cast<uint32_t>(size));
+        out.insert(out.end(), data, data + size);
+        if (size & 1) out.push_back(0);
+    }
+
+    /// Encodes a patch as a still WebP and returns its ALPH, VP8 and VP8L chunks, as ANMF frame data.
+    std::vector<uint8_t> EncodeFrame(const Patch& patch) {
+        const uint8_t* bgra = reinterpret_cast<const uint8_t*>(patch.pixels.data());
+        uint8_t* encoded = nullptr;
+        const size_t size = patch.lossless ? WebPEncodeLosslessBGRA(bgra, patch.width, patch.height, patch.width * 4, &encoded)
+                                           : WebPEncodeBGRA(bgra, patch.width, patch.height, patch.width * 4, 80.0f, &encoded);
+        std::vector<uint8_t> out;
+        for (size_t pos = 12; pos + 8 <= size;) {
+            const uint32_t length = encoded[pos + 4] | (encoded[pos + 5] << 8) | (encoded[pos + 6] << 16) | (encoded[pos + 7] << 24);
+            const size_t next = pos + 8 + length + (length & 1);
+            if (!memcmp(encoded + pos, "ALPH", 4) || !memcmp(encoded + pos, "VP8 ", 4) || !memcmp(encoded + pos, "VP8L", 4)) {
+                out.insert(out.end(), encoded + pos, encoded + std::min(next, size));
+            }
+            pos = next;
+        }
+        WebPFree(encoded);
+        return out;
+    }
+
+    std::vector<uint8_t> WriteWebp(const Clip& clip) {
+        std::vector<uint8_t> body, payload;
+        payload = {0x12, 0, 0, 0};      // Animation and alpha flags.
+        Put24(payload, clip.width - 1);
+        Put24(payload, clip.height - 1);
+        PutChunk(body, "VP8X", payload.data(), payload.size());
+        payload = {0, 0, 0, 0, 0, 0};   // Background colour, loop forever.
+        PutChunk(body, "ANIM", payload.data(), payload.size());
+        for (const Patch& patch : clip.patches) {
+            payload.clear();
+            Put24(payload, patch.x / 2);
+            Put24(payload, patch.y / 2);
+            Put24(payload, patch.width - 1);
+            Put24(payload, patch.height - 1);
+            Put24(payload, 40);
+            payload.push_back(static_cast<uint8_t>((patch.blend ? 0 : 2) | (patch.dispose ? 1 : 0)));
+            const std::vector<uint8_t> frame = EncodeFrame(patch);
+            payload.insert(payload.end(), frame.begin(), frame.end());
+            PutChunk(body, "ANMF", payload.data(), payload.size());
+        }
+        std::vector<uint8_t> out = {'R', 'I', 'F', 'F'};
+        Put32(out, static_cast<uint32_t>(body.size() + 4));
+        out.insert(out.end(), {'W', 'E', 'B', 'P'});
+        out.insert(out.end(), body.begin(), body.end());
+        return out;
+    }
+
+    uint32_t Bgra(int r, int g, int b, int a) {
+        return (static_cast<uint32_t>(a) << 24) | (static_cast<uint32_t>(std::clamp(r, 0, 255)) << 16) |
+               (static_cast<uint32_t>(std::clamp(g, 0, 255)) << 8) | static_cast<uint32_t>(std::clamp(b, 0, 255));
+    }
+
+    /// A soft-edged sprite moving over a transparent canvas; every other frame clears its rectangle.
+    Clip StickerClip(int size, int frames) {
+        Clip clip{"sticker", size, size, {}};
+        const int sprite = size / 3 & ~1;
+        for (int f = 0; f < frames; ++f) {
+            const int x = (f * 14) % (size - sprite) & ~1, y = (f * 6) % (size - sprite) & ~1;
+            Patch p{x, y, sprite, sprite, f % 2 == 1, true, true, std::vector<uint32_t>(static_cast<size_t>(sprite) * sprite)};
+            for (int py = 0; py < sprite; ++py) {
+                for (int px = 0; px < sprite; ++px) {
+                    const int dx = px - sprite / 2, dy = py - sprite / 2, r = sprite * sprite / 4, d = dx * dx + dy * dy;
+                    const int alpha = d >= r ? 0 : std::min(255, (r - d) * 768 / r);
+                    p.pixels[static_cast<size_t>(py) * sprite + px] = Bgra(255 - px * 255 / sprite, (f * 9 + py) & 255, px * 255 / sprite, alpha);
+                }
+            }
+            clip.patches.push_back(std::move(p));
+        }
+        return clip;
+    }
+
+    /// A lossy full first frame, then small opaque lossless patches (text, a cursor) blended over it.
+    Clip ScreenClip(int width, int height, int frames) {
+        Clip clip{"screen", width, height, {}};
+        uint32_t state = 0x1234567u;
+        for (int f = 0; f < frames; ++f) {
+            Patch p{0, 0, width, height, false, false, false, {}};
+            if (f > 0) {
+                p.width = 40 + static_cast<int>(Rand(state) % 200);
+                p.height = 16 + static_cast<int>(Rand(state) % 60);
+                p.x = static_cast<int>(Rand(state) % (width - p.width)) & ~1;
+                p.y = static_cast<int>(Rand(state) % (height - p.height)) & ~1;
+                p.blend = true;
+                p.lossless = true;
+            }
+            p.pixels.resize(static_cast<size_t>(p.width) * p.height);
+            for (int y = 0; y < p.height; ++y) {
+                for (int x = 0; x < p.width; ++x) {
+                    const bool ink = f == 0 ? ((x / 8 + y / 16) % 9 == 0) : ((x * 7 + y * 3 + f) % 11 < 4);
+                    p.pixels[static_cast<size_t>(y) * p.width + x] = ink ? Bgra(30, 30, 40, 255) : Bgra(240, 242, 245, 255);
+                }
+            }
+            clip.patches.push_back(std::move(p));
+        }
+        return clip;
+    }
+
+    /// Translucent full-canvas gradients blended over each other; every eighth frame clears the canvas after itself.
+    Clip FadeClip(int width, int height, int frames) {
+        Clip clip{"fade", width, height, {}};
+        for (int f = 0; f < frames; ++f) {
+            Patch p{0, 0, width, height, f % 8 == 7, f % 8 != 0, false, std::vector<uint32_t>(static_cast<size_t>(width) * height)};
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const int alpha = f % 8 == 0 ? 255 : 40 + (x + y + f * 16) % 160;
+                    p.pixels[static_cast<size_t>(y) * width + x] = Bgra(x * 255 / width + f * 5, y * 255 / height, (f * 31) & 255, alpha);
+                }
+            }
+            clip.patches.push_back(std::move(p));
+        }
+        return clip;
+    }
+
+#ifdef WITH_WEBPDEMUX
+    /// Plays the file through WebPAnimDecoder to premultiplied BGRA; returns ms, and the largest
+    /// channel difference from `compositor`'s canvases if it is given.
+    double AnimDecoderPlay(const std::vector<uint8_t>& file, WebpCompositor* compositor, int& max_diff) {
+        WebPAnimDecoderOptions options;
+        WebPAnimDecoderOptionsInit(&options);
+        options.color_mode = MODE_bgrA;
+        const WebPData data{file.data(), file.size()};
+        const auto start = Clock::now();
+        WebPAnimDecoder* decoder = WebPAnimDecoderNew(&data, &options);
+        int index = 0;
+        uint8_t* canvas = nullptr;
+        int timestamp = 0;
+        while (WebPAnimDecoderGetNext(decoder, &canvas, &timestamp)) {
+            if (compositor) {
+                FrameRect dirty;
+                compositor->RenderTo(index, dirty);
+                const size_t bytes = compositor->Stride() * compositor->Height();
+                for (size_t i = 0; i < bytes; ++i) max_diff = std::max(max_diff, abs(canvas[i] - compositor->Pixels()[i]));
+            }
+            ++index;
+        }
+        WebPAnimDecoderDelete(decoder);
+        return MsSince(start);
+    }
+#endif
+}
+
+int main(int argc, char** argv) {
+    const int scale = argc > 1 ? std::max(1, atoi(argv[1])) : 1;
+    const int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 3;
+
+    std::vector<Clip> clips;
+    clips.push_back(StickerClip(512, 60 * scale));
+    clips.push_back(ScreenClip(1280, 720, 100 * scale));
+    clips.push_back(FadeClip(640, 480, 32 * scale));
+
+    printf("blend: %s\n", CpuFeatures::Name(CpuFeatures::Level()));
+    printf("%-8s %6s %9s %8s | %9s %10s %10s %7s", "clip", "frames", "canvas", "file MB", "decode ms", "scalar ms", "sse2 ms",
+           "blend");
+#ifdef WITH_WEBPDEMUX
+    printf(" | %9s %5s", "anim ms", "diff");
+#endif
+    printf(" | %10s %10s | %12s %12s\n", "seek: key", "from 0", "dirty KB/fr", "full KB/fr");
+
+    for (const Clip& clip : clips) {
+        const std::vector<uint8_t> file = WriteWebp(clip);
+
+        WebpCompositor compositor;
+        if (!compositor.Open(file.data(), file.size()) || compositor.Decoder().FrameCount() != static_cast<int>(clip.patches.size())) {
+            printf("%s: failed to open\n", clip.name.c_str());
+            return 1;
+        }
+        const WebpDecoder& decoder = compositor.Decoder();
+        const int frames = decoder.FrameCount();
+
+        double decode_ms = 1e30, scalar_ms = 1e30, simd_ms = 1e30;
+        std::vector<uint8_t> scratch(static_cast<size_t>(clip.width) * clip.height * 4);
+        uint64_t dirty_bytes = 0;
+        for (int run = 0; run < runs; ++run) {
+            auto start = Clock::now();
+            for (int f = 0; f < frames; ++f) decoder.DecodeFrame(f, scratch.data());
+            decode_ms = std::min(decode_ms, MsSince(start));
+
+            for (int simd = 0; simd < 2; ++simd) {
+                compositor.SetSimd(simd == 1);
+                compositor.Reset();
+                uint64_t bytes = 0;
+                FrameRect dirty;
+                start = Clock::now();
+                for (int f = 0; f < frames; ++f) {
+                    compositor.RenderTo(f, dirty);
+                    bytes += static_cast<uint64_t>(dirty.width) * dirty.height * 4;
+                }
+                double& best = simd ? simd_ms : scalar_ms;
+                best = std::min(best, MsSince(start));
+                dirty_bytes = bytes;
+            }
+        }
+
+        char canvas[32];
+        snprintf(canvas, sizeof(canvas), "%dx%d", clip.width, clip.height);
+        printf("%-8s %6d %9s %8.2f | %9.1f %10.1f %10.1f %6.2fx", clip.name.c_str(), frames, canvas, file.size() / 1048576.0,
+               decode_ms, scalar_ms, simd_ms, (scalar_ms - decode_ms) / std::max(0.01, simd_ms - decode_ms));
+#ifdef WITH_WEBPDEMUX
+        double anim_ms = 1e30;
+        int max_diff = 0;
+        for (int run = 0; run < runs; ++run) anim_ms = std::min(anim_ms, AnimDecoderPlay(file, nullptr, max_diff));
+        compositor.Reset();
+        AnimDecoderPlay(file, &compositor, max_diff);
+        printf(" | %9.1f %5d", anim_ms, max_diff);
+#endif
+
+        // Random seeks: frames drawn with key frames against replaying from the first frame.
+        uint32_t state = 0xBEEFu;
+        const int seeks = 200;
+        int64_t from_zero = 0;
+        const int64_t drawn_before = compositor.FramesDrawn();
+        for (int s = 0; s < seeks; ++s) {
+            const int target = static_cast<int>(Rand(state) % frames);
+            FrameRect dirty;
+            compositor.Reset();
+            compositor.RenderTo(target, dirty);
+            from_zero += target + 1;
+        }
+        printf(" | %10.1f %10.1f | %12.0f %12.0f\n", static_cast<double>(compositor.FramesDrawn() - drawn_before) / seeks,
+               static_cast<double>(from_zero) / seeks, dirty_bytes / 1024.0 / frames,
+               static_cast<double>(clip.width) * clip.height * 4 / 1024.0);
+    }
+    return 0;
+}
@@ -0,0 +1,279 @@
+/**
+ * @file DirectoryScanner.cpp
+ * @brief Implements DirectoryScanner and NaturalSortKey.
+ */
+
+#include "DirectoryScanner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	constexpr uint8_t kClassPunctuation = 0x01;
+	constexpr uint8_t kClassDigits = 0x02;
+	constexpr uint8_t kClassOther = 0x03;
+
+	/// @brief The code unit as an unsigned value (plain char is signed on some compilers).
+	template <typename CharT>
+	uint32_t Unit(CharT c) { return static_cast<uint32_t>(static_cast<std::make_unsigned_t<CharT>>(c)); }
+
+	template <typename CharT>
+	bool IsDigit(CharT c) { return c >= '0' && c <= '9'; }
+
+	template <typename CharT>
+	bool IsAsciiPunctuation(CharT c)
+	{
+		return Unit(c) < 0x80 && !IsDigit(c) && !(c >= 'a' && c <= 'z') && !(c >= 'A' && c <= 'Z');
+	}
+
+	template <typename CharT>
+	CharT ToLowerAscii(CharT c)
+	{
+		return (c >= 'A' && c <= 'Z') ? static_cast<CharT>(c - 'A' + 'a') : c;
+	}
+
+#ifdef _WIN32
+	/// @brief Appends the OS sort key, which orders exactly like StrCmpLogicalW / Explorer.
+	void AppendSystemKey(const wchar_t* name, size_t length, std::string& key)
+	{
+		constexpr DWORD flags = LCMAP_SORTKEY | SORT_DIGITSASNUMBERS | NORM_IGNORECASE;
+		const int needed = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, name, static_cast<int>(length),
+			nullptr, 0, nullptr, nullptr, 0);
+		if (needed <= 0)
+		{
+			NaturalSortKey::AppendPortable(name, length, key);
+			return;
+		}
+		const size_t start = key.size();
+		key.resize(start + needed);
+		LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, name, static_cast<int>(length),
+			reinterpret_cast<LPWSTR>(&key[start]), needed, nullptr, nullptr, 0);
+	}
+#endif
+}
+
+template <typename CharT>
+void NaturalSortKey::AppendPortable(const CharT* name, size_t length, std::string& key)
+{
+	size_t i = 0;
+	while (i < length)
+	{
+		const CharT c = name[i];
+		if (IsDigit(c))
+		{
+			// Skip leading zeros, then record the run length before the digits so that a
+			// longer run (a bigger number) always sorts after a shorter one.
+			size_t start = i;
+			while (i < length && IsDigit(name[i])) ++i;
+			size_t first = start;
+			while (first + 1 < i && name[first] == '0') ++first;
+			const size_t digits = std::min<size_t>(i - first, 0xFFFF);
+
+			key.push_back(static_cast<char>(kClassDigits));
+			key.push_back(static_cast<char>((digits >> 8) & 0xFF));
+			key.push_back(static_cast<char>(digits & 0xFF));
+			for (size_t d = 0; d < digits; ++d)
+				key.push_back(static_cast<char>(name[first + d]));
+			continue;
+		}
+
+		if (IsAsciiPunctuation(c))
+		{
+			key.push_back(static_cast<char>(kClassPunctuation));
+			key.push_back(static_cast<char>(c));
+		}
+		else
+		{
+			const uint32_t u = Unit(ToLowerAscii(c));
+			key.push_back(static_cast<char>(kClassOther));
+			if (sizeof(CharT) > 1)
+			{
+				key.push_back(static_cast<char>((u >> 24) & 0xFF));
+				key.push_back(static_cast<char>((u >> 16) & 0xFF));
+				key.push_back(static_cast<char>((u >> 8) & 0xFF));
+			}
+			key.push_back(static_cast<char>(u & 0xFF));
+		}
+		++i;
+	}
+}
+
+template void NaturalSortKey::AppendPortable<char>(const char*, size_t, std::string&);
+template void NaturalSortKey::AppendPortable<wchar_t>(const wchar_t*, size_t, std::string&);
+
+void DirectoryScanner::SetExtensions(const CharT* list)
+{
+	extensions.clear();
+	if (!list) return;
+
+	String current;
+	for (const CharT* p = list;; ++p)
+	{
+		if (*p == ',' || *p == ';' || *p == 0)
+		{
+			if (!current.empty())
+			{
+				if (current[0] != '.') current.insert(current.begin(), '.');
+				extensions.push_back(current);
+			}
+			current.clear();
+			if (*p == 0) break;
+		}
+		else if (*p != ' ')
+		{
+			current.push_back(ToLowerAscii(*p));
+		}
+	}
+	std::sort(extensions.begin(), extensions.end());
+	extensions.erase(std::unique(extensions.begin(), extensions.end()), extensions.end());
+}
+
+/// @brief Case-insensitive check of the name's extension against the sorted filter set.
+bool DirectoryScanner::Matches(const CharT* name, size_t length) const
+{
+	size_t dot = length;
+	while (dot > 0 && name[dot - 1] != '.') --dot;
+	if (dot == 0) return false;
+	--dot;
+
+	const size_t ext_length = length - dot;
+	CharT lowered[16];
+	if (ext_length > sizeof(lowered) / sizeof(lowered[0])) return false;
+	for (size_t i = 0; i < ext_length; ++i) lowered[i] = ToLowerAscii(name[dot + i]);
+
+	const String ext(lowered, ext_length);
+	return std::binary_search(extensions.begin(), extensions.end(), ext);
+}
+
+/**
+ * @brief Builds every key once into a single arena, sorts indices with memcmp on the keys
+ *        (ordinal name as the tie-break) and packs the result.
+ */
+void DirectoryScanner::SortAndPack(const String& directory, const std::vector<String>& names, PackedPathList<CharT>& out)
+{
+	const size_t count = names.size();
+
+	std::string keys;
+	std::vector<uint32_t> key_offsets(count + 1);
+	size_t name_chars = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		key_offsets[i] = static_cast<uint32_t>(keys.size());
+#ifdef _WIN32
+		AppendSystemKey(names[i].data(), names[i].size(), keys);
+#else
+		NaturalSortKey::AppendPortable(names[i].data(), names[i].size(), keys);
+#endif
+		name_chars += names[i].size();
+	}
+	key_offsets[count] = static_cast<uint32_t>(keys.size());
+
+	std::vector<uint32_t> order(count);
+	std::iota(order.begin(), order.end(), 0u);
+	const char* key_data = keys.data();
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+	{
+		const size_t la = key_offsets[a + 1] - key_offsets[a];
+		const size_t lb = key_offsets[b + 1] - key_offsets[b];
+		const int cmp = memcmp(key_data + key_offsets[a], key_data + key_offsets[b], std::min(la, lb));
+		if (cmp != 0) return cmp < 0;
+		if (la != lb) return la < lb;
+		return names[a] < names[b];
+	});
+
+	const bool needs_separator = !directory.empty() && directory.back() != '\\' && directory.back() != '/';
+#ifdef _WIN32
+	const CharT separator = '\\';
+#else
+	const CharT separator = '/';
+#endif
+	const size_t prefix = directory.size() + (needs_separator ? 1 : 0);
+
+	out.Chars.clear();
+	out.Offsets.clear();
+	out.Chars.reserve(prefix * count + name_chars);
+	out.Offsets.reserve(count + 1);
+	for (uint32_t index : order)
+	{
+		out.Offsets.push_back(static_cast<int32_t>(out.Chars.size()));
+		out.Chars.insert(out.Chars.end(), directory.begin(), directory.end());
+		if (needs_separator) out.Chars.push_back(separator);
+		out.Chars.insert(out.Chars.end(), names[index].begin(), names[index].end());
+	}
+	out.Offsets.push_back(static_cast<int32_t>(out.Chars.size()));
+}
+
+#ifdef _WIN32
+
+/**
+ * @brief Enumerates with FindFirstFileExW. FindExInfoBasic skips the 8.3 short name and
+ *        FIND_FIRST_EX_LARGE_FETCH asks the file system for larger batches per call.
+ *        Hidden and system files are kept, matching the managed enumeration.
+ */
+bool DirectoryScanner::Scan(const String& directory, PackedPathList<CharT>& out) const
+{
+	String pattern = directory;
+	if (!pattern.empty() && pattern.back() != L'\\' && pattern.back() != L'/') pattern.push_back(L'\\');
+	pattern.push_back(L'*');
+
+	WIN32_FIND_DATAW data;
+	HANDLE find = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch,
+		nullptr, FIND_FIRST_EX_LARGE_FETCH);
+	if (find == INVALID_HANDLE_VALUE) return false;
+
+	std::vector<String> names;
+	do
+	{
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+		const size_t length = wcslen(data.cFileName);
+		if (Matches(data.cFileName, length)) names.emplace_back(data.cFileName, length);
+	} while (FindNextFileW(find, &data));
+	FindClose(find);
+
+	SortAndPack(directory, names, out);
+	return true;
+}
+
+#else
+
+bool DirectoryScanner::Scan(const String& directory, PackedPathList<CharT>& out) const
+{
+	DIR* dir = opendir(directory.c_str());
+	if (!dir) return false;
+
+	std::vector<String> names;
+	while (dirent* entry = readdir(dir))
+	{
+		if (entry->d_type == DT_DIR) continue;
+		const size_t length = strlen(entry->d_name);
+		if (!Matches(entry->d_name, length)) continue;
+
+		// d_type is not filled in by every file system; fall back to a stat for those and symlinks.
+		if (entry->d_type != DT_REG)
+		{
+			struct stat st;
+			if (fstatat(dirfd(dir), entry->d_name, &st, 0) != 0 || !S_ISREG(st.st_mode)) continue;
+		}
+		names.emplace_back(entry->d_name, length);
+	}
+	closedir(dir);
+
+	SortAndPack(directory, names, out);
+	return true;
+}
+
+#endif
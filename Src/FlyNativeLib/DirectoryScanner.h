@@ -0,0 +1,83 @@
+/**
+ * @file DirectoryScanner.h
+ * @brief Declares DirectoryScanner - enumerates, filters and natural-sorts a folder in one call.
+ *
+ * File discovery used to list a folder in managed code and sort it with one StrCmpLogicalW
+ * P/Invoke per comparison, which for a 50k-file folder is close to a million interop
+ * transitions. DirectoryScanner does the whole job natively:
+ *
+ *  1. reads directory entries in bulk (FindFirstFileExW with a large fetch on Windows,
+ *     readdir elsewhere),
+ *  2. keeps only files whose extension is in the supplied set,
+ *  3. builds a natural-sort key for each name once (digit runs compare as numbers), so
+ *     the sort itself is a plain memcmp per comparison,
+ *  4. packs the sorted full paths into one character buffer indexed by offsets.
+ *
+ * On Windows the key is the OS sort key produced with SORT_DIGITSASNUMBERS, which orders
+ * names exactly like Explorer and StrCmpLogicalW. Elsewhere a portable key is used, so the
+ * core can be built and benchmarked on Linux (see Misc/native_bench).
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Sorted full paths packed into one buffer.
+ *
+ * Path i occupies Chars[Offsets[i] .. Offsets[i + 1]), without a terminator.
+ * Offsets therefore has Count() + 1 entries.
+ */
+template <typename CharT>
+struct PackedPathList
+{
+	std::vector<CharT>   Chars;
+	std::vector<int32_t> Offsets;
+
+	size_t Count() const { return Offsets.empty() ? 0 : Offsets.size() - 1; }
+};
+
+/// @brief Builds natural-sort keys: byte strings whose memcmp order is the natural order of the names.
+class NaturalSortKey
+{
+public:
+	/// @brief Appends the portable key for a name (UTF-16/32 code units or UTF-8 bytes) to `key`.
+	/// @details Case-insensitive for ASCII. Characters fall into three classes that sort in
+	///          the order punctuation < digits < everything else, matching the shell. A digit
+	///          run is encoded once as its significant-digit count followed by the digits, so
+	///          "9" < "10" and "007" == "7" (ties are broken by the caller).
+	template <typename CharT>
+	static void AppendPortable(const CharT* name, size_t length, std::string& key);
+};
+
+/// @brief Enumerates one folder, filters by extension and returns natural-sorted full paths.
+class DirectoryScanner
+{
+public:
+#ifdef _WIN32
+	using CharT = wchar_t;
+#else
+	using CharT = char;
+#endif
+	using String = std::basic_string<CharT>;
+
+	/// @brief Parses a comma- or semicolon-separated extension list (".jpg,.png") into the filter set.
+	void SetExtensions(const CharT* extensions);
+
+	/// @brief Scans `directory` and fills `out` with the sorted full paths of matching files.
+	/// @return false if the directory cannot be opened.
+	bool Scan(const String& directory, PackedPathList<CharT>& out) const;
+
+	/// @brief Sorts `names` naturally and packs `directory` + name for each into `out`.
+	/// @details Exposed separately so the sort can be benchmarked without touching the disk.
+	static void SortAndPack(const String& directory, const std::vector<String>& names, PackedPathList<CharT>& out);
+
+private:
+	bool Matches(const CharT* name, size_t length) const;
+
+	std::vector<String> extensions; // lower-case, including the dot
+};
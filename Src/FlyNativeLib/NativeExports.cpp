@@ -20,6 +20,7 @@
 #include "DllGlobals.h"
 #include "ShellContextMenu.h"
 #include "ShellProgramScanner.h"
+#include "DirectoryScanner.h"
 
 /**
  * @brief Implementation of the GetFileListFromExplorer exported function.
@@ -171,4 +172,55 @@ HRESULT GetUwpAppIcon(const wchar_t* aumid, SingleIconCallback callback)
     }
 
     return E_FAIL;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Implementation of the EnumerateImageFiles exported function.
+ * @details Enumerates, filters and natural-sorts the folder in DirectoryScanner, then copies
+ * the packed result into two plain arrays the caller can read without per-string marshalling.
+ */
+HRESULT EnumerateImageFiles(const wchar_t* directory, const wchar_t* extensions, PackedFileList* outList)
+{
+    if (!directory || !extensions || !outList)
+        return E_POINTER;
+    *outList = {};
+
+    try
+    {
+        DirectoryScanner scanner;
+        scanner.SetExtensions(extensions);
+
+        PackedPathList<wchar_t> packed;
+        if (!scanner.Scan(directory, packed))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        const size_t count = packed.Count();
+        outList->Offsets = new int32_t[count + 1];
+        std::copy(packed.Offsets.begin(), packed.Offsets.end(), outList->Offsets);
+        if (count == 0)
+            outList->Offsets[0] = 0;
+
+        outList->Chars = new wchar_t[packed.Chars.size() + 1];
+        std::copy(packed.Chars.begin(), packed.Chars.end(), outList->Chars);
+        outList->Chars[packed.Chars.size()] = L'\0';
+
+        outList->Count = static_cast<int32_t>(count);
+        outList->CharCount = static_cast<int32_t>(packed.Chars.size());
+        return S_OK;
+    }
+    catch (const std::bad_alloc&)
+    {
+        FreePackedFileList(outList);
+        return E_OUTOFMEMORY;
+    }
+}
+
+/// @brief Frees the buffers of a PackedFileList returned by EnumerateImageFiles.
+void FreePackedFileList(PackedFileList* list)
+{
+    if (!list)
+        return;
+    delete[] list->Chars;
+    delete[] list->Offsets;
+    *list = {};
+}
@@ -88,6 +88,27 @@ extern "C" {
     /// @return S_OK on success, or an error code.
     __declspec(dllexport) HRESULT GetUwpAppIcon(const wchar_t* aumid, SingleIconCallback callback);
 
+    /// @brief Sorted full paths returned by EnumerateImageFiles, packed into one buffer.
+    /// @details Path i is Chars[Offsets[i] .. Offsets[i + 1]) with no terminator; Offsets has Count + 1 entries.
+    struct PackedFileList
+    {
+        wchar_t* Chars;
+        int32_t* Offsets;
+        int32_t  Count;
+        int32_t  CharCount;
+    };
+
+    /// @brief Lists the files of a folder whose extension is in `extensions`, sorted in Explorer's natural order.
+    /// @param directory The folder to enumerate (not recursive).
+    /// @param extensions Comma- or semicolon-separated extensions, e.g. L".jpg,.png". Matched case-insensitively.
+    /// @param outList Receives the packed result. Must be released with FreePackedFileList().
+    /// @return S_OK on success, or an HRESULT error code if the folder cannot be read.
+    __declspec(dllexport) HRESULT EnumerateImageFiles(const wchar_t* directory, const wchar_t* extensions, PackedFileList* outList);
+
+    /// @brief Frees the buffers of a PackedFileList returned by EnumerateImageFiles.
+    /// @param list The list to free. Its fields are reset to zero.
+    __declspec(dllexport) void FreePackedFileList(PackedFileList* list);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "AnimatedAvifReader.h"
 #include "PixelBufferEncoder.h"
+#include "DecodeReport.h"
 #include "DllGlobals.h"
 
 /**
@@ -123,25 +124,81 @@ int AnimatedAvifReader::DecodeNextFrame(uint8_t* out_bgra_buffer) {
     }
 
     // Decode the next interleaved RGB frame into memory
-    heif_error err = heif_track_decode_next_image(track, &current_image, heif_colorspace_RGB, heif_chroma_interleaved_RGBA, nullptr);
+    heif_error err;
+    {
+        DecodeReportScope::StageTimer timer(&DecodeReport::decode_ns);
+        err = heif_track_decode_next_image(track, &current_image, heif_colorspace_RGB, heif_chroma_interleaved_RGBA, nullptr);
+    }
     if (err.code != 0 || !current_image) {
+        DecodeReportScope::Error(err.code, err.subcode);
         return 0; // EOF or decoding error
     }
-    
+    DecodeReportScope::Flag(DecodeReport_Animated);
+    DecodeReportScope::Output(width, height);
+
     // Copy/encode the frame's pixels to the out buffer for C#
-    PixelBufferEncoder::Encode(current_image, width, height, out_bgra_buffer);
+    {
+        DecodeReportScope::StageTimer timer(&DecodeReport::copy_ns);
+        PixelBufferEncoder::Encode(current_image, width, height, out_bgra_buffer);
+    }
 
     // Calculate the frame's exact display duration using the track timescale
-    uint32_t timescale = heif_track_get_timescale(track);
-    uint32_t duration_ticks = heif_image_get_duration(current_image);
+    current_frame_duration_ms = ToMilliseconds(heif_image_get_duration(current_image));
+
+    return current_frame_duration_ms;
+}
+
+/**
+ * @brief Converts a duration in track timescale ticks to milliseconds.
+ * @param duration_ticks The sample duration from the track.
+ * @return The duration in milliseconds, or 100 if the track has no timescale or the duration rounds to 0.
+ */
+int AnimatedAvifReader::ToMilliseconds(uint32_t duration_ticks) const {
+    uint32_t timescale = track ? heif_track_get_timescale(track) : 0;
     int duration_ms = 100;
-    
+
     if (timescale > 0) {
         duration_ms = static_cast<int>((static_cast<double>(duration_ticks) / timescale) * 1000.0);
     }
-    current_frame_duration_ms = duration_ms > 0 ? duration_ms : 100;
+    return duration_ms > 0 ? duration_ms : 100;
+}
 
-    return current_frame_duration_ms;
+/**
+ * @brief Walks the track's samples on a second context, reading only their durations.
+ *        Raw samples are the compressed data as stored, so nothing is decoded, and the
+ *        second context leaves the decode position of this one where it was.
+ * @param out_durations_ms Receives one duration per frame in milliseconds.
+ * @return True if the file has a sequence track, false otherwise.
+ */
+bool AnimatedAvifReader::ReadFrameDurations(std::vector<int>& out_durations_ms) const {
+    out_durations_ms.clear();
+    if (!track || !cached_data) return false;
+
+    std::shared_ptr<heif_context> walk_context(heif_context_alloc(), [](heif_context* c) { heif_context_free(c); });
+    heif_error err = heif_context_read_from_memory_without_copy(walk_context.get(), cached_data, cached_size, nullptr);
+    if (err.code != 0) return false;
+    heif_track* walk_track = heif_context_get_track(walk_context.get(), track_id);
+    if (!walk_track) return false;
+
+    heif_raw_sequence_sample* sample = nullptr;
+    while (heif_track_get_next_raw_sequence_sample(walk_track, &sample).code == 0 && sample) {
+        out_durations_ms.push_back(ToMilliseconds(heif_raw_sequence_sample_get_duration(sample)));
+        heif_raw_sequence_sample_release(sample);
+        sample = nullptr;
+    }
+    heif_track_release(walk_track);
+    return true;
+}
+
+/**
+ * @brief Reports the size of the decoded frame kept until the next decode or reset.
+ * @return The frame's interleaved plane size in bytes, or 0 if no frame is held.
+ */
+size_t AnimatedAvifReader::HeldImageBytes() const {
+    if (!current_image) return 0;
+    int stride = 0;
+    if (!heif_image_get_plane_readonly(current_image, heif_channel_interleaved, &stride)) return 0;
+    return static_cast<size_t>(stride) * height;
 }
 
 /**
@@ -57,6 +57,19 @@ public:
      */
     void Reset();
 
+    /**
+     * @brief Reads the duration of every sample in the track without decoding any of them.
+     * @param out_durations_ms Receives one duration per frame, in milliseconds, as DecodeNextFrame() would return them.
+     * @return false if the file has no sequence track. The decode position is not changed.
+     */
+    bool ReadFrameDurations(std::vector<int>& out_durations_ms) const;
+
+    /**
+     * @brief Gets the size of the decoded frame the reader holds on to between calls.
+     * @return Bytes of the most recent frame's pixels, or 0 if none is held.
+     */
+    size_t HeldImageBytes() const;
+
 private:
     /// @brief Shared pointer to the libheif context managing the file data.
     std::shared_ptr<heif_context> context;
@@ -84,6 +97,9 @@ private:
 
     /// @brief Cached size of the raw file bytes.
     size_t cached_size = 0;
+
+    /// @brief Converts a sample duration in track timescale ticks to milliseconds, 100 if it is zero.
+    int ToMilliseconds(uint32_t duration_ticks) const;
 };
 
 #endif // ANIMATED_AVIF_READER_H
@@ -0,0 +1,51 @@
+/**
+ * @file AnimationSource.cpp
+ * @brief Implements the format-independent part of IAnimationSource.
+ */
+
+#include "AnimationSource.h"
+#include "ImageProbe.h"
+
+#include <cstring>
+
+/**
+ * @brief The signatures ImageProbe checks. An ISOBMFF file is AVIF if its ftyp lists an AVIF
+ *        brand, and HEIF otherwise; both are played by AvifAnimationSource.
+ */
+int32_t SniffAnimationFormat(const uint8_t* data, size_t size) {
+    if (!data || size < 12) return static_cast<int32_t>(ImageFormat::Unknown);
+    if (std::memcmp(data, "GIF87a", 6) == 0 || std::memcmp(data, "GIF89a", 6) == 0) {
+        return static_cast<int32_t>(ImageFormat::Gif);
+    }
+    if (std::memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) return static_cast<int32_t>(ImageFormat::Png);
+    if (std::memcmp(data, "RIFF", 4) == 0 && std::memcmp(data + 8, "WEBP", 4) == 0) return static_cast<int32_t>(ImageFormat::WebP);
+    if (std::memcmp(data + 4, "ftyp", 4) == 0) {
+        const size_t box_size = std::min<size_t>(size, (static_cast<size_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3]);
+        for (size_t brand = 8; brand + 4 <= box_size; brand += 4) {
+            if (brand == 12) continue; // minor_version
+            if (std::memcmp(data + brand, "avif", 4) == 0 || std::memcmp(data + brand, "avis", 4) == 0) {
+                return static_cast<int32_t>(ImageFormat::Avif);
+            }
+        }
+        return static_cast<int32_t>(ImageFormat::Heif);
+    }
+    return static_cast<int32_t>(ImageFormat::Unknown);
+}
+
+bool IAnimationSource::DecodeInto(int32_t index, const AnimationRing& ring, int32_t slot, FrameRect& dirty) {
+    dirty = FrameRect{};
+    const size_t canvas_bytes = static_cast<size_t>(Info().height) * Stride();
+    if (!ring.slots || slot < 0 || slot >= ring.slot_count || ring.slot_size < 0 ||
+        static_cast<uint64_t>(ring.slot_size) < canvas_bytes) {
+        return false;
+    }
+    if (!RenderTo(index, dirty)) return false;
+
+    uint8_t* out = ring.slots + static_cast<size_t>(slot) * static_cast<size_t>(ring.slot_size);
+    const size_t row_bytes = static_cast<size_t>(dirty.width) * 4;
+    for (int32_t y = 0; y < dirty.height; ++y) {
+        std::memcpy(out + y * row_bytes, Pixels() + static_cast<size_t>(dirty.y + y) * Stride() + static_cast<size_t>(dirty.x) * 4,
+                    row_bytes);
+    }
+    return true;
+}
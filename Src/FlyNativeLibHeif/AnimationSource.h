@@ -0,0 +1,159 @@
+/**
+ * @file AnimationSource.h
+ * @brief Declares IAnimationSource, the one interface every animated format is played through.
+ *
+ * GIF, APNG, WebP and AVIF each have a decoder with its own frame fields and seek rules. The
+ * viewer needs the same few things from all of them, so each is wrapped in an IAnimationSource:
+ *
+ * - A frame table in one shape (rectangle, delay, key frame), read when the source is opened.
+ * - RenderTo(), which brings a premultiplied BGRA canvas to a frame, replaying from the nearest
+ *   key frame on a seek, and reports the rectangle that changed.
+ * - DecodeInto(), which renders a frame and copies the changed rectangle into one slot of a
+ *   caller-owned ring, so decoding can run ahead of display without a buffer per frame.
+ * - Stats(), the memory held and frames decoded, counted the same way for every format.
+ *
+ * CompositorSource adapts the GIF, APNG and WebP compositors. AVIF goes through libheif and is
+ * AvifAnimationSource, declared separately because it needs the libheif headers.
+ *
+ * Not thread-safe. This file does not include pch.h and must build without Windows headers
+ * on other platforms.
+ */
+
+#pragma once
+#ifndef ANIMATION_SOURCE_H
+#define ANIMATION_SOURCE_H
+
+#include "ApngCompositor.h"
+#include "FrameRect.h"
+#include "GifCompositor.h"
+#include "WebpCompositor.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief The animation as a whole. Blittable for P/Invoke.
+struct AnimationInfo {
+    int32_t width;                      ///< Canvas size.
+    int32_t height;
+    int32_t frame_count;
+    int32_t loop_count;                 ///< As the file stores it: 0 loops forever; GIF without a loop extension is -1.
+    int64_t duration_ms;                ///< Sum of the frame delays.
+    int32_t format;                     ///< The ImageFormat of the container.
+    int32_t reserved;
+};
+
+/// @brief One frame, in the terms every format shares. Blittable for P/Invoke.
+struct AnimationFrameInfo {
+    int32_t x;                          ///< The rectangle the frame draws, clipped to the canvas.
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    int32_t delay_ms;                   ///< Display time, with each format's minimum already applied.
+    int32_t key_frame;                  ///< 1 if a seek to this frame or later need not replay the frames before it.
+};
+
+/// @brief A caller-owned ring of equal slots that DecodeInto() writes changed rectangles into. Blittable for P/Invoke.
+struct AnimationRing {
+    uint8_t* slots;                     ///< `slot_count * slot_size` bytes.
+    int64_t slot_size;                  ///< At least the canvas, `width * height * 4` bytes.
+    int32_t slot_count;
+    int32_t reserved;
+};
+
+/// @brief What a source holds and has done, counted alike for every format. Blittable for P/Invoke.
+struct AnimationStats {
+    int64_t source_bytes;               ///< The file data read from; owned by the caller.
+    int64_t canvas_bytes;
+    int64_t scratch_bytes;              ///< Frame table and buffers kept between frames, besides the canvas.
+    int64_t frames_decoded;             ///< Frames decoded since Open(), replays after a seek included.
+};
+
+/// @brief An animation decoded onto one premultiplied BGRA canvas.
+class IAnimationSource {
+public:
+    virtual ~IAnimationSource() = default;
+
+    /// @brief Parses the file and reads its frame table. `data` must outlive the source.
+    /// @return false if the data is not an animation this source can play.
+    virtual bool Open(const uint8_t* data, size_t size) = 0;
+
+    virtual const AnimationInfo& Info() const = 0;
+    virtual const AnimationFrameInfo& Frame(int32_t index) const = 0;
+
+    /// @brief Brings the canvas to the state after frame `index` was drawn.
+    /// @param dirty Receives the rectangle that changed; empty if nothing did.
+    /// @return false if `index` is out of range or the frame could not be decoded.
+    virtual bool RenderTo(int32_t index, FrameRect& dirty) = 0;
+
+    /// @brief Premultiplied BGRA pixels of the canvas, `Stride()` bytes per row.
+    virtual const uint8_t* Pixels() const = 0;
+
+    virtual AnimationStats Stats() const = 0;
+
+    size_t Stride() const { return static_cast<size_t>(Info().width) * 4; }
+
+    /// @brief Renders frame `index` and copies the rectangle that changed into slot `slot` of
+    ///        `ring`, packed (`dirty.width * 4` bytes per row).
+    /// @return false if the slot is out of range or too small, or RenderTo() fails.
+    bool DecodeInto(int32_t index, const AnimationRing& ring, int32_t slot, FrameRect& dirty);
+};
+
+/// @brief IAnimationSource over one of the GIF, APNG and WebP compositors, which share their shape.
+template <class Compositor>
+class CompositorSource final : public IAnimationSource {
+public:
+    /// @param format The ImageFormat reported in Info().
+    explicit CompositorSource(int32_t format) { info_.format = format; }
+
+    bool Open(const uint8_t* data, size_t size) override {
+        if (!compositor_.Open(data, size)) return false;
+        const auto& info = compositor_.Decoder().Info();
+        info_.width = info.width;
+        info_.height = info.height;
+        info_.frame_count = info.frame_count;
+        info_.loop_count = info.loop_count;
+        info_.duration_ms = info.duration_ms;
+        frames_.resize(static_cast<size_t>(info.frame_count));
+        for (int32_t i = 0; i < info.frame_count; ++i) {
+            const auto& frame = compositor_.Decoder().Frame(i);
+            const int32_t x = std::min(frame.x, info.width);
+            const int32_t y = std::min(frame.y, info.height);
+            frames_[i] = AnimationFrameInfo{x, y, std::min(frame.width, info.width - x), std::min(frame.height, info.height - y),
+                                            frame.delay_ms, compositor_.IsKeyFrame(i) ? 1 : 0};
+        }
+        source_bytes_ = size;
+        return true;
+    }
+
+    const AnimationInfo& Info() const override { return info_; }
+    const AnimationFrameInfo& Frame(int32_t index) const override { return frames_[index]; }
+    bool RenderTo(int32_t index, FrameRect& dirty) override { return compositor_.RenderTo(index, dirty); }
+    const uint8_t* Pixels() const override { return compositor_.Pixels(); }
+
+    AnimationStats Stats() const override {
+        return AnimationStats{static_cast<int64_t>(source_bytes_), static_cast<int64_t>(compositor_.Height() * compositor_.Stride()),
+                              static_cast<int64_t>(compositor_.ScratchBytes() + frames_.capacity() * sizeof(AnimationFrameInfo)),
+                              compositor_.FramesDrawn()};
+    }
+
+    /// @brief The wrapped compositor, e.g. to select its kernels.
+    Compositor& Inner() { return compositor_; }
+
+private:
+    Compositor compositor_;
+    AnimationInfo info_{};
+    std::vector<AnimationFrameInfo> frames_;
+    size_t source_bytes_ = 0;
+};
+
+/// @brief Identifies the container from its signature: Gif, Png, WebP, Avif or Heif.
+/// @return An ImageFormat value; Unknown for anything else.
+int32_t SniffAnimationFormat(const uint8_t* data, size_t size);
+
+using GifAnimationSource = CompositorSource<GifCompositor>;
+using ApngAnimationSource = CompositorSource<ApngCompositor>;
+using WebpAnimationSource = CompositorSource<WebpCompositor>;
+
+#endif // ANIMATION_SOURCE_H
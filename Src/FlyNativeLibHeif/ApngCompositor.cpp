@@ -0,0 +1,165 @@
+/**
+ * @file ApngCompositor.cpp
+ * @brief Implements ApngCompositor.
+ */
+
+#include "ApngCompositor.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    /// Premultiplied source-over: each channel is src + dst * (255 - src alpha) / 255.
+    void BlendOverRow(const uint32_t* src, int32_t count, uint32_t* dst) {
+        for (int32_t i = 0; i < count; ++i) {
+            const uint32_t s = src[i];
+            const uint32_t alpha = s >> 24;
+            if (alpha == 255) {
+                dst[i] = s;
+            } else if (alpha != 0) {
+                const uint32_t keep = 255 - alpha;
+                const uint32_t d = dst[i];
+                uint32_t out = 0;
+                for (int shift = 0; shift < 32; shift += 8) {
+                    const uint32_t v = ((d >> shift) & 0xFF) * keep + 128;
+                    out |= (((s >> shift) & 0xFF) + ((v + (v >> 8)) >> 8)) << shift;
+                }
+                dst[i] = out;
+            }
+        }
+    }
+}
+
+bool ApngCompositor::Open(const uint8_t* data, size_t size) {
+    if (!decoder_.Open(data, size)) return false;
+    canvas_.assign(static_cast<size_t>(Width()) * Height(), 0);
+    MarkKeyFrames();
+    current_ = -1;
+    previous_rect_ = FrameRect{};
+    previous_dispose_ = 0;
+    frames_drawn_ = 0;
+    return true;
+}
+
+void ApngCompositor::Reset() {
+    std::fill(canvas_.begin(), canvas_.end(), 0u);
+    current_ = -1;
+    previous_rect_ = FrameRect{};
+    previous_dispose_ = 0;
+}
+
+/**
+ * @brief Only source-blended frames count as covering the canvas: an over-blended frame may
+ *        have see-through pixels, and telling would mean decoding it.
+ */
+void ApngCompositor::MarkKeyFrames() {
+    const int32_t count = decoder_.FrameCount();
+    const auto covers_canvas = [this](const ApngFrameInfo& frame) {
+        const FrameRect rect = Clip(frame);
+        return rect.x == 0 && rect.y == 0 && rect.width == Width() && rect.height == Height();
+    };
+    key_frames_.assign(static_cast<size_t>(count), 0);
+    for (int32_t i = 0; i < count; ++i) {
+        const ApngFrameInfo& frame = decoder_.Frame(i);
+        if (i == 0) {
+            key_frames_[i] = 1;
+            continue;
+        }
+        const ApngFrameInfo& previous = decoder_.Frame(i - 1);
+        const bool covers = covers_canvas(frame) && frame.blend_op == static_cast<int32_t>(ApngBlend::Source) &&
+                            frame.dispose_op != static_cast<int32_t>(ApngDispose::Previous);
+        const bool cleared = previous.dispose_op == static_cast<int32_t>(ApngDispose::Background) && covers_canvas(previous);
+        key_frames_[i] = covers || cleared ? 1 : 0;
+    }
+}
+
+bool ApngCompositor::RenderTo(int32_t index, FrameRect& dirty) {
+    dirty = FrameRect{};
+    if (index < 0 || index >= decoder_.FrameCount()) return false;
+
+    int32_t key = index;
+    while (key > 0 && !key_frames_[key]) --key;
+    if (index < current_ || key > current_ + 1) {
+        Reset();
+        current_ = key - 1;
+        dirty = FrameRect{0, 0, Width(), Height()};
+    }
+    while (current_ < index) DrawNext(dirty);
+    return true;
+}
+
+/**
+ * @brief As for GIF, the previous frame's dispose op is applied first and a dispose-to-previous
+ *        frame saves its rectangle as it is after that.
+ */
+void ApngCompositor::DrawNext(FrameRect& dirty) {
+    const int32_t index = current_ + 1;
+    const ApngFrameInfo& frame = decoder_.Frame(index);
+
+    if (previous_dispose_ == static_cast<int32_t>(ApngDispose::Background)) {
+        Fill(previous_rect_, 0);
+        dirty.Unite(previous_rect_);
+    } else if (previous_dispose_ == static_cast<int32_t>(ApngDispose::Previous) && !previous_rect_.Empty()) {
+        const FrameRect& r = previous_rect_;
+        for (int32_t y = 0; y < r.height; ++y) {
+            std::memcpy(canvas_.data() + static_cast<size_t>(r.y + y) * Width() + r.x,
+                        saved_.data() + static_cast<size_t>(y) * r.width, static_cast<size_t>(r.width) * 4);
+        }
+        dirty.Unite(r);
+    }
+
+    const FrameRect rect = Clip(frame);
+    if (frame.dispose_op == static_cast<int32_t>(ApngDispose::Previous) && !rect.Empty()) {
+        saved_.resize(static_cast<size_t>(rect.width) * rect.height);
+        for (int32_t y = 0; y < rect.height; ++y) {
+            std::memcpy(saved_.data() + static_cast<size_t>(y) * rect.width,
+                        canvas_.data() + static_cast<size_t>(rect.y + y) * Width() + rect.x,
+                        static_cast<size_t>(rect.width) * 4);
+        }
+    }
+
+    if (!rect.Empty()) {
+        frame_.resize(static_cast<size_t>(frame.width) * frame.height);
+        decoder_.DecodeFrame(index, frame_.data());
+        const bool over = frame.blend_op == static_cast<int32_t>(ApngBlend::Over);
+        for (int32_t y = 0; y < rect.height; ++y) {
+            const uint32_t* src = frame_.data() + static_cast<size_t>(y) * frame.width;
+            uint32_t* dst = canvas_.data() + static_cast<size_t>(rect.y + y) * Width() + rect.x;
+            if (over) {
+                BlendOverRow(src, rect.width, dst);
+            } else {
+                std::memcpy(dst, src, static_cast<size_t>(rect.width) * 4);
+            }
+        }
+        dirty.Unite(rect);
+    }
+
+    previous_rect_ = rect;
+    previous_dispose_ = frame.dispose_op;
+    current_ = index;
+    ++frames_drawn_;
+}
+
+void ApngCompositor::Fill(const FrameRect& rect, uint32_t value) {
+    for (int32_t y = 0; y < rect.height; ++y) {
+        uint32_t* row = canvas_.data() + static_cast<size_t>(rect.y + y) * Width() + rect.x;
+        std::fill(row, row + rect.width, value);
+    }
+}
+
+FrameRect ApngCompositor::Clip(const ApngFrameInfo& frame) const {
+    const int32_t x0 = std::min(frame.x, Width());
+    const int32_t y0 = std::min(frame.y, Height());
+    const int32_t x1 = static_cast<int32_t>(std::min<int64_t>(static_cast<int64_t>(frame.x) + frame.width, Width()));
+    const int32_t y1 = static_cast<int32_t>(std::min<int64_t>(static_cast<int64_t>(frame.y) + frame.height, Height()));
+    return FrameRect{x0, y0, x1 - x0, y1 - y0};
+}
+
+void ApngCompositor::CopyRect(const FrameRect& rect, uint8_t* out) const {
+    const size_t row_bytes = static_cast<size_t>(rect.width) * 4;
+    for (int32_t y = 0; y < rect.height; ++y) {
+        std::memcpy(out + y * row_bytes, Pixels() + static_cast<size_t>(rect.y + y) * Stride() + static_cast<size_t>(rect.x) * 4,
+                    row_bytes);
+    }
+}
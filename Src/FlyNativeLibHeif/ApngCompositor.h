@@ -0,0 +1,88 @@
+/**
+ * @file ApngCompositor.h
+ * @brief Declares ApngCompositor, which plays an APNG's frames onto one BGRA canvas.
+ *
+ * Like GIF, APNG frames are patches with a disposal rule; they also say whether they replace
+ * the pixels under them or blend over them. ApngCompositor keeps the canvas in memory and
+ * applies both on the CPU, so the renderer only uploads what changed:
+ *
+ * - RenderTo() draws every frame from the current one up to the requested one, applying the
+ *   dispose and blend ops in between, and reports the union of the rectangles it touched.
+ * - A seek backwards, or forwards past a key frame, clears the canvas and replays from the
+ *   nearest key frame at or before the target; a loop restart replays from the first frame.
+ * - Dispose-to-previous saves only the rectangle of the frame that asks for it.
+ *
+ * Not thread-safe. This file does not include pch.h and must build without Windows headers
+ * on other platforms.
+ */
+
+#pragma once
+#ifndef APNG_COMPOSITOR_H
+#define APNG_COMPOSITOR_H
+
+#include "ApngDecoder.h"
+#include "FrameRect.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief An APNG decoder and the canvas its frames are composited onto.
+class ApngCompositor {
+public:
+    /// @brief Parses the APNG and allocates a transparent canvas. `data` must outlive the compositor.
+    bool Open(const uint8_t* data, size_t size);
+
+    ApngDecoder& Decoder() { return decoder_; }
+    const ApngDecoder& Decoder() const { return decoder_; }
+    int32_t Width() const { return decoder_.Info().width; }
+    int32_t Height() const { return decoder_.Info().height; }
+    size_t Stride() const { return static_cast<size_t>(Width()) * 4; }
+
+    /// @brief Premultiplied BGRA pixels of the canvas, `Stride()` bytes per row.
+    const uint8_t* Pixels() const { return reinterpret_cast<const uint8_t*>(canvas_.data()); }
+
+    /// @brief The last frame drawn, or -1 if the canvas is clear.
+    int32_t Current() const { return current_; }
+
+    /// @brief Brings the canvas to the state after frame `index` was drawn.
+    /// @param dirty Receives the union of the rectangles that changed; empty if none did.
+    /// @return false if `index` is out of range.
+    bool RenderTo(int32_t index, FrameRect& dirty);
+
+    /// @brief Clears the canvas, as before the first frame.
+    void Reset();
+
+    /// @brief Copies rectangle `rect` of the canvas into `out`, packed (`rect.width * 4` bytes per row).
+    void CopyRect(const FrameRect& rect, uint8_t* out) const;
+
+    /// @brief True if the canvas after frame `index` does not depend on the frames before it:
+    ///        the frame replaces the whole canvas and does not dispose to previous, or the frame
+    ///        before it cleared the whole canvas.
+    bool IsKeyFrame(int32_t index) const { return key_frames_[index] != 0; }
+
+    /// @brief Frames drawn since Open(), replays included.
+    int64_t FramesDrawn() const { return frames_drawn_; }
+
+    /// @brief Bytes held between frames besides the canvas: saved rectangles and decode buffers.
+    size_t ScratchBytes() const { return (saved_.capacity() + frame_.capacity()) * 4 + decoder_.ScratchBytes(); }
+
+private:
+    void DrawNext(FrameRect& dirty);
+    void MarkKeyFrames();
+    void Fill(const FrameRect& rect, uint32_t value);
+    FrameRect Clip(const ApngFrameInfo& frame) const;
+
+    ApngDecoder decoder_;
+    std::vector<uint32_t> canvas_;
+    std::vector<uint32_t> saved_;       // The rectangle under a dispose-to-previous frame.
+    std::vector<uint32_t> frame_;       // The frame being drawn, decoded.
+    std::vector<uint8_t> key_frames_;
+
+    int32_t current_ = -1;
+    FrameRect previous_rect_{};
+    int32_t previous_dispose_ = 0;
+    int64_t frames_drawn_ = 0;
+};
+
+#endif // APNG_COMPOSITOR_H
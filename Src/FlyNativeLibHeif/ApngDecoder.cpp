@@ -0,0 +1,499 @@
+/**
+ * @file ApngDecoder.cpp
+ * @brief Implements ApngDecoder.
+ */
+
+#include "ApngDecoder.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+
+#ifdef _MSC_VER
+#ifdef _DEBUG
+#pragma comment(lib, "zlibd.lib")
+#else
+#pragma comment(lib, "zlib.lib")
+#endif
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLY_APNG_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    uint32_t Read32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    uint16_t Read16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+
+    bool IsType(const uint8_t* p, const char* type) { return std::memcmp(p, type, 4) == 0; }
+
+    /// round(c * a / 255) without a division.
+    inline uint32_t Premultiply(uint32_t c, uint32_t a) {
+        const uint32_t v = c * a + 128;
+        return (v + (v >> 8)) >> 8;
+    }
+
+    inline uint32_t Pack(uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+        if (a == 255) return 0xFF000000u | (r << 16) | (g << 8) | b;
+        if (a == 0) return 0;
+        return (a << 24) | (Premultiply(r, a) << 16) | (Premultiply(g, a) << 8) | Premultiply(b, a);
+    }
+
+    // --- Scalar unfilter kernels ---
+
+    void UnfilterNone(uint8_t*, const uint8_t*, size_t, size_t) {}
+
+    void UnfilterSub(uint8_t* row, const uint8_t*, size_t length, size_t bpp) {
+        for (size_t i = bpp; i < length; ++i) row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+    }
+
+    void UnfilterUp(uint8_t* row, const uint8_t* prev, size_t length, size_t) {
+        for (size_t i = 0; i < length; ++i) row[i] = static_cast<uint8_t>(row[i] + prev[i]);
+    }
+
+    void UnfilterAvg(uint8_t* row, const uint8_t* prev, size_t length, size_t bpp) {
+        const size_t head = std::min(bpp, length);
+        for (size_t i = 0; i < head; ++i) row[i] = static_cast<uint8_t>(row[i] + (prev[i] >> 1));
+        for (size_t i = head; i < length; ++i) row[i] = static_cast<uint8_t>(row[i] + ((row[i - bpp] + prev[i]) >> 1));
+    }
+
+    void UnfilterPaeth(uint8_t* row, const uint8_t* prev, size_t length, size_t bpp) {
+        const size_t head = std::min(bpp, length);
+        for (size_t i = 0; i < head; ++i) row[i] = static_cast<uint8_t>(row[i] + prev[i]);
+        for (size_t i = head; i < length; ++i) {
+            const int a = row[i - bpp];
+            const int b = prev[i];
+            const int c = prev[i - bpp];
+            const int pa = std::abs(b - c);
+            const int pb = std::abs(a - c);
+            const int pc = std::abs(a + b - 2 * c);
+            const int predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+            row[i] = static_cast<uint8_t>(row[i] + predictor);
+        }
+    }
+
+#ifdef FLY_APNG_SSE2
+    // --- SSE2 unfilter kernels ---
+    // Sub, Avg and Paeth carry a dependency from each pixel to the next, so these process one
+    // whole 3- or 4-byte pixel per step with all its channels in one register. Up has no such
+    // dependency and runs 16 bytes at a time for any pixel size.
+
+    // A 3-byte memcpy into an int goes through the stack and stalls on the 4-byte reload, so
+    // 3-byte pixels are assembled from a 2-byte and a 1-byte access instead.
+    template <size_t Bpp>
+    inline __m128i LoadPixel(const uint8_t* p) {
+        uint32_t v;
+        if constexpr (Bpp == 4) {
+            std::memcpy(&v, p, 4);
+        } else {
+            uint16_t low;
+            std::memcpy(&low, p, 2);
+            v = low | (static_cast<uint32_t>(p[2]) << 16);
+        }
+        return _mm_cvtsi32_si128(static_cast<int>(v));
+    }
+
+    template <size_t Bpp>
+    inline void StorePixel(uint8_t* p, __m128i v) {
+        const uint32_t bits = static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+        if constexpr (Bpp == 4) {
+            std::memcpy(p, &bits, 4);
+        } else {
+            const uint16_t low = static_cast<uint16_t>(bits);
+            std::memcpy(p, &low, 2);
+            p[2] = static_cast<uint8_t>(bits >> 16);
+        }
+    }
+
+    void UnfilterUpSse2(uint8_t* row, const uint8_t* prev, size_t length, size_t bpp) {
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_add_epi8(x, b));
+        }
+        UnfilterUp(row + i, prev + i, length - i, bpp);
+    }
+
+    template <size_t Bpp>
+    void UnfilterSubSse2(uint8_t* row, const uint8_t*, size_t length, size_t) {
+        __m128i a = _mm_setzero_si128();
+        for (size_t i = 0; i + Bpp <= length; i += Bpp) {
+            a = _mm_add_epi8(LoadPixel<Bpp>(row + i), a);
+            StorePixel<Bpp>(row + i, a);
+        }
+    }
+
+    template <size_t Bpp>
+    void UnfilterAvgSse2(uint8_t* row, const uint8_t* prev, size_t length, size_t) {
+        const __m128i one = _mm_set1_epi8(1);
+        __m128i a = _mm_setzero_si128();
+        for (size_t i = 0; i + Bpp <= length; i += Bpp) {
+            const __m128i b = LoadPixel<Bpp>(prev + i);
+            // _mm_avg_epu8 rounds up; PNG's average rounds down.
+            const __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+            a = _mm_add_epi8(LoadPixel<Bpp>(row + i), avg);
+            StorePixel<Bpp>(row + i, a);
+        }
+    }
+
+    inline __m128i Abs16(__m128i x) { return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x)); }
+
+    inline __m128i Select(__m128i mask, __m128i a, __m128i b) {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    /// Channels are widened to 16 bits so the predictor distances cannot overflow.
+    template <size_t Bpp>
+    void UnfilterPaethSse2(uint8_t* row, const uint8_t* prev, size_t length, size_t) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i a = zero;
+        __m128i c = zero;
+        for (size_t i = 0; i + Bpp <= length; i += Bpp) {
+            const __m128i b = _mm_unpacklo_epi8(LoadPixel<Bpp>(prev + i), zero);
+            const __m128i pa = Abs16(_mm_sub_epi16(b, c));
+            const __m128i pb = Abs16(_mm_sub_epi16(a, c));
+            const __m128i pc = Abs16(_mm_sub_epi16(_mm_add_epi16(a, b), _mm_add_epi16(c, c)));
+            const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            const __m128i predictor = Select(_mm_cmpeq_epi16(smallest, pa), a,
+                                             Select(_mm_cmpeq_epi16(smallest, pb), b, c));
+            const __m128i x = _mm_add_epi8(LoadPixel<Bpp>(row + i), _mm_packus_epi16(predictor, predictor));
+            StorePixel<Bpp>(row + i, x);
+            a = _mm_unpacklo_epi8(x, zero);
+            c = b;
+        }
+    }
+#endif
+
+    constexpr int32_t kAdam7[7][4] = {
+        {0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2},
+    };
+}
+
+ApngDecoder::ApngDecoder() {
+    auto stream = new z_stream{};
+    if (inflateInit(stream) != Z_OK) {
+        delete stream;
+        stream = nullptr;
+    }
+    zstream_ = stream;
+    SetSimd(true);
+}
+
+ApngDecoder::~ApngDecoder() {
+    if (zstream_) {
+        inflateEnd(static_cast<z_stream*>(zstream_));
+        delete static_cast<z_stream*>(zstream_);
+    }
+}
+
+void ApngDecoder::SetSimd(bool enabled) {
+    const UnfilterFn scalar[5] = {&UnfilterNone, &UnfilterSub, &UnfilterUp, &UnfilterAvg, &UnfilterPaeth};
+    std::copy(scalar, scalar + 5, unfilter_);
+    std::copy(scalar, scalar + 5, unfilter3_);
+    std::copy(scalar, scalar + 5, unfilter4_);
+#ifdef FLY_APNG_SSE2
+    if (enabled && CpuFeatures::Level() >= SimdLevel::Sse2) {
+        unfilter_[2] = unfilter3_[2] = unfilter4_[2] = &UnfilterUpSse2;
+        unfilter3_[1] = &UnfilterSubSse2<3>;
+        unfilter3_[3] = &UnfilterAvgSse2<3>;
+        unfilter3_[4] = &UnfilterPaethSse2<3>;
+        unfilter4_[1] = &UnfilterSubSse2<4>;
+        unfilter4_[3] = &UnfilterAvgSse2<4>;
+        unfilter4_[4] = &UnfilterPaethSse2<4>;
+    }
+#else
+    (void)enabled;
+#endif
+}
+
+ApngDecoder::UnfilterFn ApngDecoder::Unfilter(int filter, size_t bpp) const {
+    if (bpp == 3) return unfilter3_[filter];
+    if (bpp == 4) return unfilter4_[filter];
+    return unfilter_[filter];
+}
+
+/**
+ * @brief Chunks are walked without checking their CRCs. IDAT before the first fcTL is the
+ *        hidden default image unless no fcTL follows; IDAT after it belongs to the first frame.
+ */
+bool ApngDecoder::Open(const uint8_t* data, size_t size) {
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+
+    data_ = data;
+    size_ = size;
+    info_ = ApngInfo{};
+    frames_.clear();
+    has_key_ = false;
+    if (!zstream_ || !data || size < 8 || std::memcmp(data, kSignature, 8) != 0) return false;
+
+    bool have_header = false;
+    size_t palette_offset = 0;
+    size_t palette_size = 0;
+    size_t trns_offset = 0;
+    size_t trns_size = 0;
+    std::vector<Segment> default_image;
+
+    size_t pos = 8;
+    while (pos + 8 <= size) {
+        const size_t length = Read32(data + pos);
+        const uint8_t* type = data + pos + 4;
+        const size_t body = pos + 8;
+        if (length > size - body) break;
+        const uint8_t* p = data + body;
+        pos = body + length + 4;
+
+        if (IsType(type, "IHDR") && length >= 13) {
+            info_.width = static_cast<int32_t>(std::min<uint32_t>(Read32(p), INT32_MAX));
+            info_.height = static_cast<int32_t>(std::min<uint32_t>(Read32(p + 4), INT32_MAX));
+            bit_depth_ = p[8];
+            color_type_ = p[9];
+            interlaced_ = p[12] == 1;
+            have_header = p[10] == 0 && p[11] == 0 && p[12] <= 1;
+        } else if (IsType(type, "PLTE")) {
+            palette_offset = body;
+            palette_size = std::min<size_t>(length / 3, 256);
+        } else if (IsType(type, "tRNS")) {
+            trns_offset = body;
+            trns_size = length;
+        } else if (IsType(type, "acTL") && length >= 8) {
+            info_.loop_count = static_cast<int32_t>(std::min<uint32_t>(Read32(p + 4), INT32_MAX));
+        } else if (IsType(type, "fcTL") && length >= 26) {
+            FrameData frame{};
+            frame.sequence = Read32(p);
+            frame.info.width = static_cast<int32_t>(std::min<uint32_t>(Read32(p + 4), INT32_MAX));
+            frame.info.height = static_cast<int32_t>(std::min<uint32_t>(Read32(p + 8), INT32_MAX));
+            frame.info.x = static_cast<int32_t>(std::min<uint32_t>(Read32(p + 12), INT32_MAX));
+            frame.info.y = static_cast<int32_t>(std::min<uint32_t>(Read32(p + 16), INT32_MAX));
+            const uint32_t delay_num = Read16(p + 20);
+            const uint32_t delay_den = Read16(p + 22) == 0 ? 100 : Read16(p + 22);
+            frame.info.delay_ms = delay_num == 0 ? 100 : static_cast<int32_t>((delay_num * 1000 + delay_den / 2) / delay_den);
+            frame.info.dispose_op = p[24] <= 2 ? p[24] : 0;
+            frame.info.blend_op = p[25] <= 1 ? p[25] : 0;
+            frames_.push_back(std::move(frame));
+        } else if (IsType(type, "IDAT")) {
+            (frames_.empty() ? default_image : frames_.back().segments).push_back(Segment{body, length});
+        } else if (IsType(type, "fdAT") && length > 4 && !frames_.empty()) {
+            frames_.back().segments.push_back(Segment{body + 4, length - 4});
+        } else if (IsType(type, "IEND")) {
+            break;
+        }
+    }
+
+    bool valid_depth = false;
+    switch (color_type_) {
+    case 0: valid_depth = bit_depth_ == 1 || bit_depth_ == 2 || bit_depth_ == 4 || bit_depth_ == 8 || bit_depth_ == 16; channels_ = 1; break;
+    case 2: valid_depth = bit_depth_ == 8 || bit_depth_ == 16; channels_ = 3; break;
+    case 3: valid_depth = (bit_depth_ == 1 || bit_depth_ == 2 || bit_depth_ == 4 || bit_depth_ == 8) && palette_size > 0; channels_ = 1; break;
+    case 4: valid_depth = bit_depth_ == 8 || bit_depth_ == 16; channels_ = 2; break;
+    case 6: valid_depth = bit_depth_ == 8 || bit_depth_ == 16; channels_ = 4; break;
+    default: break;
+    }
+    const int64_t canvas = static_cast<int64_t>(info_.width) * info_.height;
+    if (!have_header || !valid_depth || canvas == 0 || canvas > kMaxPixels) {
+        frames_.clear();
+        return false;
+    }
+    bpp_ = std::max<size_t>(1, static_cast<size_t>(channels_ * bit_depth_) / 8);
+
+    // A plain PNG, or an APNG whose frames were all lost, shows its IDAT image.
+    if (frames_.empty() && !default_image.empty()) {
+        FrameData frame{};
+        frame.info.width = info_.width;
+        frame.info.height = info_.height;
+        frame.info.delay_ms = 100;
+        frame.segments = std::move(default_image);
+        frames_.push_back(std::move(frame));
+    }
+
+    std::stable_sort(frames_.begin(), frames_.end(),
+                     [](const FrameData& a, const FrameData& b) { return a.sequence < b.sequence; });
+    // Frames must lie within the canvas.
+    frames_.erase(std::remove_if(frames_.begin(), frames_.end(),
+                                 [this](const FrameData& f) {
+                                     return f.segments.empty() || f.info.width == 0 || f.info.height == 0 ||
+                                            static_cast<int64_t>(f.info.x) + f.info.width > info_.width ||
+                                            static_cast<int64_t>(f.info.y) + f.info.height > info_.height;
+                                 }),
+                  frames_.end());
+    if (frames_.empty()) return false;
+    if (frames_[0].info.dispose_op == static_cast<int32_t>(ApngDispose::Previous)) {
+        frames_[0].info.dispose_op = static_cast<int32_t>(ApngDispose::Background);
+    }
+    for (const FrameData& frame : frames_) info_.duration_ms += frame.info.delay_ms;
+    info_.frame_count = static_cast<int32_t>(frames_.size());
+
+    // Palette entries past PLTE are opaque black; tRNS gives alpha to the first entries.
+    for (int i = 0; i < 256; ++i) palette_[i] = 0xFF000000u;
+    for (size_t i = 0; i < palette_size; ++i) {
+        const uint8_t* rgb = data + palette_offset + 3 * i;
+        const uint32_t alpha = (color_type_ == 3 && i < trns_size) ? data[trns_offset + i] : 255;
+        palette_[i] = Pack(rgb[0], rgb[1], rgb[2], alpha);
+    }
+    if (color_type_ == 0 && trns_size >= 2) {
+        has_key_ = true;
+        key_[0] = Read16(data + trns_offset);
+    } else if (color_type_ == 2 && trns_size >= 6) {
+        has_key_ = true;
+        for (int i = 0; i < 3; ++i) key_[i] = Read16(data + trns_offset + 2 * i);
+    }
+    return true;
+}
+
+size_t ApngDecoder::RowBytes(int32_t width) const {
+    return (static_cast<size_t>(width) * channels_ * bit_depth_ + 7) / 8;
+}
+
+/**
+ * @brief The payloads are inflated one after another into raw_ without being joined. Stops at
+ *        the end of the zlib stream, when raw_ is full, or at an error.
+ */
+size_t ApngDecoder::Inflate(const FrameData& frame, size_t capacity) {
+    auto stream = static_cast<z_stream*>(zstream_);
+    inflateReset(stream);
+    // kMaxPixels keeps a frame's raw size, at most 8 bytes a pixel plus the filter bytes,
+    // within zlib's 32-bit counters.
+    stream->next_out = raw_.data();
+    stream->avail_out = static_cast<uInt>(capacity);
+    for (const Segment& segment : frame.segments) {
+        if (segment.offset + segment.size > size_) break;
+        stream->next_in = const_cast<Bytef*>(data_ + segment.offset);
+        stream->avail_in = static_cast<uInt>(segment.size);
+        const int result = inflate(stream, Z_NO_FLUSH);
+        if (result != Z_OK || stream->avail_out == 0) break;
+    }
+    return capacity - stream->avail_out;
+}
+
+bool ApngDecoder::DecodeFrame(int32_t index, uint32_t* out) {
+    const FrameData& frame = frames_[index];
+    const int32_t width = frame.info.width;
+    const int32_t height = frame.info.height;
+    std::fill(out, out + static_cast<size_t>(width) * height, 0u);
+
+    size_t capacity = 0;
+    if (interlaced_) {
+        for (const auto& pass : kAdam7) {
+            const int32_t pass_width = (width - pass[0] + pass[2] - 1) / pass[2];
+            const int32_t pass_height = (height - pass[1] + pass[3] - 1) / pass[3];
+            if (pass_width > 0 && pass_height > 0) capacity += static_cast<size_t>(pass_height) * (1 + RowBytes(pass_width));
+        }
+    } else {
+        capacity = static_cast<size_t>(height) * (1 + RowBytes(width));
+    }
+    if (raw_.size() < capacity) raw_.resize(capacity);
+    if (zero_row_.size() < RowBytes(width)) zero_row_.assign(RowBytes(width), 0);
+    if (row_pixels_.size() < static_cast<size_t>(width)) row_pixels_.resize(width);
+
+    uint8_t* raw = raw_.data();
+    const uint8_t* raw_end = raw + Inflate(frame, capacity);
+    if (!interlaced_) return DecodePass(raw, raw_end, width, height, out, width, 0, 0, 1, 1);
+
+    for (const auto& pass : kAdam7) {
+        const int32_t pass_width = (width - pass[0] + pass[2] - 1) / pass[2];
+        const int32_t pass_height = (height - pass[1] + pass[3] - 1) / pass[3];
+        if (pass_width <= 0 || pass_height <= 0) continue;
+        if (!DecodePass(raw, raw_end, pass_width, pass_height, out, width, pass[0], pass[1], pass[2], pass[3])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Rows are unfiltered in place in raw_, so the row above is always at hand unfiltered.
+ *        Pixel (i, j) of the pass lands at (x0 + i * dx, y0 + j * dy) of the frame.
+ */
+bool ApngDecoder::DecodePass(uint8_t*& raw, const uint8_t* raw_end, int32_t width, int32_t height, uint32_t* out,
+                             int32_t out_width, int32_t x0, int32_t y0, int32_t dx, int32_t dy) {
+    const size_t row_bytes = RowBytes(width);
+    const uint8_t* prev = zero_row_.data();
+    for (int32_t j = 0; j < height; ++j) {
+        if (static_cast<size_t>(raw_end - raw) < 1 + row_bytes || raw[0] > 4) return false;
+        uint8_t* row = raw + 1;
+        Unfilter(raw[0], bpp_)(row, prev, row_bytes, bpp_);
+        uint32_t* dst = out + static_cast<size_t>(y0 + j * dy) * out_width + x0;
+        if (dx == 1) {
+            ConvertRow(row, width, dst);
+        } else {
+            ConvertRow(row, width, row_pixels_.data());
+            for (int32_t i = 0; i < width; ++i) dst[static_cast<size_t>(i) * dx] = row_pixels_[i];
+        }
+        prev = row;
+        raw += 1 + row_bytes;
+    }
+    return true;
+}
+
+void ApngDecoder::ConvertRow(const uint8_t* src, int32_t count, uint32_t* dst) const {
+    const bool wide = bit_depth_ == 16;
+    switch (color_type_) {
+    case 6:
+        if (!wide) {
+            for (int32_t i = 0; i < count; ++i, src += 4) dst[i] = Pack(src[0], src[1], src[2], src[3]);
+        } else {
+            for (int32_t i = 0; i < count; ++i, src += 8) dst[i] = Pack(src[0], src[2], src[4], src[6]);
+        }
+        break;
+    case 2:
+        if (!wide) {
+            for (int32_t i = 0; i < count; ++i, src += 3) {
+                const bool clear = has_key_ && src[0] == key_[0] && src[1] == key_[1] && src[2] == key_[2];
+                dst[i] = clear ? 0 : Pack(src[0], src[1], src[2], 255);
+            }
+        } else {
+            for (int32_t i = 0; i < count; ++i, src += 6) {
+                const bool clear = has_key_ && Read16(src) == key_[0] && Read16(src + 2) == key_[1] && Read16(src + 4) == key_[2];
+                dst[i] = clear ? 0 : Pack(src[0], src[2], src[4], 255);
+            }
+        }
+        break;
+    case 4:
+        for (int32_t i = 0; i < count; ++i) {
+            const uint32_t grey = src[0];
+            const uint32_t alpha = wide ? src[2] : src[1];
+            dst[i] = Pack(grey, grey, grey, alpha);
+            src += wide ? 4 : 2;
+        }
+        break;
+    case 3:
+        if (bit_depth_ == 8) {
+            for (int32_t i = 0; i < count; ++i) dst[i] = palette_[src[i]];
+            break;
+        }
+        [[fallthrough]];
+    case 0: {
+        // Sub-byte samples are packed from the high bits down.
+        const int32_t depth = bit_depth_;
+        const uint32_t mask = (1u << std::min(depth, 8)) - 1;
+        for (int32_t i = 0; i < count; ++i) {
+            uint32_t sample;
+            uint32_t level;
+            if (depth == 16) {
+                sample = Read16(src + 2 * i);
+                level = sample >> 8;
+            } else {
+                const size_t bit = static_cast<size_t>(i) * depth;
+                sample = (src[bit >> 3] >> (8 - depth - (bit & 7))) & mask;
+                level = sample * 255 / mask;
+            }
+            if (color_type_ == 3) {
+                dst[i] = palette_[sample];
+            } else {
+                dst[i] = (has_key_ && sample == key_[0]) ? 0 : Pack(level, level, level, 255);
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
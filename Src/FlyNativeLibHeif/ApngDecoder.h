@@ -0,0 +1,150 @@
+/**
+ * @file ApngDecoder.h
+ * @brief Declares ApngDecoder, an APNG container parser and frame decoder.
+ *
+ * Open() walks the chunk list once and records, per frame, its fcTL fields and where its
+ * IDAT/fdAT payloads are in the file; nothing is copied or inflated until a frame is asked
+ * for. DecodeFrame() then turns one frame into premultiplied BGRA:
+ *
+ * - The payloads are fed to zlib in place, one after the other, into a raw buffer reused
+ *   across frames; the inflate state is reset rather than rebuilt per frame.
+ * - Rows are unfiltered in place. Up runs 16 bytes at a time; Sub, Avg and Paeth depend on the
+ *   pixel to the left, so for 3- and 4-byte pixels they run a whole pixel per SSE2 step, as
+ *   libpng's intrinsics do. Other pixel sizes use the scalar kernels.
+ * - Every colour type and bit depth is converted to BGRA (16-bit samples keep the high byte),
+ *   with tRNS applied; Adam7 frames are scattered pass by pass.
+ *
+ * Frames follow the fcTL sequence numbers. An IDAT image before the first fcTL is the hidden
+ * default image and is not a frame; a file without fcTL is one frame of its IDAT image.
+ * Compositing frames onto a canvas is ApngCompositor's job.
+ *
+ * The file data is not copied and must outlive the decoder. Not thread-safe.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef APNG_DECODER_H
+#define APNG_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief dispose_op values of the fcTL chunk.
+enum class ApngDispose : int32_t {
+    None = 0,           ///< Leave the frame in place.
+    Background = 1,     ///< Clear the frame's rectangle to transparent black.
+    Previous = 2,       ///< Restore the rectangle to what it was before the frame was drawn.
+};
+
+/// @brief blend_op values of the fcTL chunk.
+enum class ApngBlend : int32_t {
+    Source = 0,         ///< Replace the rectangle, alpha included.
+    Over = 1,           ///< Composite over what is there.
+};
+
+/// @brief One frame as described by its fcTL chunk. Blittable for P/Invoke.
+struct ApngFrameInfo {
+    int32_t x;                          ///< Frame rectangle on the canvas; frames outside it are dropped.
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    int32_t delay_ms;                   ///< delay_num / delay_den seconds; a zero delay becomes 100 ms.
+    int32_t dispose_op;                 ///< An ApngDispose value; Previous on the first frame is Background.
+    int32_t blend_op;                   ///< An ApngBlend value.
+    int32_t reserved;
+};
+
+/// @brief The animation as a whole. Blittable for P/Invoke.
+struct ApngInfo {
+    int32_t width;                      ///< Canvas size, from IHDR.
+    int32_t height;
+    int32_t frame_count;
+    int32_t loop_count;                 ///< num_plays from acTL: 0 loops forever.
+    int64_t duration_ms;                ///< Sum of the frame delays.
+};
+
+/// @brief Parses an APNG in memory and decodes its frames to premultiplied BGRA.
+class ApngDecoder {
+public:
+    /// Canvases and frames larger than this many pixels are rejected.
+    static constexpr int64_t kMaxPixels = 1ll << 28;
+
+    /// @brief Reverses one row's filter in place. `prev` is the unfiltered row above (all zero
+    ///        for the first row); `bpp` is the number of bytes per complete pixel, at least 1.
+    using UnfilterFn = void (*)(uint8_t* row, const uint8_t* prev, size_t length, size_t bpp);
+
+    ApngDecoder();
+    ~ApngDecoder();
+    ApngDecoder(const ApngDecoder&) = delete;
+    ApngDecoder& operator=(const ApngDecoder&) = delete;
+
+    /// @brief Parses `data`. Frames after a truncation, and frames that do not fit the canvas, are dropped.
+    /// @return false if the data is not a PNG this decoder supports or has no frame.
+    bool Open(const uint8_t* data, size_t size);
+
+    const ApngInfo& Info() const { return info_; }
+    int32_t FrameCount() const { return info_.frame_count; }
+    const ApngFrameInfo& Frame(int32_t index) const { return frames_[index].info; }
+
+    /// @brief Decodes frame `index` into `out`, `width * height` premultiplied BGRA pixels
+    ///        (B in the low byte), packed.
+    /// @return false if the frame's data is truncated or corrupt; what could be decoded is
+    ///         still written and the rest is transparent.
+    bool DecodeFrame(int32_t index, uint32_t* out);
+
+    /// @brief Selects the unfilter kernels: SSE2 where the CPU has it, or scalar.
+    void SetSimd(bool enabled);
+
+    /// @brief The unfilter kernel for filter type `filter` (0-4) and `bpp`-byte pixels.
+    UnfilterFn Unfilter(int filter, size_t bpp) const;
+
+    /// @brief Bytes held between frames: the frame table and the inflate and row buffers.
+    /// @note zlib's own inflate state and window are not included.
+    size_t ScratchBytes() const {
+        return frames_.capacity() * sizeof(FrameData) + raw_.capacity() + zero_row_.capacity() + row_pixels_.capacity() * 4;
+    }
+
+private:
+    struct Segment {
+        size_t offset;
+        size_t size;
+    };
+
+    struct FrameData {
+        ApngFrameInfo info;
+        uint32_t sequence;
+        std::vector<Segment> segments;  // IDAT or fdAT payloads, sequence number stripped.
+    };
+
+    size_t RowBytes(int32_t width) const;
+    size_t Inflate(const FrameData& frame, size_t capacity);
+    bool DecodePass(uint8_t*& raw, const uint8_t* raw_end, int32_t width, int32_t height, uint32_t* out,
+                    int32_t out_width, int32_t x0, int32_t y0, int32_t dx, int32_t dy);
+    void ConvertRow(const uint8_t* src, int32_t count, uint32_t* dst) const;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    ApngInfo info_{};
+    std::vector<FrameData> frames_;
+
+    int32_t bit_depth_ = 0;
+    int32_t color_type_ = 0;
+    bool interlaced_ = false;
+    size_t bpp_ = 0;                    // Bytes per complete pixel, at least 1.
+    int32_t channels_ = 0;
+    uint32_t palette_[256] = {};        // Premultiplied BGRA, tRNS applied.
+    bool has_key_ = false;              // tRNS colour key for grey and RGB.
+    uint16_t key_[3] = {};
+
+    void* zstream_ = nullptr;           // z_stream, kept out of this header.
+    std::vector<uint8_t> raw_;          // Inflated frame: filter byte and row data, per row.
+    std::vector<uint8_t> zero_row_;
+    std::vector<uint32_t> row_pixels_;
+    UnfilterFn unfilter_[5] = {};
+    UnfilterFn unfilter3_[5] = {};      // For 3-byte pixels.
+    UnfilterFn unfilter4_[5] = {};      // For 4-byte pixels.
+};
+
+#endif // APNG_DECODER_H
@@ -0,0 +1,137 @@
+/**
+ * @file AvifAnimationSource.cpp
+ * @brief Implements AvifAnimationSource.
+ */
+
+#include "pch.h"
+#include "AvifAnimationSource.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLY_AVIF_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    /// round(c * a / 255) without a division.
+    inline uint32_t Scale(uint32_t c, uint32_t a) {
+        const uint32_t v = c * a + 128;
+        return (v + (v >> 8)) >> 8;
+    }
+
+    void ConvertRowScalar(uint32_t* pixels, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t px = pixels[i];
+            const uint32_t a = px >> 24;
+            const uint32_t r = px & 0xFF, g = (px >> 8) & 0xFF, b = (px >> 16) & 0xFF;
+            pixels[i] = a == 255 ? (a << 24) | (r << 16) | (g << 8) | b
+                                 : (a << 24) | (Scale(r, a) << 16) | (Scale(g, a) << 8) | Scale(b, a);
+        }
+    }
+
+#ifdef FLY_AVIF_SSE2
+    /// Two pixels as 16-bit lanes: R and B swapped, colour scaled by alpha with Scale()'s rounding.
+    inline __m128i Convert16(__m128i px16) {
+        const __m128i swapped = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px16, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+        const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px16, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        const __m128i factor = _mm_or_si128(_mm_and_si128(alpha, _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1)),
+                                            _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0));
+        const __m128i v = _mm_add_epi16(_mm_mullo_epi16(swapped, factor), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+    }
+
+    void ConvertRowSse2(uint32_t* pixels, size_t count) {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i* p = reinterpret_cast<__m128i*>(pixels + i);
+            const __m128i px = _mm_loadu_si128(p);
+            _mm_storeu_si128(p, _mm_packus_epi16(Convert16(_mm_unpacklo_epi8(px, zero)), Convert16(_mm_unpackhi_epi8(px, zero))));
+        }
+        ConvertRowScalar(pixels + i, count - i);
+    }
+#endif
+}
+
+AvifAnimationSource::AvifAnimationSource(int32_t format) {
+    info_.format = format;
+    SetSimd(true);
+}
+
+void AvifAnimationSource::SetSimd(bool enabled) {
+    convert_ = &ConvertRowScalar;
+#ifdef FLY_AVIF_SSE2
+    if (enabled && CpuFeatures::Level() >= SimdLevel::Sse2) convert_ = &ConvertRowSse2;
+#else
+    (void)enabled;
+#endif
+    diff_.SetSimd(enabled);
+}
+
+/**
+ * @brief Only sequences are accepted; a still AVIF has no track to play and is shown by the
+ *        still-image path.
+ */
+bool AvifAnimationSource::Open(const uint8_t* data, size_t size) {
+    if (!reader_.Open(data, size) || !reader_.IsAnimated()) return false;
+
+    std::vector<int> durations;
+    if (!reader_.ReadFrameDurations(durations) || durations.empty()) return false;
+
+    info_.width = reader_.GetWidth();
+    info_.height = reader_.GetHeight();
+    info_.frame_count = static_cast<int32_t>(durations.size());
+    info_.loop_count = 0;
+    info_.duration_ms = 0;
+    frames_.resize(durations.size());
+    for (size_t i = 0; i < durations.size(); ++i) {
+        frames_[i] = AnimationFrameInfo{0, 0, info_.width, info_.height, durations[i], i == 0 ? 1 : 0};
+        info_.duration_ms += durations[i];
+    }
+    canvas_.assign(static_cast<size_t>(info_.width) * info_.height, 0);
+    frame_.assign(canvas_.size(), 0);
+    current_ = -1;
+    frames_decoded_ = 0;
+    source_bytes_ = size;
+    return true;
+}
+
+/**
+ * @brief Frames are decoded into frame_, so the canvas keeps the last frame rendered until the
+ *        new one is compared with it. A frame that fails to decode (a track shorter than its
+ *        sample table, or corrupt data) restarts the track and leaves the canvas as it was;
+ *        the next call decodes from the first frame again.
+ */
+bool AvifAnimationSource::RenderTo(int32_t index, FrameRect& dirty) {
+    dirty = FrameRect{};
+    if (index < 0 || index >= info_.frame_count) return false;
+    if (index == current_) return true;
+    if (index < current_) {
+        reader_.Reset();
+        current_ = -1;
+    }
+
+    uint8_t* frame = reinterpret_cast<uint8_t*>(frame_.data());
+    while (current_ < index) {
+        if (reader_.DecodeNextFrame(frame) <= 0) {
+            reader_.Reset();
+            current_ = -1;
+            return false;
+        }
+        ++current_;
+        ++frames_decoded_;
+    }
+    convert_(frame_.data(), frame_.size());
+    dirty = diff_.Compare(canvas_.data(), frame_.data(), info_.width, info_.height);
+    canvas_.swap(frame_);
+    return true;
+}
+
+AnimationStats AvifAnimationSource::Stats() const {
+    const size_t scratch = reader_.HeldImageBytes() + frame_.capacity() * 4 + frames_.capacity() * sizeof(AnimationFrameInfo);
+    return AnimationStats{static_cast<int64_t>(source_bytes_), static_cast<int64_t>(canvas_.size() * 4),
+                          static_cast<int64_t>(scratch), frames_decoded_};
+}
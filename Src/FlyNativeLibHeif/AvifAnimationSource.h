@@ -0,0 +1,64 @@
+/**
+ * @file AvifAnimationSource.h
+ * @brief Declares AvifAnimationSource, the IAnimationSource for AVIF and HEIF image sequences.
+ *
+ * AnimatedAvifReader decodes the sequence track through libheif; this class gives it the shape
+ * the other formats have. The frame table comes from the track's sample durations, read at open
+ * without decoding. libheif returns every frame whole, so each new frame is decoded beside the
+ * canvas and compared with it by FrameDiff. The rectangle reported as changed is only the part
+ * that differs, which for a mostly static animation is a small fraction of the canvas.
+ *
+ * libheif decodes a track only forwards from its first sample, so the first frame is the only key
+ * frame: a seek backwards restarts the track, and a seek forwards decodes the frames in between
+ * but converts only the last. libheif's RGBA is turned into premultiplied BGRA in place, four
+ * pixels per SSE2 step.
+ *
+ * Not thread-safe.
+ */
+
+#pragma once
+#ifndef AVIF_ANIMATION_SOURCE_H
+#define AVIF_ANIMATION_SOURCE_H
+
+#include "AnimatedAvifReader.h"
+#include "AnimationSource.h"
+#include "FrameDiff.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief An AVIF or HEIF image sequence decoded onto a premultiplied BGRA canvas.
+class AvifAnimationSource final : public IAnimationSource {
+public:
+    /// @brief Converts `count` straight-alpha RGBA pixels to premultiplied BGRA in place.
+    using ConvertRowFn = void (*)(uint32_t* pixels, size_t count);
+
+    /// @param format The ImageFormat reported in Info(): Avif or Heif.
+    explicit AvifAnimationSource(int32_t format);
+
+    bool Open(const uint8_t* data, size_t size) override;
+    const AnimationInfo& Info() const override { return info_; }
+    const AnimationFrameInfo& Frame(int32_t index) const override { return frames_[index]; }
+    bool RenderTo(int32_t index, FrameRect& dirty) override;
+    const uint8_t* Pixels() const override { return reinterpret_cast<const uint8_t*>(canvas_.data()); }
+    AnimationStats Stats() const override;
+
+    /// @brief Selects the conversion and compare kernels: SSE2 where the CPU has it, or scalar.
+    void SetSimd(bool enabled);
+
+private:
+    AnimatedAvifReader reader_;
+    AnimationInfo info_{};
+    std::vector<AnimationFrameInfo> frames_;
+    std::vector<uint32_t> canvas_;
+    std::vector<uint32_t> frame_;       // The frame being decoded; swapped with the canvas once compared.
+    ConvertRowFn convert_ = nullptr;
+    FrameDiff diff_;
+
+    int32_t current_ = -1;              // The frame on the canvas, or -1 if none is.
+    int64_t frames_decoded_ = 0;
+    size_t source_bytes_ = 0;
+};
+
+#endif // AVIF_ANIMATION_SOURCE_H
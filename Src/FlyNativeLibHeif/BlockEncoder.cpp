@@ -0,0 +1,512 @@
+/**
+ * @file BlockEncoder.cpp
+ * @brief Implements BlockEncoder.
+ */
+
+#include "BlockEncoder.h"
+#include "CpuFeatures.h"
+#include "ImageReducer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLY_BLOCK_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    constexpr uint16_t kPreviewVersion = 2;
+
+    /// Largest texture edge accepted, and the most mip levels (level 0 included) in a blob.
+    constexpr int kMaxEdge = 16384;
+    constexpr size_t kMaxLevels = 8;
+
+    bool ValidDimensions(uint32_t width, uint32_t height) {
+        return width != 0 && height != 0 && (width & 3) == 0 && (height & 3) == 0 &&
+               width <= static_cast<uint32_t>(kMaxEdge) && height <= static_cast<uint32_t>(kMaxEdge);
+    }
+
+    /// Pixels of one level while a blob is being built. Level 0 points at the caller's image;
+    /// the others own their storage.
+    struct LevelPixels {
+        const uint8_t* pixels;
+        int width, height, stride;
+        std::vector<uint8_t> storage;
+    };
+
+    /// Pixel i of a block (row-major) uses index bits 2i..2i+1. `level` is the rounded position
+    /// of the pixel between the min endpoint (0) and the max endpoint (3); BC1 numbers the
+    /// palette max, min, 2/3 max, 1/3 max, so levels 0..3 map to indices 1, 3, 2, 0.
+    constexpr uint32_t kLevelToIndex[4] = { 1, 3, 2, 0 };
+
+    uint16_t To565(int b, int g, int r) {
+        const int r5 = (r * 31 + 128) / 255;
+        const int g6 = (g * 63 + 128) / 255;
+        const int b5 = (b * 31 + 128) / 255;
+        return static_cast<uint16_t>((r5 << 11) | (g6 << 5) | b5);
+    }
+
+    void From565(uint16_t c, int& b, int& g, int& r) {
+        const int r5 = (c >> 11) & 31, g6 = (c >> 5) & 63, b5 = c & 31;
+        r = (r5 << 3) | (r5 >> 2);
+        g = (g6 << 2) | (g6 >> 4);
+        b = (b5 << 3) | (b5 >> 2);
+    }
+
+    void WriteColorBlock(uint8_t* out, uint16_t c0, uint16_t c1, uint32_t indices) {
+        out[0] = static_cast<uint8_t>(c0);
+        out[1] = static_cast<uint8_t>(c0 >> 8);
+        out[2] = static_cast<uint8_t>(c1);
+        out[3] = static_cast<uint8_t>(c1 >> 8);
+        out[4] = static_cast<uint8_t>(indices);
+        out[5] = static_cast<uint8_t>(indices >> 8);
+        out[6] = static_cast<uint8_t>(indices >> 16);
+        out[7] = static_cast<uint8_t>(indices >> 24);
+    }
+
+    /// Endpoints of one block: the colour bounding box, shrunk by 1/16 of its extent on each
+    /// side so that outliers do not pull both endpoints away from the bulk of the pixels. Of
+    /// the box's four diagonals the one the pixels run along is used, so a block where one
+    /// channel rises while another falls is not collapsed onto a single palette entry.
+    struct Endpoints {
+        uint16_t c0, c1;                // 565, c0 >= c1.
+        int dir[3];                     // Expanded c0 - c1 per channel (B, G, R).
+        int d1;                         // dot(expanded c1, dir).
+        int span;                       // dot(c0 - c1, dir); 0 for a solid block.
+    };
+
+    void MakeEndpoints(const uint8_t* block, const int mn[3], const int mx[3], Endpoints& e) {
+        // Sign of the covariance of B and R with G (or of B with R if G is flat) decides
+        // whether that channel's extent is walked backwards.
+        int cov_bg = 0, cov_rg = 0, cov_br = 0;
+        const int mid_b = mn[0] + mx[0], mid_g = mn[1] + mx[1], mid_r = mn[2] + mx[2];
+        for (int i = 0; i < 16; ++i) {
+            const int b = 2 * block[i * 4] - mid_b, g = 2 * block[i * 4 + 1] - mid_g, r = 2 * block[i * 4 + 2] - mid_r;
+            cov_bg += b * g;
+            cov_rg += r * g;
+            cov_br += b * r;
+        }
+        const bool flip[3] = { mn[1] != mx[1] ? cov_bg < 0 : cov_br < 0, false, mn[1] != mx[1] && cov_rg < 0 };
+
+        int lo[3], hi[3];
+        for (int c = 0; c < 3; ++c) {
+            const int inset = (mx[c] - mn[c]) >> 4;
+            lo[c] = mn[c] + inset;
+            hi[c] = mx[c] - inset;
+            if (flip[c]) std::swap(lo[c], hi[c]);
+        }
+        e.c0 = To565(hi[0], hi[1], hi[2]);
+        e.c1 = To565(lo[0], lo[1], lo[2]);
+        if (e.c0 < e.c1) std::swap(e.c0, e.c1);
+        int p0[3], p1[3];
+        From565(e.c0, p0[0], p0[1], p0[2]);
+        From565(e.c1, p1[0], p1[1], p1[2]);
+        e.d1 = 0;
+        e.span = 0;
+        for (int c = 0; c < 3; ++c) {
+            e.dir[c] = p0[c] - p1[c];
+            e.d1 += p1[c] * e.dir[c];
+            e.span += e.dir[c] * e.dir[c];
+        }
+        if (e.c0 == e.c1) e.span = 0;
+    }
+
+    /// Spreads the low 16 bits of x to the even bit positions.
+    uint32_t Spread16(uint32_t x) {
+        x = (x | (x << 8)) & 0x00FF00FFu;
+        x = (x | (x << 4)) & 0x0F0F0F0Fu;
+        x = (x | (x << 2)) & 0x33333333u;
+        x = (x | (x << 1)) & 0x55555555u;
+        return x;
+    }
+
+    /// Colour half of a block from 16 BGRA pixels (64 bytes, row-major).
+    void ColorBlockScalar(const uint8_t* block, uint8_t* out) {
+        int mn[3] = { 255, 255, 255 }, mx[3] = { 0, 0, 0 };
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                mn[c] = std::min<int>(mn[c], block[i * 4 + c]);
+                mx[c] = std::max<int>(mx[c], block[i * 4 + c]);
+            }
+        }
+        Endpoints e;
+        MakeEndpoints(block, mn, mx, e);
+
+        uint32_t indices = 0;
+        if (e.span > 0) {
+            for (int i = 0; i < 16; ++i) {
+                const uint8_t* p = block + i * 4;
+                const int v = 6 * (p[0] * e.dir[0] + p[1] * e.dir[1] + p[2] * e.dir[2] - e.d1);
+                const int level = (v > e.span) + (v > 3 * e.span) + (v > 5 * e.span);
+                indices |= kLevelToIndex[level] << (2 * i);
+            }
+        }
+        WriteColorBlock(out, e.c0, e.c1, indices);
+    }
+
+#ifdef FLY_BLOCK_SSE2
+    /// Dot products of the four pixels of one row with the endpoint axis.
+    inline __m128i RowDots(__m128i row, __m128i dir) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(row, zero), dir);   // p0.bg, p0.ra, p1.bg, p1.ra
+        const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(row, zero), dir);
+        const __m128i lo_sum = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+        const __m128i hi_sum = _mm_add_epi32(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_unpacklo_epi64(_mm_shuffle_epi32(lo_sum, _MM_SHUFFLE(3, 1, 2, 0)),
+                                  _mm_shuffle_epi32(hi_sum, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    /**
+     * SSE2 version of ColorBlockScalar: the bounding box is reduced across the block in
+     * registers, the projections are four madd per row, and the three threshold masks are
+     * packed straight into index bit planes with movemask. Produces identical output.
+     */
+    void ColorBlockSse2(const uint8_t* block, uint8_t* out) {
+        const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+        const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16));
+        const __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 32));
+        const __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 48));
+
+        __m128i mn = _mm_min_epu8(_mm_min_epu8(r0, r1), _mm_min_epu8(r2, r3));
+        __m128i mx = _mm_max_epu8(_mm_max_epu8(r0, r1), _mm_max_epu8(r2, r3));
+        mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(1, 0, 3, 2)));
+        mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(1, 0, 3, 2)));
+        mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(2, 3, 0, 1)));
+        mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        const uint32_t mn_px = static_cast<uint32_t>(_mm_cvtsi128_si32(mn));
+        const uint32_t mx_px = static_cast<uint32_t>(_mm_cvtsi128_si32(mx));
+        const int lo[3] = { static_cast<int>(mn_px & 0xFF), static_cast<int>((mn_px >> 8) & 0xFF), static_cast<int>((mn_px >> 16) & 0xFF) };
+        const int hi[3] = { static_cast<int>(mx_px & 0xFF), static_cast<int>((mx_px >> 8) & 0xFF), static_cast<int>((mx_px >> 16) & 0xFF) };
+        Endpoints e;
+        MakeEndpoints(block, lo, hi, e);
+
+        uint32_t indices = 0;
+        if (e.span > 0) {
+            const __m128i dir = _mm_setr_epi16(
+                static_cast<short>(e.dir[0]), static_cast<short>(e.dir[1]), static_cast<short>(e.dir[2]), 0,
+                static_cast<short>(e.dir[0]), static_cast<short>(e.dir[1]), static_cast<short>(e.dir[2]), 0);
+            const __m128i d1 = _mm_set1_epi32(e.d1);
+            const __m128i t1 = _mm_set1_epi32(e.span);
+            const __m128i t3 = _mm_set1_epi32(3 * e.span);
+            const __m128i t5 = _mm_set1_epi32(5 * e.span);
+
+            __m128i a[4], b[4], c[4];
+            const __m128i rows[4] = { r0, r1, r2, r3 };
+            for (int r = 0; r < 4; ++r) {
+                const __m128i x = _mm_sub_epi32(RowDots(rows[r], dir), d1);
+                const __m128i v = _mm_add_epi32(_mm_slli_epi32(x, 2), _mm_slli_epi32(x, 1));   // 6x
+                a[r] = _mm_cmpgt_epi32(v, t1);
+                b[r] = _mm_cmpgt_epi32(v, t3);
+                c[r] = _mm_cmpgt_epi32(v, t5);
+            }
+            auto mask16 = [](const __m128i m[4]) {
+                const __m128i packed = _mm_packs_epi16(_mm_packs_epi32(m[0], m[1]), _mm_packs_epi32(m[2], m[3]));
+                return static_cast<uint32_t>(_mm_movemask_epi8(packed));
+            };
+            const uint32_t ma = mask16(a), mb = mask16(b), mc = mask16(c);
+            // level = a + b + c; index bit 0 is set for levels 0 and 1 (not b), bit 1 for levels 1 and 2 (a xor c).
+            indices = Spread16(~mb & 0xFFFF) | (Spread16(ma ^ mc) << 1);
+        }
+        WriteColorBlock(out, e.c0, e.c1, indices);
+    }
+#endif
+
+    using ColorBlockFn = void (*)(const uint8_t* block, uint8_t* out);
+
+    ColorBlockFn SelectColorKernel() {
+#ifdef FLY_BLOCK_SSE2
+        if (CpuFeatures::Level() >= SimdLevel::Sse2) return &ColorBlockSse2;
+#endif
+        return &ColorBlockScalar;
+    }
+
+    /// Interpolated 8-alpha block: endpoints are the alpha range, indices the rounded position in it.
+    void AlphaBlock(const uint8_t* block, uint8_t* out) {
+        int mn = 255, mx = 0;
+        for (int i = 0; i < 16; ++i) {
+            mn = std::min<int>(mn, block[i * 4 + 3]);
+            mx = std::max<int>(mx, block[i * 4 + 3]);
+        }
+        out[0] = static_cast<uint8_t>(mx);
+        out[1] = static_cast<uint8_t>(mn);
+        uint64_t bits = 0;
+        if (mx > mn) {
+            const int span = mx - mn;
+            for (int i = 0; i < 16; ++i) {
+                const int level = (14 * (block[i * 4 + 3] - mn) + span) / (2 * span);   // round(7t), 0..7
+                const uint64_t index = level == 7 ? 0 : level == 0 ? 1 : static_cast<uint64_t>(8 - level);
+                bits |= index << (3 * i);
+            }
+        }
+        for (int i = 0; i < 6; ++i) out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+
+    /// Copies the 4x4 block at (bx, by) into 64 contiguous bytes, replicating the last
+    /// row and column for blocks that overhang the image.
+    void LoadBlock(const uint8_t* bgra, int width, int height, int stride, int bx, int by, uint8_t* block) {
+        const int x0 = bx * 4, y0 = by * 4;
+        if (x0 + 4 <= width && y0 + 4 <= height) {
+            for (int y = 0; y < 4; ++y) {
+                memcpy(block + y * 16, bgra + static_cast<size_t>(y0 + y) * stride + static_cast<size_t>(x0) * 4, 16);
+            }
+            return;
+        }
+        for (int y = 0; y < 4; ++y) {
+            const uint8_t* row = bgra + static_cast<size_t>(std::min(y0 + y, height - 1)) * stride;
+            for (int x = 0; x < 4; ++x) {
+                memcpy(block + y * 16 + x * 4, row + static_cast<size_t>(std::min(x0 + x, width - 1)) * 4, 4);
+            }
+        }
+    }
+
+    /// Expands one colour block to 16 BGRA pixels, in the palette modes the GPU uses: four
+    /// colours when c0 > c1, otherwise three plus transparent black.
+    void DecodeColorBlock(const uint8_t* in, uint8_t* block) {
+        const uint16_t c0 = static_cast<uint16_t>(in[0] | (in[1] << 8));
+        const uint16_t c1 = static_cast<uint16_t>(in[2] | (in[3] << 8));
+        const uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | (static_cast<uint32_t>(in[7]) << 24);
+        int palette[4][4];
+        From565(c0, palette[0][0], palette[0][1], palette[0][2]);
+        From565(c1, palette[1][0], palette[1][1], palette[1][2]);
+        palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+        for (int c = 0; c < 3; ++c) {
+            if (c0 > c1) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            } else {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        if (c0 <= c1) palette[3][3] = 0;
+        for (int i = 0; i < 16; ++i) {
+            const int* p = palette[(indices >> (2 * i)) & 3];
+            for (int c = 0; c < 4; ++c) block[i * 4 + c] = static_cast<uint8_t>(p[c]);
+        }
+    }
+
+    /// Replaces the alpha of 16 BGRA pixels with a decoded BC3 alpha block.
+    void DecodeAlphaBlock(const uint8_t* in, uint8_t* block) {
+        const int a0 = in[0], a1 = in[1];
+        int table[8] = { a0, a1 };
+        if (a0 > a1) {
+            for (int k = 1; k < 7; ++k) table[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+        } else {
+            for (int k = 1; k < 5; ++k) table[k + 1] = ((5 - k) * a0 + k * a1) / 5;
+            table[6] = 0;
+            table[7] = 255;
+        }
+        uint64_t bits = 0;
+        for (int k = 0; k < 6; ++k) bits |= static_cast<uint64_t>(in[2 + k]) << (8 * k);
+        for (int i = 0; i < 16; ++i) block[i * 4 + 3] = static_cast<uint8_t>(table[(bits >> (3 * i)) & 7]);
+    }
+
+    template <bool WithAlpha>
+    void EncodeBlocks(const uint8_t* bgra, int width, int height, int stride, uint8_t* out) {
+        static const ColorBlockFn color_kernel = SelectColorKernel();
+        const int blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+        alignas(16) uint8_t block[64];
+        for (int by = 0; by < blocks_y; ++by) {
+            for (int bx = 0; bx < blocks_x; ++bx) {
+                LoadBlock(bgra, width, height, stride, bx, by, block);
+                if (WithAlpha) {
+                    AlphaBlock(block, out);
+                    out += 8;
+                }
+                color_kernel(block, out);
+                out += 8;
+            }
+        }
+    }
+}
+
+size_t BlockEncoder::CompressedSize(BlockFormat format, int width, int height) {
+    if (width <= 0 || height <= 0) return 0;
+    const size_t blocks = static_cast<size_t>((width + 3) / 4) * static_cast<size_t>((height + 3) / 4);
+    return blocks * (format == BlockFormat::Bc1 ? 8 : 16);
+}
+
+bool BlockEncoder::HasAlpha(const uint8_t* bgra, int width, int height, int stride) {
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = bgra + static_cast<size_t>(y) * stride;
+        for (int x = 0; x < width; ++x) {
+            if (row[x * 4 + 3] != 255) return true;
+        }
+    }
+    return false;
+}
+
+void BlockEncoder::EncodeBc1(const uint8_t* bgra, int width, int height, int stride, uint8_t* out) {
+    EncodeBlocks<false>(bgra, width, height, stride, out);
+}
+
+void BlockEncoder::EncodeBc3(const uint8_t* bgra, int width, int height, int stride, uint8_t* out) {
+    EncodeBlocks<true>(bgra, width, height, stride, out);
+}
+
+void BlockEncoder::Decode(BlockFormat format, const uint8_t* blocks, int width, int height, uint8_t* bgra, int stride) {
+    const int blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+    uint8_t block[64];
+    for (int by = 0; by < blocks_y; ++by) {
+        for (int bx = 0; bx < blocks_x; ++bx) {
+            if (format == BlockFormat::Bc3) {
+                DecodeColorBlock(blocks + 8, block);
+                DecodeAlphaBlock(blocks, block);
+                blocks += 16;
+            } else {
+                DecodeColorBlock(blocks, block);
+                blocks += 8;
+            }
+            const int x0 = bx * 4, y0 = by * 4;
+            const int w = std::min(4, width - x0), h = std::min(4, height - y0);
+            for (int y = 0; y < h; ++y) {
+                memcpy(bgra + static_cast<size_t>(y0 + y) * stride + static_cast<size_t>(x0) * 4, block + y * 16,
+                       static_cast<size_t>(w) * 4);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Picks BC1 for opaque images (half the size) and BC3 otherwise. The smaller levels
+ *        are reduced from each other, so the whole chain costs about a third more than
+ *        level 0 alone to build and to store.
+ */
+bool BlockEncoder::EncodePreview(const uint8_t* bgra, int width, int height, int stride, int tile_size,
+                                 std::vector<uint8_t>& out) {
+    if (!bgra || width <= 0 || height <= 0 || stride < width * 4 || width > kMaxEdge || height > kMaxEdge) return false;
+
+    const BlockFormat format = HasAlpha(bgra, width, height, stride) ? BlockFormat::Bc3 : BlockFormat::Bc1;
+
+    // Level 0 is the caller's pixels; each further level is allocated by halving the last.
+    std::vector<LevelPixels> levels;
+    levels.push_back({ bgra, width, height, stride, {} });
+    while (tile_size > 0 && levels.size() < kMaxLevels &&
+           std::min((levels.back().width + 1) / 2, (levels.back().height + 1) / 2) >= tile_size) {
+        const LevelPixels& prev = levels.back();
+        LevelPixels next{ nullptr, (prev.width + 1) / 2, (prev.height + 1) / 2, 0, {} };
+        next.stride = next.width * 4;
+        next.storage.resize(static_cast<size_t>(next.stride) * next.height);
+        ImageReducer::Halve(prev.pixels, prev.width, prev.height, prev.stride, next.storage.data(), next.stride);
+        next.pixels = next.storage.data();
+        levels.push_back(std::move(next));
+    }
+    const size_t mip_count = levels.size();
+    if (tile_size > 0) {
+        const LevelPixels& last = levels.back();
+        const int side = std::min(last.width, last.height);
+        const uint8_t* crop = last.pixels + static_cast<size_t>((last.height - side) / 2) * last.stride +
+                              static_cast<size_t>((last.width - side) / 2) * 4;
+        LevelPixels tile{ nullptr, tile_size, tile_size, tile_size * 4, {} };
+        tile.storage.resize(static_cast<size_t>(tile.stride) * tile_size);
+        ImageReducer::Resample(crop, side, side, last.stride, tile.storage.data(), tile_size, tile_size, tile.stride);
+        tile.pixels = tile.storage.data();
+        levels.push_back(std::move(tile));
+    }
+
+    std::vector<BlockPreviewLevel> table(levels.size());
+    size_t offset = sizeof(BlockPreviewHeader) + table.size() * sizeof(BlockPreviewLevel);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        table[i].width = static_cast<uint32_t>((levels[i].width + 3) & ~3);
+        table[i].height = static_cast<uint32_t>((levels[i].height + 3) & ~3);
+        table[i].offset = static_cast<uint32_t>(offset);
+        table[i].size = static_cast<uint32_t>(CompressedSize(format, levels[i].width, levels[i].height));
+        table[i].kind = static_cast<uint32_t>(i < mip_count ? BlockLevelKind::Mip : BlockLevelKind::Tile);
+        offset += table[i].size;
+    }
+    out.resize(offset);
+
+    BlockPreviewHeader header{};
+    header.magic = kBlockPreviewMagic;
+    header.version = kPreviewVersion;
+    header.format = static_cast<uint16_t>(format);
+    header.width = table[0].width;
+    header.height = table[0].height;
+    header.data_size = static_cast<uint32_t>(offset - sizeof(BlockPreviewHeader));
+    header.level_count = static_cast<uint32_t>(table.size());
+    memcpy(out.data(), &header, sizeof(header));
+    memcpy(out.data() + sizeof(header), table.data(), table.size() * sizeof(BlockPreviewLevel));
+
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const LevelPixels& level = levels[i];
+        uint8_t* blocks = out.data() + table[i].offset;
+        if (format == BlockFormat::Bc1) {
+            EncodeBc1(level.pixels, level.width, level.height, level.stride, blocks);
+        } else {
+            EncodeBc3(level.pixels, level.width, level.height, level.stride, blocks);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Checks the header and, for version 2, that every level lies inside the blob, has
+ *        the block size its dimensions imply, and that any tile is the last level.
+ */
+bool BlockEncoder::ParsePreview(const uint8_t* data, size_t size, BlockPreviewHeader& header) {
+    if (!data || size < sizeof(BlockPreviewHeader)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != kBlockPreviewMagic || (header.version != 1 && header.version != kPreviewVersion)) return false;
+    if (header.format != static_cast<uint16_t>(BlockFormat::Bc1) && header.format != static_cast<uint16_t>(BlockFormat::Bc3)) return false;
+    if (!ValidDimensions(header.width, header.height)) return false;
+    if (header.data_size > size - sizeof(BlockPreviewHeader)) return false;
+    const BlockFormat format = static_cast<BlockFormat>(header.format);
+
+    if (header.version == 1) {
+        return header.level_count == 0 &&
+               header.data_size == CompressedSize(format, static_cast<int>(header.width), static_cast<int>(header.height));
+    }
+
+    if (header.level_count == 0 || header.level_count > kMaxLevels + 1) return false;
+    const size_t table_end = sizeof(BlockPreviewHeader) + header.level_count * sizeof(BlockPreviewLevel);
+    const size_t end = sizeof(BlockPreviewHeader) + header.data_size;
+    if (table_end > end) return false;
+    for (uint32_t i = 0; i < header.level_count; ++i) {
+        BlockPreviewLevel level;
+        memcpy(&level, data + sizeof(BlockPreviewHeader) + i * sizeof(BlockPreviewLevel), sizeof(level));
+        if (!ValidDimensions(level.width, level.height)) return false;
+        if (level.size != CompressedSize(format, static_cast<int>(level.width), static_cast<int>(level.height))) return false;
+        if (level.offset < table_end || level.offset > end || level.size > end - level.offset) return false;
+        if (level.kind == static_cast<uint32_t>(BlockLevelKind::Tile)) {
+            if (i == 0 || i + 1 != header.level_count) return false;
+        } else if (level.kind != static_cast<uint32_t>(BlockLevelKind::Mip)) {
+            return false;
+        }
+        if (i == 0 && (level.width != header.width || level.height != header.height)) return false;
+    }
+    return true;
+}
+
+bool BlockEncoder::GetLevel(const uint8_t* data, const BlockPreviewHeader& header, uint32_t index, BlockPreviewLevel& level) {
+    if (header.version == 1) {
+        if (index != 0) return false;
+        level = { header.width, header.height, static_cast<uint32_t>(sizeof(BlockPreviewHeader)), header.data_size,
+                  static_cast<uint32_t>(BlockLevelKind::Mip) };
+        return true;
+    }
+    if (index >= header.level_count) return false;
+    memcpy(&level, data + sizeof(BlockPreviewHeader) + index * sizeof(BlockPreviewLevel), sizeof(level));
+    return true;
+}
+
+bool BlockEncoder::FindLevel(const uint8_t* data, size_t size, int edge, bool tile, BlockPreviewLevel& level) {
+    BlockPreviewHeader header;
+    if (!ParsePreview(data, size, header)) return false;
+    const uint32_t count = header.version == 1 ? 1 : header.level_count;
+
+    if (tile) {
+        return GetLevel(data, header, count - 1, level) && level.kind == static_cast<uint32_t>(BlockLevelKind::Tile);
+    }
+    GetLevel(data, header, 0, level);
+    for (uint32_t i = 1; i < count; ++i) {
+        BlockPreviewLevel smaller;
+        GetLevel(data, header, i, smaller);
+        if (smaller.kind != static_cast<uint32_t>(BlockLevelKind::Mip) ||
+            static_cast<int>(std::max(smaller.width, smaller.height)) < edge) break;
+        level = smaller;
+    }
+    return true;
+}
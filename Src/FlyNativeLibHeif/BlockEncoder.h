@@ -0,0 +1,110 @@
+/**
+ * @file BlockEncoder.h
+ * @brief Declares BlockEncoder, a real-time BC1/BC3 (DXT1/DXT5) compressor for cached previews.
+ *
+ * Previews in the thumbnail store are kept as block-compressed textures so that a cache hit
+ * is uploaded to the GPU as-is, with no JPEG decode. Direct2D (and so Win2D) can create
+ * bitmaps from BC1, BC2 and BC3 data but not BC7, so opaque previews use BC1 (4 bits per
+ * pixel) and previews with transparency use BC3 (8 bits per pixel).
+ *
+ * Encoding favours speed over quality: each block takes the inset bounding box of its
+ * colours as endpoints and assigns indices by projecting onto the endpoint axis. An SSE2
+ * kernel handles the colour part on x64; other platforms use the equivalent scalar code.
+ *
+ * A preview blob holds a chain of levels encoded in one pass: the preview, its successive
+ * halvings down to about the thumbnail-strip size, and a square tile of exactly that size
+ * cut from the centre. The viewer takes the level nearest the size it draws at, and the
+ * thumbnail strip uploads the tile directly instead of scaling the preview down itself.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef BLOCK_ENCODER_H
+#define BLOCK_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief Block formats a compressed preview may use. Values match the managed side.
+enum class BlockFormat : uint16_t {
+    Bc1 = 1,    ///< DXGI_FORMAT_BC1_UNORM: RGB, 8 bytes per 4x4 block.
+    Bc3 = 3,    ///< DXGI_FORMAT_BC3_UNORM: RGBA, 16 bytes per 4x4 block.
+};
+
+/// @brief Header at the start of a compressed preview blob.
+///
+/// Version 1 blobs hold a single level whose blocks follow the header. Version 2 blobs
+/// follow it with `level_count` BlockPreviewLevel entries, then the blocks of each level.
+struct BlockPreviewHeader {
+    uint32_t magic;         ///< kBlockPreviewMagic.
+    uint16_t version;       ///< 1 or 2.
+    uint16_t format;        ///< A BlockFormat value, shared by every level.
+    uint32_t width;         ///< Texture width of level 0 in pixels; a multiple of 4.
+    uint32_t height;        ///< Texture height of level 0 in pixels; a multiple of 4.
+    uint32_t data_size;     ///< Bytes after the header: level table and blocks (version 1: blocks only).
+    uint32_t level_count;   ///< Entries in the level table (0 in version 1).
+};
+
+/// @brief What a level of a preview blob contains.
+enum class BlockLevelKind : uint32_t {
+    Mip = 0,    ///< The whole preview at 1/2^n of the size of level 0.
+    Tile = 1,   ///< A square centre crop for the thumbnail strip. At most one, and always last.
+};
+
+/// @brief One entry of a version 2 level table. Levels are ordered from largest to smallest.
+struct BlockPreviewLevel {
+    uint32_t width;         ///< Texture width in pixels; a multiple of 4.
+    uint32_t height;        ///< Texture height in pixels; a multiple of 4.
+    uint32_t offset;        ///< Offset of the level's blocks from the start of the blob.
+    uint32_t size;          ///< Bytes of block data.
+    uint32_t kind;          ///< A BlockLevelKind value.
+};
+
+/// @brief "FBCP" in little-endian byte order.
+constexpr uint32_t kBlockPreviewMagic = 0x50434246;
+
+/// @brief Converts premultiplied BGRA pixels to BC1 or BC3 blocks.
+class BlockEncoder {
+public:
+    /// @brief Bytes of block data for a `width` x `height` image (rounded up to whole blocks).
+    static size_t CompressedSize(BlockFormat format, int width, int height);
+
+    /// @brief True if any pixel has alpha below 255.
+    static bool HasAlpha(const uint8_t* bgra, int width, int height, int stride);
+
+    /// @brief Encodes BGRA pixels as BC1. Edge blocks of images not a multiple of 4 replicate the last row/column.
+    /// @param out Receives CompressedSize(Bc1, width, height) bytes.
+    static void EncodeBc1(const uint8_t* bgra, int width, int height, int stride, uint8_t* out);
+
+    /// @brief Encodes BGRA pixels as BC3 (BC1 colour plus an interpolated alpha block).
+    /// @param out Receives CompressedSize(Bc3, width, height) bytes.
+    static void EncodeBc3(const uint8_t* bgra, int width, int height, int stride, uint8_t* out);
+
+    /// @brief Builds a complete preview blob, BC1 or BC3 if the image has transparency.
+    /// @param tile_size Edge of the thumbnail tile. The image is halved while the shorter edge
+    ///        stays at least this long, and the tile is cut from the smallest level. 0 stores
+    ///        the image alone.
+    /// @return false if the dimensions are invalid.
+    static bool EncodePreview(const uint8_t* bgra, int width, int height, int stride, int tile_size,
+                              std::vector<uint8_t>& out);
+
+    /// @brief Decodes BC1 or BC3 blocks back to premultiplied BGRA, for consumers that need pixels
+    ///        (the thumbnail-strip atlas) rather than a texture.
+    /// @param bgra Receives `width` x `height` pixels; blocks overhanging the image are clipped.
+    static void Decode(BlockFormat format, const uint8_t* blocks, int width, int height, uint8_t* bgra, int stride);
+
+    /// @brief Validates a blob produced by EncodePreview and returns its header.
+    static bool ParsePreview(const uint8_t* data, size_t size, BlockPreviewHeader& header);
+
+    /// @brief Gets level `index` of a blob that passed ParsePreview. Version 1 blobs have only level 0.
+    static bool GetLevel(const uint8_t* data, const BlockPreviewHeader& header, uint32_t index, BlockPreviewLevel& level);
+
+    /// @brief Picks the level to draw at `edge` pixels on the longest side: the smallest mip
+    ///        level at least that large, or level 0 if none is. With `tile` set, the tile is
+    ///        returned instead, and false if the blob has none.
+    static bool FindLevel(const uint8_t* data, size_t size, int edge, bool tile, BlockPreviewLevel& level);
+};
+
+#endif // BLOCK_ENCODER_H
@@ -0,0 +1,397 @@
+/**
+ * @file CacheWarmer.cpp
+ * @brief Implements CacheWarmer.
+ */
+
+#include "CacheWarmer.h"
+#include "ContentFingerprint.h"
+#include "ThumbnailStore.h"
+
+#include <algorithm>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    constexpr char kCheckpointMagic[] = "FLYWARM 1";
+    constexpr size_t kQueueDepth = 4096;                        // Listed files waiting for a worker.
+    constexpr auto kPowerPollInterval = std::chrono::seconds(5);
+    constexpr uint32_t kDefaultCheckpointMs = 5000;
+
+    /// Lowers the CPU, I/O and memory priority of the calling thread for the rest of its life,
+    /// so warming never competes with the viewer or other applications.
+    void EnterBackgroundMode() {
+#ifdef _WIN32
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#endif
+    }
+
+    /// True if `dir` is `path` or one of its ancestors (both relative to the same root).
+    bool Contains(const fs::path& dir, const fs::path& path) {
+        auto it = path.begin();
+        for (const auto& part : dir) {
+            if (it == path.end() || *it != part) return false;
+            ++it;
+        }
+        return true;
+    }
+
+    std::string LowerAscii(std::string s) {
+        for (char& c : s) {
+            if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+        return s;
+    }
+}
+
+CacheWarmer::CacheWarmer(ThumbnailStore& store, const CacheWarmHooks& hooks)
+    : store_(store), hooks_(hooks) {
+}
+
+CacheWarmer::~CacheWarmer() {
+    Stop();
+}
+
+bool CacheWarmer::Start(const fs::path& root, const std::vector<std::string>& extensions,
+                        const fs::path& checkpoint_file, const CacheWarmOptions& options) {
+    Stop();
+    std::error_code ec;
+    if (!hooks_.generate || !fs::is_directory(root, ec)) return false;
+
+    root_ = root;
+    extensions_ = extensions;
+    checkpoint_file_ = checkpoint_file;
+    options_ = options;
+    if (options_.threads <= 0) options_.threads = static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency() / 2));
+    if (options_.checkpoint_interval_ms == 0) options_.checkpoint_interval_ms = kDefaultCheckpointMs;
+
+    resume_after_.clear();
+    LoadCheckpoint();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.clear();
+    handed_.clear();
+    checkpoint_ = resume_after_;
+    last_checkpoint_ = std::chrono::steady_clock::now();
+    throttle_until_ = {};
+    next_sequence_ = 0;
+    workers_left_ = options_.threads;
+    walk_complete_ = paused_ = stop_ = limit_reached_ = false;
+    progress_ = {};
+    state_ = CacheWarmState::Running;
+
+    walker_ = std::thread(&CacheWarmer::WalkLoop, this);
+    for (int i = 0; i < options_.threads; ++i) workers_.emplace_back(&CacheWarmer::WorkerLoop, this);
+    return true;
+}
+
+void CacheWarmer::Pause() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    paused_ = true;
+    if (state_ == CacheWarmState::Running || state_ == CacheWarmState::PowerHold) state_ = CacheWarmState::Paused;
+}
+
+void CacheWarmer::Resume() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        paused_ = false;
+        if (state_ == CacheWarmState::Paused) state_ = CacheWarmState::Running;
+    }
+    cv_.notify_all();
+}
+
+/**
+ * @brief The last worker to exit saves the checkpoint (or deletes it after a complete walk),
+ *        so Stop() only has to wait for the threads.
+ */
+void CacheWarmer::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    Join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_ == CacheWarmState::Running || state_ == CacheWarmState::Paused || state_ == CacheWarmState::PowerHold) {
+        state_ = CacheWarmState::Stopped;
+    }
+}
+
+void CacheWarmer::GetProgress(CacheWarmProgress& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out = progress_;
+    out.state = static_cast<int32_t>(state_);
+    out.walk_complete = walk_complete_ ? 1 : 0;
+}
+
+void CacheWarmer::Join() {
+    if (walker_.joinable()) walker_.join();
+    for (auto& worker : workers_) worker.join();
+    workers_.clear();
+}
+
+void CacheWarmer::WalkLoop() {
+    EnterBackgroundMode();
+    if (!Walk(root_, fs::path())) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        walk_complete_ = true;
+    }
+    cv_.notify_all();
+}
+
+/**
+ * @brief Depth-first, each directory's entries sorted by name. That visits files in the order
+ *        fs::path::compare() puts them, so one path is enough to say where a walk stopped:
+ *        a subtree sorting entirely before the checkpoint is skipped without being listed.
+ * @return false if the run was stopped.
+ */
+bool CacheWarmer::Walk(const fs::path& dir, const fs::path& relative) {
+    std::vector<fs::directory_entry> entries;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        entries.push_back(*it);
+    }
+    std::sort(entries.begin(), entries.end(), [](const fs::directory_entry& a, const fs::directory_entry& b) {
+        return a.path().filename().compare(b.path().filename()) < 0;
+    });
+
+    for (const auto& entry : entries) {
+        fs::path rel = relative / entry.path().filename();
+        std::error_code entry_ec;
+
+        if (entry.is_directory(entry_ec)) {
+            if (!options_.recursive || entry.is_symlink(entry_ec)) continue;
+            if (!resume_after_.empty() && !Contains(rel, resume_after_) && rel.compare(resume_after_) < 0) continue;
+            if (!Walk(entry.path(), rel)) return false;
+            continue;
+        }
+        if (!entry.is_regular_file(entry_ec)) continue;
+
+        const std::string extension = LowerAscii(entry.path().extension().u8string());
+        if (std::find(extensions_.begin(), extensions_.end(), extension) == extensions_.end()) continue;
+
+        if (!resume_after_.empty()) {
+            if (rel.compare(resume_after_) <= 0) continue;
+            resume_after_.clear();
+        }
+
+        const uint64_t size = entry.file_size(entry_ec);
+        if (entry_ec) continue;
+        const auto write_time = entry.last_write_time(entry_ec);
+        if (entry_ec) continue;
+
+        Item item{ entry.path(), size, static_cast<int64_t>(write_time.time_since_epoch().count()), 0 };
+        if (!Push(std::move(item), std::move(rel))) return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !stop_;
+}
+
+bool CacheWarmer::Push(Item&& item, fs::path&& relative) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return stop_ || (!paused_ && queue_.size() < kQueueDepth); });
+        if (stop_) return false;
+        item.sequence = next_sequence_++;
+        handed_.push_back({ item.sequence, std::move(relative), false });
+        queue_.push_back(std::move(item));
+        ++progress_.discovered;
+    }
+    cv_.notify_all();
+    return true;
+}
+
+void CacheWarmer::WorkerLoop() {
+    EnterBackgroundMode();
+    for (;;) {
+        Item item;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || walk_complete_ || !queue_.empty(); });
+            if (stop_ || queue_.empty()) break;
+            item = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        cv_.notify_all();
+        if (!Process(item)) break;
+        Complete(item.sequence);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (--workers_left_ > 0) return;
+    const bool drained = !stop_;
+    if (drained || limit_reached_) state_ = CacheWarmState::Finished;
+    lock.unlock();
+
+    if (drained) {
+        std::error_code ec;
+        if (!checkpoint_file_.empty()) fs::remove(checkpoint_file_, ec);
+    } else {
+        SaveCheckpoint();
+    }
+}
+
+/**
+ * @return false if the run was stopped before the file was finished.
+ */
+bool CacheWarmer::Process(const Item& item) {
+    if (!WaitUntilRunnable()) return false;
+    if (IsCached(item)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++progress_.cached;
+        return true;
+    }
+    if (!Throttle(item.size)) return false;
+
+    const bool stored = hooks_.generate(hooks_.context, item.path.c_str());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    progress_.bytes += item.size;
+    if (!stored) {
+        ++progress_.failed;
+        return true;
+    }
+    ++progress_.generated;
+    if (options_.max_generated != 0 && progress_.generated >= options_.max_generated) {
+        limit_reached_ = true;
+        stop_ = true;
+        cv_.notify_all();
+    }
+    return true;
+}
+
+/**
+ * @brief Blocks while the run is paused or the `can_run` hook says no; the hook is called
+ *        without the lock held, since the owner may query progress from inside it.
+ * @return false if the run was stopped.
+ */
+bool CacheWarmer::WaitUntilRunnable() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        if (stop_) return false;
+        if (paused_) {
+            cv_.wait(lock);
+            continue;
+        }
+        lock.unlock();
+        const bool allowed = !hooks_.can_run || hooks_.can_run(hooks_.context);
+        lock.lock();
+        if (allowed) {
+            if (stop_ || paused_) continue;
+            state_ = CacheWarmState::Running;
+            return true;
+        }
+        state_ = CacheWarmState::PowerHold;
+        cv_.wait_for(lock, kPowerPollInterval, [this] { return stop_; });
+    }
+}
+
+/**
+ * @brief Spaces files out so that, over time, no more than `max_bytes_per_second` of source
+ *        data is handed to the hook. Each file books the interval its size is worth, starting
+ *        where the previous booking ended; an idle period does not build up credit.
+ * @return false if the run was stopped while waiting.
+ */
+bool CacheWarmer::Throttle(uint64_t bytes) {
+    if (options_.max_bytes_per_second == 0) return true;
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto start = std::max(std::chrono::steady_clock::now(), throttle_until_);
+    throttle_until_ = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(bytes) / static_cast<double>(options_.max_bytes_per_second)));
+    return !cv_.wait_until(lock, start, [this] { return stop_; });
+}
+
+/**
+ * @brief A hit by path is the common case. A miss is retried by content fingerprint, as the
+ *        viewer's own lookup does, and a hit there aliases the new path to the existing entry.
+ */
+bool CacheWarmer::IsCached(const Item& item) {
+    const std::string utf8_path = item.path.u8string();
+    ThumbnailView view;
+    if (store_.Get(utf8_path, item.mtime, view)) {
+        store_.Release(view);
+        return true;
+    }
+    const uint64_t fingerprint = ContentFingerprint::ComputeFile(item.path);
+    if (!fingerprint || !store_.GetByFingerprint(fingerprint, item.mtime, view)) return false;
+    store_.Release(view);
+    store_.Alias(utf8_path, item.mtime, fingerprint);
+    return true;
+}
+
+/**
+ * @brief Files finish out of order across workers; the checkpoint only moves past a file once
+ *        every file handed out before it has finished too.
+ */
+void CacheWarmer::Complete(uint64_t sequence) {
+    bool save = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handed_[static_cast<size_t>(sequence - handed_.front().sequence)].done = true;
+        bool advanced = false;
+        while (!handed_.empty() && handed_.front().done) {
+            checkpoint_ = std::move(handed_.front().relative);
+            handed_.pop_front();
+            advanced = true;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        save = advanced && !checkpoint_file_.empty() &&
+               now - last_checkpoint_ >= std::chrono::milliseconds(options_.checkpoint_interval_ms);
+        if (save) last_checkpoint_ = now;
+    }
+    if (save) SaveCheckpoint();
+}
+
+bool CacheWarmer::LoadCheckpoint() {
+    if (checkpoint_file_.empty()) return false;
+    std::ifstream stream(checkpoint_file_, std::ios::binary);
+    std::string magic, root, relative;
+    if (!stream || !std::getline(stream, magic) || !std::getline(stream, root) || !std::getline(stream, relative)) return false;
+    if (magic != kCheckpointMagic || root != root_.u8string() || relative.empty()) return false;
+    resume_after_ = fs::u8path(relative);
+    return true;
+}
+
+/**
+ * @brief Writes the checkpoint to a temporary file and renames it over the old one, so a crash
+ *        mid-write leaves the previous checkpoint intact.
+ */
+void CacheWarmer::SaveCheckpoint() {
+    if (checkpoint_file_.empty()) return;
+    std::lock_guard<std::mutex> guard(checkpoint_mutex_);
+    fs::path relative;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        relative = checkpoint_;
+    }
+    if (relative.empty()) return;
+
+    std::error_code ec;
+    fs::create_directories(checkpoint_file_.parent_path(), ec);
+    fs::path temp = checkpoint_file_;
+    temp += ".tmp";
+    {
+        std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+        if (!stream) return;
+        stream << kCheckpointMagic << '\n' << root_.u8string() << '\n' << relative.u8string() << '\n';
+        if (!stream.flush()) {
+            stream.close();
+            fs::remove(temp, ec);
+            return;
+        }
+    }
+    fs::rename(temp, checkpoint_file_, ec);
+    if (ec) fs::remove(temp, ec);
+}
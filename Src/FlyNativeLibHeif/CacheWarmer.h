@@ -0,0 +1,171 @@
+/**
+ * @file CacheWarmer.h
+ * @brief Declares CacheWarmer, a background walker that fills the thumbnail store ahead of use.
+ *
+ * The viewer writes a preview to the ThumbnailStore only for photos that passed through its
+ * sliding window, so the first visit to most of a large folder still decodes every photo.
+ * CacheWarmer walks a folder (or a whole library tree) on background-priority threads and
+ * has every photo the store does not hold yet generated, so opening it later is a cache hit.
+ *
+ * - Decoding stays with the owner: the store must hold exactly what the application's own
+ *   preview pipeline produces, so the warmer calls the `generate` hook for each missing
+ *   file. Files the store already holds, by path or by content fingerprint, are skipped
+ *   without a decode.
+ * - Source bytes handed to the hook are throttled to a rate, and the `can_run` hook is polled
+ *   before each file so the owner can hold the warmer on battery or in energy saver.
+ *   Pause() and Resume() hold it explicitly.
+ * - Each directory is listed in sorted order, so files are handed out in path order. The last
+ *   path up to which every file is finished is saved to a checkpoint file now and then, and a
+ *   later Start() with the same checkpoint skips everything up to it. A completed walk
+ *   deletes the checkpoint.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef CACHE_WARMER_H
+#define CACHE_WARMER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ThumbnailStore;
+
+/// @brief Path characters handed to the hooks: UTF-16 on Windows, UTF-8 elsewhere.
+using CacheWarmChar = std::filesystem::path::value_type;
+
+/// @brief State of a warm-up run.
+enum class CacheWarmState : int32_t {
+    Idle = 0,           ///< Never started.
+    Running = 1,
+    Paused = 2,         ///< Held by Pause().
+    PowerHold = 3,      ///< Held because the `can_run` hook returned false.
+    Finished = 4,       ///< The walk completed, or the generation limit was reached.
+    Stopped = 5,        ///< Stop() was called before the walk completed.
+};
+
+/// @brief Callbacks into the owner. Blittable for P/Invoke.
+struct CacheWarmHooks {
+    /// Generates and stores the preview of `path`. Called on a worker thread; returns true if it was stored.
+    bool (*generate)(void* context, const CacheWarmChar* path);
+    /// Returns true if warming may run now. Optional; called before each file.
+    bool (*can_run)(void* context);
+    void* context;
+};
+
+/// @brief Tuning of a run. Blittable for P/Invoke; zero fields take the defaults.
+struct CacheWarmOptions {
+    int32_t threads;                    ///< Worker threads; 0 for half the hardware threads.
+    int32_t recursive;                  ///< Non-zero to walk subdirectories too.
+    uint64_t max_bytes_per_second;      ///< Source bytes per second handed to `generate`; 0 for no limit.
+    uint32_t max_generated;             ///< Stop after this many previews were generated; 0 for no limit.
+    uint32_t checkpoint_interval_ms;    ///< Minimum time between checkpoint writes; 0 for 5 seconds.
+};
+
+/// @brief Counters reported by CacheWarmer::GetProgress(). Blittable for P/Invoke.
+struct CacheWarmProgress {
+    uint64_t discovered;        ///< Matching files listed so far (after the checkpoint, if resuming).
+    uint64_t cached;            ///< Files the store already held; skipped.
+    uint64_t generated;         ///< Files `generate` stored.
+    uint64_t failed;            ///< Files `generate` could not store.
+    uint64_t bytes;             ///< Source bytes handed to `generate`.
+    int32_t state;              ///< A CacheWarmState value.
+    int32_t walk_complete;      ///< 1 once every directory has been listed, so `discovered` is the total.
+};
+
+/// @brief Walks a folder on background threads and generates missing thumbnail store entries.
+class CacheWarmer {
+public:
+    /// @brief The store must stay open until the warmer is stopped or destroyed.
+    CacheWarmer(ThumbnailStore& store, const CacheWarmHooks& hooks);
+    ~CacheWarmer();
+
+    CacheWarmer(const CacheWarmer&) = delete;
+    CacheWarmer& operator=(const CacheWarmer&) = delete;
+
+    /// @brief Starts warming `root`, ending any previous run first.
+    /// @param extensions Lower-case extensions including the dot (".jpg") to include.
+    /// @param checkpoint_file Where progress is saved for resuming; empty for none.
+    /// @return false if `root` is not a directory or `generate` is missing.
+    bool Start(const std::filesystem::path& root, const std::vector<std::string>& extensions,
+               const std::filesystem::path& checkpoint_file, const CacheWarmOptions& options);
+
+    /// @brief Holds the workers after their current file.
+    void Pause();
+
+    /// @brief Lets a paused run continue.
+    void Resume();
+
+    /// @brief Ends the run, waits for the files in progress and saves the checkpoint.
+    void Stop();
+
+    /// @brief Snapshot of the counters and state.
+    void GetProgress(CacheWarmProgress& out) const;
+
+private:
+    struct Item {
+        std::filesystem::path path;
+        uint64_t size;
+        int64_t mtime;
+        uint64_t sequence;
+    };
+
+    /// A file handed out, in walk order, until everything before it is finished too.
+    struct Handed {
+        uint64_t sequence;
+        std::filesystem::path relative;
+        bool done;
+    };
+
+    void WalkLoop();
+    bool Walk(const std::filesystem::path& dir, const std::filesystem::path& relative);
+    bool Push(Item&& item, std::filesystem::path&& relative);
+    void WorkerLoop();
+    bool Process(const Item& item);
+    bool WaitUntilRunnable();
+    bool Throttle(uint64_t bytes);
+    bool IsCached(const Item& item);
+    void Complete(uint64_t sequence);
+    void Join();
+    bool LoadCheckpoint();
+    void SaveCheckpoint();
+
+    ThumbnailStore& store_;
+    CacheWarmHooks hooks_;
+
+    // Fixed for the duration of a run.
+    std::filesystem::path root_;
+    std::filesystem::path checkpoint_file_;
+    std::vector<std::string> extensions_;
+    CacheWarmOptions options_{};
+    std::filesystem::path resume_after_;        // Walker only.
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Item> queue_;
+    std::deque<Handed> handed_;
+    std::filesystem::path checkpoint_;          // Every file up to this relative path is finished.
+    std::chrono::steady_clock::time_point last_checkpoint_{};
+    std::chrono::steady_clock::time_point throttle_until_{};
+    uint64_t next_sequence_ = 0;
+    int workers_left_ = 0;
+    bool walk_complete_ = false;
+    bool paused_ = false;
+    bool stop_ = false;
+    bool limit_reached_ = false;
+    CacheWarmState state_ = CacheWarmState::Idle;
+    CacheWarmProgress progress_{};
+
+    std::mutex checkpoint_mutex_;               // Serialises checkpoint writes.
+    std::thread walker_;
+    std::vector<std::thread> workers_;
+};
+
+#endif // CACHE_WARMER_H
@@ -0,0 +1,58 @@
+/**
+ * @file ContentFingerprint.cpp
+ * @brief Implements ContentFingerprint.
+ */
+
+#include "ContentFingerprint.h"
+#include "ExifParser.h"
+#include "FileSource.h"
+#include "ImageProbe.h"
+
+#include <algorithm>
+#include <vector>
+
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+
+namespace {
+
+    /// Distinguishes these hashes from any other use of XXH3 with the default seed.
+    constexpr uint64_t kSeed = 0x46594650;   // "FYFP"
+}
+
+/**
+ * @brief Hashes size, capture time, head and tail. The capture time is read from the head
+ *        already in memory, so formats that keep EXIF further in (some HEIF files) hash it
+ *        as 0; that is consistent for a given file, which is all a key needs.
+ */
+uint64_t ContentFingerprint::Compute(ByteSource& source) {
+    const uint64_t size = source.Size();
+    if (size == 0) return 0;
+
+    const size_t head_size = static_cast<size_t>(std::min<uint64_t>(size, kSampleBytes));
+    const uint64_t tail_offset = std::max<uint64_t>(head_size, size - std::min<uint64_t>(size, kSampleBytes));
+    const size_t tail_size = static_cast<size_t>(size - tail_offset);
+
+    std::vector<uint8_t> buffer(head_size + tail_size);
+    if (!source.ReadExact(0, buffer.data(), head_size)) return 0;
+    if (tail_size && !source.ReadExact(tail_offset, buffer.data() + head_size, tail_size)) return 0;
+
+    ExifInfo exif;
+    ImageProbeInfo info;
+    MemoryByteSource head(buffer.data(), head_size);
+    ImageProbe::Probe(head, info, &exif);
+
+    XXH3_state_t state;
+    XXH3_64bits_reset_withSeed(&state, kSeed);
+    XXH3_64bits_update(&state, &size, sizeof(size));
+    XXH3_64bits_update(&state, &exif.capture_time, sizeof(exif.capture_time));
+    XXH3_64bits_update(&state, buffer.data(), buffer.size());
+    const uint64_t hash = XXH3_64bits_digest(&state);
+    return hash ? hash : 1;
+}
+
+uint64_t ContentFingerprint::ComputeFile(const std::filesystem::path& path) {
+    FileByteSource file;
+    if (!file.Open(path)) return 0;
+    return Compute(file);
+}
@@ -0,0 +1,43 @@
+/**
+ * @file ContentFingerprint.h
+ * @brief Declares ContentFingerprint, a cheap identity for image files that survives moves.
+ *
+ * The thumbnail store is keyed by path, so renaming or moving a folder used to orphan every
+ * entry in it. The fingerprint identifies a file by what it contains instead: xxHash3 over
+ * the file size, the EXIF capture time and the first and last 64 KB. Two files only share a
+ * fingerprint if they agree on all of these, which for photos means they are copies.
+ * Reading 128 KB is a small fraction of what decoding the file would cost.
+ *
+ * An edit in place that keeps the size and changes only the middle of the file keeps the
+ * fingerprint too, e.g. a retouched uncompressed TIFF, BMP or PSD. Lookups by fingerprint
+ * therefore also require the last write time the entry was stored with: a move or rename
+ * keeps it, and the edit changes it.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef CONTENT_FINGERPRINT_H
+#define CONTENT_FINGERPRINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+class ByteSource;
+
+/// @brief Computes content fingerprints of image files.
+class ContentFingerprint {
+public:
+    /// @brief Bytes hashed from each end of the file.
+    static constexpr size_t kSampleBytes = 64 * 1024;
+
+    /// @brief Fingerprints the data in `source`.
+    /// @return The fingerprint, never 0; 0 if the data is empty or cannot be read.
+    static uint64_t Compute(ByteSource& source);
+
+    /// @brief Opens `path` and fingerprints it. Returns 0 if the file cannot be read.
+    static uint64_t ComputeFile(const std::filesystem::path& path);
+};
+
+#endif // CONTENT_FINGERPRINT_H
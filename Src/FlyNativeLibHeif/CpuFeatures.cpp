@@ -0,0 +1,84 @@
+/**
+ * @file CpuFeatures.cpp
+ * @brief Implements CpuFeatures.
+ */
+
+#include "CpuFeatures.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLY_CPU_X64 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+#ifdef FLY_CPU_X64
+    void CpuId(int leaf, int subleaf, uint32_t regs[4]) {
+#ifdef _MSC_VER
+        int r[4];
+        __cpuidex(r, leaf, subleaf);
+        for (int i = 0; i < 4; ++i) regs[i] = static_cast<uint32_t>(r[i]);
+#else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    /// @brief Reads XCR0, i.e. which register states the OS saves on a context switch.
+    uint64_t ReadXcr0() {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        uint32_t eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+    }
+#endif
+}
+
+/** @brief Returns the level detected on the first call; thread-safe via the static initialiser. */
+SimdLevel CpuFeatures::Level() {
+    static const SimdLevel level = Detect();
+    return level;
+}
+
+/** @brief Maps a level to the lower-case name used in logs. */
+const char* CpuFeatures::Name(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Sse2:  return "sse2";
+    case SimdLevel::Sse41: return "sse4.1";
+    case SimdLevel::Avx2:  return "avx2";
+    case SimdLevel::Neon:  return "neon";
+    default:               return "scalar";
+    }
+}
+
+/**
+ * @brief Checks CPUID for SSE4.1 and AVX2. AVX2 also needs OSXSAVE and the YMM state
+ *        enabled in XCR0, otherwise the first 256-bit instruction faults.
+ */
+SimdLevel CpuFeatures::Detect() {
+#if defined(FLY_CPU_X64)
+    uint32_t regs[4];
+    CpuId(0, 0, regs);
+    const uint32_t max_leaf = regs[0];
+
+    CpuId(1, 0, regs);
+    const bool sse41 = (regs[2] & (1u << 19)) != 0;
+    const bool osxsave = (regs[2] & (1u << 27)) != 0;
+    const bool avx = (regs[2] & (1u << 28)) != 0;
+
+    if (max_leaf >= 7 && osxsave && avx && (ReadXcr0() & 0x6) == 0x6) {
+        CpuId(7, 0, regs);
+        if (regs[1] & (1u << 5)) return SimdLevel::Avx2;
+    }
+    return sse41 ? SimdLevel::Sse41 : SimdLevel::Sse2;
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    return SimdLevel::Neon;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
@@ -0,0 +1,38 @@
+/**
+ * @file CpuFeatures.h
+ * @brief Declares CpuFeatures, a one-time runtime check of the SIMD extensions available.
+ *
+ * Kernels that have vector variants query this once and keep a function pointer, rather
+ * than testing CPUID on every call. The result is also reported to the managed side through
+ * the FlyHeifApi capability table.
+ */
+
+#pragma once
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <cstdint>
+
+/// @brief The widest SIMD extension usable on this machine. Values are shared with the managed side.
+enum class SimdLevel : int32_t {
+    Scalar = 0,  ///< No vector extension is used.
+    Sse2,        ///< x86-64 baseline.
+    Sse41,       ///< SSE4.1 (blend, packus_epi32, pminud...).
+    Avx2,        ///< AVX2, with OS support for the YMM state.
+    Neon         ///< ARM64 Advanced SIMD.
+};
+
+/// @brief Runtime CPU feature detection.
+class CpuFeatures {
+public:
+    /// @brief Gets the detected SIMD level. Detected on first call, cached afterwards.
+    static SimdLevel Level();
+
+    /// @brief Gets a short name for a level ("avx2", "neon", ...).
+    static const char* Name(SimdLevel level);
+
+private:
+    static SimdLevel Detect();
+};
+
+#endif // CPU_FEATURES_H
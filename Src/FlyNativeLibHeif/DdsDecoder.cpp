@@ -0,0 +1,1192 @@
+/**
+ * @file DdsDecoder.cpp
+ * @brief Implements DdsDecoder.
+ */
+
+#include "DdsDecoder.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLY_DDS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    constexpr uint32_t kMagic = 0x20534444;             // "DDS "
+    constexpr uint32_t kHeaderSize = 124;
+
+    // DDS_HEADER.dwFlags
+    constexpr uint32_t kFlagMipCount = 0x20000;
+    constexpr uint32_t kFlagDepth = 0x800000;
+
+    // DDS_PIXELFORMAT.dwFlags
+    constexpr uint32_t kPfAlphaPixels = 0x1;
+    constexpr uint32_t kPfAlpha = 0x2;
+    constexpr uint32_t kPfFourCc = 0x4;
+    constexpr uint32_t kPfRgb = 0x40;
+    constexpr uint32_t kPfLuminance = 0x20000;
+
+    // DDS_HEADER.dwCaps2
+    constexpr uint32_t kCaps2Cubemap = 0x200;
+    constexpr uint32_t kCaps2CubemapFaces = 0xFC00;
+    constexpr uint32_t kCaps2Volume = 0x200000;
+
+    // DDS_HEADER_DXT10
+    constexpr uint32_t kDimensionTexture1D = 2;
+    constexpr uint32_t kDimensionTexture3D = 4;
+    constexpr uint32_t kMiscTextureCube = 0x4;
+    enum AlphaMode : uint32_t { AlphaUnknown = 0, AlphaStraight = 1, AlphaPremultiplied = 2, AlphaOpaque = 3, AlphaCustom = 4 };
+
+    /// Rows of blocks or pixels a worker takes at a time, and pixels below which no worker is started.
+    constexpr int32_t kRowsPerTask = 32;
+    constexpr int64_t kPixelsPerWorker = 1 << 16;
+
+    constexpr uint32_t FourCc(char a, char b, char c, char d) {
+        return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) |
+               (static_cast<uint32_t>(d) << 24);
+    }
+
+    uint16_t LE16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+    uint32_t LE32(const uint8_t* p) {
+        return p[0] | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    uint64_t LE64(const uint8_t* p) { return LE32(p) | (static_cast<uint64_t>(LE32(p + 4)) << 32); }
+
+    int32_t BitCount(uint32_t v) {
+        int32_t n = 0;
+        for (; v; v &= v - 1) ++n;
+        return n;
+    }
+
+    inline uint32_t Pack(uint32_t r, uint32_t g, uint32_t b, uint32_t a) { return b | (g << 8) | (r << 16) | (a << 24); }
+
+    /// round(c * a / 255) without a division.
+    inline uint32_t Scale(uint32_t c, uint32_t a) {
+        const uint32_t v = c * a + 128;
+        return (v + (v >> 8)) >> 8;
+    }
+
+    inline uint32_t Premultiply(uint32_t px) {
+        const uint32_t a = px >> 24;
+        if (a == 255) return px;
+        return Pack(Scale((px >> 16) & 0xFF, a), Scale((px >> 8) & 0xFF, a), Scale(px & 0xFF, a), a);
+    }
+
+    /// Writes a decoded 4x4 block to 4 rows of `bgra`.
+    inline void StoreBlock(const uint32_t* px, uint8_t* bgra, size_t stride) {
+        for (int y = 0; y < 4; ++y) std::memcpy(bgra + y * stride, px + y * 4, 16);
+    }
+
+    // ------------------------------------------------------------------------
+    // Float formats
+    // ------------------------------------------------------------------------
+
+    float HalfToFloat(uint16_t h) {
+        const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+        const uint32_t exponent = (h >> 10) & 31;
+        const uint32_t mantissa = h & 0x3FF;
+        if (exponent == 0) {
+            const float value = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+            return sign ? -value : value;
+        }
+        const uint32_t bits = exponent == 31 ? sign | 0x7F800000 | (mantissa << 13) : sign | ((exponent + 112) << 23) | (mantissa << 13);
+        float value;
+        std::memcpy(&value, &bits, 4);
+        return value;
+    }
+
+    /// [0, 1] to a byte, rounded; negatives and NaN are 0.
+    inline uint8_t UnitToByte(float v) {
+        if (!(v > 0.0f)) return 0;
+        if (v >= 1.0f) return 255;
+        return static_cast<uint8_t>(v * 255.0f + 0.5f);
+    }
+
+    /// UnitToByte() of every half-float bit pattern, built once.
+    const uint8_t* HalfToByte() {
+        static const std::vector<uint8_t> table = [] {
+            std::vector<uint8_t> t(65536);
+            for (uint32_t h = 0; h < 65536; ++h) t[h] = UnitToByte(HalfToFloat(static_cast<uint16_t>(h)));
+            return t;
+        }();
+        return table.data();
+    }
+
+    /// An unsigned float with a 5-bit exponent, as in R11G11B10, widened to half precision.
+    inline uint16_t SmallFloatToHalf(uint32_t v, int mantissa_bits) {
+        return static_cast<uint16_t>(((v >> mantissa_bits) << 10) | ((v & ((1u << mantissa_bits) - 1)) << (10 - mantissa_bits)));
+    }
+
+    float LoadFloat(const uint8_t* p) {
+        const uint32_t bits = LE32(p);
+        float value;
+        std::memcpy(&value, &bits, 4);
+        return value;
+    }
+
+    inline uint8_t Narrow16(uint32_t v) { return static_cast<uint8_t>((v * 255 + 32767) / 65535); }
+
+    // ------------------------------------------------------------------------
+    // BC1-BC5
+    // ------------------------------------------------------------------------
+
+    /// The four colours of a BC1 colour block. Three colours and transparent black when c0 <= c1,
+    /// unless the block is part of BC2 or BC3, which always use four.
+    void ColorPalette(const uint8_t* block, bool four_colors, uint32_t palette[4]) {
+        const uint32_t c0 = LE16(block), c1 = LE16(block + 2);
+        const uint32_t r0 = ((c0 >> 11) << 3) | (c0 >> 13), g0 = (((c0 >> 5) & 63) << 2) | ((c0 >> 9) & 3), b0 = ((c0 & 31) << 3) | ((c0 >> 2) & 7);
+        const uint32_t r1 = ((c1 >> 11) << 3) | (c1 >> 13), g1 = (((c1 >> 5) & 63) << 2) | ((c1 >> 9) & 3), b1 = ((c1 & 31) << 3) | ((c1 >> 2) & 7);
+        palette[0] = Pack(r0, g0, b0, 255);
+        palette[1] = Pack(r1, g1, b1, 255);
+        if (four_colors || c0 > c1) {
+            palette[2] = Pack((2 * r0 + r1 + 1) / 3, (2 * g0 + g1 + 1) / 3, (2 * b0 + b1 + 1) / 3, 255);
+            palette[3] = Pack((r0 + 2 * r1 + 1) / 3, (g0 + 2 * g1 + 1) / 3, (b0 + 2 * b1 + 1) / 3, 255);
+        } else {
+            palette[2] = Pack((r0 + r1 + 1) / 2, (g0 + g1 + 1) / 2, (b0 + b1 + 1) / 2, 255);
+            palette[3] = 0;
+        }
+    }
+
+    /// The eight values of a BC3 alpha or BC4 channel block, unsigned.
+    void ChannelPalette(const uint8_t* block, uint8_t palette[8]) {
+        const uint32_t a0 = block[0], a1 = block[1];
+        palette[0] = static_cast<uint8_t>(a0);
+        palette[1] = static_cast<uint8_t>(a1);
+        if (a0 > a1) {
+            for (uint32_t i = 1; i < 7; ++i) palette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1 + 3) / 7);
+        } else {
+            for (uint32_t i = 1; i < 5; ++i) palette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1 + 2) / 5);
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    /// The eight values of a BC4 or BC5 SNORM channel block, mapped from [-127, 127] to [0, 255].
+    /// -128 is read as -127, but the mode is chosen on the stored values, as Direct3D does.
+    void SignedChannelPalette(const uint8_t* block, uint8_t palette[8]) {
+        const int32_t a0 = std::max<int32_t>(static_cast<int8_t>(block[0]), -127);
+        const int32_t a1 = std::max<int32_t>(static_cast<int8_t>(block[1]), -127);
+        int32_t values[8] = {a0, a1};
+        auto lerp = [](int32_t x, int32_t y, int32_t wx, int32_t wy, int32_t d) {
+            const int32_t v = wx * x + wy * y;
+            return (v >= 0 ? v + d / 2 : v - d / 2) / d;
+        };
+        if (static_cast<int8_t>(block[0]) > static_cast<int8_t>(block[1])) {
+            for (int32_t i = 1; i < 7; ++i) values[i + 1] = lerp(a0, a1, 7 - i, i, 7);
+        } else {
+            for (int32_t i = 1; i < 5; ++i) values[i + 1] = lerp(a0, a1, 5 - i, i, 5);
+            values[6] = -127;
+            values[7] = 127;
+        }
+        for (int i = 0; i < 8; ++i) palette[i] = static_cast<uint8_t>(((values[i] + 127) * 255 + 127) / 254);
+    }
+
+    /// The 16 values of a BC3 alpha or BC4 channel block.
+    void DecodeChannel(const uint8_t* block, bool is_signed, uint8_t out[16]) {
+        uint8_t palette[8];
+        if (is_signed) SignedChannelPalette(block, palette);
+        else ChannelPalette(block, palette);
+        const uint64_t indices = LE64(block) >> 16;
+        for (int i = 0; i < 16; ++i) out[i] = palette[(indices >> (3 * i)) & 7];
+    }
+
+    /// The 16 alpha values of a BC2 block, 4 bits each.
+    void DecodeExplicitAlpha(const uint8_t* block, uint8_t out[16]) {
+        const uint64_t bits = LE64(block);
+        for (int i = 0; i < 16; ++i) out[i] = static_cast<uint8_t>(((bits >> (4 * i)) & 15) * 17);
+    }
+
+    void DecodeColor(const uint8_t* block, bool four_colors, uint32_t px[16]) {
+        uint32_t palette[4];
+        ColorPalette(block, four_colors, palette);
+        const uint32_t indices = LE32(block + 4);
+        for (int i = 0; i < 16; ++i) px[i] = palette[(indices >> (2 * i)) & 3];
+    }
+
+    void DecodeBc1Scalar(const uint8_t* blocks, int32_t count, uint8_t* bgra, size_t stride, bool) {
+        uint32_t px[16];
+        for (int32_t i = 0; i < count; ++i, blocks += 8, bgra += 16) {
+            DecodeColor(blocks, false, px);
+            StoreBlock(px, bgra, stride);
+        }
+    }
+
+    /// BC2 and BC3: a colour block after an alpha block.
+    template <bool Explicit>
+    void DecodeBc23Scalar(const uint8_t* blocks, int32_t count, uint8_t* bgra, size_t stride, bool straight) {
+        uint32_t px[16];
+        uint8_t alpha[16];
+        for (int32_t i = 0; i < count; ++i, blocks += 16, bgra += 16) {
+            if (Explicit) DecodeExplicitAlpha(blocks, alpha);
+            else DecodeChannel(blocks, false, alpha);
+            DecodeColor(blocks + 8, true, px);
+            for (int p = 0; p < 16; ++p) {
+                px[p] = (px[p] & 0x00FFFFFF) | (static_cast<uint32_t>(alpha[p]) << 24);
+                if (straight) px[p] = Premultiply(px[p]);
+            }
+            StoreBlock(px, bgra, stride);
+        }
+    }
+
+    void DecodeBc4(const uint8_t* block, bool is_signed, uint32_t px[16]) {
+        uint8_t red[16];
+        DecodeChannel(block, is_signed, red);
+        for (int i = 0; i < 16; ++i) px[i] = Pack(red[i], red[i], red[i], 255);
+    }
+
+    void DecodeBc5(const uint8_t* block, bool is_signed, uint32_t px[16]) {
+        uint8_t red[16], green[16];
+        DecodeChannel(block, is_signed, red);
+        DecodeChannel(block + 8, is_signed, green);
+        // Blue is zero in the texture's own range: 0 for UNORM, the middle of [-1, 1] for SNORM.
+        const uint32_t blue = is_signed ? 128 : 0;
+        for (int i = 0; i < 16; ++i) px[i] = Pack(red[i], green[i], blue, 255);
+    }
+
+    // ------------------------------------------------------------------------
+    // BC6H and BC7
+    // ------------------------------------------------------------------------
+
+    /// Reads a 128-bit block from its least significant bit up, shifting the block down as it goes.
+    class BlockBits {
+    public:
+        explicit BlockBits(const uint8_t* block) : lo_(LE64(block)), hi_(LE64(block + 8)) {}
+
+        /// Up to 16 bits.
+        uint32_t Read(uint32_t count) {
+            const uint32_t v = static_cast<uint32_t>(lo_) & ((1u << count) - 1);
+            lo_ = (lo_ >> count) | ((hi_ << 1) << (63 - count));
+            hi_ >>= count;
+            return v;
+        }
+
+        /// Reads `count` bits into `field` starting at bit `at`.
+        void Into(int32_t& field, uint32_t at, uint32_t count) { field |= static_cast<int32_t>(Read(count) << at); }
+
+    private:
+        uint64_t lo_;
+        uint64_t hi_;
+    };
+
+    // Subset of each pixel for the 64 two-subset and three-subset partitions. BC6H uses the first
+    // 32 two-subset ones.
+    const uint8_t kPartition2[64][16] = {
+        {0,0,1,1,0,0,1,1,0,0,1,1,0,0,1,1}, {0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1}, {0,1,1,1,0,1,1,1,0,1,1,1,0,1,1,1}, {0,0,0,1,0,0,1,1,0,0,1,1,0,1,1,1},
+        {0,0,0,0,0,0,0,1,0,0,0,1,0,0,1,1}, {0,0,1,1,0,1,1,1,0,1,1,1,1,1,1,1}, {0,0,0,1,0,0,1,1,0,1,1,1,1,1,1,1}, {0,0,0,0,0,0,0,1,0,0,1,1,0,1,1,1},
+        {0,0,0,0,0,0,0,0,0,0,0,1,0,0,1,1}, {0,0,1,1,0,1,1,1,1,1,1,1,1,1,1,1}, {0,0,0,0,0,0,0,1,0,1,1,1,1,1,1,1}, {0,0,0,0,0,0,0,0,0,0,0,1,0,1,1,1},
+        {0,0,0,1,0,1,1,1,1,1,1,1,1,1,1,1}, {0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1}, {0,0,0,0,1,1,1,1,1,1,1,1,1,1,1,1}, {0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1},
+        {0,0,0,0,1,0,0,0,1,1,1,0,1,1,1,1}, {0,1,1,1,0,0,0,1,0,0,0,0,0,0,0,0}, {0,0,0,0,0,0,0,0,1,0,0,0,1,1,1,0}, {0,1,1,1,0,0,1,1,0,0,0,1,0,0,0,0},
+        {0,0,1,1,0,0,0,1,0,0,0,0,0,0,0,0}, {0,0,0,0,1,0,0,0,1,1,0,0,1,1,1,0}, {0,0,0,0,0,0,0,0,1,0,0,0,1,1,0,0}, {0,1,1,1,0,0,1,1,0,0,1,1,0,0,0,1},
+        {0,0,1,1,0,0,0,1,0,0,0,1,0,0,0,0}, {0,0,0,0,1,0,0,0,1,0,0,0,1,1,0,0}, {0,1,1,0,0,1,1,0,0,1,1,0,0,1,1,0}, {0,0,1,1,0,1,1,0,0,1,1,0,1,1,0,0},
+        {0,0,0,1,0,1,1,1,1,1,1,0,1,0,0,0}, {0,0,0,0,1,1,1,1,1,1,1,1,0,0,0,0}, {0,1,1,1,0,0,0,1,1,0,0,0,1,1,1,0}, {0,0,1,1,1,0,0,1,1,0,0,1,1,1,0,0},
+        {0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1}, {0,0,0,0,1,1,1,1,0,0,0,0,1,1,1,1}, {0,1,0,1,1,0,1,0,0,1,0,1,1,0,1,0}, {0,0,1,1,0,0,1,1,1,1,0,0,1,1,0,0},
+        {0,0,1,1,1,1,0,0,0,0,1,1,1,1,0,0}, {0,1,0,1,0,1,0,1,1,0,1,0,1,0,1,0}, {0,1,1,0,1,0,0,1,0,1,1,0,1,0,0,1}, {0,1,0,1,1,0,1,0,1,0,1,0,0,1,0,1},
+        {0,1,1,1,0,0,1,1,1,1,0,0,1,1,1,0}, {0,0,0,1,0,0,1,1,1,1,0,0,1,0,0,0}, {0,0,1,1,0,0,1,0,0,1,0,0,1,1,0,0}, {0,0,1,1,1,0,1,1,1,1,0,1,1,1,0,0},
+        {0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0}, {0,0,1,1,1,1,0,0,1,1,0,0,0,0,1,1}, {0,1,1,0,0,1,1,0,1,0,0,1,1,0,0,1}, {0,0,0,0,0,1,1,0,0,1,1,0,0,0,0,0},
+        {0,1,0,0,1,1,1,0,0,1,0,0,0,0,0,0}, {0,0,1,0,0,1,1,1,0,0,1,0,0,0,0,0}, {0,0,0,0,0,0,1,0,0,1,1,1,0,0,1,0}, {0,0,0,0,0,1,0,0,1,1,1,0,0,1,0,0},
+        {0,1,1,0,1,1,0,0,1,0,0,1,0,0,1,1}, {0,0,1,1,0,1,1,0,1,1,0,0,1,0,0,1}, {0,1,1,0,0,0,1,1,1,0,0,1,1,1,0,0}, {0,0,1,1,1,0,0,1,1,1,0,0,0,1,1,0},
+        {0,1,1,0,1,1,0,0,1,1,0,0,1,0,0,1}, {0,1,1,0,0,0,1,1,0,0,1,1,1,0,0,1}, {0,1,1,1,1,1,1,0,1,0,0,0,0,0,0,1}, {0,0,0,1,1,0,0,0,1,1,1,0,0,1,1,1},
+        {0,0,0,0,1,1,1,1,0,0,1,1,0,0,1,1}, {0,0,1,1,0,0,1,1,1,1,1,1,0,0,0,0}, {0,0,1,0,0,0,1,0,1,1,1,0,1,1,1,0}, {0,1,0,0,0,1,0,0,0,1,1,1,0,1,1,1},
+    };
+
+    const uint8_t kPartition3[64][16] = {
+        {0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2}, {0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1}, {0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1}, {0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1},
+        {0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2}, {0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2}, {0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1}, {0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1},
+        {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2}, {0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2}, {0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2}, {0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2},
+        {0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2}, {0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2}, {0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2}, {0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0},
+        {0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2}, {0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0}, {0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2}, {0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1},
+        {0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2}, {0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1}, {0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2}, {0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0},
+        {0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0}, {0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2}, {0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0}, {0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1},
+        {0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2}, {0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2}, {0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1}, {0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1},
+        {0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2}, {0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1}, {0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2}, {0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0},
+        {0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0}, {0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0}, {0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0}, {0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1},
+        {0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1}, {0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2}, {0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1}, {0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2},
+        {0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1}, {0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1}, {0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1}, {0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1},
+        {0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2}, {0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1}, {0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2}, {0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2},
+        {0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2}, {0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2}, {0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2}, {0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2},
+        {0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2}, {0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2}, {0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2}, {0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2},
+        {0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1}, {0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2}, {0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2}, {0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0},
+    };
+
+    // The pixel whose index drops its top bit: subset 1 of the two-subset partitions, and subsets
+    // 1 and 2 of the three-subset ones. Subset 0's is always pixel 0.
+    const uint8_t kAnchor2[64] = {
+        15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15, 15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+        15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,  6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15,
+    };
+    const uint8_t kAnchor3a[64] = {
+         3, 3,15,15, 8, 3,15,15,  8, 8, 6, 6, 6, 5, 3, 3,  3, 3, 8,15, 3, 3, 6,10,  5, 8, 8, 6, 8, 5,15,15,
+         8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15,  3,15, 5, 5, 5, 8, 5,10,  5,10, 8,13,15,12, 3, 3,
+    };
+    const uint8_t kAnchor3b[64] = {
+        15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8, 15, 8,15, 3,15, 8,15, 8,  3,15, 6,10,15,15,10, 8,
+        15, 3,15,10,10, 8, 9,10,  6,15, 8,15, 3, 6, 6, 8, 15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8,
+    };
+
+    const uint8_t kWeights2[4] = {0, 21, 43, 64};
+    const uint8_t kWeights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+    const uint8_t kWeights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    const uint8_t* Weights(uint32_t bits) { return bits == 2 ? kWeights2 : bits == 3 ? kWeights3 : kWeights4; }
+
+    inline int32_t Interpolate(int32_t e0, int32_t e1, uint32_t weight) {
+        return (e0 * (64 - static_cast<int32_t>(weight)) + e1 * static_cast<int32_t>(weight) + 32) >> 6;
+    }
+
+    /// Reads 16 indices of `bits` bits; anchor pixels have one bit fewer.
+    void ReadIndices(BlockBits& in, uint32_t bits, int32_t subsets, uint32_t partition, uint8_t out[16]) {
+        for (uint32_t i = 0; i < 16; ++i) {
+            const bool anchor = i == 0 || (subsets == 2 && i == kAnchor2[partition]) ||
+                                (subsets == 3 && (i == kAnchor3a[partition] || i == kAnchor3b[partition]));
+            out[i] = static_cast<uint8_t>(in.Read(anchor ? bits - 1 : bits));
+        }
+    }
+
+    struct Bc7Mode {
+        uint8_t subsets;
+        uint8_t partition_bits;
+        uint8_t rotation_bits;
+        uint8_t selector_bits;          // Index selection: which index set the alpha uses.
+        uint8_t color_bits;
+        uint8_t alpha_bits;
+        uint8_t endpoint_pbits;         // One p-bit per endpoint.
+        uint8_t shared_pbits;           // One p-bit per subset.
+        uint8_t index_bits;
+        uint8_t index2_bits;
+    };
+
+    const Bc7Mode kBc7Modes[8] = {
+        {3, 4, 0, 0, 4, 0, 1, 0, 3, 0}, {2, 6, 0, 0, 6, 0, 0, 1, 3, 0}, {3, 6, 0, 0, 5, 0, 0, 0, 2, 0}, {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+        {1, 0, 2, 1, 5, 6, 0, 0, 2, 3}, {1, 0, 2, 0, 7, 8, 0, 0, 2, 2}, {1, 0, 0, 0, 7, 7, 1, 0, 4, 0}, {2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+    };
+
+    /// Widens a `bits`-bit value to 8 bits by repeating its top bits.
+    inline int32_t Widen(int32_t v, uint32_t bits) {
+        v <<= 8 - bits;
+        return v | (v >> bits);
+    }
+
+    /// One BC7 block as straight BGRA. A reserved mode decodes to transparent black.
+    void DecodeBc7(const uint8_t* block, uint32_t px[16]) {
+        uint32_t mode = 0;
+        while (mode < 8 && !(block[0] & (1u << mode))) ++mode;
+        if (mode == 8) {
+            std::fill(px, px + 16, 0u);
+            return;
+        }
+        const Bc7Mode& m = kBc7Modes[mode];
+        BlockBits in(block);
+        in.Read(mode + 1);
+        const uint32_t partition = in.Read(m.partition_bits);
+        const uint32_t rotation = in.Read(m.rotation_bits);
+        const uint32_t selector = in.Read(m.selector_bits);
+
+        int32_t ep[3][2][4] = {};       // [subset][endpoint][r, g, b, a]
+        for (int c = 0; c < 3; ++c)
+            for (int s = 0; s < m.subsets; ++s)
+                for (int e = 0; e < 2; ++e) ep[s][e][c] = static_cast<int32_t>(in.Read(m.color_bits));
+        if (m.alpha_bits)
+            for (int s = 0; s < m.subsets; ++s)
+                for (int e = 0; e < 2; ++e) ep[s][e][3] = static_cast<int32_t>(in.Read(m.alpha_bits));
+
+        const uint32_t pbit = m.endpoint_pbits || m.shared_pbits ? 1 : 0;
+        for (int s = 0; s < m.subsets; ++s) {
+            uint32_t shared = m.shared_pbits ? in.Read(1) : 0;
+            for (int e = 0; e < 2; ++e) {
+                const uint32_t p = m.endpoint_pbits ? in.Read(1) : shared;
+                for (int c = 0; c < 4; ++c) {
+                    const uint32_t bits = c < 3 ? m.color_bits : m.alpha_bits;
+                    if (!bits) {
+                        ep[s][e][c] = 255;
+                        continue;
+                    }
+                    ep[s][e][c] = Widen(pbit ? (ep[s][e][c] << 1) | static_cast<int32_t>(p) : ep[s][e][c], bits + pbit);
+                }
+            }
+        }
+
+        uint8_t index[16], index2[16] = {};
+        ReadIndices(in, m.index_bits, m.subsets, partition, index);
+        if (m.index2_bits) ReadIndices(in, m.index2_bits, 1, 0, index2);
+        const uint8_t* color_weights = Weights(selector ? m.index2_bits : m.index_bits);
+        const uint8_t* alpha_weights = Weights(m.index2_bits && !selector ? m.index2_bits : m.index_bits);
+
+        for (int i = 0; i < 16; ++i) {
+            const int s = m.subsets == 1 ? 0 : m.subsets == 2 ? kPartition2[partition][i] : kPartition3[partition][i];
+            const uint32_t wc = color_weights[m.index2_bits && selector ? index2[i] : index[i]];
+            const uint32_t wa = alpha_weights[m.index2_bits && !selector ? index2[i] : index[i]];
+            int32_t rgba[4];
+            for (int c = 0; c < 3; ++c) rgba[c] = Interpolate(ep[s][0][c], ep[s][1][c], wc);
+            rgba[3] = Interpolate(ep[s][0][3], ep[s][1][3], wa);
+            if (rotation) std::swap(rgba[3], rgba[rotation - 1]);
+            px[i] = Pack(static_cast<uint32_t>(rgba[0]), static_cast<uint32_t>(rgba[1]), static_cast<uint32_t>(rgba[2]),
+                         static_cast<uint32_t>(rgba[3]));
+        }
+    }
+
+    struct Bc6Mode {
+        uint8_t bits;                   // The mode field, 2 or 5 bits.
+        uint8_t transformed;            // Endpoints after the first are deltas.
+        uint8_t subsets;
+        uint8_t endpoint_bits;
+        uint8_t delta_bits[3];
+    };
+
+    const Bc6Mode kBc6Modes[14] = {
+        {0x00, 1, 2, 10, {5, 5, 5}}, {0x01, 1, 2, 7, {6, 6, 6}}, {0x02, 1, 2, 11, {5, 4, 4}}, {0x06, 1, 2, 11, {4, 5, 4}},
+        {0x0A, 1, 2, 11, {4, 4, 5}}, {0x0E, 1, 2, 9, {5, 5, 5}}, {0x12, 1, 2, 8, {6, 5, 5}}, {0x16, 1, 2, 8, {5, 6, 5}},
+        {0x1A, 1, 2, 8, {5, 5, 6}}, {0x1E, 0, 2, 6, {6, 6, 6}}, {0x03, 0, 1, 10, {10, 10, 10}}, {0x07, 1, 1, 11, {9, 9, 9}},
+        {0x0B, 1, 1, 12, {8, 8, 8}}, {0x0F, 1, 1, 16, {4, 4, 4}},
+    };
+
+    inline int32_t SignExtend(int32_t v, uint32_t bits) {
+        const int32_t shift = 32 - static_cast<int32_t>(bits);
+        return static_cast<int32_t>(static_cast<uint32_t>(v) << shift) >> shift;
+    }
+
+    /// Reads the endpoints of BC6H mode `mode` as the bit layout scatters them: e[endpoint][r, g, b],
+    /// endpoints 0 and 1 of subset 0, then 2 and 3 of subset 1.
+    void ReadBc6Endpoints(BlockBits& in, int mode, int32_t e[4][3]) {
+        enum { R, G, B };
+        switch (mode) {
+        case 0:
+            in.Into(e[2][G], 4, 1); in.Into(e[2][B], 4, 1); in.Into(e[3][B], 4, 1);
+            in.Into(e[0][R], 0, 10); in.Into(e[0][G], 0, 10); in.Into(e[0][B], 0, 10);
+            in.Into(e[1][R], 0, 5); in.Into(e[3][G], 4, 1); in.Into(e[2][G], 0, 4); in.Into(e[1][G], 0, 5);
+            in.Into(e[3][B], 0, 1); in.Into(e[3][G], 0, 4); in.Into(e[1][B], 0, 5); in.Into(e[3][B], 1, 1);
+            in.Into(e[2][B], 0, 4); in.Into(e[2][R], 0, 5); in.Into(e[3][B], 2, 1); in.Into(e[3][R], 0, 5); in.Into(e[3][B], 3, 1);
+            break;
+        case 1:
+            in.Into(e[2][G], 5, 1); in.Into(e[3][G], 4, 1); in.Into(e[3][G], 5, 1);
+            in.Into(e[0][R], 0, 7); in.Into(e[3][B], 0, 1); in.Into(e[3][B], 1, 1); in.Into(e[2][B], 4, 1);
+            in.Into(e[0][G], 0, 7); in.Into(e[2][B], 5, 1); in.Into(e[3][B], 2, 1); in.Into(e[2][G], 4, 1);
+            in.Into(e[0][B], 0, 7); in.Into(e[3][B], 3, 1); in.Into(e[3][B], 5, 1); in.Into(e[3][B], 4, 1);
+            in.Into(e[1][R], 0, 6); in.Into(e[2][G], 0, 4); in.Into(e[1][G], 0, 6); in.Into(e[3][G], 0, 4);
+            in.Into(e[1][B], 0, 6); in.Into(e[2][B], 0, 4); in.Into(e[2][R], 0, 6); in.Into(e[3][R], 0, 6);
+            break;
+        case 2:
+            in.Into(e[0][R], 0, 10); in.Into(e[0][G], 0, 10); in.Into(e[0][B], 0, 10);
+            in.Into(e[1][R], 0, 5); in.Into(e[0][R], 10, 1); in.Into(e[2][G], 0, 4); in.Into(e[1][G], 0, 4);
+            in.Into(e[0][G], 10, 1); in.Into(e[3][B], 0, 1); in.Into(e[3][G], 0, 4); in.Into(e[1][B], 0, 4);
+            in.Into(e[0][B], 10, 1); in.Into(e[3][B], 1, 1); in.Into(e[2][B], 0, 4); in.Into(e[2][R], 0, 5);
+            in.Into(e[3][B], 2, 1); in.Into(e[3][R], 0, 5); in.Into(e[3][B], 3, 1);
+            break;
+        case 3:
+            in.Into(e[0][R], 0, 10); in.Into(e[0][G], 0, 10); in.Into(e[0][B], 0, 10);
+            in.Into(e[1][R], 0, 4); in.Into(e[0][R], 10, 1); in.Into(e[3][G], 4, 1); in.Into(e[2][G], 0, 4);
+            in.Into(e[1][G], 0, 5); in.Into(e[0][G], 10, 1); in.Into(e[3][G], 0, 4); in.Into(e[1][B], 0, 4);
+            in.Into(e[0][B], 10, 1); in.Into(e[3][B], 1, 1); in.Into(e[2][B], 0, 4); in.Into(e[2][R], 0, 4);
+            in.Into(e[3][B], 0, 1); in.Into(e[3][B], 2, 1); in.Into(e[3][R], 0, 4); in.Into(e[2][G], 4, 1); in.Into(e[3][B], 3, 1);
+            break;
+        case 4:
+            in.Into(e[0][R], 0, 10); in.Into(e[0][G], 0, 10); in.Into(e[0][B], 0, 10);
+            in.Into(e[1][R], 0, 4); in.Into(e[0][R], 10, 1); in.Into(e[2][B], 4, 1); in.Into(e[2][G], 0, 4);
+            in.Into(e[1][G], 0, 4); in.Into(e[0][G], 10, 1); in.Into(e[3][B], 0, 1); in.Into(e[3][G], 0, 4);
+            in.Into(e[1][B], 0, 5); in.Into(e[0][B], 10, 1); in.Into(e[2][B], 0, 4); in.Into(e[2][R], 0, 4);
+            in.Into(e[3][B], 1, 1); in.Into(e[3][B], 2, 1); in.Into(e[3][R], 0, 4); in.Into(e[3][B], 4, 1); in.Into(e[3][B], 3, 1);
+            break;
+        case 5:
+            in.Into(e[0][R], 0, 9); in.Into(e[2][B], 4, 1); in.Into(e[0][G], 0, 9); in.Into(e[2][G], 4, 1);
+            in.Into(e[0][B], 0, 9); in.Into(e[3][B], 4, 1); in.Into(e[1][R], 0, 5); in.Into(e[3][G], 4, 1);
+            in.Into(e[2][G], 0, 4); in.Into(e[1][G], 0, 5); in.Into(e[3][B], 0, 1); in.Into(e[3][G], 0, 4);
+            in.Into(e[1][B], 0, 5); in.Into(e[3][B], 1, 1); in.Into(e[2][B], 0, 4); in.Into(e[2][R], 0, 5);
+            in.Into(e[3][B], 2, 1); in.Into(e[3][R], 0, 5); in.Into(e[3][B], 3, 1);
+            break;
+        case 6:
+            in.Into(e[0][R], 0, 8); in.Into(e[3][G], 4, 1); in.Into(e[2][B], 4, 1); in.Into(e[0][G], 0, 8);
+            in.Into(e[3][B], 2, 1); in.Into(e[2][G], 4, 1); in.Into(e[0][B], 0, 8); in.Into(e[3][B], 3, 1);
+            in.Into(e[3][B], 4, 1); in.Into(e[1][R], 0, 6); in.Into(e[2][G], 0, 4); in.Into(e[1][G], 0, 5);
+            in.Into(e[3][B], 0, 1); in.Into(e[3][G], 0, 4); in.Into(e[1][B], 0, 5); in.Into(e[3][B], 1, 1);
+            in.Into(e[2][B], 0, 4); in.Into(e[2][R], 0, 6); in.Into(e[3][R], 0, 6);
+            break;
+        case 7:
+            in.Into(e[0][R], 0, 8); in.Into(e[3][B], 0, 1); in.Into(e[2][B], 4, 1); in.Into(e[0][G], 0, 8);
+            in.Into(e[2][G], 5, 1); in.Into(e[2][G], 4, 1); in.Into(e[0][B], 0, 8); in.Into(e[3][G], 5, 1);
+            in.Into(e[3][B], 4, 1); in.Into(e[1][R], 0, 5); in.Into(e[3][G], 4, 1); in.Into(e[2][G], 0, 4);
+            in.Into(e[1][G], 0, 6); in.Into(e[3][G], 0, 4); in.Into(e[1][B], 0, 5); in.Into(e[3][B], 1, 1);
+            in.Into(e[2][B], 0, 4); in.Into(e[2][R], 0, 5); in.Into(e[3][B], 2, 1); in.Into(e[3][R], 0, 5); in.Into(e[3][B], 3, 1);
+            break;
+        case 8:
+            in.Into(e[0][R], 0, 8); in.Into(e[3][B], 1, 1); in.Into(e[2][B], 4, 1); in.Into(e[0][G], 0, 8);
+            in.Into(e[2][B], 5, 1); in.Into(e[2][G], 4, 1); in.Into(e[0][B], 0, 8); in.Into(e[3][B], 5, 1);
+            in.Into(e[3][B], 4, 1); in.Into(e[1][R], 0, 5); in.Into(e[3][G], 4, 1); in.Into(e[2][G], 0, 4);
+            in.Into(e[1][G], 0, 5); in.Into(e[3][B], 0, 1); in.Into(e[3][G], 0, 4); in.Into(e[1][B], 0, 6);
+            in.Into(e[2][B], 0, 4); in.Into(e[2][R], 0, 5); in.Into(e[3][B], 2, 1); in.Into(e[3][R], 0, 5); in.Into(e[3][B], 3, 1);
+            break;
+        case 9:
+            in.Into(e[0][R], 0, 6); in.Into(e[3][G], 4, 1); in.Into(e[3][B], 0, 1); in.Into(e[3][B], 1, 1);
+            in.Into(e[2][B], 4, 1); in.Into(e[0][G], 0, 6); in.Into(e[2][G], 5, 1); in.Into(e[2][B], 5, 1);
+            in.Into(e[3][B], 2, 1); in.Into(e[2][G], 4, 1); in.Into(e[0][B], 0, 6); in.Into(e[3][G], 5, 1);
+            in.Into(e[3][B], 3, 1); in.Into(e[3][B], 5, 1); in.Into(e[3][B], 4, 1); in.Into(e[1][R], 0, 6);
+            in.Into(e[2][G], 0, 4); in.Into(e[1][G], 0, 6); in.Into(e[3][G], 0, 4); in.Into(e[1][B], 0, 6);
+            in.Into(e[2][B], 0, 4); in.Into(e[2][R], 0, 6); in.Into(e[3][R], 0, 6);
+            break;
+        case 10:
+            for (int c = 0; c < 3; ++c) in.Into(e[0][c], 0, 10);
+            for (int c = 0; c < 3; ++c) in.Into(e[1][c], 0, 10);
+            break;
+        case 11:
+            for (int c = 0; c < 3; ++c) in.Into(e[0][c], 0, 10);
+            for (int c = 0; c < 3; ++c) {
+                in.Into(e[1][c], 0, 9);
+                in.Into(e[0][c], 10, 1);
+            }
+            break;
+        case 12:
+            for (int c = 0; c < 3; ++c) in.Into(e[0][c], 0, 10);
+            for (int c = 0; c < 3; ++c) {
+                in.Into(e[1][c], 0, 8);
+                in.Into(e[0][c], 11, 1);
+                in.Into(e[0][c], 10, 1);
+            }
+            break;
+        case 13:
+            for (int c = 0; c < 3; ++c) in.Into(e[0][c], 0, 10);
+            for (int c = 0; c < 3; ++c) {
+                in.Into(e[1][c], 0, 4);
+                for (uint32_t bit = 15; bit >= 10; --bit) in.Into(e[0][c], bit, 1);
+            }
+            break;
+        }
+    }
+
+    inline int32_t UnquantizeBc6(int32_t v, uint32_t bits, bool is_signed) {
+        if (!is_signed) {
+            if (bits >= 15 || v == 0) return v;
+            if (v == (1 << bits) - 1) return 0xFFFF;
+            return ((v << 16) + 0x8000) >> bits;
+        }
+        if (bits >= 16) return v;
+        const bool negative = v < 0;
+        const int32_t magnitude = negative ? -v : v;
+        int32_t q;
+        if (magnitude == 0) q = 0;
+        else if (magnitude >= (1 << (bits - 1)) - 1) q = 0x7FFF;
+        else q = ((magnitude << 15) + 0x4000) >> (bits - 1);
+        return negative ? -q : q;
+    }
+
+    /// The interpolated value scaled to half-float bits.
+    inline uint16_t FinishBc6(int32_t v, bool is_signed) {
+        if (!is_signed) return static_cast<uint16_t>((v * 31) >> 6);
+        return v < 0 ? static_cast<uint16_t>(0x8000 | (((-v) * 31) >> 5)) : static_cast<uint16_t>((v * 31) >> 5);
+    }
+
+    /// One BC6H block as opaque BGRA. A reserved mode decodes to black.
+    void DecodeBc6(const uint8_t* block, bool is_signed, uint32_t px[16]) {
+        BlockBits in(block);
+        uint32_t bits = in.Read(2);
+        if (bits > 1) bits |= in.Read(3) << 2;
+        int mode = -1;
+        for (int i = 0; i < 14; ++i)
+            if (kBc6Modes[i].bits == bits) mode = i;
+        if (mode < 0) {
+            std::fill(px, px + 16, Pack(0, 0, 0, 255));
+            return;
+        }
+        const Bc6Mode& m = kBc6Modes[mode];
+
+        int32_t e[4][3] = {};
+        ReadBc6Endpoints(in, mode, e);
+        const uint32_t partition = m.subsets == 2 ? in.Read(5) : 0;
+        const int32_t endpoints = m.subsets * 2;
+        const int32_t mask = (1 << m.endpoint_bits) - 1;
+        for (int c = 0; c < 3; ++c) {
+            if (is_signed) e[0][c] = SignExtend(e[0][c], m.endpoint_bits);
+            for (int i = 1; i < endpoints; ++i) {
+                if (m.transformed) {
+                    e[i][c] = (e[0][c] + SignExtend(e[i][c], m.delta_bits[c])) & mask;
+                    if (is_signed) e[i][c] = SignExtend(e[i][c], m.endpoint_bits);
+                } else if (is_signed) {
+                    e[i][c] = SignExtend(e[i][c], m.endpoint_bits);
+                }
+            }
+            for (int i = 0; i < endpoints; ++i) e[i][c] = UnquantizeBc6(e[i][c], m.endpoint_bits, is_signed);
+        }
+
+        const uint32_t index_bits = m.subsets == 2 ? 3 : 4;
+        uint8_t index[16];
+        ReadIndices(in, index_bits, m.subsets, partition, index);
+        const uint8_t* weights = Weights(index_bits);
+        const uint8_t* to_byte = HalfToByte();
+        for (int i = 0; i < 16; ++i) {
+            const int s = m.subsets == 2 ? kPartition2[partition][i] : 0;
+            uint8_t rgb[3];
+            for (int c = 0; c < 3; ++c)
+                rgb[c] = to_byte[FinishBc6(Interpolate(e[2 * s][c], e[2 * s + 1][c], weights[index[i]]), is_signed)];
+            px[i] = Pack(rgb[0], rgb[1], rgb[2], 255);
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    // Row kernels
+    // ------------------------------------------------------------------------
+
+    void PremultiplyRowScalar(uint8_t* bgra, int32_t count) {
+        for (int32_t i = 0; i < count; ++i, bgra += 4) {
+            const uint32_t a = bgra[3];
+            if (a == 255) continue;
+            bgra[0] = static_cast<uint8_t>(Scale(bgra[0], a));
+            bgra[1] = static_cast<uint8_t>(Scale(bgra[1], a));
+            bgra[2] = static_cast<uint8_t>(Scale(bgra[2], a));
+        }
+    }
+
+    void SwizzleRowScalar(const uint8_t* rgba, int32_t count, uint8_t* bgra) {
+        for (int32_t i = 0; i < count; ++i, rgba += 4, bgra += 4) {
+            const uint8_t r = rgba[0];
+            bgra[0] = rgba[2];
+            bgra[1] = rgba[1];
+            bgra[2] = r;
+            bgra[3] = rgba[3];
+        }
+    }
+
+#ifdef FLY_DDS_SSE2
+    inline __m128i Select(__m128i mask, __m128i yes, __m128i no) {
+        return _mm_or_si128(_mm_and_si128(mask, yes), _mm_andnot_si128(mask, no));
+    }
+
+    /// Four BGRA pixels premultiplied by their own alpha, with Scale()'s rounding; alpha is kept.
+    inline __m128i Premultiply4(__m128i px) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi16(128);
+        __m128i lo = _mm_unpacklo_epi8(px, zero);
+        __m128i hi = _mm_unpackhi_epi8(px, zero);
+        const __m128i alpha_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        const __m128i alpha_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, alpha_lo), round);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, alpha_hi), round);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+        return Select(alpha_mask, px, _mm_packus_epi16(lo, hi));
+    }
+
+    /// The 16 pixels of a colour block, one row per vector: each index's two bits select from
+    /// the palette broadcast across the lanes.
+    inline void SelectColors(const uint32_t palette[4], uint32_t indices, __m128i rows[4]) {
+        const __m128i bit0 = _mm_setr_epi32(1, 4, 16, 64);
+        const __m128i bit1 = _mm_setr_epi32(2, 8, 32, 128);
+        const __m128i p0 = _mm_set1_epi32(static_cast<int>(palette[0]));
+        const __m128i p1 = _mm_set1_epi32(static_cast<int>(palette[1]));
+        const __m128i p2 = _mm_set1_epi32(static_cast<int>(palette[2]));
+        const __m128i p3 = _mm_set1_epi32(static_cast<int>(palette[3]));
+        for (int y = 0; y < 4; ++y, indices >>= 8) {
+            const __m128i v = _mm_set1_epi32(static_cast<int>(indices & 0xFF));
+            const __m128i low = _mm_cmpeq_epi32(_mm_and_si128(v, bit0), bit0);
+            const __m128i high = _mm_cmpeq_epi32(_mm_and_si128(v, bit1), bit1);
+            rows[y] = Select(high, Select(low, p3, p2), Select(low, p1, p0));
+        }
+    }
+
+    void DecodeBc1Sse2(const uint8_t* blocks, int32_t count, uint8_t* bgra, size_t stride, bool) {
+        uint32_t palette[4];
+        __m128i rows[4];
+        for (int32_t i = 0; i < count; ++i, blocks += 8, bgra += 16) {
+            ColorPalette(blocks, false, palette);
+            SelectColors(palette, LE32(blocks + 4), rows);
+            for (int y = 0; y < 4; ++y) _mm_storeu_si128(reinterpret_cast<__m128i*>(bgra + y * stride), rows[y]);
+        }
+    }
+
+    template <bool Explicit>
+    void DecodeBc23Sse2(const uint8_t* blocks, int32_t count, uint8_t* bgra, size_t stride, bool straight) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i color_mask = _mm_set1_epi32(0x00FFFFFF);
+        uint32_t palette[4];
+        alignas(16) uint8_t alpha[16];
+        __m128i rows[4];
+        for (int32_t i = 0; i < count; ++i, blocks += 16, bgra += 16) {
+            if (Explicit) DecodeExplicitAlpha(blocks, alpha);
+            else DecodeChannel(blocks, false, alpha);
+            ColorPalette(blocks + 8, true, palette);
+            SelectColors(palette, LE32(blocks + 12), rows);
+
+            // Alpha bytes to the top byte of each 32-bit lane.
+            const __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(alpha));
+            const __m128i a_lo = _mm_unpacklo_epi8(zero, a);
+            const __m128i a_hi = _mm_unpackhi_epi8(zero, a);
+            const __m128i lanes[4] = {_mm_unpacklo_epi16(zero, a_lo), _mm_unpackhi_epi16(zero, a_lo), _mm_unpacklo_epi16(zero, a_hi),
+                                      _mm_unpackhi_epi16(zero, a_hi)};
+            const bool opaque = _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_set1_epi8(-1))) == 0xFFFF;
+            for (int y = 0; y < 4; ++y) {
+                __m128i px = _mm_or_si128(_mm_and_si128(rows[y], color_mask), lanes[y]);
+                if (straight && !opaque) px = Premultiply4(px);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(bgra + y * stride), px);
+            }
+        }
+    }
+
+    void PremultiplyRowSse2(uint8_t* bgra, int32_t count) {
+        const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i* p = reinterpret_cast<__m128i*>(bgra + static_cast<size_t>(i) * 4);
+            const __m128i px = _mm_loadu_si128(p);
+            if ((_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(px, alpha_mask), alpha_mask)) & 0xFFFF) == 0xFFFF) continue;
+            _mm_storeu_si128(p, Premultiply4(px));
+        }
+        PremultiplyRowScalar(bgra + static_cast<size_t>(i) * 4, count - i);
+    }
+
+    void SwizzleRowSse2(const uint8_t* rgba, int32_t count, uint8_t* bgra) {
+        const __m128i keep = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+        const __m128i low = _mm_set1_epi32(0xFF);
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + static_cast<size_t>(i) * 4));
+            const __m128i swapped = _mm_or_si128(_mm_and_si128(px, keep),
+                                                 _mm_or_si128(_mm_and_si128(_mm_srli_epi32(px, 16), low),
+                                                              _mm_slli_epi32(_mm_and_si128(px, low), 16)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(bgra + static_cast<size_t>(i) * 4), swapped);
+        }
+        SwizzleRowScalar(rgba + static_cast<size_t>(i) * 4, count - i, bgra + static_cast<size_t>(i) * 4);
+    }
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Header
+// ----------------------------------------------------------------------------
+
+bool DdsDecoder::Open(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    info_ = DdsInfo{};
+    layout_ = Layout::None;
+    block_bytes_ = pixel_bits_ = 0;
+    signed_ = straight_ = opaque_ = luminance_ = alpha_only_ = false;
+    if (!data || size < 4 + kHeaderSize || LE32(data) != kMagic || LE32(data + 4) != kHeaderSize) return false;
+
+    const uint32_t flags = LE32(data + 8);
+    const uint32_t height = LE32(data + 12);
+    const uint32_t width = LE32(data + 16);
+    const uint32_t depth = LE32(data + 24);
+    const uint32_t mips = LE32(data + 28);
+    const uint32_t pf_flags = LE32(data + 80);
+    const uint32_t fourcc = LE32(data + 84);
+    const uint32_t caps2 = LE32(data + 112);
+
+    uint32_t items = 1;
+    bool volume = false;
+    uint32_t alpha_mode = AlphaUnknown;
+    data_offset_ = 4 + kHeaderSize;
+    if ((pf_flags & kPfFourCc) && fourcc == FourCc('D', 'X', '1', '0')) {
+        if (size < data_offset_ + 20) return false;
+        const uint8_t* dx10 = data + data_offset_;
+        const uint32_t dimension = LE32(dx10 + 4);
+        const uint32_t misc = LE32(dx10 + 8);
+        info_.is_cubemap = (misc & kMiscTextureCube) ? 1 : 0;
+        items = std::max(1u, LE32(dx10 + 12)) * (info_.is_cubemap ? 6 : 1);
+        volume = dimension == kDimensionTexture3D;
+        alpha_mode = LE32(dx10 + 16) & 7;
+        data_offset_ += 20;
+        if (dimension == kDimensionTexture1D) info_.height = 1;
+        SetDxgiFormat(LE32(dx10));
+    } else {
+        if (caps2 & kCaps2Cubemap) {
+            info_.is_cubemap = 1;
+            items = std::max(1, BitCount(caps2 & kCaps2CubemapFaces));
+        }
+        volume = (caps2 & kCaps2Volume) != 0;
+        if (pf_flags & kPfFourCc) {
+            SetFourCc(fourcc);
+        } else if (pf_flags & (kPfRgb | kPfLuminance | kPfAlpha)) {
+            const uint32_t a_mask = (pf_flags & (kPfAlphaPixels | kPfAlpha)) ? LE32(data + 104) : 0;
+            luminance_ = (pf_flags & kPfLuminance) != 0;
+            alpha_only_ = (pf_flags & (kPfRgb | kPfLuminance)) == 0;
+            SetMasks(LE32(data + 88), alpha_only_ ? 0 : LE32(data + 92), alpha_only_ ? 0 : LE32(data + 96),
+                     alpha_only_ ? 0 : LE32(data + 100), a_mask);
+        }
+    }
+
+    if (width == 0 || height == 0 || width > (1u << 24) || height > (1u << 24) || items > 65536) return false;
+    info_.width = static_cast<int32_t>(width);
+    if (info_.height == 0) info_.height = static_cast<int32_t>(height);
+    info_.depth = volume && ((flags & kFlagDepth) || depth > 1) ? static_cast<int32_t>(std::clamp(depth, 1u, 1u << 16)) : 1;
+    info_.array_size = static_cast<int32_t>(items);
+
+    int32_t max_levels = 1;
+    while ((std::max({info_.width, info_.height, info_.depth}) >> max_levels) > 0) ++max_levels;
+    info_.mip_count = (flags & kFlagMipCount) && mips > 0 ? std::min(static_cast<int32_t>(std::min(mips, 32u)), max_levels) : 1;
+
+    // Straight alpha unless the header says the pixels are premultiplied or their alpha is not
+    // transparency. BC1's transparent texels are black, so it needs no premultiplying.
+    opaque_ = info_.has_alpha && (alpha_mode == AlphaOpaque || alpha_mode == AlphaCustom);
+    if (!info_.has_alpha || opaque_ || alpha_mode == AlphaPremultiplied || layout_ == Layout::Bc1) straight_ = false;
+    info_.can_decode = layout_ != Layout::None ? 1 : 0;
+
+    item_bytes_ = 0;
+    if (info_.can_decode)
+        for (int32_t level = 0; level < info_.mip_count; ++level) item_bytes_ += SurfaceBytes(level);
+    return true;
+}
+
+/**
+ * @brief Maps a DXGI_FORMAT onto a layout. The packed 8-to-32-bit formats share the bit-mask
+ *        path of legacy headers.
+ */
+void DdsDecoder::SetDxgiFormat(uint32_t format) {
+    info_.dxgi_format = static_cast<int32_t>(format);
+    straight_ = true;
+    auto block = [&](Layout layout, int32_t bytes, bool alpha, bool is_signed = false) {
+        layout_ = layout;
+        block_bytes_ = bytes;
+        info_.has_alpha = alpha ? 1 : 0;
+        signed_ = is_signed;
+    };
+    auto row = [&](Layout layout, int32_t bits, bool alpha) {
+        layout_ = layout;
+        pixel_bits_ = bits;
+        info_.has_alpha = alpha ? 1 : 0;
+    };
+    switch (format) {
+    case 70: case 71: case 72: block(Layout::Bc1, 8, true); break;
+    case 73: case 74: case 75: block(Layout::Bc2, 16, true); break;
+    case 76: case 77: case 78: block(Layout::Bc3, 16, true); break;
+    case 79: case 80: block(Layout::Bc4, 8, false); break;
+    case 81: block(Layout::Bc4, 8, false, true); break;
+    case 82: case 83: block(Layout::Bc5, 16, false); break;
+    case 84: block(Layout::Bc5, 16, false, true); break;
+    case 94: case 95: block(Layout::Bc6, 16, false); break;
+    case 96: block(Layout::Bc6, 16, false, true); break;
+    case 97: case 98: case 99: block(Layout::Bc7, 16, true); break;
+    case 27: case 28: case 29: row(Layout::Rgba8, 32, true); break;
+    case 87: case 90: case 91: row(Layout::Bgra8, 32, true); break;
+    case 88: case 92: case 93: row(Layout::Bgrx8, 32, false); break;
+    case 11: row(Layout::Rgba16, 64, true); break;
+    case 10: row(Layout::Rgba16F, 64, true); break;
+    case 2: row(Layout::Rgba32F, 128, true); break;
+    case 56: row(Layout::R16, 16, false); break;
+    case 54: row(Layout::R16F, 16, false); break;
+    case 41: row(Layout::R32F, 32, false); break;
+    case 26: row(Layout::R11G11B10F, 32, false); break;
+    case 24: SetMasks(32, 0x3FF, 0xFFC00, 0x3FF00000, 0xC0000000); break;
+    case 85: SetMasks(16, 0xF800, 0x07E0, 0x001F, 0); break;
+    case 86: SetMasks(16, 0x7C00, 0x03E0, 0x001F, 0x8000); break;
+    case 115: SetMasks(16, 0x0F00, 0x00F0, 0x000F, 0xF000); break;
+    case 49: SetMasks(16, 0xFF, 0xFF00, 0, 0); break;
+    case 61:
+        luminance_ = true;
+        SetMasks(8, 0xFF, 0, 0, 0);
+        break;
+    case 65:
+        alpha_only_ = true;
+        SetMasks(8, 0, 0, 0, 0xFF);
+        break;
+    default: break;
+    }
+    if (format == 0) layout_ = Layout::None;
+}
+
+/** @brief Maps a legacy FourCC, or a D3DFORMAT number stored in its place, onto a layout. */
+void DdsDecoder::SetFourCc(uint32_t fourcc) {
+    switch (fourcc) {
+    case FourCc('D', 'X', 'T', '1'): SetDxgiFormat(71); break;
+    case FourCc('D', 'X', 'T', '2'): SetDxgiFormat(74); straight_ = false; break;
+    case FourCc('D', 'X', 'T', '3'): SetDxgiFormat(74); break;
+    case FourCc('D', 'X', 'T', '4'): SetDxgiFormat(77); straight_ = false; break;
+    case FourCc('D', 'X', 'T', '5'): SetDxgiFormat(77); break;
+    case FourCc('A', 'T', 'I', '1'):
+    case FourCc('B', 'C', '4', 'U'): SetDxgiFormat(80); break;
+    case FourCc('B', 'C', '4', 'S'): SetDxgiFormat(81); break;
+    case FourCc('A', 'T', 'I', '2'):
+    case FourCc('B', 'C', '5', 'U'): SetDxgiFormat(83); break;
+    case FourCc('B', 'C', '5', 'S'): SetDxgiFormat(84); break;
+    case 36: SetDxgiFormat(11); break;   // D3DFMT_A16B16G16R16
+    case 111: SetDxgiFormat(54); break;  // D3DFMT_R16F
+    case 113: SetDxgiFormat(10); break;  // D3DFMT_A16B16G16R16F
+    case 114: SetDxgiFormat(41); break;  // D3DFMT_R32F
+    case 116: SetDxgiFormat(2); break;   // D3DFMT_A32B32G32R32F
+    default: break;
+    }
+}
+
+/**
+ * @brief Sets up the bit-mask path. The two 8-bit-per-channel orders get their own layouts,
+ *        which copy or swizzle whole rows instead of unpacking each pixel.
+ */
+void DdsDecoder::SetMasks(uint32_t bits, uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+    if (bits != 8 && bits != 16 && bits != 24 && bits != 32) return;
+    straight_ = true;
+    if (bits == 32 && !luminance_ && r == 0xFF0000 && g == 0xFF00 && b == 0xFF) {
+        layout_ = a == 0xFF000000 ? Layout::Bgra8 : Layout::Bgrx8;
+        info_.dxgi_format = a == 0xFF000000 ? 87 : 88;
+        info_.has_alpha = a ? 1 : 0;
+        pixel_bits_ = 32;
+        return;
+    }
+    if (bits == 32 && !luminance_ && r == 0xFF && g == 0xFF00 && b == 0xFF0000 && a == 0xFF000000) {
+        layout_ = Layout::Rgba8;
+        info_.dxgi_format = 28;
+        info_.has_alpha = 1;
+        pixel_bits_ = 32;
+        return;
+    }
+    const uint32_t masks[4] = {b, g, r, a};
+    for (int c = 0; c < 4; ++c) {
+        shift_[c] = 0;
+        max_[c] = 0;
+        scale_[c] = 0;
+        if (!masks[c]) continue;
+        while (!(masks[c] & (1u << shift_[c]))) ++shift_[c];
+        max_[c] = masks[c] >> shift_[c];
+        // Wider channels lose their low bits, so the 32.32 product below cannot overflow.
+        while (max_[c] > 0xFFFF) {
+            ++shift_[c];
+            max_[c] >>= 1;
+        }
+        scale_[c] = ((255ull << 32) + max_[c] / 2) / max_[c];
+    }
+    layout_ = Layout::Masked;
+    pixel_bits_ = static_cast<int32_t>(bits);
+    info_.has_alpha = a && !alpha_only_ ? 1 : 0;
+}
+
+uint64_t DdsDecoder::RowPitch(int32_t level) const {
+    if (block_bytes_) return static_cast<uint64_t>((MipWidth(level) + 3) / 4) * block_bytes_;
+    return (static_cast<uint64_t>(MipWidth(level)) * pixel_bits_ + 7) / 8;
+}
+
+int32_t DdsDecoder::RowCount(int32_t level) const { return block_bytes_ ? (MipHeight(level) + 3) / 4 : MipHeight(level); }
+
+uint64_t DdsDecoder::SurfaceBytes(int32_t level) const {
+    return RowPitch(level) * static_cast<uint64_t>(RowCount(level)) * static_cast<uint64_t>(Reduce(info_.depth, level));
+}
+
+DdsMip DdsDecoder::SelectMip(int32_t max_dimension) const {
+    int32_t level = 0;
+    if (max_dimension > 0)
+        while (level + 1 < info_.mip_count && std::max(MipWidth(level + 1), MipHeight(level + 1)) >= max_dimension) ++level;
+    return DdsMip{level, MipWidth(level), MipHeight(level), 0};
+}
+
+// ----------------------------------------------------------------------------
+// Decoding
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Shares the surface's rows out to workers pulling from a shared cursor, as
+ *        ImageProbe::ProbeBatch() does with files. Every row is independent of the others.
+ */
+bool DdsDecoder::Decode(int32_t item, int32_t level, uint8_t* bgra, size_t stride, unsigned threads) const {
+    if (!info_.can_decode || !bgra || item < 0 || item >= info_.array_size || level < 0 || level >= info_.mip_count) return false;
+    const int32_t width = MipWidth(level), height = MipHeight(level);
+    if (static_cast<int64_t>(width) * height > kMaxPixels || stride < static_cast<size_t>(width) * 4) return false;
+
+    uint64_t offset = data_offset_ + item_bytes_ * static_cast<uint64_t>(item);
+    for (int32_t l = 0; l < level; ++l) offset += SurfaceBytes(l);
+    const uint64_t pitch = RowPitch(level);
+    const int32_t rows = RowCount(level);
+    if (offset > size_ || pitch * static_cast<uint64_t>(rows) > size_ - offset) return false;
+    const uint8_t* src = data_ + offset;
+
+    const int32_t rows_per_task = block_bytes_ ? kRowsPerTask / 4 : kRowsPerTask;
+    const int32_t tasks = (rows + rows_per_task - 1) / rows_per_task;
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<int64_t>({threads, tasks, std::max<int64_t>(1, static_cast<int64_t>(width) * height / kPixelsPerWorker)}));
+
+    std::atomic<int32_t> next{0};
+    auto work = [&]() {
+        // Blocks that hang over the right or bottom edge are decoded here first.
+        std::vector<uint8_t> scratch(block_bytes_ ? static_cast<size_t>((width + 3) / 4) * 64 : 0);
+        for (int32_t task = next.fetch_add(1); task < tasks; task = next.fetch_add(1)) {
+            const int32_t end = std::min(rows, (task + 1) * rows_per_task);
+            for (int32_t row = task * rows_per_task; row < end; ++row) {
+                const uint8_t* in = src + pitch * static_cast<uint64_t>(row);
+                if (block_bytes_) {
+                    DecodeBlockRow(in, row * 4, width, height, bgra, stride, scratch.data());
+                } else {
+                    uint8_t* out = bgra + stride * static_cast<size_t>(row);
+                    ConvertRow(in, width, out);
+                    if (straight_) premultiply_(out, width);
+                }
+            }
+        }
+    };
+
+    if (threads <= 1) {
+        work();
+        return true;
+    }
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    return true;
+}
+
+/**
+ * @brief Decodes one row of blocks, the pixel rows from `y`. Straight into the output when the
+ *        blocks fit it exactly; through `scratch` at the right and bottom edges.
+ */
+void DdsDecoder::DecodeBlockRow(const uint8_t* src, int32_t y, int32_t width, int32_t height, uint8_t* bgra, size_t stride,
+                                uint8_t* scratch) const {
+    const int32_t blocks = (width + 3) / 4;
+    const int32_t rows = std::min(4, height - y);
+    const bool direct = rows == 4 && width % 4 == 0;
+    uint8_t* out = direct ? bgra + stride * static_cast<size_t>(y) : scratch;
+    const size_t out_stride = direct ? stride : static_cast<size_t>(blocks) * 16;
+
+    uint32_t px[16];
+    switch (layout_) {
+    case Layout::Bc1: bc1_(src, blocks, out, out_stride, false); break;
+    case Layout::Bc2: bc2_(src, blocks, out, out_stride, straight_); break;
+    case Layout::Bc3: bc3_(src, blocks, out, out_stride, straight_); break;
+    case Layout::Bc4:
+        for (int32_t i = 0; i < blocks; ++i) {
+            DecodeBc4(src + i * 8, signed_, px);
+            StoreBlock(px, out + i * 16, out_stride);
+        }
+        break;
+    case Layout::Bc5:
+        for (int32_t i = 0; i < blocks; ++i) {
+            DecodeBc5(src + i * 16, signed_, px);
+            StoreBlock(px, out + i * 16, out_stride);
+        }
+        break;
+    case Layout::Bc6:
+        for (int32_t i = 0; i < blocks; ++i) {
+            DecodeBc6(src + i * 16, signed_, px);
+            StoreBlock(px, out + i * 16, out_stride);
+        }
+        break;
+    case Layout::Bc7:
+        for (int32_t i = 0; i < blocks; ++i) {
+            DecodeBc7(src + i * 16, px);
+            StoreBlock(px, out + i * 16, out_stride);
+        }
+        if (straight_)
+            for (int32_t r = 0; r < rows; ++r) premultiply_(out + out_stride * r, blocks * 4);
+        break;
+    default: break;
+    }
+
+    if (!direct)
+        for (int32_t r = 0; r < rows; ++r) std::memcpy(bgra + stride * static_cast<size_t>(y + r), scratch + out_stride * r, static_cast<size_t>(width) * 4);
+    if (opaque_)
+        for (int32_t r = 0; r < rows; ++r) {
+            uint8_t* p = bgra + stride * static_cast<size_t>(y + r);
+            for (int32_t x = 0; x < width; ++x) p[x * 4 + 3] = 255;
+        }
+}
+
+/** @brief Converts one row of an uncompressed layout, leaving straight alpha as it is. */
+void DdsDecoder::ConvertRow(const uint8_t* src, int32_t width, uint8_t* bgra) const {
+    const uint8_t* to_byte = HalfToByte();
+    uint8_t* out = bgra;
+    switch (layout_) {
+    case Layout::Rgba8: swizzle_(src, width, bgra); break;
+    case Layout::Bgra8: std::memcpy(bgra, src, static_cast<size_t>(width) * 4); break;
+    case Layout::Bgrx8:
+        for (int32_t x = 0; x < width; ++x, src += 4, out += 4) {
+            std::memcpy(out, src, 3);
+            out[3] = 255;
+        }
+        break;
+    case Layout::Masked: MaskedRow(src, width, bgra); break;
+    case Layout::Rgba16:
+        for (int32_t x = 0; x < width; ++x, src += 8, out += 4) {
+            out[0] = Narrow16(LE16(src + 4));
+            out[1] = Narrow16(LE16(src + 2));
+            out[2] = Narrow16(LE16(src));
+            out[3] = Narrow16(LE16(src + 6));
+        }
+        break;
+    case Layout::Rgba16F:
+        for (int32_t x = 0; x < width; ++x, src += 8, out += 4) {
+            out[0] = to_byte[LE16(src + 4)];
+            out[1] = to_byte[LE16(src + 2)];
+            out[2] = to_byte[LE16(src)];
+            out[3] = to_byte[LE16(src + 6)];
+        }
+        break;
+    case Layout::Rgba32F:
+        for (int32_t x = 0; x < width; ++x, src += 16, out += 4) {
+            out[0] = UnitToByte(LoadFloat(src + 8));
+            out[1] = UnitToByte(LoadFloat(src + 4));
+            out[2] = UnitToByte(LoadFloat(src));
+            out[3] = UnitToByte(LoadFloat(src + 12));
+        }
+        break;
+    case Layout::R16:
+    case Layout::R16F:
+    case Layout::R32F:
+        for (int32_t x = 0; x < width; ++x, out += 4) {
+            const uint8_t v = layout_ == Layout::R16 ? Narrow16(LE16(src + x * 2))
+                              : layout_ == Layout::R16F ? to_byte[LE16(src + x * 2)]
+                                                        : UnitToByte(LoadFloat(src + x * 4));
+            out[0] = out[1] = out[2] = v;
+            out[3] = 255;
+        }
+        break;
+    case Layout::R11G11B10F:
+        for (int32_t x = 0; x < width; ++x, src += 4, out += 4) {
+            const uint32_t v = LE32(src);
+            out[0] = to_byte[SmallFloatToHalf(v >> 22, 5)];
+            out[1] = to_byte[SmallFloatToHalf((v >> 11) & 0x7FF, 6)];
+            out[2] = to_byte[SmallFloatToHalf(v & 0x7FF, 6)];
+            out[3] = 255;
+        }
+        break;
+    default: break;
+    }
+    if (opaque_)
+        for (int32_t x = 0; x < width; ++x) bgra[x * 4 + 3] = 255;
+}
+
+/** @brief Unpacks each pixel by its channel masks, scaling every channel to 8 bits. */
+void DdsDecoder::MaskedRow(const uint8_t* src, int32_t width, uint8_t* bgra) const {
+    const int32_t bytes = pixel_bits_ / 8;
+    for (int32_t x = 0; x < width; ++x, src += bytes, bgra += 4) {
+        uint32_t v = 0;
+        for (int32_t i = 0; i < bytes; ++i) v |= static_cast<uint32_t>(src[i]) << (8 * i);
+        uint32_t c[4];
+        for (int i = 0; i < 4; ++i)
+            c[i] = static_cast<uint32_t>((((v >> shift_[i]) & max_[i]) * scale_[i] + (1ull << 31)) >> 32);
+        if (!max_[3]) c[3] = 255;
+        if (luminance_) c[0] = c[1] = c[2];
+        if (alpha_only_) {
+            c[0] = c[1] = c[2] = c[3];
+            c[3] = 255;
+        }
+        bgra[0] = static_cast<uint8_t>(c[0]);
+        bgra[1] = static_cast<uint8_t>(c[1]);
+        bgra[2] = static_cast<uint8_t>(c[2]);
+        bgra[3] = static_cast<uint8_t>(c[3]);
+    }
+}
+
+/**
+ * @brief Only BC1-BC3, the RGBA8 swizzle and the premultiply pass have SSE2 kernels; BC4-BC7 and
+ *        the 16-bit formats always run scalar code.
+ */
+void DdsDecoder::SetSimd(bool enabled) {
+    bc1_ = &DecodeBc1Scalar;
+    bc2_ = &DecodeBc23Scalar<true>;
+    bc3_ = &DecodeBc23Scalar<false>;
+    swizzle_ = &SwizzleRowScalar;
+    premultiply_ = &PremultiplyRowScalar;
+#ifdef FLY_DDS_SSE2
+    if (enabled && CpuFeatures::Level() >= SimdLevel::Sse2) {
+        bc1_ = &DecodeBc1Sse2;
+        bc2_ = &DecodeBc23Sse2<true>;
+        bc3_ = &DecodeBc23Sse2<false>;
+        swizzle_ = &SwizzleRowSse2;
+        premultiply_ = &PremultiplyRowSse2;
+    }
+#else
+    (void)enabled;
+#endif
+}
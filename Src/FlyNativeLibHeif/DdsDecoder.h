@@ -0,0 +1,145 @@
+/**
+ * @file DdsDecoder.h
+ * @brief Declares DdsDecoder, a DirectDraw Surface texture decoder with mip selection.
+ *
+ * A DDS is a header followed by raw GPU surfaces: every mip level of every array element or
+ * cube face, back to back. Open() reads the header (and the DX10 extension) and works out the
+ * pixel format and the size of each surface, so any one of them can be found without reading
+ * the others. SelectMip() picks the smallest level that still covers a display size: a
+ * 16384x16384 texture previews from its 512x512 mip, which is 1/1024 of the work.
+ *
+ * Decode() turns one surface into premultiplied BGRA. Block-compressed surfaces are decoded a
+ * row of 4x4 blocks at a time, and the rows are shared out to worker threads. Supported:
+ *
+ * - BC1-BC5 (DXT1-DXT5, ATI1/ATI2), with SSE2 kernels for BC1-BC3. BC4 is shown as grey and
+ *   BC5 as red and green, as texture tools do.
+ * - BC6H and BC7, every mode. BC6H and the float formats are clamped to [0, 1] and scaled,
+ *   without tone mapping.
+ * - Uncompressed DXGI formats: 8-bit RGBA/BGRA/BGRX, 16-bit RGBA (UNORM and FLOAT), 32-bit
+ *   float RGBA, R11G11B10 float, single-channel R8/R16/R16F/R32F/A8, R8G8, R10G10B10A2 and the
+ *   16-bit packed formats, plus any legacy header described by bit masks.
+ *
+ * Only the first slice of a volume texture is decoded. sRGB formats are passed through as
+ * stored. The file data is not copied and must outlive the decoder. Decode() may be called
+ * from several threads at once; Open() and SetSimd() may not.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef DDS_DECODER_H
+#define DDS_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief What Open() found. Blittable for P/Invoke.
+struct DdsInfo {
+    int32_t width;                      ///< Of the top mip level.
+    int32_t height;
+    int32_t depth;                      ///< Slices of a volume texture; 1 otherwise.
+    int32_t mip_count;
+    int32_t array_size;                 ///< Images in the file: array elements, times 6 for a cubemap.
+    int32_t is_cubemap;
+    int32_t dxgi_format;                ///< Legacy headers mapped to DXGI; 0 for other legacy bit masks.
+    int32_t has_alpha;
+    int32_t can_decode;                 ///< 1 if Decode() handles the pixel format.
+    int32_t reserved;
+};
+
+/// @brief A mip level and its size. Blittable for P/Invoke.
+struct DdsMip {
+    int32_t level;
+    int32_t width;
+    int32_t height;
+    int32_t reserved;
+};
+
+/// @brief Parses a DDS in memory and decodes its surfaces.
+class DdsDecoder {
+public:
+    /// Surfaces larger than this many pixels are not decoded.
+    static constexpr int64_t kMaxPixels = 1ll << 28;
+
+    /// @brief Decodes `count` 4x4 blocks into 4 rows of `stride` bytes, premultiplying if `straight` alpha.
+    using DecodeBlocksFn = void (*)(const uint8_t* blocks, int32_t count, uint8_t* bgra, size_t stride, bool straight);
+
+    /// @brief Converts `count` pixels in place, e.g. premultiplying straight BGRA.
+    using RowFn = void (*)(uint8_t* bgra, int32_t count);
+
+    /// @brief Converts `count` pixels from `src` into `bgra`, e.g. RGBA to BGRA.
+    using ConvertRowFn = void (*)(const uint8_t* src, int32_t count, uint8_t* bgra);
+
+    DdsDecoder() { SetSimd(true); }
+
+    /// @brief Parses the header and locates the surfaces.
+    /// @return false if the data is not a DDS or its header is inconsistent.
+    bool Open(const uint8_t* data, size_t size);
+
+    const DdsInfo& Info() const { return info_; }
+
+    int32_t MipWidth(int32_t level) const { return Reduce(info_.width, level); }
+    int32_t MipHeight(int32_t level) const { return Reduce(info_.height, level); }
+
+    /// @brief The smallest mip level whose longer side is at least `max_dimension`.
+    /// @details The top level if none is, or if `max_dimension` is 0 or less.
+    DdsMip SelectMip(int32_t max_dimension) const;
+
+    /// @brief Decodes mip `level` of image `item` into `bgra`, `MipHeight(level)` rows of `stride` bytes.
+    /// @param threads Workers to share the rows between; 0 for one per core. Small surfaces use one.
+    /// @return false if the format is not handled, an argument is out of range, or the surface runs past the end of the file.
+    bool Decode(int32_t item, int32_t level, uint8_t* bgra, size_t stride, unsigned threads = 0) const;
+
+    /// @brief Selects the block, swizzle and premultiply kernels: SSE2 where the CPU has it, or scalar.
+    void SetSimd(bool enabled);
+
+private:
+    enum class Layout : int32_t {
+        None, Bc1, Bc2, Bc3, Bc4, Bc5, Bc6, Bc7,
+        Rgba8, Bgra8, Bgrx8, Masked, Rgba16, Rgba16F, Rgba32F, R16, R16F, R32F, R11G11B10F
+    };
+
+    static int32_t Reduce(int32_t size, int32_t level) { return size >> level > 0 ? size >> level : 1; }
+
+    void SetDxgiFormat(uint32_t format);
+    void SetFourCc(uint32_t fourcc);
+    void SetMasks(uint32_t bits, uint32_t r, uint32_t g, uint32_t b, uint32_t a);
+
+    /// Bytes per row of blocks, or per row of pixels for uncompressed layouts.
+    uint64_t RowPitch(int32_t level) const;
+    /// Rows of blocks, or of pixels.
+    int32_t RowCount(int32_t level) const;
+    uint64_t SurfaceBytes(int32_t level) const;
+
+    void DecodeBlockRow(const uint8_t* src, int32_t y, int32_t width, int32_t height, uint8_t* bgra, size_t stride,
+                        uint8_t* scratch) const;
+    void ConvertRow(const uint8_t* src, int32_t width, uint8_t* bgra) const;
+    void MaskedRow(const uint8_t* src, int32_t width, uint8_t* bgra) const;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    DdsInfo info_{};
+    Layout layout_ = Layout::None;
+    size_t data_offset_ = 0;            // The first surface's first byte.
+    uint64_t item_bytes_ = 0;           // One image with all its mip levels.
+    int32_t block_bytes_ = 0;           // 8 or 16 for block-compressed layouts; 0 otherwise.
+    int32_t pixel_bits_ = 0;            // For uncompressed layouts.
+    bool signed_ = false;               // BC4, BC5 and BC6H SNORM/SF16.
+    bool straight_ = false;             // The alpha is straight and needs premultiplying.
+    bool opaque_ = false;               // The alpha is not transparency and is replaced by 255.
+
+    // Masked: shift, maximum and 32.32 scale to 255 of each channel, B, G, R, A; a maximum of 0 means absent.
+    uint32_t shift_[4] = {};
+    uint32_t max_[4] = {};
+    uint64_t scale_[4] = {};
+    bool luminance_ = false;            // R is grey.
+    bool alpha_only_ = false;           // A is shown as grey.
+
+    DecodeBlocksFn bc1_ = nullptr;
+    DecodeBlocksFn bc2_ = nullptr;
+    DecodeBlocksFn bc3_ = nullptr;
+    ConvertRowFn swizzle_ = nullptr;
+    RowFn premultiply_ = nullptr;
+};
+
+#endif // DDS_DECODER_H
@@ -0,0 +1,91 @@
+/**
+ * @file DecodeReport.cpp
+ * @brief Implements DecodeReportScope.
+ */
+
+#include "DecodeReport.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    thread_local DecodeReportScope* t_active = nullptr;
+    thread_local DecodeReport t_last{};
+    thread_local bool t_has_last = false;
+
+    int64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+/** @brief Opens a report on the current thread; nested scopes restore the outer one on exit. */
+DecodeReportScope::DecodeReportScope(int thread_count)
+    : previous_(t_active), start_(std::chrono::steady_clock::now()) {
+    report_.struct_size = sizeof(DecodeReport);
+    report_.thread_count = thread_count;
+    t_active = this;
+}
+
+/** @brief Stamps the total time and publishes the report as the thread's last one. */
+DecodeReportScope::~DecodeReportScope() {
+    report_.total_ns = ElapsedNs(start_);
+    t_last = report_;
+    t_has_last = true;
+    t_active = previous_;
+}
+
+DecodeReportScope* DecodeReportScope::Active() {
+    return t_active;
+}
+
+void DecodeReportScope::Error(int code, int subcode) {
+    DecodeReportScope* scope = Active();
+    if (!scope || code == 0 || scope->report_.heif_error_code != 0) return;
+    scope->report_.heif_error_code = code;
+    scope->report_.heif_error_subcode = subcode;
+}
+
+void DecodeReportScope::Acquire(uint64_t bytes) {
+    DecodeReportScope* scope = Active();
+    if (!scope) return;
+    scope->live_bytes_ += bytes;
+    scope->report_.peak_bytes = std::max(scope->report_.peak_bytes, scope->live_bytes_);
+}
+
+void DecodeReportScope::Release(uint64_t bytes) {
+    DecodeReportScope* scope = Active();
+    if (!scope) return;
+    scope->live_bytes_ -= std::min(scope->live_bytes_, bytes);
+}
+
+void DecodeReportScope::Flag(uint32_t flags) {
+    if (DecodeReportScope* scope = Active()) scope->report_.flags |= flags;
+}
+
+void DecodeReportScope::Output(int width, int height) {
+    DecodeReportScope* scope = Active();
+    if (!scope) return;
+    scope->report_.width = width;
+    scope->report_.height = height;
+}
+
+/**
+ * @brief Copies at most `out.struct_size` bytes, so a caller built against an older, shorter
+ * struct is never written past its end. `struct_size` itself is left as the caller set it.
+ */
+bool DecodeReportScope::GetLast(DecodeReport& out) {
+    if (!t_has_last || out.struct_size < sizeof(uint32_t)) return false;
+    const uint32_t caller_size = out.struct_size;
+    const size_t size = std::min<size_t>(caller_size, sizeof(DecodeReport));
+    memcpy(&out, &t_last, size);
+    out.struct_size = caller_size;
+    return true;
+}
+
+DecodeReportScope::StageTimer::StageTimer(Stage stage)
+    : stage_(stage), start_(std::chrono::steady_clock::now()) {
+}
+
+DecodeReportScope::StageTimer::~StageTimer() {
+    if (DecodeReportScope* scope = Active()) scope->report_.*stage_ += ElapsedNs(start_);
+}
@@ -0,0 +1,124 @@
+/**
+ * @file DecodeReport.h
+ * @brief Defines DecodeReport, a per-call record of where a native decode spent its time
+ *        and why it failed.
+ *
+ * HeifError collapses every failure into a handful of codes and says nothing about time.
+ * Each decode export opens a DecodeReportScope; the code underneath adds stage timings,
+ * byte counts and the raw libheif error through the static helpers (which do nothing when
+ * no scope is open). When the export returns, the report is kept as the calling thread's
+ * "last report", which the caller may fetch with GetLastDecodeReport() - the same pattern
+ * as GetLastError(), so no existing export signature changes.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef DECODE_REPORT_H
+#define DECODE_REPORT_H
+
+#include <chrono>
+#include <cstdint>
+
+/// @brief Bits for DecodeReport::flags.
+enum DecodeReportFlags : uint32_t {
+    DecodeReport_UsedThumbnail = 1u << 0,   ///< The embedded thumbnail was decoded instead of the primary image.
+    DecodeReport_Scaled        = 1u << 1,   ///< The decoded image was scaled down to fit the requested bounds.
+    DecodeReport_Animated      = 1u << 2,   ///< The decode produced a frame of an image sequence.
+};
+
+/// @brief Timings and diagnostics of one decode call. Blittable for P/Invoke.
+/// @note Size-prefixed like FlyHeifDecodeOptions: callers set `struct_size` and receive at most that many bytes.
+struct DecodeReport {
+    uint32_t struct_size;         ///< sizeof(DecodeReport) as seen by the caller.
+    int32_t result;               ///< The HeifError the export returned (0 = Ok).
+    int32_t heif_error_code;      ///< heif_error::code of the first libheif call that failed, 0 if none did.
+    int32_t heif_error_subcode;   ///< heif_error::subcode of that call.
+    int64_t open_ns;              ///< Reading the file and parsing the container boxes.
+    int64_t decode_ns;            ///< heif_decode_image. libheif converts YCbCr to RGB inside this call, so it includes that.
+    int64_t color_convert_ns;     ///< Conversions done outside libheif (RGB expanded to RGBA).
+    int64_t scale_ns;             ///< Scaling to the requested bounds.
+    int64_t copy_ns;              ///< Allocating and filling the output buffer.
+    int64_t total_ns;             ///< Wall time of the whole export.
+    uint64_t peak_bytes;          ///< Largest total of pixel buffers held at once (decoded, scaled, output). Excludes decoder-internal memory.
+    int32_t thread_count;         ///< Decoder threads requested; 0 = libheif default.
+    int32_t width;                ///< Output width in pixels.
+    int32_t height;               ///< Output height in pixels.
+    uint32_t flags;               ///< A combination of DecodeReportFlags.
+};
+
+/// @brief Collects a DecodeReport for the duration of one export call on the current thread.
+class DecodeReportScope {
+public:
+    /// @brief Stage slots of DecodeReport that a StageTimer can add to.
+    using Stage = int64_t DecodeReport::*;
+
+    explicit DecodeReportScope(int thread_count);
+    ~DecodeReportScope();
+
+    DecodeReportScope(const DecodeReportScope&) = delete;
+    DecodeReportScope& operator=(const DecodeReportScope&) = delete;
+
+    /// @brief Records the export's result. Call once, just before returning.
+    template <typename Result>
+    Result Finish(Result result) {
+        report_.result = static_cast<int32_t>(result);
+        return result;
+    }
+
+    /// @brief Records the first failing libheif call. Later failures are ignored.
+    static void Error(int code, int subcode);
+
+    /// @brief Accounts `bytes` of pixel memory as held; updates the peak.
+    static void Acquire(uint64_t bytes);
+
+    /// @brief Accounts `bytes` of pixel memory as released.
+    static void Release(uint64_t bytes);
+
+    /// @brief Sets DecodeReportFlags bits.
+    static void Flag(uint32_t flags);
+
+    /// @brief Records the output dimensions.
+    static void Output(int width, int height);
+
+    /// @brief Copies the last report of the calling thread to `out`, honouring `out.struct_size`.
+    /// @return false if this thread has not finished a decode yet.
+    static bool GetLast(DecodeReport& out);
+
+    /// @brief Adds the time between construction and destruction to one stage of the active report.
+    class StageTimer {
+    public:
+        explicit StageTimer(Stage stage);
+        ~StageTimer();
+
+        StageTimer(const StageTimer&) = delete;
+        StageTimer& operator=(const StageTimer&) = delete;
+
+    private:
+        Stage stage_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    /// @brief Holds `bytes` of accounted pixel memory until destroyed.
+    class HeldBytes {
+    public:
+        explicit HeldBytes(uint64_t bytes) : bytes_(bytes) { Acquire(bytes_); }
+        ~HeldBytes() { Release(bytes_); }
+
+        HeldBytes(const HeldBytes&) = delete;
+        HeldBytes& operator=(const HeldBytes&) = delete;
+
+    private:
+        uint64_t bytes_;
+    };
+
+private:
+    static DecodeReportScope* Active();
+
+    DecodeReport report_{};
+    DecodeReportScope* previous_;
+    uint64_t live_bytes_ = 0;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif // DECODE_REPORT_H
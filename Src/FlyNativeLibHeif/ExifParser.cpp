@@ -0,0 +1,171 @@
+/**
+ * @file ExifParser.cpp
+ * @brief Implements ExifParser.
+ */
+
+#include "ExifParser.h"
+
+namespace {
+
+    /// @brief Bounds-checked reader over a TIFF block in either byte order.
+    struct TiffView {
+        const uint8_t* data;
+        size_t size;
+        bool little_endian;
+
+        bool U16(size_t offset, uint16_t& v) const {
+            if (offset + 2 > size) return false;
+            const uint8_t* p = data + offset;
+            v = little_endian ? static_cast<uint16_t>(p[0] | (p[1] << 8))
+                              : static_cast<uint16_t>((p[0] << 8) | p[1]);
+            return true;
+        }
+
+        bool U32(size_t offset, uint32_t& v) const {
+            if (offset + 4 > size) return false;
+            const uint8_t* p = data + offset;
+            v = little_endian
+                ? (static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+                   (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24))
+                : ((static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                   (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]));
+            return true;
+        }
+    };
+
+    constexpr uint16_t kTagOrientation = 0x0112;
+    constexpr uint16_t kTagDateTime = 0x0132;
+    constexpr uint16_t kTagExifIfd = 0x8769;
+    constexpr uint16_t kTagDateTimeOriginal = 0x9003;
+    constexpr uint16_t kTagJpegOffset = 0x0201;
+    constexpr uint16_t kTagJpegLength = 0x0202;
+    constexpr uint16_t kTypeAscii = 2;
+    constexpr uint16_t kTypeShort = 3;
+    constexpr uint16_t kTypeLong = 4;
+
+    /// @brief Reads an ASCII entry that is stored out-of-line (timestamps are always 20 bytes).
+    int64_t ReadDateTimeEntry(const TiffView& tiff, size_t entry) {
+        uint32_t count = 0, offset = 0;
+        if (!tiff.U32(entry + 4, count) || !tiff.U32(entry + 8, offset)) return 0;
+        if (count < 19 || count > 64 || static_cast<size_t>(offset) + count > tiff.size) return 0;
+        return ExifParser::ParseDateTime(reinterpret_cast<const char*>(tiff.data + offset), count);
+    }
+
+    /// @brief Days from 1970-01-01 to the given civil date (proleptic Gregorian).
+    int64_t DaysFromCivil(int64_t y, unsigned m, unsigned d) {
+        y -= m <= 2;
+        const int64_t era = (y >= 0 ? y : y - 399) / 400;
+        const unsigned yoe = static_cast<unsigned>(y - era * 400);
+        const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<int64_t>(doe) - 719468;
+    }
+}
+
+/**
+ * @brief Reads the TIFF header, walks IFD0 for the tags in ExifInfo, follows the Exif
+ *        sub-IFD pointer for DateTimeOriginal and the next-IFD link to IFD1 for the thumbnail.
+ */
+bool ExifParser::Parse(const uint8_t* data, size_t size, ExifInfo& out) {
+    if (!data || size < 8) return false;
+
+    TiffView tiff{ data, size, false };
+    if (data[0] == 'I' && data[1] == 'I') tiff.little_endian = true;
+    else if (data[0] == 'M' && data[1] == 'M') tiff.little_endian = false;
+    else return false;
+
+    uint16_t magic = 0;
+    uint32_t ifd0 = 0;
+    if (!tiff.U16(2, magic) || magic != 42 || !tiff.U32(4, ifd0)) return false;
+
+    uint16_t count = 0;
+    if (!tiff.U16(ifd0, count)) return false;
+
+    uint32_t exif_ifd = 0;
+    int64_t date_time = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+        const size_t entry = static_cast<size_t>(ifd0) + 2 + static_cast<size_t>(i) * 12;
+        uint16_t tag = 0, type = 0;
+        if (!tiff.U16(entry, tag) || !tiff.U16(entry + 2, type)) break;
+
+        if (tag == kTagOrientation && type == kTypeShort) {
+            uint16_t value = 1;
+            if (tiff.U16(entry + 8, value) && value >= 1 && value <= 8) {
+                out.orientation = value;
+            }
+        }
+        else if (tag == kTagDateTime && type == kTypeAscii) {
+            date_time = ReadDateTimeEntry(tiff, entry);
+        }
+        else if (tag == kTagExifIfd && type == kTypeLong) {
+            tiff.U32(entry + 8, exif_ifd);
+        }
+    }
+
+    // DateTime is when the file was last written; prefer when the shutter fired.
+    int64_t original = 0;
+    if (exif_ifd != 0 && exif_ifd != ifd0 && tiff.U16(exif_ifd, count)) {
+        for (uint16_t i = 0; i < count; ++i) {
+            const size_t entry = static_cast<size_t>(exif_ifd) + 2 + static_cast<size_t>(i) * 12;
+            uint16_t tag = 0, type = 0;
+            if (!tiff.U16(entry, tag) || !tiff.U16(entry + 2, type)) break;
+            if (tag == kTagDateTimeOriginal && type == kTypeAscii) {
+                original = ReadDateTimeEntry(tiff, entry);
+                break;
+            }
+        }
+    }
+    out.capture_time = original != 0 ? original : date_time;
+
+    // IFD1 describes the thumbnail; a JPEG one is a byte range of the block.
+    uint16_t ifd0_count = 0;
+    uint32_t ifd1 = 0;
+    if (tiff.U16(ifd0, ifd0_count) && tiff.U32(static_cast<size_t>(ifd0) + 2 + static_cast<size_t>(ifd0_count) * 12, ifd1) &&
+        ifd1 != 0 && ifd1 != ifd0 && tiff.U16(ifd1, count)) {
+        uint32_t offset = 0, length = 0;
+        for (uint16_t i = 0; i < count; ++i) {
+            const size_t entry = static_cast<size_t>(ifd1) + 2 + static_cast<size_t>(i) * 12;
+            uint16_t tag = 0, type = 0;
+            if (!tiff.U16(entry, tag) || !tiff.U16(entry + 2, type)) break;
+            if (type != kTypeLong) continue;
+            if (tag == kTagJpegOffset) tiff.U32(entry + 8, offset);
+            else if (tag == kTagJpegLength) tiff.U32(entry + 8, length);
+        }
+        if (offset != 0 && length != 0 && static_cast<size_t>(offset) + length <= size) {
+            out.thumbnail_offset = offset;
+            out.thumbnail_length = length;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Parses the fixed "YYYY:MM:DD HH:MM:SS" layout. Cameras with no clock set write
+ *        zeros or spaces here, which are rejected.
+ */
+int64_t ExifParser::ParseDateTime(const char* text, size_t length) {
+    if (!text || length < 19) return 0;
+
+    int fields[6] = {};
+    const int widths[6] = { 4, 2, 2, 2, 2, 2 };
+    size_t pos = 0;
+    for (int f = 0; f < 6; ++f) {
+        int value = 0;
+        for (int i = 0; i < widths[f]; ++i, ++pos) {
+            const char c = text[pos];
+            if (c < '0' || c > '9') return 0;
+            value = value * 10 + (c - '0');
+        }
+        fields[f] = value;
+        ++pos; // Separator.
+    }
+
+    const int year = fields[0], month = fields[1], day = fields[2];
+    const int hour = fields[3], minute = fields[4], second = fields[5];
+    if (year < 1900 || month < 1 || month > 12 || day < 1 || day > 31 ||
+        hour > 23 || minute > 59 || second > 60) {
+        return 0;
+    }
+    return DaysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)) * 86400 +
+           hour * 3600 + minute * 60 + second;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file ExifParser.h
+ * @brief Defines a minimal reader for the TIFF-structured EXIF block.
+ *
+ * Only the handful of tags the viewer needs for layout are decoded, plus where IFD1 keeps the
+ * JPEG thumbnail. The parser works on
+ * an in-memory copy of the block (the payload of a JPEG APP1 "Exif" segment, a WebP
+ * "EXIF" chunk, or a HEIF Exif item) and never follows offsets outside it.
+ */
+
+#pragma once
+#ifndef EXIF_PARSER_H
+#define EXIF_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief The subset of EXIF fields extracted by ExifParser.
+struct ExifInfo {
+    int orientation = 1;        ///< EXIF orientation (1..8). 1 when absent or invalid.
+    int64_t capture_time = 0;   ///< DateTimeOriginal (else DateTime) as seconds since 1970-01-01, in the
+                                ///< camera's local time with no zone applied. 0 when absent.
+    uint32_t thumbnail_offset = 0;  ///< IFD1's JPEG thumbnail, from the start of the TIFF header. 0 when absent.
+    uint32_t thumbnail_length = 0;  ///< Bytes of the thumbnail; it lies wholly inside the block when non-zero.
+};
+
+/// @brief Parses a TIFF-structured EXIF block ("II*\0" / "MM\0*" header onwards).
+class ExifParser {
+public:
+    /// @brief Parses the block and fills `out` with whatever tags were found.
+    /// @param data Start of the TIFF header (i.e. after the "Exif\0\0" prefix, if any).
+    /// @param size Number of valid bytes at `data`.
+    /// @return false if the block is not a valid TIFF structure.
+    static bool Parse(const uint8_t* data, size_t size, ExifInfo& out);
+
+    /// @brief Converts an EXIF "YYYY:MM:DD HH:MM:SS" timestamp to seconds since 1970-01-01.
+    /// @return 0 if the text is not a valid timestamp.
+    static int64_t ParseDateTime(const char* text, size_t length);
+};
+
+#endif // EXIF_PARSER_H
@@ -0,0 +1,323 @@
+/**
+ * @file FileSource.cpp
+ * @brief Implements the byte sources, WindowedReader and the mapped-file wrappers.
+ */
+
+#include "FileSource.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Copies bytes out of the wrapped buffer, clamping at its end.
+ */
+size_t MemoryByteSource::ReadAt(uint64_t offset, void* dst, size_t count) {
+    if (offset >= size) return 0;
+    const size_t available = static_cast<size_t>(size - offset);
+    const size_t n = std::min(count, available);
+    memcpy(dst, data + offset, n);
+    return n;
+}
+
+FileByteSource::~FileByteSource() {
+    Close();
+}
+
+WritableMappedFile::~WritableMappedFile() {
+    Close();
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+#ifdef _WIN32
+
+/**
+ * @brief Opens the file with full sharing so probing never blocks Explorer, editors or
+ *        a concurrent decode of the same photo.
+ */
+bool FileByteSource::Open(const std::filesystem::path& path) {
+    Close();
+    HANDLE h = CreateFileW(path.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(h, &size)) {
+        CloseHandle(h);
+        return false;
+    }
+    handle = h;
+    file_size = static_cast<uint64_t>(size.QuadPart);
+    return true;
+}
+
+void FileByteSource::Close() {
+    if (handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(handle);
+        handle = INVALID_HANDLE_VALUE;
+    }
+    file_size = 0;
+}
+
+bool FileByteSource::IsOpen() const {
+    return handle != INVALID_HANDLE_VALUE;
+}
+
+/**
+ * @brief Positional read: the offset travels in the OVERLAPPED block, so the handle's
+ *        file pointer is never used and one handle can serve reads in any order.
+ */
+size_t FileByteSource::ReadAt(uint64_t offset, void* dst, size_t size) {
+    if (handle == INVALID_HANDLE_VALUE || offset >= file_size) return 0;
+    size = static_cast<size_t>(std::min<uint64_t>(size, file_size - offset));
+
+    size_t total = 0;
+    while (total < size) {
+        OVERLAPPED ov{};
+        const uint64_t at = offset + total;
+        ov.Offset = static_cast<DWORD>(at & 0xFFFFFFFFu);
+        ov.OffsetHigh = static_cast<DWORD>(at >> 32);
+        const DWORD chunk = static_cast<DWORD>(std::min<size_t>(size - total, 0x40000000u));
+        DWORD read = 0;
+        if (!ReadFile(handle, static_cast<uint8_t*>(dst) + total, chunk, &read, &ov) || read == 0) break;
+        total += read;
+    }
+    return total;
+}
+
+/**
+ * @brief Maps the whole file read-only. The file handle is closed as soon as the section
+ *        exists; the view keeps the file alive until Close().
+ * @details Shares like FileByteSource::Open(), so a file another process has open for writing
+ *          can still be read. While the view exists, Windows refuses to truncate the file, so
+ *          the mapped range stays backed; a concurrent write can only change the bytes in it.
+ */
+bool MappedFile::Open(const std::filesystem::path& path) {
+    Close();
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 ||
+        static_cast<uint64_t>(file_size.QuadPart) > SIZE_MAX) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE section = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!section) return false;
+
+    void* view = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(section);
+        return false;
+    }
+    mapping = section;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(file_size.QuadPart);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    data = nullptr;
+    mapping = nullptr;
+    size = 0;
+}
+
+/**
+ * @brief Creating a mapping larger than the file extends the file, so no explicit resize
+ *        is needed. Delete sharing lets the owner remove a segment file it has unmapped.
+ */
+bool WritableMappedFile::Open(const std::filesystem::path& path, uint64_t min_size) {
+    Close();
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return false;
+    }
+    const uint64_t target = std::max<uint64_t>(static_cast<uint64_t>(file_size.QuadPart), min_size);
+    if (target == 0 || target > SIZE_MAX) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE section = CreateFileMappingW(file, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(target >> 32), static_cast<DWORD>(target), nullptr);
+    CloseHandle(file);
+    if (!section) return false;
+
+    void* view = MapViewOfFile(section, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+    if (!view) {
+        CloseHandle(section);
+        return false;
+    }
+    mapping = section;
+    data = static_cast<uint8_t*>(view);
+    size = static_cast<size_t>(target);
+    return true;
+}
+
+void WritableMappedFile::Close() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    data = nullptr;
+    mapping = nullptr;
+    size = 0;
+}
+
+bool WritableMappedFile::Flush(size_t offset, size_t length) {
+    if (!data || offset >= size) return false;
+    length = std::min(length, size - offset);
+    return FlushViewOfFile(data + offset, length) != FALSE;
+}
+
+#else
+
+bool FileByteSource::Open(const std::filesystem::path& path) {
+    Close();
+    int f = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (f < 0) return false;
+
+    struct stat st;
+    if (fstat(f, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(f);
+        return false;
+    }
+    fd = f;
+    file_size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+void FileByteSource::Close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    file_size = 0;
+}
+
+bool FileByteSource::IsOpen() const {
+    return fd >= 0;
+}
+
+size_t FileByteSource::ReadAt(uint64_t offset, void* dst, size_t size) {
+    if (fd < 0 || offset >= file_size) return 0;
+    size = static_cast<size_t>(std::min<uint64_t>(size, file_size - offset));
+
+    size_t total = 0;
+    while (total < size) {
+        const ssize_t read = ::pread(fd, static_cast<uint8_t*>(dst) + total, size - total,
+            static_cast<off_t>(offset + total));
+        if (read <= 0) break;
+        total += static_cast<size_t>(read);
+    }
+    return total;
+}
+
+bool MappedFile::Open(const std::filesystem::path& path) {
+    Close();
+    int f = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (f < 0) return false;
+
+    struct stat st;
+    if (fstat(f, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        ::close(f);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, f, 0);
+    ::close(f);
+    if (view == MAP_FAILED) return false;
+
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+    data = nullptr;
+    size = 0;
+}
+
+bool WritableMappedFile::Open(const std::filesystem::path& path, uint64_t min_size) {
+    Close();
+    int f = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (f < 0) return false;
+
+    struct stat st;
+    if (fstat(f, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(f);
+        return false;
+    }
+    const uint64_t target = std::max<uint64_t>(static_cast<uint64_t>(st.st_size), min_size);
+    if (target == 0 || target > SIZE_MAX ||
+        (target > static_cast<uint64_t>(st.st_size) && ftruncate(f, static_cast<off_t>(target)) != 0)) {
+        ::close(f);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(target), PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
+    ::close(f);
+    if (view == MAP_FAILED) return false;
+
+    data = static_cast<uint8_t*>(view);
+    size = static_cast<size_t>(target);
+    return true;
+}
+
+void WritableMappedFile::Close() {
+    if (data) munmap(data, size);
+    data = nullptr;
+    size = 0;
+}
+
+/** @brief msync needs a page-aligned start, so the range is widened down to the page boundary. */
+bool WritableMappedFile::Flush(size_t offset, size_t length) {
+    if (!data || offset >= size) return false;
+    length = std::min(length, size - offset);
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t start = offset - offset % page;
+    return msync(data + start, length + (offset - start), MS_ASYNC) == 0;
+}
+
+#endif
+
+/**
+ * @brief Serves the read from the cached window, refilling it at `offset` on a miss.
+ *        Requests larger than the window bypass it entirely.
+ */
+bool WindowedReader::Read(uint64_t offset, void* dst, size_t size) {
+    if (size > kWindowSize) {
+        return source.ReadExact(offset, dst, size);
+    }
+    if (offset < window_offset || offset + size > window_offset + window_length) {
+        window_offset = offset;
+        window_length = source.ReadAt(offset, window, kWindowSize);
+        if (size > window_length) return false;
+    }
+    memcpy(dst, window + (offset - window_offset), size);
+    return true;
+}
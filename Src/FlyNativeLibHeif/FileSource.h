@@ -0,0 +1,166 @@
+/**
+ * @file FileSource.h
+ * @brief Defines small random-access byte sources used by the header parsers.
+ *
+ * The header probe, folder index and format parsers only ever need a handful of bytes at
+ * known offsets. These classes give them a uniform `ReadAt` view over either an open file
+ * or an in-memory buffer, without pulling Windows headers into the parsers themselves so
+ * the parsing code can be built and benchmarked on other platforms too.
+ */
+
+#pragma once
+#ifndef FILE_SOURCE_H
+#define FILE_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+/// @brief A random-access, read-only view over a sequence of bytes.
+class ByteSource {
+public:
+    virtual ~ByteSource() = default;
+
+    /// @brief Copies up to `size` bytes starting at `offset` into `dst`.
+    /// @return The number of bytes actually copied; less than `size` only at end of data or on error.
+    virtual size_t ReadAt(uint64_t offset, void* dst, size_t size) = 0;
+
+    /// @brief Total number of bytes available.
+    virtual uint64_t Size() const = 0;
+
+    /// @brief Reads exactly `size` bytes or fails.
+    bool ReadExact(uint64_t offset, void* dst, size_t size) {
+        return ReadAt(offset, dst, size) == size;
+    }
+};
+
+/// @brief A ByteSource over a caller-owned memory buffer. Performs no copies.
+class MemoryByteSource : public ByteSource {
+public:
+    MemoryByteSource(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    size_t ReadAt(uint64_t offset, void* dst, size_t count) override;
+    uint64_t Size() const override { return size; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+};
+
+/// @brief A ByteSource over a file opened for shared, read-only access.
+/// @details Uses positional reads (ReadFile with an OVERLAPPED offset on Windows, pread
+///          elsewhere), so a single instance never seeks and never buffers more than asked.
+class FileByteSource : public ByteSource {
+public:
+    FileByteSource() = default;
+    ~FileByteSource() override;
+
+    FileByteSource(const FileByteSource&) = delete;
+    FileByteSource& operator=(const FileByteSource&) = delete;
+
+    /// @brief Opens the file. Returns false if it does not exist or cannot be read.
+    bool Open(const std::filesystem::path& path);
+
+    /// @brief Closes the file. Safe to call more than once.
+    void Close();
+
+    bool IsOpen() const;
+
+    size_t ReadAt(uint64_t offset, void* dst, size_t size) override;
+    uint64_t Size() const override { return file_size; }
+
+private:
+#ifdef _WIN32
+    void* handle = reinterpret_cast<void*>(static_cast<intptr_t>(-1)); ///< INVALID_HANDLE_VALUE
+#else
+    int fd = -1;
+#endif
+    uint64_t file_size = 0;
+};
+
+/// @brief Serves small reads from a single cached window over another ByteSource.
+/// @details Header walks read a few bytes at a time from nearby offsets (JPEG segment
+///          markers, ISOBMFF box headers). Refilling one window per miss turns dozens of
+///          tiny reads into one or two system calls.
+class WindowedReader {
+public:
+    static constexpr size_t kWindowSize = 4096;
+
+    explicit WindowedReader(ByteSource& source) : source(source) {}
+
+    /// @brief Reads exactly `size` bytes at `offset`, refilling the window when needed.
+    bool Read(uint64_t offset, void* dst, size_t size);
+
+    uint64_t Size() const { return source.Size(); }
+    ByteSource& Source() { return source; }
+
+private:
+    ByteSource& source;
+    uint8_t window[kWindowSize];
+    uint64_t window_offset = 0;
+    size_t window_length = 0;
+};
+
+/// @brief A read-only memory mapping of a whole file.
+/// @details Used for the on-disk indexes, which are read far more often than written and
+///          are laid out so records can be used straight from the mapping.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// @brief Maps the file. Returns false if it does not exist, is empty or cannot be mapped.
+    bool Open(const std::filesystem::path& path);
+
+    /// @brief Unmaps the file. Safe to call more than once.
+    void Close();
+
+    const uint8_t* Data() const { return data; }
+    size_t Size() const { return size; }
+    bool IsOpen() const { return data != nullptr; }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+};
+
+/// @brief A read-write, shared memory mapping of a whole file, created or grown to a fixed size.
+/// @details Used by the thumbnail store, whose segment and index files are written in place
+///          through the mapping and read back by other threads without copying.
+class WritableMappedFile {
+public:
+    WritableMappedFile() = default;
+    ~WritableMappedFile();
+
+    WritableMappedFile(const WritableMappedFile&) = delete;
+    WritableMappedFile& operator=(const WritableMappedFile&) = delete;
+
+    /// @brief Opens or creates the file, grows it to at least `min_size` bytes and maps all of it.
+    /// @details Growth leaves a sparse (or lazily zeroed) tail, so reserving a large file is cheap.
+    bool Open(const std::filesystem::path& path, uint64_t min_size);
+
+    /// @brief Unmaps the file. Modified pages are still written back by the OS. Safe to call more than once.
+    void Close();
+
+    /// @brief Starts writing back the pages covering [offset, offset + length). Does not wait for the disk.
+    bool Flush(size_t offset, size_t length);
+
+    uint8_t* Data() const { return data; }
+    size_t Size() const { return size; }
+    bool IsOpen() const { return data != nullptr; }
+
+private:
+    uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+};
+
+#endif // FILE_SOURCE_H
@@ -0,0 +1,54 @@
+/**
+ * @file FlyHeifApi.cpp
+ * @brief Implements the versioned API table returned by GetFlyHeifApiTable().
+ */
+
+#include "pch.h"
+#include "FlyHeifApi.h"
+#include "CpuFeatures.h"
+#include "NativeExports.h"
+#include <algorithm>
+#include <thread>
+
+namespace {
+    /**
+     * @brief Asks libheif which codecs were compiled in. The vcpkg build ships libde265 and
+     * dav1d, but a trimmed build may not, and that is exactly what a caller wants to know
+     * before it routes a file here.
+     */
+    uint32_t DetectCapabilities(int max_threads) {
+        uint32_t caps = FlyHeifCap_ScaledDecode | FlyHeifCap_Sequences;
+        if (heif_have_decoder_for_format(heif_compression_HEVC)) caps |= FlyHeifCap_HevcDecoder;
+        if (heif_have_decoder_for_format(heif_compression_AV1)) caps |= FlyHeifCap_Av1Decoder;
+        if (max_threads > 1) caps |= FlyHeifCap_Threads;
+        // HdrOutput and RegionDecode stay clear: the output is always RGBA8 and the whole
+        // image is decoded. The bits are reserved so a later build can report them.
+        return caps;
+    }
+
+    FlyHeifApi BuildTable() {
+        FlyHeifApi api{};
+        api.struct_size = sizeof(FlyHeifApi);
+        api.version = FLY_HEIF_API_VERSION;
+        api.max_threads = static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+        api.capabilities = DetectCapabilities(api.max_threads);
+        api.simd_level = static_cast<int32_t>(CpuFeatures::Level());
+        api.libheif_version = heif_get_version_number();
+
+        api.DecodeFile = &DecodeHeifImage;
+        api.DecodeMemory = &DecodeHeifImageFromMemory;
+        api.FreePixelBuffer = &FreePixelBuffer;
+        api.ProbeImage = &ProbeImage;
+        api.GetLastReport = &GetLastDecodeReport;
+        return api;
+    }
+}
+
+/**
+ * @brief Returns the table, filled in once. Function-local static initialisation is
+ * thread-safe, so concurrent first calls are fine.
+ */
+const FlyHeifApi* GetFlyHeifApiTable() {
+    static const FlyHeifApi table = BuildTable();
+    return &table;
+}
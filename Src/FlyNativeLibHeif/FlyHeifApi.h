@@ -0,0 +1,71 @@
+/**
+ * @file FlyHeifApi.h
+ * @brief Defines the versioned function table through which callers discover what this
+ *        build of FlyNativeLibHeif can do.
+ *
+ * Instead of calling a decode export and falling back to another decoder when it fails,
+ * a caller asks for the table once at startup with GetFlyHeifApi(), reads the capability
+ * flags (which codecs are compiled in, SIMD level, thread count) and picks its decode path
+ * up front. New entries are only ever appended; `struct_size` tells the caller which ones
+ * exist, and a new `version` is introduced only if an existing entry changes meaning.
+ */
+
+#pragma once
+#ifndef FLY_HEIF_API_H
+#define FLY_HEIF_API_H
+
+#include <cstddef>
+#include <cstdint>
+#include "HeifReader.h"
+#include "ImageProbe.h"
+#include "DecodeReport.h"
+
+/// @brief The newest table version this build can return.
+#define FLY_HEIF_API_VERSION 1
+
+/// @brief Capability bits reported in FlyHeifApi::capabilities. Values are shared with the managed side.
+enum FlyHeifCapability : uint32_t {
+    FlyHeifCap_HevcDecoder  = 1u << 0,  ///< A HEVC decoder (libde265) is available: .heic/.heif/.hif decode natively.
+    FlyHeifCap_Av1Decoder   = 1u << 1,  ///< An AV1 decoder (dav1d) is available: .avif decodes natively.
+    FlyHeifCap_Sequences    = 1u << 2,  ///< Image sequences (animated AVIF/HEIF) can be played.
+    FlyHeifCap_Threads      = 1u << 3,  ///< FlyHeifDecodeOptions::thread_count is honoured.
+    FlyHeifCap_ScaledDecode = 1u << 4,  ///< FlyHeifDecodeOptions::max_width/max_height are honoured.
+    FlyHeifCap_HdrOutput    = 1u << 5,  ///< Reserved: more than 8 bits per channel in the output buffer.
+    FlyHeifCap_RegionDecode = 1u << 6,  ///< Reserved: decoding a sub-rectangle without the whole image.
+};
+
+/// @brief Signature of FlyHeifApi::DecodeFile. See DecodeHeifImage().
+typedef HeifError (*FlyHeifDecodeFileFn)(const wchar_t* path, const FlyHeifDecodeOptions* options, PixelBuffer* out_buffer);
+
+/// @brief Signature of FlyHeifApi::DecodeMemory. See DecodeHeifImageFromMemory().
+typedef HeifError (*FlyHeifDecodeMemoryFn)(const uint8_t* data, size_t size, const FlyHeifDecodeOptions* options, PixelBuffer* out_buffer, bool* out_is_animated);
+
+/// @brief Signature of FlyHeifApi::FreePixelBuffer. See FreePixelBuffer().
+typedef void (*FlyHeifFreePixelBufferFn)(PixelBuffer* buffer);
+
+/// @brief Signature of FlyHeifApi::ProbeImage. See ProbeImage().
+typedef bool (*FlyHeifProbeImageFn)(const wchar_t* path, ImageProbeInfo* out_info);
+
+/// @brief Signature of FlyHeifApi::GetLastReport. See GetLastDecodeReport().
+typedef bool (*FlyHeifGetLastReportFn)(DecodeReport* out_report);
+
+/// @brief The version 1 function table. Static for the lifetime of the DLL; never freed by the caller.
+struct FlyHeifApi {
+    uint32_t struct_size;       ///< sizeof(FlyHeifApi) in this build. Entries beyond it do not exist.
+    uint32_t version;           ///< The table version that was returned.
+    uint32_t capabilities;      ///< A combination of FlyHeifCapability.
+    int32_t simd_level;         ///< A SimdLevel value: the widest vector extension this machine supports.
+    int32_t max_threads;        ///< Suggested upper bound for FlyHeifDecodeOptions::thread_count.
+    uint32_t libheif_version;   ///< heif_get_version_number(), i.e. 0xHHMMLL00.
+
+    FlyHeifDecodeFileFn DecodeFile;
+    FlyHeifDecodeMemoryFn DecodeMemory;
+    FlyHeifFreePixelBufferFn FreePixelBuffer;
+    FlyHeifProbeImageFn ProbeImage;
+    FlyHeifGetLastReportFn GetLastReport;
+};
+
+/// @brief Builds the process-wide table on first use.
+const FlyHeifApi* GetFlyHeifApiTable();
+
+#endif // FLY_HEIF_API_H
@@ -0,0 +1,264 @@
+/**
+ * @file FolderIndex.cpp
+ * @brief Implements FolderIndex.
+ */
+
+#include "FolderIndex.h"
+#include "ExifParser.h"
+#include "ImageProbe.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+    constexpr char kMagic[8] = { 'F', 'L', 'Y', 'F', 'I', 'D', 'X', '\0' };
+
+    /// File header. Records start right after it; the name blob follows the records.
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_size;
+        uint64_t count;
+        uint64_t names_size;
+    };
+    static_assert(sizeof(Header) == 32, "FolderIndex header layout changed");
+
+    /// A file found by the directory enumeration, before probing.
+    struct Candidate {
+        std::string name;
+        uint64_t file_size;
+        int64_t mtime;
+    };
+
+    std::string LowerAscii(std::string s) {
+        for (char& c : s) {
+            if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+        return s;
+    }
+}
+
+/// On-disk record: the exported entry followed by the location of its name in the blob.
+struct FolderIndex::Record {
+    FolderIndexEntry entry;
+    uint32_t name_offset;
+    uint32_t name_length;
+};
+static_assert(sizeof(FolderIndexEntry) == 40, "FolderIndexEntry layout is shared with the managed side");
+
+/**
+ * @brief Maps the file and checks that the header, record array and name blob fit in it.
+ *        Records are trusted afterwards, so any mismatch rejects the whole file.
+ */
+bool FolderIndex::Load(const std::filesystem::path& index_file) {
+    Close();
+    if (!file.Open(index_file)) return false;
+
+    const uint8_t* data = file.Data();
+    const size_t size = file.Size();
+    Header header;
+    if (size < sizeof(Header)) { Close(); return false; }
+    memcpy(&header, data, sizeof(header));
+
+    const uint64_t records_bytes = header.count * sizeof(Record);
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.record_size != sizeof(Record) || header.count > size / sizeof(Record) ||
+        sizeof(Header) + records_bytes + header.names_size != size) {
+        Close();
+        return false;
+    }
+
+    records = reinterpret_cast<const Record*>(data + sizeof(Header));
+    names = reinterpret_cast<const char*>(data + sizeof(Header) + records_bytes);
+    names_size = static_cast<size_t>(header.names_size);
+    count = static_cast<size_t>(header.count);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (static_cast<uint64_t>(records[i].name_offset) + records[i].name_length > names_size) {
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void FolderIndex::Close() {
+    file.Close();
+    records = nullptr;
+    names = nullptr;
+    names_size = 0;
+    count = 0;
+}
+
+const FolderIndexEntry* FolderIndex::At(size_t i) const {
+    return i < count ? &records[i].entry : nullptr;
+}
+
+std::string_view FolderIndex::NameAt(size_t i) const {
+    if (i >= count) return {};
+    return std::string_view(names + records[i].name_offset, records[i].name_length);
+}
+
+const FolderIndexEntry* FolderIndex::Find(std::string_view utf8_name) const {
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        const int cmp = NameAt(mid).compare(utf8_name);
+        if (cmp == 0) return &records[mid].entry;
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Enumerates the folder, reuses entries whose size and mtime are unchanged, probes
+ *        the rest in parallel, and rewrites the index only when something differs.
+ * @details The enumeration itself supplies size and mtime (on Windows the directory
+ *          iterator caches them from FindNextFile), so unchanged files are never opened.
+ *          The new index is written to a temporary file and renamed over the old one, so
+ *          a crash mid-write leaves the previous index intact.
+ */
+bool FolderIndex::Refresh(const std::filesystem::path& folder, const std::filesystem::path& index_file,
+                          const std::vector<std::string>& extensions, FolderIndexRefreshStats* stats) {
+    FolderIndexRefreshStats local{};
+    FolderIndexRefreshStats& s = stats ? *stats : local;
+    s = {};
+
+    // 1. The current index, if any, is the baseline.
+    Load(index_file);
+
+    // 2. One pass over the directory.
+    std::vector<Candidate> candidates;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(folder, std::filesystem::directory_options::skip_permission_denied, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        const auto& entry = *it;
+        std::error_code entry_ec;
+        if (!entry.is_regular_file(entry_ec)) continue;
+
+        const std::string extension = LowerAscii(entry.path().extension().u8string());
+        if (std::find(extensions.begin(), extensions.end(), extension) == extensions.end()) continue;
+
+        const uint64_t file_size = entry.file_size(entry_ec);
+        if (entry_ec) continue;
+        const auto write_time = entry.last_write_time(entry_ec);
+        if (entry_ec) continue;
+
+        candidates.push_back({ entry.path().filename().u8string(), file_size,
+                               static_cast<int64_t>(write_time.time_since_epoch().count()) });
+    }
+    if (ec && candidates.empty()) return IsLoaded();
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) { return a.name < b.name; });
+
+    // 3. Split into reused and to-probe.
+    std::vector<FolderIndexEntry> entries(candidates.size());
+    std::vector<size_t> to_probe;
+    size_t matched = 0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const Candidate& c = candidates[i];
+        const FolderIndexEntry* old = Find(c.name);
+        if (old) ++matched;
+        if (old && old->file_size == c.file_size && old->mtime == c.mtime) {
+            entries[i] = *old;
+            ++s.reused;
+        }
+        else {
+            to_probe.push_back(i);
+        }
+    }
+    s.removed = static_cast<int32_t>(count - matched);
+    s.probed = static_cast<int32_t>(to_probe.size());
+    s.total = static_cast<int32_t>(candidates.size());
+
+    if (IsLoaded() && to_probe.empty() && s.removed == 0) return true;
+
+    // 4. Probe new and changed files. Files the probe does not understand are still
+    //    recorded (format 0) so they are not reopened on the next refresh.
+    std::atomic<size_t> next{ 0 };
+    auto work = [&]() {
+        for (size_t n = next.fetch_add(1); n < to_probe.size(); n = next.fetch_add(1)) {
+            const size_t i = to_probe[n];
+            ImageProbeInfo info;
+            ExifInfo exif;
+            const bool ok = ImageProbe::ProbeFile(folder / std::filesystem::u8path(candidates[i].name), info, &exif);
+
+            FolderIndexEntry& e = entries[i];
+            e = {};
+            e.file_size = candidates[i].file_size;
+            e.mtime = candidates[i].mtime;
+            if (ok) {
+                e.width = info.width;
+                e.height = info.height;
+                e.format = info.format;
+                e.orientation = info.orientation;
+                e.capture_time = exif.capture_time;
+            }
+        }
+    };
+    const unsigned threads = static_cast<unsigned>(std::min<size_t>(
+        std::max(1u, std::thread::hardware_concurrency()), (to_probe.size() + 15) / 16));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+
+    // 5. Persist and remap. The old mapping must go first: Windows cannot replace a mapped file.
+    std::vector<std::string> sorted_names;
+    sorted_names.reserve(candidates.size());
+    for (auto& c : candidates) sorted_names.push_back(std::move(c.name));
+
+    Close();
+    if (!Write(index_file, entries, sorted_names)) return false;
+    return Load(index_file);
+}
+
+bool FolderIndex::Write(const std::filesystem::path& index_file,
+                        const std::vector<FolderIndexEntry>& entries,
+                        const std::vector<std::string>& names) {
+    std::vector<Record> out(entries.size());
+    std::string blob;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        out[i].entry = entries[i];
+        out[i].name_offset = static_cast<uint32_t>(blob.size());
+        out[i].name_length = static_cast<uint32_t>(names[i].size());
+        blob += names[i];
+    }
+
+    Header header{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.record_size = sizeof(Record);
+    header.count = out.size();
+    header.names_size = blob.size();
+
+    std::error_code ec;
+    std::filesystem::create_directories(index_file.parent_path(), ec);
+
+    std::filesystem::path temp = index_file;
+    temp += ".tmp";
+    {
+        std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+        if (!stream) return false;
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size() * sizeof(Record)));
+        stream.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+        if (!stream.flush()) {
+            stream.close();
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(temp, index_file, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file FolderIndex.h
+ * @brief Defines FolderIndex, a per-folder file of image metadata stored under the app data.
+ *
+ * The index records size, modification time, dimensions, orientation, capture time and
+ * format for every image in one folder. It is a flat binary file (header, fixed-size
+ * records sorted by name, then a name blob) that is memory-mapped and read in place, so
+ * reopening a large folder costs one directory enumeration and no image file opens.
+ * Refresh() compares size and mtime against the directory listing and only probes files
+ * that are new or changed.
+ */
+
+#pragma once
+#ifndef FOLDER_INDEX_H
+#define FOLDER_INDEX_H
+
+#include "FileSource.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief Metadata for one file. Blittable for P/Invoke; also the head of each on-disk record.
+struct FolderIndexEntry {
+    uint64_t file_size;     ///< Size in bytes.
+    int64_t mtime;          ///< Last write time in file-clock ticks (FILETIME units on Windows).
+    int64_t capture_time;   ///< EXIF capture time in seconds since 1970 (camera local time), 0 if unknown.
+    int32_t width;          ///< Stored pixel width, 0 if the format is not probed.
+    int32_t height;         ///< Stored pixel height, 0 if the format is not probed.
+    int32_t format;         ///< An ImageFormat value.
+    int32_t orientation;    ///< EXIF-style orientation (1..8), 0 if unknown.
+};
+
+/// @brief Counters reported by FolderIndex::Refresh.
+struct FolderIndexRefreshStats {
+    int32_t total;      ///< Files in the refreshed index.
+    int32_t reused;     ///< Files whose size and mtime matched, so were not opened.
+    int32_t probed;     ///< New or changed files that were probed.
+    int32_t removed;    ///< Entries dropped because their file no longer exists.
+};
+
+/// @brief A memory-mapped, name-sorted index of the images in one folder.
+class FolderIndex {
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    /// @brief Maps an existing index file. Fails if it is missing or was written by another version.
+    bool Load(const std::filesystem::path& index_file);
+
+    /// @brief Unmaps the index.
+    void Close();
+
+    /// @brief Brings the index for `folder` up to date and maps the result.
+    /// @param folder The folder to enumerate (not recursive).
+    /// @param index_file Where the index lives; rewritten only if something changed.
+    /// @param extensions Lower-case extensions including the dot (".jpg") to include.
+    /// @param stats Optional counters describing the work done.
+    /// @return true if the index is mapped afterwards.
+    bool Refresh(const std::filesystem::path& folder, const std::filesystem::path& index_file,
+                 const std::vector<std::string>& extensions, FolderIndexRefreshStats* stats = nullptr);
+
+    /// @brief True while an index file is mapped.
+    bool IsLoaded() const { return file.IsOpen(); }
+
+    /// @brief Number of entries in the mapped index.
+    size_t Count() const { return count; }
+
+    /// @brief Looks up a file by its UTF-8 file name (no directory). Binary search, no allocation.
+    const FolderIndexEntry* Find(std::string_view utf8_name) const;
+
+    /// @brief Entry `i` in name order.
+    const FolderIndexEntry* At(size_t i) const;
+
+    /// @brief UTF-8 file name of entry `i`.
+    std::string_view NameAt(size_t i) const;
+
+private:
+    struct Record;
+
+    static bool Write(const std::filesystem::path& index_file,
+                      const std::vector<FolderIndexEntry>& entries,
+                      const std::vector<std::string>& names);
+
+    MappedFile file;
+    const Record* records = nullptr;
+    const char* names = nullptr;
+    size_t names_size = 0;
+    size_t count = 0;
+};
+
+#endif // FOLDER_INDEX_H
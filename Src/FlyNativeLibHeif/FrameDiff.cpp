@@ -0,0 +1,107 @@
+/**
+ * @file FrameDiff.cpp
+ * @brief Implements FrameDiff.
+ */
+
+#include "FrameDiff.h"
+#include "CpuFeatures.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLY_DIFF_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    size_t FirstDiffScalar(const uint32_t* a, const uint32_t* b, size_t count) {
+        size_t i = 0;
+        while (i < count && a[i] == b[i]) ++i;
+        return i;
+    }
+
+    size_t LastDiffScalar(const uint32_t* a, const uint32_t* b, size_t count) {
+        size_t n = count;
+        while (n > 0 && a[n - 1] == b[n - 1]) --n;
+        return n;
+    }
+
+#ifdef FLY_DIFF_SSE2
+    /// True if the eight pixels at `a` and `b` are equal.
+    inline bool Equal8(const uint32_t* a, const uint32_t* b) {
+        const __m128i lo = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+        const __m128i hi = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 4)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 4)));
+        return _mm_movemask_epi8(_mm_and_si128(lo, hi)) == 0xFFFF;
+    }
+
+    // The vector loop stops at the first block of eight that differs; the scalar loop then
+    // finds the pixel within it, so the kernels return exactly what the scalar ones do.
+
+    size_t FirstDiffSse2(const uint32_t* a, const uint32_t* b, size_t count) {
+        size_t i = 0;
+        while (i + 8 <= count && Equal8(a + i, b + i)) i += 8;
+        return i + FirstDiffScalar(a + i, b + i, count - i);
+    }
+
+    size_t LastDiffSse2(const uint32_t* a, const uint32_t* b, size_t count) {
+        size_t n = count;
+        while (n >= 8 && Equal8(a + n - 8, b + n - 8)) n -= 8;
+        return LastDiffScalar(a, b, n);
+    }
+#endif
+}
+
+void FrameDiff::SetSimd(bool enabled) {
+    first_ = &FirstDiffScalar;
+    last_ = &LastDiffScalar;
+#ifdef FLY_DIFF_SSE2
+    if (enabled && CpuFeatures::Level() >= SimdLevel::Sse2) {
+        first_ = &FirstDiffSse2;
+        last_ = &LastDiffSse2;
+    }
+#else
+    (void)enabled;
+#endif
+}
+
+/**
+ * @brief Finds the top row that differs, then the bottom one, and then widens the column range
+ *        with the rows between them. Only the pixels to the left and right of the range found
+ *        so far need to be compared.
+ */
+FrameRect FrameDiff::Compare(const uint32_t* before, const uint32_t* after, int32_t width, int32_t height) const {
+    const size_t w = static_cast<size_t>(width);
+    size_t left = w, right = 0;
+
+    int32_t top = 0;
+    for (; top < height; ++top) {
+        const size_t offset = static_cast<size_t>(top) * w;
+        left = first_(before + offset, after + offset, w);
+        if (left < w) {
+            right = last_(before + offset, after + offset, w);
+            break;
+        }
+    }
+    if (top == height) return FrameRect{};
+
+    int32_t bottom = height - 1;
+    for (; bottom > top; --bottom) {
+        const size_t offset = static_cast<size_t>(bottom) * w;
+        const size_t first = first_(before + offset, after + offset, w);
+        if (first < w) {
+            if (first < left) left = first;
+            const size_t last = last_(before + offset, after + offset, w);
+            if (last > right) right = last;
+            break;
+        }
+    }
+
+    for (int32_t y = top + 1; y < bottom; ++y) {
+        const size_t offset = static_cast<size_t>(y) * w;
+        const size_t first = first_(before + offset, after + offset, left);
+        if (first < left) left = first;
+        right += last_(before + offset + right, after + offset + right, w - right);
+    }
+    return FrameRect{static_cast<int32_t>(left), top, static_cast<int32_t>(right - left), bottom - top + 1};
+}
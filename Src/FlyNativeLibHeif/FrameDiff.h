@@ -0,0 +1,53 @@
+/**
+ * @file FrameDiff.h
+ * @brief Declares FrameDiff, which finds the rectangle in which two canvases differ.
+ *
+ * The GIF, APNG and WebP compositors know which rectangle each frame drew. Decoders that produce
+ * whole frames, such as libheif for AVIF sequences, do not, yet most animations change only part
+ * of the picture. FrameDiff compares the new frame with the one before it so that only the
+ * changed rectangle is uploaded:
+ *
+ * - Rows are compared eight pixels at a time, as SSE2 vectors where the CPU has them.
+ * - The first and last changed rows are found from the top and bottom. Rows between them are
+ *   compared only outside the columns already known to have changed. Pixels inside the
+ *   rectangle are never read twice, and most of them are not read at all.
+ *
+ * The result is one bounding rectangle, not a list. An animation slot holds one rectangle and
+ * Win2D uploads one per call.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef FRAME_DIFF_H
+#define FRAME_DIFF_H
+
+#include "FrameRect.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Compares two canvases of the same size.
+class FrameDiff {
+public:
+    /// @brief Index of the first pixel at which `a` and `b` differ, or `count` if none does.
+    using FirstDiffFn = size_t (*)(const uint32_t* a, const uint32_t* b, size_t count);
+
+    /// @brief One past the index of the last pixel at which `a` and `b` differ, or 0 if none does.
+    using LastDiffFn = size_t (*)(const uint32_t* a, const uint32_t* b, size_t count);
+
+    FrameDiff() { SetSimd(true); }
+
+    /// @brief The smallest rectangle outside which `before` and `after` are equal; empty if they are equal.
+    ///        Both are `width` x `height` pixels with no row padding.
+    FrameRect Compare(const uint32_t* before, const uint32_t* after, int32_t width, int32_t height) const;
+
+    /// @brief Selects the compare kernels: SSE2 where the CPU has it, or scalar.
+    void SetSimd(bool enabled);
+
+private:
+    FirstDiffFn first_ = nullptr;
+    LastDiffFn last_ = nullptr;
+};
+
+#endif // FRAME_DIFF_H
@@ -0,0 +1,40 @@
+/**
+ * @file FrameRect.h
+ * @brief Declares FrameRect, the canvas rectangle the animation compositors report as changed.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef FRAME_RECT_H
+#define FRAME_RECT_H
+
+#include <algorithm>
+#include <cstdint>
+
+/// @brief A pixel rectangle of an animation canvas. Blittable for P/Invoke.
+struct FrameRect {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+
+    bool Empty() const { return width <= 0 || height <= 0; }
+
+    /// @brief Grows this rectangle to cover `rect` as well.
+    void Unite(const FrameRect& rect) {
+        if (rect.Empty()) return;
+        if (Empty()) {
+            *this = rect;
+            return;
+        }
+        const int32_t right = std::max(x + width, rect.x + rect.width);
+        const int32_t bottom = std::max(y + height, rect.y + rect.height);
+        x = std::min(x, rect.x);
+        y = std::min(y, rect.y);
+        width = right - x;
+        height = bottom - y;
+    }
+};
+
+#endif // FRAME_RECT_H
@@ -0,0 +1,210 @@
+/**
+ * @file GifCompositor.cpp
+ * @brief Implements GifCompositor.
+ */
+
+#include "GifCompositor.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLY_GIF_AVX2 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define FLY_GIF_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define FLY_GIF_AVX2_TARGET
+#endif
+#endif
+
+namespace {
+
+    void ExpandRowScalar(const uint8_t* indices, int32_t count, const uint32_t* table, int32_t transparent,
+                         uint32_t* dst) {
+        if (transparent < 0) {
+            for (int32_t i = 0; i < count; ++i) dst[i] = table[indices[i]];
+            return;
+        }
+        for (int32_t i = 0; i < count; ++i) {
+            if (indices[i] != transparent) dst[i] = table[indices[i]];
+        }
+    }
+
+#ifdef FLY_GIF_AVX2
+    /// Eight pixels per iteration: the indices are widened to 32 bits and gathered from the table;
+    /// where an index is the transparent one, the canvas pixel is kept instead.
+    FLY_GIF_AVX2_TARGET void ExpandRowAvx2(const uint8_t* indices, int32_t count, const uint32_t* table,
+                                           int32_t transparent, uint32_t* dst) {
+        const int* base = reinterpret_cast<const int*>(table);
+        int32_t i = 0;
+        if (transparent < 0) {
+            for (; i + 8 <= count; i += 8) {
+                const __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_i32gather_epi32(base, idx, 4));
+            }
+        } else {
+            const __m256i key = _mm256_set1_epi32(transparent);
+            for (; i + 8 <= count; i += 8) {
+                const __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i)));
+                const __m256i colour = _mm256_i32gather_epi32(base, idx, 4);
+                const __m256i under = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+                const __m256i keep = _mm256_cmpeq_epi32(idx, key);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_blendv_epi8(colour, under, keep));
+            }
+        }
+        ExpandRowScalar(indices + i, count - i, table, transparent, dst + i);
+    }
+#endif
+
+    GifCompositor::ExpandRowFn SelectExpandKernel() {
+#ifdef FLY_GIF_AVX2
+        if (CpuFeatures::Level() >= SimdLevel::Avx2) return &ExpandRowAvx2;
+#endif
+        return &ExpandRowScalar;
+    }
+}
+
+bool GifCompositor::Open(const uint8_t* data, size_t size) {
+    if (!decoder_.Open(data, size)) return false;
+    canvas_.assign(static_cast<size_t>(Width()) * Height(), 0);
+    if (!expand_) expand_ = SelectExpandKernel();
+    MarkKeyFrames();
+    current_ = -1;
+    previous_rect_ = FrameRect{};
+    previous_disposal_ = 0;
+    frames_drawn_ = 0;
+    return true;
+}
+
+void GifCompositor::SetSimd(bool enabled) {
+    expand_ = enabled ? SelectExpandKernel() : &ExpandRowScalar;
+}
+
+void GifCompositor::Reset() {
+    std::fill(canvas_.begin(), canvas_.end(), 0u);
+    current_ = -1;
+    previous_rect_ = FrameRect{};
+    previous_disposal_ = 0;
+}
+
+/**
+ * @brief A key frame is drawn the same whatever was on the canvas. Truncated frames are the
+ *        exception: the rows they lack show what was under them, which after a seek is
+ *        transparent rather than the earlier frames.
+ */
+void GifCompositor::MarkKeyFrames() {
+    const int32_t count = decoder_.FrameCount();
+    const auto covers_canvas = [this](const GifFrameInfo& frame) {
+        const FrameRect rect = Clip(frame);
+        return rect.x == 0 && rect.y == 0 && rect.width == Width() && rect.height == Height();
+    };
+    key_frames_.assign(static_cast<size_t>(count), 0);
+    for (int32_t i = 0; i < count; ++i) {
+        const GifFrameInfo& frame = decoder_.Frame(i);
+        if (i == 0) {
+            key_frames_[i] = 1;
+            continue;
+        }
+        const GifFrameInfo& previous = decoder_.Frame(i - 1);
+        const bool covers = covers_canvas(frame) && frame.transparent_index < 0 &&
+                            frame.disposal != static_cast<int32_t>(GifDisposal::Previous);
+        const bool cleared = previous.disposal == static_cast<int32_t>(GifDisposal::Background) && covers_canvas(previous);
+        key_frames_[i] = covers || cleared ? 1 : 0;
+    }
+}
+
+bool GifCompositor::RenderTo(int32_t index, FrameRect& dirty) {
+    dirty = FrameRect{};
+    if (index < 0 || index >= decoder_.FrameCount()) return false;
+
+    int32_t key = index;
+    while (key > 0 && !key_frames_[key]) --key;
+    if (index < current_ || key > current_ + 1) {
+        Reset();
+        current_ = key - 1;
+        dirty = FrameRect{0, 0, Width(), Height()};
+    }
+    while (current_ < index) DrawNext(dirty);
+    return true;
+}
+
+/**
+ * @brief The previous frame's disposal is applied first; a restore-to-previous frame then saves
+ *        its rectangle as it is after that disposal, which is the state it must restore.
+ */
+void GifCompositor::DrawNext(FrameRect& dirty) {
+    const int32_t index = current_ + 1;
+    const GifFrameInfo& frame = decoder_.Frame(index);
+
+    if (previous_disposal_ == static_cast<int32_t>(GifDisposal::Background)) {
+        Fill(previous_rect_, 0);
+        dirty.Unite(previous_rect_);
+    } else if (previous_disposal_ == static_cast<int32_t>(GifDisposal::Previous) && !previous_rect_.Empty()) {
+        const FrameRect& r = previous_rect_;
+        for (int32_t y = 0; y < r.height; ++y) {
+            std::memcpy(canvas_.data() + static_cast<size_t>(r.y + y) * Width() + r.x,
+                        saved_.data() + static_cast<size_t>(y) * r.width, static_cast<size_t>(r.width) * 4);
+        }
+        dirty.Unite(r);
+    }
+
+    const FrameRect rect = Clip(frame);
+    if (frame.disposal == static_cast<int32_t>(GifDisposal::Previous) && !rect.Empty()) {
+        saved_.resize(static_cast<size_t>(rect.width) * rect.height);
+        for (int32_t y = 0; y < rect.height; ++y) {
+            std::memcpy(saved_.data() + static_cast<size_t>(y) * rect.width,
+                        canvas_.data() + static_cast<size_t>(rect.y + y) * Width() + rect.x,
+                        static_cast<size_t>(rect.width) * 4);
+        }
+    }
+
+    if (!rect.Empty()) {
+        const size_t decoded = decoder_.DecodeIndices(index, indices_);
+        decoder_.ColorTable(index, table_);
+        // Rows are visited in stream order so a truncated frame draws exactly what was decoded.
+        const size_t frame_width = static_cast<size_t>(frame.width);
+        const size_t rows = std::min<size_t>((decoded + frame_width - 1) / frame_width, frame.height);
+        const int32_t skip = rect.x - frame.x;
+        for (size_t row = 0; row < rows; ++row) {
+            const int32_t y = frame.y + (frame.interlaced ? GifDecoder::InterlacedRow(static_cast<int32_t>(row), frame.height)
+                                                          : static_cast<int32_t>(row));
+            if (y < rect.y || y >= rect.y + rect.height) continue;
+            const size_t first = row * frame_width + skip;
+            if (first >= decoded) break;
+            const int32_t count = static_cast<int32_t>(std::min<size_t>(rect.width, decoded - first));
+            expand_(indices_.data() + first, count, table_, frame.transparent_index,
+                    canvas_.data() + static_cast<size_t>(y) * Width() + rect.x);
+        }
+        dirty.Unite(rect);
+    }
+
+    previous_rect_ = rect;
+    previous_disposal_ = frame.disposal;
+    current_ = index;
+    ++frames_drawn_;
+}
+
+void GifCompositor::Fill(const FrameRect& rect, uint32_t value) {
+    for (int32_t y = 0; y < rect.height; ++y) {
+        uint32_t* row = canvas_.data() + static_cast<size_t>(rect.y + y) * Width() + rect.x;
+        std::fill(row, row + rect.width, value);
+    }
+}
+
+FrameRect GifCompositor::Clip(const GifFrameInfo& frame) const {
+    const int32_t x0 = std::min(frame.x, Width());
+    const int32_t y0 = std::min(frame.y, Height());
+    const int32_t x1 = std::min(frame.x + frame.width, Width());
+    const int32_t y1 = std::min(frame.y + frame.height, Height());
+    return FrameRect{x0, y0, x1 - x0, y1 - y0};
+}
+
+void GifCompositor::CopyRect(const FrameRect& rect, uint8_t* out) const {
+    const size_t row_bytes = static_cast<size_t>(rect.width) * 4;
+    for (int32_t y = 0; y < rect.height; ++y) {
+        std::memcpy(out + y * row_bytes, Pixels() + static_cast<size_t>(rect.y + y) * Stride() + static_cast<size_t>(rect.x) * 4,
+                    row_bytes);
+    }
+}
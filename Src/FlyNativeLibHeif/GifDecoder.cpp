@@ -0,0 +1,300 @@
+/**
+ * @file GifDecoder.cpp
+ * @brief Implements GifDecoder.
+ */
+
+#include "GifDecoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    constexpr int kMaxCodeBits = 12;
+    constexpr uint32_t kMaxCodes = 1u << kMaxCodeBits;
+
+    /// Bytes of zero padding after a joined LZW stream, so the 64-bit code loads stay in bounds.
+    constexpr size_t kStreamPad = 8;
+
+    uint16_t Read16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+    uint64_t Load64(const uint8_t* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    /// Skips a chain of data sub-blocks; returns the position after the terminator (or `size`).
+    size_t SkipSubBlocks(const uint8_t* data, size_t size, size_t pos) {
+        while (pos < size) {
+            const uint8_t length = data[pos++];
+            if (length == 0) return pos;
+            pos += length;
+        }
+        return size;
+    }
+
+    /**
+     * Copies `length` bytes from `src` to `dst` further on in the same buffer, front to back, so
+     * a source that runs into the destination repeats itself as LZ copies do. Eight bytes at a
+     * time when the two are at least that far apart; may write up to 7 bytes past the end.
+     */
+    inline void CopyForward(uint8_t* dst, const uint8_t* src, size_t length) {
+        if (dst - src >= 8) {
+            for (size_t i = 0; i < length; i += 8) std::memcpy(dst + i, src + i, 8);
+        } else {
+            for (size_t i = 0; i < length; ++i) dst[i] = src[i];
+        }
+    }
+}
+
+bool GifDecoder::Open(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    info_ = GifInfo{};
+    info_.loop_count = -1;
+    frames_.clear();
+
+    if (!data || size < 13 || std::memcmp(data, "GIF8", 4) != 0 || (data[4] != '7' && data[4] != '9') ||
+        data[5] != 'a') {
+        return false;
+    }
+    int32_t width = Read16(data + 6);
+    int32_t height = Read16(data + 8);
+    const uint8_t screen_flags = data[10];
+
+    size_t pos = 13;
+    size_t global_offset = 0;
+    int32_t global_size = 0;
+    if (screen_flags & 0x80) {
+        global_size = 2 << (screen_flags & 7);
+        global_offset = pos;
+        pos += 3 * static_cast<size_t>(global_size);
+        if (pos > size) return false;
+    }
+
+    // The graphic control extension applies to the next image only.
+    int32_t delay = 0;
+    int32_t disposal = 0;
+    int32_t transparent = -1;
+
+    while (pos < size) {
+        const uint8_t introducer = data[pos++];
+        if (introducer == 0x3B) break;
+
+        if (introducer == 0x21) {
+            if (pos >= size) break;
+            const uint8_t label = data[pos++];
+            if (label == 0xF9 && pos + 5 <= size && data[pos] == 4) {
+                const uint8_t flags = data[pos + 1];
+                delay = Read16(data + pos + 2);
+                disposal = (flags >> 2) & 7;
+                transparent = (flags & 1) ? data[pos + 4] : -1;
+            } else if (label == 0xFF && pos + 12 <= size && data[pos] == 11 &&
+                       (std::memcmp(data + pos + 1, "NETSCAPE2.0", 11) == 0 ||
+                        std::memcmp(data + pos + 1, "ANIMEXTS1.0", 11) == 0)) {
+                const size_t sub = pos + 12;
+                if (sub + 4 <= size && data[sub] >= 3 && data[sub + 1] == 1) info_.loop_count = Read16(data + sub + 2);
+            }
+            pos = SkipSubBlocks(data, size, pos);
+            continue;
+        }
+
+        if (introducer != 0x2C || pos + 9 > size) break;
+
+        FrameData frame{};
+        frame.info.x = Read16(data + pos);
+        frame.info.y = Read16(data + pos + 2);
+        frame.info.width = Read16(data + pos + 4);
+        frame.info.height = Read16(data + pos + 6);
+        const uint8_t image_flags = data[pos + 8];
+        pos += 9;
+        frame.info.interlaced = (image_flags & 0x40) ? 1 : 0;
+        frame.info.delay_ms = delay > 1 ? delay * 10 : 100;
+        frame.info.disposal = disposal;
+        frame.info.transparent_index = transparent;
+        frame.palette_offset = global_offset;
+        frame.palette_size = global_size;
+        if (image_flags & 0x80) {
+            frame.palette_size = 2 << (image_flags & 7);
+            frame.palette_offset = pos;
+            pos += 3 * static_cast<size_t>(frame.palette_size);
+        }
+        if (pos >= size) break;
+        frame.min_code_size = data[pos++];
+        frame.data_offset = pos;
+        pos = SkipSubBlocks(data, size, pos);
+
+        delay = 0;
+        disposal = 0;
+        transparent = -1;
+
+        const int64_t area = static_cast<int64_t>(frame.info.width) * frame.info.height;
+        if (area == 0 || area > kMaxPixels || frame.min_code_size < 1 || frame.min_code_size > 8) continue;
+        frames_.push_back(frame);
+        info_.duration_ms += frame.info.delay_ms;
+    }
+
+    if (frames_.empty()) return false;
+
+    // A zero logical screen is taken to mean "as large as the frames".
+    if (width == 0 || height == 0) {
+        for (const FrameData& frame : frames_) {
+            width = std::max(width, frame.info.x + frame.info.width);
+            height = std::max(height, frame.info.y + frame.info.height);
+        }
+    }
+    if (static_cast<int64_t>(width) * height > kMaxPixels) {
+        frames_.clear();
+        return false;
+    }
+    info_.width = width;
+    info_.height = height;
+    info_.frame_count = static_cast<int32_t>(frames_.size());
+    return true;
+}
+
+size_t GifDecoder::DecodeIndices(int32_t index, std::vector<uint8_t>& out) {
+    const FrameData& frame = frames_[index];
+    const size_t area = static_cast<size_t>(frame.info.width) * frame.info.height;
+    out.resize(area + kSlack);
+
+    stream_.clear();
+    size_t pos = frame.data_offset;
+    while (pos < size_) {
+        const uint8_t block = data_[pos++];
+        const size_t length = std::min<size_t>(block, size_ - pos);
+        if (length == 0) break;
+        stream_.insert(stream_.end(), data_ + pos, data_ + pos + length);
+        pos += length;
+    }
+    const size_t stream_size = stream_.size();
+    stream_.resize(stream_size + kStreamPad, 0);
+
+    return DecodeLzw(stream_.data(), stream_size, frame.min_code_size, out.data(), area);
+}
+
+void GifDecoder::ColorTable(int32_t index, uint32_t table[256]) const {
+    const FrameData& frame = frames_[index];
+    for (int i = 0; i < 256; ++i) table[i] = 0xFF000000u;
+    if (frame.palette_offset != 0) {
+        const uint8_t* rgb = data_ + frame.palette_offset;
+        for (int i = 0; i < frame.palette_size; ++i, rgb += 3) {
+            table[i] = 0xFF000000u | (static_cast<uint32_t>(rgb[0]) << 16) | (static_cast<uint32_t>(rgb[1]) << 8) | rgb[2];
+        }
+    }
+    if (frame.info.transparent_index >= 0) table[frame.info.transparent_index] = 0;
+}
+
+int32_t GifDecoder::InterlacedRow(int32_t row, int32_t height) {
+    const int32_t pass0 = (height + 7) / 8;
+    if (row < pass0) return row * 8;
+    row -= pass0;
+    const int32_t pass1 = (height + 3) / 8;
+    if (row < pass1) return 4 + row * 8;
+    row -= pass1;
+    const int32_t pass2 = (height + 1) / 4;
+    if (row < pass2) return 2 + row * 4;
+    row -= pass2;
+    return 1 + row * 2;
+}
+
+/**
+ * @brief Codes are read from a 64-bit window; while 48 bits remain, four codes of up to 12
+ *        bits each are taken from one load. A new dictionary entry is the previous string
+ *        plus the first index of the current one, which the output already holds contiguously
+ *        at the previous string's offset, so it is recorded as that offset and one more than
+ *        the previous length. Decoding stops at the end code, at the end of the data, when the
+ *        output is full, or at a code that is not yet defined.
+ */
+size_t GifDecoder::DecodeLzw(const uint8_t* src, size_t src_size, int min_code_size, uint8_t* out, size_t capacity) {
+    uint32_t offsets[kMaxCodes];
+    uint16_t lengths[kMaxCodes];
+
+    const uint32_t clear = 1u << min_code_size;
+    const uint32_t end = clear + 1;
+    int code_bits = min_code_size + 1;
+    uint32_t code_mask = (1u << code_bits) - 1;
+    uint32_t next = clear + 2;
+
+    size_t pos = 0;
+    size_t prev_pos = 0;
+    size_t prev_length = 0;             // 0 right after a clear code.
+
+    const uint64_t total_bits = static_cast<uint64_t>(src_size) * 8;
+    uint64_t bit_pos = 0;
+
+    while (pos < capacity) {
+        uint64_t window;
+        int codes;
+        if (bit_pos + 4 * kMaxCodeBits <= total_bits) {
+            window = Load64(src + (bit_pos >> 3)) >> (bit_pos & 7);
+            codes = 4;
+        } else if (bit_pos + code_bits <= total_bits) {
+            window = Load64(src + (bit_pos >> 3)) >> (bit_pos & 7);
+            codes = 1;
+        } else {
+            break;
+        }
+
+        for (; codes > 0; --codes) {
+            const uint32_t code = static_cast<uint32_t>(window) & code_mask;
+            window >>= code_bits;
+            bit_pos += code_bits;
+
+            if (code == clear) {
+                code_bits = min_code_size + 1;
+                code_mask = (1u << code_bits) - 1;
+                next = clear + 2;
+                prev_length = 0;
+                continue;
+            }
+            if (code == end) return pos;
+
+            if (prev_length == 0) {
+                if (code > clear) return pos;
+                out[pos] = static_cast<uint8_t>(code);
+                prev_pos = pos++;
+                prev_length = 1;
+                if (pos >= capacity) return pos;
+                continue;
+            }
+
+            size_t length;
+            size_t from;
+            if (code < clear) {
+                length = 1;
+                from = 0;
+            } else if (code < next) {
+                length = lengths[code];
+                from = offsets[code];
+            } else if (code == next && next < kMaxCodes) {
+                length = prev_length + 1;
+                from = prev_pos;
+            } else {
+                return pos;
+            }
+
+            if (next < kMaxCodes) {
+                offsets[next] = static_cast<uint32_t>(prev_pos);
+                lengths[next] = static_cast<uint16_t>(prev_length + 1);
+                if (++next > code_mask && code_bits < kMaxCodeBits) {
+                    ++code_bits;
+                    code_mask = (1u << code_bits) - 1;
+                }
+            }
+
+            length = std::min(length, capacity - pos);
+            if (code < clear) {
+                out[pos] = static_cast<uint8_t>(code);
+            } else {
+                CopyForward(out + pos, out + from, length);
+            }
+            prev_pos = pos;
+            prev_length = length;
+            pos += length;
+            if (pos >= capacity) return pos;
+        }
+    }
+    return pos;
+}
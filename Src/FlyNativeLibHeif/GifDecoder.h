@@ -0,0 +1,117 @@
+/**
+ * @file GifDecoder.h
+ * @brief Declares GifDecoder, a GIF87a/GIF89a container parser and LZW decoder.
+ *
+ * Open() walks the block structure once and records, per frame, its rectangle, timing,
+ * disposal, transparency, colour table and where its LZW data starts; no pixel data is
+ * decoded until a frame is asked for. DecodeIndices() then turns one frame's LZW stream
+ * into palette indices:
+ *
+ * - The data sub-blocks are gathered into one padded buffer so codes can be read with a
+ *   single unaligned 64-bit load, four codes per load while enough bits remain.
+ * - Every dictionary entry is a string already written to the output, so an entry is just
+ *   its offset and length there, and a code is emitted with one forward copy (eight bytes at
+ *   a time where the copy does not overlap itself) instead of a walk down its prefix chain.
+ *
+ * Indices come out in stream order; interlaced frames are mapped to canvas rows by
+ * InterlacedRow(). Compositing frames onto a canvas is GifCompositor's job.
+ *
+ * The file data is not copied and must outlive the decoder. Not thread-safe.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef GIF_DECODER_H
+#define GIF_DECODER_H
+
+#include "FrameRect.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief Disposal methods from the graphic control extension.
+enum class GifDisposal : int32_t {
+    None = 0,           ///< Unspecified; treated as Keep.
+    Keep = 1,           ///< Leave the frame in place.
+    Background = 2,     ///< Clear the frame's rectangle (to transparent, as browsers do).
+    Previous = 3,       ///< Restore the rectangle to what it was before the frame was drawn.
+};
+
+/// @brief One frame as described by its image descriptor and graphic control extension. Blittable for P/Invoke.
+struct GifFrameInfo {
+    int32_t x;                          ///< Frame rectangle on the canvas (may extend past it).
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    int32_t delay_ms;                   ///< Display time; 0 and 1 (hundredths) become 100 ms, as in browsers.
+    int32_t disposal;                   ///< A GifDisposal value; 4-7 are treated as Keep.
+    int32_t transparent_index;          ///< -1 if the frame has no transparent colour.
+    int32_t interlaced;                 ///< 1 if the rows are stored in the four-pass order.
+};
+
+/// @brief The animation as a whole. Blittable for P/Invoke.
+struct GifInfo {
+    int32_t width;                      ///< Logical screen size.
+    int32_t height;
+    int32_t frame_count;
+    int32_t loop_count;                 ///< From the NETSCAPE2.0 extension: 0 loops forever, -1 if absent.
+    int64_t duration_ms;                ///< Sum of the frame delays.
+};
+
+/// @brief Parses a GIF in memory and decodes its frames to palette indices.
+class GifDecoder {
+public:
+    /// Canvases and frames larger than this many pixels are rejected.
+    static constexpr int64_t kMaxPixels = 1ll << 28;
+
+    /// Bytes DecodeIndices() may write past a frame's last pixel; the output is sized for them.
+    static constexpr size_t kSlack = 16;
+
+    /// @brief Parses `data`. Frames after a truncation or an unknown block are dropped.
+    /// @return false if the data is not a GIF or has no decodable frame.
+    bool Open(const uint8_t* data, size_t size);
+
+    const GifInfo& Info() const { return info_; }
+    int32_t FrameCount() const { return info_.frame_count; }
+    const GifFrameInfo& Frame(int32_t index) const { return frames_[index].info; }
+
+    /// @brief Decodes the palette indices of frame `index`, in stream order.
+    /// @param out Resized to the frame's area plus kSlack.
+    /// @return The number of pixels decoded: the frame's area, or less if its data is truncated or corrupt.
+    size_t DecodeIndices(int32_t index, std::vector<uint8_t>& out);
+
+    /// @brief Expands the colour table of frame `index` to premultiplied BGRA (one uint32_t per
+    ///        entry, B in the low byte). Entries past the table are opaque black; the transparent
+    ///        entry is all zero.
+    void ColorTable(int32_t index, uint32_t table[256]) const;
+
+    /// @brief The canvas row of the `row`-th row stored in an interlaced frame `height` rows high.
+    static int32_t InterlacedRow(int32_t row, int32_t height);
+
+    /// @brief Decodes one LZW stream. `src` must be readable for 8 bytes past `src_size`, and
+    ///        `out` writable for kSlack bytes past `capacity`.
+    /// @return The number of indices written, at most `capacity`.
+    static size_t DecodeLzw(const uint8_t* src, size_t src_size, int min_code_size, uint8_t* out, size_t capacity);
+
+    /// @brief Bytes held between frames: the frame table and the joined sub-blocks.
+    size_t ScratchBytes() const { return frames_.capacity() * sizeof(FrameData) + stream_.capacity(); }
+
+private:
+    struct FrameData {
+        GifFrameInfo info;
+        size_t palette_offset;          // 0 if the frame uses no table.
+        int32_t palette_size;
+        int32_t min_code_size;
+        size_t data_offset;             // First data sub-block.
+    };
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    GifInfo info_{};
+    std::vector<FrameData> frames_;
+    std::vector<uint8_t> stream_;       // The current frame's sub-blocks, joined and padded.
+};
+
+#endif // GIF_DECODER_H
@@ -4,9 +4,66 @@
 #include <iostream>
 #include <memory>
 #include <cassert>
+#include <algorithm>
+#include <cstring>
 #include "PixelBufferEncoder.h"
+#include "DecodeReport.h"
 #include <libheif/heif_sequences.h>
 
+namespace {
+    using StageTimer = DecodeReportScope::StageTimer;
+
+    /// @brief Records a failed libheif call in the active DecodeReport. Returns true on failure.
+    bool Failed(const heif_error& err) {
+        if (err.code == heif_error_Ok) return false;
+        DecodeReportScope::Error(err.code, err.subcode);
+        return true;
+    }
+
+    heif_error ReadFile(heif_context* context, const std::string& filename) {
+        StageTimer timer(&DecodeReport::open_ns);
+        return heif_context_read_from_file(context, filename.c_str(), nullptr);
+    }
+
+    heif_error ReadMemory(heif_context* context, const uint8_t* data, size_t size) {
+        StageTimer timer(&DecodeReport::open_ns);
+        return heif_context_read_from_memory_without_copy(context, data, size, nullptr);
+    }
+
+    heif_error GetPrimaryHandle(heif_context* context, heif_image_handle** out_handle) {
+        StageTimer timer(&DecodeReport::open_ns);
+        return heif_context_get_primary_image_handle(context, out_handle);
+    }
+
+    heif_error GetThumbnailHandle(heif_image_handle* primary, heif_item_id id, heif_image_handle** out_handle) {
+        StageTimer timer(&DecodeReport::open_ns);
+        return heif_image_handle_get_thumbnail(primary, id, out_handle);
+    }
+
+    heif_error DecodeRgba(heif_image_handle* handle, heif_image** out_image) {
+        StageTimer timer(&DecodeReport::decode_ns);
+        return heif_decode_image(handle, out_image, heif_colorspace_RGB, heif_chroma_interleaved_RGBA, nullptr);
+    }
+
+    heif_error ScaleImage(const heif_image* image, heif_image** out_image, int width, int height) {
+        StageTimer timer(&DecodeReport::scale_ns);
+        DecodeReportScope::Flag(DecodeReport_Scaled);
+        return heif_image_scale_image(image, out_image, width, height, nullptr);
+    }
+
+    /// @brief Takes ownership of a decoded image and accounts its pixel memory until it is released.
+    std::shared_ptr<heif_image> TrackImage(heif_image* image) {
+        int stride = 0;
+        heif_image_get_plane_readonly(image, heif_channel_interleaved, &stride);
+        const uint64_t bytes = static_cast<uint64_t>(stride) * heif_image_get_height(image, heif_channel_interleaved);
+        DecodeReportScope::Acquire(bytes);
+        return std::shared_ptr<heif_image>(image, [bytes](heif_image* img) {
+            DecodeReportScope::Release(bytes);
+            heif_image_release(img);
+        });
+    }
+}
+
 
 HeifReader::HeifReader() {
     // The heif_initializer_ member handles initialization automatically.
@@ -25,15 +82,15 @@ HeifError HeifReader::ExtractThumbnail(const std::string& input_filename, PixelB
     std::shared_ptr<heif_context> context(heif_context_alloc(),
         [](heif_context* c) { heif_context_free(c); });
 
-    heif_error err = heif_context_read_from_file(context.get(), input_filename.c_str(), nullptr);
-    if (err.code != 0) {
+    heif_error err = ReadFile(context.get(), input_filename);
+    if (Failed(err)) {
         return HeifError::FileReadError;
     }
 
     // 2. Get the primary image handle, needed for dimensions and thumbnail lookup.
     heif_image_handle* primary_image_handle = nullptr;
-    err = heif_context_get_primary_image_handle(context.get(), &primary_image_handle);
-    if (err.code) {
+    err = GetPrimaryHandle(context.get(), &primary_image_handle);
+    if (Failed(err)) {
         return HeifError::NoPrimaryImage;
     }
     // Manage its lifetime since we'll need it throughout this function.
@@ -47,12 +104,13 @@ HeifError HeifReader::ExtractThumbnail(const std::string& input_filename, PixelB
     heif_item_id thumbnail_id;
     if (heif_image_handle_get_list_of_thumbnail_IDs(primary_image_handle, &thumbnail_id, 1) > 0) {
         heif_image_handle* thumbnail_handle = nullptr;
-        err = heif_image_handle_get_thumbnail(primary_image_handle, thumbnail_id, &thumbnail_handle);
-        if (err.code == 0) {
+        err = GetThumbnailHandle(primary_image_handle, thumbnail_id, &thumbnail_handle);
+        if (!Failed(err)) {
             // Success: an embedded thumbnail was found and retrieved.
             // Delegate to the helper, which will take ownership of thumbnail_handle.
             HeifError thumb_decode_result = ExtractImageToBuffer(thumbnail_handle, out_buffer);
             if (thumb_decode_result == HeifError::Ok) {
+                DecodeReportScope::Flag(DecodeReport_UsedThumbnail);
                 // SUCCESS: The embedded thumbnail was found, retrieved, AND decoded successfully.
                 // We are done, so we can return immediately.
                 return HeifError::Ok;
@@ -70,12 +128,12 @@ HeifError HeifReader::ExtractThumbnail(const std::string& input_filename, PixelB
 
     // 5. First, we must decode the full primary image.
     heif_image* primary_image = nullptr;
-    err = heif_decode_image(primary_image_handle, &primary_image, heif_colorspace_RGB, heif_chroma_interleaved_RGBA, nullptr);
-    if (err.code) {
+    err = DecodeRgba(primary_image_handle, &primary_image);
+    if (Failed(err)) {
         return HeifError::ImageDecodeError;
     }
     // Ensure the decoded primary image is released when we're done with it.
-    std::shared_ptr<heif_image> primary_image_guard(primary_image, heif_image_release);
+    std::shared_ptr<heif_image> primary_image_guard = TrackImage(primary_image);
 
     // 6. Check if the primary image needs to be scaled.
     const int primary_w = out_buffer.primaryImageWidth;
@@ -100,12 +158,12 @@ HeifError HeifReader::ExtractThumbnail(const std::string& input_filename, PixelB
         }
 
         heif_image* scaled_image = nullptr;
-        err = heif_image_scale_image(primary_image, &scaled_image, thumb_w, thumb_h, nullptr);
-        if (err.code) {
+        err = ScaleImage(primary_image, &scaled_image, thumb_w, thumb_h);
+        if (Failed(err)) {
             return HeifError::ImageDecodeError; // Scaling failed
         }
         // Ensure the newly created scaled image is released.
-        std::shared_ptr<heif_image> scaled_image_guard(scaled_image, heif_image_release);
+        std::shared_ptr<heif_image> scaled_image_guard = TrackImage(scaled_image);
 
         // Fill the output buffer using the scaled image data.
         FillPixelBufferFromImage(scaled_image, thumb_w, thumb_h, out_buffer);
@@ -121,15 +179,15 @@ HeifError HeifReader::ExtractPrimaryImage(const std::string& input_filename, Pix
     std::shared_ptr<heif_context> context(heif_context_alloc(),
         [](heif_context* c) { heif_context_free(c); });
 
-    heif_error err = heif_context_read_from_file(context.get(), input_filename.c_str(), nullptr);
-    if (err.code != 0) {
+    heif_error err = ReadFile(context.get(), input_filename);
+    if (Failed(err)) {
         return HeifError::FileReadError;
     }
 
     // 2. Get the primary image handle.
     heif_image_handle* primary_image_handle = nullptr;
-    err = heif_context_get_primary_image_handle(context.get(), &primary_image_handle);
-    if (err.code) {
+    err = GetPrimaryHandle(context.get(), &primary_image_handle);
+    if (Failed(err)) {
         return HeifError::NoPrimaryImage;
     }
 
@@ -150,8 +208,8 @@ HeifError HeifReader::ExtractPrimaryImageFromMemory(const uint8_t* data, size_t
     // 1. Create a memory-mapped context.
     std::shared_ptr<heif_context> context(heif_context_alloc(), [](heif_context* c) { heif_context_free(c); });
 
-    heif_error err = heif_context_read_from_memory_without_copy(context.get(), data, size, nullptr);
-    if (err.code != 0) {
+    heif_error err = ReadMemory(context.get(), data, size);
+    if (Failed(err)) {
         return HeifError::FileReadError;
     }
 
@@ -160,8 +218,8 @@ HeifError HeifReader::ExtractPrimaryImageFromMemory(const uint8_t* data, size_t
 
     // 3. Get the primary image handle.
     heif_image_handle* primary_image_handle = nullptr;
-    err = heif_context_get_primary_image_handle(context.get(), &primary_image_handle);
-    if (err.code) {
+    err = GetPrimaryHandle(context.get(), &primary_image_handle);
+    if (Failed(err)) {
         return HeifError::NoPrimaryImage;
     }
 
@@ -173,6 +231,125 @@ HeifError HeifReader::ExtractPrimaryImageFromMemory(const uint8_t* data, size_t
     return ExtractImageToBuffer(primary_image_handle, out_buffer);
 }
 
+/**
+ * @brief Decodes a file according to the caller's options.
+ */
+HeifError HeifReader::Decode(const std::string& input_filename, const FlyHeifDecodeOptions& options, PixelBuffer& out_buffer) {
+    std::shared_ptr<heif_context> context(heif_context_alloc(), [](heif_context* c) { heif_context_free(c); });
+
+    heif_error err = ReadFile(context.get(), input_filename);
+    if (Failed(err)) {
+        return HeifError::FileReadError;
+    }
+    return DecodeContext(context.get(), options, out_buffer);
+}
+
+/**
+ * @brief Decodes in-memory file data according to the caller's options, reporting sequence status.
+ */
+HeifError HeifReader::DecodeFromMemory(const uint8_t* data, size_t size, const FlyHeifDecodeOptions& options, PixelBuffer& out_buffer, bool& out_is_animated) {
+    std::shared_ptr<heif_context> context(heif_context_alloc(), [](heif_context* c) { heif_context_free(c); });
+
+    heif_error err = ReadMemory(context.get(), data, size);
+    if (Failed(err)) {
+        return HeifError::FileReadError;
+    }
+    out_is_animated = heif_context_has_sequence(context.get()) || heif_context_number_of_sequence_tracks(context.get()) > 0;
+    return DecodeContext(context.get(), options, out_buffer);
+}
+
+/**
+ * @brief Starts from the defaults and copies only the bytes the caller declared, so a caller
+ * built against an older, shorter struct never has its missing fields read.
+ */
+FlyHeifDecodeOptions HeifReader::ReadOptions(const FlyHeifDecodeOptions* options) {
+    FlyHeifDecodeOptions result{};
+    result.struct_size = sizeof(FlyHeifDecodeOptions);
+    if (options && options->struct_size >= sizeof(uint32_t)) {
+        const size_t size = std::min<size_t>(options->struct_size, sizeof(FlyHeifDecodeOptions));
+        memcpy(&result, options, size);
+        result.struct_size = sizeof(FlyHeifDecodeOptions);
+    }
+    if (result.max_width < 0) result.max_width = 0;
+    if (result.max_height < 0) result.max_height = 0;
+    if (result.thread_count < 0) result.thread_count = 0;
+    return result;
+}
+
+/**
+ * @brief Applies the thread count, then decodes either the embedded thumbnail (when preferred
+ * and present) or the primary image, scaled to fit the requested bounds.
+ */
+HeifError HeifReader::DecodeContext(heif_context* context, const FlyHeifDecodeOptions& options, PixelBuffer& out_buffer) {
+    if (options.thread_count > 0) {
+        heif_context_set_max_decoding_threads(context, options.thread_count);
+    }
+
+    heif_image_handle* primary_image_handle = nullptr;
+    heif_error err = GetPrimaryHandle(context, &primary_image_handle);
+    if (Failed(err)) {
+        return HeifError::NoPrimaryImage;
+    }
+    std::shared_ptr<heif_image_handle> primary_handle_guard(primary_image_handle, heif_image_handle_release);
+
+    out_buffer.primaryImageWidth = heif_image_handle_get_width(primary_image_handle);
+    out_buffer.primaryImageHeight = heif_image_handle_get_height(primary_image_handle);
+
+    if (options.flags & FlyHeifDecode_PreferThumbnail) {
+        heif_item_id thumbnail_id;
+        if (heif_image_handle_get_list_of_thumbnail_IDs(primary_image_handle, &thumbnail_id, 1) > 0) {
+            heif_image_handle* thumbnail_handle = nullptr;
+            err = GetThumbnailHandle(primary_image_handle, thumbnail_id, &thumbnail_handle);
+            if (!Failed(err)) {
+                std::shared_ptr<heif_image_handle> thumbnail_guard(thumbnail_handle, heif_image_handle_release);
+                if (DecodeHandleToFit(thumbnail_handle, options.max_width, options.max_height, out_buffer) == HeifError::Ok) {
+                    DecodeReportScope::Flag(DecodeReport_UsedThumbnail);
+                    return HeifError::Ok;
+                }
+                // A broken thumbnail falls through to the primary image.
+            }
+        }
+    }
+
+    return DecodeHandleToFit(primary_image_handle, options.max_width, options.max_height, out_buffer);
+}
+
+/**
+ * @brief Decodes a handle to RGBA and, if it exceeds the bounds, scales it down preserving the
+ * aspect ratio. The caller keeps ownership of the handle.
+ */
+HeifError HeifReader::DecodeHandleToFit(heif_image_handle* image_handle, int max_width, int max_height, PixelBuffer& out_buffer) {
+    heif_image* image = nullptr;
+    heif_error err = DecodeRgba(image_handle, &image);
+    if (Failed(err)) {
+        return HeifError::ImageDecodeError;
+    }
+    std::shared_ptr<heif_image> image_guard = TrackImage(image);
+
+    const int width = heif_image_handle_get_width(image_handle);
+    const int height = heif_image_handle_get_height(image_handle);
+
+    double scale = 1.0;
+    if (max_width > 0 && width > max_width) scale = std::min(scale, static_cast<double>(max_width) / width);
+    if (max_height > 0 && height > max_height) scale = std::min(scale, static_cast<double>(max_height) / height);
+    if (scale >= 1.0) {
+        FillPixelBufferFromImage(image, width, height, out_buffer);
+        return HeifError::Ok;
+    }
+
+    const int scaled_w = std::max(1, static_cast<int>(width * scale));
+    const int scaled_h = std::max(1, static_cast<int>(height * scale));
+    heif_image* scaled_image = nullptr;
+    err = ScaleImage(image, &scaled_image, scaled_w, scaled_h);
+    if (Failed(err)) {
+        return HeifError::ImageDecodeError;
+    }
+    std::shared_ptr<heif_image> scaled_image_guard = TrackImage(scaled_image);
+
+    FillPixelBufferFromImage(scaled_image, scaled_w, scaled_h, out_buffer);
+    return HeifError::Ok;
+}
+
 /**
  * @brief Private helper to decode any image handle into a packed RGBA buffer.
  * This function contains the common logic for decoding, buffer allocation, and pixel copy.
@@ -183,13 +360,13 @@ HeifError HeifReader::ExtractImageToBuffer(heif_image_handle* image_handle, Pixe
 
     // Decode the image handle into a raw heif_image object.
     heif_image* image = nullptr;
-    heif_error err = heif_decode_image(image_handle, &image, heif_colorspace_RGB, heif_chroma_interleaved_RGBA, nullptr);
+    heif_error err = DecodeRgba(image_handle, &image);
 
-    if (err.code) {
+    if (Failed(err)) {
         return HeifError::ImageDecodeError;
     }
     // Manage the decoded image's lifetime.
-    std::shared_ptr<heif_image> image_guard(image, heif_image_release);
+    std::shared_ptr<heif_image> image_guard = TrackImage(image);
 
     // Get dimensions and delegate to the new buffer-filling helper.
     const int width = heif_image_handle_get_width(image_handle);
@@ -215,6 +392,13 @@ void HeifReader::FillPixelBufferFromImage(const heif_image* image, int width, in
         out_buffer.data = nullptr; // Ensure data is null for zero-pixel images
         return;
     }
+    // The output outlives the decode, so it is only ever acquired in the report.
+    DecodeReportScope::Acquire(static_cast<uint64_t>(out_buffer.dataSize));
+    DecodeReportScope::Output(width, height);
+
+    // An RGBA source is a straight copy; an RGB source is expanded, which is a conversion.
+    const bool converts = heif_image_get_chroma_format(image) != heif_chroma_interleaved_RGBA;
+    DecodeReportScope::StageTimer timer(converts ? &DecodeReport::color_convert_ns : &DecodeReport::copy_ns);
     out_buffer.data = new uint8_t[out_buffer.dataSize];
 
     // Use the PixelBufferEncoder to fill the allocated buffer.
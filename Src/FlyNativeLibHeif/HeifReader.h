@@ -6,6 +6,7 @@
 #ifndef HEIF_READER_H
 #define HEIF_READER_H
 
+#include <cstdint>
 #include <string>
 #include <libheif/heif.h>
 #include <vector>
@@ -34,6 +35,24 @@ struct PixelBuffer {
     int primaryImageHeight;   ///< Height of the original primary image (useful for thumbnails).
 };
 
+/// @brief Flags for FlyHeifDecodeOptions::flags.
+enum FlyHeifDecodeFlags : uint32_t {
+    FlyHeifDecode_None = 0,
+    FlyHeifDecode_PreferThumbnail = 1u << 0,  ///< Decode the embedded thumbnail instead of the primary image when there is one.
+};
+
+/// @brief Options for the options-driven decode entry points. Blittable for P/Invoke.
+/// @note Size-prefixed: callers set `struct_size` to the size they were compiled against.
+///       Fields the caller does not know about keep their defaults, so the struct can grow
+///       at the end without breaking older callers.
+struct FlyHeifDecodeOptions {
+    uint32_t struct_size;   ///< sizeof(FlyHeifDecodeOptions) as seen by the caller.
+    uint32_t flags;         ///< A combination of FlyHeifDecodeFlags.
+    int32_t max_width;      ///< The output is scaled down to fit max_width x max_height. 0 = no limit.
+    int32_t max_height;     ///< See max_width. 0 = no limit.
+    int32_t thread_count;   ///< Decoder threads for this image. 0 = libheif default.
+};
+
 /// @brief A class to read and decode HEIC/HEIF image files.
 class HeifReader {
 public:
@@ -49,7 +68,22 @@ public:
     /// @brief Extracts the primary image into a raw RGBA pixel buffer directly from memory, and outputs whether it contains sequence tracks.
     HeifError ExtractPrimaryImageFromMemory(const uint8_t* data, size_t size, PixelBuffer& out_buffer, bool& out_is_animated);
 
+    /// @brief Decodes a file according to `options` (thumbnail preference, size limit, thread count).
+    HeifError Decode(const std::string& input_filename, const FlyHeifDecodeOptions& options, PixelBuffer& out_buffer);
+
+    /// @brief Decodes in-memory file data according to `options`, and outputs whether it contains sequence tracks.
+    HeifError DecodeFromMemory(const uint8_t* data, size_t size, const FlyHeifDecodeOptions& options, PixelBuffer& out_buffer, bool& out_is_animated);
+
+    /// @brief Copies a caller's size-prefixed options over the defaults. A null pointer yields the defaults.
+    static FlyHeifDecodeOptions ReadOptions(const FlyHeifDecodeOptions* options);
+
 private:
+    ///@brief Shared body of Decode and DecodeFromMemory once the context has been read.
+    HeifError DecodeContext(heif_context* context, const FlyHeifDecodeOptions& options, PixelBuffer& out_buffer);
+
+    ///@brief Decodes an image handle, scales it to fit the given bounds (0 = no limit) and fills the buffer. Does not take ownership of the handle.
+    HeifError DecodeHandleToFit(heif_image_handle* image_handle, int max_width, int max_height, PixelBuffer& out_buffer);
+
     ///@brief Internal helper to decode any image handle into a packed RGBA buffer.
     HeifError ExtractImageToBuffer(heif_image_handle* image_handle, PixelBuffer& out_buffer);
 
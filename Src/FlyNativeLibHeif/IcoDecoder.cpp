@@ -0,0 +1,292 @@
+/**
+ * @file IcoDecoder.cpp
+ * @brief Implements IcoDecoder.
+ */
+
+#include "IcoDecoder.h"
+#include "ApngDecoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    constexpr size_t kDirectoryEntry = 16;
+    constexpr size_t kInfoHeader = 40;                  // BITMAPINFOHEADER
+    constexpr uint32_t kBiRgb = 0;
+    constexpr uint32_t kBiBitfields = 3;
+
+    const uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+
+    uint16_t LE16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+    uint32_t LE32(const uint8_t* p) {
+        return p[0] | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    uint32_t BE32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    /// round(c * a / 255) without a division.
+    inline uint32_t Premultiply(uint32_t c, uint32_t a) {
+        const uint32_t v = c * a + 128;
+        return (v + (v >> 8)) >> 8;
+    }
+
+    inline uint32_t PackPremultiplied(uint32_t b, uint32_t g, uint32_t r, uint32_t a) {
+        if (a == 255) return 0xFF000000u | (r << 16) | (g << 8) | b;
+        return (a << 24) | (Premultiply(r, a) << 16) | (Premultiply(g, a) << 8) | Premultiply(b, a);
+    }
+
+    /// Bytes per row of a DIB or its mask: rows are padded to 32 bits.
+    size_t DibStride(int32_t width, int32_t bits) { return (static_cast<size_t>(width) * bits + 31) / 32 * 4; }
+
+    /// One channel of a bit-field pixel: its shift, its maximum and a 32.32 scale to 8 bits.
+    struct Field {
+        uint32_t shift = 0;
+        uint32_t max = 0;
+        uint64_t scale = 0;
+
+        explicit Field(uint32_t mask) {
+            if (!mask) return;
+            while (!(mask & 1)) {
+                mask >>= 1;
+                ++shift;
+            }
+            // Wider channels lose their low bits, so the product below cannot overflow.
+            while (mask > 0xFFFF) {
+                mask >>= 1;
+                ++shift;
+            }
+            max = mask;
+            scale = ((255ull << 32) + max / 2) / max;
+        }
+
+        uint32_t operator()(uint32_t v) const { return static_cast<uint32_t>((((v >> shift) & max) * scale + (1ull << 31)) >> 32); }
+    };
+
+} // namespace
+
+/** @brief Reads the directory, then the DIB or PNG header of each entry. */
+bool IcoDecoder::Open(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    type_ = 0;
+    entries_.clear();
+    sources_.clear();
+    if (!data || size < 6 || LE16(data) != 0) return false;
+    const uint16_t type = LE16(data + 2);
+    const uint16_t count = LE16(data + 4);
+    if ((type != 1 && type != 2) || count == 0 || 6 + count * kDirectoryEntry > size) return false;
+    type_ = type;
+
+    entries_.reserve(count);
+    sources_.reserve(count);
+    for (uint16_t i = 0; i < count; ++i) {
+        const uint8_t* e = data + 6 + i * kDirectoryEntry;
+        IcoEntry entry{};
+        entry.index = i;
+        entry.width = e[0] ? e[0] : 256;
+        entry.height = e[1] ? e[1] : 256;
+        // In a cursor the planes and bit count fields hold the hotspot.
+        if (type == 2) {
+            entry.hotspot_x = LE16(e + 4);
+            entry.hotspot_y = LE16(e + 6);
+        } else {
+            entry.bit_count = LE16(e + 6);
+        }
+
+        Source source{};
+        const uint32_t bytes = LE32(e + 8);
+        const uint32_t offset = LE32(e + 12);
+        if (offset < size) {
+            source.offset = offset;
+            source.size = std::min<size_t>(bytes, size - offset);
+            const uint8_t* p = data + offset;
+            if (source.size >= 24 && std::memcmp(p, kPngSignature, 8) == 0 && std::memcmp(p + 12, "IHDR", 4) == 0) {
+                static const int32_t kChannels[7] = {1, 0, 3, 1, 2, 0, 4};
+                const uint32_t width = BE32(p + 16);
+                const uint32_t height = BE32(p + 20);
+                entry.is_png = 1;
+                entry.width = static_cast<int32_t>(std::min<uint32_t>(width, INT32_MAX));
+                entry.height = static_cast<int32_t>(std::min<uint32_t>(height, INT32_MAX));
+                entry.bit_count = source.size > 25 && p[25] < 7 ? p[24] * kChannels[p[25]] : 0;
+                entry.can_decode = width && height && static_cast<int64_t>(width) * height <= kMaxPixels ? 1 : 0;
+            } else {
+                ReadDib(p, source.size, entry, source);
+            }
+        }
+        entries_.push_back(entry);
+        sources_.push_back(source);
+    }
+    return true;
+}
+
+/**
+ * @brief Takes the size and format from a BITMAPINFOHEADER or a later version of it. The height
+ *        counts the colour rows and the mask rows, so it is twice the image's.
+ */
+void IcoDecoder::ReadDib(const uint8_t* p, size_t size, IcoEntry& entry, Source& source) const {
+    if (size < kInfoHeader) return;
+    const uint32_t header = LE32(p);
+    const int32_t width = static_cast<int32_t>(LE32(p + 4));
+    const int32_t stored_height = static_cast<int32_t>(LE32(p + 8));
+    const uint16_t bits = LE16(p + 14);
+    const uint32_t compression = LE32(p + 16);
+    const uint32_t colors_used = LE32(p + 32);
+    if (header < kInfoHeader || header > size || width <= 0 || stored_height == 0 || stored_height == INT32_MIN) return;
+
+    const int32_t height = (stored_height < 0 ? -stored_height : stored_height) / 2;
+    if (height <= 0) return;
+    entry.width = width;
+    entry.height = height;
+    entry.bit_count = bits;
+    source.flipped = stored_height > 0 ? 1 : 0;
+    source.compression = static_cast<int32_t>(compression);
+    // BITMAPINFOHEADER keeps its bit masks after it; the later headers hold them inside.
+    source.header_size = header + (compression == kBiBitfields && header == kInfoHeader ? 12 : 0);
+    source.colors = bits <= 8 ? (colors_used && colors_used < (1u << bits) ? static_cast<int32_t>(colors_used) : 1 << bits) : 0;
+
+    const bool format = (compression == kBiRgb && (bits == 1 || bits == 4 || bits == 8 || bits == 16 || bits == 24 || bits == 32)) ||
+                        (compression == kBiBitfields && (bits == 16 || bits == 32));
+    if (!format || static_cast<int64_t>(width) * height > kMaxPixels) return;
+    const uint64_t needed = source.header_size + static_cast<uint64_t>(source.colors) * 4 + DibStride(width, bits) * height;
+    entry.can_decode = needed <= size ? 1 : 0;
+}
+
+/** @brief Picks the entry by its real size; entries that cannot be decoded are never picked. */
+int32_t IcoDecoder::SelectEntry(int32_t size) const {
+    int32_t best = -1;
+    bool best_covers = false;
+    for (const IcoEntry& e : entries_) {
+        if (!e.can_decode) continue;
+        const bool covers = size > 0 && std::max(e.width, e.height) >= size;
+        if (best < 0) {
+            best = e.index;
+            best_covers = covers;
+            continue;
+        }
+        const IcoEntry& b = entries_[best];
+        const int64_t area = static_cast<int64_t>(e.width) * e.height;
+        const int64_t best_area = static_cast<int64_t>(b.width) * b.height;
+        bool better;
+        if (covers != best_covers) better = covers;
+        else if (area != best_area) better = covers ? area < best_area : area > best_area;
+        else better = e.bit_count > b.bit_count;
+        if (better) {
+            best = e.index;
+            best_covers = covers;
+        }
+    }
+    return best;
+}
+
+/** @brief Stable, so the same size at several bit depths keeps the file's order. */
+std::vector<int32_t> IcoDecoder::LargestFirst() const {
+    std::vector<int32_t> order(entries_.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int32_t>(i);
+    std::stable_sort(order.begin(), order.end(), [this](int32_t a, int32_t b) {
+        return static_cast<int64_t>(entries_[a].width) * entries_[a].height > static_cast<int64_t>(entries_[b].width) * entries_[b].height;
+    });
+    return order;
+}
+
+/** @brief Hands PNG entries to ApngDecoder, which keeps its own inflate state per call. */
+bool IcoDecoder::Decode(int32_t index, uint32_t* out) const {
+    if (index < 0 || index >= EntryCount() || !out) return false;
+    const IcoEntry& entry = entries_[index];
+    const Source& source = sources_[index];
+    if (!entry.can_decode) return false;
+    if (!entry.is_png) return DecodeDib(entry, source, out);
+
+    ApngDecoder png;
+    if (!png.Open(data_ + source.offset, source.size)) return false;
+    const ApngFrameInfo& frame = png.Frame(0);
+    if (frame.width != entry.width || frame.height != entry.height) return false;
+    return png.DecodeFrame(0, out);
+}
+
+/**
+ * @brief Unpacks the colour rows and applies the AND mask, whose set bits are transparent. A
+ *        32-bit entry with any non-zero alpha uses its alpha instead; a missing mask is opaque.
+ */
+bool IcoDecoder::DecodeDib(const IcoEntry& entry, const Source& source, uint32_t* out) const {
+    const int32_t width = entry.width;
+    const int32_t height = entry.height;
+    const int32_t bits = entry.bit_count;
+    const uint8_t* p = data_ + source.offset;
+    const uint8_t* palette = p + source.header_size;
+    const uint8_t* pixels = palette + static_cast<size_t>(source.colors) * 4;
+    const size_t stride = DibStride(width, bits);
+    const size_t mask_stride = DibStride(width, 1);
+    const uint8_t* mask = pixels + stride * height;
+    const bool has_mask = static_cast<size_t>(mask - p) + mask_stride * height <= source.size;
+
+    // Colours past the palette are black.
+    uint32_t colors[256];
+    std::fill(colors, colors + 256, 0xFF000000u);
+    for (int32_t i = 0; i < source.colors; ++i)
+        colors[i] = 0xFF000000u | (static_cast<uint32_t>(palette[i * 4 + 2]) << 16) | (static_cast<uint32_t>(palette[i * 4 + 1]) << 8) |
+                    palette[i * 4];
+
+    const bool bitfields = source.compression == static_cast<int32_t>(kBiBitfields);
+    const Field red(bitfields ? LE32(p + kInfoHeader) : bits == 16 ? 0x7C00 : 0xFF0000);
+    const Field green(bitfields ? LE32(p + kInfoHeader + 4) : bits == 16 ? 0x03E0 : 0xFF00);
+    const Field blue(bitfields ? LE32(p + kInfoHeader + 8) : bits == 16 ? 0x001F : 0xFF);
+    // Only a BITMAPV4HEADER or later says where the alpha of a bit-field pixel is.
+    const Field alpha(bits == 32 ? (bitfields ? (source.header_size >= kInfoHeader + 16 ? LE32(p + kInfoHeader + 12) : 0) : 0xFF000000u) : 0);
+
+    const bool bgra = bits == 32 && !bitfields;
+    bool use_alpha = false;
+    if (alpha.max) {
+        for (int32_t y = 0; y < height && !use_alpha; ++y) {
+            const uint8_t* row = pixels + stride * y;
+            for (int32_t x = 0; x < width; ++x) {
+                if (bgra ? row[x * 4 + 3] : alpha(LE32(row + x * 4))) {
+                    use_alpha = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int32_t y = 0; y < height; ++y) {
+        const int32_t stored = source.flipped ? height - 1 - y : y;
+        const uint8_t* row = pixels + stride * stored;
+        uint32_t* dst = out + static_cast<size_t>(y) * width;
+        switch (bits) {
+        case 1:
+            for (int32_t x = 0; x < width; ++x) dst[x] = colors[(row[x >> 3] >> (7 - (x & 7))) & 1];
+            break;
+        case 4:
+            for (int32_t x = 0; x < width; ++x) dst[x] = colors[(row[x >> 1] >> ((x & 1) ? 0 : 4)) & 15];
+            break;
+        case 8:
+            for (int32_t x = 0; x < width; ++x) dst[x] = colors[row[x]];
+            break;
+        case 24:
+            for (int32_t x = 0; x < width; ++x, row += 3)
+                dst[x] = 0xFF000000u | (static_cast<uint32_t>(row[2]) << 16) | (static_cast<uint32_t>(row[1]) << 8) | row[0];
+            break;
+        default:
+            if (bgra && use_alpha) {
+                for (int32_t x = 0; x < width; ++x, row += 4) dst[x] = PackPremultiplied(row[0], row[1], row[2], row[3]);
+            } else if (bgra) {
+                for (int32_t x = 0; x < width; ++x) dst[x] = 0xFF000000u | LE32(row + x * 4);
+            } else {
+                for (int32_t x = 0; x < width; ++x) {
+                    const uint32_t v = bits == 16 ? LE16(row + x * 2) : LE32(row + x * 4);
+                    dst[x] = use_alpha ? PackPremultiplied(blue(v), green(v), red(v), alpha(v))
+                                       : 0xFF000000u | (red(v) << 16) | (green(v) << 8) | blue(v);
+                }
+            }
+            break;
+        }
+        if (use_alpha || !has_mask) continue;
+        const uint8_t* mask_row = mask + mask_stride * stored;
+        for (int32_t x = 0; x < width; ++x)
+            if ((mask_row[x >> 3] >> (7 - (x & 7))) & 1) dst[x] = 0;
+    }
+    return true;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file IcoDecoder.h
+ * @brief Declares IcoDecoder, a Windows icon and cursor (ICO/CUR) parser and entry decoder.
+ *
+ * An ICO is a directory of images of the same picture at several sizes and bit depths, each
+ * either a BMP DIB without its file header or a complete PNG. Open() reads the directory and
+ * the first bytes of every image: the directory's one-byte sizes cannot say more than 256 and
+ * are sometimes wrong, so the size that counts is the one in the DIB or PNG header. Nothing is
+ * decoded until an entry is asked for, so choosing the 32x32 entry of an icon with a 1024x1024
+ * PNG costs a few header reads.
+ *
+ * Decode() turns one entry into premultiplied BGRA. DIB entries of 1, 4, 8, 16, 24 and 32 bits
+ * are unpacked here, bottom-up rows and the AND mask included; 32-bit entries whose alpha is all
+ * zero take their transparency from the mask, as Windows does. PNG entries are decoded by
+ * ApngDecoder.
+ *
+ * The file data is not copied and must outlive the decoder. Decode() may be called from several
+ * threads at once; Open() may not.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef ICO_DECODER_H
+#define ICO_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief One directory entry. Blittable for P/Invoke.
+struct IcoEntry {
+    int32_t index;                      ///< Position in the directory.
+    int32_t width;                      ///< From the DIB or PNG header.
+    int32_t height;
+    int32_t bit_count;                  ///< Bits per pixel; for PNG, bit depth times channels.
+    int32_t is_png;
+    int32_t hotspot_x;                  ///< Cursors only; 0 for icons.
+    int32_t hotspot_y;
+    int32_t can_decode;                 ///< 1 if Decode() handles the entry.
+};
+
+/// @brief What Open() and SelectEntry() found. Blittable for P/Invoke.
+struct IcoInfo {
+    int32_t type;                       ///< 1 for an icon, 2 for a cursor.
+    int32_t entry_count;
+    int32_t selected;                   ///< Directory index of the entry SelectEntry() picked.
+    int32_t width;                      ///< Of the selected entry.
+    int32_t height;
+    int32_t reserved;
+};
+
+/// @brief Parses an ICO or CUR in memory and decodes its entries.
+class IcoDecoder {
+public:
+    /// Entries larger than this many pixels are not decoded.
+    static constexpr int64_t kMaxPixels = 1ll << 28;
+
+    /// @brief Reads the directory and the header of every entry.
+    /// @return false if the data is not an ICO or CUR, or it has no entries.
+    bool Open(const uint8_t* data, size_t size);
+
+    int32_t Type() const { return type_; }
+    int32_t EntryCount() const { return static_cast<int32_t>(entries_.size()); }
+    const IcoEntry& Entry(int32_t index) const { return entries_[index]; }
+
+    /// @brief The directory index of the entry to show at `size` pixels: the smallest decodable
+    ///        entry whose longer side is at least `size`, or the largest if none is. Equal sizes
+    ///        go to the higher bit count, then to the earlier entry.
+    /// @details 0 or less asks for the largest. -1 if no entry can be decoded.
+    int32_t SelectEntry(int32_t size) const;
+
+    /// @brief Directory indices by decreasing area, equal areas in file order.
+    std::vector<int32_t> LargestFirst() const;
+
+    /// @brief Decodes entry `index` into `out`, `width * height` premultiplied BGRA pixels
+    ///        (B in the low byte), packed.
+    /// @return false if the entry is not decodable or its data is truncated or corrupt.
+    bool Decode(int32_t index, uint32_t* out) const;
+
+private:
+    struct Source {
+        size_t offset;
+        size_t size;                    // Clamped to the end of the file.
+        int32_t compression;            // DIB biCompression.
+        int32_t flipped;                // DIB rows are stored bottom-up.
+        int32_t colors;                 // DIB palette entries.
+        size_t header_size;             // DIB header, bit masks included.
+    };
+
+    void ReadDib(const uint8_t* p, size_t size, IcoEntry& entry, Source& source) const;
+    bool DecodeDib(const IcoEntry& entry, const Source& source, uint32_t* out) const;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    int32_t type_ = 0;
+    std::vector<IcoEntry> entries_;
+    std::vector<Source> sources_;
+};
+
+#endif // ICO_DECODER_H
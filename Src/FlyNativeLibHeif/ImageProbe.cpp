@@ -0,0 +1,667 @@
+/**
+ * @file ImageProbe.cpp
+ * @brief Implements ImageProbe.
+ */
+
+#include "ImageProbe.h"
+#include "FileSource.h"
+#include "ExifParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    uint16_t BE16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+    uint16_t LE16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+    uint32_t BE32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+    uint32_t LE32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+    uint32_t LE24(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16);
+    }
+    uint64_t BE64(const uint8_t* p) {
+        return (static_cast<uint64_t>(BE32(p)) << 32) | BE32(p + 4);
+    }
+    bool FourCC(const uint8_t* p, const char* tag) { return memcmp(p, tag, 4) == 0; }
+
+    /// Bytes read up-front for magic detection and the fixed-offset formats.
+    constexpr size_t kHeadSize = 64;
+
+    /// Upper bound on a HEIF 'meta' box we are willing to buffer. Real files are a few KB.
+    constexpr uint64_t kMaxMetaBoxSize = 4u << 20;
+
+    /// Upper bound on an EXIF payload we are willing to buffer (a JPEG APP1 segment is <= 64 KB).
+    constexpr uint32_t kMaxExifSize = 1u << 20;
+
+    bool SetSize(ImageProbeInfo& out, ImageFormat format, int64_t width, int64_t height) {
+        if (width <= 0 || height <= 0 || width > INT32_MAX || height > INT32_MAX) return false;
+        out.format = static_cast<int32_t>(format);
+        out.width = static_cast<int32_t>(width);
+        out.height = static_cast<int32_t>(height);
+        return true;
+    }
+
+    // ------------------------------------------------------------------------
+    // Orientation algebra.
+    // An orientation is (k, flip): an optional horizontal flip followed by k
+    // clockwise quarter turns. This lets HEIF's ordered irot/imir properties be
+    // folded into a single EXIF orientation value.
+    // ------------------------------------------------------------------------
+
+    struct Orientation { int k; bool flip; };
+
+    constexpr Orientation kExifToOrientation[9] = {
+        {0, false},                                  // 0: unused
+        {0, false}, {0, true}, {2, false}, {2, true}, // 1..4
+        {3, true}, {1, false}, {1, true}, {3, false}  // 5..8
+    };
+
+    int OrientationToExif(Orientation o) {
+        for (int i = 1; i <= 8; ++i) {
+            if (kExifToOrientation[i].k == o.k && kExifToOrientation[i].flip == o.flip) return i;
+        }
+        return 1;
+    }
+
+    /// Returns the orientation equivalent to applying `first` and then `second`.
+    Orientation Compose(Orientation first, Orientation second) {
+        // R^kb F^fb R^ka F^fa == R^(kb +/- ka) F^(fa ^ fb), since F R^k == R^-k F.
+        const int k = (second.k + (second.flip ? 4 - first.k : first.k)) & 3;
+        return { k, first.flip != second.flip };
+    }
+
+    // ------------------------------------------------------------------------
+    // ISOBMFF (HEIF / AVIF) helpers
+    // ------------------------------------------------------------------------
+
+    struct Box {
+        uint64_t offset;       ///< Offset of the box header.
+        uint64_t payload;      ///< Offset of the first payload byte.
+        uint64_t end;          ///< One past the last byte of the box.
+        char type[4];
+    };
+
+    /// Reads a box header at `offset` from a memory buffer. `limit` bounds the parent.
+    bool ReadBox(const uint8_t* data, uint64_t offset, uint64_t limit, Box& box) {
+        if (offset > limit || limit - offset < 8) return false;
+        uint64_t size = BE32(data + offset);
+        uint64_t header = 8;
+        if (size == 1) {
+            if (limit - offset < 16) return false;
+            size = BE64(data + offset + 8);
+            header = 16;
+        }
+        else if (size == 0) {
+            size = limit - offset;
+        }
+        // Compared by subtraction: a 64-bit largesize would wrap `offset + size`.
+        if (size < header || size > limit - offset) return false;
+        box.offset = offset;
+        box.payload = offset + header;
+        box.end = offset + size;
+        memcpy(box.type, data + offset + 4, 4);
+        return true;
+    }
+
+    /// Property indices associated with the primary item, in ipma order (1-based).
+    struct PrimaryProperties {
+        uint32_t primary_id = 0;
+        std::vector<uint16_t> indices;
+    };
+
+    bool ParsePitm(const uint8_t* d, const Box& box, uint32_t& id) {
+        if (box.payload + 4 > box.end) return false;
+        const uint8_t version = d[box.payload];
+        const uint64_t p = box.payload + 4;
+        if (version == 0) {
+            if (p + 2 > box.end) return false;
+            id = BE16(d + p);
+        }
+        else {
+            if (p + 4 > box.end) return false;
+            id = BE32(d + p);
+        }
+        return true;
+    }
+
+    /// Reads a big-endian unsigned field of 0, 4 or 8 bytes (the iloc size fields).
+    bool ReadSized(const uint8_t* d, uint64_t& p, uint64_t end, int size, uint64_t& v) {
+        if (size == 0) { v = 0; return true; }
+        if (p + size > end) return false;
+        v = size == 4 ? BE32(d + p) : size == 8 ? BE64(d + p) : 0;
+        p += size;
+        return size == 4 || size == 8;
+    }
+
+    /// Finds the item id of the 'Exif' item listed in iinf, or 0.
+    uint32_t FindExifItem(const uint8_t* d, const Box& box) {
+        if (box.payload + 4 > box.end) return 0;
+        const uint8_t version = d[box.payload];
+        uint64_t p = box.payload + 4 + (version == 0 ? 2 : 4);
+
+        while (p < box.end) {
+            Box infe;
+            if (!ReadBox(d, p, box.end, infe)) break;
+            p = infe.end;
+            if (!FourCC(reinterpret_cast<const uint8_t*>(infe.type), "infe") || infe.payload + 4 > infe.end) continue;
+            const uint8_t infe_version = d[infe.payload];
+            uint64_t q = infe.payload + 4;
+            if (infe_version < 2) continue;
+            uint32_t id = 0;
+            if (infe_version == 2) {
+                if (q + 2 > infe.end) continue;
+                id = BE16(d + q);
+                q += 2;
+            }
+            else {
+                if (q + 4 > infe.end) continue;
+                id = BE32(d + q);
+                q += 4;
+            }
+            q += 2; // item_protection_index
+            if (q + 4 <= infe.end && FourCC(d + q, "Exif")) return id;
+        }
+        return 0;
+    }
+
+    /// Resolves the first file extent of `item_id` from iloc. Only construction method 0
+    /// (plain file offsets) is supported, which is what cameras write for Exif items.
+    bool FindItemExtent(const uint8_t* d, const Box& box, uint32_t item_id, uint64_t& offset, uint64_t& length) {
+        if (box.payload + 8 > box.end) return false;
+        const uint8_t version = d[box.payload];
+        uint64_t p = box.payload + 4;
+        const int offset_size = d[p] >> 4;
+        const int length_size = d[p] & 0x0F;
+        const int base_offset_size = d[p + 1] >> 4;
+        const int index_size = (version == 1 || version == 2) ? (d[p + 1] & 0x0F) : 0;
+        p += 2;
+
+        uint32_t items = 0;
+        if (version < 2) {
+            items = BE16(d + p);
+            p += 2;
+        }
+        else {
+            if (p + 4 > box.end) return false;
+            items = BE32(d + p);
+            p += 4;
+        }
+
+        while (items-- > 0) {
+            uint32_t id = 0;
+            if (version < 2) {
+                if (p + 2 > box.end) return false;
+                id = BE16(d + p);
+                p += 2;
+            }
+            else {
+                if (p + 4 > box.end) return false;
+                id = BE32(d + p);
+                p += 4;
+            }
+            uint16_t construction_method = 0;
+            if (version == 1 || version == 2) {
+                if (p + 2 > box.end) return false;
+                construction_method = BE16(d + p) & 0x0F;
+                p += 2;
+            }
+            p += 2; // data_reference_index
+            uint64_t base = 0;
+            if (!ReadSized(d, p, box.end, base_offset_size, base)) return false;
+            if (p + 2 > box.end) return false;
+            uint16_t extents = BE16(d + p);
+            p += 2;
+
+            for (uint16_t e = 0; e < extents; ++e) {
+                uint64_t index = 0, extent_offset = 0, extent_length = 0;
+                if (!ReadSized(d, p, box.end, index_size, index) ||
+                    !ReadSized(d, p, box.end, offset_size, extent_offset) ||
+                    !ReadSized(d, p, box.end, length_size, extent_length)) {
+                    return false;
+                }
+                if (id == item_id && e == 0) {
+                    if (construction_method != 0) return false;
+                    offset = base + extent_offset;
+                    length = extent_length;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void ParseIpma(const uint8_t* d, const Box& box, PrimaryProperties& props) {
+        if (box.payload + 8 > box.end) return;
+        const uint8_t version = d[box.payload];
+        const bool wide_index = (d[box.payload + 3] & 1) != 0;
+        uint32_t entries = BE32(d + box.payload + 4);
+        uint64_t p = box.payload + 8;
+
+        while (entries-- > 0) {
+            uint32_t item_id = 0;
+            if (version < 1) {
+                if (p + 2 > box.end) return;
+                item_id = BE16(d + p);
+                p += 2;
+            }
+            else {
+                if (p + 4 > box.end) return;
+                item_id = BE32(d + p);
+                p += 4;
+            }
+            if (p + 1 > box.end) return;
+            const uint8_t count = d[p++];
+            for (uint8_t i = 0; i < count; ++i) {
+                uint16_t index = 0;
+                if (wide_index) {
+                    if (p + 2 > box.end) return;
+                    index = BE16(d + p) & 0x7FFF;
+                    p += 2;
+                }
+                else {
+                    if (p + 1 > box.end) return;
+                    index = d[p] & 0x7F;
+                    p += 1;
+                }
+                if (item_id == props.primary_id && index != 0) props.indices.push_back(index);
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Public entry points
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Sniffs the format from the first bytes and dispatches to the matching parser.
+ */
+bool ImageProbe::Probe(ByteSource& source, ImageProbeInfo& out, ExifInfo* exif) {
+    memset(&out, 0, sizeof(out));
+    out.orientation = 1;
+    ExifInfo local_exif;
+
+    WindowedReader reader(source);
+    uint8_t head[kHeadSize] = {};
+    const size_t size = static_cast<size_t>(std::min<uint64_t>(kHeadSize, source.Size()));
+    if (size < 12 || !reader.Read(0, head, size)) return false;
+
+    if (head[0] == 0xFF && head[1] == 0xD8 && head[2] == 0xFF) return ProbeJpeg(reader, out, exif ? *exif : local_exif);
+    if (head[0] == 0x89 && head[1] == 'P' && head[2] == 'N' && head[3] == 'G') return ProbePng(head, size, out);
+    if (memcmp(head, "GIF87a", 6) == 0 || memcmp(head, "GIF89a", 6) == 0) return ProbeGif(head, size, out);
+    if (FourCC(head, "RIFF") && FourCC(head + 8, "WEBP")) return ProbeWebP(reader, head, size, out, exif ? *exif : local_exif);
+    if (FourCC(head + 4, "ftyp")) return ProbeIsoBmff(reader, head, size, out, exif);
+    if (FourCC(head, "8BPS")) return ProbePsd(head, size, out);
+    if (FourCC(head, "DDS ")) return ProbeDds(head, size, out);
+    if (head[0] == 'B' && head[1] == 'M') return ProbeBmp(head, size, out);
+    if (head[0] == 0 && head[1] == 0 && (head[2] == 1 || head[2] == 2) && head[3] == 0) return ProbeIco(reader, head, out);
+    return false;
+}
+
+bool ImageProbe::ProbeFile(const std::filesystem::path& path, ImageProbeInfo& out, ExifInfo* exif) {
+    FileByteSource file;
+    if (!file.Open(path)) {
+        memset(&out, 0, sizeof(out));
+        return false;
+    }
+    return Probe(file, out, exif);
+}
+
+/**
+ * @brief Spreads the files over a few worker threads pulling from a shared cursor.
+ * @details Probing is dominated by file-open latency rather than CPU, so running several
+ *          opens concurrently is what makes a whole folder cheap.
+ */
+int ImageProbe::ProbeBatch(const std::filesystem::path::value_type* const* paths, size_t count,
+                           ImageProbeInfo* out, unsigned max_threads) {
+    if (!paths || !out || count == 0) return 0;
+
+    unsigned threads = max_threads ? max_threads : std::max(1u, std::thread::hardware_concurrency());
+    // Each worker should get a meaningful share; tiny batches run inline.
+    threads = static_cast<unsigned>(std::min<size_t>(threads, (count + 15) / 16));
+
+    std::atomic<size_t> next{ 0 };
+    std::atomic<int> succeeded{ 0 };
+    auto work = [&]() {
+        int local = 0;
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            if (paths[i] && ProbeFile(paths[i], out[i])) ++local;
+            else memset(&out[i], 0, sizeof(ImageProbeInfo));
+        }
+        succeeded += local;
+    };
+
+    if (threads <= 1) {
+        work();
+        return succeeded.load();
+    }
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    return succeeded.load();
+}
+
+// ----------------------------------------------------------------------------
+// Format parsers
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Walks JPEG marker segments up to the first SOFn, parsing an APP1 "Exif"
+ *        segment on the way for the orientation tag.
+ */
+bool ImageProbe::ProbeJpeg(WindowedReader& reader, ImageProbeInfo& out, ExifInfo& exif) {
+    uint64_t pos = 2;
+    const uint64_t file_size = reader.Size();
+
+    while (pos + 4 <= file_size) {
+        uint8_t marker[4];
+        if (!reader.Read(pos, marker, 2)) return false;
+        if (marker[0] != 0xFF) return false;
+
+        const uint8_t code = marker[1];
+        if (code == 0xFF) { ++pos; continue; }                        // Fill byte.
+        if (code == 0x01 || (code >= 0xD0 && code <= 0xD8)) { pos += 2; continue; } // No length.
+        if (code == 0xD9 || code == 0xDA) return false;               // EOI / SOS before any SOF.
+
+        if (!reader.Read(pos + 2, marker + 2, 2)) return false;
+        const uint16_t length = BE16(marker + 2);
+        if (length < 2) return false;
+        const uint64_t payload = pos + 4;
+
+        const bool is_sof = code >= 0xC0 && code <= 0xCF && code != 0xC4 && code != 0xC8 && code != 0xCC;
+        if (is_sof) {
+            uint8_t sof[5];
+            if (length < 7 || !reader.Read(payload, sof, sizeof(sof))) return false;
+            return SetSize(out, ImageFormat::Jpeg, BE16(sof + 3), BE16(sof + 1));
+        }
+
+        if (code == 0xE1 && length > 8) {
+            uint8_t sig[6];
+            if (reader.Read(payload, sig, sizeof(sig)) && memcmp(sig, "Exif\0\0", 6) == 0) {
+                std::vector<uint8_t> block(length - 8);
+                if (reader.Read(payload + 6, block.data(), block.size()) &&
+                    ExifParser::Parse(block.data(), block.size(), exif)) {
+                    out.orientation = exif.orientation;
+                }
+            }
+        }
+        pos = payload + length - 2;
+    }
+    return false;
+}
+
+/// @brief PNG: the IHDR chunk is required to come first, at a fixed offset.
+bool ImageProbe::ProbePng(const uint8_t* head, size_t size, ImageProbeInfo& out) {
+    if (size < 24 || !FourCC(head + 12, "IHDR")) return false;
+    return SetSize(out, ImageFormat::Png, BE32(head + 16), BE32(head + 20));
+}
+
+/// @brief GIF: the logical screen descriptor follows the 6-byte signature.
+bool ImageProbe::ProbeGif(const uint8_t* head, size_t size, ImageProbeInfo& out) {
+    if (size < 10) return false;
+    return SetSize(out, ImageFormat::Gif, LE16(head + 6), LE16(head + 8));
+}
+
+/**
+ * @brief WebP: reads the first chunk (VP8, VP8L or VP8X). For extended files with the
+ *        EXIF flag set, walks the chunk list to find the orientation.
+ */
+bool ImageProbe::ProbeWebP(WindowedReader& reader, const uint8_t* head, size_t size, ImageProbeInfo& out,
+                           ExifInfo& exif) {
+    if (size < 30) return false;
+    const uint8_t* chunk = head + 12;
+    const uint8_t* payload = head + 20;
+
+    if (FourCC(chunk, "VP8 ")) {
+        if (payload[3] != 0x9D || payload[4] != 0x01 || payload[5] != 0x2A) return false;
+        return SetSize(out, ImageFormat::WebP, LE16(payload + 6) & 0x3FFF, LE16(payload + 8) & 0x3FFF);
+    }
+    if (FourCC(chunk, "VP8L")) {
+        if (payload[0] != 0x2F) return false;
+        const uint32_t bits = LE32(payload + 1);
+        return SetSize(out, ImageFormat::WebP, (bits & 0x3FFF) + 1, ((bits >> 14) & 0x3FFF) + 1);
+    }
+    if (!FourCC(chunk, "VP8X")) return false;
+
+    if (!SetSize(out, ImageFormat::WebP, static_cast<int64_t>(LE24(payload + 4)) + 1,
+                 static_cast<int64_t>(LE24(payload + 7)) + 1)) {
+        return false;
+    }
+
+    const bool has_exif = (payload[0] & 0x08) != 0;
+    if (!has_exif) return true;
+
+    // Chunks are padded to even sizes. EXIF normally sits after the image data, so this
+    // costs one small read per chunk header rather than reading any pixel data.
+    const uint64_t riff_end = std::min<uint64_t>(reader.Size(), static_cast<uint64_t>(LE32(head + 4)) + 8);
+    uint64_t pos = 12;
+    while (pos + 8 <= riff_end) {
+        uint8_t header[8];
+        if (!reader.Read(pos, header, sizeof(header))) break;
+        const uint32_t chunk_size = LE32(header + 4);
+        if (FourCC(header, "EXIF")) {
+            if (chunk_size == 0 || chunk_size > kMaxExifSize) break;
+            std::vector<uint8_t> block(chunk_size);
+            if (!reader.Read(pos + 8, block.data(), block.size())) break;
+            // Some writers keep the JPEG-style "Exif\0\0" prefix.
+            size_t skip = (chunk_size > 6 && memcmp(block.data(), "Exif\0\0", 6) == 0) ? 6 : 0;
+            if (ExifParser::Parse(block.data() + skip, block.size() - skip, exif)) out.orientation = exif.orientation;
+            break;
+        }
+        pos += 8 + static_cast<uint64_t>(chunk_size) + (chunk_size & 1);
+    }
+    return true;
+}
+
+/**
+ * @brief HEIF / AVIF: finds the top-level 'meta' box, resolves the primary item through
+ *        'pitm', and reads its 'ispe' size plus any 'irot' / 'imir' transforms listed for
+ *        it in 'ipma'. Only the meta box is read; the media data is never touched.
+ */
+bool ImageProbe::ProbeIsoBmff(WindowedReader& reader, const uint8_t* head, size_t size, ImageProbeInfo& out,
+                              ExifInfo* exif) {
+    // 1. Classify from the ftyp brands.
+    const uint32_t ftyp_size = BE32(head);
+    ImageFormat format = ImageFormat::Heif;
+    if (FourCC(head + 8, "avif") || FourCC(head + 8, "avis")) {
+        format = ImageFormat::Avif;
+    }
+    else if (!FourCC(head + 8, "heic") && !FourCC(head + 8, "heix") && !FourCC(head + 8, "heim") &&
+             !FourCC(head + 8, "heis") && !FourCC(head + 8, "hevc") && !FourCC(head + 8, "hevx") &&
+             !FourCC(head + 8, "mif1") && !FourCC(head + 8, "msf1")) {
+        return false;
+    }
+    if (format == ImageFormat::Heif) {
+        // mif1-branded files may still be AVIF; the compatible brands tell them apart.
+        for (uint32_t p = 16; p + 4 <= std::min<uint32_t>(ftyp_size, static_cast<uint32_t>(size)); p += 4) {
+            if (FourCC(head + p, "avif")) { format = ImageFormat::Avif; break; }
+            if (FourCC(head + p, "heic") || FourCC(head + p, "heix")) break;
+        }
+    }
+
+    // 2. Locate the top-level meta box.
+    const uint64_t file_size = reader.Size();
+    uint64_t pos = 0;
+    uint64_t meta_offset = 0, meta_size = 0;
+    while (pos + 8 <= file_size) {
+        uint8_t header[16];
+        if (!reader.Read(pos, header, 8)) return false;
+        uint64_t box_size = BE32(header);
+        if (box_size == 1) {
+            if (!reader.Read(pos + 8, header + 8, 8)) return false;
+            box_size = BE64(header + 8);
+        }
+        else if (box_size == 0) {
+            box_size = file_size - pos;
+        }
+        if (box_size < 8 || box_size > file_size - pos) return false;
+        if (FourCC(header + 4, "meta")) {
+            meta_offset = pos;
+            meta_size = box_size;
+            break;
+        }
+        pos += box_size;
+    }
+    if (meta_size == 0 || meta_size > kMaxMetaBoxSize) return false;
+
+    // 3. Buffer the meta box and walk it.
+    std::vector<uint8_t> meta(static_cast<size_t>(meta_size));
+    if (!reader.Source().ReadExact(meta_offset, meta.data(), meta.size())) return false;
+    const uint8_t* d = meta.data();
+
+    Box meta_box;
+    if (!ReadBox(d, 0, meta_size, meta_box)) return false;
+    const uint64_t children = meta_box.payload + 4; // FullBox version/flags.
+
+    PrimaryProperties props;
+    Box ipco{}, ipma{}, iinf{}, iloc{};
+    bool have_pitm = false, have_ipco = false, have_ipma = false, have_iinf = false, have_iloc = false;
+
+    for (uint64_t p = children; p < meta_box.end;) {
+        Box child;
+        if (!ReadBox(d, p, meta_box.end, child)) break;
+        if (FourCC(reinterpret_cast<const uint8_t*>(child.type), "pitm")) {
+            have_pitm = ParsePitm(d, child, props.primary_id);
+        }
+        else if (FourCC(reinterpret_cast<const uint8_t*>(child.type), "iinf")) { iinf = child; have_iinf = true; }
+        else if (FourCC(reinterpret_cast<const uint8_t*>(child.type), "iloc")) { iloc = child; have_iloc = true; }
+        else if (FourCC(reinterpret_cast<const uint8_t*>(child.type), "iprp")) {
+            for (uint64_t q = child.payload; q < child.end;) {
+                Box grandchild;
+                if (!ReadBox(d, q, child.end, grandchild)) break;
+                if (FourCC(reinterpret_cast<const uint8_t*>(grandchild.type), "ipco")) { ipco = grandchild; have_ipco = true; }
+                if (FourCC(reinterpret_cast<const uint8_t*>(grandchild.type), "ipma")) { ipma = grandchild; have_ipma = true; }
+                q = grandchild.end;
+            }
+        }
+        p = child.end;
+    }
+    if (!have_pitm || !have_ipco || !have_ipma) return false;
+
+    // 4. Index the property container so ipma's 1-based indices can be resolved.
+    std::vector<Box> properties;
+    for (uint64_t p = ipco.payload; p < ipco.end;) {
+        Box property;
+        if (!ReadBox(d, p, ipco.end, property)) break;
+        properties.push_back(property);
+        p = property.end;
+    }
+
+    ParseIpma(d, ipma, props);
+
+    // 5. Apply the primary item's properties in association order.
+    uint32_t width = 0, height = 0;
+    Orientation orientation{ 0, false };
+    for (uint16_t index : props.indices) {
+        if (index > properties.size()) continue;
+        const Box& property = properties[index - 1];
+        const uint8_t* type = reinterpret_cast<const uint8_t*>(property.type);
+
+        if (FourCC(type, "ispe") && property.payload + 12 <= property.end) {
+            width = BE32(d + property.payload + 4);
+            height = BE32(d + property.payload + 8);
+        }
+        else if (FourCC(type, "irot") && property.payload + 1 <= property.end) {
+            // irot is an anti-clockwise rotation in quarter turns.
+            const int ccw = d[property.payload] & 3;
+            orientation = Compose(orientation, Orientation{ (4 - ccw) & 3, false });
+        }
+        else if (FourCC(type, "imir") && property.payload + 1 <= property.end) {
+            // axis 0 mirrors about the vertical axis (left/right); axis 1 about the horizontal one.
+            const bool horizontal_axis = (d[property.payload] & 1) != 0;
+            orientation = Compose(orientation, horizontal_axis ? Orientation{ 2, true } : Orientation{ 0, true });
+        }
+    }
+
+    out.orientation = OrientationToExif(orientation);
+    if (!SetSize(out, format, width, height)) return false;
+
+    // 6. Optionally read the Exif item for the capture time. Orientation stays with irot/imir,
+    //    which HEIF readers must honour instead of the EXIF tag.
+    if (exif && have_iinf && have_iloc) {
+        const uint32_t exif_id = FindExifItem(d, iinf);
+        uint64_t offset = 0, length = 0;
+        if (exif_id != 0 && FindItemExtent(d, iloc, exif_id, offset, length) &&
+            length > 4 && length <= kMaxExifSize && offset + length <= file_size) {
+            std::vector<uint8_t> block(static_cast<size_t>(length));
+            if (reader.Source().ReadExact(offset, block.data(), block.size())) {
+                // The item starts with a 32-bit offset from its 5th byte to the TIFF header.
+                const uint64_t tiff = 4 + static_cast<uint64_t>(BE32(block.data()));
+                if (tiff < block.size()) ExifParser::Parse(block.data() + tiff, block.size() - tiff, *exif);
+            }
+        }
+    }
+    return true;
+}
+
+/// @brief PSD / PSB: height and width are big-endian at fixed offsets in the file header.
+bool ImageProbe::ProbePsd(const uint8_t* head, size_t size, ImageProbeInfo& out) {
+    if (size < 26) return false;
+    const uint16_t version = BE16(head + 4);
+    if (version != 1 && version != 2) return false;
+    return SetSize(out, ImageFormat::Psd, BE32(head + 18), BE32(head + 14));
+}
+
+/// @brief DDS: DDS_HEADER follows the magic; dwHeight precedes dwWidth.
+bool ImageProbe::ProbeDds(const uint8_t* head, size_t size, ImageProbeInfo& out) {
+    if (size < 20 || LE32(head + 4) != 124) return false;
+    return SetSize(out, ImageFormat::Dds, LE32(head + 16), LE32(head + 12));
+}
+
+/**
+ * @brief ICO / CUR: reports the largest directory entry. A 0 in the directory means 256,
+ *        but PNG-compressed entries may be larger still, so their IHDR is consulted.
+ */
+bool ImageProbe::ProbeIco(WindowedReader& reader, const uint8_t* head, ImageProbeInfo& out) {
+    const uint16_t count = LE16(head + 4);
+    if (count == 0) return false;
+
+    int64_t best_w = 0, best_h = 0;
+    uint32_t best_offset = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+        uint8_t entry[16];
+        if (!reader.Read(6 + static_cast<uint64_t>(i) * 16, entry, sizeof(entry))) return false;
+        const int64_t w = entry[0] ? entry[0] : 256;
+        const int64_t h = entry[1] ? entry[1] : 256;
+        if (w * h > best_w * best_h) {
+            best_w = w;
+            best_h = h;
+            best_offset = LE32(entry + 12);
+        }
+    }
+
+    if (best_w == 256 || best_h == 256) {
+        uint8_t png[24];
+        if (reader.Read(best_offset, png, sizeof(png)) && png[0] == 0x89 && png[1] == 'P' && FourCC(png + 12, "IHDR")) {
+            best_w = BE32(png + 16);
+            best_h = BE32(png + 20);
+        }
+    }
+    return SetSize(out, ImageFormat::Ico, best_w, best_h);
+}
+
+/// @brief BMP: BITMAPCOREHEADER has 16-bit sizes; every later header has signed 32-bit ones.
+bool ImageProbe::ProbeBmp(const uint8_t* head, size_t size, ImageProbeInfo& out) {
+    if (size < 26) return false;
+    const uint32_t header_size = LE32(head + 14);
+    if (header_size == 12) {
+        return SetSize(out, ImageFormat::Bmp, LE16(head + 18), LE16(head + 20));
+    }
+    if (header_size < 40) return false;
+    const int32_t width = static_cast<int32_t>(LE32(head + 18));
+    const int32_t height = static_cast<int32_t>(LE32(head + 22));  // Negative for top-down.
+    return SetSize(out, ImageFormat::Bmp, width, height < 0 ? -static_cast<int64_t>(height) : height);
+}
@@ -0,0 +1,78 @@
+/**
+ * @file ImageProbe.h
+ * @brief Defines ImageProbe, a header-only dimension and orientation reader.
+ *
+ * The viewer often needs just the size and orientation of a photo to lay it out before
+ * any pixels are available. ImageProbe answers that by reading the few header bytes each
+ * format keeps them in, and never decodes image data.
+ */
+
+#pragma once
+#ifndef IMAGE_PROBE_H
+#define IMAGE_PROBE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+class ByteSource;
+class WindowedReader;
+struct ExifInfo;
+
+/// @brief Container formats recognised by ImageProbe. Values are shared with the managed side.
+enum class ImageFormat : int32_t {
+    Unknown = 0,
+    Jpeg,
+    Png,
+    Gif,
+    WebP,
+    Heif,
+    Avif,
+    Psd,
+    Dds,
+    Ico,
+    Bmp
+};
+
+/// @brief A C-style struct describing a probed image. Blittable for P/Invoke.
+struct ImageProbeInfo {
+    int32_t format;       ///< An ImageFormat value.
+    int32_t width;        ///< Stored pixel width, before orientation is applied.
+    int32_t height;       ///< Stored pixel height, before orientation is applied.
+    int32_t orientation;  ///< EXIF-style orientation (1..8). HEIF irot/imir are mapped onto it.
+};
+
+/// @brief Reads image dimensions and orientation from file headers.
+class ImageProbe {
+public:
+    /// @brief Identifies the format of `source` and reads its dimensions and orientation.
+    /// @param exif Optional. Receives the parsed EXIF fields (e.g. capture time) when the
+    ///        format carries an EXIF block; left at its defaults otherwise.
+    /// @return true if the format was recognised and the dimensions are valid.
+    static bool Probe(ByteSource& source, ImageProbeInfo& out, ExifInfo* exif = nullptr);
+
+    /// @brief Opens `path` and probes it.
+    static bool ProbeFile(const std::filesystem::path& path, ImageProbeInfo& out, ExifInfo* exif = nullptr);
+
+    /// @brief Probes many files in parallel.
+    /// @param paths Array of `count` null-terminated paths.
+    /// @param out Array of `count` results; entries for files that fail are zeroed.
+    /// @param max_threads Upper bound on worker threads; 0 picks the hardware concurrency.
+    /// @return The number of files successfully probed.
+    static int ProbeBatch(const std::filesystem::path::value_type* const* paths, size_t count,
+                          ImageProbeInfo* out, unsigned max_threads = 0);
+
+private:
+    static bool ProbeJpeg(WindowedReader& reader, ImageProbeInfo& out, ExifInfo& exif);
+    static bool ProbePng(const uint8_t* head, size_t size, ImageProbeInfo& out);
+    static bool ProbeGif(const uint8_t* head, size_t size, ImageProbeInfo& out);
+    static bool ProbeWebP(WindowedReader& reader, const uint8_t* head, size_t size, ImageProbeInfo& out, ExifInfo& exif);
+    static bool ProbeIsoBmff(WindowedReader& reader, const uint8_t* head, size_t size, ImageProbeInfo& out,
+                             ExifInfo* exif);
+    static bool ProbePsd(const uint8_t* head, size_t size, ImageProbeInfo& out);
+    static bool ProbeDds(const uint8_t* head, size_t size, ImageProbeInfo& out);
+    static bool ProbeIco(WindowedReader& reader, const uint8_t* head, ImageProbeInfo& out);
+    static bool ProbeBmp(const uint8_t* head, size_t size, ImageProbeInfo& out);
+};
+
+#endif // IMAGE_PROBE_H
@@ -0,0 +1,157 @@
+/**
+ * @file ImageReducer.cpp
+ * @brief Implements ImageReducer.
+ */
+
+#include "ImageReducer.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLY_REDUCER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    /// Averages the 2x2 box whose top-left source pixel is (x, y), clamping to the image.
+    void HalvePixel(const uint8_t* src, int width, int height, int stride, int x, int y, uint8_t* out) {
+        const int x1 = std::min(x + 1, width - 1), y1 = std::min(y + 1, height - 1);
+        const uint8_t* a = src + static_cast<size_t>(y) * stride + static_cast<size_t>(x) * 4;
+        const uint8_t* b = src + static_cast<size_t>(y) * stride + static_cast<size_t>(x1) * 4;
+        const uint8_t* c = src + static_cast<size_t>(y1) * stride + static_cast<size_t>(x) * 4;
+        const uint8_t* d = src + static_cast<size_t>(y1) * stride + static_cast<size_t>(x1) * 4;
+        for (int k = 0; k < 4; ++k) out[k] = static_cast<uint8_t>((a[k] + b[k] + c[k] + d[k] + 2) >> 2);
+    }
+
+    /// Output pixels [x0, x1) of output row `y`, one at a time.
+    void HalveSpanScalar(const uint8_t* src, int width, int height, int stride, int y, int x0, int x1, uint8_t* dst_row) {
+        for (int x = x0; x < x1; ++x) HalvePixel(src, width, height, stride, 2 * x, 2 * y, dst_row + x * 4);
+    }
+
+#ifdef FLY_REDUCER_SSE2
+    /// Sums horizontally adjacent pixel pairs: [p0 p1], [p2 p3] -> [p0+p1, p2+p3].
+    inline __m128i PairSums(__m128i p01, __m128i p23) {
+        return _mm_add_epi16(_mm_unpacklo_epi64(p01, p23), _mm_unpackhi_epi64(p01, p23));
+    }
+
+    /**
+     * Four output pixels per iteration: eight pixels from each of the two source rows are
+     * widened to 16 bits, summed vertically, then summed in horizontal pairs and rounded.
+     * Produces the same values as HalvePixel.
+     */
+    void HalveSpanSse2(const uint8_t* src, int width, int height, int stride, int y, int x0, int x1, uint8_t* dst_row) {
+        const uint8_t* row0 = src + static_cast<size_t>(2 * y) * stride;
+        const uint8_t* row1 = src + static_cast<size_t>(std::min(2 * y + 1, height - 1)) * stride;
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        int x = x0;
+        for (; x + 4 <= x1 && 2 * x + 8 <= width; x += 4) {
+            const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+            const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16));
+            const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+            const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16));
+            const __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            const __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            const __m128i s45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            const __m128i s67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+            const __m128i lo = _mm_srli_epi16(_mm_add_epi16(PairSums(s01, s23), two), 2);
+            const __m128i hi = _mm_srli_epi16(_mm_add_epi16(PairSums(s45, s67), two), 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_row + x * 4), _mm_packus_epi16(lo, hi));
+        }
+        HalveSpanScalar(src, width, height, stride, y, x, x1, dst_row);
+    }
+#endif
+
+    using HalveSpanFn = void (*)(const uint8_t*, int, int, int, int, int, int, uint8_t*);
+
+    HalveSpanFn SelectHalveKernel() {
+#ifdef FLY_REDUCER_SSE2
+        if (CpuFeatures::Level() >= SimdLevel::Sse2) return &HalveSpanSse2;
+#endif
+        return &HalveSpanScalar;
+    }
+
+    /// Source pixels contributing to one output coordinate, and their weights (summing to 1).
+    struct Taps {
+        int first = 0;
+        std::vector<float> weights;
+    };
+
+    std::vector<Taps> MakeTaps(int src_size, int dst_size) {
+        std::vector<Taps> taps(dst_size);
+        const double scale = static_cast<double>(src_size) / dst_size;
+        for (int i = 0; i < dst_size; ++i) {
+            Taps& t = taps[i];
+            if (scale >= 1.0) {
+                // Box: the overlap of each source pixel with [i * scale, (i + 1) * scale).
+                const double lo = i * scale, hi = std::min<double>((i + 1) * scale, src_size);
+                t.first = static_cast<int>(lo);
+                for (int j = t.first; j < hi; ++j) {
+                    const double cover = std::min<double>(j + 1, hi) - std::max<double>(j, lo);
+                    t.weights.push_back(static_cast<float>(cover / scale));
+                }
+            } else {
+                // Linear between the two nearest source centres, clamped at the edges.
+                const double centre = (i + 0.5) * scale - 0.5;
+                const int j = static_cast<int>(std::floor(centre));
+                const float frac = static_cast<float>(centre - j);
+                t.first = std::clamp(j, 0, src_size - 1);
+                if (j >= 0 && j + 1 < src_size) {
+                    t.weights = { 1.0f - frac, frac };
+                } else {
+                    t.weights = { 1.0f };
+                }
+            }
+        }
+        return taps;
+    }
+}
+
+void ImageReducer::Halve(const uint8_t* src, int width, int height, int stride, uint8_t* dst, int dst_stride) {
+    static const HalveSpanFn kernel = SelectHalveKernel();
+    const int dst_width = (width + 1) / 2, dst_height = (height + 1) / 2;
+    for (int y = 0; y < dst_height; ++y) {
+        kernel(src, width, height, stride, y, 0, dst_width, dst + static_cast<size_t>(y) * dst_stride);
+    }
+}
+
+/**
+ * @brief Separable: rows are filtered horizontally into a float buffer, then columns of that
+ *        buffer vertically. Only used for thumbnail-sized images, so it stays scalar.
+ */
+void ImageReducer::Resample(const uint8_t* src, int width, int height, int stride,
+                            uint8_t* dst, int dst_width, int dst_height, int dst_stride) {
+    const std::vector<Taps> taps_x = MakeTaps(width, dst_width);
+    const std::vector<Taps> taps_y = MakeTaps(height, dst_height);
+
+    std::vector<float> rows(static_cast<size_t>(height) * dst_width * 4);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* in = src + static_cast<size_t>(y) * stride;
+        float* out = &rows[static_cast<size_t>(y) * dst_width * 4];
+        for (int x = 0; x < dst_width; ++x) {
+            const Taps& t = taps_x[x];
+            float acc[4] = {};
+            for (size_t k = 0; k < t.weights.size(); ++k) {
+                const uint8_t* p = in + static_cast<size_t>(t.first + k) * 4;
+                for (int c = 0; c < 4; ++c) acc[c] += t.weights[k] * p[c];
+            }
+            for (int c = 0; c < 4; ++c) out[x * 4 + c] = acc[c];
+        }
+    }
+
+    for (int y = 0; y < dst_height; ++y) {
+        const Taps& t = taps_y[y];
+        uint8_t* out = dst + static_cast<size_t>(y) * dst_stride;
+        for (int x = 0; x < dst_width * 4; ++x) {
+            float acc = 0.0f;
+            for (size_t k = 0; k < t.weights.size(); ++k) {
+                acc += t.weights[k] * rows[(static_cast<size_t>(t.first) + k) * dst_width * 4 + x];
+            }
+            out[x] = static_cast<uint8_t>(std::clamp(static_cast<int>(acc + 0.5f), 0, 255));
+        }
+    }
+}
@@ -0,0 +1,35 @@
+/**
+ * @file ImageReducer.h
+ * @brief Declares ImageReducer, the box filters that build the smaller levels of a cached preview.
+ *
+ * A cached preview holds a chain of levels (see BlockEncoder::EncodePreview): the preview
+ * itself, successive halvings of it, and a square tile for the thumbnail strip. Halving is
+ * an exact 2x2 box average, which an SSE2 kernel does eight source pixels at a time; the
+ * tile is area-averaged from the centre of the smallest level. Pixels are premultiplied
+ * BGRA, so averaging all four channels alike is correct.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef IMAGE_REDUCER_H
+#define IMAGE_REDUCER_H
+
+#include <cstdint>
+
+/// @brief Downscaling filters for premultiplied BGRA images.
+class ImageReducer {
+public:
+    /// @brief Halves an image with a 2x2 box filter. The output is (width+1)/2 x (height+1)/2;
+    ///        an odd last row or column is averaged with itself.
+    /// @param dst Receives the output; rows are `dst_stride` bytes apart.
+    static void Halve(const uint8_t* src, int width, int height, int stride, uint8_t* dst, int dst_stride);
+
+    /// @brief Resamples an image to `dst_width` x `dst_height`. Each output pixel is the
+    ///        area-weighted average of the source pixels it covers when shrinking, and a
+    ///        linear interpolation of its neighbours when enlarging.
+    static void Resample(const uint8_t* src, int width, int height, int stride,
+                         uint8_t* dst, int dst_width, int dst_height, int dst_stride);
+};
+
+#endif // IMAGE_REDUCER_H
@@ -0,0 +1,435 @@
+/**
+ * @file JpegDecoder.cpp
+ * @brief Implements JpegDecoder.
+ */
+
+#include "JpegDecoder.h"
+#include "ExifParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <jpeglib.h>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "jpeg.lib")
+#endif
+
+namespace {
+
+    constexpr int64_t kPixelsPerWorker = 1 << 18;
+    constexpr int32_t kOrientTile = 32;
+
+    uint16_t BE16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+
+    /// @brief libjpeg reports fatal errors through error_exit, which must not return.
+    struct ErrorManager {
+        jpeg_error_mgr base;
+        jmp_buf jump;
+    };
+
+    void ErrorExit(j_common_ptr cinfo) { longjmp(reinterpret_cast<ErrorManager*>(cinfo->err)->jump, 1); }
+
+    /// Warnings about corrupt data are not fatal; the damaged part decodes grey, as in other viewers.
+    void OutputMessage(j_common_ptr) {}
+
+    /**
+     * @brief Decodes output rows [skip, skip + rows) of a JPEG stream at 1/`denominator` into `out`.
+     *        Rows before `skip` are decoded into a scratch row and dropped; the rest are not decoded.
+     * @details Nothing here may need a destructor: a fatal error longjmps back to the setjmp.
+     */
+    bool DecodeRows(const uint8_t* data, size_t size, int32_t denominator, int32_t width, int32_t skip, int32_t rows,
+                    uint8_t* out, size_t stride) {
+        if (size > ULONG_MAX) return false;
+
+        jpeg_decompress_struct cinfo;
+        ErrorManager error;
+        cinfo.err = jpeg_std_error(&error.base);
+        error.base.error_exit = ErrorExit;
+        error.base.output_message = OutputMessage;
+        if (setjmp(error.jump)) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo, data, static_cast<unsigned long>(size));
+        if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+        cinfo.out_color_space = JCS_EXT_BGRA;
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = static_cast<unsigned int>(denominator);
+        jpeg_start_decompress(&cinfo);
+        if (static_cast<int32_t>(cinfo.output_width) != width ||
+            static_cast<int64_t>(cinfo.output_height) < static_cast<int64_t>(skip) + rows) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+
+        JSAMPROW scratch = skip > 0
+            ? (*cinfo.mem->alloc_sarray)(reinterpret_cast<j_common_ptr>(&cinfo), JPOOL_IMAGE, static_cast<JDIMENSION>(width) * 4, 1)[0]
+            : nullptr;
+        const JDIMENSION end = static_cast<JDIMENSION>(skip + rows);
+        JSAMPROW pointers[16];
+        bool ok = true;
+        while (cinfo.output_scanline < end) {
+            const JDIMENSION first = cinfo.output_scanline;
+            const JDIMENSION count = std::min<JDIMENSION>(16, end - first);
+            for (JDIMENSION i = 0; i < count; ++i) {
+                const JDIMENSION line = first + i;
+                pointers[i] = line < static_cast<JDIMENSION>(skip) ? scratch : out + stride * (line - skip);
+            }
+            if (jpeg_read_scanlines(&cinfo, pointers, count) == 0) {
+                ok = false;
+                break;
+            }
+        }
+        jpeg_destroy_decompress(&cinfo);
+        return ok;
+    }
+
+    /**
+     * @brief Copies `src`, `width` x `height` packed pixels as stored, into `dst` with EXIF
+     *        `orientation` applied. Destination tiles keep the reads of a rotation within a few
+     *        source rows; bands of tile rows are shared out to the workers.
+     */
+    void Orient(const uint8_t* src, int32_t width, int32_t height, int32_t orientation, uint8_t* dst, size_t stride,
+                unsigned threads) {
+        const int64_t w = width, h = height;
+        int64_t base = 0, step_x = 1, step_y = w;
+        switch (orientation) {
+        case 2: base = w - 1;               step_x = -1; step_y = w;  break;
+        case 3: base = (h - 1) * w + w - 1; step_x = -1; step_y = -w; break;
+        case 4: base = (h - 1) * w;         step_x = 1;  step_y = -w; break;
+        case 5: base = 0;                   step_x = w;  step_y = 1;  break;
+        case 6: base = (h - 1) * w;         step_x = -w; step_y = 1;  break;
+        case 7: base = (h - 1) * w + w - 1; step_x = -w; step_y = -1; break;
+        case 8: base = w - 1;               step_x = w;  step_y = -1; break;
+        default: break;
+        }
+        const int32_t out_width = orientation >= 5 ? height : width;
+        const int32_t out_height = orientation >= 5 ? width : height;
+        const int32_t tasks = (out_height + kOrientTile - 1) / kOrientTile;
+
+        if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<int64_t>({threads, tasks, std::max<int64_t>(1, w * h / kPixelsPerWorker)}));
+
+        std::atomic<int32_t> next{0};
+        auto work = [&]() {
+            for (int32_t task = next.fetch_add(1); task < tasks; task = next.fetch_add(1)) {
+                const int32_t y0 = task * kOrientTile;
+                const int32_t y1 = std::min(out_height, y0 + kOrientTile);
+                for (int32_t x0 = 0; x0 < out_width; x0 += kOrientTile) {
+                    const int32_t x1 = std::min(out_width, x0 + kOrientTile);
+                    for (int32_t y = y0; y < y1; ++y) {
+                        uint8_t* out = dst + stride * static_cast<size_t>(y) + static_cast<size_t>(x0) * 4;
+                        int64_t at = base + step_y * y + step_x * x0;
+                        for (int32_t x = x0; x < x1; ++x, out += 4, at += step_x) {
+                            std::memcpy(out, src + at * 4, 4);
+                        }
+                    }
+                }
+            }
+        };
+
+        if (threads <= 1) {
+            work();
+            return;
+        }
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+        work();
+        for (auto& t : pool) t.join();
+    }
+
+    int32_t Scaled(int32_t size, int32_t denominator) { return (size + denominator - 1) / denominator; }
+}
+
+/**
+ * @brief Walks the markers from SOI to the first SOS. Only the first frame header counts, and
+ *        the first APP1 "Exif" segment if `exif_offset` asks for it.
+ */
+bool JpegDecoder::ParseStream(const uint8_t* data, size_t size, Stream& stream, size_t* exif_offset, size_t* exif_length) {
+    stream = Stream{};
+    if (!data || size < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+    stream.data = data;
+    stream.size = size;
+
+    size_t pos = 2;
+    bool have_frame = false;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) return false;
+        const uint8_t code = data[pos + 1];
+        if (code == 0xFF) { ++pos; continue; }                      // Fill byte.
+        if (code == 0x01 || (code >= 0xD0 && code <= 0xD8)) { pos += 2; continue; } // No length.
+        if (code == 0xD9) return false;                             // EOI before any scan.
+
+        const size_t length = BE16(data + pos + 2);
+        if (length < 2 || length > size - pos - 2) return false;
+        const uint8_t* payload = data + pos + 4;
+        const size_t payload_length = length - 2;
+
+        const bool is_sof = code >= 0xC0 && code <= 0xCF && code != 0xC4 && code != 0xC8 && code != 0xCC;
+        if (is_sof && !have_frame) {
+            if (payload_length < 6) return false;
+            have_frame = true;
+            stream.sof = code - 0xC0;
+            const int32_t precision = payload[0];
+            stream.height = BE16(payload + 1);
+            stream.width = BE16(payload + 3);
+            stream.components = payload[5];
+            stream.height_offset = pos + 5;
+            if (payload_length < 6 + static_cast<size_t>(stream.components) * 3) return false;
+            for (int32_t c = 0; c < stream.components; ++c) {
+                const uint8_t factors = payload[6 + c * 3 + 1];
+                const int32_t h = factors >> 4, v = factors & 15;
+                if (h < 1 || h > 4 || v < 1 || v > 4) return false;
+                stream.max_h = std::max(stream.max_h, h);
+                stream.max_v = std::max(stream.max_v, v);
+            }
+            stream.decodable = precision == 8 && (stream.sof == 0 || stream.sof == 1 || stream.sof == 2) &&
+                               (stream.components == 1 || stream.components == 3) && stream.width > 0 &&
+                               stream.height > 0 && static_cast<int64_t>(stream.width) * stream.height <= kMaxPixels;
+        }
+        else if (code == 0xDD && payload_length >= 2) {
+            stream.restart_interval = BE16(payload);
+        }
+        else if (code == 0xE1 && exif_offset && *exif_length == 0 && payload_length > 6 &&
+                 std::memcmp(payload, "Exif\0\0", 6) == 0) {
+            *exif_offset = pos + 10;
+            *exif_length = payload_length - 6;
+        }
+        else if (code == 0xDA) {
+            if (!have_frame || payload_length < 1) return false;
+            stream.scan_components = payload[0];
+            stream.scan_offset = pos + 2 + length;
+            return true;
+        }
+        pos += 2 + length;
+    }
+    return false;
+}
+
+/**
+ * @brief The thumbnail is a JPEG of its own inside the EXIF block; its headers are read now so
+ *        SelectScale() can weigh it without touching the main image again.
+ */
+bool JpegDecoder::Open(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    info_ = JpegInfo{};
+    thumbnail_ = Stream{};
+
+    size_t exif_offset = 0, exif_length = 0;
+    if (!ParseStream(data, size, main_, &exif_offset, &exif_length)) return false;
+
+    ExifInfo exif;
+    if (exif_length && ExifParser::Parse(data + exif_offset, exif_length, exif) && exif.thumbnail_length) {
+        Stream thumbnail;
+        if (ParseStream(data + exif_offset + exif.thumbnail_offset, exif.thumbnail_length, thumbnail, nullptr, nullptr) &&
+            thumbnail.decodable && thumbnail.width < main_.width && thumbnail.height < main_.height) {
+            thumbnail_ = thumbnail;
+        }
+    }
+
+    const bool swap = exif.orientation >= 5;
+    info_.width = swap ? main_.height : main_.width;
+    info_.height = swap ? main_.width : main_.height;
+    info_.orientation = exif.orientation;
+    info_.components = main_.components;
+    info_.progressive = main_.sof == 2 ? 1 : 0;
+    info_.restart_interval = main_.restart_interval;
+    if (thumbnail_.decodable) {
+        info_.thumbnail_width = swap ? thumbnail_.height : thumbnail_.width;
+        info_.thumbnail_height = swap ? thumbnail_.width : thumbnail_.height;
+    }
+    info_.can_decode = main_.decodable ? 1 : 0;
+    return true;
+}
+
+JpegScale JpegDecoder::Resolve(int32_t thumbnail, int32_t denominator) const {
+    const Stream& stream = thumbnail ? thumbnail_ : main_;
+    const bool valid = thumbnail ? denominator == 1
+                                 : denominator == 1 || denominator == 2 || denominator == 4 || denominator == 8;
+    if (!stream.decodable || !valid) return JpegScale{thumbnail ? 1 : 0, denominator, 0, 0};
+
+    const int32_t width = Scaled(stream.width, denominator);
+    const int32_t height = Scaled(stream.height, denominator);
+    const bool swap = info_.orientation >= 5;
+    return JpegScale{thumbnail ? 1 : 0, denominator, swap ? height : width, swap ? width : height};
+}
+
+/**
+ * @brief Prefers the thumbnail, as it costs almost nothing to decode. Cameras often letterbox a
+ *        160x120 thumbnail of a 3:2 photo, so it must also match the image's aspect ratio within 2%.
+ */
+JpegScale JpegDecoder::SelectScale(int32_t max_dimension) const {
+    if (max_dimension <= 0) return Resolve(0, 1);
+
+    if (thumbnail_.decodable && std::max(thumbnail_.width, thumbnail_.height) >= max_dimension) {
+        const int64_t cross = static_cast<int64_t>(thumbnail_.width) * main_.height -
+                              static_cast<int64_t>(thumbnail_.height) * main_.width;
+        if (std::abs(cross) * 50 <= static_cast<int64_t>(thumbnail_.width) * main_.height) return Resolve(1, 1);
+    }
+    for (int32_t denominator : {8, 4, 2}) {
+        if (std::max(Scaled(main_.width, denominator), Scaled(main_.height, denominator)) >= max_dimension) {
+            return Resolve(0, denominator);
+        }
+    }
+    return Resolve(0, 1);
+}
+
+/**
+ * @brief Decodes as stored, straight into `bgra` when there is no orientation to apply and
+ *        through a buffer of the stored size otherwise.
+ */
+bool JpegDecoder::Decode(const JpegScale& scale, uint8_t* bgra, size_t stride, unsigned threads) const {
+    const JpegScale resolved = Resolve(scale.thumbnail, scale.denominator);
+    if (!bgra || resolved.width == 0 || resolved.width != scale.width || resolved.height != scale.height ||
+        stride < static_cast<size_t>(resolved.width) * 4) {
+        return false;
+    }
+
+    const Stream& stream = scale.thumbnail ? thumbnail_ : main_;
+    const int32_t width = Scaled(stream.width, scale.denominator);
+    const int32_t height = Scaled(stream.height, scale.denominator);
+    const int32_t orientation = info_.orientation;
+
+    std::vector<uint8_t> stored;
+    uint8_t* target = bgra;
+    size_t target_stride = stride;
+    if (orientation != 1) {
+        stored.resize(static_cast<size_t>(width) * height * 4);
+        target = stored.data();
+        target_stride = static_cast<size_t>(width) * 4;
+    }
+
+    // Entropy decoding is most of the work at any scale, so the bands follow the stored size.
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned bands = static_cast<unsigned>(std::min<int64_t>(
+        threads, std::max<int64_t>(1, static_cast<int64_t>(stream.width) * stream.height / kPixelsPerWorker)));
+    bool failed = false;
+    if (bands < 2 || !DecodeBands(stream, scale.denominator, target, target_stride, bands, failed)) {
+        failed = !DecodeSerial(stream, scale.denominator, target, target_stride);
+    }
+    if (failed) return false;
+
+    if (orientation != 1) Orient(target, width, height, orientation, bgra, stride, threads);
+    return true;
+}
+
+bool JpegDecoder::DecodeSerial(const Stream& stream, int32_t denominator, uint8_t* bgra, size_t stride) const {
+    const int32_t width = Scaled(stream.width, denominator);
+    const int32_t height = Scaled(stream.height, denominator);
+    return DecodeRows(stream.data, stream.size, denominator, width, 0, height, bgra, stride);
+}
+
+/**
+ * @brief Splits the first scan at restart markers that start an MCU row, and decodes the bands
+ *        on separate threads. Markers are found with one pass over the entropy-coded data; it
+ *        must hold exactly the markers the restart interval implies and end at EOI. Anything
+ *        else (a progressive or multi-scan file, DNL, a damaged marker) decodes serially.
+ */
+bool JpegDecoder::DecodeBands(const Stream& stream, int32_t denominator, uint8_t* bgra, size_t stride, unsigned bands,
+                              bool& failed) const {
+    const int32_t interval = stream.restart_interval;
+    if (interval <= 0 || stream.sof > 1 || stream.scan_components != stream.components) return false;
+
+    // A single-component scan is not interleaved: its MCU is one 8x8 block.
+    const int32_t mcu_width = stream.components > 1 ? 8 * stream.max_h : 8;
+    const int32_t mcu_height = stream.components > 1 ? 8 * stream.max_v : 8;
+    const int64_t mcus_per_row = (stream.width + mcu_width - 1) / mcu_width;
+    const int32_t mcu_rows = (stream.height + mcu_height - 1) / mcu_height;
+    const int64_t total = mcus_per_row * mcu_rows;
+    const int64_t segments = (total + interval - 1) / interval;
+
+    // MCU rows between restart markers that fall on a row boundary.
+    const int64_t step = interval / std::gcd<int64_t>(interval, mcus_per_row);
+    const int64_t units = mcu_rows / step;
+    bands = static_cast<unsigned>(std::min<int64_t>(bands, units / 2));
+    if (bands < 2) return false;
+
+    const uint8_t* data = stream.data;
+    std::vector<size_t> markers;
+    markers.reserve(static_cast<size_t>(segments));
+    size_t pos = stream.scan_offset, end = 0;
+    while (!end) {
+        const void* found = pos < stream.size ? std::memchr(data + pos, 0xFF, stream.size - pos) : nullptr;
+        if (!found) return false;
+        pos = static_cast<const uint8_t*>(found) - data;
+        if (pos + 1 >= stream.size) return false;
+        const uint8_t code = data[pos + 1];
+        if (code == 0x00) { pos += 2; continue; }                   // Stuffed 0xFF.
+        if (code == 0xFF) { ++pos; continue; }                      // Fill byte.
+        if (code >= 0xD0 && code <= 0xD7) {
+            if (code - 0xD0 != static_cast<int32_t>(markers.size() & 7)) return false;
+            markers.push_back(pos);
+            pos += 2;
+            continue;
+        }
+        if (code != 0xD9) return false;
+        end = pos;
+    }
+    if (static_cast<int64_t>(markers.size()) != segments - 1) return false;
+
+    auto segment_start = [&](int64_t s) { return s == 0 ? stream.scan_offset : markers[s - 1] + 2; };
+    auto segment_end = [&](int64_t s) { return s == segments - 1 ? end : markers[s]; };
+    const int32_t out_per_row = mcu_height / denominator;
+    const int32_t out_height = Scaled(stream.height, denominator);
+    const int32_t out_width = Scaled(stream.width, denominator);
+
+    std::atomic<unsigned> next{0};
+    std::atomic<bool> any_failed{false};
+    auto work = [&]() {
+        std::vector<uint8_t> band;
+        for (unsigned b = next.fetch_add(1); b < bands; b = next.fetch_add(1)) {
+            // Kept MCU rows [keep0, keep1); decoded rows [decode0, decode1), one step more on each inner side.
+            const int64_t keep0 = units * b / bands * step;
+            const int64_t keep1 = b + 1 == bands ? mcu_rows : units * (b + 1) / bands * step;
+            const int64_t decode0 = b == 0 ? 0 : keep0 - step;
+            const int64_t decode1 = b + 1 == bands ? mcu_rows : keep1 + step;
+            const int64_t first = decode0 * mcus_per_row / interval;
+            const int64_t last = decode1 == mcu_rows ? segments : decode1 * mcus_per_row / interval;
+
+            const size_t from = segment_start(first), to = segment_end(last - 1);
+            band.resize(stream.scan_offset + (to - from) + 2);
+            std::memcpy(band.data(), data, stream.scan_offset);
+            std::memcpy(band.data() + stream.scan_offset, data + from, to - from);
+            band[band.size() - 2] = 0xFF;
+            band[band.size() - 1] = 0xD9;
+            const int64_t rows = std::min<int64_t>(decode1 * mcu_height, stream.height) - decode0 * mcu_height;
+            band[stream.height_offset] = static_cast<uint8_t>(rows >> 8);
+            band[stream.height_offset + 1] = static_cast<uint8_t>(rows);
+            for (int64_t m = first; m < last - 1; ++m) {
+                band[stream.scan_offset + (markers[m] - from) + 1] = static_cast<uint8_t>(0xD0 + ((m - first) & 7));
+            }
+
+            const int32_t skip = static_cast<int32_t>((keep0 - decode0) * out_per_row);
+            const int32_t row0 = static_cast<int32_t>(keep0 * out_per_row);
+            const int32_t row1 = static_cast<int32_t>(std::min<int64_t>(keep1 * out_per_row, out_height));
+            if (!DecodeRows(band.data(), band.size(), denominator, out_width, skip, row1 - row0,
+                            bgra + stride * static_cast<size_t>(row0), stride)) {
+                any_failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(bands - 1);
+    for (unsigned t = 1; t < bands; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    failed = any_failed;
+    return true;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file JpegDecoder.h
+ * @brief Declares JpegDecoder, a libjpeg-turbo reader with DCT-domain scaling and
+ *        restart-interval parallel decoding.
+ *
+ * Open() walks the markers up to the first scan, so it reads a few kilobytes at most: the frame
+ * header, the restart interval, and the EXIF block with its orientation and thumbnail.
+ * SelectScale() then picks the cheapest source that covers a display size:
+ *
+ * - The EXIF thumbnail, if it is at least that large and has the image's aspect ratio.
+ * - Otherwise the main image with libjpeg's reduced IDCT (1/2, 1/4 or 1/8). That computes only
+ *   the low-frequency part of each block and upsamples and converts a quarter or less of the
+ *   pixels, and nothing has to be resized afterwards. Entropy decoding still reads the whole
+ *   file, so the saving is largest for baseline files and smaller for progressive ones.
+ *
+ * A baseline image with restart markers at MCU row boundaries is decoded in bands, one per
+ * worker. Each band is a small JPEG of its own: the original headers with the height patched,
+ * and the entropy-coded segments between two restart markers, renumbered from RST0. The DC
+ * predictors restart at each marker, so a band decodes independently. Each band also decodes
+ * one band-aligned MCU row above and below what it keeps, so chroma upsampling at band edges
+ * sees the same neighbours it would in a single pass. The output is identical to a serial
+ * decode. Progressive images, and images without restart markers, are decoded serially.
+ *
+ * The output is opaque BGRA with the EXIF orientation applied. Only 8-bit greyscale, YCbCr
+ * and RGB images are decoded; CMYK, 12-bit, lossless and arithmetic-coded files are left to
+ * WIC. The file data is not copied and must outlive the decoder. Decode() may be called from
+ * several threads at once; Open() may not.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef JPEG_DECODER_H
+#define JPEG_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief What Open() found. Blittable for P/Invoke.
+struct JpegInfo {
+    int32_t width;                      ///< As displayed, after the EXIF orientation.
+    int32_t height;
+    int32_t orientation;                ///< 1-8, as in EXIF; Decode() applies it.
+    int32_t components;                 ///< 1 for greyscale, 3 for YCbCr or RGB.
+    int32_t progressive;
+    int32_t restart_interval;           ///< MCUs between restart markers; 0 if there are none.
+    int32_t thumbnail_width;            ///< Of the EXIF thumbnail as displayed; 0 if there is none.
+    int32_t thumbnail_height;
+    int32_t can_decode;                 ///< 1 if Decode() handles the main image.
+    int32_t reserved;
+};
+
+/// @brief The source to decode for a display size, and the size it comes out at. Blittable for P/Invoke.
+struct JpegScale {
+    int32_t thumbnail;                  ///< 1 for the EXIF thumbnail, 0 for the main image.
+    int32_t denominator;                ///< IDCT scale of the main image: 1, 2, 4 or 8. 1 for the thumbnail.
+    int32_t width;                      ///< Of the output, as displayed.
+    int32_t height;
+};
+
+/// @brief Parses a JPEG in memory and decodes it, or its EXIF thumbnail, to BGRA.
+class JpegDecoder {
+public:
+    /// Images larger than this many pixels are not decoded.
+    static constexpr int64_t kMaxPixels = 1ll << 28;
+
+    /// @brief Reads the markers before the first scan and the EXIF thumbnail's frame header.
+    /// @return false if the data is not a JPEG or its headers are inconsistent.
+    bool Open(const uint8_t* data, size_t size);
+
+    const JpegInfo& Info() const { return info_; }
+
+    /// @brief The cheapest source whose longer side is at least `max_dimension`.
+    /// @details The main image at full size if none is, or if `max_dimension` is 0 or less.
+    JpegScale SelectScale(int32_t max_dimension) const;
+
+    /// @brief The size, as displayed, that `scale` comes out at; 0x0 if it names no source.
+    JpegScale Resolve(int32_t thumbnail, int32_t denominator) const;
+
+    /// @brief Decodes `scale` into `bgra`, `scale.height` rows of `stride` bytes.
+    /// @param threads Bands to decode in parallel; 0 for one per core. Used only when the image has
+    ///        restart markers at MCU row boundaries and is large enough.
+    /// @return false if the source cannot be decoded or libjpeg reports a fatal error.
+    bool Decode(const JpegScale& scale, uint8_t* bgra, size_t stride, unsigned threads = 0) const;
+
+private:
+    /// The frame and first-scan layout of one JPEG stream: the main image or the thumbnail.
+    struct Stream {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        int32_t width = 0;              // As stored.
+        int32_t height = 0;
+        int32_t components = 0;
+        int32_t sof = -1;               // The SOFn marker's n.
+        int32_t restart_interval = 0;
+        size_t height_offset = 0;       // Of the frame header's height field.
+        size_t scan_offset = 0;         // First byte of the first scan's entropy-coded data.
+        int32_t scan_components = 0;
+        int32_t max_h = 1;              // Largest sampling factors.
+        int32_t max_v = 1;
+        bool decodable = false;
+    };
+
+    static bool ParseStream(const uint8_t* data, size_t size, Stream& stream, size_t* exif_offset, size_t* exif_length);
+
+    bool DecodeSerial(const Stream& stream, int32_t denominator, uint8_t* bgra, size_t stride) const;
+
+    /// @return false without touching `bgra` if the stream cannot be split; the caller then decodes serially.
+    bool DecodeBands(const Stream& stream, int32_t denominator, uint8_t* bgra, size_t stride, unsigned bands,
+                     bool& failed) const;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    JpegInfo info_{};
+    Stream main_;
+    Stream thumbnail_;
+};
+
+#endif // JPEG_DECODER_H
@@ -1,6 +1,10 @@
 #include "pch.h"
 #include "NativeExports.h"
+#include "AvifAnimationSource.h"
+#include "ContentFingerprint.h"
+#include "FileSource.h"
 #include <atlstr.h>
+#include <algorithm>
 
 /**
  * @brief Converts a std::wstring (UTF-16) to a std::string (ANSI/UTF-8).
@@ -14,6 +18,24 @@ static std::string WStringToString(const std::wstring& wstr)
     return std::string(CW2A(wstr.c_str(), CP_UTF8));
 }
 
+/**
+ * @brief Converts an array of UTF-16 extensions to the lower-case UTF-8 form the folder walkers
+ *        compare against. Null entries are skipped.
+ */
+static std::vector<std::string> LowerExtensions(const wchar_t* const* extensions, int extension_count)
+{
+    std::vector<std::string> lowered;
+    lowered.reserve(extension_count);
+    for (int i = 0; i < extension_count; ++i) {
+        if (!extensions[i]) continue;
+        std::string ext = std::filesystem::path(extensions[i]).u8string();
+        std::transform(ext.begin(), ext.end(), ext.begin(),
+            [](char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; });
+        lowered.push_back(std::move(ext));
+    }
+    return lowered;
+}
+
 /**
  * @brief C-API function to extract the primary image into a raw RGBA buffer.
  * This function serves as the boundary between managed C# and native C++,
@@ -21,7 +43,9 @@ static std::string WStringToString(const std::wstring& wstr)
  */
 HeifError ExtractPrimaryImage(const wchar_t* heic_path, PixelBuffer* out_buffer) {
     // Basic input validation to prevent null pointer dereferences.
-    if (!heic_path || !out_buffer) { return HeifError::InvalidInput; }
+    // Record stage timings for GetLastDecodeReport().
+    DecodeReportScope report(0);
+    if (!heic_path || !out_buffer) { return report.Finish(HeifError::InvalidInput); }
     // Zero out the output buffer to ensure it's in a known-good state, especially on failure.
     memset(out_buffer, 0, sizeof(PixelBuffer));
 
@@ -43,7 +67,7 @@ HeifError ExtractPrimaryImage(const wchar_t* heic_path, PixelBuffer* out_buffer)
     }
 
     // Return the result code to the caller.
-    return result;
+    return report.Finish(result);
 }
 
 /**
@@ -51,8 +75,9 @@ HeifError ExtractPrimaryImage(const wchar_t* heic_path, PixelBuffer* out_buffer)
  * This is the C-style wrapper for the thumbnail extraction functionality.
  */
 HeifError ExtractThumbnail(const wchar_t* heic_path, PixelBuffer* out_buffer) {
+    DecodeReportScope report(0);
     // Basic input validation.
-    if (!heic_path || !out_buffer) { return HeifError::InvalidInput; }
+    if (!heic_path || !out_buffer) { return report.Finish(HeifError::InvalidInput); }
     // Ensure the output buffer is clean before proceeding.
     memset(out_buffer, 0, sizeof(PixelBuffer));
 
@@ -71,7 +96,7 @@ HeifError ExtractThumbnail(const wchar_t* heic_path, PixelBuffer* out_buffer) {
         *out_buffer = cppBuffer;
     }
 
-    return result;
+    return report.Finish(result);
 }
 
 /**
@@ -95,7 +120,8 @@ void FreePixelBuffer(PixelBuffer* buffer) {
  * This function serves as the boundary between managed C# and native C++ memory for in-RAM decodes.
  */
 HeifError ExtractPrimaryImageAndAnimationStatusFromMemory(const uint8_t* data, size_t size, PixelBuffer* out_buffer, bool* out_is_animated) {
-    if (!data || size == 0 || !out_buffer || !out_is_animated) { return HeifError::InvalidInput; }
+    DecodeReportScope report(0);
+    if (!data || size == 0 || !out_buffer || !out_is_animated) { return report.Finish(HeifError::InvalidInput); }
     memset(out_buffer, 0, sizeof(PixelBuffer));
     *out_is_animated = false;
 
@@ -108,86 +134,1216 @@ HeifError ExtractPrimaryImageAndAnimationStatusFromMemory(const uint8_t* data, s
         *out_buffer = cppBuffer;
     }
 
-    return result;
+    return report.Finish(result);
+}
+
+// --- Versioned API Exports ---
+
+/**
+ * @brief Returns the function table for the requested version.
+ * @param version The table version the caller was built against.
+ * @return The static table, or nullptr if the version is not supported by this build.
+ */
+const FlyHeifApi* GetFlyHeifApi(uint32_t version) {
+    if (version == 0 || version > FLY_HEIF_API_VERSION) return nullptr;
+    return GetFlyHeifApiTable();
+}
+
+/**
+ * @brief C-API function to decode a file into a raw RGBA buffer according to the caller's options.
+ * Ownership of the pixel data passes to the caller, as with ExtractPrimaryImage.
+ */
+HeifError DecodeHeifImage(const wchar_t* path, const FlyHeifDecodeOptions* options, PixelBuffer* out_buffer) {
+    const FlyHeifDecodeOptions decode_options = HeifReader::ReadOptions(options);
+    DecodeReportScope report(decode_options.thread_count);
+    if (!path || !out_buffer) { return report.Finish(HeifError::InvalidInput); }
+    memset(out_buffer, 0, sizeof(PixelBuffer));
+
+    HeifReader reader;
+    PixelBuffer cppBuffer{};
+    const std::string input_file = WStringToString(path);
+
+    HeifError result = reader.Decode(input_file, decode_options, cppBuffer);
+    if (result == HeifError::Ok) {
+        *out_buffer = cppBuffer;
+    }
+    return report.Finish(result);
+}
+
+/**
+ * @brief C-API function to decode in-memory file data according to the caller's options.
+ */
+HeifError DecodeHeifImageFromMemory(const uint8_t* data, size_t size, const FlyHeifDecodeOptions* options, PixelBuffer* out_buffer, bool* out_is_animated) {
+    const FlyHeifDecodeOptions decode_options = HeifReader::ReadOptions(options);
+    DecodeReportScope report(decode_options.thread_count);
+    if (!data || size == 0 || !out_buffer) { return report.Finish(HeifError::InvalidInput); }
+    memset(out_buffer, 0, sizeof(PixelBuffer));
+    if (out_is_animated) *out_is_animated = false;
+
+    HeifReader reader;
+    PixelBuffer cppBuffer{};
+    bool is_animated = false;
+
+    HeifError result = reader.DecodeFromMemory(data, size, decode_options, cppBuffer, is_animated);
+    if (out_is_animated) *out_is_animated = is_animated;
+    if (result == HeifError::Ok) {
+        *out_buffer = cppBuffer;
+    }
+    return report.Finish(result);
 }
 
-// --- AVIF Animation Exports ---
+/**
+ * @brief Copies the report of the last decode export that ran on the calling thread.
+ * @param out_report Caller-allocated struct with `struct_size` set; at most that many bytes are written.
+ * @return True if a report was available, false if this thread has not decoded anything yet.
+ */
+bool GetLastDecodeReport(DecodeReport* out_report) {
+    if (!out_report) return false;
+    return DecodeReportScope::GetLast(*out_report);
+}
 
-#include "AnimatedAvifReader.h"
+// --- Animation Exports ---
 
 /**
- * @brief Opens an AVIF/HEIF animation file from memory and caches its frame metadata.
- * @param data Pointer to the file data in memory.
+ * @brief Opens an animation from memory with the backend its signature calls for.
+ * @param data Pointer to the file data in memory; it must stay valid until CloseAnimation().
  * @param size Size of the file data in bytes.
- * @return An opaque handle to the animation context `AnimatedAvifReader`, or nullptr on failure. This handle must be passed to subsequent Avif export functions.
+ * @return An opaque handle to the `IAnimationSource`, or nullptr on failure.
  */
-void* OpenAvifAnimation(const uint8_t* data, size_t size) {
+void* OpenAnimation(const uint8_t* data, size_t size) {
     if (!data || size == 0) return nullptr;
 
-    auto reader = new AnimatedAvifReader();
-    if (!reader->Open(data, size)) {
-        delete reader;
+    const int32_t format = SniffAnimationFormat(data, size);
+    IAnimationSource* source = nullptr;
+    switch (static_cast<ImageFormat>(format)) {
+        case ImageFormat::Gif: source = new GifAnimationSource(format); break;
+        case ImageFormat::Png: source = new ApngAnimationSource(format); break;
+        case ImageFormat::WebP: source = new WebpAnimationSource(format); break;
+        case ImageFormat::Avif:
+        case ImageFormat::Heif: source = new AvifAnimationSource(format); break;
+        default: return nullptr;
+    }
+    if (!source->Open(data, size)) {
+        delete source;
         return nullptr;
     }
-    return reader;
+    return source;
+}
+
+/**
+ * @brief Retrieves the canvas size, frame count, loop count, total duration and container format.
+ * @param handle Opaque handle to the `IAnimationSource`.
+ * @param out_info Pointer to a struct to receive the information.
+ * @return False if an argument is invalid.
+ */
+bool GetAnimationInfo(void* handle, AnimationInfo* out_info) {
+    if (!out_info) return false;
+    memset(out_info, 0, sizeof(AnimationInfo));
+    if (!handle) return false;
+    *out_info = static_cast<IAnimationSource*>(handle)->Info();
+    return true;
 }
 
 /**
- * @brief Checks quickly if the given context handle holds an animated sequence.
- * @param handle Opaque handle to the `AnimatedAvifReader` context.
- * @return True if it contains a sequence track, false otherwise.
+ * @brief Retrieves the rectangle, delay and key-frame flag of one frame.
+ * @param handle Opaque handle to the `IAnimationSource`.
+ * @param index Frame index.
+ * @param out_info Pointer to a struct to receive the frame information.
+ * @return False if an argument is invalid or the index is out of range.
  */
-bool IsAvifAnimated(void* handle) {
+bool GetAnimationFrameInfo(void* handle, int32_t index, AnimationFrameInfo* out_info) {
+    if (!out_info) return false;
+    memset(out_info, 0, sizeof(AnimationFrameInfo));
     if (!handle) return false;
-    return static_cast<AnimatedAvifReader*>(handle)->IsAnimated();
+    const IAnimationSource* source = static_cast<IAnimationSource*>(handle);
+    if (index < 0 || index >= source->Info().frame_count) return false;
+    *out_info = source->Frame(index);
+    return true;
+}
+
+/**
+ * @brief Renders frame `index` and copies the rectangle that changed into one slot of the caller's ring.
+ * @param handle Opaque handle to the `IAnimationSource`.
+ * @param index Frame to show.
+ * @param ring The caller's ring of slots.
+ * @param slot Slot to write the packed rectangle to.
+ * @param out_dirty Receives the changed rectangle.
+ * @return False if an argument is invalid, the index is out of range or the frame could not be decoded.
+ */
+bool DecodeAnimationFrame(void* handle, int32_t index, const AnimationRing* ring, int32_t slot, FrameRect* out_dirty) {
+    DecodeReportScope report(1);
+    if (out_dirty) memset(out_dirty, 0, sizeof(FrameRect));
+    if (!handle || !ring || !out_dirty) { report.Finish(HeifError::InvalidInput); return false; }
+
+    FrameRect dirty;
+    if (!static_cast<IAnimationSource*>(handle)->DecodeInto(index, *ring, slot, dirty)) {
+        report.Finish(HeifError::ImageDecodeError);
+        return false;
+    }
+    *out_dirty = dirty;
+    report.Finish(HeifError::Ok);
+    return true;
+}
+
+/**
+ * @brief Retrieves the memory held and the frames decoded so far.
+ * @param handle Opaque handle to the `IAnimationSource`.
+ * @param out_stats Pointer to a struct to receive the statistics.
+ * @return False if an argument is invalid.
+ */
+bool GetAnimationStats(void* handle, AnimationStats* out_stats) {
+    if (!out_stats) return false;
+    memset(out_stats, 0, sizeof(AnimationStats));
+    if (!handle) return false;
+    *out_stats = static_cast<IAnimationSource*>(handle)->Stats();
+    return true;
+}
+
+/**
+ * @brief Releases the source and everything it holds.
+ * @param handle Opaque handle to the `IAnimationSource`.
+ */
+void CloseAnimation(void* handle) {
+    if (handle) {
+        delete static_cast<IAnimationSource*>(handle);
+    }
+}
+
+// --- PSD Exports ---
+
+/**
+ * @brief Maps the file and walks its sections; only the pages holding section headers and
+ *        image resources are read, whatever the size of the layers.
+ * @param path Path to the .psd or .psb file (UTF-16).
+ * @param out_info Pointer to a struct to receive the result.
+ * @return False if an argument is invalid, or the file cannot be mapped or is not a PSD or PSB.
+ */
+bool ReadPsdInfo(const wchar_t* path, PsdInfo* out_info) {
+    if (!path || !out_info) return false;
+    memset(out_info, 0, sizeof(PsdInfo));
+
+    MappedFile file;
+    PsdDecoder decoder;
+    if (!file.Open(path) || !decoder.Open(file.Data(), file.Size())) return false;
+    *out_info = decoder.Info();
+    return true;
+}
+
+/**
+ * @brief Decodes the composite straight from the mapping into the caller's buffer, so the
+ *        pixels are written once and nothing but a few rows of scratch is allocated.
+ * @param path Path to the .psd or .psb file (UTF-16).
+ * @param out_bgra Caller-allocated buffer for the pixels.
+ * @param out_size Size of `out_bgra` in bytes.
+ * @return A HeifError code indicating the result.
+ */
+HeifError DecodePsdComposite(const wchar_t* path, uint8_t* out_bgra, uint64_t out_size) {
+    DecodeReportScope report(1);
+    if (!path || !out_bgra) { return report.Finish(HeifError::InvalidInput); }
+
+    MappedFile file;
+    PsdDecoder decoder;
+    {
+        DecodeReportScope::StageTimer timer(&DecodeReport::open_ns);
+        if (!file.Open(path)) { return report.Finish(HeifError::FileReadError); }
+        if (!decoder.Open(file.Data(), file.Size())) { return report.Finish(HeifError::FileReadError); }
+    }
+    const PsdInfo& info = decoder.Info();
+    if (!info.can_decode) { return report.Finish(HeifError::ImageDecodeError); }
+    if (out_size != static_cast<uint64_t>(info.width) * info.height * 4) { return report.Finish(HeifError::InvalidInput); }
+
+    {
+        DecodeReportScope::StageTimer timer(&DecodeReport::decode_ns);
+        if (!decoder.Decode(out_bgra, static_cast<size_t>(info.width) * 4)) { return report.Finish(HeifError::ImageDecodeError); }
+    }
+    DecodeReportScope::Output(info.width, info.height);
+    return report.Finish(HeifError::Ok);
+}
+
+// --- DDS Exports ---
+
+/**
+ * @brief Maps the file and reads its header; the surfaces are located by arithmetic, so none
+ *        of the pixel data is touched.
+ * @param path Path to the .dds file (UTF-16).
+ * @param max_dimension Display size the preview must cover.
+ * @param out_info Pointer to a struct to receive the header.
+ * @param out_mip Pointer to a struct to receive the selected level.
+ * @return False if an argument is invalid, or the file cannot be mapped or is not a DDS.
+ */
+bool ReadDdsInfo(const wchar_t* path, int32_t max_dimension, DdsInfo* out_info, DdsMip* out_mip) {
+    if (!path || !out_info || !out_mip) return false;
+    memset(out_info, 0, sizeof(DdsInfo));
+    memset(out_mip, 0, sizeof(DdsMip));
+
+    MappedFile file;
+    DdsDecoder decoder;
+    if (!file.Open(path) || !decoder.Open(file.Data(), file.Size())) return false;
+    *out_info = decoder.Info();
+    *out_mip = decoder.SelectMip(max_dimension);
+    return true;
+}
+
+/**
+ * @brief Decodes one surface straight from the mapping into the caller's buffer. Only the
+ *        pages of the requested level are read, so a small mip of a large texture is cheap.
+ * @param path Path to the .dds file (UTF-16).
+ * @param item Array element or cube face.
+ * @param level Mip level.
+ * @param out_bgra Caller-allocated buffer for the pixels.
+ * @param out_size Size of `out_bgra` in bytes.
+ * @return A HeifError code indicating the result.
+ */
+HeifError DecodeDdsMip(const wchar_t* path, int32_t item, int32_t level, uint8_t* out_bgra, uint64_t out_size) {
+    DecodeReportScope report(1);
+    if (!path || !out_bgra) { return report.Finish(HeifError::InvalidInput); }
+
+    MappedFile file;
+    DdsDecoder decoder;
+    {
+        DecodeReportScope::StageTimer timer(&DecodeReport::open_ns);
+        if (!file.Open(path)) { return report.Finish(HeifError::FileReadError); }
+        if (!decoder.Open(file.Data(), file.Size())) { return report.Finish(HeifError::FileReadError); }
+    }
+    const DdsInfo& info = decoder.Info();
+    if (!info.can_decode) { return report.Finish(HeifError::ImageDecodeError); }
+    if (level < 0 || level >= info.mip_count || item < 0 || item >= info.array_size) {
+        return report.Finish(HeifError::InvalidInput);
+    }
+    const int32_t width = decoder.MipWidth(level);
+    const int32_t height = decoder.MipHeight(level);
+    if (out_size != static_cast<uint64_t>(width) * height * 4) { return report.Finish(HeifError::InvalidInput); }
+
+    {
+        DecodeReportScope::StageTimer timer(&DecodeReport::decode_ns);
+        if (!decoder.Decode(item, level, out_bgra, static_cast<size_t>(width) * 4)) {
+            return report.Finish(HeifError::ImageDecodeError);
+        }
+    }
+    DecodeReportScope::Output(width, height);
+    return report.Finish(HeifError::Ok);
+}
+
+// --- ICO Exports ---
+
+/**
+ * @brief Maps the file and reads the directory and each entry's header; the entry is chosen
+ *        by its real size, so nothing is decoded to find it.
+ * @param path Path to the .ico or .cur file (UTF-16).
+ * @param size Size the entry should cover.
+ * @param out_info Pointer to a struct to receive the result.
+ * @param out_entries Caller-allocated array for the entries, largest first.
+ * @param capacity Length of `out_entries`.
+ * @return False if an argument is invalid, or the file cannot be mapped, is not an ICO or CUR,
+ *         or has no decodable entry.
+ */
+bool ReadIcoInfo(const wchar_t* path, int32_t size, IcoInfo* out_info, IcoEntry* out_entries, int32_t capacity) {
+    if (!path || !out_info || (capacity > 0 && !out_entries)) return false;
+    memset(out_info, 0, sizeof(IcoInfo));
+
+    MappedFile file;
+    IcoDecoder decoder;
+    if (!file.Open(path) || !decoder.Open(file.Data(), file.Size())) return false;
+    const int32_t selected = decoder.SelectEntry(size);
+    if (selected < 0) return false;
+
+    out_info->type = decoder.Type();
+    out_info->entry_count = decoder.EntryCount();
+    out_info->selected = selected;
+    out_info->width = decoder.Entry(selected).width;
+    out_info->height = decoder.Entry(selected).height;
+    const std::vector<int32_t> order = decoder.LargestFirst();
+    for (int32_t i = 0; i < capacity && i < decoder.EntryCount(); ++i) out_entries[i] = decoder.Entry(order[i]);
+    return true;
 }
 
 /**
- * @brief Retrieves the width of the animated AVIF canvas.
- * @param handle Opaque handle to the `AnimatedAvifReader` context.
- * @return The width in pixels, or 0 if invalid.
+ * @brief Decodes one entry straight from the mapping into the caller's buffer; the other
+ *        entries are not read.
+ * @param path Path to the .ico or .cur file (UTF-16).
+ * @param index Directory index of the entry.
+ * @param out_bgra Caller-allocated buffer for the pixels.
+ * @param out_size Size of `out_bgra` in bytes.
+ * @return A HeifError code indicating the result.
  */
-int GetAvifCanvasWidth(void* handle) {
+HeifError DecodeIcoEntry(const wchar_t* path, int32_t index, uint8_t* out_bgra, uint64_t out_size) {
+    DecodeReportScope report(1);
+    if (!path || !out_bgra) { return report.Finish(HeifError::InvalidInput); }
+
+    MappedFile file;
+    IcoDecoder decoder;
+    {
+        DecodeReportScope::StageTimer timer(&DecodeReport::open_ns);
+        if (!file.Open(path)) { return report.Finish(HeifError::FileReadError); }
+        if (!decoder.Open(file.Data(), file.Size())) { return report.Finish(HeifError::FileReadError); }
+    }
+    if (index < 0 || index >= decoder.EntryCount()) { return report.Finish(HeifError::InvalidInput); }
+    const IcoEntry& entry = decoder.Entry(index);
+    if (!entry.can_decode) { return report.Finish(HeifError::ImageDecodeError); }
+    if (out_size != static_cast<uint64_t>(entry.width) * entry.height * 4) { return report.Finish(HeifError::InvalidInput); }
+
+    {
+        DecodeReportScope::StageTimer timer(&DecodeReport::decode_ns);
+        // The caller's buffer is a managed byte array, which is at least 4-byte aligned.
+        if (!decoder.Decode(index, reinterpret_cast<uint32_t*>(out_bgra))) { return report.Finish(HeifError::ImageDecodeError); }
+    }
+    DecodeReportScope::Output(entry.width, entry.height);
+    return report.Finish(HeifError::Ok);
+}
+
+// --- TIFF Exports ---
+
+namespace {
+    /// The mapping and the index built over it live and die together.
+    struct TiffFile {
+        MappedFile file;
+        TiffDecoder decoder;
+    };
+}
+
+/**
+ * @brief Maps the file and walks every directory in it; no pixel data is read.
+ * @param path Path to the .tif or .tiff file (UTF-16).
+ * @return An opaque handle to the `TiffFile`, or nullptr on failure.
+ */
+void* OpenTiff(const wchar_t* path) {
+    if (!path) return nullptr;
+    auto tiff = new TiffFile();
+    if (!tiff->file.Open(path) || !tiff->decoder.Open(tiff->file.Data(), tiff->file.Size())) {
+        delete tiff;
+        return nullptr;
+    }
+    return tiff;
+}
+
+/**
+ * @brief Retrieves the number of pages in an open TIFF.
+ * @param handle Opaque handle to the `TiffFile`.
+ * @return The number of pages, or 0 if invalid.
+ */
+int32_t GetTiffPageCount(void* handle) {
     if (!handle) return 0;
-    return static_cast<AnimatedAvifReader*>(handle)->GetWidth();
+    return static_cast<TiffFile*>(handle)->decoder.PageCount();
+}
+
+/**
+ * @brief Describes a page and selects its level for a display size from the index alone.
+ * @param handle Opaque handle to the `TiffFile`.
+ * @param page Page index.
+ * @param max_dimension Display size the level must cover; 0 or less selects the page itself.
+ * @param out_page Pointer to a struct to receive the page description.
+ * @param out_level Pointer to a struct to receive the selected level.
+ * @return False if an argument is invalid.
+ */
+bool GetTiffPageInfo(void* handle, int32_t page, int32_t max_dimension, TiffPageInfo* out_page, TiffLevel* out_level) {
+    if (!handle || !out_page || !out_level) return false;
+    const TiffDecoder& decoder = static_cast<TiffFile*>(handle)->decoder;
+    if (page < 0 || page >= decoder.PageCount()) return false;
+    *out_page = decoder.PageInfo(page);
+    *out_level = decoder.SelectLevel(page, max_dimension);
+    return true;
+}
+
+/**
+ * @brief Decodes one level of one page from the mapping into the caller's buffer, its strips or
+ *        tiles shared between cores.
+ * @param handle Opaque handle to the `TiffFile`.
+ * @param page Page index.
+ * @param level Level; 0 is the page at full resolution.
+ * @param out_bgra Caller-allocated buffer for the pixels.
+ * @param out_size Size of `out_bgra` in bytes.
+ * @return A HeifError code indicating the result.
+ */
+HeifError DecodeTiffPage(void* handle, int32_t page, int32_t level, uint8_t* out_bgra, uint64_t out_size) {
+    DecodeReportScope report(1);
+    if (!handle || !out_bgra) { return report.Finish(HeifError::InvalidInput); }
+
+    const TiffDecoder& decoder = static_cast<TiffFile*>(handle)->decoder;
+    const TiffLevel info = decoder.Level(page, level);
+    if (info.level < 0) { return report.Finish(HeifError::InvalidInput); }
+    if (!info.can_decode) { return report.Finish(HeifError::ImageDecodeError); }
+    if (out_size != static_cast<uint64_t>(info.width) * info.height * 4) { return report.Finish(HeifError::InvalidInput); }
+
+    {
+        DecodeReportScope::StageTimer timer(&DecodeReport::decode_ns);
+        if (!decoder.Decode(page, level, out_bgra, static_cast<size_t>(info.width) * 4)) { return report.Finish(HeifError::ImageDecodeError); }
+    }
+    DecodeReportScope::Output(info.width, info.height);
+    return report.Finish(HeifError::Ok);
+}
+
+/**
+ * @brief Unmaps the TIFF and releases the handle.
+ * @param handle Opaque handle to the `TiffFile`.
+ */
+void CloseTiff(void* handle) {
+    if (handle) {
+        delete static_cast<TiffFile*>(handle);
+    }
+}
+
+// --- JPEG Exports ---
+
+/**
+ * @brief Maps the file and reads the markers before the first scan; no pixels are decoded.
+ * @param path Path to the .jpg file (UTF-16).
+ * @param max_dimension Display size the output must cover.
+ * @param out_info Pointer to a struct to receive the result.
+ * @param out_scale Pointer to a struct to receive the selected source.
+ * @return True on success.
+ */
+bool ReadJpegInfo(const wchar_t* path, int32_t max_dimension, JpegInfo* out_info, JpegScale* out_scale) {
+    if (!path || !out_info || !out_scale) return false;
+    memset(out_info, 0, sizeof(JpegInfo));
+    memset(out_scale, 0, sizeof(JpegScale));
+
+    MappedFile file;
+    JpegDecoder decoder;
+    if (!file.Open(path) || !decoder.Open(file.Data(), file.Size())) return false;
+    *out_info = decoder.Info();
+    *out_scale = decoder.SelectScale(max_dimension);
+    return true;
+}
+
+/**
+ * @brief Decodes from the mapping into the caller's buffer, in restart-marker bands across the
+ *        cores when the image has them.
+ * @param path Path to the .jpg file (UTF-16).
+ * @param thumbnail 1 for the EXIF thumbnail.
+ * @param denominator IDCT scale.
+ * @param out_bgra Caller-allocated buffer for the pixels.
+ * @param out_size Size of `out_bgra` in bytes.
+ * @return A HeifError code indicating the result.
+ */
+HeifError DecodeJpeg(const wchar_t* path, int32_t thumbnail, int32_t denominator, uint8_t* out_bgra, uint64_t out_size) {
+    DecodeReportScope report(1);
+    if (!path || !out_bgra) { return report.Finish(HeifError::InvalidInput); }
+
+    MappedFile file;
+    JpegDecoder decoder;
+    {
+        DecodeReportScope::StageTimer timer(&DecodeReport::open_ns);
+        if (!file.Open(path)) { return report.Finish(HeifError::FileReadError); }
+        if (!decoder.Open(file.Data(), file.Size())) { return report.Finish(HeifError::FileReadError); }
+    }
+    const JpegScale scale = decoder.Resolve(thumbnail, denominator);
+    if (scale.width == 0) { return report.Finish(HeifError::ImageDecodeError); }
+    if (out_size != static_cast<uint64_t>(scale.width) * scale.height * 4) { return report.Finish(HeifError::InvalidInput); }
+
+    {
+        DecodeReportScope::StageTimer timer(&DecodeReport::decode_ns);
+        if (!decoder.Decode(scale, out_bgra, static_cast<size_t>(scale.width) * 4)) {
+            return report.Finish(HeifError::ImageDecodeError);
+        }
+    }
+    DecodeReportScope::Output(scale.width, scale.height);
+    return report.Finish(HeifError::Ok);
 }
 
 /**
- * @brief Retrieves the height of the animated AVIF canvas.
- * @param handle Opaque handle to the `AnimatedAvifReader` context.
- * @return The height in pixels, or 0 if invalid.
+ * @brief Reads an image's dimensions and orientation from its header without decoding any pixels.
+ * @param path Path to the image file (UTF-16).
+ * @param out_info Pointer to a struct to receive the probe result.
+ * @return True if the format was recognised and the size was read, false otherwise.
  */
-int GetAvifCanvasHeight(void* handle) {
+bool ProbeImage(const wchar_t* path, ImageProbeInfo* out_info) {
+    if (!path || !out_info) return false;
+    return ImageProbe::ProbeFile(path, *out_info);
+}
+
+/**
+ * @brief Probes many files in parallel on a small pool of worker threads.
+ * @param paths Array of `count` UTF-16 paths.
+ * @param count Number of entries in `paths` and `out_infos`.
+ * @param out_infos Caller-allocated array of `count` structs.
+ * @return The number of files successfully probed.
+ */
+int ProbeImageBatch(const wchar_t* const* paths, int count, ImageProbeInfo* out_infos) {
+    if (!paths || !out_infos || count <= 0) return 0;
+    return ImageProbe::ProbeBatch(paths, static_cast<size_t>(count), out_infos);
+}
+
+/**
+ * @brief Refreshes the metadata index of a folder and opens it for lookups.
+ * @param folder The folder to index (UTF-16).
+ * @param index_file Path of the index file.
+ * @param extensions Array of extensions including the dot.
+ * @param extension_count Number of entries in `extensions`.
+ * @param out_stats Optional refresh counters.
+ * @return An opaque handle to the `FolderIndex`, or nullptr on failure.
+ */
+void* OpenFolderIndex(const wchar_t* folder, const wchar_t* index_file, const wchar_t* const* extensions, int extension_count, FolderIndexRefreshStats* out_stats) {
+    if (!folder || !index_file || !extensions || extension_count <= 0) return nullptr;
+    if (out_stats) memset(out_stats, 0, sizeof(FolderIndexRefreshStats));
+
+    auto index = new FolderIndex();
+    if (!index->Refresh(folder, index_file, LowerExtensions(extensions, extension_count), out_stats)) {
+        delete index;
+        return nullptr;
+    }
+    return index;
+}
+
+/**
+ * @brief Retrieves the number of files in an open folder index.
+ * @param handle Opaque handle to the `FolderIndex`.
+ * @return The number of entries, or 0 if invalid.
+ */
+int GetFolderIndexCount(void* handle) {
     if (!handle) return 0;
-    return static_cast<AnimatedAvifReader*>(handle)->GetHeight();
+    return static_cast<int>(static_cast<FolderIndex*>(handle)->Count());
+}
+
+/**
+ * @brief Looks up one file in an open folder index.
+ * @param handle Opaque handle to the `FolderIndex`.
+ * @param file_name The file name without its directory (UTF-16).
+ * @param out_entry Pointer to a struct to receive the entry.
+ * @return True if the file is in the index, false otherwise.
+ */
+bool LookupFolderIndexEntry(void* handle, const wchar_t* file_name, FolderIndexEntry* out_entry) {
+    if (!handle || !file_name || !out_entry) return false;
+    memset(out_entry, 0, sizeof(FolderIndexEntry));
+
+    const std::string name = std::filesystem::path(file_name).u8string();
+    const FolderIndexEntry* entry = static_cast<FolderIndex*>(handle)->Find(name);
+    if (!entry) return false;
+    *out_entry = *entry;
+    return true;
+}
+
+/**
+ * @brief Unmaps the folder index and releases the handle.
+ * @param handle Opaque handle to the `FolderIndex`.
+ */
+void CloseFolderIndex(void* handle) {
+    if (handle) {
+        delete static_cast<FolderIndex*>(handle);
+    }
+}
+
+// --- Thumbnail Store Exports ---
+
+/**
+ * @brief Opens the persistent thumbnail store.
+ * @param folder Directory for the index and segment files (UTF-16).
+ * @param max_bytes Live bytes above which eviction runs.
+ * @param max_entries Entry count above which eviction runs.
+ * @return An opaque handle to the `ThumbnailStore`, or nullptr on failure.
+ */
+void* OpenThumbnailStore(const wchar_t* folder, uint64_t max_bytes, uint32_t max_entries) {
+    if (!folder) return nullptr;
+    auto store = new ThumbnailStore();
+    if (!store->Open(folder, max_bytes, max_entries)) {
+        delete store;
+        return nullptr;
+    }
+    return store;
+}
+
+/**
+ * @brief Looks up a thumbnail. The view points into the store's mapping; nothing is copied.
+ * @param handle Opaque handle to the `ThumbnailStore`.
+ * @param path The source file path (UTF-16).
+ * @param mtime The source file's last write time.
+ * @param out_view Pointer to a struct to receive the view.
+ * @return True on a hit.
+ */
+bool GetThumbnail(void* handle, const wchar_t* path, int64_t mtime, ThumbnailView* out_view) {
+    if (!handle || !path || !out_view) return false;
+    memset(out_view, 0, sizeof(ThumbnailView));
+    return static_cast<ThumbnailStore*>(handle)->Get(WStringToString(path), mtime, *out_view);
+}
+
+/**
+ * @brief Fingerprints the file and looks the fingerprint up with `mtime`. A hit queues an alias for `path`.
+ * @param handle Opaque handle to the `ThumbnailStore`.
+ * @param path The source file path (UTF-16).
+ * @param mtime The source file's current last write time.
+ * @param out_view Receives the view on a hit.
+ * @return True on a hit.
+ */
+bool GetThumbnailByContent(void* handle, const wchar_t* path, int64_t mtime, ThumbnailView* out_view) {
+    if (!out_view) return false;
+    memset(out_view, 0, sizeof(ThumbnailView));
+    if (!handle || !path) return false;
+    auto* store = static_cast<ThumbnailStore*>(handle);
+    const uint64_t fingerprint = ContentFingerprint::ComputeFile(path);
+    if (!fingerprint || !store->GetByFingerprint(fingerprint, mtime, *out_view)) return false;
+    store->Alias(WStringToString(path), mtime, fingerprint);
+    return true;
+}
+
+/**
+ * @brief Releases a view returned by GetThumbnail() or GetThumbnailByContent().
+ * @param handle Opaque handle to the `ThumbnailStore`.
+ * @param view The view to release.
+ */
+void ReleaseThumbnailView(void* handle, const ThumbnailView* view) {
+    if (!handle || !view) return;
+    static_cast<ThumbnailStore*>(handle)->Release(*view);
+}
+
+/**
+ * @brief Queues a thumbnail for writing.
+ * @param handle Opaque handle to the `ThumbnailStore`.
+ * @param path The source file path (UTF-16).
+ * @param mtime The source file's last write time.
+ * @param data The encoded thumbnail.
+ * @param size Number of bytes in `data`.
+ * @param width Width stored with the entry.
+ * @param height Height stored with the entry.
+ * @return True if the write was queued.
+ */
+bool PutThumbnail(void* handle, const wchar_t* path, int64_t mtime, const uint8_t* data, uint32_t size, int32_t width, int32_t height) {
+    if (!handle || !path || !data || size == 0) return false;
+    return static_cast<ThumbnailStore*>(handle)->Put(WStringToString(path), mtime, data, size, width, height);
+}
+
+/**
+ * @brief Encodes a preview and its levels with BlockEncoder on the calling thread and queues the result,
+ *        keyed by path and by the file's content fingerprint.
+ * @param handle Opaque handle to the `ThumbnailStore`.
+ * @param path The source file path (UTF-16).
+ * @param mtime The source file's last write time.
+ * @param bgra Premultiplied BGRA8 pixels.
+ * @param preview_width Width of `bgra` in pixels.
+ * @param preview_height Height of `bgra` in pixels.
+ * @param stride Bytes per row of `bgra`.
+ * @param tile_size Edge of the thumbnail-strip tile; 0 for none.
+ * @param width Width stored with the entry.
+ * @param height Height stored with the entry.
+ * @return True if the write was queued.
+ */
+bool PutCompressedThumbnail(void* handle, const wchar_t* path, int64_t mtime, const uint8_t* bgra,
+                            int32_t preview_width, int32_t preview_height, int32_t stride,
+                            int32_t tile_size, int32_t width, int32_t height) {
+    if (!handle || !path || !bgra) return false;
+    std::vector<uint8_t> blob;
+    if (!BlockEncoder::EncodePreview(bgra, preview_width, preview_height, stride, tile_size, blob)) return false;
+    const uint64_t fingerprint = ContentFingerprint::ComputeFile(path);
+    return static_cast<ThumbnailStore*>(handle)->Put(WStringToString(path), mtime, std::move(blob), width, height, fingerprint);
+}
+
+/**
+ * @brief Picks the level of a block-compressed thumbnail nearest a drawing size.
+ * @param view The view holding the blob.
+ * @param edge Longest edge the image will be drawn at, in pixels.
+ * @param tile True to get the thumbnail-strip tile.
+ * @param out_level Receives the level.
+ * @return True if a level was found.
+ */
+bool FindThumbnailLevel(const ThumbnailView* view, int32_t edge, bool tile, BlockPreviewLevel* out_level) {
+    if (!view || !out_level) return false;
+    memset(out_level, 0, sizeof(BlockPreviewLevel));
+    return BlockEncoder::FindLevel(view->data, view->size, edge, tile, *out_level);
+}
+
+/**
+ * @brief Blocks until every queued write is committed.
+ * @param handle Opaque handle to the `ThumbnailStore`.
+ */
+void FlushThumbnailStore(void* handle) {
+    if (handle) static_cast<ThumbnailStore*>(handle)->Flush();
+}
+
+/**
+ * @brief Removes every entry from the store.
+ * @param handle Opaque handle to the `ThumbnailStore`.
+ */
+void ClearThumbnailStore(void* handle) {
+    if (handle) static_cast<ThumbnailStore*>(handle)->Clear();
+}
+
+/**
+ * @brief Retrieves the store's counters.
+ * @param handle Opaque handle to the `ThumbnailStore`.
+ * @param out_stats Pointer to a struct to receive the counters.
+ * @return True on success, false if the handle is invalid.
+ */
+bool GetThumbnailStoreStats(void* handle, ThumbnailStoreStats* out_stats) {
+    if (!handle || !out_stats) return false;
+    static_cast<ThumbnailStore*>(handle)->GetStats(*out_stats);
+    return true;
+}
+
+/**
+ * @brief Closes the store and releases the handle.
+ * @param handle Opaque handle to the `ThumbnailStore`.
+ */
+void CloseThumbnailStore(void* handle) {
+    if (handle) {
+        delete static_cast<ThumbnailStore*>(handle);
+    }
+}
+
+// --- Thumbnail Atlas Exports ---
+
+/**
+ * @brief Creates a thumbnail atlas.
+ * @param slot_size Edge of a slot in pixels.
+ * @param columns Slots per row.
+ * @param rows Rows of slots.
+ * @return An opaque handle to the `ThumbnailAtlas`, or nullptr on invalid arguments.
+ */
+void* CreateThumbnailAtlas(int32_t slot_size, int32_t columns, int32_t rows) {
+    if (slot_size <= 0 || columns <= 0 || rows <= 0 || slot_size > 1024 || columns * slot_size > 16384 || rows * slot_size > 16384) {
+        return nullptr;
+    }
+    return new ThumbnailAtlas(slot_size, columns, rows);
+}
+
+/**
+ * @brief Looks up the slot of a thumbnail.
+ * @param handle Opaque handle to the `ThumbnailAtlas`.
+ * @param key Identity of the thumbnail.
+ * @return The slot index, or -1.
+ */
+int32_t FindAtlasSlot(void* handle, uint64_t key) {
+    if (!handle) return -1;
+    return static_cast<ThumbnailAtlas*>(handle)->Find(key);
+}
+
+/**
+ * @brief Inserts BGRA pixels into the atlas.
+ * @param handle Opaque handle to the `ThumbnailAtlas`.
+ * @param key Identity of the thumbnail.
+ * @param bgra Premultiplied BGRA8 pixels.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @param stride Bytes per row.
+ * @return The slot index, or -1.
+ */
+int32_t InsertAtlasPixels(void* handle, uint64_t key, const uint8_t* bgra, int32_t width, int32_t height, int32_t stride) {
+    if (!handle) return -1;
+    return static_cast<ThumbnailAtlas*>(handle)->Insert(key, bgra, width, height, stride);
+}
+
+/**
+ * @brief Inserts BC1/BC3 blocks into the atlas.
+ * @param handle Opaque handle to the `ThumbnailAtlas`.
+ * @param key Identity of the thumbnail.
+ * @param format A BlockFormat value.
+ * @param blocks Block data.
+ * @param size Bytes of block data.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @return The slot index, or -1.
+ */
+int32_t InsertAtlasBlocks(void* handle, uint64_t key, int32_t format, const uint8_t* blocks, uint32_t size, int32_t width, int32_t height) {
+    if (!handle) return -1;
+    if (format != static_cast<int32_t>(BlockFormat::Bc1) && format != static_cast<int32_t>(BlockFormat::Bc3)) return -1;
+    return static_cast<ThumbnailAtlas*>(handle)->InsertBlocks(key, static_cast<BlockFormat>(format), blocks, size, width, height);
+}
+
+/**
+ * @brief Gets the pixel rectangle of a slot.
+ * @param handle Opaque handle to the `ThumbnailAtlas`.
+ * @param slot The slot index.
+ * @param out_rect Receives the rectangle.
+ * @return True on success.
+ */
+bool GetAtlasSlotRect(void* handle, int32_t slot, AtlasRect* out_rect) {
+    if (!handle || !out_rect) return false;
+    memset(out_rect, 0, sizeof(AtlasRect));
+    auto atlas = static_cast<ThumbnailAtlas*>(handle);
+    if (slot < 0 || slot >= atlas->Capacity()) return false;
+    *out_rect = atlas->SlotRect(slot);
+    return true;
+}
+
+/**
+ * @brief Retrieves and clears the dirty areas of the atlas.
+ * @param handle Opaque handle to the `ThumbnailAtlas`.
+ * @param out_rects Receives the rectangles.
+ * @param max_rects Capacity of `out_rects`.
+ * @return The number of rectangles written.
+ */
+int32_t TakeAtlasDirtyRects(void* handle, AtlasRect* out_rects, int32_t max_rects) {
+    if (!handle || !out_rects || max_rects <= 0) return 0;
+    auto atlas = static_cast<ThumbnailAtlas*>(handle);
+    const std::vector<AtlasRect> rects = atlas->TakeDirty();
+    if (rects.size() > static_cast<size_t>(max_rects)) {
+        out_rects[0] = { 0, 0, atlas->Width(), atlas->Height() };
+        return 1;
+    }
+    std::copy(rects.begin(), rects.end(), out_rects);
+    return static_cast<int32_t>(rects.size());
+}
+
+/**
+ * @brief Copies a rectangle of the atlas into a packed buffer.
+ * @param handle Opaque handle to the `ThumbnailAtlas`.
+ * @param rect The rectangle.
+ * @param dst Destination buffer.
+ * @param dst_size Size of `dst` in bytes.
+ * @return True on success.
+ */
+bool CopyAtlasRect(void* handle, const AtlasRect* rect, uint8_t* dst, uint32_t dst_size) {
+    if (!handle || !rect || !dst) return false;
+    return static_cast<ThumbnailAtlas*>(handle)->CopyRect(*rect, dst, dst_size);
+}
+
+/**
+ * @brief Clears the atlas.
+ * @param handle Opaque handle to the `ThumbnailAtlas`.
+ */
+void ClearThumbnailAtlas(void* handle) {
+    if (handle) static_cast<ThumbnailAtlas*>(handle)->Clear();
+}
+
+/**
+ * @brief Frees the atlas.
+ * @param handle Opaque handle to the `ThumbnailAtlas`.
+ */
+void DestroyThumbnailAtlas(void* handle) {
+    if (handle) {
+        delete static_cast<ThumbnailAtlas*>(handle);
+    }
+}
+
+/**
+ * @brief Creates a cache warmer over an open thumbnail store.
+ * @param store Opaque handle to the `ThumbnailStore`.
+ * @param hooks The owner's callbacks.
+ * @return An opaque handle to the `CacheWarmer`, or nullptr on invalid input.
+ */
+void* CreateCacheWarmer(void* store, const CacheWarmHooks* hooks) {
+    if (!store || !hooks || !hooks->generate) return nullptr;
+    return new CacheWarmer(*static_cast<ThumbnailStore*>(store), *hooks);
+}
+
+/**
+ * @brief Starts warming a folder.
+ * @param handle Opaque handle to the `CacheWarmer`.
+ * @param root The folder to warm (UTF-16).
+ * @param extensions Array of extensions including the dot.
+ * @param extension_count Number of entries in `extensions`.
+ * @param checkpoint_file Checkpoint path, or nullptr.
+ * @param options Run options, or nullptr.
+ * @return True if the run started.
+ */
+bool StartCacheWarmer(void* handle, const wchar_t* root, const wchar_t* const* extensions, int extension_count,
+                      const wchar_t* checkpoint_file, const CacheWarmOptions* options) {
+    if (!handle || !root || !extensions || extension_count <= 0) return false;
+    const CacheWarmOptions defaults{};
+    return static_cast<CacheWarmer*>(handle)->Start(root, LowerExtensions(extensions, extension_count),
+        checkpoint_file ? std::filesystem::path(checkpoint_file) : std::filesystem::path(), options ? *options : defaults);
+}
+
+/**
+ * @brief Pauses the warmer.
+ * @param handle Opaque handle to the `CacheWarmer`.
+ */
+void PauseCacheWarmer(void* handle) {
+    if (handle) static_cast<CacheWarmer*>(handle)->Pause();
+}
+
+/**
+ * @brief Resumes the warmer.
+ * @param handle Opaque handle to the `CacheWarmer`.
+ */
+void ResumeCacheWarmer(void* handle) {
+    if (handle) static_cast<CacheWarmer*>(handle)->Resume();
+}
+
+/**
+ * @brief Stops the warmer and waits for its threads.
+ * @param handle Opaque handle to the `CacheWarmer`.
+ */
+void StopCacheWarmer(void* handle) {
+    if (handle) static_cast<CacheWarmer*>(handle)->Stop();
+}
+
+/**
+ * @brief Gets the warmer's progress.
+ * @param handle Opaque handle to the `CacheWarmer`.
+ * @param out_progress Receives the counters.
+ * @return True on success.
+ */
+bool GetCacheWarmerProgress(void* handle, CacheWarmProgress* out_progress) {
+    if (!out_progress) return false;
+    memset(out_progress, 0, sizeof(CacheWarmProgress));
+    if (!handle) return false;
+    static_cast<CacheWarmer*>(handle)->GetProgress(*out_progress);
+    return true;
 }
 
 /**
- * @brief Decodes the next sequence frame into a pre-allocated BGRA buffer and returns its duration in ms.
- * @param handle Opaque handle to the `AnimatedAvifReader` context.
- * @param out_bgra_buffer A pre-allocated buffer of size Width * Height * 4. This ensures a 0-allocation decode path.
- * @return The duration of the decoded frame in ms, or 0 if EOF or an error occurred.
+ * @brief Stops and frees the warmer.
+ * @param handle Opaque handle to the `CacheWarmer`.
  */
-int DecodeNextAvifFrame(void* handle, uint8_t* out_bgra_buffer) {
-    if (!handle || !out_bgra_buffer) return 0;
-    return static_cast<AnimatedAvifReader*>(handle)->DecodeNextFrame(out_bgra_buffer);
+void DestroyCacheWarmer(void* handle) {
+    if (handle) {
+        delete static_cast<CacheWarmer*>(handle);
+    }
+}
+
+/**
+ * @brief Creates a prefetch scheduler.
+ * @param hooks Load and release callbacks.
+ * @param options Scheduler options, or nullptr.
+ * @return Opaque handle, or nullptr on invalid input.
+ */
+void* CreatePrefetchScheduler(const PrefetchHooks* hooks, const PrefetchOptions* options) {
+    if (!hooks || !hooks->load || !hooks->release) return nullptr;
+    const PrefetchOptions defaults{};
+    return new PrefetchScheduler(*hooks, options ? *options : defaults);
+}
+
+/**
+ * @brief Starts the scheduler's workers.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ */
+void StartPrefetchScheduler(void* handle) {
+    if (handle) static_cast<PrefetchScheduler*>(handle)->Start();
+}
+
+/**
+ * @brief Moves the prefetch window.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ * @param window The new window.
+ * @param keys Keys in window order.
+ * @param count Number of keys.
+ */
+void MovePrefetchWindow(void* handle, const PrefetchWindow* window, const int32_t* keys, int count) {
+    if (!handle || !window) return;
+    static_cast<PrefetchScheduler*>(handle)->MoveWindow(*window, count > 0 ? keys : nullptr, count);
+}
+
+/**
+ * @brief Ends a navigation burst.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ */
+void EndPrefetchBurst(void* handle) {
+    if (handle) static_cast<PrefetchScheduler*>(handle)->EndBurst();
+}
+
+/**
+ * @brief Queues a disk-cache write.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ * @param key The photo key.
+ */
+void QueuePrefetchDiskWrite(void* handle, int32_t key) {
+    if (handle) static_cast<PrefetchScheduler*>(handle)->QueueDiskWrite(key);
+}
+
+/**
+ * @brief Records a result loaded by the owner.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ * @param key The photo key.
+ * @param tier A PrefetchTier value.
+ * @param bytes Memory the result holds.
+ */
+void MarkPrefetchLoaded(void* handle, int32_t key, int32_t tier, uint64_t bytes) {
+    if (handle) static_cast<PrefetchScheduler*>(handle)->MarkLoaded(key, static_cast<PrefetchTier>(tier), bytes);
+}
+
+/**
+ * @brief Forgets a result freed by the owner.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ * @param key The photo key.
+ * @param tier A PrefetchTier value.
+ */
+void UnloadPrefetch(void* handle, int32_t key, int32_t tier) {
+    if (handle) static_cast<PrefetchScheduler*>(handle)->Unload(key, static_cast<PrefetchTier>(tier));
+}
+
+/**
+ * @brief Sets the expected size of a key's HQ bitmap.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ * @param key The photo key.
+ * @param bytes Decoded size in bytes.
+ */
+void SetPrefetchHqSizeHint(void* handle, int32_t key, uint64_t bytes) {
+    if (handle) static_cast<PrefetchScheduler*>(handle)->SetHqSizeHint(key, bytes);
+}
+
+/**
+ * @brief Forgets every result of a key.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ * @param key The photo key.
+ */
+void ForgetPrefetchKey(void* handle, int32_t key) {
+    if (handle) static_cast<PrefetchScheduler*>(handle)->Forget(key);
+}
+
+/**
+ * @brief Checks whether a result is loaded.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ * @param key The photo key.
+ * @param tier A PrefetchTier value.
+ * @return True if loaded.
+ */
+bool IsPrefetchLoaded(void* handle, int32_t key, int32_t tier) {
+    return handle && static_cast<PrefetchScheduler*>(handle)->IsLoaded(key, static_cast<PrefetchTier>(tier));
 }
 
 /**
- * @brief Resets the animation track to the beginning to loop the animation continuously.
- * @param handle Opaque handle to the `AnimatedAvifReader` context.
+ * @brief Counts loaded results around a key.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ * @param tier A PrefetchTier value.
+ * @param pivot The key to count around.
+ * @param out_below Receives the count below.
+ * @param out_above Receives the count above.
+ * @return True on success.
  */
-void ResetAvifAnimation(void* handle) {
-    if (!handle) return;
-    static_cast<AnimatedAvifReader*>(handle)->Reset();
+bool CountPrefetchLoaded(void* handle, int32_t tier, int32_t pivot, int32_t* out_below, int32_t* out_above) {
+    if (!out_below || !out_above) return false;
+    *out_below = *out_above = 0;
+    if (!handle) return false;
+    static_cast<PrefetchScheduler*>(handle)->CountLoaded(static_cast<PrefetchTier>(tier), pivot, *out_below, *out_above);
+    return true;
+}
+
+/**
+ * @brief Gets the scheduler's counters.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ * @param out_stats Receives the counters.
+ * @return True on success.
+ */
+bool GetPrefetchStats(void* handle, PrefetchStats* out_stats) {
+    if (!out_stats) return false;
+    memset(out_stats, 0, sizeof(PrefetchStats));
+    if (!handle) return false;
+    static_cast<PrefetchScheduler*>(handle)->GetStats(*out_stats);
+    return true;
 }
 
 /**
- * @brief Closes the animation and releases all libheif associated memory for the given context.
- * @param handle Opaque handle to the `AnimatedAvifReader` context.
+ * @brief Keeps queued loads from starting without waiting for the loads in progress.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
  */
-void CloseAvifAnimation(void* handle) {
+void CancelPrefetchScheduler(void* handle) {
+    if (handle) static_cast<PrefetchScheduler*>(handle)->Cancel();
+}
+
+/**
+ * @brief Stops and frees the scheduler.
+ * @param handle Opaque handle to the `PrefetchScheduler`.
+ */
+void DestroyPrefetchScheduler(void* handle) {
+    if (handle) {
+        delete static_cast<PrefetchScheduler*>(handle);
+    }
+}
+
+/**
+ * @brief Creates a navigation predictor.
+ * @param preview_radius The configured preview radius.
+ * @param hq_radius The configured HQ radius.
+ * @return An opaque handle.
+ */
+void* CreateNavigationPredictor(int32_t preview_radius, int32_t hq_radius) {
+    return new NavigationPredictor(preview_radius, hq_radius);
+}
+
+/**
+ * @brief Records a navigation and gets the resulting plan.
+ * @param handle Opaque handle to the `NavigationPredictor`.
+ * @param event The navigation.
+ * @param preview_radius The configured preview radius.
+ * @param hq_radius The configured HQ radius.
+ * @param out_plan Receives the plan.
+ * @return True on success.
+ */
+bool RecordNavigation(void* handle, const NavigationEvent* event, int32_t preview_radius, int32_t hq_radius,
+                      PrefetchPlan* out_plan) {
+    if (!out_plan) return false;
+    memset(out_plan, 0, sizeof(PrefetchPlan));
+    if (!handle || !event) return false;
+    auto* predictor = static_cast<NavigationPredictor*>(handle);
+    predictor->SetRadii(preview_radius, hq_radius);
+    *out_plan = predictor->Record(*event);
+    return true;
+}
+
+/**
+ * @brief Forgets the navigation history.
+ * @param handle Opaque handle to the `NavigationPredictor`.
+ */
+void ResetNavigationPredictor(void* handle) {
+    if (handle) static_cast<NavigationPredictor*>(handle)->Reset();
+}
+
+/**
+ * @brief Frees the predictor.
+ * @param handle Opaque handle to the `NavigationPredictor`.
+ */
+void DestroyNavigationPredictor(void* handle) {
     if (handle) {
-        delete static_cast<AnimatedAvifReader*>(handle);
+        delete static_cast<NavigationPredictor*>(handle);
     }
-}
\ No newline at end of file
+}
+
+namespace {
+
+    /**
+     * @brief Startup decoder hook: the embedded thumbnail of a HEIF or AVIF file. Other formats
+     *        have no preview cheaper than the managed readers' and are left to them.
+     */
+    bool DecodeStartupPreview(const std::filesystem::path& path, const ImageProbeInfo& probe, StartupPixels& out) {
+        const auto format = static_cast<ImageFormat>(probe.format);
+        if (format != ImageFormat::Heif && format != ImageFormat::Avif) return false;
+        HeifReader reader;
+        PixelBuffer buffer{};
+        if (reader.ExtractThumbnail(path.u8string(), buffer) != HeifError::Ok) return false;
+        out.data = buffer.data;
+        out.size = buffer.dataSize;
+        out.width = buffer.width;
+        out.height = buffer.height;
+        out.full_width = buffer.primaryImageWidth;
+        out.full_height = buffer.primaryImageHeight;
+        return true;
+    }
+}
+
+/**
+ * @brief Starts the speculative load of the launch photo.
+ * @param path The launch photo (UTF-16).
+ * @param store_folder The thumbnail store's folder (UTF-16), or nullptr.
+ * @param options Steps and store limits.
+ * @return True if the load was started.
+ */
+bool BeginStartupPreview(const wchar_t* path, const wchar_t* store_folder, const StartupPreviewOptions* options) {
+    if (!path || !options) return false;
+    return StartupPreview::Instance().Begin(path, store_folder ? std::filesystem::path(store_folder) : std::filesystem::path(),
+                                            *options, &DecodeStartupPreview);
+}
+
+/**
+ * @brief Takes over the store opened by the startup load, waiting for the open to finish.
+ * @return An opaque handle to the `ThumbnailStore`, or nullptr.
+ */
+void* ClaimStartupThumbnailStore() {
+    return StartupPreview::Instance().ClaimStore().release();
+}
+
+/**
+ * @brief Takes the result of the startup load.
+ * @param path The photo about to be displayed (UTF-16).
+ * @param timeout_ms How long to wait for the load.
+ * @param out_result Receives the result.
+ * @return True if a result was claimed.
+ */
+bool ClaimStartupPreview(const wchar_t* path, uint32_t timeout_ms, StartupPreviewResult* out_result) {
+    if (!out_result) return false;
+    memset(out_result, 0, sizeof(StartupPreviewResult));
+    if (!path) return false;
+    return StartupPreview::Instance().Claim(path, std::chrono::milliseconds(timeout_ms), *out_result);
+}
+
+/**
+ * @brief Frees the pixels of a claimed result.
+ * @param result The claimed result.
+ */
+void FreeStartupPreview(StartupPreviewResult* result) {
+    if (result) StartupPreview::FreePixels(result->pixels);
+}
+
+/**
+ * @brief Gives up on the unclaimed parts of the startup load.
+ */
+void EndStartupPreview() {
+    StartupPreview::Instance().End();
+}
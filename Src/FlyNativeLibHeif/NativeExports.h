@@ -14,6 +14,23 @@
 #include <Windows.h>
 #include <cstdint> // For uint8_t
 #include "HeifReader.h" // Provides HeifError and PixelBuffer definitions
+#include "ImageProbe.h" // Provides ImageProbeInfo
+#include "FolderIndex.h" // Provides FolderIndexEntry and FolderIndexRefreshStats
+#include "FlyHeifApi.h" // Provides FlyHeifApi and the capability flags
+#include "DecodeReport.h" // Provides DecodeReport
+#include "ThumbnailStore.h" // Provides ThumbnailView and ThumbnailStoreStats
+#include "BlockEncoder.h" // Provides BlockPreviewLevel
+#include "ThumbnailAtlas.h" // Provides AtlasRect
+#include "CacheWarmer.h" // Provides CacheWarmHooks, CacheWarmOptions and CacheWarmProgress
+#include "PrefetchScheduler.h" // Provides PrefetchHooks, PrefetchOptions, PrefetchWindow, PrefetchStats and ResidencyStats
+#include "NavigationPredictor.h" // Provides NavigationEvent and PrefetchPlan
+#include "StartupPreview.h" // Provides StartupPreviewOptions and StartupPreviewResult
+#include "AnimationSource.h" // Provides AnimationInfo, AnimationFrameInfo, AnimationRing, AnimationStats and FrameRect
+#include "PsdDecoder.h" // Provides PsdInfo
+#include "DdsDecoder.h" // Provides DdsInfo and DdsMip
+#include "IcoDecoder.h" // Provides IcoInfo and IcoEntry
+#include "TiffDecoder.h" // Provides TiffPageInfo and TiffLevel
+#include "JpegDecoder.h" // Provides JpegInfo and JpegScale
 
 #ifdef __cplusplus
 extern "C" {
@@ -46,42 +63,569 @@ extern "C" {
     /// @note The caller MUST call FreePixelBuffer() on the out_buffer to prevent a memory leak.
     __declspec(dllexport) HeifError ExtractPrimaryImageAndAnimationStatusFromMemory(const uint8_t* data, size_t size, PixelBuffer* out_buffer, bool* out_is_animated);
 
-    // --- AVIF Animation Exports ---
+    // --- Versioned API Exports ---
 
-    /// @brief Opens an AVIF/HEIF animation file from memory and caches its frame metadata.
+    /// @brief Returns the function table and capability flags of this build.
+    /// @param version The table version the caller was built against (1 to FLY_HEIF_API_VERSION).
+    /// @return A pointer to a static table, valid for the lifetime of the DLL, or nullptr if `version` is not supported.
+    __declspec(dllexport) const FlyHeifApi* GetFlyHeifApi(uint32_t version);
+
+    /// @brief Decodes a HEIF/AVIF file into a raw RGBA pixel buffer according to `options`.
+    /// @param path Path to the input file (UTF-16).
+    /// @param options Optional, size-prefixed options (thumbnail preference, size limit, thread count). nullptr uses the defaults.
+    /// @param out_buffer Pointer to a struct to receive the decoded image data.
+    /// @return A HeifError code indicating the result.
+    /// @note The caller MUST call FreePixelBuffer() on the out_buffer to prevent a memory leak.
+    __declspec(dllexport) HeifError DecodeHeifImage(const wchar_t* path, const FlyHeifDecodeOptions* options, PixelBuffer* out_buffer);
+
+    /// @brief Decodes HEIF/AVIF file data from memory according to `options`, reporting sequence status.
     /// @param data Pointer to the file data in memory.
     /// @param size Size of the file data in bytes.
-    /// @return An opaque handle to the animation context `AnimatedAvifReader`, or nullptr on failure. This handle must be passed to subsequent Avif export functions.
-    __declspec(dllexport) void* OpenAvifAnimation(const uint8_t* data, size_t size);
-
-    /// @brief Checks quickly if the given context handle holds an animated sequence.
-    /// @param handle Opaque handle to the `AnimatedAvifReader` context.
-    /// @return True if it contains a sequence track, false otherwise.
-    __declspec(dllexport) bool IsAvifAnimated(void* handle);
-
-    /// @brief Retrieves the width of the animated AVIF canvas.
-    /// @param handle Opaque handle to the `AnimatedAvifReader` context.
-    /// @return The width in pixels, or 0 if invalid.
-    __declspec(dllexport) int GetAvifCanvasWidth(void* handle);
-
-    /// @brief Retrieves the height of the animated AVIF canvas.
-    /// @param handle Opaque handle to the `AnimatedAvifReader` context.
-    /// @return The height in pixels, or 0 if invalid.
-    __declspec(dllexport) int GetAvifCanvasHeight(void* handle);
-    
-    /// @brief Decodes the next sequence frame into a pre-allocated BGRA buffer and returns its duration in ms.
-    /// @param handle Opaque handle to the `AnimatedAvifReader` context.
-    /// @param out_bgra_buffer A pre-allocated buffer of size Width * Height * 4. This ensures a 0-allocation decode path.
-    /// @return The duration of the decoded frame in ms, or 0 if EOF or an error occurred.
-    __declspec(dllexport) int DecodeNextAvifFrame(void* handle, uint8_t* out_bgra_buffer);
-
-    /// @brief Resets the animation track to the beginning to loop the animation continuously.
-    /// @param handle Opaque handle to the `AnimatedAvifReader` context.
-    __declspec(dllexport) void ResetAvifAnimation(void* handle);
-
-    /// @brief Closes the animation and releases all libheif associated memory for the given context.
-    /// @param handle Opaque handle to the `AnimatedAvifReader` context.
-    __declspec(dllexport) void CloseAvifAnimation(void* handle);
+    /// @param options Optional, size-prefixed options. nullptr uses the defaults.
+    /// @param out_buffer Pointer to a struct to receive the decoded image data.
+    /// @param out_is_animated Optional. Receives whether the file contains an animation sequence.
+    /// @return A HeifError code indicating the result.
+    /// @note The caller MUST call FreePixelBuffer() on the out_buffer to prevent a memory leak.
+    __declspec(dllexport) HeifError DecodeHeifImageFromMemory(const uint8_t* data, size_t size, const FlyHeifDecodeOptions* options, PixelBuffer* out_buffer, bool* out_is_animated);
+
+    /// @brief Copies the timing and error report of the last decode export that ran on the calling thread.
+    /// @param out_report Pointer to a caller-allocated struct with `struct_size` set. At most that many bytes are written.
+    /// @return True if a report was available, false if this thread has not run a decode export yet.
+    /// @note Every decode export (including DecodeAnimationFrame) records a report. Call this right after the export, on the same thread.
+    __declspec(dllexport) bool GetLastDecodeReport(DecodeReport* out_report);
+
+    // --- Animation Exports ---
+
+    /// @brief Opens an animated GIF, APNG, WebP or AVIF/HEIF sequence from memory and reads its frame table. No frame is decoded yet.
+    /// @param data Pointer to the file data in memory. It is not copied and MUST stay valid until CloseAnimation().
+    /// @param size Size of the file data in bytes.
+    /// @return An opaque handle to an `IAnimationSource`, or nullptr if the data is not an animation any backend can play.
+    ///         A still GIF, PNG or WebP opens as one frame; a still AVIF/HEIF does not open.
+    __declspec(dllexport) void* OpenAnimation(const uint8_t* data, size_t size);
+
+    /// @brief Retrieves the canvas size, frame count, loop count, total duration and container format.
+    /// @param handle Opaque handle to the `IAnimationSource`.
+    /// @param out_info Pointer to a struct to receive the information.
+    /// @return False if an argument is invalid.
+    __declspec(dllexport) bool GetAnimationInfo(void* handle, AnimationInfo* out_info);
+
+    /// @brief Retrieves the rectangle and delay of one frame, and whether it is a key frame.
+    /// @param handle Opaque handle to the `IAnimationSource`.
+    /// @param index Frame index, from 0 to frame_count - 1.
+    /// @param out_info Pointer to a struct to receive the frame information.
+    /// @return False if an argument is invalid or the index is out of range.
+    __declspec(dllexport) bool GetAnimationFrameInfo(void* handle, int32_t index, AnimationFrameInfo* out_info);
+
+    /// @brief Brings the canvas to frame `index` and copies the part that changed into one slot of a caller-owned ring.
+    /// @param handle Opaque handle to the `IAnimationSource`.
+    /// @param index Frame to show. A seek backwards, or past a key frame, replays from the nearest key frame.
+    /// @param ring The caller's ring. Each slot must hold at least Width * Height * 4 bytes.
+    /// @param slot Slot to write, from 0 to ring->slot_count - 1. Receives the changed rectangle's
+    ///        premultiplied BGRA pixels, packed (`width * 4` bytes per row).
+    /// @param out_dirty Receives the changed rectangle; empty if nothing changed.
+    /// @return False if an argument is invalid, the index is out of range or the frame could not be decoded.
+    __declspec(dllexport) bool DecodeAnimationFrame(void* handle, int32_t index, const AnimationRing* ring, int32_t slot, FrameRect* out_dirty);
+
+    /// @brief Retrieves the memory held and the frames decoded so far, counted alike for every format.
+    /// @param handle Opaque handle to the `IAnimationSource`.
+    /// @param out_stats Pointer to a struct to receive the statistics.
+    /// @return False if an argument is invalid.
+    __declspec(dllexport) bool GetAnimationStats(void* handle, AnimationStats* out_stats);
+
+    /// @brief Releases the source, its canvas and its decoder state. The file data may be freed afterwards.
+    /// @param handle Opaque handle to the `IAnimationSource`.
+    __declspec(dllexport) void CloseAnimation(void* handle);
+
+    // --- PSD Exports ---
+
+    /// @brief Reads a PSD or PSB's header and finds its JPEG thumbnail by walking the file's sections.
+    /// @param path Path to the .psd or .psb file (UTF-16).
+    /// @param out_info Pointer to a struct to receive the size, the composite's format and where the thumbnail is.
+    /// @return False if the file cannot be mapped or is not a PSD or PSB.
+    __declspec(dllexport) bool ReadPsdInfo(const wchar_t* path, PsdInfo* out_info);
+
+    /// @brief Decodes a PSD or PSB's merged composite into caller-allocated memory as premultiplied BGRA.
+    /// @param path Path to the .psd or .psb file (UTF-16).
+    /// @param out_bgra Receives `width * height` pixels, packed, with the size ReadPsdInfo() reported.
+    /// @param out_size Size of `out_bgra` in bytes; must be exactly `width * height * 4`.
+    /// @return A HeifError code; ImageDecodeError if the composite is in a form PsdDecoder does not handle.
+    __declspec(dllexport) HeifError DecodePsdComposite(const wchar_t* path, uint8_t* out_bgra, uint64_t out_size);
+
+    // --- DDS Exports ---
+
+    /// @brief Reads a DDS header and picks the mip level to preview from.
+    /// @param path Path to the .dds file (UTF-16).
+    /// @param max_dimension Display size the preview must cover; 0 selects the top level.
+    /// @param out_info Pointer to a struct to receive the size, format, mip count and image count.
+    /// @param out_mip Pointer to a struct to receive the smallest level whose longer side is at least `max_dimension`.
+    /// @return False if the file cannot be mapped or is not a DDS.
+    __declspec(dllexport) bool ReadDdsInfo(const wchar_t* path, int32_t max_dimension, DdsInfo* out_info, DdsMip* out_mip);
+
+    /// @brief Decodes one mip level of one array element or cube face into caller-allocated memory as premultiplied BGRA.
+    /// @param path Path to the .dds file (UTF-16).
+    /// @param item Array element, or array element times 6 plus face for a cubemap; 0 for a plain texture.
+    /// @param level Mip level; 0 is the full size.
+    /// @param out_bgra Receives the level's pixels, packed, with the size ReadDdsInfo() reported.
+    /// @param out_size Size of `out_bgra` in bytes; must be exactly `width * height * 4` of the level.
+    /// @return A HeifError code; ImageDecodeError if DdsDecoder does not handle the pixel format.
+    __declspec(dllexport) HeifError DecodeDdsMip(const wchar_t* path, int32_t item, int32_t level, uint8_t* out_bgra,
+                                                 uint64_t out_size);
+
+    // --- ICO Exports ---
+
+    /// @brief Reads an ICO or CUR directory and picks the entry to show at a given size, without decoding any entry.
+    /// @param path Path to the .ico or .cur file (UTF-16).
+    /// @param size Size the entry should cover; 0 or less selects the largest.
+    /// @param out_info Pointer to a struct to receive the entry count and the selected entry.
+    /// @param out_entries Receives up to `capacity` entries, largest first; may be null if `capacity` is 0.
+    /// @param capacity Number of entries `out_entries` has room for. `out_info->entry_count` says how many there are.
+    /// @return False if the file cannot be mapped, is not an ICO or CUR, or has no entry that can be decoded.
+    __declspec(dllexport) bool ReadIcoInfo(const wchar_t* path, int32_t size, IcoInfo* out_info, IcoEntry* out_entries,
+                                           int32_t capacity);
+
+    /// @brief Decodes one ICO or CUR entry into caller-allocated memory as premultiplied BGRA.
+    /// @param path Path to the .ico or .cur file (UTF-16).
+    /// @param index Directory index of the entry, as IcoEntry::index reports it.
+    /// @param out_bgra Receives the entry's pixels, packed, with the size ReadIcoInfo() reported.
+    /// @param out_size Size of `out_bgra` in bytes; must be exactly `width * height * 4` of the entry.
+    /// @return A HeifError code; ImageDecodeError if the entry is in a form IcoDecoder does not handle or is corrupt.
+    __declspec(dllexport) HeifError DecodeIcoEntry(const wchar_t* path, int32_t index, uint8_t* out_bgra, uint64_t out_size);
+
+    // --- TIFF Exports ---
+
+    /// @brief Maps a TIFF or BigTIFF and indexes every page and reduced-resolution image in it.
+    /// @param path Path to the .tif or .tiff file (UTF-16).
+    /// @return An opaque handle that keeps the file mapped until CloseTiff(), or nullptr if the file
+    ///         cannot be mapped or is not a TIFF.
+    __declspec(dllexport) void* OpenTiff(const wchar_t* path);
+
+    /// @param handle Opaque handle from OpenTiff().
+    /// @return The number of pages, or 0 if the handle is null.
+    __declspec(dllexport) int32_t GetTiffPageCount(void* handle);
+
+    /// @brief Describes one page and picks the level to show it at a given size.
+    /// @param handle Opaque handle from OpenTiff().
+    /// @param page Page index.
+    /// @param max_dimension Display size the level must cover; 0 or less selects the page itself.
+    /// @param out_page Pointer to a struct to receive the page's full size, layout and orientation.
+    /// @param out_level Pointer to a struct to receive the smallest decodable level whose longer side is at
+    ///        least `max_dimension`; its level is -1 if no level can be decoded.
+    /// @return False if an argument is invalid.
+    __declspec(dllexport) bool GetTiffPageInfo(void* handle, int32_t page, int32_t max_dimension, TiffPageInfo* out_page,
+                                               TiffLevel* out_level);
+
+    /// @brief Decodes one level of one page into caller-allocated memory as premultiplied BGRA.
+    ///        Only that level's strips or tiles are read. May be called from several threads at once.
+    /// @param handle Opaque handle from OpenTiff().
+    /// @param page Page index.
+    /// @param level Level; 0 is the page at full resolution.
+    /// @param out_bgra Receives the level's pixels, packed.
+    /// @param out_size Size of `out_bgra` in bytes; must be exactly `width * height * 4` of the level.
+    /// @return A HeifError code; ImageDecodeError if TiffDecoder does not handle the level or its data is corrupt.
+    __declspec(dllexport) HeifError DecodeTiffPage(void* handle, int32_t page, int32_t level, uint8_t* out_bgra,
+                                                   uint64_t out_size);
+
+    /// @brief Unmaps the file and frees the index. No call on the handle may be running or follow.
+    /// @param handle Opaque handle from OpenTiff().
+    __declspec(dllexport) void CloseTiff(void* handle);
+
+    // --- JPEG Exports ---
+
+    /// @brief Reads a JPEG's headers and EXIF block and picks the cheapest source for a display size.
+    /// @param path Path to the .jpg file (UTF-16).
+    /// @param max_dimension Display size the output must cover; 0 selects the main image at full size.
+    /// @param out_info Pointer to a struct to receive the size as displayed, the orientation and the thumbnail size.
+    /// @param out_scale Pointer to a struct to receive the EXIF thumbnail or IDCT scale to decode, and its output size.
+    /// @return False if the file cannot be mapped or is not a JPEG.
+    __declspec(dllexport) bool ReadJpegInfo(const wchar_t* path, int32_t max_dimension, JpegInfo* out_info,
+                                            JpegScale* out_scale);
+
+    /// @brief Decodes a JPEG, or its EXIF thumbnail, into caller-allocated memory as BGRA with the orientation applied.
+    /// @param path Path to the .jpg file (UTF-16).
+    /// @param thumbnail 1 for the EXIF thumbnail, 0 for the main image.
+    /// @param denominator IDCT scale of the main image: 1, 2, 4 or 8.
+    /// @param out_bgra Receives the pixels, packed, with the size ReadJpegInfo() reported for this scale.
+    /// @param out_size Size of `out_bgra` in bytes; must be exactly `width * height * 4` of the output.
+    /// @return A HeifError code; ImageDecodeError if JpegDecoder does not handle the image or libjpeg fails.
+    __declspec(dllexport) HeifError DecodeJpeg(const wchar_t* path, int32_t thumbnail, int32_t denominator,
+                                               uint8_t* out_bgra, uint64_t out_size);
+
+    // --- Image Probe Exports ---
+
+    /// @brief Reads an image's dimensions and orientation from its header without decoding any pixels.
+    /// @param path Path to the image file (UTF-16). JPEG, PNG, GIF, WebP, HEIF/AVIF, PSD, DDS, ICO/CUR and BMP are recognised.
+    /// @param out_info Pointer to a struct to receive the format, stored size and EXIF-style orientation.
+    /// @return True if the format was recognised and the size was read, false otherwise.
+    __declspec(dllexport) bool ProbeImage(const wchar_t* path, ImageProbeInfo* out_info);
+
+    /// @brief Probes many files in parallel, e.g. every file of a folder.
+    /// @param paths Array of `count` UTF-16 paths.
+    /// @param count Number of entries in `paths` and `out_infos`.
+    /// @param out_infos Caller-allocated array of `count` structs. Entries for unreadable files are zeroed.
+    /// @return The number of files successfully probed.
+    __declspec(dllexport) int ProbeImageBatch(const wchar_t* const* paths, int count, ImageProbeInfo* out_infos);
+
+    // --- Folder Index Exports ---
+
+    /// @brief Refreshes the metadata index of a folder and opens it for lookups.
+    /// @param folder The folder to index (UTF-16, not recursive).
+    /// @param index_file Path of the index file to read and, if anything changed, rewrite.
+    /// @param extensions Array of `extension_count` extensions including the dot (e.g. L".jpg"); matched case-insensitively.
+    /// @param extension_count Number of entries in `extensions`.
+    /// @param out_stats Optional. Receives how many entries were reused, probed and removed.
+    /// @return An opaque handle to the mapped `FolderIndex`, or nullptr on failure. Must be released with CloseFolderIndex().
+    __declspec(dllexport) void* OpenFolderIndex(const wchar_t* folder, const wchar_t* index_file, const wchar_t* const* extensions, int extension_count, FolderIndexRefreshStats* out_stats);
+
+    /// @brief Retrieves the number of files in an open folder index.
+    /// @param handle Opaque handle to the `FolderIndex`.
+    /// @return The number of entries, or 0 if invalid.
+    __declspec(dllexport) int GetFolderIndexCount(void* handle);
+
+    /// @brief Looks up one file in an open folder index. Reads straight from the mapped file.
+    /// @param handle Opaque handle to the `FolderIndex`.
+    /// @param file_name The file name without its directory (UTF-16).
+    /// @param out_entry Pointer to a struct to receive the entry.
+    /// @return True if the file is in the index, false otherwise.
+    __declspec(dllexport) bool LookupFolderIndexEntry(void* handle, const wchar_t* file_name, FolderIndexEntry* out_entry);
+
+    /// @brief Unmaps the folder index and releases the handle.
+    /// @param handle Opaque handle to the `FolderIndex`.
+    __declspec(dllexport) void CloseFolderIndex(void* handle);
+
+    // --- Thumbnail Store Exports ---
+
+    /// @brief Opens (or creates) the persistent thumbnail store in a folder and starts its writer thread.
+    /// @param folder Directory for the index and segment files (UTF-16). Created if missing.
+    /// @param max_bytes Live bytes above which the least recently read entries are evicted.
+    /// @param max_entries Entry count above which eviction runs.
+    /// @return An opaque handle to the `ThumbnailStore`, or nullptr if the folder cannot be used or another process has it open.
+    __declspec(dllexport) void* OpenThumbnailStore(const wchar_t* folder, uint64_t max_bytes, uint32_t max_entries);
+
+    /// @brief Looks up a thumbnail without locking or copying.
+    /// @param handle Opaque handle to the `ThumbnailStore`.
+    /// @param path The source file path (UTF-16), compared exactly.
+    /// @param mtime The source file's last write time; an entry stored with another value is a miss.
+    /// @param out_view Receives a view into the mapped store on a hit.
+    /// @return True on a hit. The view MUST then be passed to ReleaseThumbnailView().
+    __declspec(dllexport) bool GetThumbnail(void* handle, const wchar_t* path, int64_t mtime, ThumbnailView* out_view);
+
+    /// @brief Looks up a thumbnail by the content fingerprint of the file at `path`, for files that were moved or renamed.
+    /// @param handle Opaque handle to the `ThumbnailStore`.
+    /// @param path The source file path (UTF-16). The file is read (about 128 KB) to fingerprint it.
+    /// @param mtime The source file's current last write time. The entry must have been stored with it:
+    ///        a move keeps it, but an edit in place that leaves the sampled bytes alone does not.
+    /// @param out_view Receives the view on a hit.
+    /// @return True on a hit. `path` is then aliased to the entry, so the next GetThumbnail() for it hits directly.
+    ///         The view MUST be passed to ReleaseThumbnailView().
+    __declspec(dllexport) bool GetThumbnailByContent(void* handle, const wchar_t* path, int64_t mtime, ThumbnailView* out_view);
+
+    /// @brief Releases a view returned by GetThumbnail() or GetThumbnailByContent(). Its memory must not be touched afterwards.
+    /// @param handle Opaque handle to the `ThumbnailStore`.
+    /// @param view The view to release.
+    __declspec(dllexport) void ReleaseThumbnailView(void* handle, const ThumbnailView* view);
+
+    /// @brief Queues a thumbnail for writing, replacing any older one for the same path. The data is copied.
+    /// @param handle Opaque handle to the `ThumbnailStore`.
+    /// @param path The source file path (UTF-16).
+    /// @param mtime The source file's last write time.
+    /// @param data The encoded thumbnail.
+    /// @param size Number of bytes in `data`.
+    /// @param width Stored with the entry and returned in ThumbnailView::width.
+    /// @param height Stored with the entry and returned in ThumbnailView::height.
+    /// @return True if queued; false if the blob is too large or the write queue is full.
+    __declspec(dllexport) bool PutThumbnail(void* handle, const wchar_t* path, int64_t mtime, const uint8_t* data, uint32_t size, int32_t width, int32_t height);
+
+    /// @brief Block-compresses a BGRA preview and its smaller levels (BC1, or BC3 if it has transparency) and queues it for writing.
+    /// @param handle Opaque handle to the `ThumbnailStore`.
+    /// @param path The source file path (UTF-16).
+    /// @param mtime The source file's last write time.
+    /// @param bgra Premultiplied BGRA8 pixels of the preview.
+    /// @param preview_width Width of the preview in pixels.
+    /// @param preview_height Height of the preview in pixels.
+    /// @param stride Bytes per row of `bgra`.
+    /// @param tile_size Edge of the square thumbnail-strip tile stored with the preview; 0 for none.
+    /// @param width Stored with the entry and returned in ThumbnailView::width.
+    /// @param height Stored with the entry and returned in ThumbnailView::height.
+    /// @return True if queued. The stored blob starts with a BlockPreviewHeader, and the entry carries the
+    ///         content fingerprint of the file so GetThumbnailByContent() finds it after a move.
+    __declspec(dllexport) bool PutCompressedThumbnail(void* handle, const wchar_t* path, int64_t mtime, const uint8_t* bgra,
+                                                      int32_t preview_width, int32_t preview_height, int32_t stride,
+                                                      int32_t tile_size, int32_t width, int32_t height);
+
+    /// @brief Picks the level of a block-compressed thumbnail to draw at a given size.
+    /// @param view A view returned by GetThumbnail() or GetThumbnailByContent().
+    /// @param edge Longest edge, in pixels, the image will be drawn at. The smallest level at least this large is chosen.
+    /// @param tile True to get the square thumbnail-strip tile instead.
+    /// @param out_level Receives the level; its offset is relative to `view->data`.
+    /// @return False if the view does not hold a valid block-compressed blob, or `tile` is set and it has no tile.
+    __declspec(dllexport) bool FindThumbnailLevel(const ThumbnailView* view, int32_t edge, bool tile, BlockPreviewLevel* out_level);
+
+    /// @brief Blocks until every queued write is committed.
+    /// @param handle Opaque handle to the `ThumbnailStore`.
+    __declspec(dllexport) void FlushThumbnailStore(void* handle);
+
+    /// @brief Removes every entry and deletes the segment files. Blocks until done.
+    /// @param handle Opaque handle to the `ThumbnailStore`.
+    __declspec(dllexport) void ClearThumbnailStore(void* handle);
+
+    /// @brief Retrieves entry, byte, hit and compaction counters.
+    /// @param handle Opaque handle to the `ThumbnailStore`.
+    /// @param out_stats Pointer to a struct to receive the counters.
+    /// @return True on success, false if the handle is invalid.
+    __declspec(dllexport) bool GetThumbnailStoreStats(void* handle, ThumbnailStoreStats* out_stats);
+
+    /// @brief Commits pending writes, closes the store and releases the handle.
+    /// @param handle Opaque handle to the `ThumbnailStore`.
+    /// @note No view may be outstanding and no other call on the handle may be in progress.
+    __declspec(dllexport) void CloseThumbnailStore(void* handle);
+
+    // --- Thumbnail Atlas Exports ---
+
+    /// @brief Creates an atlas of `columns` x `rows` square slots for the thumbnail strip.
+    /// @param slot_size Edge of a slot in pixels; thumbnails are scaled to it on insertion.
+    /// @return An opaque handle to the `ThumbnailAtlas`, or nullptr if the arguments are invalid.
+    __declspec(dllexport) void* CreateThumbnailAtlas(int32_t slot_size, int32_t columns, int32_t rows);
+
+    /// @brief Looks up the slot holding a thumbnail and marks it most recently used.
+    /// @param handle Opaque handle to the `ThumbnailAtlas`.
+    /// @param key Caller-chosen identity of the thumbnail's pixels.
+    /// @return The slot index, or -1 if the thumbnail is not in the atlas.
+    __declspec(dllexport) int32_t FindAtlasSlot(void* handle, uint64_t key);
+
+    /// @brief Scales premultiplied BGRA pixels into the least recently used slot and marks it dirty.
+    /// @param handle Opaque handle to the `ThumbnailAtlas`.
+    /// @param key Identity of the thumbnail, for FindAtlasSlot().
+    /// @param bgra The thumbnail pixels.
+    /// @param width Width of `bgra` in pixels.
+    /// @param height Height of `bgra` in pixels.
+    /// @param stride Bytes per row of `bgra`.
+    /// @return The slot index, or -1 on invalid input.
+    __declspec(dllexport) int32_t InsertAtlasPixels(void* handle, uint64_t key, const uint8_t* bgra, int32_t width, int32_t height, int32_t stride);
+
+    /// @brief Decodes BC1/BC3 blocks (a cached strip tile) into the least recently used slot and marks it dirty.
+    /// @param handle Opaque handle to the `ThumbnailAtlas`.
+    /// @param key Identity of the thumbnail, for FindAtlasSlot().
+    /// @param format A BlockFormat value.
+    /// @param blocks The block data.
+    /// @param size Bytes in `blocks`.
+    /// @param width Width of the image in pixels.
+    /// @param height Height of the image in pixels.
+    /// @return The slot index, or -1 on invalid input.
+    __declspec(dllexport) int32_t InsertAtlasBlocks(void* handle, uint64_t key, int32_t format, const uint8_t* blocks, uint32_t size, int32_t width, int32_t height);
+
+    /// @brief Gets the pixel rectangle of a slot.
+    /// @param handle Opaque handle to the `ThumbnailAtlas`.
+    /// @param slot A slot index returned by FindAtlasSlot() or an insert.
+    /// @param out_rect Receives the rectangle.
+    /// @return False if the handle or slot is invalid.
+    __declspec(dllexport) bool GetAtlasSlotRect(void* handle, int32_t slot, AtlasRect* out_rect);
+
+    /// @brief Retrieves the areas changed since the last call and marks the atlas clean.
+    /// @param handle Opaque handle to the `ThumbnailAtlas`.
+    /// @param out_rects Array that receives the rectangles.
+    /// @param max_rects Capacity of `out_rects`. If more areas changed, one rectangle covering the whole atlas is returned.
+    /// @return The number of rectangles written.
+    __declspec(dllexport) int32_t TakeAtlasDirtyRects(void* handle, AtlasRect* out_rects, int32_t max_rects);
+
+    /// @brief Copies a rectangle of the atlas into tightly packed BGRA rows, for upload.
+    /// @param handle Opaque handle to the `ThumbnailAtlas`.
+    /// @param rect The rectangle to copy.
+    /// @param dst Destination buffer.
+    /// @param dst_size Bytes available at `dst`; at least width * height * 4.
+    /// @return False if the rectangle is outside the atlas or the buffer is too small.
+    __declspec(dllexport) bool CopyAtlasRect(void* handle, const AtlasRect* rect, uint8_t* dst, uint32_t dst_size);
+
+    /// @brief Forgets every thumbnail and clears the pixels; the whole atlas becomes dirty.
+    /// @param handle Opaque handle to the `ThumbnailAtlas`.
+    __declspec(dllexport) void ClearThumbnailAtlas(void* handle);
+
+    /// @brief Frees the atlas and releases the handle.
+    /// @param handle Opaque handle to the `ThumbnailAtlas`.
+    __declspec(dllexport) void DestroyThumbnailAtlas(void* handle);
+
+
+    // --- Cache Warm-up Exports ---
+
+    /// @brief Creates a warmer that fills a thumbnail store in the background.
+    /// @param store Opaque handle from OpenThumbnailStore(). It must stay open until the warmer is destroyed.
+    /// @param hooks Callbacks that generate a preview and gate warming on power state. Copied.
+    /// @return An opaque handle to the `CacheWarmer`, or nullptr if `generate` is missing.
+    __declspec(dllexport) void* CreateCacheWarmer(void* store, const CacheWarmHooks* hooks);
+
+    /// @brief Starts walking a folder on background threads, ending any previous run first.
+    /// @param handle Opaque handle to the `CacheWarmer`.
+    /// @param root The folder to warm (UTF-16).
+    /// @param extensions Array of extensions including the dot.
+    /// @param extension_count Number of entries in `extensions`.
+    /// @param checkpoint_file Where progress is saved so an interrupted run resumes; nullptr for none.
+    /// @param options Threads, recursion, throttling and limits; nullptr for the defaults.
+    /// @return False if the folder does not exist or the arguments are invalid.
+    __declspec(dllexport) bool StartCacheWarmer(void* handle, const wchar_t* root, const wchar_t* const* extensions, int extension_count,
+                                                const wchar_t* checkpoint_file, const CacheWarmOptions* options);
+
+    /// @brief Holds the warmer after the files in progress.
+    /// @param handle Opaque handle to the `CacheWarmer`.
+    __declspec(dllexport) void PauseCacheWarmer(void* handle);
+
+    /// @brief Lets a paused warmer continue.
+    /// @param handle Opaque handle to the `CacheWarmer`.
+    __declspec(dllexport) void ResumeCacheWarmer(void* handle);
+
+    /// @brief Ends the run, waits for the files in progress and saves the checkpoint.
+    /// @param handle Opaque handle to the `CacheWarmer`.
+    /// @note Blocks while a `generate` call is running; do not call it from inside a hook.
+    __declspec(dllexport) void StopCacheWarmer(void* handle);
+
+    /// @brief Retrieves the counters and state of the current or last run.
+    /// @param handle Opaque handle to the `CacheWarmer`.
+    /// @param out_progress Receives the snapshot.
+    /// @return False if the handle is invalid.
+    __declspec(dllexport) bool GetCacheWarmerProgress(void* handle, CacheWarmProgress* out_progress);
+
+    /// @brief Stops the warmer and frees it.
+    /// @param handle Opaque handle to the `CacheWarmer`.
+    __declspec(dllexport) void DestroyCacheWarmer(void* handle);
+
+    // --- Prefetch Scheduler Exports ---
+
+    /// @brief Creates the scheduler of the viewer's sliding-window loads. Its workers are not started.
+    /// @param hooks Callbacks that load, announce and release a key's results. Copied.
+    /// @param options Threads, memory budget and size estimates; nullptr for the defaults.
+    /// @return An opaque handle to the `PrefetchScheduler`, or nullptr if a hook is missing.
+    __declspec(dllexport) void* CreatePrefetchScheduler(const PrefetchHooks* hooks, const PrefetchOptions* options);
+
+    /// @brief Starts the worker pool.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    __declspec(dllexport) void StartPrefetchScheduler(void* handle);
+
+    /// @brief Re-centres the window, releasing results outside it through the `release` hook.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    /// @param window Centre, radii and burst state.
+    /// @param keys Keys at positions [window->first, window->first + count), covering both radii.
+    /// @param count Number of keys; 0 forgets every result without releasing it.
+    __declspec(dllexport) void MovePrefetchWindow(void* handle, const PrefetchWindow* window, const int32_t* keys, int count);
+
+    /// @brief Ends a burst so held HQ loads run. May release results through the `release` hook.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    __declspec(dllexport) void EndPrefetchBurst(void* handle);
+
+    /// @brief Queues a disk-cache write for a key whose preview is loaded or loading.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    /// @param key The photo key.
+    __declspec(dllexport) void QueuePrefetchDiskWrite(void* handle, int32_t key);
+
+    /// @brief Records a result the owner loaded itself.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    /// @param key The photo key.
+    /// @param tier A PrefetchTier value.
+    /// @param bytes Memory the result holds.
+    __declspec(dllexport) void MarkPrefetchLoaded(void* handle, int32_t key, int32_t tier, uint64_t bytes);
+
+    /// @brief Forgets a result the owner freed itself; the next window move queues it again.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    /// @param key The photo key.
+    /// @param tier A PrefetchTier value.
+    __declspec(dllexport) void UnloadPrefetch(void* handle, int32_t key, int32_t tier);
+
+    /// @brief Tells the scheduler how many bytes a key's HQ bitmap will hold, e.g. from the preview's metadata.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    /// @param key The photo key; ignored if it is not in the window.
+    /// @param bytes Decoded size of the full-resolution bitmap.
+    __declspec(dllexport) void SetPrefetchHqSizeHint(void* handle, int32_t key, uint64_t bytes);
+
+    /// @brief Forgets every result of a key without releasing it.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    /// @param key The photo key.
+    __declspec(dllexport) void ForgetPrefetchKey(void* handle, int32_t key);
+
+    /// @brief Whether the `tier` result of a key is loaded.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    /// @param key The photo key.
+    /// @param tier A PrefetchTier value.
+    __declspec(dllexport) bool IsPrefetchLoaded(void* handle, int32_t key, int32_t tier);
+
+    /// @brief Counts loaded results of a tier with keys below and above a pivot key.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    /// @param tier A PrefetchTier value.
+    /// @param pivot The key to count around, usually the one on screen.
+    /// @param out_below Receives the count below `pivot`.
+    /// @param out_above Receives the count above `pivot`.
+    /// @return False if the handle is invalid.
+    __declspec(dllexport) bool CountPrefetchLoaded(void* handle, int32_t tier, int32_t pivot, int32_t* out_below, int32_t* out_above);
+
+    /// @brief Retrieves memory and queue counters.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    /// @param out_stats Receives the snapshot.
+    /// @return False if the handle is invalid.
+    __declspec(dllexport) bool GetPrefetchStats(void* handle, PrefetchStats* out_stats);
+
+    /// @brief Keeps queued loads from starting; returns without waiting for the loads in progress.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    /// @note The handle stays valid; free it with DestroyPrefetchScheduler().
+    __declspec(dllexport) void CancelPrefetchScheduler(void* handle);
+
+    /// @brief Stops the workers after the loads in progress and frees the scheduler.
+    /// @param handle Opaque handle to the `PrefetchScheduler`.
+    /// @note Blocks while a `load` call is running; do not call it from inside a hook.
+    __declspec(dllexport) void DestroyPrefetchScheduler(void* handle);
+
+    // --- Navigation Predictor Exports ---
+
+    /// @brief Creates a predictor that shapes the prefetch window from recent navigation.
+    /// @param preview_radius The configured preview radius per side.
+    /// @param hq_radius The configured HQ radius per side.
+    /// @return An opaque handle to the `NavigationPredictor`.
+    __declspec(dllexport) void* CreateNavigationPredictor(int32_t preview_radius, int32_t hq_radius);
+
+    /// @brief Records a navigation and returns the plan for the window around its position.
+    /// @param handle Opaque handle to the `NavigationPredictor`.
+    /// @param event The navigation.
+    /// @param preview_radius The configured preview radius per side, which may have changed.
+    /// @param hq_radius The configured HQ radius per side.
+    /// @param out_plan Receives the plan.
+    /// @return False if an argument is invalid.
+    __declspec(dllexport) bool RecordNavigation(void* handle, const NavigationEvent* event, int32_t preview_radius,
+                                                int32_t hq_radius, PrefetchPlan* out_plan);
+
+    /// @brief Forgets the navigation history, e.g. when another folder is opened.
+    /// @param handle Opaque handle to the `NavigationPredictor`.
+    __declspec(dllexport) void ResetNavigationPredictor(void* handle);
+
+    /// @brief Frees the predictor.
+    /// @param handle Opaque handle to the `NavigationPredictor`.
+    __declspec(dllexport) void DestroyNavigationPredictor(void* handle);
+
+    // --- Startup Preview Exports ---
+
+    /// @brief Starts the speculative load of the launch photo on a native thread. Call once, as early as possible.
+    /// @param path The photo the process was launched with (UTF-16).
+    /// @param store_folder The thumbnail store's folder (UTF-16), or nullptr to skip the cache.
+    /// @param options Which steps to run, and the store limits as for OpenThumbnailStore().
+    /// @return False if an argument is invalid or a load was already started.
+    __declspec(dllexport) bool BeginStartupPreview(const wchar_t* path, const wchar_t* store_folder,
+                                                   const StartupPreviewOptions* options);
+
+    /// @brief Takes over the thumbnail store the startup load opened, instead of opening it again.
+    ///        Waits, without a timeout, for the open to finish: the load holds the store's lock
+    ///        until then, so the caller could not open the store itself in the meantime.
+    /// @return An opaque handle to the `ThumbnailStore`, to be used and closed like one from
+    ///         OpenThumbnailStore(); nullptr if there is none, and the caller opens the store itself.
+    __declspec(dllexport) void* ClaimStartupThumbnailStore();
+
+    /// @brief Takes the result of the startup load of `path`.
+    /// @param path The photo about to be displayed (UTF-16).
+    /// @param timeout_ms How long to wait for the load to finish.
+    /// @param out_result Receives the result. A Cached view MUST be released with ReleaseThumbnailView()
+    ///        on the claimed store; the result MUST then be passed to FreeStartupPreview().
+    /// @return False if no load of `path` ran, it did not finish in time, or it was already claimed.
+    __declspec(dllexport) bool ClaimStartupPreview(const wchar_t* path, uint32_t timeout_ms, StartupPreviewResult* out_result);
+
+    /// @brief Frees the pixels of a claimed result.
+    /// @param result The result filled by ClaimStartupPreview().
+    __declspec(dllexport) void FreeStartupPreview(StartupPreviewResult* result);
+
+    /// @brief Gives up on whatever of the startup load was not claimed. Does not block.
+    __declspec(dllexport) void EndStartupPreview();
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,128 @@
+/**
+ * @file NavigationPredictor.cpp
+ * @brief Implements NavigationPredictor.
+ */
+
+#include "NavigationPredictor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+    /// Weight of the newest navigation in the running statistics.
+    constexpr double kWeight = 0.25;
+
+    /// Above this steadiness, single steps count as sequential browsing; above the second, as very steady.
+    constexpr double kSequential = 0.5;
+    constexpr double kVerySteady = 0.85;
+
+    /// Above this share of jumps, the user is browsing at random.
+    constexpr double kRandom = 0.5;
+
+    /// Stepping faster than this outruns an HQ decode, so one more bitmap is fetched ahead.
+    constexpr double kFastDwellMs = 400;
+    constexpr int64_t kMaxDwellMs = 10000;
+
+    /// Rank multiplier for photos behind while a key is held.
+    constexpr int32_t kBurstBehindWeight = 8;
+
+    double Mix(double average, double sample) { return average + kWeight * (sample - average); }
+}
+
+NavigationPredictor::NavigationPredictor(int32_t preview_radius, int32_t hq_radius) {
+    SetRadii(preview_radius, hq_radius);
+}
+
+void NavigationPredictor::SetRadii(int32_t preview_radius, int32_t hq_radius) {
+    preview_radius_ = std::max(0, preview_radius);
+    hq_radius_ = std::max(0, hq_radius);
+}
+
+/**
+ * @brief A jump or a move of more than one photo counts as a jump; a single step continues the
+ *        direction or turns it. Only single steps taken by hand update the dwell time: a held
+ *        key's repeat rate says nothing about how long the user looks at a photo. Redisplaying
+ *        the same position is not a navigation.
+ */
+PrefetchPlan NavigationPredictor::Record(const NavigationEvent& event) {
+    const auto kind = static_cast<NavigationKind>(event.kind);
+    if (!have_last_) {
+        have_last_ = true;
+        last_time_ms_ = event.time_ms;
+        last_position_ = event.position;
+        last_kind_ = NavigationKind::Jump;
+        return Plan();
+    }
+
+    const int32_t delta = event.position - last_position_;
+    if (delta == 0) return Plan();
+    const int64_t dwell = std::clamp<int64_t>(event.time_ms - last_time_ms_, 0, kMaxDwellMs);
+
+    if (kind == NavigationKind::Jump || std::abs(delta) > 1) {
+        jumpiness_ = Mix(jumpiness_, 1);
+        steadiness_ = Mix(steadiness_, 0);
+        direction_ = 0;
+        last_kind_ = NavigationKind::Jump;
+    } else {
+        const int32_t direction = delta > 0 ? 1 : -1;
+        jumpiness_ = Mix(jumpiness_, 0);
+        steadiness_ = Mix(steadiness_, direction == direction_ ? 1 : 0);
+        direction_ = direction;
+        if (kind == NavigationKind::Step) {
+            dwell_ms_ = dwell_ms_ == 0 ? static_cast<double>(dwell) : Mix(dwell_ms_, static_cast<double>(dwell));
+        }
+        last_kind_ = kind;
+    }
+
+    last_time_ms_ = event.time_ms;
+    last_position_ = event.position;
+    return Plan();
+}
+
+PrefetchPlan NavigationPredictor::Plan() const {
+    const int32_t r = preview_radius_;
+    const int32_t h = hq_radius_;
+
+    PrefetchPlan plan{};
+    plan.mode = static_cast<int32_t>(NavigationMode::Balanced);
+    plan.preview_ahead = plan.preview_behind = r;
+    plan.hq_ahead = plan.hq_behind = h;
+    plan.confidence = static_cast<int32_t>(std::lround(steadiness_ * 100));
+
+    if (last_kind_ == NavigationKind::Repeat && direction_ != 0) {
+        plan.mode = static_cast<int32_t>(NavigationMode::Burst);
+        plan.direction = direction_;
+        plan.preview_ahead = r + r / 2;
+        plan.preview_behind = r / 4;
+        plan.hq_behind = std::min(h, 1);
+        plan.behind_weight = kBurstBehindWeight;
+    } else if (last_kind_ == NavigationKind::Jump || jumpiness_ >= kRandom) {
+        // The next photo could be anywhere near; cover more of it at full quality.
+        plan.mode = static_cast<int32_t>(NavigationMode::Random);
+        if (h > 0) plan.hq_ahead = plan.hq_behind = h + 1;
+    } else if (direction_ != 0 && steadiness_ >= kSequential) {
+        // Shift up to half the radius from behind to ahead, in proportion to the steadiness.
+        const int32_t shift = static_cast<int32_t>(std::lround(r * steadiness_ / 2));
+        plan.mode = static_cast<int32_t>(NavigationMode::Sequential);
+        plan.direction = direction_;
+        plan.preview_ahead = r + shift;
+        plan.preview_behind = std::max(r / 4, r - shift);
+        if (h > 0 && dwell_ms_ > 0 && dwell_ms_ < kFastDwellMs) plan.hq_ahead = h + 1;
+        if (h > 1 && steadiness_ >= kVerySteady) plan.hq_behind = h - 1;
+        plan.behind_weight = 2 + static_cast<int32_t>(std::lround(4 * steadiness_));
+    }
+    return plan;
+}
+
+void NavigationPredictor::Reset() {
+    have_last_ = false;
+    last_time_ms_ = 0;
+    last_position_ = 0;
+    last_kind_ = NavigationKind::Jump;
+    direction_ = 0;
+    steadiness_ = 0;
+    jumpiness_ = 0;
+    dwell_ms_ = 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file NavigationPredictor.h
+ * @brief Declares NavigationPredictor, which turns the user's navigation into a prefetch plan.
+ *
+ * A window of equal radii on both sides fits a user who might go either way, but most sessions
+ * have a shape: stepping steadily through a folder, holding a key, or jumping around from the
+ * thumbnail strip. NavigationPredictor is fed one event per navigation (the new position, how
+ * it got there and when) and answers with the radii the prefetch window should use.
+ *
+ * - Sequential browsing: the radii lean into the direction of travel, more the steadier the
+ *   stepping, and one more HQ bitmap is fetched ahead when the user steps faster than an HQ
+ *   decode. Photos behind rank further back in the queue.
+ * - Held key: previews far ahead, little behind; HQ loads are held by the scheduler anyway.
+ * - Random jumps: no direction to lean into, so the HQ radius widens on both sides instead.
+ * - Otherwise the plan is symmetric and the scheduler derives the direction itself, as without
+ *   a predictor.
+ *
+ * Statistics are exponentially weighted, so a few events change the mode. Event times come
+ * from the caller, which keeps replays of recorded traces deterministic.
+ *
+ * Not thread-safe; calls come from the thread that moves the window.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef NAVIGATION_PREDICTOR_H
+#define NAVIGATION_PREDICTOR_H
+
+#include <cstdint>
+
+/// @brief How a navigation reached its position.
+enum class NavigationKind : int32_t {
+    Step = 0,           ///< A single step: arrow key, wheel, button.
+    Repeat = 1,         ///< A step while a navigation key is held.
+    Jump = 2,           ///< Thumbnail click, first/last, page, or opening the folder.
+};
+
+/// @brief The mode a plan was made for. Reported for logging and the replay harness.
+enum class NavigationMode : int32_t {
+    Balanced = 0,
+    Sequential = 1,
+    Burst = 2,
+    Random = 3,
+};
+
+/// @brief One navigation. Blittable for P/Invoke.
+struct NavigationEvent {
+    int64_t time_ms;                    ///< Monotonic time of the navigation.
+    int32_t position;                   ///< New position in the photo list.
+    int32_t kind;                       ///< A NavigationKind value.
+};
+
+/// @brief Radii for the prefetch window. Blittable for P/Invoke.
+struct PrefetchPlan {
+    int32_t direction;                  ///< -1 or 1 to lean the window that way; 0 for symmetric.
+    int32_t mode;                       ///< A NavigationMode value.
+    int32_t preview_ahead;              ///< Preview radius in the direction (both sides if direction is 0).
+    int32_t preview_behind;
+    int32_t hq_ahead;
+    int32_t hq_behind;
+    int32_t behind_weight;              ///< Rank multiplier for photos behind; 0 for the scheduler's default.
+    int32_t confidence;                 ///< 0-100: how steady the sequential browsing is.
+};
+
+/// @brief Exponentially weighted model of recent navigation.
+class NavigationPredictor {
+public:
+    /// @param preview_radius The configured preview radius per side.
+    /// @param hq_radius The configured HQ radius per side.
+    NavigationPredictor(int32_t preview_radius, int32_t hq_radius);
+
+    /// @brief Updates the configured radii, e.g. after the settings change.
+    void SetRadii(int32_t preview_radius, int32_t hq_radius);
+
+    /// @brief Records a navigation and returns the plan for the window around its position.
+    PrefetchPlan Record(const NavigationEvent& event);
+
+    /// @brief The plan for the last recorded navigation.
+    PrefetchPlan Plan() const;
+
+    /// @brief Forgets the history, e.g. when another folder is opened.
+    void Reset();
+
+private:
+    int32_t preview_radius_;
+    int32_t hq_radius_;
+
+    bool have_last_ = false;
+    int64_t last_time_ms_ = 0;
+    int32_t last_position_ = 0;
+    NavigationKind last_kind_ = NavigationKind::Jump;
+
+    int32_t direction_ = 0;             // Sign of the last single step, 0 after a jump.
+    double steadiness_ = 0;             // Weighted share of steps continuing the direction.
+    double jumpiness_ = 0;              // Weighted share of jumps among navigations.
+    double dwell_ms_ = 0;               // Weighted time spent on a photo before a single step.
+};
+
+#endif // NAVIGATION_PREDICTOR_H
@@ -0,0 +1,505 @@
+/**
+ * @file PrefetchScheduler.cpp
+ * @brief Implements PrefetchScheduler.
+ */
+
+#include "PrefetchScheduler.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+    constexpr uint64_t kDefaultMemoryBudget = 1ull << 30;
+    constexpr uint64_t kDefaultPreviewEstimate = 4ull << 20;
+    constexpr uint64_t kDefaultHqEstimate = 96ull << 20;
+
+    /// Disk writes sort after every load, whatever their distance.
+    constexpr uint64_t kDiskWriteBase = 1ull << 40;
+
+    /// HQ bitmaps kept outside the HQ radius rank after all window work, by eviction score.
+    constexpr uint64_t kRetainedBase = 1ull << 41;
+    constexpr uint64_t kMaxRetainedScore = 1ull << 60;
+
+    /// Behind the direction of travel, a photo counts as this many times further away; more while bursting.
+    constexpr uint64_t kBehindWeight = 2;
+    constexpr uint64_t kBehindWeightBurst = 4;
+
+    int TierIndex(PrefetchTier tier) { return static_cast<int>(tier); }
+
+    PrefetchOptions WithDefaults(PrefetchOptions options) {
+        if (options.memory_budget == 0) options.memory_budget = kDefaultMemoryBudget;
+        if (options.preview_estimate == 0) options.preview_estimate = kDefaultPreviewEstimate;
+        if (options.hq_estimate == 0) options.hq_estimate = kDefaultHqEstimate;
+        if (options.hq_budget == 0) options.hq_budget = options.memory_budget;
+        options.hq_budget = std::min(options.hq_budget, options.memory_budget);
+        if (options.threads <= 0) options.threads = static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+        return options;
+    }
+}
+
+PrefetchScheduler::PrefetchScheduler(const PrefetchHooks& hooks, const PrefetchOptions& options)
+    : hooks_(hooks), options_(WithDefaults(options)), hq_(options_.hq_budget, options_.system_reserve) {
+}
+
+PrefetchScheduler::~PrefetchScheduler() {
+    Stop();
+}
+
+void PrefetchScheduler::Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!workers_.empty()) return;
+    stop_ = false;
+    for (int32_t i = 0; i < options_.threads; ++i) workers_.emplace_back(&PrefetchScheduler::WorkerLoop, this);
+}
+
+void PrefetchScheduler::Stop() {
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        workers.swap(workers_);
+    }
+    cv_.notify_all();
+    for (std::thread& t : workers) t.join();
+}
+
+void PrefetchScheduler::Cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+}
+
+/**
+ * @brief Results outside the new window are collected under the lock and released after it,
+ *        so the hook may call back into the scheduler. Previews are released as they leave the
+ *        window; HQ bitmaps are left to the residency manager. Queued tasks are rebuilt from
+ *        scratch because every priority depends on the centre and the direction, then the
+ *        results are trimmed to the budgets.
+ */
+void PrefetchScheduler::MoveWindow(const PrefetchWindow& window, const int32_t* keys, int32_t count) {
+    std::vector<std::pair<int32_t, PrefetchTier>> released;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!keys || count <= 0) {
+            entries_.clear();
+            pending_.clear();
+            hq_.Clear();
+            resident_bytes_ = 0;
+            direction_ = 0;
+            have_window_ = false;
+            return;
+        }
+
+        // A plan's direction wins. Otherwise single steps set it; a jump further than the HQ radius resets it.
+        const int32_t delta = window.centre - window_.centre;
+        if (window.direction != 0) {
+            direction_ = window.direction > 0 ? 1 : -1;
+        } else if (!have_window_) {
+            direction_ = 0;
+        } else if (delta != 0) {
+            direction_ = std::abs(delta) <= std::max(1, window.hq_radius) ? (delta > 0 ? 1 : -1) : 0;
+        }
+        const bool moved = !have_window_ || delta != 0;
+        window_ = window;
+        have_window_ = true;
+
+        for (auto& [key, entry] : entries_) entry.position = -1;
+        for (int32_t i = 0; i < count; ++i) entries_[keys[i]].position = window.first + i;
+        if (moved && window.centre >= window.first && window.centre - window.first < count) {
+            hq_.Touch(keys[window.centre - window.first]);
+        }
+
+        pending_.clear();
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            const int32_t key = it->first;
+            Entry& entry = it->second;
+            for (PrefetchTier tier : { PrefetchTier::Preview, PrefetchTier::Hq }) {
+                const int t = TierIndex(tier);
+                const bool inside = InWindowLocked(tier, entry.position);
+                if (entry.state[t] == State::Loaded && !inside && tier == PrefetchTier::Preview) {
+                    DropLocked(key, entry, tier);
+                    released.emplace_back(key, tier);
+                } else if (entry.state[t] == State::Queued) {
+                    entry.state[t] = State::None;
+                }
+                if (entry.state[t] == State::None && inside) QueueLocked(key, tier, entry.position);
+            }
+
+            State& disk = entry.state[TierIndex(PrefetchTier::DiskWrite)];
+            if (disk == State::Queued) {
+                disk = State::None;
+                if (entry.state[TierIndex(PrefetchTier::Preview)] == State::Loaded &&
+                    InWindowLocked(PrefetchTier::DiskWrite, entry.position)) {
+                    QueueLocked(key, PrefetchTier::DiskWrite, entry.position);
+                }
+            }
+
+            const bool idle = std::all_of(std::begin(entry.state), std::end(entry.state),
+                                          [](State s) { return s == State::None; });
+            it = entry.position < 0 && idle ? entries_.erase(it) : std::next(it);
+        }
+        TrimLocked(released);
+    }
+    cv_.notify_all();
+
+    for (const auto& [key, tier] : released) hooks_.release(hooks_.context, key, static_cast<int32_t>(tier));
+}
+
+/**
+ * @brief Keeps the best work that fits the budgets. First the HQ budget: retained HQ bitmaps
+ *        make room for the HQ loads the window wants. Then the overall budget: loaded results
+ *        and queued loads are walked in priority order, and loaded results past the budget are
+ *        released (and queued again if still in their window). Without this, previews left far
+ *        behind by a long walk hold the memory the photos ahead need until they leave the window.
+ */
+void PrefetchScheduler::TrimLocked(std::vector<std::pair<int32_t, PrefetchTier>>& released) {
+    EvictHqLocked(released);
+
+    struct Holding {
+        uint64_t priority;
+        int32_t key;
+        PrefetchTier tier;
+        bool loaded;
+    };
+    std::vector<Holding> order;
+    for (const auto& [key, entry] : entries_) {
+        if (entry.state[TierIndex(PrefetchTier::Preview)] == State::Loaded && entry.position >= 0) {
+            order.push_back({ PriorityLocked(PrefetchTier::Preview, entry.position), key, PrefetchTier::Preview, true });
+        }
+        if (entry.state[TierIndex(PrefetchTier::Hq)] == State::Loaded) {
+            const uint64_t priority = InWindowLocked(PrefetchTier::Hq, entry.position)
+                ? PriorityLocked(PrefetchTier::Hq, entry.position)
+                : kRetainedBase + std::min(kMaxRetainedScore, hq_.Score(key, BehindLocked(entry.position)));
+            order.push_back({ priority, key, PrefetchTier::Hq, true });
+        }
+    }
+    for (const Task& task : pending_) {
+        if (task.tier != PrefetchTier::DiskWrite) order.push_back({ task.priority, task.key, task.tier, false });
+    }
+    std::sort(order.begin(), order.end(), [](const Holding& a, const Holding& b) { return a.priority < b.priority; });
+
+    uint64_t used = in_flight_bytes_;
+    for (const Holding& h : order) {
+        Entry& entry = entries_[h.key];
+        const int t = TierIndex(h.tier);
+        used += h.loaded ? entry.bytes[t] : EstimateLocked(h.tier, h.key);
+        if (!h.loaded || used <= options_.memory_budget || entry.position == window_.centre) continue;
+        DropLocked(h.key, entry, h.tier);
+        released.emplace_back(h.key, h.tier);
+        if (InWindowLocked(h.tier, entry.position)) QueueLocked(h.key, h.tier, entry.position);
+    }
+}
+
+/**
+ * @brief Counts the queued HQ loads, best first, that could fit once every retained bitmap
+ *        was gone, and has the residency manager evict retained bitmaps until they do. Loads
+ *        that cannot fit anyway (a window of panoramas) do not cost the retained bitmaps.
+ *        Nothing is reserved while bursting; EndBurst() trims again.
+ */
+void PrefetchScheduler::EvictHqLocked(std::vector<std::pair<int32_t, PrefetchTier>>& released) {
+    const auto is_protected = [this](int32_t key) {
+        auto it = entries_.find(key);
+        return it != entries_.end() && InWindowLocked(PrefetchTier::Hq, it->second.position);
+    };
+    const auto is_behind = [this](int32_t key) {
+        auto it = entries_.find(key);
+        return it == entries_.end() || BehindLocked(it->second.position);
+    };
+
+    uint64_t need = 0;
+    if (!window_.burst) {
+        uint64_t kept = hq_in_flight_bytes_;
+        for (const auto& [key, entry] : entries_) {
+            if (entry.state[TierIndex(PrefetchTier::Hq)] == State::Loaded && is_protected(key)) {
+                kept += entry.bytes[TierIndex(PrefetchTier::Hq)];
+            }
+        }
+        const uint64_t budget = hq_.EffectiveBudget();
+        const uint64_t room = budget > kept ? budget - kept : 0;
+        for (const Task& task : pending_) {
+            if (task.tier != PrefetchTier::Hq) continue;
+            const uint64_t cost = EstimateLocked(PrefetchTier::Hq, task.key);
+            if (need + cost > room) break;
+            need += cost;
+        }
+    }
+
+    for (int32_t key : hq_.Evict(hq_in_flight_bytes_ + need, is_protected, is_behind)) {
+        auto it = entries_.find(key);
+        if (it == entries_.end()) continue;
+        Entry& entry = it->second;
+        resident_bytes_ -= entry.bytes[TierIndex(PrefetchTier::Hq)];
+        entry.bytes[TierIndex(PrefetchTier::Hq)] = 0;
+        entry.state[TierIndex(PrefetchTier::Hq)] = State::None;
+        released.emplace_back(key, PrefetchTier::Hq);
+    }
+}
+
+void PrefetchScheduler::DropLocked(int32_t key, Entry& entry, PrefetchTier tier) {
+    const int t = TierIndex(tier);
+    resident_bytes_ -= entry.bytes[t];
+    entry.bytes[t] = 0;
+    entry.state[t] = State::None;
+    if (tier == PrefetchTier::Hq) hq_.Erase(key);
+}
+
+/** @brief The held HQ loads now rank ahead of far previews, so the results are trimmed again. */
+void PrefetchScheduler::EndBurst() {
+    std::vector<std::pair<int32_t, PrefetchTier>> released;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        window_.burst = 0;
+        TrimLocked(released);
+    }
+    cv_.notify_all();
+
+    for (const auto& [key, tier] : released) hooks_.release(hooks_.context, key, static_cast<int32_t>(tier));
+}
+
+/** @brief Called from the preview's `load` hook, so the preview may still be running. */
+void PrefetchScheduler::QueueDiskWrite(int32_t key) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) return;
+        Entry& entry = it->second;
+        if (entry.position < 0 || entry.state[TierIndex(PrefetchTier::Preview)] == State::None ||
+            entry.state[TierIndex(PrefetchTier::DiskWrite)] != State::None) {
+            return;
+        }
+        QueueLocked(key, PrefetchTier::DiskWrite, entry.position);
+    }
+    cv_.notify_one();
+}
+
+void PrefetchScheduler::MarkLoaded(int32_t key, PrefetchTier tier, uint64_t bytes) {
+    if (tier == PrefetchTier::DiskWrite) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int t = TierIndex(tier);
+    Entry& entry = entries_[key];
+    if (entry.state[t] == State::Queued) {
+        for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+            if (it->key == key && it->tier == tier) {
+                pending_.erase(it);
+                break;
+            }
+        }
+    }
+    if (entry.state[t] == State::Loaded) resident_bytes_ -= entry.bytes[t];
+    entry.state[t] = State::Loaded;
+    entry.bytes[t] = bytes;
+    resident_bytes_ += bytes;
+    if (tier == PrefetchTier::Hq) hq_.Insert(key, bytes);
+}
+
+void PrefetchScheduler::SetHqSizeHint(int32_t key, uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) it->second.hq_hint = bytes;
+}
+
+void PrefetchScheduler::Unload(int32_t key, PrefetchTier tier) {
+    if (tier == PrefetchTier::DiskWrite) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) return;
+        const int t = TierIndex(tier);
+        Entry& entry = it->second;
+        if (entry.state[t] != State::Loaded) return;
+        DropLocked(key, entry, tier);
+    }
+    cv_.notify_all();
+}
+
+/** @brief A load still running for the key finds no entry when it finishes and is ignored. */
+void PrefetchScheduler::Forget(int32_t key) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) return;
+        for (auto task = pending_.begin(); task != pending_.end();) {
+            task = task->key == key ? pending_.erase(task) : std::next(task);
+        }
+        for (int t = 0; t < 2; ++t) {
+            if (it->second.state[t] == State::Loaded) resident_bytes_ -= it->second.bytes[t];
+        }
+        hq_.Erase(key);
+        entries_.erase(it);
+    }
+    cv_.notify_all();
+}
+
+bool PrefetchScheduler::IsLoaded(int32_t key, PrefetchTier tier) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    return it != entries_.end() && it->second.state[TierIndex(tier)] == State::Loaded;
+}
+
+void PrefetchScheduler::CountLoaded(PrefetchTier tier, int32_t pivot, int32_t& below, int32_t& above) const {
+    below = above = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [key, entry] : entries_) {
+        if (entry.state[TierIndex(tier)] != State::Loaded) continue;
+        if (key < pivot) ++below;
+        else if (key > pivot) ++above;
+    }
+}
+
+void PrefetchScheduler::GetStats(PrefetchStats& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.resident_bytes = resident_bytes_;
+    out.in_flight_bytes = in_flight_bytes_;
+    out.memory_budget = options_.memory_budget;
+    out.pending = static_cast<int32_t>(pending_.size());
+    out.running = running_;
+    out.direction = direction_;
+    out.held_by_memory = held_by_memory_ ? 1 : 0;
+    hq_.GetStats(out.hq);
+}
+
+void PrefetchScheduler::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        uint64_t estimate = 0;
+        auto it = pending_.end();
+        cv_.wait(lock, [&] { return stop_ || (it = PickLocked(estimate)) != pending_.end(); });
+        if (stop_) return;
+
+        const Task task = *it;
+        pending_.erase(it);
+        entries_[task.key].state[TierIndex(task.tier)] = State::Running;
+        ++running_;
+        in_flight_bytes_ += estimate;
+        if (task.tier == PrefetchTier::Hq) hq_in_flight_bytes_ += estimate;
+
+        lock.unlock();
+        const int64_t result = hooks_.load(hooks_.context, task.key, static_cast<int32_t>(task.tier));
+        lock.lock();
+
+        const bool recorded = FinishLocked(task, estimate, result);
+        cv_.notify_all();
+        if (recorded && hooks_.loaded) {
+            lock.unlock();
+            hooks_.loaded(hooks_.context, task.key, static_cast<int32_t>(task.tier));
+            lock.lock();
+        }
+    }
+}
+
+/**
+ * @brief The first task in priority order that may run now. HQ loads are skipped while
+ *        bursting. Once a load does not fit the memory budget no later load may start either,
+ *        so a large HQ bitmap is not starved by a stream of small previews; disk writes hold
+ *        no memory and still run.
+ */
+std::set<PrefetchScheduler::Task>::iterator PrefetchScheduler::PickLocked(uint64_t& estimate) {
+    held_by_memory_ = false;
+    for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+        if (it->tier == PrefetchTier::Hq && window_.burst) continue;
+        if (it->tier == PrefetchTier::DiskWrite) {
+            estimate = 0;
+            return it;
+        }
+        if (held_by_memory_) continue;
+
+        const uint64_t cost = EstimateLocked(it->tier, it->key);
+        auto entry = entries_.find(it->key);
+        const bool centre = entry != entries_.end() && entry->second.position == window_.centre;
+        const bool fits = resident_bytes_ + in_flight_bytes_ + cost <= options_.memory_budget &&
+            (it->tier != PrefetchTier::Hq || hq_.Resident() + hq_in_flight_bytes_ + cost <= hq_.EffectiveBudget());
+        if (centre || fits) {
+            estimate = cost;
+            return it;
+        }
+        held_by_memory_ = true;
+    }
+    return pending_.end();
+}
+
+/** @brief Returns true if a preview or HQ result was recorded as loaded. */
+bool PrefetchScheduler::FinishLocked(const Task& task, uint64_t estimate, int64_t result) {
+    --running_;
+    in_flight_bytes_ -= estimate;
+    if (task.tier == PrefetchTier::Hq) hq_in_flight_bytes_ -= estimate;
+
+    auto it = entries_.find(task.key);
+    if (it == entries_.end()) return false;
+    Entry& entry = it->second;
+    const int t = TierIndex(task.tier);
+    if (entry.state[t] != State::Running) return false;
+
+    if (task.tier == PrefetchTier::DiskWrite) {
+        entry.state[t] = State::None;
+    } else if (result >= 0) {
+        entry.state[t] = State::Loaded;
+        entry.bytes[t] = static_cast<uint64_t>(result);
+        resident_bytes_ += entry.bytes[t];
+        ++loaded_count_[t];
+        loaded_bytes_[t] += entry.bytes[t];
+        if (task.tier == PrefetchTier::Hq) hq_.Insert(task.key, entry.bytes[t]);
+        return true;
+    } else {
+        // A dropped load is queued again by the next MoveWindow, a stale one right away.
+        entry.state[t] = State::None;
+        if (result == kPrefetchLoadRetry && InWindowLocked(task.tier, entry.position)) {
+            QueueLocked(task.key, task.tier, entry.position);
+        }
+    }
+    return false;
+}
+
+void PrefetchScheduler::QueueLocked(int32_t key, PrefetchTier tier, int32_t position) {
+    entries_[key].state[TierIndex(tier)] = State::Queued;
+    pending_.insert(Task{ PriorityLocked(tier, position), next_sequence_++, key, tier });
+}
+
+/**
+ * @brief Distance in half steps: ahead of the centre at d costs 2d, behind it costs 2d + 1
+ *        when standing still and weighted further when moving. Loads interleave by distance,
+ *        preview before HQ; disk writes follow all loads.
+ */
+uint64_t PrefetchScheduler::PriorityLocked(PrefetchTier tier, int32_t position) const {
+    const int32_t offset = position - window_.centre;
+    const uint64_t distance = static_cast<uint64_t>(std::abs(offset));
+    const bool ahead = direction_ == 0 ? offset >= 0 : offset * direction_ >= 0;
+    const uint64_t weight = window_.behind_weight > 0 ? static_cast<uint64_t>(window_.behind_weight)
+        : window_.burst ? kBehindWeightBurst : kBehindWeight;
+    uint64_t rank = 2 * distance;
+    if (!ahead) rank = direction_ == 0 ? rank + 1 : rank * weight + 1;
+    if (tier == PrefetchTier::DiskWrite) return kDiskWriteBase + rank;
+    return rank * 2 + static_cast<uint64_t>(TierIndex(tier));
+}
+
+/**
+ * @brief The key's HQ size hint if it has one, else the running average of completed loads of
+ *        the tier, or the configured guess before any.
+ */
+uint64_t PrefetchScheduler::EstimateLocked(PrefetchTier tier, int32_t key) const {
+    const int t = TierIndex(tier);
+    if (tier == PrefetchTier::Hq) {
+        auto it = entries_.find(key);
+        if (it != entries_.end() && it->second.hq_hint > 0) return it->second.hq_hint;
+    }
+    if (loaded_count_[t] == 0) return tier == PrefetchTier::Hq ? options_.hq_estimate : options_.preview_estimate;
+    return std::max<uint64_t>(1, loaded_bytes_[t] / loaded_count_[t]);
+}
+
+bool PrefetchScheduler::InWindowLocked(PrefetchTier tier, int32_t position) const {
+    if (position < 0 || !have_window_) return false;
+    const int32_t offset = position - window_.centre;
+    const bool behind = window_.direction != 0 && offset * window_.direction < 0;
+    const int32_t radius = tier == PrefetchTier::Hq ? (behind ? window_.hq_behind : window_.hq_radius)
+                                                    : (behind ? window_.preview_behind : window_.preview_radius);
+    return std::abs(offset) <= radius;
+}
+
+/** @brief Outside the window counts as behind: nothing suggests the user is heading there. */
+bool PrefetchScheduler::BehindLocked(int32_t position) const {
+    if (position < 0) return true;
+    const int32_t offset = position - window_.centre;
+    return direction_ == 0 ? false : offset * direction_ < 0;
+}
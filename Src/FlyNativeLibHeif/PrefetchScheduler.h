@@ -0,0 +1,217 @@
+/**
+ * @file PrefetchScheduler.h
+ * @brief Declares PrefetchScheduler, which orders and runs the viewer's background photo loads.
+ *
+ * The viewer keeps a sliding window of photos loaded around the one on screen: previews for a
+ * wide radius, HQ bitmaps for a narrow one, and a disk-cache write for every preview that had
+ * to be decoded. PrefetchScheduler owns that window and the work it implies.
+ *
+ * - The window is a centre position, a radius per tier, the direction of travel (derived from
+ *   successive centres) and a burst flag set while a navigation key is held. A PrefetchPlan
+ *   from NavigationPredictor may set the direction and give each side its own radii.
+ * - All pending work sits in one queue ordered by distance from the centre, photos ahead in
+ *   the direction of travel first. A preview and an HQ load at the same distance are adjacent,
+ *   so the neighbours' HQ bitmaps are not stuck behind two hundred far previews. Disk writes
+ *   run only when nothing else can.
+ * - One worker pool serves every tier.
+ * - Memory is bounded by a budget rather than a count: a load starts only if the bytes held by
+ *   loaded photos plus an estimate for every load in flight stay under it, and each window
+ *   move releases the loaded photos that rank past the budget, so the window shrinks to what
+ *   fits. The centre photo is always admitted.
+ * - HQ loads are held while bursting, so photos being skipped past are not decoded.
+ * - HQ bitmaps have their own byte budget, kept by a ResidencyManager: they stay resident after
+ *   leaving the HQ radius until their room is needed, and an HQ load is admitted by its
+ *   expected size (SetHqSizeHint()) rather than by a neighbour count, so a window of panoramas
+ *   holds fewer of them than a window of small PNGs.
+ *
+ * The loads themselves are done by the owner through the `load` hook and announced through
+ * `loaded` once recorded; photos that leave the window are handed back through `release`.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef PREFETCH_SCHEDULER_H
+#define PREFETCH_SCHEDULER_H
+
+#include "ResidencyManager.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// @brief The kinds of work the scheduler runs.
+enum class PrefetchTier : int32_t {
+    Preview = 0,
+    Hq = 1,
+    DiskWrite = 2,      ///< Writes a decoded preview to the disk cache; holds no memory.
+};
+
+/// @brief Return values of the `load` hook other than a byte count.
+enum : int64_t {
+    kPrefetchLoadDropped = -1,      ///< Nothing was loaded; tried again after the window moves.
+    kPrefetchLoadRetry = -2,        ///< The result was stale; load again if still in the window.
+};
+
+/// @brief Callbacks into the owner. Blittable for P/Invoke.
+struct PrefetchHooks {
+    /// Loads `key` for `tier` on a worker thread. Returns the bytes the result holds, or a kPrefetchLoad value.
+    int64_t (*load)(void* context, int32_t key, int32_t tier);
+    /// Frees the `tier` result of a key that left the window. Called on the thread that moved the window.
+    void (*release)(void* context, int32_t key, int32_t tier);
+    /// Reports a recorded result, once IsLoaded() is true for it. Optional; called on the worker thread.
+    void (*loaded)(void* context, int32_t key, int32_t tier);
+    void* context;
+};
+
+/// @brief Tuning. Blittable for P/Invoke; zero fields take the defaults.
+struct PrefetchOptions {
+    int32_t threads;                    ///< Worker threads; 0 for the hardware threads.
+    uint32_t reserved;
+    uint64_t memory_budget;             ///< Bytes loaded photos may hold; 0 for 1 GiB.
+    uint64_t preview_estimate;          ///< Bytes assumed per preview until some have loaded; 0 for 4 MiB.
+    uint64_t hq_estimate;               ///< Bytes assumed per HQ bitmap without a size hint; 0 for 96 MiB.
+    uint64_t hq_budget;                 ///< Bytes HQ bitmaps may hold, at most `memory_budget`; 0 for all of it.
+    uint64_t system_reserve;            ///< Physical memory HQ bitmaps must leave available; 0 for a tenth, at least 512 MB.
+};
+
+/// @brief A window position. Blittable for P/Invoke.
+///
+/// With `direction` 0 the radii apply to both sides and the direction is derived from successive
+/// centres. A NavigationPredictor plan sets `direction` and then the radii are those ahead, the
+/// `_behind` fields those behind.
+struct PrefetchWindow {
+    int32_t centre;                     ///< Position of the photo on screen.
+    int32_t first;                      ///< Position of keys[0].
+    int32_t preview_radius;
+    int32_t hq_radius;
+    int32_t burst;                      ///< Non-zero while a navigation key is held.
+    int32_t direction;                  ///< -1 or 1 from a plan, or 0.
+    int32_t preview_behind;             ///< Preview radius behind `direction`; unused if it is 0.
+    int32_t hq_behind;                  ///< HQ radius behind `direction`; unused if it is 0.
+    int32_t behind_weight;              ///< Rank multiplier for photos behind; 0 for the default.
+};
+
+/// @brief Memory and queue counters. Blittable for P/Invoke.
+struct PrefetchStats {
+    uint64_t resident_bytes;            ///< Held by loaded previews and HQ bitmaps.
+    uint64_t in_flight_bytes;           ///< Estimated for the loads running now.
+    uint64_t memory_budget;
+    int32_t pending;
+    int32_t running;
+    int32_t direction;                  ///< -1, 0 or 1.
+    int32_t held_by_memory;             ///< 1 if the best pending load waits for memory.
+    ResidencyStats hq;                  ///< Resident HQ bitmaps against their budget.
+};
+
+/// @brief Runs the window's loads on a shared pool, nearest and most memory-affordable first.
+class PrefetchScheduler {
+public:
+    PrefetchScheduler(const PrefetchHooks& hooks, const PrefetchOptions& options);
+    ~PrefetchScheduler();
+
+    PrefetchScheduler(const PrefetchScheduler&) = delete;
+    PrefetchScheduler& operator=(const PrefetchScheduler&) = delete;
+
+    /// @brief Starts the worker pool. Loads are queued but not run before this.
+    void Start();
+
+    /// @brief Stops the pool after the loads in progress. Never call it from a hook.
+    void Stop();
+
+    /// @brief Keeps queued loads from starting and lets idle workers exit, without waiting for
+    ///        the loads in progress. Stop() or the destructor still joins the workers.
+    void Cancel();
+
+    /// @brief Re-centres the window on the keys at positions [first, first + count).
+    ///        Releases results outside it and queues what is missing inside it.
+    ///        An empty key list forgets every result without releasing it.
+    void MoveWindow(const PrefetchWindow& window, const int32_t* keys, int32_t count);
+
+    /// @brief Ends a burst, letting held HQ loads run. May release results, like MoveWindow.
+    void EndBurst();
+
+    /// @brief Queues a disk-cache write for a key whose preview is loaded.
+    void QueueDiskWrite(int32_t key);
+
+    /// @brief Sets the expected size of a key's HQ bitmap (width x height x 4), used to admit its load.
+    void SetHqSizeHint(int32_t key, uint64_t bytes);
+
+    /// @brief Records a result loaded outside the scheduler (e.g. the first photo).
+    void MarkLoaded(int32_t key, PrefetchTier tier, uint64_t bytes);
+
+    /// @brief Forgets a result the owner has freed itself. It is queued again by the next MoveWindow.
+    void Unload(int32_t key, PrefetchTier tier);
+
+    /// @brief Forgets every result of a key without releasing it (e.g. the photo was deleted).
+    void Forget(int32_t key);
+
+    bool IsLoaded(int32_t key, PrefetchTier tier) const;
+
+    /// @brief Counts loaded results of `tier` with keys below and above `pivot`.
+    void CountLoaded(PrefetchTier tier, int32_t pivot, int32_t& below, int32_t& above) const;
+
+    void GetStats(PrefetchStats& out);
+
+private:
+    enum class State : uint8_t { None, Queued, Running, Loaded };
+
+    struct Entry {
+        int32_t position = -1;              // In the current window, or -1.
+        State state[3] = {};
+        uint64_t bytes[2] = {};             // Held by the loaded preview and HQ results.
+        uint64_t hq_hint = 0;               // Expected HQ bytes, or 0.
+    };
+
+    struct Task {
+        uint64_t priority;
+        uint64_t sequence;
+        int32_t key;
+        PrefetchTier tier;
+        bool operator<(const Task& other) const {
+            return priority != other.priority ? priority < other.priority : sequence < other.sequence;
+        }
+    };
+
+    void WorkerLoop();
+    std::set<Task>::iterator PickLocked(uint64_t& estimate);
+    void TrimLocked(std::vector<std::pair<int32_t, PrefetchTier>>& released);
+    bool FinishLocked(const Task& task, uint64_t estimate, int64_t result);
+    void DropLocked(int32_t key, Entry& entry, PrefetchTier tier);
+    void EvictHqLocked(std::vector<std::pair<int32_t, PrefetchTier>>& released);
+    void QueueLocked(int32_t key, PrefetchTier tier, int32_t position);
+    uint64_t PriorityLocked(PrefetchTier tier, int32_t position) const;
+    uint64_t EstimateLocked(PrefetchTier tier, int32_t key) const;
+    bool InWindowLocked(PrefetchTier tier, int32_t position) const;
+    bool BehindLocked(int32_t position) const;
+
+    PrefetchHooks hooks_;
+    PrefetchOptions options_;
+    ResidencyManager hq_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<int32_t, Entry> entries_;
+    std::set<Task> pending_;
+    PrefetchWindow window_{};
+    int32_t direction_ = 0;
+    bool have_window_ = false;
+    uint64_t next_sequence_ = 0;
+    uint64_t resident_bytes_ = 0;
+    uint64_t in_flight_bytes_ = 0;
+    uint64_t hq_in_flight_bytes_ = 0;
+    uint64_t loaded_count_[2] = {};         // Completed loads, for the running average estimate.
+    uint64_t loaded_bytes_[2] = {};
+    int32_t running_ = 0;
+    bool held_by_memory_ = false;
+    bool stop_ = false;
+
+    std::vector<std::thread> workers_;
+};
+
+#endif // PREFETCH_SCHEDULER_H
@@ -0,0 +1,396 @@
+/**
+ * @file PsdDecoder.cpp
+ * @brief Implements PsdDecoder.
+ */
+
+#include "PsdDecoder.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLY_PSD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    enum ColorMode : int32_t { Grayscale = 1, Rgb = 3, Cmyk = 4, Duotone = 8 };
+
+    uint16_t BE16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+
+    uint32_t BE32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    uint64_t BE64(const uint8_t* p) { return (static_cast<uint64_t>(BE32(p)) << 32) | BE32(p + 4); }
+
+    bool IsType(const uint8_t* p, const char* type) { return std::memcmp(p, type, 4) == 0; }
+
+    /// Colour channels before the extra ones: the alpha, when there is one, follows them.
+    int32_t BaseChannels(int32_t color_mode) {
+        switch (color_mode) {
+        case Rgb: return 3;
+        case Cmyk: return 4;
+        case Grayscale:
+        case Duotone: return 1;
+        default: return 0;
+        }
+    }
+
+    /// round(c * a / 255) without a division.
+    inline uint32_t Scale(uint32_t c, uint32_t a) {
+        const uint32_t v = c * a + 128;
+        return (v + (v >> 8)) >> 8;
+    }
+
+    size_t UnpackRowScalar(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size) {
+        const uint8_t* end = src + src_size;
+        size_t out = 0;
+        while (src < end && out < dst_size) {
+            const int n = static_cast<int8_t>(*src++);
+            if (n >= 0) {
+                const size_t count = static_cast<size_t>(n) + 1;
+                if (count > static_cast<size_t>(end - src) || count > dst_size - out) break;
+                std::memcpy(dst + out, src, count);
+                src += count;
+                out += count;
+            } else if (n != -128) {
+                const size_t count = std::min(static_cast<size_t>(1 - n), dst_size - out);
+                if (src == end) break;
+                std::memset(dst + out, *src++, count);
+                out += count;
+            }
+        }
+        return out;
+    }
+
+    void InterleaveRowScalar(const uint8_t* r, const uint8_t* g, const uint8_t* b, const uint8_t* a, int32_t count,
+                             uint8_t* bgra) {
+        for (int32_t i = 0; i < count; ++i, bgra += 4) {
+            const uint32_t alpha = a ? a[i] : 255;
+            if (alpha == 255) {
+                bgra[0] = b[i];
+                bgra[1] = g[i];
+                bgra[2] = r[i];
+            } else {
+                bgra[0] = static_cast<uint8_t>(Scale(b[i], alpha));
+                bgra[1] = static_cast<uint8_t>(Scale(g[i], alpha));
+                bgra[2] = static_cast<uint8_t>(Scale(r[i], alpha));
+            }
+            bgra[3] = static_cast<uint8_t>(alpha);
+        }
+    }
+
+#ifdef FLY_PSD_SSE2
+    // Literals and runs are written 16 bytes at a time; the last store of each may run up to
+    // 15 bytes past it, into the next one or the caller's slack. Literals are read the same way
+    // only while 16 bytes of the row remain, so the source is never over-read.
+
+    size_t UnpackRowSse2(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size) {
+        const uint8_t* end = src + src_size;
+        size_t out = 0;
+        while (src < end && out < dst_size) {
+            const int n = static_cast<int8_t>(*src++);
+            if (n >= 0) {
+                const size_t count = static_cast<size_t>(n) + 1;
+                const size_t available = static_cast<size_t>(end - src);
+                if (count > available || count > dst_size - out) break;
+                if (available >= ((count + 15) & ~size_t(15))) {
+                    for (size_t i = 0; i < count; i += 16) {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + out + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+                    }
+                } else {
+                    std::memcpy(dst + out, src, count);
+                }
+                src += count;
+                out += count;
+            } else if (n != -128) {
+                const size_t count = std::min(static_cast<size_t>(1 - n), dst_size - out);
+                if (src == end) break;
+                const __m128i value = _mm_set1_epi8(static_cast<char>(*src++));
+                for (size_t i = 0; i < count; i += 16) _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + out + i), value);
+                out += count;
+            }
+        }
+        return out;
+    }
+
+    /// Eight samples as 16-bit lanes scaled by alpha, with Scale()'s rounding.
+    inline __m128i Scale16(__m128i c, __m128i a) {
+        const __m128i v = _mm_add_epi16(_mm_mullo_epi16(c, a), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+    }
+
+    inline __m128i Premultiply8(__m128i c, __m128i a) {
+        const __m128i zero = _mm_setzero_si128();
+        return _mm_packus_epi16(Scale16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(a, zero)),
+                                Scale16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(a, zero)));
+    }
+
+    void InterleaveRowSse2(const uint8_t* r, const uint8_t* g, const uint8_t* b, const uint8_t* a, int32_t count,
+                           uint8_t* bgra) {
+        const __m128i opaque = _mm_set1_epi8(-1);
+        int32_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i red = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i));
+            __m128i green = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g + i));
+            __m128i blue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            const __m128i alpha = a ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)) : opaque;
+            if (a && _mm_movemask_epi8(_mm_cmpeq_epi8(alpha, opaque)) != 0xFFFF) {
+                red = Premultiply8(red, alpha);
+                green = Premultiply8(green, alpha);
+                blue = Premultiply8(blue, alpha);
+            }
+            const __m128i bg_lo = _mm_unpacklo_epi8(blue, green);
+            const __m128i bg_hi = _mm_unpackhi_epi8(blue, green);
+            const __m128i ra_lo = _mm_unpacklo_epi8(red, alpha);
+            const __m128i ra_hi = _mm_unpackhi_epi8(red, alpha);
+            __m128i* out = reinterpret_cast<__m128i*>(bgra + static_cast<size_t>(i) * 4);
+            _mm_storeu_si128(out, _mm_unpacklo_epi16(bg_lo, ra_lo));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(bg_lo, ra_lo));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(bg_hi, ra_hi));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(bg_hi, ra_hi));
+        }
+        InterleaveRowScalar(r + i, g + i, b + i, a ? a + i : nullptr, count - i, bgra + static_cast<size_t>(i) * 4);
+    }
+#endif
+}
+
+void PsdDecoder::SetSimd(bool enabled) {
+    unpack_ = &UnpackRowScalar;
+    interleave_ = &InterleaveRowScalar;
+#ifdef FLY_PSD_SSE2
+    if (enabled && CpuFeatures::Level() >= SimdLevel::Sse2) {
+        unpack_ = &UnpackRowSse2;
+        interleave_ = &InterleaveRowSse2;
+    }
+#else
+    (void)enabled;
+#endif
+}
+
+/**
+ * @brief Every section is skipped by its length, so the time taken does not depend on the size
+ *        of the layers. PSB widens the layer and mask lengths, and the RLE row counts, to 64 and
+ *        32 bits.
+ */
+bool PsdDecoder::Open(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    info_ = PsdInfo{};
+    merged_alpha_ = false;
+    image_data_ = 0;
+    if (!data || size < 26 || !IsType(data, "8BPS")) return false;
+
+    info_.version = BE16(data + 4);
+    info_.channels = BE16(data + 12);
+    info_.height = static_cast<int32_t>(BE32(data + 14));
+    info_.width = static_cast<int32_t>(BE32(data + 18));
+    info_.depth = BE16(data + 22);
+    info_.color_mode = BE16(data + 24);
+    if ((info_.version != 1 && info_.version != 2) || info_.channels < 1 || info_.width <= 0 || info_.height <= 0) return false;
+
+    size_t pos = 26;
+    if (size - pos < 4) return false;
+    const size_t color_data = BE32(data + pos);
+    if (color_data > size - pos - 4) return false;
+    pos += 4 + color_data;
+
+    if (size - pos < 4) return false;
+    const size_t resources = BE32(data + pos);
+    if (resources > size - pos - 4) return false;
+    const bool real_merged = ReadResources(pos + 4, pos + 4 + resources);
+    pos += 4 + resources;
+
+    const size_t length_bytes = info_.version == 2 ? 8 : 4;
+    if (size - pos < length_bytes) return false;
+    const uint64_t layers = length_bytes == 8 ? BE64(data + pos) : BE32(data + pos);
+    if (layers > size - pos - length_bytes) return false;
+    ReadLayerCount(pos + length_bytes, pos + length_bytes + static_cast<size_t>(layers));
+    pos += length_bytes + static_cast<size_t>(layers);
+
+    if (size - pos < 2) return false;
+    info_.compression = BE16(data + pos);
+    image_data_ = pos + 2;
+
+    const int32_t base = BaseChannels(info_.color_mode);
+    info_.has_alpha = base && merged_alpha_ && info_.channels > base ? 1 : 0;
+    info_.can_decode = real_merged && base && info_.channels >= base && (info_.depth == 8 || info_.depth == 16) &&
+                       (info_.compression == 0 || info_.compression == 1) &&
+                       static_cast<int64_t>(info_.width) * info_.height <= kMaxPixels ? 1 : 0;
+    return true;
+}
+
+/**
+ * @brief Records the thumbnail and reads the version info resource.
+ * @return false only if resource 1057 says the composite is not a real merge of the layers.
+ */
+bool PsdDecoder::ReadResources(size_t pos, size_t end) {
+    bool real_merged = true;
+    size_t thumbnail_v4 = 0, thumbnail_v4_size = 0;
+    while (end - pos >= 12) {
+        const uint8_t* block = data_ + pos;
+        const uint16_t id = BE16(block + 4);
+        const size_t name = (static_cast<size_t>(block[6]) + 2) & ~size_t(1);    // Length byte and name, padded to even.
+        if (end - pos < 6 + name + 4) break;
+        const size_t length = BE32(block + 6 + name);
+        const size_t start = pos + 6 + name + 4;
+        if (length > end - start) break;
+        const uint8_t* payload = data_ + start;
+
+        if ((id == 1036 || id == 1033) && length > 28 && BE32(payload) == 1) {
+            if (id == 1036) {
+                info_.thumbnail_offset = static_cast<int64_t>(start + 28);
+                info_.thumbnail_size = static_cast<int64_t>(length - 28);
+                info_.thumbnail_width = static_cast<int32_t>(BE32(payload + 4));
+                info_.thumbnail_height = static_cast<int32_t>(BE32(payload + 8));
+            } else {
+                thumbnail_v4 = start;
+                thumbnail_v4_size = length;
+            }
+        } else if (id == 1057 && length >= 5) {
+            real_merged = payload[4] != 0;
+        }
+        pos = start + length + (length & 1);
+        if (pos > end) break;
+    }
+    if (!info_.thumbnail_size && thumbnail_v4) {
+        info_.thumbnail_offset = static_cast<int64_t>(thumbnail_v4 + 28);
+        info_.thumbnail_size = static_cast<int64_t>(thumbnail_v4_size - 28);
+        info_.thumbnail_width = static_cast<int32_t>(BE32(data_ + thumbnail_v4 + 4));
+        info_.thumbnail_height = static_cast<int32_t>(BE32(data_ + thumbnail_v4 + 8));
+    }
+    return real_merged;
+}
+
+/**
+ * @brief Reads the layer count's sign. 16- and 32-bit documents keep their layer info in an
+ *        Lr16 or Lr32 block after the global layer mask, with the usual layer info left empty.
+ */
+void PsdDecoder::ReadLayerCount(size_t pos, size_t end) {
+    const bool psb = info_.version == 2;
+    const size_t length_bytes = psb ? 8 : 4;
+    if (end - pos < length_bytes) return;
+    const uint64_t layer_info = psb ? BE64(data_ + pos) : BE32(data_ + pos);
+    if (layer_info > end - pos - length_bytes) return;
+    if (layer_info >= 2) {
+        merged_alpha_ = static_cast<int16_t>(BE16(data_ + pos + length_bytes)) < 0;
+        return;
+    }
+    pos += length_bytes + static_cast<size_t>(layer_info);
+
+    if (end - pos < 4) return;
+    const size_t global_mask = BE32(data_ + pos);
+    if (global_mask > end - pos - 4) return;
+    pos += 4 + global_mask;
+
+    while (end - pos >= 12) {
+        const uint8_t* block = data_ + pos;
+        if (!IsType(block, "8BIM") && !IsType(block, "8B64")) return;
+        const uint8_t* key = block + 4;
+        // PSB widens the length of these keys only.
+        const bool wide = psb && (IsType(key, "LMsk") || IsType(key, "Lr16") || IsType(key, "Lr32") || IsType(key, "Layr") ||
+                                  IsType(key, "Mt16") || IsType(key, "Mt32") || IsType(key, "Mtrn") || IsType(key, "Alph") ||
+                                  IsType(key, "FMsk") || IsType(key, "lnk2") || IsType(key, "FEid") || IsType(key, "FXid") ||
+                                  IsType(key, "PxSD"));
+        const size_t header = wide ? 16 : 12;
+        if (end - pos < header) return;
+        const uint64_t length = wide ? BE64(block + 8) : BE32(block + 8);
+        if (length > end - pos - header) return;
+        if ((IsType(key, "Lr16") || IsType(key, "Lr32") || IsType(key, "Layr")) && length >= 2) {
+            merged_alpha_ = static_cast<int16_t>(BE16(block + header)) < 0;
+            return;
+        }
+        pos += header + static_cast<size_t>(length);
+    }
+    return;
+}
+
+/**
+ * @brief Offsets of the first `rows` RLE rows, channel after channel, plus the end of the last.
+ */
+bool PsdDecoder::RowOffsets(size_t rows, std::vector<uint64_t>& offsets) const {
+    const size_t count_bytes = info_.version == 2 ? 4 : 2;
+    const uint64_t table = static_cast<uint64_t>(info_.channels) * info_.height * count_bytes;
+    if (table > size_ - image_data_) return false;
+
+    offsets.resize(rows + 1);
+    const uint8_t* counts = data_ + image_data_;
+    uint64_t offset = image_data_ + table;
+    for (size_t i = 0; i < rows; ++i) {
+        offsets[i] = offset;
+        offset += count_bytes == 4 ? BE32(counts + i * 4) : BE16(counts + i * 2);
+    }
+    offsets[rows] = offset;
+    return offset <= size_;
+}
+
+const uint8_t* PsdDecoder::ChannelRow(int32_t channel, int32_t y, const std::vector<uint64_t>& offsets, std::vector<uint8_t>& packed,
+                                      std::vector<uint8_t>& narrow) const {
+    const size_t row_bytes = static_cast<size_t>(info_.width) * (info_.depth / 8);
+    const size_t row = static_cast<size_t>(channel) * info_.height + y;
+    const uint8_t* samples;
+    if (info_.compression == 0) {
+        samples = data_ + image_data_ + row * row_bytes;
+    } else {
+        const size_t written = unpack_(data_ + offsets[row], static_cast<size_t>(offsets[row + 1] - offsets[row]), packed.data(), row_bytes);
+        std::memset(packed.data() + written, 0, row_bytes - written);
+        samples = packed.data();
+    }
+    if (info_.depth == 8) return samples;
+
+    for (int32_t x = 0; x < info_.width; ++x) narrow[x] = static_cast<uint8_t>((BE16(samples + x * 2) * 255u + 32767u) / 65535u);
+    return narrow.data();
+}
+
+/**
+ * @brief Decodes the composite a row at a time: the channels of one row are unpacked into
+ *        small buffers, so memory besides the output stays a few rows whatever the image size.
+ *        CMYK is stored inverted (255 is no ink), so red is simply C * K / 255.
+ */
+bool PsdDecoder::Decode(uint8_t* bgra, size_t stride) const {
+    if (!info_.can_decode || !bgra) return false;
+    const int32_t base = BaseChannels(info_.color_mode);
+    const int32_t used = base + info_.has_alpha;
+    const size_t width = static_cast<size_t>(info_.width);
+    const size_t row_bytes = width * (info_.depth / 8);
+
+    std::vector<uint64_t> offsets;
+    if (info_.compression == 1) {
+        if (!RowOffsets(static_cast<size_t>(used) * info_.height, offsets)) return false;
+    } else if (static_cast<uint64_t>(used) * info_.height * row_bytes > size_ - image_data_) {
+        return false;
+    }
+
+    std::vector<uint8_t> packed[5], narrow[5], rgb[3];
+    for (int32_t c = 0; c < used; ++c) {
+        if (info_.compression == 1) packed[c].resize(row_bytes + kUnpackSlack);
+        if (info_.depth == 16) narrow[c].resize(width);
+    }
+    if (info_.color_mode == Cmyk) {
+        for (auto& plane : rgb) plane.resize(width);
+    }
+
+    const uint8_t* rows[5] = {};
+    for (int32_t y = 0; y < info_.height; ++y) {
+        for (int32_t c = 0; c < used; ++c) rows[c] = ChannelRow(c, y, offsets, packed[c], narrow[c]);
+        const uint8_t* alpha = info_.has_alpha ? rows[base] : nullptr;
+        uint8_t* out = bgra + static_cast<size_t>(y) * stride;
+        if (info_.color_mode == Cmyk) {
+            for (size_t x = 0; x < width; ++x) {
+                const uint32_t k = rows[3][x];
+                rgb[0][x] = static_cast<uint8_t>(Scale(rows[0][x], k));
+                rgb[1][x] = static_cast<uint8_t>(Scale(rows[1][x], k));
+                rgb[2][x] = static_cast<uint8_t>(Scale(rows[2][x], k));
+            }
+            interleave_(rgb[0].data(), rgb[1].data(), rgb[2].data(), alpha, info_.width, out);
+        } else if (base == 1) {
+            interleave_(rows[0], rows[0], rows[0], alpha, info_.width, out);
+        } else {
+            interleave_(rows[0], rows[1], rows[2], alpha, info_.width, out);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file PsdDecoder.h
+ * @brief Declares PsdDecoder, a Photoshop PSD/PSB parser and composite decoder.
+ *
+ * Open() walks the file's sections by their length fields: the header, the colour mode data,
+ * the image resources, and the layer and mask information. It reads only their headers, so a
+ * 500 MB PSD costs a few page faults. It records:
+ *
+ * - Where the JPEG thumbnail is. Resource 1036 is preferred, then 1033 (Photoshop 4, whose
+ *   JPEG has its red and blue swapped; it is used as it is).
+ * - Whether the file has a real merged composite. Resource 1057 says when "maximize
+ *   compatibility" was off.
+ * - Whether the composite's first extra channel is its transparency. The layer count is
+ *   negative in that case.
+ *
+ * Decode() turns the merged composite into premultiplied BGRA one row at a time. Each row of
+ * each channel is unpacked from PackBits (16 bytes per SSE2 store) or read raw, narrowed from
+ * 16 bits, converted from CMYK or grayscale, and interleaved. The interleave premultiplies 16
+ * pixels per SSE2 step and takes a shortcut for opaque runs. Only 8- and 16-bit RGB, CMYK,
+ * grayscale and duotone composites, raw or RLE, are decoded. Others are left to a general
+ * decoder.
+ *
+ * The file data is not copied and must outlive the decoder. Not thread-safe.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef PSD_DECODER_H
+#define PSD_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief What Open() found. Blittable for P/Invoke.
+struct PsdInfo {
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    int32_t depth;                      ///< Bits per channel: 1, 8, 16 or 32.
+    int32_t color_mode;                 ///< As the header stores it: 1 grayscale, 3 RGB, 4 CMYK, 8 duotone...
+    int32_t version;                    ///< 1 for PSD, 2 for PSB.
+    int32_t compression;                ///< Of the composite: 0 raw, 1 RLE, 2 and 3 ZIP.
+    int32_t has_alpha;                  ///< 1 if the composite carries its transparency.
+    int32_t can_decode;                 ///< 1 if Decode() handles the composite.
+    int32_t thumbnail_width;            ///< Of the JPEG thumbnail; 0 if there is none.
+    int32_t thumbnail_height;
+    int32_t reserved;
+    int64_t thumbnail_offset;           ///< File offset of the thumbnail's JPEG data.
+    int64_t thumbnail_size;             ///< Bytes of JPEG data; 0 if there is none.
+};
+
+/// @brief Parses a PSD or PSB in memory and decodes its merged composite.
+class PsdDecoder {
+public:
+    /// Composites larger than this many pixels are not decoded.
+    static constexpr int64_t kMaxPixels = 1ll << 28;
+
+    /// @brief Expands one PackBits row from `src` into `dst`.
+    /// @details `dst` must have room for kUnpackSlack bytes past `dst_size`.
+    /// @return The bytes written, at most `dst_size`; fewer if the row is corrupt.
+    using UnpackRowFn = size_t (*)(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size);
+
+    /// @brief Interleaves `count` pixels of 8-bit planes into premultiplied BGRA. `a` may be null for opaque.
+    using InterleaveRowFn = void (*)(const uint8_t* r, const uint8_t* g, const uint8_t* b, const uint8_t* a, int32_t count,
+                                     uint8_t* bgra);
+
+    /// Bytes an UnpackRowFn may write past the end of its row.
+    static constexpr size_t kUnpackSlack = 16;
+
+    PsdDecoder() { SetSimd(true); }
+
+    /// @brief Parses `data` up to the composite's compression field.
+    /// @return false if the data is not a PSD or PSB, or its sections run past the end.
+    bool Open(const uint8_t* data, size_t size);
+
+    const PsdInfo& Info() const { return info_; }
+
+    /// @brief The thumbnail's JPEG data, `Info().thumbnail_size` bytes, or null if there is none.
+    const uint8_t* Thumbnail() const { return info_.thumbnail_size ? data_ + info_.thumbnail_offset : nullptr; }
+
+    /// @brief Decodes the composite into `bgra`, `Info().height` rows of `stride` bytes.
+    /// @details A corrupt row is finished with zeros rather than failing the whole image.
+    /// @return false if `Info().can_decode` is 0 or the channel data runs past the end of the file.
+    bool Decode(uint8_t* bgra, size_t stride) const;
+
+    /// @brief Selects the unpack and interleave kernels: SSE2 where the CPU has it, or scalar.
+    void SetSimd(bool enabled);
+
+private:
+    bool ReadResources(size_t pos, size_t end);
+    void ReadLayerCount(size_t pos, size_t end);
+    bool RowOffsets(size_t rows, std::vector<uint64_t>& offsets) const;
+
+    /// Row `y` of channel `channel` as 8-bit samples: a pointer into the file, or `packed` or `narrow` filled.
+    const uint8_t* ChannelRow(int32_t channel, int32_t y, const std::vector<uint64_t>& offsets, std::vector<uint8_t>& packed,
+                              std::vector<uint8_t>& narrow) const;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    PsdInfo info_{};
+    bool merged_alpha_ = false;         // The layer count was negative.
+    size_t image_data_ = 0;             // The composite's first byte, after its compression field.
+
+    UnpackRowFn unpack_ = nullptr;
+    InterleaveRowFn interleave_ = nullptr;
+};
+
+#endif // PSD_DECODER_H
@@ -0,0 +1,142 @@
+/**
+ * @file ResidencyManager.cpp
+ * @brief Implements ResidencyManager.
+ */
+
+#include "ResidencyManager.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+    constexpr uint64_t kMinReserve = 512ull << 20;
+    constexpr uint64_t kBehindWeight = 4;
+    constexpr auto kSampleInterval = std::chrono::milliseconds(500);
+
+    /// Physical memory as (total, available); zeros if unknown.
+    std::pair<uint64_t, uint64_t> PhysicalMemory() {
+#ifdef _WIN32
+        MEMORYSTATUSEX status{};
+        status.dwLength = sizeof(status);
+        if (!GlobalMemoryStatusEx(&status)) return { 0, 0 };
+        return { status.ullTotalPhys, status.ullAvailPhys };
+#else
+        const long pages = sysconf(_SC_PHYS_PAGES), page_size = sysconf(_SC_PAGESIZE);
+        const uint64_t total = pages > 0 && page_size > 0 ? static_cast<uint64_t>(pages) * page_size : 0;
+        // MemAvailable counts reclaimable cache, which free pages alone do not.
+        uint64_t available = 0;
+        if (FILE* f = std::fopen("/proc/meminfo", "r")) {
+            char line[128];
+            unsigned long long kb = 0;
+            while (std::fgets(line, sizeof(line), f)) {
+                if (std::sscanf(line, "MemAvailable: %llu kB", &kb) == 1) {
+                    available = kb * 1024;
+                    break;
+                }
+            }
+            std::fclose(f);
+        }
+        if (available == 0) {
+            const long free_pages = sysconf(_SC_AVPHYS_PAGES);
+            if (free_pages > 0 && page_size > 0) available = static_cast<uint64_t>(free_pages) * page_size;
+        }
+        return { total, available };
+#endif
+    }
+}
+
+ResidencyManager::ResidencyManager(uint64_t budget, uint64_t system_reserve)
+    : budget_(budget), reserve_(system_reserve) {
+    if (reserve_ == 0) reserve_ = std::max(kMinReserve, PhysicalMemory().first / 10);
+}
+
+void ResidencyManager::Insert(int32_t key, uint64_t bytes) {
+    Erase(key);
+    entries_[key] = Entry{ bytes, clock_ };
+    resident_bytes_ += bytes;
+}
+
+uint64_t ResidencyManager::Erase(int32_t key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return 0;
+    const uint64_t bytes = it->second.bytes;
+    resident_bytes_ -= bytes;
+    entries_.erase(it);
+    return bytes;
+}
+
+void ResidencyManager::Touch(int32_t key) {
+    ++clock_;
+    auto it = entries_.find(key);
+    if (it != entries_.end()) it->second.last_used = clock_;
+}
+
+void ResidencyManager::Clear() {
+    entries_.clear();
+    resident_bytes_ = 0;
+}
+
+/**
+ * @brief The memory the bitmaps already hold counts as available to them: the cap is what
+ *        they hold now plus what the system can spare above the reserve.
+ */
+uint64_t ResidencyManager::EffectiveBudget() {
+    const auto now = std::chrono::steady_clock::now();
+    if (sampled_ == std::chrono::steady_clock::time_point{} || now - sampled_ >= kSampleInterval) {
+        available_ = PhysicalMemory().second;
+        sampled_ = now;
+    }
+    if (available_ == 0) return budget_;
+    const uint64_t spare = available_ > reserve_ ? available_ - reserve_ : 0;
+    return std::min(budget_, resident_bytes_ + spare);
+}
+
+uint64_t ResidencyManager::Score(int32_t key, bool behind) const {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return 0;
+    const uint64_t age = clock_ - it->second.last_used + 1;
+    return it->second.bytes * age * (behind ? kBehindWeight : 1);
+}
+
+std::vector<int32_t> ResidencyManager::Evict(uint64_t incoming, const std::function<bool(int32_t)>& is_protected,
+                                             const std::function<bool(int32_t)>& is_behind) {
+    std::vector<int32_t> victims;
+    const uint64_t budget = EffectiveBudget();
+    if (resident_bytes_ + incoming <= budget) return victims;
+
+    std::vector<std::pair<uint64_t, int32_t>> candidates;
+    for (const auto& [key, entry] : entries_) {
+        if (!is_protected(key)) candidates.emplace_back(Score(key, is_behind(key)), key);
+    }
+    std::sort(candidates.begin(), candidates.end(), std::greater<>());
+
+    for (const auto& [score, key] : candidates) {
+        if (resident_bytes_ + incoming <= budget) break;
+        const uint64_t bytes = Erase(key);
+        evicted_bytes_ += bytes;
+        ++evictions_;
+        victims.push_back(key);
+    }
+    return victims;
+}
+
+void ResidencyManager::GetStats(ResidencyStats& out) {
+    out.effective_budget = EffectiveBudget();
+    out.resident_bytes = resident_bytes_;
+    out.budget = budget_;
+    out.available_physical = available_;
+    out.evicted_bytes = evicted_bytes_;
+    out.resident_count = static_cast<uint32_t>(entries_.size());
+    out.evictions = evictions_;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file ResidencyManager.h
+ * @brief Declares ResidencyManager, the byte-budgeted store of which HQ bitmaps stay in memory.
+ *
+ * A decoded HQ bitmap costs width x height x 4 bytes: a few megabytes for a small PNG, hundreds
+ * for a 100 MP panorama. Keeping a fixed number of neighbours resident therefore either wastes
+ * memory or exhausts it. ResidencyManager tracks the exact bytes of every resident bitmap and
+ * keeps the total under a byte budget.
+ *
+ * - Bitmaps stay resident after the viewer moves on, so returning to a photo is instant, until
+ *   room is needed. Victims are chosen by bytes x age (navigation steps since last use), with
+ *   photos behind the direction of travel weighted further: large, stale bitmaps the user is
+ *   moving away from go first.
+ * - The budget is capped by the physical memory actually available, minus a reserve, so HQ
+ *   bitmaps never push the system into paging whatever the mix of sizes. The available memory
+ *   is sampled at most every 500 ms.
+ *
+ * Not thread-safe; PrefetchScheduler calls it under its own lock and does the releasing.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef RESIDENCY_MANAGER_H
+#define RESIDENCY_MANAGER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Live accounting of the resident HQ bitmaps. Blittable for P/Invoke.
+struct ResidencyStats {
+    uint64_t resident_bytes;
+    uint64_t budget;                    ///< The configured budget.
+    uint64_t effective_budget;          ///< The budget after the available-memory cap.
+    uint64_t available_physical;        ///< Last sample of available physical memory; 0 if unknown.
+    uint64_t evicted_bytes;             ///< Total released to make room.
+    uint32_t resident_count;
+    uint32_t evictions;
+};
+
+/// @brief Byte-budgeted, size- and direction-aware LRU of resident HQ bitmaps.
+class ResidencyManager {
+public:
+    /// @param budget Bytes the bitmaps may hold.
+    /// @param system_reserve Physical memory to leave available; 0 for a tenth of it, at least 512 MB.
+    ResidencyManager(uint64_t budget, uint64_t system_reserve);
+
+    /// @brief Records a resident bitmap, replacing any previous one for the key, and marks it used.
+    void Insert(int32_t key, uint64_t bytes);
+
+    /// @brief Forgets a bitmap. Returns the bytes it held, or 0 if it was not resident.
+    uint64_t Erase(int32_t key);
+
+    /// @brief Marks a bitmap used, e.g. because it is on screen, and advances the LRU clock.
+    void Touch(int32_t key);
+
+    void Clear();
+
+    bool Contains(int32_t key) const { return entries_.count(key) != 0; }
+    uint64_t Resident() const { return resident_bytes_; }
+
+    /// @brief The budget, capped so that available physical memory stays above the reserve.
+    uint64_t EffectiveBudget();
+
+    /// @brief Eviction score of a resident bitmap: bytes x (age + 1), x4 if `behind`. Higher goes first.
+    uint64_t Score(int32_t key, bool behind) const;
+
+    /**
+     * @brief Chooses victims until `Resident() + incoming` fits the effective budget or only
+     *        protected bitmaps are left, and forgets them.
+     * @param is_protected Bitmaps that must stay, e.g. those in the HQ window.
+     * @param is_behind Whether a bitmap lies behind the direction of travel.
+     */
+    std::vector<int32_t> Evict(uint64_t incoming, const std::function<bool(int32_t)>& is_protected,
+                               const std::function<bool(int32_t)>& is_behind);
+
+    void GetStats(ResidencyStats& out);
+
+private:
+    struct Entry {
+        uint64_t bytes;
+        uint64_t last_used;
+    };
+
+    std::unordered_map<int32_t, Entry> entries_;
+    uint64_t budget_;
+    uint64_t reserve_;
+    uint64_t resident_bytes_ = 0;
+    uint64_t clock_ = 0;
+    uint64_t evicted_bytes_ = 0;
+    uint32_t evictions_ = 0;
+    uint64_t available_ = 0;
+    std::chrono::steady_clock::time_point sampled_{};
+};
+
+#endif // RESIDENCY_MANAGER_H
@@ -0,0 +1,178 @@
+/**
+ * @file StartupPreview.cpp
+ * @brief Implements StartupPreview.
+ */
+
+#include "StartupPreview.h"
+#include "ContentFingerprint.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+    /// Seconds from 1601-01-01 (the FILETIME epoch) to 1970-01-01.
+    constexpr int64_t kFileTimeEpochOffset = 11644473600ll;
+
+    /// The last write time in FILETIME units, as the managed cache stores it
+    /// (File.GetLastWriteTimeUtc().ToFileTimeUtc()); 0 if the file cannot be read.
+    int64_t LastWriteTime(const std::filesystem::path& path) {
+#ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA data{};
+        if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data)) return 0;
+        return static_cast<int64_t>((static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                                    data.ftLastWriteTime.dwLowDateTime);
+#else
+        struct stat st {};
+        if (stat(path.c_str(), &st) != 0) return 0;
+        return (static_cast<int64_t>(st.st_mtim.tv_sec) + kFileTimeEpochOffset) * 10000000 + st.st_mtim.tv_nsec / 100;
+#endif
+    }
+
+    uint32_t ElapsedMs(std::chrono::steady_clock::time_point since) {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - since).count());
+    }
+}
+
+StartupPreview& StartupPreview::Instance() {
+    static StartupPreview* instance = new StartupPreview();
+    return *instance;
+}
+
+bool StartupPreview::Begin(const std::filesystem::path& path, const std::filesystem::path& store_folder,
+                           const StartupPreviewOptions& options, StartupDecodeFn decode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_ || path.empty()) return false;
+    started_ = true;
+    path_ = path;
+    store_folder_ = store_folder;
+    options_ = options;
+    decode_ = decode;
+    begun_ = std::chrono::steady_clock::now();
+    std::thread(&StartupPreview::Run, this).detach();
+    return true;
+}
+
+/**
+ * @brief The store is published together with the lookup in it, so a claimed store is never
+ *        used by this thread again; the decode of a miss runs after the store is available.
+ */
+void StartupPreview::Run() {
+    StartupPreviewResult result{};
+    result.probed = ImageProbe::ProbeFile(path_, result.probe) ? 1 : 0;
+    result.mtime = LastWriteTime(path_);
+
+    std::unique_ptr<ThumbnailStore> store;
+    if ((options_.flags & StartupPreview_UseCache) && !store_folder_.empty()) {
+        store = std::make_unique<ThumbnailStore>();
+        if (!store->Open(store_folder_, options_.store_max_bytes, options_.store_max_entries)) store.reset();
+    }
+    if (store && result.mtime != 0) {
+        const std::string utf8 = path_.u8string();
+        if (store->Get(utf8, result.mtime, result.view)) {
+            result.kind = static_cast<int32_t>(StartupPreviewKind::Cached);
+        } else if (const uint64_t fingerprint = ContentFingerprint::ComputeFile(path_);
+                   fingerprint && store->GetByFingerprint(fingerprint, result.mtime, result.view)) {
+            store->Alias(utf8, result.mtime, fingerprint);
+            result.kind = static_cast<int32_t>(StartupPreviewKind::Cached);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        store_ = std::move(store);
+        lookup_store_ = store_.get();
+        store_done_ = true;
+    }
+    cv_.notify_all();
+
+    if (result.kind == static_cast<int32_t>(StartupPreviewKind::None) && result.probed &&
+        (options_.flags & StartupPreview_UseEmbedded) && decode_) {
+        if (decode_(path_, result.probe, result.pixels)) {
+            result.kind = static_cast<int32_t>(StartupPreviewKind::Pixels);
+        } else {
+            FreePixels(result.pixels);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result.ready_ms = ElapsedMs(begun_);
+        result_ = result;
+        done_ = true;
+        if (ended_) CleanUpLocked();
+    }
+    cv_.notify_all();
+}
+
+std::unique_ptr<ThumbnailStore> StartupPreview::ClaimStore() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!started_ || ended_) return nullptr;
+    cv_.wait(lock, [this] { return store_done_; });
+    if (store_) store_claimed_ = true;
+    return std::move(store_);
+}
+
+/**
+ * @brief A cached view can only be handed over with its store: if the store was not claimed,
+ *        the view is released here and only the probe is handed over.
+ */
+bool StartupPreview::Claim(const std::filesystem::path& path, std::chrono::milliseconds timeout,
+                           StartupPreviewResult& out) {
+    std::memset(&out, 0, sizeof(out));
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!started_ || ended_ || claimed_ || path != path_) return false;
+    if (!cv_.wait_for(lock, timeout, [this] { return done_; })) return false;
+    claimed_ = true;
+    out = result_;
+    result_ = StartupPreviewResult{};
+    out.waited_ms = ElapsedMs(start);
+    if (out.kind == static_cast<int32_t>(StartupPreviewKind::Cached) && !store_claimed_) {
+        if (lookup_store_) lookup_store_->Release(out.view);
+        std::memset(&out.view, 0, sizeof(out.view));
+        out.kind = static_cast<int32_t>(StartupPreviewKind::None);
+    }
+    return true;
+}
+
+void StartupPreview::End() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_ || ended_) return;
+    ended_ = true;
+    if (done_) CleanUpLocked();
+}
+
+/**
+ * @brief Runs once both End() was called and the result is parked. An unclaimed view is
+ *        released through the store it came from, which the managed cache may own by now.
+ */
+void StartupPreview::CleanUpLocked() {
+    if (!claimed_) {
+        claimed_ = true;
+        if (result_.kind == static_cast<int32_t>(StartupPreviewKind::Cached) && lookup_store_) {
+            lookup_store_->Release(result_.view);
+        }
+        FreePixels(result_.pixels);
+        result_ = StartupPreviewResult{};
+    }
+    if (store_) {
+        store_->Close();
+        store_.reset();
+    }
+    lookup_store_ = nullptr;
+}
+
+void StartupPreview::FreePixels(StartupPixels& pixels) {
+    delete[] pixels.data;
+    std::memset(&pixels, 0, sizeof(pixels));
+}
@@ -0,0 +1,144 @@
+/**
+ * @file StartupPreview.h
+ * @brief Declares StartupPreview, the speculative first-preview load started at process entry.
+ *
+ * The first photo cannot be read through the managed pipeline until the window and the Win2D
+ * canvas exist, and creating them takes a few hundred milliseconds in which the disk and the
+ * CPU sit idle. StartupPreview is handed the launch path as soon as the process starts and
+ * does on a native thread what the managed first load would do first:
+ *
+ * - opens the thumbnail store (the managed cache adopts it with ClaimStore() instead of
+ *   opening it again); the open waits, as ThumbnailStore::Open() does, for a previous instance
+ *   that is being killed on relaunch to release the store's lock,
+ * - probes the header for the dimensions and orientation,
+ * - looks the file up in the store, by path and last write time, then by content,
+ * - on a miss, decodes a preview through an optional decoder hook (the DLL supplies the HEIF
+ *   embedded thumbnail decode; formats without one are left to the managed readers).
+ *
+ * The result is parked in a single handoff slot. Claim() takes it once the canvas is ready,
+ * waiting for the load if it is still running; End() frees whatever nobody claimed. Nothing
+ * here needs a GPU: a cached entry is handed over as a pinned view and decoded pixels as a
+ * buffer, and the managed side creates the bitmap.
+ *
+ * One speculative load per process; Begin() after the first call does nothing.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef STARTUP_PREVIEW_H
+#define STARTUP_PREVIEW_H
+
+#include "ImageProbe.h"
+#include "ThumbnailStore.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/// @brief Bits for StartupPreviewOptions::flags.
+enum StartupPreviewFlags : uint32_t {
+    StartupPreview_UseCache = 1u << 0,      ///< Open the thumbnail store and look the file up.
+    StartupPreview_UseEmbedded = 1u << 1,   ///< Decode a preview through the decoder hook on a cache miss.
+};
+
+/// @brief What the handoff slot holds.
+enum class StartupPreviewKind : int32_t {
+    None = 0,           ///< Only the probe (if `probed`); the managed readers load the preview.
+    Cached = 1,         ///< `view` is a pinned thumbnail store entry.
+    Pixels = 2,         ///< `pixels` is a decoded RGBA preview.
+};
+
+/// @brief Decoded RGBA pixels. `data` is allocated with new[]; FreeStartupPreview() frees it.
+struct StartupPixels {
+    uint8_t* data;
+    int32_t size;
+    int32_t width;
+    int32_t height;
+    int32_t full_width;                 ///< Size of the full image the preview was made from.
+    int32_t full_height;
+};
+
+/// @brief Decodes a preview of `path` into `out`. Returns false if the format has no fast preview.
+using StartupDecodeFn = bool (*)(const std::filesystem::path& path, const ImageProbeInfo& probe, StartupPixels& out);
+
+/// @brief Options for Begin(). Blittable for P/Invoke.
+struct StartupPreviewOptions {
+    uint32_t flags;                     ///< A combination of StartupPreviewFlags.
+    uint32_t store_max_entries;         ///< As for ThumbnailStore::Open().
+    uint64_t store_max_bytes;
+};
+
+/// @brief The handoff slot's contents. Blittable for P/Invoke.
+struct StartupPreviewResult {
+    int32_t kind;                       ///< A StartupPreviewKind value.
+    int32_t probed;                     ///< 1 if `probe` is valid.
+    ImageProbeInfo probe;
+    int64_t mtime;                      ///< Last write time the store lookup used (FILETIME units).
+    ThumbnailView view;                 ///< For Cached: release through the claimed store.
+    StartupPixels pixels;               ///< For Pixels: free with FreeStartupPreview().
+    uint32_t ready_ms;                  ///< Time from Begin() until the result was parked.
+    uint32_t waited_ms;                 ///< Time Claim() waited for it.
+};
+
+/// @brief The process-wide speculative load of the launch photo.
+class StartupPreview {
+public:
+    /// @brief The single instance. Never destroyed, so the detached worker can outlive any caller.
+    static StartupPreview& Instance();
+
+    /// @brief Starts the load of `path` on a native thread. Returns false if one was already started.
+    /// @param store_folder The thumbnail store's folder; empty to skip the cache.
+    /// @param decode Optional decoder for cache misses.
+    bool Begin(const std::filesystem::path& path, const std::filesystem::path& store_folder,
+               const StartupPreviewOptions& options, StartupDecodeFn decode);
+
+    /// @brief Takes ownership of the store the load opened, waiting for the open and the lookup
+    ///        in it to finish. There is no timeout: the load holds the store's lock until then, so
+    ///        a caller that gave up could not open the store itself either.
+    /// @return The open store, or nullptr if none was opened (or it was already claimed or ended).
+    std::unique_ptr<ThumbnailStore> ClaimStore();
+
+    /// @brief Takes the parked result for `path`, waiting up to `timeout` for the load to finish.
+    /// @return false if no load of `path` was started, it did not finish in time, or it was
+    ///         already claimed. A Cached view must have been preceded by ClaimStore().
+    bool Claim(const std::filesystem::path& path, std::chrono::milliseconds timeout, StartupPreviewResult& out);
+
+    /// @brief Gives up on anything unclaimed: frees a parked result and closes an unclaimed store,
+    ///        now or when the load finishes. Does not block.
+    void End();
+
+    /// @brief Frees the pixels of a claimed result. Cached views go back through their store.
+    static void FreePixels(StartupPixels& pixels);
+
+private:
+    StartupPreview() = default;
+
+    void Run();
+    void CleanUpLocked();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool started_ = false;
+    bool store_done_ = false;           // The store open was attempted.
+    bool done_ = false;                 // The result is parked.
+    bool store_claimed_ = false;
+    bool claimed_ = false;
+    bool ended_ = false;
+
+    std::filesystem::path path_;
+    std::filesystem::path store_folder_;
+    StartupPreviewOptions options_{};
+    StartupDecodeFn decode_ = nullptr;
+    std::chrono::steady_clock::time_point begun_{};
+
+    std::unique_ptr<ThumbnailStore> store_;     // Until claimed.
+    ThumbnailStore* lookup_store_ = nullptr;    // The store the parked view came from, claimed or not.
+    StartupPreviewResult result_{};
+};
+
+#endif // STARTUP_PREVIEW_H
@@ -0,0 +1,101 @@
+/**
+ * @file ThumbnailAtlas.cpp
+ * @brief Implements ThumbnailAtlas.
+ */
+
+#include "ThumbnailAtlas.h"
+#include "ImageReducer.h"
+
+#include <algorithm>
+#include <cstring>
+
+ThumbnailAtlas::ThumbnailAtlas(int slot_size, int columns, int rows)
+    : slot_size_(slot_size), columns_(columns), rows_(rows),
+      pixels_(static_cast<size_t>(columns) * slot_size * rows * slot_size * 4),
+      slots_(static_cast<size_t>(columns) * rows) {
+}
+
+int ThumbnailAtlas::Find(uint64_t key) {
+    const auto it = lookup_.find(key);
+    if (it == lookup_.end()) return -1;
+    slots_[it->second].last_use = ++clock_;
+    return it->second;
+}
+
+/**
+ * @brief Reuses the key's own slot, else a free one, else the least recently used. The atlas
+ *        holds a few screens of thumbnails, so a linear scan for the oldest is cheaper than
+ *        maintaining a list.
+ */
+int ThumbnailAtlas::AcquireSlot(uint64_t key) {
+    const auto it = lookup_.find(key);
+    int slot = it != lookup_.end() ? it->second : -1;
+    if (slot < 0) {
+        slot = 0;
+        for (int i = 1; i < Capacity() && slots_[slot].last_use != 0; ++i) {
+            if (slots_[i].last_use < slots_[slot].last_use) slot = i;
+        }
+        if (slots_[slot].last_use != 0) lookup_.erase(slots_[slot].key);
+        lookup_[key] = slot;
+    }
+    Slot& s = slots_[slot];
+    s.key = key;
+    s.last_use = ++clock_;
+    s.dirty = true;
+    return slot;
+}
+
+int ThumbnailAtlas::Insert(uint64_t key, const uint8_t* bgra, int width, int height, int stride) {
+    if (!bgra || width <= 0 || height <= 0 || stride < width * 4) return -1;
+    const int slot = AcquireSlot(key);
+    const AtlasRect r = SlotRect(slot);
+    uint8_t* dst = pixels_.data() + static_cast<size_t>(r.y) * Stride() + static_cast<size_t>(r.x) * 4;
+    ImageReducer::Resample(bgra, width, height, stride, dst, slot_size_, slot_size_, static_cast<int>(Stride()));
+    return slot;
+}
+
+int ThumbnailAtlas::InsertBlocks(uint64_t key, BlockFormat format, const uint8_t* blocks, size_t size, int width, int height) {
+    if (!blocks || width <= 0 || height <= 0 || size < BlockEncoder::CompressedSize(format, width, height)) return -1;
+    scratch_.resize(static_cast<size_t>(width) * height * 4);
+    BlockEncoder::Decode(format, blocks, width, height, scratch_.data(), width * 4);
+    return Insert(key, scratch_.data(), width, height, width * 4);
+}
+
+AtlasRect ThumbnailAtlas::SlotRect(int slot) const {
+    return { (slot % columns_) * slot_size_, (slot / columns_) * slot_size_, slot_size_, slot_size_ };
+}
+
+std::vector<AtlasRect> ThumbnailAtlas::TakeDirty() {
+    std::vector<AtlasRect> rects;
+    for (int row = 0; row < rows_; ++row) {
+        int run_start = -1;
+        for (int col = 0; col <= columns_; ++col) {
+            Slot* s = col < columns_ ? &slots_[static_cast<size_t>(row) * columns_ + col] : nullptr;
+            if (s && s->dirty) {
+                s->dirty = false;
+                if (run_start < 0) run_start = col;
+            } else if (run_start >= 0) {
+                rects.push_back({ run_start * slot_size_, row * slot_size_, (col - run_start) * slot_size_, slot_size_ });
+                run_start = -1;
+            }
+        }
+    }
+    return rects;
+}
+
+bool ThumbnailAtlas::CopyRect(const AtlasRect& rect, uint8_t* dst, size_t dst_size) const {
+    if (!dst || rect.x < 0 || rect.y < 0 || rect.width <= 0 || rect.height <= 0 ||
+        rect.x + rect.width > Width() || rect.y + rect.height > Height()) return false;
+    const size_t row_bytes = static_cast<size_t>(rect.width) * 4;
+    if (dst_size < row_bytes * rect.height) return false;
+    for (int y = 0; y < rect.height; ++y) {
+        memcpy(dst + y * row_bytes, pixels_.data() + static_cast<size_t>(rect.y + y) * Stride() + static_cast<size_t>(rect.x) * 4, row_bytes);
+    }
+    return true;
+}
+
+void ThumbnailAtlas::Clear() {
+    std::fill(pixels_.begin(), pixels_.end(), 0);
+    std::fill(slots_.begin(), slots_.end(), Slot{});
+    lookup_.clear();
+}
@@ -0,0 +1,96 @@
+/**
+ * @file ThumbnailAtlas.h
+ * @brief Declares ThumbnailAtlas, a persistent BGRA atlas of fixed-size thumbnails for the strip.
+ *
+ * The thumbnail strip used to keep one bitmap per photo and rescale each of them into the
+ * strip on every rebuild. The atlas keeps every thumbnail already scaled to the size it is
+ * drawn at, in one grid of square slots mirrored by a single GPU texture. A thumbnail is
+ * scaled once, when it is inserted; slots are reused least-recently-used first, so sliding
+ * through a large folder recycles the slots of photos that scrolled out of view.
+ *
+ * Insertions only mark their slot dirty. TakeDirty() returns the changed areas, merged into
+ * one rectangle per run of adjacent slots, and the owner uploads just those.
+ *
+ * Not thread-safe: the strip's render thread owns an atlas. This file does not include
+ * pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef THUMBNAIL_ATLAS_H
+#define THUMBNAIL_ATLAS_H
+
+#include "BlockEncoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// @brief A pixel rectangle of the atlas. Blittable for P/Invoke.
+struct AtlasRect {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+};
+
+/// @brief A grid of square thumbnail slots with LRU reuse and dirty tracking.
+class ThumbnailAtlas {
+public:
+    /// @brief Creates a `columns` x `rows` grid of `slot_size` pixel slots, all free and dirty.
+    ThumbnailAtlas(int slot_size, int columns, int rows);
+
+    int SlotSize() const { return slot_size_; }
+    int Width() const { return columns_ * slot_size_; }
+    int Height() const { return rows_ * slot_size_; }
+    int Capacity() const { return columns_ * rows_; }
+    size_t Stride() const { return static_cast<size_t>(Width()) * 4; }
+
+    /// @brief Premultiplied BGRA pixels of the whole atlas, `Stride()` bytes per row.
+    const uint8_t* Pixels() const { return pixels_.data(); }
+
+    /// @brief Looks up the slot holding `key` and marks it most recently used.
+    /// @return The slot index, or -1 if the key is not in the atlas.
+    int Find(uint64_t key);
+
+    /// @brief Scales BGRA pixels into the least recently used slot (replacing any thumbnail for `key`).
+    /// @return The slot index, or -1 if the input is invalid.
+    int Insert(uint64_t key, const uint8_t* bgra, int width, int height, int stride);
+
+    /// @brief Decodes BC1/BC3 blocks and inserts the result like Insert().
+    int InsertBlocks(uint64_t key, BlockFormat format, const uint8_t* blocks, size_t size, int width, int height);
+
+    /// @brief Pixel rectangle of a slot.
+    AtlasRect SlotRect(int slot) const;
+
+    /// @brief Returns the rectangles changed since the last call, and marks everything clean.
+    ///        Adjacent dirty slots in a row are merged into one rectangle.
+    std::vector<AtlasRect> TakeDirty();
+
+    /// @brief Copies a rectangle of the atlas into tightly packed rows at `dst`.
+    /// @return false if the rectangle is outside the atlas or `dst_size` is too small.
+    bool CopyRect(const AtlasRect& rect, uint8_t* dst, size_t dst_size) const;
+
+    /// @brief Forgets every thumbnail and clears the pixels, marking the whole atlas dirty.
+    void Clear();
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        uint64_t last_use = 0;      // 0 for a free slot.
+        bool dirty = true;
+    };
+
+    int AcquireSlot(uint64_t key);
+
+    int slot_size_;
+    int columns_;
+    int rows_;
+    uint64_t clock_ = 0;
+    std::vector<uint8_t> pixels_;
+    std::vector<Slot> slots_;
+    std::unordered_map<uint64_t, int> lookup_;
+    std::vector<uint8_t> scratch_;
+};
+
+#endif // THUMBNAIL_ATLAS_H
@@ -0,0 +1,1255 @@
+/**
+ * @file ThumbnailStore.cpp
+ * @brief Implements ThumbnailStore.
+ */
+
+#include "ThumbnailStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    constexpr char kIndexMagic[8] = { 'F', 'L', 'Y', 'T', 'I', 'D', 'X', '\0' };
+    constexpr char kSegmentMagic[8] = { 'F', 'L', 'Y', 'T', 'S', 'E', 'G', '\0' };
+    constexpr uint32_t kRecordMagic = 0x52545946;       // "FYTR"
+    constexpr uint32_t kMaxSegments = 4096;             // Descriptor table size; ids wrap around it.
+    constexpr uint64_t kMaxQueuedBytes = 64ull << 20;   // Put() drops beyond this rather than grow without bound.
+    constexpr uint64_t kMinSegmentBytes = 1ull << 20;
+    constexpr auto kIdleInterval = std::chrono::seconds(2);
+    constexpr auto kLockWait = std::chrono::seconds(2);         // How long Open() waits for another process's lock.
+    constexpr double kCompactBelow = 0.5;               // Live fraction under which a sealed segment is rewritten.
+    constexpr double kEvictFraction = 0.25;             // Share of entries dropped per eviction, as the SQLite cache did.
+    constexpr int kSeqlockRetries = 64;
+    constexpr uint32_t kSlotAlias = 1;                  // Slot flag: a path that resolves to another path's record.
+
+    enum SegmentState : int {
+        Segment_Free,
+        Segment_Live,
+        Segment_Retired,
+    };
+
+    /// Index file header; the slot array follows it.
+    struct IndexHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t slot_size;
+        uint64_t capacity;
+        uint32_t clean;             // 1 only between a clean Close() and the next Open().
+        uint32_t next_segment;
+        uint64_t next_sequence;
+        uint64_t reserved[3];
+    };
+    static_assert(sizeof(IndexHeader) == 64, "ThumbnailStore index header layout changed");
+
+    /// Segment file header; records follow it back to back.
+    struct SegmentHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t id;
+        uint64_t reserved[6];
+    };
+    static_assert(sizeof(SegmentHeader) == 64, "ThumbnailStore segment header layout changed");
+
+    /// Record header, followed by the UTF-8 path and the blob, each padded to 8 bytes.
+    /// `magic` is stored last, so a record the writer never finished ends the segment scan.
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t path_size;
+        uint64_t key;
+        uint64_t sequence;
+        int64_t mtime;
+        uint64_t checksum;          // Over path and blob; verified only when rebuilding the index.
+        uint64_t fingerprint;       // Content fingerprint of the source file; 0 if none was given.
+        uint32_t blob_size;
+        int32_t width;
+        int32_t height;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(RecordHeader) == 64, "ThumbnailStore record layout changed");
+
+    uint64_t Align8(uint64_t v) {
+        return (v + 7) & ~uint64_t{ 7 };
+    }
+
+    uint64_t RecordSize(uint64_t path_size, uint64_t blob_size) {
+        return sizeof(RecordHeader) + Align8(path_size) + Align8(blob_size);
+    }
+
+    /// Word-at-a-time multiplicative hash; only has to catch torn writes, not adversaries.
+    uint64_t Checksum(uint64_t h, const uint8_t* data, size_t size) {
+        constexpr uint64_t kMul = 0x9E3779B97F4A7C15ull;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t w;
+            memcpy(&w, data + i, 8);
+            h = (h ^ w) * kMul;
+            h ^= h >> 29;
+        }
+        for (; i < size; ++i) {
+            h = (h ^ data[i]) * kMul;
+        }
+        return h ^ (h >> 32);
+    }
+
+    uint64_t NowSeconds() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    fs::path SegmentPath(const fs::path& folder, uint32_t id) {
+        char name[32];
+        snprintf(name, sizeof(name), "thumbs_%08u.seg", id);
+        return folder / name;
+    }
+
+    bool ParseSegmentName(const std::string& name, uint32_t& id) {
+        unsigned value = 0;
+        char tail = 0;
+        if (name.size() != 19 || sscanf(name.c_str(), "thumbs_%8u.se%c", &value, &tail) != 2 || tail != 'g') return false;
+        id = value;
+        return id != 0;
+    }
+
+    /**
+     * @brief Takes an exclusive lock on `path`, held until ReleaseLock(). On Windows the file is
+     *        opened without sharing; elsewhere flock() is used so a crashed owner releases it.
+     * @return nullptr if the file cannot be created, or if another process holds the lock.
+     */
+    void* TryAcquireLock(const fs::path& path, bool& held_elsewhere) {
+        held_elsewhere = false;
+#ifdef _WIN32
+        HANDLE h = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (h != INVALID_HANDLE_VALUE) return h;
+        held_elsewhere = GetLastError() == ERROR_SHARING_VIOLATION;
+        return nullptr;
+#else
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) return nullptr;
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            held_elsewhere = errno == EWOULDBLOCK;
+            ::close(fd);
+            return nullptr;
+        }
+        return reinterpret_cast<void*>(static_cast<intptr_t>(fd) + 1);
+#endif
+    }
+
+    /**
+     * @brief TryAcquireLock(), retried with backoff for up to kLockWait while another process
+     *        holds the lock. A relaunch in single-instance mode kills the previous instance
+     *        without waiting for it to exit, so its lock is usually released a moment later.
+     */
+    void* AcquireLock(const fs::path& path) {
+        const auto deadline = std::chrono::steady_clock::now() + kLockWait;
+        auto delay = std::chrono::milliseconds(10);
+        for (;;) {
+            bool held_elsewhere = false;
+            if (void* lock = TryAcquireLock(path, held_elsewhere)) return lock;
+            const auto now = std::chrono::steady_clock::now();
+            if (!held_elsewhere || now >= deadline) return nullptr;
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(delay, deadline - now));
+            delay = std::min(delay * 2, std::chrono::milliseconds(250));
+        }
+    }
+
+    void ReleaseLock(void* lock) {
+        if (!lock) return;
+#ifdef _WIN32
+        CloseHandle(lock);
+#else
+        ::close(static_cast<int>(reinterpret_cast<intptr_t>(lock) - 1));
+#endif
+    }
+}
+
+/// Plain copy of a slot, as read under its sequence counter.
+struct ThumbnailStore::SlotData {
+    uint64_t key = 0;
+    int64_t mtime = 0;
+    uint32_t segment = 0;
+    uint32_t length = 0;
+    uint64_t offset = 0;
+    uint64_t last_access = 0;
+    uint64_t fingerprint = 0;
+    uint32_t flags = 0;
+};
+
+/// One index slot, living in the mapped index file. `key == 0` marks an empty slot.
+/// The writer bumps `version` to odd before changing the other fields and to even after;
+/// a reader retries if it sees an odd or changed version. `last_access` sits outside that
+/// protocol because readers update it. Fingerprint slots use the same layout, keyed by the
+/// fingerprint.
+struct ThumbnailStore::Slot {
+    std::atomic<uint32_t> version;
+    std::atomic<uint32_t> segment;
+    std::atomic<uint64_t> key;
+    std::atomic<int64_t> mtime;
+    std::atomic<uint64_t> offset;
+    std::atomic<uint32_t> length;
+    std::atomic<uint32_t> flags;
+    std::atomic<uint64_t> last_access;
+    std::atomic<uint64_t> fingerprint;
+
+    bool Load(SlotData& out) const {
+        for (int attempt = 0; attempt < kSeqlockRetries; ++attempt) {
+            const uint32_t before = version.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            out.key = key.load(std::memory_order_relaxed);
+            out.mtime = mtime.load(std::memory_order_relaxed);
+            out.segment = segment.load(std::memory_order_relaxed);
+            out.offset = offset.load(std::memory_order_relaxed);
+            out.length = length.load(std::memory_order_relaxed);
+            out.fingerprint = fingerprint.load(std::memory_order_relaxed);
+            out.flags = flags.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (version.load(std::memory_order_relaxed) == before) return true;
+        }
+        return false;
+    }
+
+    /// Writer only; reads its own fields without the retry loop.
+    SlotData Peek() const {
+        SlotData data;
+        data.key = key.load(std::memory_order_relaxed);
+        data.mtime = mtime.load(std::memory_order_relaxed);
+        data.segment = segment.load(std::memory_order_relaxed);
+        data.offset = offset.load(std::memory_order_relaxed);
+        data.length = length.load(std::memory_order_relaxed);
+        data.last_access = last_access.load(std::memory_order_relaxed);
+        data.fingerprint = fingerprint.load(std::memory_order_relaxed);
+        data.flags = flags.load(std::memory_order_relaxed);
+        return data;
+    }
+
+    void Store(const SlotData& data) {
+        const uint32_t v = version.load(std::memory_order_relaxed);
+        version.store(v + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        key.store(data.key, std::memory_order_relaxed);
+        mtime.store(data.mtime, std::memory_order_relaxed);
+        segment.store(data.segment, std::memory_order_relaxed);
+        offset.store(data.offset, std::memory_order_relaxed);
+        length.store(data.length, std::memory_order_relaxed);
+        fingerprint.store(data.fingerprint, std::memory_order_relaxed);
+        flags.store(data.flags, std::memory_order_relaxed);
+        version.store(v + 2, std::memory_order_release);
+        last_access.store(data.last_access, std::memory_order_relaxed);
+    }
+};
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && std::atomic<uint64_t>::is_always_lock_free,
+    "Index slots are shared through a file mapping and need plain lock-free 64-bit atomics");
+
+/// In-memory descriptor of one segment file. The first five fields are read by Get() on any
+/// thread; the rest belong to the writer. Descriptors are never freed while the store is open,
+/// so a reader may always touch one, and `id` tells it whether it still describes its segment.
+struct ThumbnailStore::Segment {
+    std::atomic<uint32_t> id{ 0 };
+    std::atomic<int> state{ Segment_Free };
+    std::atomic<int32_t> pins{ 0 };
+    std::atomic<uint8_t*> base{ nullptr };
+    std::atomic<uint64_t> capacity{ 0 };
+
+    WritableMappedFile file;
+    uint64_t used = 0;
+    uint64_t live_bytes = 0;
+    uint32_t live_records = 0;
+
+    /// Calls fn(offset, header) for every complete record, in write order. Returns the end offset.
+    template <typename Fn>
+    uint64_t ForEachRecord(bool verify, Fn&& fn) const {
+        const uint8_t* data = file.Data();
+        const uint64_t size = file.Size();
+        uint64_t offset = sizeof(SegmentHeader);
+        while (offset + sizeof(RecordHeader) <= size) {
+            RecordHeader header;
+            memcpy(&header, data + offset, sizeof(header));
+            if (header.magic != kRecordMagic) break;
+            const uint64_t total = RecordSize(header.path_size, header.blob_size);
+            if (total > size - offset) break;
+            if (verify) {
+                const uint8_t* path = data + offset + sizeof(RecordHeader);
+                const uint8_t* blob = path + Align8(header.path_size);
+                const uint64_t sum = Checksum(Checksum(header.key, path, header.path_size), blob, header.blob_size);
+                if (sum != header.checksum) break;
+            }
+            fn(offset, header);
+            offset += total;
+        }
+        return offset;
+    }
+};
+
+/// A queued write. `clear` entries empty the store at their position in the queue; `alias`
+/// entries carry no blob and point their path at the record of `fingerprint`.
+struct ThumbnailStore::Pending {
+    bool clear = false;
+    bool alias = false;
+    uint64_t ticket = 0;
+    uint64_t key = 0;
+    uint64_t fingerprint = 0;
+    int64_t mtime = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    std::string path;
+    std::vector<uint8_t> blob;
+};
+
+ThumbnailStore::ThumbnailStore() = default;
+
+ThumbnailStore::~ThumbnailStore() {
+    Close();
+}
+
+/** @brief FNV-1a over the UTF-8 bytes. Zero marks an empty slot, so it is remapped to one. */
+uint64_t ThumbnailStore::HashPath(std::string_view utf8_path) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : utf8_path) {
+        h = (h ^ c) * 0x100000001b3ull;
+    }
+    return h ? h : 1;
+}
+
+/**
+ * @brief Locks the folder, maps the index and the segments, rebuilds the index if the last
+ *        session did not close cleanly, then starts the writer.
+ */
+bool ThumbnailStore::Open(const fs::path& folder, uint64_t max_bytes, uint32_t max_entries, uint64_t segment_bytes) {
+    Close();
+    if (max_bytes == 0 || max_entries == 0) return false;
+
+    std::error_code ec;
+    fs::create_directories(folder, ec);
+    lock_ = AcquireLock(folder / "thumbs.lock");
+    if (!lock_) return false;
+
+    folder_ = folder;
+    max_bytes_ = max_bytes;
+    max_entries_ = max_entries;
+    // Keep at least three quarters of the descriptor table free for sealed and retired segments.
+    segment_bytes_ = std::max({ segment_bytes, kMinSegmentBytes, max_bytes / (kMaxSegments / 4) + 1 });
+    segments_ = std::make_unique<Segment[]>(kMaxSegments);
+
+    uint64_t capacity = 1024;
+    while (capacity < 2ull * max_entries) capacity <<= 1;
+    bool clean = false;
+    if (!OpenIndex(capacity, clean)) {
+        Close();
+        return false;
+    }
+
+    std::vector<uint32_t> ids;
+    for (const auto& entry : fs::directory_iterator(folder_, ec)) {
+        uint32_t id;
+        if (entry.is_regular_file(ec) && ParseSegmentName(entry.path().filename().string(), id)) ids.push_back(id);
+    }
+    std::sort(ids.begin(), ids.end());
+    Segment* newest = nullptr;
+    for (uint32_t id : ids) {
+        // A clean index needs only the append point of the newest segment; a dirty one is
+        // rebuilt from every record, so every segment is scanned.
+        if (LoadSegment(id, !clean || id == ids.back())) {
+            newest = SegmentFor(id);
+        } else {
+            fs::remove(SegmentPath(folder_, id), ec);
+            clean = false;
+        }
+        next_segment_ = std::max(next_segment_, id + 1);
+    }
+
+    if (clean) {
+        // Account live bytes per segment; any slot pointing nowhere means the index cannot be trusted.
+        for (size_t pos = 0; pos <= mask_ && clean; ++pos) {
+            const SlotData data = slots_[pos].Peek();
+            const SlotData fp = fp_slots_[pos].Peek();
+            const Segment* fp_segment = fp.key ? SegmentFor(fp.segment) : nullptr;
+            if (fp.key && (!fp_segment || fp.offset + fp.length > fp_segment->file.Size())) {
+                clean = false;
+                break;
+            }
+            if (!data.key) continue;
+            Segment* segment = SegmentFor(data.segment);
+            if (!segment || data.offset + data.length > segment->file.Size()) {
+                clean = false;
+                break;
+            }
+            segment->live_bytes += data.length;
+            segment->live_records++;
+            live_bytes_ += data.length;
+            entries_++;
+        }
+    }
+    if (!clean) RebuildIndex();
+
+    active_ = newest && newest->used + RecordSize(1, 1) <= newest->file.Size() ? newest : CreateSegment();
+    if (!active_) {
+        Close();
+        return false;
+    }
+    flushed_to_ = static_cast<size_t>(active_->used);
+    EvictIfNeeded();   // A rebuild may resurrect entries evicted in the crashed session.
+
+    auto* header = reinterpret_cast<IndexHeader*>(index_file_.Data());
+    header->clean = 0;
+    index_file_.Flush(0, sizeof(IndexHeader));
+
+    PublishStats();
+    open_ = true;
+    writer_ = std::thread(&ThumbnailStore::WriterLoop, this);
+    return true;
+}
+
+/**
+ * @brief Maps the index file, recreating it if its capacity or version differ. `clean` is set
+ *        only if the previous session closed it; otherwise the slots are zeroed for a rebuild.
+ *        The path table is followed by the fingerprint table of the same capacity.
+ */
+bool ThumbnailStore::OpenIndex(uint64_t capacity, bool& clean) {
+    const fs::path path = folder_ / "thumbs.idx";
+    const uint64_t bytes = sizeof(IndexHeader) + 2 * capacity * sizeof(Slot);
+    if (!index_file_.Open(path, bytes)) return false;
+    if (index_file_.Size() != bytes) {
+        index_file_.Close();
+        std::error_code ec;
+        fs::remove(path, ec);
+        if (!index_file_.Open(path, bytes)) return false;
+    }
+
+    auto* header = reinterpret_cast<IndexHeader*>(index_file_.Data());
+    clean = memcmp(header->magic, kIndexMagic, sizeof(kIndexMagic)) == 0 && header->version == kVersion &&
+        header->slot_size == sizeof(Slot) && header->capacity == capacity && header->clean == 1;
+    if (clean) {
+        next_segment_ = std::max<uint32_t>(1, header->next_segment);
+        next_sequence_ = std::max<uint64_t>(1, header->next_sequence);
+    } else {
+        memset(index_file_.Data(), 0, index_file_.Size());
+        memcpy(header->magic, kIndexMagic, sizeof(kIndexMagic));
+        header->version = kVersion;
+        header->slot_size = sizeof(Slot);
+        header->capacity = capacity;
+    }
+    slots_ = reinterpret_cast<Slot*>(index_file_.Data() + sizeof(IndexHeader));
+    fp_slots_ = slots_ + capacity;
+    mask_ = static_cast<size_t>(capacity - 1);
+    return true;
+}
+
+/**
+ * @brief Replays every intact record in segment order. A path written more than once keeps
+ *        the record with the highest sequence, which also holds for records moved by compaction.
+ *        Fingerprint slots are filled as records are replayed; aliases are not recovered.
+ */
+void ThumbnailStore::RebuildIndex() {
+    memset(static_cast<void*>(slots_), 0, 2 * (mask_ + 1) * sizeof(Slot));
+    entries_ = 0;
+    live_bytes_ = 0;
+    const uint64_t now = NowSeconds();
+
+    std::vector<uint32_t> ids;
+    for (uint32_t i = 0; i < kMaxSegments; ++i) {
+        Segment& segment = segments_[i];
+        if (segment.state.load(std::memory_order_relaxed) != Segment_Live) continue;
+        segment.live_bytes = 0;
+        segment.live_records = 0;
+        ids.push_back(segment.id.load(std::memory_order_relaxed));
+    }
+    std::sort(ids.begin(), ids.end());
+
+    for (uint32_t id : ids) {
+        Segment* segment = SegmentFor(id);
+        segment->ForEachRecord(true, [&](uint64_t offset, const RecordHeader& header) {
+            next_sequence_ = std::max(next_sequence_, header.sequence + 1);
+            size_t pos;
+            if (FindSlot(slots_, header.key, pos)) {
+                const SlotData existing = slots_[pos].Peek();
+                RecordHeader current;
+                memcpy(&current, SegmentFor(existing.segment)->file.Data() + existing.offset, sizeof(current));
+                if (current.sequence > header.sequence) return;
+            }
+            SlotData data;
+            data.key = header.key;
+            data.mtime = header.mtime;
+            data.segment = id;
+            data.offset = offset;
+            data.length = static_cast<uint32_t>(RecordSize(header.path_size, header.blob_size));
+            data.last_access = now;
+            data.fingerprint = header.fingerprint;
+            Upsert(data);
+        });
+    }
+}
+
+/**
+ * @brief Linear probe for `key`. Returns true with its position, or false with the first empty
+ *        position of the probe sequence (SIZE_MAX if the table is full).
+ */
+bool ThumbnailStore::FindSlot(const Slot* table, uint64_t key, size_t& pos) const {
+    size_t i = static_cast<size_t>(key) & mask_;
+    for (size_t probe = 0; probe <= mask_; ++probe, i = (i + 1) & mask_) {
+        const uint64_t k = table[i].key.load(std::memory_order_relaxed);
+        if (k == key) {
+            pos = i;
+            return true;
+        }
+        if (k == 0) {
+            pos = i;
+            return false;
+        }
+    }
+    pos = SIZE_MAX;
+    return false;
+}
+
+/**
+ * @brief Points the slot of `data.key` at a new record and moves the live accounting with it.
+ *        Aliases are accounted like records, so a record shared by several paths counts once
+ *        per path; that only makes eviction and compaction slightly conservative.
+ */
+void ThumbnailStore::Upsert(const SlotData& data) {
+    size_t pos;
+    if (FindSlot(slots_, data.key, pos)) {
+        const SlotData old = slots_[pos].Peek();
+        if (Segment* segment = SegmentFor(old.segment)) {
+            segment->live_bytes -= std::min<uint64_t>(segment->live_bytes, old.length);
+            if (segment->live_records) segment->live_records--;
+        }
+        live_bytes_ -= std::min<uint64_t>(live_bytes_, old.length);
+    } else if (pos == SIZE_MAX) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    } else {
+        entries_++;
+    }
+    if (Segment* segment = SegmentFor(data.segment)) {
+        segment->live_bytes += data.length;
+        segment->live_records++;
+    }
+    live_bytes_ += data.length;
+    slots_[pos].Store(data);
+    if (data.fingerprint && !(data.flags & kSlotAlias)) SetFingerprint(data);
+}
+
+/**
+ * @brief Points the fingerprint of a record at it. Nothing is removed when the record is
+ *        replaced or evicted: the record stays intact while its segment lives, and a stale
+ *        fingerprint slot is dropped when the segment is retired.
+ */
+void ThumbnailStore::SetFingerprint(const SlotData& data) {
+    size_t pos;
+    FindSlot(fp_slots_, data.fingerprint, pos);
+    if (pos == SIZE_MAX) return;
+    SlotData entry = data;
+    entry.key = data.fingerprint;
+    entry.flags = 0;
+    fp_slots_[pos].Store(entry);
+}
+
+/**
+ * @brief Removes the entry at `pos` with backward-shift deletion, so no tombstones build up.
+ *        A reader probing while an entry is shifted may miss it once; for a cache that is a
+ *        spurious miss, never a wrong answer, because every hit is checked against the record.
+ */
+void ThumbnailStore::EraseAt(size_t pos) {
+    const SlotData removed = slots_[pos].Peek();
+    if (!removed.key) return;
+    if (Segment* segment = SegmentFor(removed.segment)) {
+        segment->live_bytes -= std::min<uint64_t>(segment->live_bytes, removed.length);
+        if (segment->live_records) segment->live_records--;
+    }
+    live_bytes_ -= std::min<uint64_t>(live_bytes_, removed.length);
+    entries_--;
+    RemoveAt(slots_, pos);
+}
+
+/** @brief Backward-shift deletion in either table, without accounting. */
+void ThumbnailStore::RemoveAt(Slot* table, size_t pos) {
+    size_t hole = pos;
+    for (size_t j = (hole + 1) & mask_; ; j = (j + 1) & mask_) {
+        const SlotData next = table[j].Peek();
+        if (!next.key) break;
+        const size_t home = static_cast<size_t>(next.key) & mask_;
+        if (((j - home) & mask_) >= ((j - hole) & mask_)) {
+            table[hole].Store(next);
+            hole = j;
+        }
+    }
+    table[hole].Store(SlotData{});
+}
+
+/**
+ * @brief Lock-free lookup. The slot is read under its sequence counter, the segment is pinned,
+ *        and the record header is compared with the request before the view is handed out.
+ *        An alias slot points at a record stored under another path, so it is checked by
+ *        fingerprint instead.
+ */
+bool ThumbnailStore::Get(std::string_view utf8_path, int64_t mtime, ThumbnailView& out) {
+    memset(&out, 0, sizeof(out));
+    if (!open_) return false;
+
+    const uint64_t key = HashPath(utf8_path);
+    size_t pos = static_cast<size_t>(key) & mask_;
+    for (size_t probe = 0; probe <= mask_; ++probe, pos = (pos + 1) & mask_) {
+        SlotData data;
+        if (!slots_[pos].Load(data) || !data.key) break;
+        if (data.key != key) continue;
+        if (data.mtime != mtime) break;
+
+        Segment* segment = nullptr;
+        const uint8_t* record = PinRecord(data, segment);
+        if (!record) break;
+        RecordHeader header;
+        memcpy(&header, record, sizeof(header));
+        const uint8_t* path = record + sizeof(RecordHeader);
+        const bool valid = header.magic == kRecordMagic && RecordSize(header.path_size, header.blob_size) == data.length &&
+            ((data.flags & kSlotAlias)
+                ? header.fingerprint != 0 && header.fingerprint == data.fingerprint
+                : header.key == key && header.mtime == mtime && header.path_size == utf8_path.size() &&
+                  memcmp(path, utf8_path.data(), utf8_path.size()) == 0);
+        if (!valid) {
+            Unpin(segment);
+            break;
+        }
+
+        slots_[pos].last_access.store(NowSeconds(), std::memory_order_relaxed);
+        out.data = path + Align8(header.path_size);
+        out.size = header.blob_size;
+        out.width = header.width;
+        out.height = header.height;
+        out.segment = data.segment;
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+/** @brief Get() through the fingerprint table. Misses are not counted; the path lookup before it was. */
+bool ThumbnailStore::GetByFingerprint(uint64_t fingerprint, int64_t mtime, ThumbnailView& out) {
+    memset(&out, 0, sizeof(out));
+    if (!open_ || !fingerprint) return false;
+
+    size_t pos = static_cast<size_t>(fingerprint) & mask_;
+    for (size_t probe = 0; probe <= mask_; ++probe, pos = (pos + 1) & mask_) {
+        SlotData data;
+        if (!fp_slots_[pos].Load(data) || !data.key) break;
+        if (data.key != fingerprint) continue;
+
+        Segment* segment = nullptr;
+        const uint8_t* record = PinRecord(data, segment);
+        if (!record) break;
+        RecordHeader header;
+        memcpy(&header, record, sizeof(header));
+        if (header.magic != kRecordMagic || header.fingerprint != fingerprint || header.mtime != mtime ||
+            RecordSize(header.path_size, header.blob_size) != data.length) {
+            Unpin(segment);
+            break;
+        }
+
+        out.data = record + sizeof(RecordHeader) + Align8(header.path_size);
+        out.size = header.blob_size;
+        out.width = header.width;
+        out.height = header.height;
+        out.segment = data.segment;
+        content_hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+/** @brief Pins the segment of a slot and returns its record, or nullptr if it is gone or out of range. */
+const uint8_t* ThumbnailStore::PinRecord(const SlotData& data, Segment*& segment) {
+    segment = Pin(data.segment);
+    if (!segment) return nullptr;
+    const uint8_t* base = segment->base.load(std::memory_order_acquire);
+    const uint64_t capacity = segment->capacity.load(std::memory_order_relaxed);
+    if (!base || data.offset + data.length > capacity) {
+        Unpin(segment);
+        return nullptr;
+    }
+    return base + data.offset;
+}
+
+void ThumbnailStore::Release(const ThumbnailView& view) {
+    if (!view.data || !segments_) return;
+    Unpin(&segments_[view.segment % kMaxSegments]);
+}
+
+/**
+ * @brief Pins a segment for reading. The pin is published before the state is checked, and
+ *        Retire() publishes the state before it checks the pins, so with sequentially
+ *        consistent ordering at least one side sees the other and a mapping is never closed
+ *        under a reader.
+ */
+ThumbnailStore::Segment* ThumbnailStore::Pin(uint32_t id) {
+    Segment* segment = &segments_[id % kMaxSegments];
+    segment->pins.fetch_add(1, std::memory_order_seq_cst);
+    if (segment->state.load(std::memory_order_seq_cst) != Segment_Live ||
+        segment->id.load(std::memory_order_seq_cst) != id) {
+        Unpin(segment);
+        return nullptr;
+    }
+    return segment;
+}
+
+void ThumbnailStore::Unpin(Segment* segment) {
+    segment->pins.fetch_sub(1, std::memory_order_release);
+}
+
+/** @brief Writer-side lookup of a live or retiring segment by id. */
+ThumbnailStore::Segment* ThumbnailStore::SegmentFor(uint32_t id) const {
+    if (!id || !segments_) return nullptr;
+    Segment* segment = &segments_[id % kMaxSegments];
+    return segment->state.load(std::memory_order_relaxed) != Segment_Free &&
+        segment->id.load(std::memory_order_relaxed) == id ? segment : nullptr;
+}
+
+/**
+ * @brief Maps an existing segment file. With `scan`, walks its records to find the append
+ *        point; otherwise the segment is treated as full (it was sealed by an earlier session).
+ */
+bool ThumbnailStore::LoadSegment(uint32_t id, bool scan) {
+    Segment& segment = segments_[id % kMaxSegments];
+    if (segment.state.load(std::memory_order_relaxed) != Segment_Free) return false;
+    if (!segment.file.Open(SegmentPath(folder_, id), 0)) return false;
+
+    SegmentHeader header;
+    if (segment.file.Size() < sizeof(SegmentHeader)) {
+        segment.file.Close();
+        return false;
+    }
+    memcpy(&header, segment.file.Data(), sizeof(header));
+    if (memcmp(header.magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0 || header.version != kVersion || header.id != id) {
+        segment.file.Close();
+        return false;
+    }
+
+    segment.used = scan ? segment.ForEachRecord(false, [](uint64_t, const RecordHeader&) {}) : segment.file.Size();
+    segment.live_bytes = 0;
+    segment.live_records = 0;
+    segment.base.store(segment.file.Data(), std::memory_order_relaxed);
+    segment.capacity.store(segment.file.Size(), std::memory_order_relaxed);
+    segment.id.store(id, std::memory_order_seq_cst);
+    segment.state.store(Segment_Live, std::memory_order_seq_cst);
+    return true;
+}
+
+/** @brief Starts a new, empty segment file under the next id. */
+ThumbnailStore::Segment* ThumbnailStore::CreateSegment() {
+    for (uint32_t attempt = 0; attempt < kMaxSegments; ++attempt) {
+        const uint32_t id = next_segment_++;
+        if (!id) continue;
+        Segment& segment = segments_[id % kMaxSegments];
+        if (segment.state.load(std::memory_order_relaxed) != Segment_Free) {
+            ReapRetired();
+            if (segment.state.load(std::memory_order_relaxed) != Segment_Free) continue;
+        }
+
+        const fs::path path = SegmentPath(folder_, id);
+        std::error_code ec;
+        fs::remove(path, ec);
+        if (!segment.file.Open(path, segment_bytes_)) return nullptr;
+
+        SegmentHeader header{};
+        memcpy(header.magic, kSegmentMagic, sizeof(kSegmentMagic));
+        header.version = kVersion;
+        header.id = id;
+        memcpy(segment.file.Data(), &header, sizeof(header));
+
+        segment.used = sizeof(SegmentHeader);
+        segment.live_bytes = 0;
+        segment.live_records = 0;
+        segment.base.store(segment.file.Data(), std::memory_order_relaxed);
+        segment.capacity.store(segment.file.Size(), std::memory_order_relaxed);
+        segment.id.store(id, std::memory_order_seq_cst);
+        segment.state.store(Segment_Live, std::memory_order_seq_cst);
+        flushed_to_ = 0;
+        return &segment;
+    }
+    return nullptr;
+}
+
+/** @brief Makes sure the active segment can take `bytes` more, sealing it and starting another if not. */
+bool ThumbnailStore::EnsureRoom(uint64_t bytes) {
+    if (active_ && active_->used + bytes <= active_->file.Size()) return true;
+    FlushActive();
+    active_ = CreateSegment();
+    return active_ && active_->used + bytes <= active_->file.Size();
+}
+
+/**
+ * @brief Stops new readers of a segment. Its file is deleted by ReapRetired() once unpinned.
+ *        Fingerprint slots still pointing into it are dropped; path slots never do by now.
+ */
+void ThumbnailStore::Retire(Segment* segment) {
+    if (segment == active_) active_ = nullptr;
+    segment->state.store(Segment_Retired, std::memory_order_seq_cst);
+
+    const uint32_t id = segment->id.load(std::memory_order_relaxed);
+    std::vector<uint64_t> stale;
+    for (size_t pos = 0; pos <= mask_; ++pos) {
+        const SlotData data = fp_slots_[pos].Peek();
+        if (data.key && data.segment == id) stale.push_back(data.key);
+    }
+    for (uint64_t key : stale) {
+        size_t pos;
+        if (FindSlot(fp_slots_, key, pos)) RemoveAt(fp_slots_, pos);
+    }
+    ReapRetired();
+}
+
+void ThumbnailStore::ReapRetired() {
+    if (!segments_) return;
+    std::error_code ec;
+    for (uint32_t i = 0; i < kMaxSegments; ++i) {
+        Segment& segment = segments_[i];
+        if (segment.state.load(std::memory_order_seq_cst) != Segment_Retired ||
+            segment.pins.load(std::memory_order_seq_cst) != 0) continue;
+        const uint32_t id = segment.id.load(std::memory_order_relaxed);
+        segment.base.store(nullptr, std::memory_order_relaxed);
+        segment.capacity.store(0, std::memory_order_relaxed);
+        segment.file.Close();
+        fs::remove(SegmentPath(folder_, id), ec);
+        segment.id.store(0, std::memory_order_seq_cst);
+        segment.state.store(Segment_Free, std::memory_order_seq_cst);
+    }
+}
+
+/** @brief Asks the OS to write back what was appended to the active segment since the last flush. */
+void ThumbnailStore::FlushActive() {
+    if (!active_ || active_->used <= flushed_to_) return;
+    active_->file.Flush(flushed_to_, static_cast<size_t>(active_->used - flushed_to_));
+    flushed_to_ = static_cast<size_t>(active_->used);
+}
+
+/**
+ * @brief Copies the blob so the caller's buffer can be reused immediately; the writer thread
+ *        does the rest.
+ */
+bool ThumbnailStore::Put(std::string_view utf8_path, int64_t mtime, const uint8_t* data, size_t size,
+                         int32_t width, int32_t height, uint64_t fingerprint) {
+    if (!open_ || !data || size == 0) return false;
+    return Put(utf8_path, mtime, std::vector<uint8_t>(data, data + size), width, height, fingerprint);
+}
+
+bool ThumbnailStore::Put(std::string_view utf8_path, int64_t mtime, std::vector<uint8_t>&& blob,
+                         int32_t width, int32_t height, uint64_t fingerprint) {
+    const size_t size = blob.size();
+    if (!open_ || size == 0 || size > UINT32_MAX || utf8_path.empty() || utf8_path.size() > UINT32_MAX) return false;
+    if (RecordSize(utf8_path.size(), size) > segment_bytes_ - sizeof(SegmentHeader)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Pending item;
+    item.key = HashPath(utf8_path);
+    item.fingerprint = fingerprint;
+    item.mtime = mtime;
+    item.width = width;
+    item.height = height;
+    item.path.assign(utf8_path);
+    item.blob = std::move(blob);
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (queued_bytes_ + size > kMaxQueuedBytes) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        item.ticket = ++enqueued_ticket_;
+        queued_bytes_ += size;
+        queue_.push_back(std::move(item));
+    }
+    queue_cv_.notify_one();
+    return true;
+}
+
+/** @brief Queued behind any Put() of the target, which the writer resolves first. */
+bool ThumbnailStore::Alias(std::string_view utf8_path, int64_t mtime, uint64_t fingerprint) {
+    if (!open_ || !fingerprint || utf8_path.empty()) return false;
+
+    Pending item;
+    item.alias = true;
+    item.key = HashPath(utf8_path);
+    item.fingerprint = fingerprint;
+    item.mtime = mtime;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        item.ticket = ++enqueued_ticket_;
+        queue_.push_back(std::move(item));
+    }
+    queue_cv_.notify_one();
+    return true;
+}
+
+void ThumbnailStore::Flush() {
+    if (!open_) return;
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    const uint64_t ticket = enqueued_ticket_;
+    queue_cv_.notify_one();
+    done_cv_.wait(lock, [&] { return committed_ticket_ >= ticket; });
+}
+
+/** @brief Queued like a write, so Put() calls made before it are committed first and then dropped. */
+void ThumbnailStore::Clear() {
+    if (!open_) return;
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    Pending item;
+    item.clear = true;
+    item.ticket = ++enqueued_ticket_;
+    const uint64_t ticket = item.ticket;
+    queue_.push_back(std::move(item));
+    queue_cv_.notify_one();
+    done_cv_.wait(lock, [&] { return committed_ticket_ >= ticket; });
+}
+
+/**
+ * @brief Drains the queue in batches. Everything that arrived while the previous batch was
+ *        being written goes out as one commit; a wait that times out means the caller side is
+ *        idle, which is when compaction runs.
+ */
+void ThumbnailStore::WriterLoop() {
+    std::vector<Pending> batch;
+    for (;;) {
+        bool idle = false;
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            if (queue_.empty() && !stop_) {
+                idle = !queue_cv_.wait_for(lock, kIdleInterval, [this] { return stop_ || !queue_.empty(); });
+            }
+            batch.swap(queue_);
+            queued_bytes_ = 0;
+            stop = stop_;
+        }
+
+        size_t begin = 0;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (!batch[i].clear) continue;
+            Commit(batch, begin, i);
+            ClearAll();
+            begin = i + 1;
+        }
+        Commit(batch, begin, batch.size());
+        if (idle) Compact();
+        PublishStats();
+
+        if (!batch.empty()) {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            committed_ticket_ = batch.back().ticket;
+        }
+        done_cv_.notify_all();
+        batch.clear();
+        if (stop) break;
+    }
+}
+
+/**
+ * @brief Appends batch[begin, end), flushes once, then publishes the slots. Readers therefore
+ *        never see an entry whose bytes have not at least been handed to the OS.
+ */
+void ThumbnailStore::Commit(std::vector<Pending>& batch, size_t begin, size_t end) {
+    if (begin >= end) return;
+    std::vector<SlotData> staged;
+    staged.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        if (batch[i].alias) continue;
+        SlotData data;
+        if (AppendRecord(batch[i], data)) {
+            staged.push_back(data);
+        } else {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::vector<uint8_t>().swap(batch[i].blob);
+    }
+    FlushActive();
+    for (const SlotData& data : staged) {
+        Upsert(data);
+    }
+    // After the records, so an alias may target a blob put in the same batch.
+    for (size_t i = begin; i < end; ++i) {
+        if (batch[i].alias) ResolveAlias(batch[i]);
+    }
+    puts_.fetch_add(staged.size(), std::memory_order_relaxed);
+    commits_.fetch_add(1, std::memory_order_relaxed);
+    EvictIfNeeded();
+}
+
+/** @brief Adds or replaces the path slot of an alias with a copy of the fingerprint's slot. */
+void ThumbnailStore::ResolveAlias(const Pending& item) {
+    size_t pos;
+    if (!FindSlot(fp_slots_, item.fingerprint, pos)) return;
+    SlotData data = fp_slots_[pos].Peek();
+    if (!SegmentFor(data.segment)) return;
+    data.key = item.key;
+    data.mtime = item.mtime;
+    data.fingerprint = item.fingerprint;
+    data.flags = kSlotAlias;
+    data.last_access = NowSeconds();
+    Upsert(data);
+}
+
+/** @brief Writes one record into the active segment. The magic goes in last. */
+bool ThumbnailStore::AppendRecord(const Pending& item, SlotData& out) {
+    const uint64_t size = RecordSize(item.path.size(), item.blob.size());
+    if (!EnsureRoom(size)) return false;
+
+    uint8_t* dst = active_->file.Data() + active_->used;
+    RecordHeader header{};
+    header.path_size = static_cast<uint32_t>(item.path.size());
+    header.key = item.key;
+    header.sequence = next_sequence_++;
+    header.mtime = item.mtime;
+    header.fingerprint = item.fingerprint;
+    header.blob_size = static_cast<uint32_t>(item.blob.size());
+    header.width = item.width;
+    header.height = item.height;
+
+    uint8_t* path = dst + sizeof(RecordHeader);
+    uint8_t* blob = path + Align8(header.path_size);
+    memcpy(path, item.path.data(), item.path.size());
+    memset(path + item.path.size(), 0, Align8(item.path.size()) - item.path.size());
+    memcpy(blob, item.blob.data(), item.blob.size());
+    memset(blob + item.blob.size(), 0, Align8(item.blob.size()) - item.blob.size());
+    header.checksum = Checksum(Checksum(header.key, path, header.path_size), blob, header.blob_size);
+
+    memcpy(dst, &header, sizeof(header));
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(dst, &kRecordMagic, sizeof(kRecordMagic));
+
+    out.key = item.key;
+    out.mtime = item.mtime;
+    out.fingerprint = item.fingerprint;
+    out.segment = active_->id.load(std::memory_order_relaxed);
+    out.offset = active_->used;
+    out.length = static_cast<uint32_t>(size);
+    out.last_access = NowSeconds();
+    active_->used += size;
+    return true;
+}
+
+/**
+ * @brief Drops the least recently read quarter of the entries once either limit is passed
+ *        (more if the byte limit needs it), then retires segments left with nothing live.
+ */
+void ThumbnailStore::EvictIfNeeded() {
+    if (entries_ <= max_entries_ && live_bytes_ <= max_bytes_) return;
+
+    std::vector<std::pair<uint64_t, uint64_t>> by_age;   // (last_access, key)
+    by_age.reserve(static_cast<size_t>(entries_));
+    for (size_t pos = 0; pos <= mask_; ++pos) {
+        const SlotData data = slots_[pos].Peek();
+        if (data.key) by_age.emplace_back(data.last_access, data.key);
+    }
+    std::sort(by_age.begin(), by_age.end());
+
+    const uint64_t count_target = std::max<uint64_t>(
+        static_cast<uint64_t>(by_age.size() * kEvictFraction), entries_ > max_entries_ ? entries_ - max_entries_ : 0);
+    const uint64_t bytes_target = static_cast<uint64_t>(max_bytes_ * (1.0 - kEvictFraction));
+    uint64_t removed = 0;
+    for (const auto& [age, key] : by_age) {
+        if (removed >= count_target && live_bytes_ <= bytes_target) break;
+        size_t pos;
+        if (!FindSlot(slots_, key, pos)) continue;
+        EraseAt(pos);
+        removed++;
+    }
+    evicted_.fetch_add(removed, std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < kMaxSegments; ++i) {
+        Segment& segment = segments_[i];
+        if (&segment != active_ && segment.state.load(std::memory_order_relaxed) == Segment_Live &&
+            segment.live_records == 0) {
+            Retire(&segment);
+            compactions_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Rewrites the sealed segment with the smallest live fraction, if it is below
+ *        kCompactBelow: its live records are appended to the active segment, the slots are
+ *        repointed and the old segment is retired. One segment per idle period keeps each
+ *        pass short.
+ */
+void ThumbnailStore::Compact() {
+    ReapRetired();
+
+    Segment* victim = nullptr;
+    double lowest = kCompactBelow;
+    for (uint32_t i = 0; i < kMaxSegments; ++i) {
+        Segment& segment = segments_[i];
+        if (&segment == active_ || segment.state.load(std::memory_order_relaxed) != Segment_Live) continue;
+        const double live = static_cast<double>(segment.live_bytes) / static_cast<double>(segment.file.Size());
+        if (live < lowest) {
+            lowest = live;
+            victim = &segment;
+        }
+    }
+    if (!victim) return;
+
+    // A record shared by a path and its aliases is copied once; `copies` maps its old offset
+    // to the new one.
+    const uint32_t victim_id = victim->id.load(std::memory_order_relaxed);
+    std::vector<std::pair<size_t, SlotData>> moved;
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint64_t>> copies;
+    for (size_t pos = 0; pos <= mask_; ++pos) {
+        SlotData data = slots_[pos].Peek();
+        if (!data.key || data.segment != victim_id) continue;
+        auto copy = copies.find(data.offset);
+        if (copy == copies.end()) {
+            if (!EnsureRoom(data.length)) return;
+            memcpy(active_->file.Data() + active_->used, victim->file.Data() + data.offset, data.length);
+            copy = copies.emplace(data.offset, std::make_pair(active_->id.load(std::memory_order_relaxed), active_->used)).first;
+            active_->used += data.length;
+        }
+        data.segment = copy->second.first;
+        data.offset = copy->second.second;
+        moved.emplace_back(pos, data);
+    }
+    FlushActive();
+
+    // Fingerprints of copied records follow them; the rest are dropped by Retire().
+    for (size_t pos = 0; pos <= mask_; ++pos) {
+        SlotData data = fp_slots_[pos].Peek();
+        if (!data.key || data.segment != victim_id) continue;
+        const auto copy = copies.find(data.offset);
+        if (copy == copies.end()) continue;
+        data.segment = copy->second.first;
+        data.offset = copy->second.second;
+        fp_slots_[pos].Store(data);
+    }
+
+    for (auto& [pos, data] : moved) {
+        data.last_access = slots_[pos].last_access.load(std::memory_order_relaxed);
+        victim->live_bytes -= std::min<uint64_t>(victim->live_bytes, data.length);
+        SegmentFor(data.segment)->live_bytes += data.length;
+        SegmentFor(data.segment)->live_records++;
+        slots_[pos].Store(data);
+    }
+    victim->live_records = 0;
+    Retire(victim);
+    compactions_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/** @brief Empties the index and retires every segment, then starts a fresh one. */
+void ThumbnailStore::ClearAll() {
+    for (size_t pos = 0; pos <= mask_; ++pos) {
+        if (slots_[pos].key.load(std::memory_order_relaxed)) slots_[pos].Store(SlotData{});
+        if (fp_slots_[pos].key.load(std::memory_order_relaxed)) fp_slots_[pos].Store(SlotData{});
+    }
+    entries_ = 0;
+    live_bytes_ = 0;
+    for (uint32_t i = 0; i < kMaxSegments; ++i) {
+        if (segments_[i].state.load(std::memory_order_relaxed) == Segment_Live) Retire(&segments_[i]);
+    }
+    active_ = CreateSegment();
+}
+
+void ThumbnailStore::PublishStats() {
+    uint64_t file_bytes = 0;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < kMaxSegments; ++i) {
+        if (segments_[i].state.load(std::memory_order_relaxed) == Segment_Free) continue;
+        file_bytes += segments_[i].file.Size();
+        count++;
+    }
+    stat_entries_.store(entries_, std::memory_order_relaxed);
+    stat_live_bytes_.store(live_bytes_, std::memory_order_relaxed);
+    stat_file_bytes_.store(file_bytes, std::memory_order_relaxed);
+    stat_segments_.store(count, std::memory_order_relaxed);
+}
+
+void ThumbnailStore::GetStats(ThumbnailStoreStats& out) const {
+    memset(&out, 0, sizeof(out));
+    out.entries = stat_entries_.load(std::memory_order_relaxed);
+    out.live_bytes = stat_live_bytes_.load(std::memory_order_relaxed);
+    out.file_bytes = stat_file_bytes_.load(std::memory_order_relaxed);
+    out.hits = hits_.load(std::memory_order_relaxed);
+    out.misses = misses_.load(std::memory_order_relaxed);
+    out.content_hits = content_hits_.load(std::memory_order_relaxed);
+    out.puts = puts_.load(std::memory_order_relaxed);
+    out.dropped = dropped_.load(std::memory_order_relaxed);
+    out.evicted = evicted_.load(std::memory_order_relaxed);
+    out.commits = commits_.load(std::memory_order_relaxed);
+    out.segments = stat_segments_.load(std::memory_order_relaxed);
+    out.compactions = compactions_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Lets the writer drain the queue, then marks the index clean so the next Open() can
+ *        trust it without scanning the segments.
+ */
+void ThumbnailStore::Close() {
+    if (writer_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            stop_ = true;
+        }
+        queue_cv_.notify_all();
+        writer_.join();
+    }
+
+    if (open_) {
+        ReapRetired();
+        FlushActive();
+        auto* header = reinterpret_cast<IndexHeader*>(index_file_.Data());
+        header->next_segment = next_segment_;
+        header->next_sequence = next_sequence_;
+        std::atomic_thread_fence(std::memory_order_release);
+        header->clean = 1;
+        index_file_.Flush(0, index_file_.Size());
+    }
+
+    if (segments_) {
+        std::error_code ec;
+        for (uint32_t i = 0; i < kMaxSegments; ++i) {
+            Segment& segment = segments_[i];
+            if (segment.state.load(std::memory_order_relaxed) == Segment_Retired) {
+                segment.file.Close();
+                fs::remove(SegmentPath(folder_, segment.id.load(std::memory_order_relaxed)), ec);
+            }
+            segment.file.Close();
+        }
+        segments_.reset();
+    }
+    index_file_.Close();
+    ReleaseLock(lock_);
+
+    lock_ = nullptr;
+    slots_ = nullptr;
+    fp_slots_ = nullptr;
+    mask_ = 0;
+    active_ = nullptr;
+    open_ = false;
+    stop_ = false;
+    next_segment_ = 1;
+    next_sequence_ = 1;
+    flushed_to_ = 0;
+    entries_ = 0;
+    live_bytes_ = 0;
+    queue_.clear();
+    queued_bytes_ = 0;
+    enqueued_ticket_ = committed_ticket_ = 0;
+}
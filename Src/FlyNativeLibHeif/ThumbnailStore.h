@@ -0,0 +1,227 @@
+/**
+ * @file ThumbnailStore.h
+ * @brief Defines ThumbnailStore, the persistent cache of encoded preview thumbnails.
+ *
+ * Blobs are appended to fixed-size segment files ("thumbs_00000001.seg", ...) and never
+ * modified in place. A memory-mapped open-addressing hash table ("thumbs.idx"), keyed by a
+ * 64-bit hash of the source path, points at the newest record of every path.
+ *
+ * - Readers never lock. Each index slot is guarded by a sequence counter, and a reader pins
+ *   the segment it is about to read, so Get() returns a view straight into the mapping that
+ *   stays valid until Release(), even if the entry is replaced or compacted meanwhile.
+ * - All writes go through one background thread. Put() copies the blob into a queue; the
+ *   writer drains whatever has accumulated, appends it, asks the OS to write the range back
+ *   once per batch (group commit) and only then publishes the new slots.
+ * - When the writer is idle it compacts: the live records of a mostly-dead segment are copied
+ *   to the active segment and the old file is deleted once no reader has it pinned.
+ *
+ * Records may also carry a content fingerprint (see ContentFingerprint). A second table in the
+ * index maps fingerprints to records, so a file that was moved or renamed can still be found
+ * by its content and its unchanged last write time; Alias() then adds a slot for the new path that points at the existing record,
+ * and later lookups by the new path hit directly. Alias slots live only in the index: a rebuild
+ * drops them and they are re-created on the next lookup by fingerprint.
+ *
+ * Eviction (least recently read first) and compaction only touch the index and the segment
+ * files; a crash leaves the index marked dirty and it is rebuilt from the segments on the
+ * next Open(). Evictions are not logged, so an evicted entry may reappear after a crash -
+ * harmless, since entries are checked against the caller's mtime on every Get().
+ *
+ * Only one process may have a store open: Open() takes an exclusive lock file in the folder,
+ * waiting up to two seconds for another process to release it.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef THUMBNAIL_STORE_H
+#define THUMBNAIL_STORE_H
+
+#include "FileSource.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/// @brief A zero-copy view of one cached blob. Blittable for P/Invoke.
+struct ThumbnailView {
+    const uint8_t* data;    ///< First byte of the blob inside the mapped segment. Valid until ThumbnailStore::Release().
+    uint32_t size;          ///< Blob size in bytes.
+    int32_t width;          ///< The width stored by Put() (the FlyPhotos cache stores the original image size).
+    int32_t height;         ///< The height stored by Put().
+    uint32_t segment;       ///< The pinned segment. Only meaningful to Release().
+};
+
+/// @brief Counters reported by ThumbnailStore::GetStats(). Blittable for P/Invoke.
+struct ThumbnailStoreStats {
+    uint64_t entries;           ///< Live entries in the index.
+    uint64_t live_bytes;        ///< Bytes of live records (headers, paths and blobs).
+    uint64_t file_bytes;        ///< Bytes reserved by segment files on disk.
+    uint64_t hits;              ///< Get() calls that returned a view.
+    uint64_t misses;            ///< Get() calls that did not (absent, stale or contended).
+    uint64_t content_hits;      ///< GetByFingerprint() calls that returned a view.
+    uint64_t puts;              ///< Records committed by the writer.
+    uint64_t dropped;           ///< Put() calls rejected because the blob was too large or the queue was full.
+    uint64_t evicted;           ///< Entries removed by LRU eviction.
+    uint64_t commits;           ///< Writer batches (group commits).
+    uint32_t segments;          ///< Segment files in use.
+    uint32_t compactions;       ///< Segments rewritten or deleted by compaction.
+};
+
+/// @brief An append-only, memory-mapped blob cache with lock-free readers and a single writer thread.
+class ThumbnailStore {
+public:
+    static constexpr uint32_t kVersion = 2;
+    static constexpr uint64_t kDefaultSegmentBytes = 32ull << 20;
+
+    ThumbnailStore();
+    ~ThumbnailStore();
+
+    ThumbnailStore(const ThumbnailStore&) = delete;
+    ThumbnailStore& operator=(const ThumbnailStore&) = delete;
+
+    /// @brief Opens or creates the store in `folder` and starts the writer thread.
+    /// @param folder Directory holding the index and segment files. Created if missing.
+    /// @param max_bytes Live bytes above which the least recently read entries are evicted.
+    /// @param max_entries Entry count above which eviction runs; also sizes the hash table.
+    /// @param segment_bytes Size of each segment file. Raised if needed so max_bytes fits the segment table.
+    /// @return false if the folder cannot be used, or another process kept the store open for the
+    ///         two seconds Open() waits for its lock.
+    bool Open(const std::filesystem::path& folder, uint64_t max_bytes, uint32_t max_entries,
+              uint64_t segment_bytes = kDefaultSegmentBytes);
+
+    /// @brief Commits pending writes, stops the writer and unmaps everything.
+    /// @note No view returned by Get() may be outstanding, and no other call may be in progress.
+    void Close();
+
+    bool IsOpen() const { return open_; }
+
+    /// @brief Looks up the blob stored for `utf8_path` with the given `mtime`. Never blocks.
+    /// @return true and a pinned view on a hit; the caller must pass the view to Release().
+    bool Get(std::string_view utf8_path, int64_t mtime, ThumbnailView& out);
+
+    /// @brief Looks up the newest blob stored with `fingerprint` and `mtime`, whatever its path. Never blocks.
+    /// @details A move or rename keeps the last write time, but an edit in place changes it. The
+    ///          fingerprint samples only part of the file, so an edit can leave it unchanged.
+    /// @return true and a pinned view on a hit; the caller must pass the view to Release().
+    bool GetByFingerprint(uint64_t fingerprint, int64_t mtime, ThumbnailView& out);
+
+    /// @brief Unpins the segment of a view returned by Get() or GetByFingerprint().
+    void Release(const ThumbnailView& view);
+
+    /// @brief Queues a blob for `utf8_path`, replacing any older one. The data is copied.
+    /// @param fingerprint Content fingerprint of the source file, or 0 to store without one.
+    /// @return false if the blob can never fit a segment or too much is already queued.
+    bool Put(std::string_view utf8_path, int64_t mtime, const uint8_t* data, size_t size,
+             int32_t width, int32_t height, uint64_t fingerprint = 0);
+
+    /// @brief Put() for a blob the caller built only to store; takes ownership instead of copying.
+    bool Put(std::string_view utf8_path, int64_t mtime, std::vector<uint8_t>&& blob,
+             int32_t width, int32_t height, uint64_t fingerprint = 0);
+
+    /// @brief Queues an alias: `utf8_path` with `mtime` will resolve to the record stored with
+    ///        `fingerprint`, without copying the blob. Ignored if no such record exists by then.
+    bool Alias(std::string_view utf8_path, int64_t mtime, uint64_t fingerprint);
+
+    /// @brief Blocks until everything queued before the call is committed and visible to Get().
+    void Flush();
+
+    /// @brief Removes every entry and deletes the segment files. Blocks until done.
+    void Clear();
+
+    /// @brief Snapshot of the counters. Approximate while the writer is busy.
+    void GetStats(ThumbnailStoreStats& out) const;
+
+    /// @brief The 64-bit FNV-1a hash used as the index key.
+    static uint64_t HashPath(std::string_view utf8_path);
+
+private:
+    struct Slot;
+    struct SlotData;
+    struct Segment;
+    struct Pending;
+
+    // Index
+    bool OpenIndex(uint64_t capacity, bool& clean);
+    void RebuildIndex();
+    bool FindSlot(const Slot* table, uint64_t key, size_t& pos) const;
+    void Upsert(const SlotData& data);
+    void EraseAt(size_t pos);
+    void RemoveAt(Slot* table, size_t pos);
+    void SetFingerprint(const SlotData& data);
+    void ResolveAlias(const Pending& item);
+
+    // Segments
+    const uint8_t* PinRecord(const SlotData& data, Segment*& segment);
+    Segment* Pin(uint32_t id);
+    static void Unpin(Segment* segment);
+    Segment* CreateSegment();
+    bool LoadSegment(uint32_t id, bool scan);
+    bool EnsureRoom(uint64_t bytes);
+    void Retire(Segment* segment);
+    void ReapRetired();
+    Segment* SegmentFor(uint32_t id) const;
+
+    // Writer
+    void WriterLoop();
+    void Commit(std::vector<Pending>& batch, size_t begin, size_t end);
+    bool AppendRecord(const Pending& item, SlotData& out);
+    void EvictIfNeeded();
+    void Compact();
+    void ClearAll();
+    void FlushActive();
+    void PublishStats();
+
+    std::filesystem::path folder_;
+    uint64_t max_bytes_ = 0;
+    uint32_t max_entries_ = 0;
+    uint64_t segment_bytes_ = kDefaultSegmentBytes;
+    bool open_ = false;
+
+    WritableMappedFile index_file_;
+    Slot* slots_ = nullptr;         // Path keys (records and aliases).
+    Slot* fp_slots_ = nullptr;      // Fingerprint keys, same capacity.
+    size_t mask_ = 0;
+    void* lock_ = nullptr;
+
+    std::unique_ptr<Segment[]> segments_;
+    Segment* active_ = nullptr;
+    uint32_t next_segment_ = 1;
+    uint64_t next_sequence_ = 1;
+    size_t flushed_to_ = 0;
+
+    // Writer-owned totals, published to GetStats() through atomics.
+    uint64_t entries_ = 0;
+    uint64_t live_bytes_ = 0;
+    std::atomic<uint64_t> stat_entries_{ 0 };
+    std::atomic<uint64_t> stat_live_bytes_{ 0 };
+    std::atomic<uint64_t> stat_file_bytes_{ 0 };
+    std::atomic<uint32_t> stat_segments_{ 0 };
+    mutable std::atomic<uint64_t> hits_{ 0 };
+    mutable std::atomic<uint64_t> misses_{ 0 };
+    mutable std::atomic<uint64_t> content_hits_{ 0 };
+    std::atomic<uint64_t> puts_{ 0 };
+    std::atomic<uint64_t> dropped_{ 0 };
+    std::atomic<uint64_t> evicted_{ 0 };
+    std::atomic<uint64_t> commits_{ 0 };
+    std::atomic<uint32_t> compactions_{ 0 };
+
+    // Queue shared between callers and the writer.
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::condition_variable done_cv_;
+    std::vector<Pending> queue_;
+    uint64_t queued_bytes_ = 0;
+    uint64_t enqueued_ticket_ = 0;
+    uint64_t committed_ticket_ = 0;
+    bool stop_ = false;
+    std::thread writer_;
+};
+
+#endif // THUMBNAIL_STORE_H
@@ -0,0 +1,852 @@
+/**
+ * @file TiffDecoder.cpp
+ * @brief Implements TiffDecoder.
+ */
+
+#include "TiffDecoder.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <thread>
+#include <unordered_set>
+#include <zlib.h>
+
+#ifdef _MSC_VER
+#ifdef _DEBUG
+#pragma comment(lib, "zlibd.lib")
+#else
+#pragma comment(lib, "zlib.lib")
+#endif
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLY_TIFF_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    /// Below this many pixels per worker, starting a thread costs more than it saves.
+    constexpr uint64_t kPixelsPerWorker = 1 << 16;
+
+    /// Largest strip or tile decoded, uncompressed.
+    constexpr uint64_t kMaxChunkBytes = 1ull << 30;
+
+    /// SubIFDs read per directory; a page has a handful of reductions at most.
+    constexpr uint64_t kMaxSubIfds = 64;
+
+    enum Tag : uint16_t {
+        kNewSubfileType = 254,
+        kImageWidth = 256,
+        kImageLength = 257,
+        kBitsPerSample = 258,
+        kCompression = 259,
+        kPhotometric = 262,
+        kFillOrder = 266,
+        kStripOffsets = 273,
+        kOrientation = 274,
+        kSamplesPerPixel = 277,
+        kRowsPerStrip = 278,
+        kStripByteCounts = 279,
+        kPlanarConfig = 284,
+        kPredictor = 317,
+        kColorMap = 320,
+        kTileWidth = 322,
+        kTileLength = 323,
+        kTileOffsets = 324,
+        kTileByteCounts = 325,
+        kSubIfds = 330,
+        kExtraSamples = 338,
+        kSampleFormat = 339,
+    };
+
+    enum Compression : uint16_t {
+        kNone = 1,
+        kLzw = 5,
+        kDeflate = 8,
+        kPackBits = 32773,
+        kDeflateOld = 32946,
+    };
+
+    uint32_t TypeSize(uint16_t type) {
+        switch (type) {
+            case 1: case 2: case 6: case 7: return 1;       // BYTE, ASCII, SBYTE, UNDEFINED
+            case 3: case 8: return 2;                       // SHORT, SSHORT
+            case 4: case 9: case 11: case 13: return 4;     // LONG, SLONG, FLOAT, IFD
+            case 5: case 10: case 12: return 8;             // RATIONAL, SRATIONAL, DOUBLE
+            case 16: case 17: case 18: return 8;            // LONG8, SLONG8, IFD8
+            default: return 0;
+        }
+    }
+
+    /// round(c * a / 255) without a division.
+    inline uint32_t Premultiply(uint32_t c, uint32_t a) {
+        const uint32_t v = c * a + 128;
+        return (v + (v >> 8)) >> 8;
+    }
+
+    inline uint32_t Opaque(uint32_t r, uint32_t g, uint32_t b) { return 0xFF000000u | (r << 16) | (g << 8) | b; }
+
+    inline uint32_t WithAlpha(uint32_t r, uint32_t g, uint32_t b, uint32_t a, bool straight) {
+        if (a == 255) return Opaque(r, g, b);
+        if (straight) return (a << 24) | (Premultiply(r, a) << 16) | (Premultiply(g, a) << 8) | Premultiply(b, a);
+        // Associated alpha is premultiplied already; a colour above its alpha is out of range.
+        return (a << 24) | (std::min(r, a) << 16) | (std::min(g, a) << 8) | std::min(b, a);
+    }
+
+    /// Sample `i` of a pixel, cut to 8 bits. 16-bit samples are little-endian by the time they get here.
+    template <bool k16>
+    inline uint32_t Sample(const uint8_t* pixel, uint32_t i) {
+        if constexpr (k16) return pixel[2 * i + 1];
+        else return pixel[i];
+    }
+
+    template <bool k16>
+    void GrayRow(const uint8_t* src, uint32_t count, uint32_t samples, int32_t alpha, bool straight, uint32_t invert,
+                 uint32_t* out) {
+        const size_t step = k16 ? samples * 2 : samples;
+        if (alpha < 0) {
+            for (uint32_t x = 0; x < count; ++x, src += step) {
+                const uint32_t g = Sample<k16>(src, 0) ^ invert;
+                out[x] = Opaque(g, g, g);
+            }
+        } else {
+            for (uint32_t x = 0; x < count; ++x, src += step) {
+                const uint32_t g = Sample<k16>(src, 0) ^ invert;
+                out[x] = WithAlpha(g, g, g, Sample<k16>(src, alpha), straight);
+            }
+        }
+    }
+
+    template <bool k16>
+    void RgbRow(const uint8_t* src, uint32_t count, uint32_t samples, int32_t alpha, bool straight, uint32_t* out) {
+        const size_t step = k16 ? samples * 2 : samples;
+        if (alpha < 0) {
+            for (uint32_t x = 0; x < count; ++x, src += step)
+                out[x] = Opaque(Sample<k16>(src, 0), Sample<k16>(src, 1), Sample<k16>(src, 2));
+        } else {
+            for (uint32_t x = 0; x < count; ++x, src += step)
+                out[x] = WithAlpha(Sample<k16>(src, 0), Sample<k16>(src, 1), Sample<k16>(src, 2), Sample<k16>(src, alpha),
+                                   straight);
+        }
+    }
+
+    /// Ink to light without a colour profile, as WIC and libtiff's RGBA interface do.
+    template <bool k16>
+    void CmykRow(const uint8_t* src, uint32_t count, uint32_t samples, int32_t alpha, bool straight, uint32_t* out) {
+        const size_t step = k16 ? samples * 2 : samples;
+        for (uint32_t x = 0; x < count; ++x, src += step) {
+            const uint32_t k = 255 - Sample<k16>(src, 3);
+            const uint32_t r = Premultiply(255 - Sample<k16>(src, 0), k);
+            const uint32_t g = Premultiply(255 - Sample<k16>(src, 1), k);
+            const uint32_t b = Premultiply(255 - Sample<k16>(src, 2), k);
+            out[x] = alpha < 0 ? Opaque(r, g, b) : WithAlpha(r, g, b, Sample<k16>(src, alpha), straight);
+        }
+    }
+
+    // --- Decompressors ---
+    // Each fills as much of `out` as the data covers and reports how much that was; the caller
+    // clears the rest, so a truncated strip shows as far as it goes.
+
+    size_t UnpackBits(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size) {
+        size_t i = 0, o = 0;
+        while (i < in_size && o < out_size) {
+            const int32_t n = static_cast<int8_t>(in[i++]);
+            if (n >= 0) {
+                const size_t length = std::min<size_t>({static_cast<size_t>(n) + 1, in_size - i, out_size - o});
+                std::memcpy(out + o, in + i, length);
+                i += static_cast<size_t>(n) + 1;
+                o += length;
+            } else if (n != -128) {
+                if (i >= in_size) break;
+                const size_t length = std::min<size_t>(static_cast<size_t>(1 - n), out_size - o);
+                std::memset(out + o, in[i++], length);
+                o += length;
+            }
+        }
+        return o;
+    }
+
+    constexpr uint32_t kLzwClear = 256;
+    constexpr uint32_t kLzwEnd = 257;
+    constexpr uint32_t kLzwFirstFree = 258;
+    constexpr uint32_t kLzwCodes = 4096;
+
+    /// Every string is a shorter string plus one byte, so the table keeps the prefix code, the
+    /// last byte, the first byte and the length, and strings are written back to front.
+    struct LzwTable {
+        uint16_t prefix[kLzwCodes];
+        uint16_t length[kLzwCodes];
+        uint8_t last[kLzwCodes];
+        uint8_t first[kLzwCodes];
+
+        LzwTable() {
+            for (uint32_t c = 0; c < 256; ++c) {
+                prefix[c] = 0;
+                length[c] = 1;
+                last[c] = first[c] = static_cast<uint8_t>(c);
+            }
+        }
+
+        /// Writes the first `room` bytes of the string of `code`, or all of it if it is shorter.
+        size_t Write(uint32_t code, uint8_t* out, size_t room) const {
+            size_t n = length[code];
+            for (; n > room; --n) code = prefix[code];
+            uint8_t* p = out + n - 1;
+            while (code >= kLzwClear) {
+                *p-- = last[code];
+                code = prefix[code];
+            }
+            *p = static_cast<uint8_t>(code);
+            return n;
+        }
+    };
+
+    /// TIFF LZW: codes of 9 to 12 bits, high bit first, with the width growing one code
+    /// before the table needs it, as every writer since libtiff 5 does.
+    /// @return false on a code that is not in the table, or on the LSB-first codes of pre-5.0 writers.
+    bool UnpackLzw(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size, size_t& written, LzwTable& table) {
+        written = 0;
+        if (in_size >= 2 && in[0] == 0 && (in[1] & 1)) return false;
+
+        uint64_t bits = 0;
+        uint32_t available = 0;
+        uint32_t width = 9;
+        uint32_t next = kLzwFirstFree;
+        uint32_t old = kLzwClear;
+        size_t i = 0, o = 0;
+        while (o < out_size) {
+            while (available < width) {
+                if (i >= in_size) {
+                    written = o;
+                    return true;
+                }
+                bits = (bits << 8) | in[i++];
+                available += 8;
+            }
+            available -= width;
+            const uint32_t code = static_cast<uint32_t>(bits >> available) & ((1u << width) - 1);
+            if (code == kLzwClear) {
+                width = 9;
+                next = kLzwFirstFree;
+                old = kLzwClear;
+                continue;
+            }
+            if (code == kLzwEnd) break;
+            if (old == kLzwClear) {
+                if (code >= kLzwClear) return false;
+                out[o++] = static_cast<uint8_t>(code);
+                old = code;
+                continue;
+            }
+
+            uint8_t first;
+            if (code < next) {
+                first = table.first[code];
+                o += table.Write(code, out + o, out_size - o);
+            } else if (code == next) {
+                // The string being defined: the previous one plus its own first byte.
+                first = table.first[old];
+                const size_t n = table.Write(old, out + o, out_size - o);
+                o += n;
+                if (o < out_size) out[o++] = first;
+            } else {
+                return false;
+            }
+            if (next < kLzwCodes) {
+                table.prefix[next] = static_cast<uint16_t>(old);
+                table.length[next] = static_cast<uint16_t>(table.length[old] + 1);
+                table.last[next] = first;
+                table.first[next] = table.first[old];
+                if (++next + 1 >= (1u << width) && width < 12) ++width;
+            }
+            old = code;
+        }
+        written = o;
+        return true;
+    }
+
+    bool Inflate(z_stream* stream, const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size, size_t& written) {
+        written = 0;
+        if (!stream || inflateReset(stream) != Z_OK) return false;
+        stream->next_in = const_cast<Bytef*>(in);
+        stream->avail_in = static_cast<uInt>(std::min<size_t>(in_size, UINT_MAX));
+        stream->next_out = out;
+        stream->avail_out = static_cast<uInt>(std::min<size_t>(out_size, UINT_MAX));
+        const int result = inflate(stream, Z_FINISH);
+        written = out_size - stream->avail_out;
+        // Z_BUF_ERROR is a stream that is cut short or longer than the chunk; both keep what they have.
+        return result == Z_STREAM_END || result == Z_BUF_ERROR || result == Z_OK;
+    }
+
+    // --- Scalar predictor kernels ---
+
+    void PredictRow8(uint8_t* row, size_t length, size_t stride) {
+        for (size_t i = stride; i < length; ++i) row[i] = static_cast<uint8_t>(row[i] + row[i - stride]);
+    }
+
+    void PredictRow16(uint8_t* row, size_t length, size_t stride) {
+        const size_t step = stride * 2;
+        for (size_t i = step; i + 1 < length; i += 2) {
+            const uint32_t v = (row[i] | (row[i + 1] << 8)) + (row[i - step] | (row[i - step + 1] << 8));
+            row[i] = static_cast<uint8_t>(v);
+            row[i + 1] = static_cast<uint8_t>(v >> 8);
+        }
+    }
+
+#ifdef FLY_TIFF_SSE2
+    // --- SSE2 predictor kernels ---
+    // Undoing horizontal differencing is a running sum along the row, channel by channel. Within
+    // a 16-byte block the sum takes log2 steps, each adding the block to itself shifted by twice
+    // as many pixels as the step before; the block's last pixel, copied across a register, then
+    // carries into the next block. 3- and 6-byte pixels do not divide 16, so their blocks are 15
+    // and 12 bytes and the bytes past the block are stored back as they were.
+
+    template <int kShift, int kLimit, bool k16>
+    inline __m128i RunningSum(__m128i x) {
+        if constexpr (kShift < kLimit) {
+            const __m128i shifted = _mm_slli_si128(x, kShift);
+            x = k16 ? _mm_add_epi16(x, shifted) : _mm_add_epi8(x, shifted);
+            return RunningSum<kShift * 2, kLimit, k16>(x);
+        } else {
+            return x;
+        }
+    }
+
+    /// `kPixel` is the pixel size in bytes: the stride of 8-bit samples, twice that of 16-bit ones.
+    template <int kPixel, bool k16>
+    void PredictRowSse2(uint8_t* row, size_t length, size_t) {
+        constexpr int kBlock = 16 - 16 % kPixel;
+        const __m128i ones = _mm_set1_epi8(-1);
+        const __m128i pixel = _mm_srli_si128(ones, 16 - kPixel);
+        const __m128i block = _mm_srli_si128(ones, 16 - kBlock);
+        __m128i carry = _mm_setzero_si128();
+        size_t i = 0;
+        // Each block is loaded before the one ahead of it is stored: a load that overlaps a store
+        // still in flight cannot be forwarded from it and waits for the store to complete.
+        __m128i next = length >= 16 ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(row)) : _mm_setzero_si128();
+        for (; i + 16 <= length; i += kBlock) {
+            const __m128i in = next;
+            if (i + kBlock + 16 <= length) next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + kBlock));
+            __m128i x = RunningSum<kPixel, kBlock, k16>(in);
+            x = k16 ? _mm_add_epi16(x, carry) : _mm_add_epi8(x, carry);
+            if constexpr (kBlock < 16) x = _mm_or_si128(_mm_and_si128(block, x), _mm_andnot_si128(block, in));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), x);
+            // Copies of one pixel do not overlap, so the byte-wise running sum just repeats it.
+            carry = RunningSum<kPixel, kBlock, false>(_mm_and_si128(_mm_srli_si128(x, kBlock - kPixel), pixel));
+        }
+        if constexpr (k16) {
+            for (i = std::max<size_t>(i, kPixel); i + 1 < length; i += 2) {
+                const uint32_t v = (row[i] | (row[i + 1] << 8)) + (row[i - kPixel] | (row[i - kPixel + 1] << 8));
+                row[i] = static_cast<uint8_t>(v);
+                row[i + 1] = static_cast<uint8_t>(v >> 8);
+            }
+        } else {
+            for (i = std::max<size_t>(i, kPixel); i < length; ++i) row[i] = static_cast<uint8_t>(row[i] + row[i - kPixel]);
+        }
+    }
+#endif
+}
+
+/// Per-worker buffers, reused from one strip or tile to the next.
+struct TiffDecoder::Scratch {
+    std::vector<uint8_t> planes;        // The decompressed chunk, one plane after another.
+    std::vector<uint8_t> row;           // A row of a planar chunk, interleaved.
+    LzwTable lzw;
+    z_stream* zstream = nullptr;
+
+    ~Scratch() {
+        if (zstream) {
+            inflateEnd(zstream);
+            delete zstream;
+        }
+    }
+
+    z_stream* Stream() {
+        if (!zstream) {
+            auto stream = new z_stream{};
+            if (inflateInit(stream) != Z_OK) {
+                delete stream;
+                return nullptr;
+            }
+            zstream = stream;
+        }
+        return zstream;
+    }
+};
+
+uint16_t TiffDecoder::U16(const uint8_t* p) const {
+    return big_endian_ ? static_cast<uint16_t>((p[0] << 8) | p[1]) : static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t TiffDecoder::U32(const uint8_t* p) const {
+    if (big_endian_)
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    return p[0] | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t TiffDecoder::U64(const uint8_t* p) const {
+    const uint64_t a = U32(p), b = U32(p + 4);
+    return big_endian_ ? (a << 32) | b : (b << 32) | a;
+}
+
+// Parsing
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Walks the main chain of directories, and the SubIFDs of each, into images and pages.
+ *        A directory that cannot be read ends the chain; the pages before it are kept.
+ */
+bool TiffDecoder::Open(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    images_.clear();
+    pages_.clear();
+    if (!data || size < 8) return false;
+    if (data[0] == 'I' && data[1] == 'I') big_endian_ = false;
+    else if (data[0] == 'M' && data[1] == 'M') big_endian_ = true;
+    else return false;
+
+    uint64_t first = 0;
+    const uint16_t version = U16(data + 2);
+    if (version == 42) {
+        big_tiff_ = false;
+        first = U32(data + 4);
+    } else if (version == 43) {
+        if (size < 16 || U16(data + 4) != 8 || U16(data + 6) != 0) return false;
+        big_tiff_ = true;
+        first = U64(data + 8);
+    } else {
+        return false;
+    }
+
+    std::unordered_set<uint64_t> seen;
+    auto add = [&](Image& image, bool sub_ifd) {
+        // Transparency masks (bit 2) are not pictures of their own.
+        if (image.subfile_type & 4) return;
+        Validate(image);
+        const bool reduced = (image.subfile_type & 1) != 0;
+        if (reduced && !pages_.empty()) {
+            images_.push_back(image);
+            pages_.back().levels.push_back(static_cast<int32_t>(images_.size() - 1));
+        } else if (!sub_ifd) {
+            images_.push_back(image);
+            pages_.push_back(Page{{static_cast<int32_t>(images_.size() - 1)}});
+        }
+    };
+
+    for (uint64_t offset = first; offset && images_.size() < static_cast<size_t>(kMaxImages);) {
+        if (!seen.insert(offset).second) break;
+        Image image;
+        uint64_t next = 0;
+        if (!ReadIfd(offset, image, next)) break;
+        add(image, false);
+
+        const Array subs = image.sub_ifds;
+        for (uint64_t s = 0; s < std::min(subs.count, kMaxSubIfds); ++s) {
+            for (uint64_t sub = Value(subs, s); sub && images_.size() < static_cast<size_t>(kMaxImages);) {
+                if (!seen.insert(sub).second) break;
+                Image reduced;
+                uint64_t sub_next = 0;
+                if (!ReadIfd(sub, reduced, sub_next)) break;
+                add(reduced, true);
+                sub = sub_next;
+            }
+        }
+        offset = next;
+    }
+
+    for (Page& page : pages_) {
+        std::stable_sort(page.levels.begin() + 1, page.levels.end(), [this](int32_t a, int32_t b) {
+            return static_cast<uint64_t>(images_[a].width) * images_[a].height > static_cast<uint64_t>(images_[b].width) * images_[b].height;
+        });
+    }
+    return !pages_.empty();
+}
+
+/**
+ * @brief Reads one directory. Values that fit in an entry are kept where they are; arrays that
+ *        would run past the end of the file are dropped.
+ */
+bool TiffDecoder::ReadIfd(uint64_t offset, Image& image, uint64_t& next) const {
+    const uint64_t count_size = big_tiff_ ? 8 : 2;
+    const uint64_t entry_size = big_tiff_ ? 20 : 12;
+    const uint64_t field_size = big_tiff_ ? 8 : 4;
+    if (offset > size_ || size_ - offset < count_size) return false;
+    const uint64_t count = big_tiff_ ? U64(data_ + offset) : U16(data_ + offset);
+    const uint64_t start = offset + count_size;
+    if (count == 0 || count > (size_ - start) / entry_size) return false;
+    const uint64_t end = start + count * entry_size;
+    next = size_ - end >= field_size ? (big_tiff_ ? U64(data_ + end) : U32(data_ + end)) : 0;
+
+    for (uint64_t e = 0; e < count; ++e) {
+        const uint8_t* p = data_ + start + e * entry_size;
+        Array array;
+        array.type = U16(p + 2);
+        array.count = big_tiff_ ? U64(p + 4) : U32(p + 4);
+        const uint8_t* field = p + (big_tiff_ ? 12 : 8);
+        const uint64_t unit = TypeSize(array.type);
+        if (!unit || !array.count || array.count > size_ / unit) continue;
+        array.offset = array.count * unit <= field_size ? static_cast<uint64_t>(field - data_) : (big_tiff_ ? U64(field) : U32(field));
+        if (array.offset > size_ || array.count * unit > size_ - array.offset) continue;
+
+        const uint64_t value = Value(array, 0);
+        const uint32_t value32 = static_cast<uint32_t>(std::min<uint64_t>(value, UINT32_MAX));
+        const uint16_t value16 = static_cast<uint16_t>(std::min<uint64_t>(value, UINT16_MAX));
+        switch (U16(p)) {
+            case kNewSubfileType: image.subfile_type = value32; break;
+            case kImageWidth: image.width = value32; break;
+            case kImageLength: image.height = value32; break;
+            case kBitsPerSample: image.bits = value16; break;
+            case kCompression: image.compression = value16; break;
+            case kPhotometric: image.photometric = value16; break;
+            case kFillOrder: image.fill_order = value16; break;
+            case kOrientation: image.orientation = value16; break;
+            case kSamplesPerPixel: image.samples = value16; break;
+            case kRowsPerStrip: image.rows_per_strip = value32; break;
+            case kPlanarConfig: image.planar = value16; break;
+            case kPredictor: image.predictor = value16; break;
+            case kTileWidth: image.tile_width = value32; break;
+            case kTileLength: image.tile_height = value32; break;
+            case kExtraSamples: image.extra = value16; break;
+            case kSampleFormat: image.sample_format = value16; break;
+            case kStripOffsets:
+            case kTileOffsets: image.offsets = array; break;
+            case kStripByteCounts:
+            case kTileByteCounts: image.counts = array; break;
+            case kColorMap: image.colormap = array; break;
+            case kSubIfds: image.sub_ifds = array; break;
+            default: break;
+        }
+    }
+    return true;
+}
+
+uint64_t TiffDecoder::Value(const Array& array, uint64_t index) const {
+    if (index >= array.count) return 0;
+    const uint8_t* p = data_ + array.offset + index * TypeSize(array.type);
+    switch (array.type) {
+        case 1: case 6: case 7: return *p;
+        case 3: case 8: return U16(p);
+        case 4: case 9: case 13: return U32(p);
+        case 16: case 17: case 18: return U64(p);
+        default: return 0;
+    }
+}
+
+/**
+ * @brief Works out the chunk grid and the pixel layout, and whether Decode() handles the image.
+ */
+void TiffDecoder::Validate(Image& image) const {
+    image.can_decode = false;
+    image.layout = Layout::None;
+    image.alpha = -1;
+    if (!image.width || !image.height || static_cast<uint64_t>(image.width) * image.height > static_cast<uint64_t>(kMaxPixels)) return;
+    if (image.orientation < 1 || image.orientation > 8) image.orientation = 1;
+
+    image.tiled = image.tile_width && image.tile_height;
+    if (image.tiled) {
+        image.chunk_width = image.tile_width;
+        image.chunk_height = image.tile_height;
+        if (static_cast<uint64_t>(image.chunk_width) * image.chunk_height > static_cast<uint64_t>(kMaxPixels)) return;
+    } else {
+        image.chunk_width = image.width;
+        image.chunk_height = image.rows_per_strip ? std::min(image.rows_per_strip, image.height) : image.height;
+    }
+    image.across = (image.width - 1) / image.chunk_width + 1;
+    image.down = (image.height - 1) / image.chunk_height + 1;
+
+    const uint16_t samples = image.samples;
+    const uint16_t bits = image.bits;
+    const uint64_t planes = image.planar == 2 ? samples : 1;
+    const uint64_t chunks = static_cast<uint64_t>(image.across) * image.down * planes;
+    if (!samples || image.offsets.count < chunks || image.counts.count < chunks) return;
+    // A chunk is decompressed whole, so it must fit a worker's buffer, and zlib's 32-bit counts.
+    if (static_cast<uint64_t>(image.chunk_width) * image.chunk_height * samples * bits / 8 > kMaxChunkBytes) return;
+
+    switch (image.compression) {
+        case kNone: case kLzw: case kDeflate: case kPackBits: case kDeflateOld: break;
+        default: return;
+    }
+    if (image.fill_order != 1 || image.sample_format != 1) return;
+    if (image.planar != 1 && !(image.planar == 2 && (bits == 8 || bits == 16))) return;
+    if (image.predictor != 1 && !(image.predictor == 2 && (bits == 8 || bits == 16))) return;
+
+    const bool has_alpha = image.extra == 1 || image.extra == 2;
+    const bool wide = bits == 16;
+    switch (image.photometric) {
+        case 0:
+        case 1:
+            if (bits == 8 || bits == 16) {
+                image.layout = wide ? Layout::Gray16 : Layout::Gray8;
+                if (samples >= 2 && has_alpha) image.alpha = 1;
+            } else if ((bits == 1 || bits == 2 || bits == 4) && samples == 1) {
+                image.layout = Layout::Gray;
+            }
+            break;
+        case 2:
+            if (samples >= 3 && (bits == 8 || bits == 16)) {
+                image.layout = wide ? Layout::Rgb16 : Layout::Rgb8;
+                if (samples >= 4 && has_alpha) image.alpha = 3;
+            }
+            break;
+        case 3:
+            if (samples == 1 && (bits == 1 || bits == 2 || bits == 4 || bits == 8) && image.colormap.count >= (3u << bits))
+                image.layout = Layout::Palette;
+            break;
+        case 5:
+            if (samples >= 4 && (bits == 8 || bits == 16)) {
+                image.layout = wide ? Layout::Cmyk16 : Layout::Cmyk8;
+                if (samples >= 5 && has_alpha) image.alpha = 4;
+            }
+            break;
+        default:
+            break;
+    }
+    image.can_decode = image.layout != Layout::None;
+}
+
+TiffPageInfo TiffDecoder::PageInfo(int32_t page) const {
+    TiffPageInfo info{};
+    if (page < 0 || page >= PageCount()) return info;
+    const Image& image = images_[pages_[page].levels[0]];
+    info.width = static_cast<int32_t>(image.width);
+    info.height = static_cast<int32_t>(image.height);
+    info.bits_per_sample = image.bits;
+    info.samples_per_pixel = image.samples;
+    info.photometric = image.photometric;
+    info.compression = image.compression;
+    info.tiled = image.tiled;
+    info.orientation = image.orientation;
+    info.has_alpha = image.alpha >= 0;
+    info.level_count = static_cast<int32_t>(pages_[page].levels.size());
+    info.can_decode = image.can_decode;
+    return info;
+}
+
+TiffLevel TiffDecoder::Level(int32_t page, int32_t level) const {
+    if (page < 0 || page >= PageCount() || level < 0 || level >= static_cast<int32_t>(pages_[page].levels.size()))
+        return TiffLevel{-1, 0, 0, 0};
+    const Image& image = images_[pages_[page].levels[level]];
+    return TiffLevel{level, static_cast<int32_t>(image.width), static_cast<int32_t>(image.height), image.can_decode};
+}
+
+TiffLevel TiffDecoder::SelectLevel(int32_t page, int32_t max_dimension) const {
+    TiffLevel best{-1, 0, 0, 0};
+    if (page < 0 || page >= PageCount()) return best;
+    if (max_dimension <= 0) {
+        const TiffLevel top = Level(page, 0);
+        return top.can_decode ? top : best;
+    }
+    const int32_t count = static_cast<int32_t>(pages_[page].levels.size());
+    for (int32_t l = 0; l < count; ++l) {
+        const TiffLevel level = Level(page, l);
+        if (!level.can_decode) continue;
+        if (best.level < 0 || std::max(level.width, level.height) >= max_dimension) best = level;
+        else break;
+    }
+    return best;
+}
+
+// Decoding
+// ----------------------------------------------------------------------------
+
+/**
+ * @brief Shares the strips or tiles out to workers pulling from a shared cursor, as
+ *        DdsDecoder::Decode() does with rows. Each chunk is compressed on its own.
+ */
+bool TiffDecoder::Decode(int32_t page, int32_t level, uint8_t* bgra, size_t stride, unsigned threads) const {
+    if (!bgra || page < 0 || page >= PageCount() || level < 0 || level >= static_cast<int32_t>(pages_[page].levels.size())) return false;
+    const Image& image = images_[pages_[page].levels[level]];
+    if (!image.can_decode || stride < static_cast<size_t>(image.width) * 4) return false;
+
+    // Colour maps are 16 bits a channel; some old writers put 8-bit values in them.
+    uint32_t palette[256] = {};
+    if (image.layout == Layout::Palette) {
+        const uint32_t entries = 1u << image.bits;
+        uint64_t largest = 0;
+        for (uint32_t i = 0; i < entries * 3; ++i) largest = std::max(largest, Value(image.colormap, i));
+        const uint32_t shift = largest < 256 ? 0 : 8;
+        for (uint32_t i = 0; i < entries; ++i) {
+            palette[i] = Opaque(static_cast<uint32_t>(Value(image.colormap, i) >> shift) & 0xFF,
+                                static_cast<uint32_t>(Value(image.colormap, entries + i) >> shift) & 0xFF,
+                                static_cast<uint32_t>(Value(image.colormap, entries * 2 + i) >> shift) & 0xFF);
+        }
+    }
+
+    const uint32_t tasks = image.across * image.down;
+    const uint64_t pixels = static_cast<uint64_t>(image.width) * image.height;
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<uint64_t>({threads, tasks, std::max<uint64_t>(1, pixels / kPixelsPerWorker)}));
+
+    std::atomic<uint32_t> next{0};
+    std::atomic<bool> failed{false};
+    auto work = [&]() {
+        Scratch scratch;
+        for (uint32_t task = next.fetch_add(1); task < tasks; task = next.fetch_add(1)) {
+            if (failed.load(std::memory_order_relaxed)) return;
+            if (!DecodeChunk(image, task, scratch, palette, bgra, stride)) failed = true;
+        }
+    };
+
+    if (threads <= 1) {
+        work();
+        return !failed;
+    }
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+    return !failed;
+}
+
+/**
+ * @brief Decodes strip or tile `chunk`, every plane of it, and writes the part inside the image.
+ */
+bool TiffDecoder::DecodeChunk(const Image& image, uint32_t chunk, Scratch& scratch, const uint32_t* palette, uint8_t* bgra,
+                              size_t stride) const {
+    const uint32_t x0 = (chunk % image.across) * image.chunk_width;
+    const uint32_t y0 = (chunk / image.across) * image.chunk_height;
+    // The last strip stops at the bottom of the image; tiles are always whole.
+    const uint32_t rows = image.tiled ? image.chunk_height : std::min(image.chunk_height, image.height - y0);
+    const uint32_t planes = image.planar == 2 ? image.samples : 1;
+    const uint32_t plane_samples = image.planar == 2 ? 1 : image.samples;
+    const size_t row_bytes = (static_cast<size_t>(image.chunk_width) * plane_samples * image.bits + 7) / 8;
+    const size_t plane_bytes = row_bytes * rows;
+    if (scratch.planes.size() < plane_bytes * planes) scratch.planes.resize(plane_bytes * planes);
+
+    const uint64_t plane_chunks = static_cast<uint64_t>(image.across) * image.down;
+    for (uint32_t p = 0; p < planes; ++p) {
+        uint8_t* plane = scratch.planes.data() + plane_bytes * p;
+        if (!Decompress(image, plane_chunks * p + chunk, plane, plane_bytes, scratch)) return false;
+        if (image.bits == 16 && big_endian_) {
+            for (size_t i = 0; i + 1 < plane_bytes; i += 2) std::swap(plane[i], plane[i + 1]);
+        }
+        if (image.predictor == 2) {
+            PredictRowFn predict = image.bits == 16 ? &PredictRow16 : &PredictRow8;
+            if (plane_samples <= 4) predict = image.bits == 16 ? predict16_[plane_samples] : predict8_[plane_samples];
+            for (uint32_t r = 0; r < rows; ++r) predict(plane + row_bytes * r, row_bytes, plane_samples);
+        }
+    }
+
+    const uint32_t count = std::min(image.chunk_width, image.width - x0);
+    const uint32_t out_rows = std::min(rows, image.height - y0);
+    const size_t sample_bytes = image.bits / 8;
+    if (planes > 1 && scratch.row.size() < static_cast<size_t>(count) * planes * sample_bytes)
+        scratch.row.resize(static_cast<size_t>(count) * planes * sample_bytes);
+    for (uint32_t r = 0; r < out_rows; ++r) {
+        const uint8_t* src = scratch.planes.data() + row_bytes * r;
+        if (planes > 1) {
+            uint8_t* row = scratch.row.data();
+            for (uint32_t p = 0; p < planes; ++p) {
+                const uint8_t* in = src + plane_bytes * p;
+                uint8_t* out = row + sample_bytes * p;
+                if (sample_bytes == 1) {
+                    for (uint32_t x = 0; x < count; ++x) out[static_cast<size_t>(x) * planes] = in[x];
+                } else {
+                    for (uint32_t x = 0; x < count; ++x) std::memcpy(out + static_cast<size_t>(x) * planes * 2, in + x * 2, 2);
+                }
+            }
+            src = row;
+        }
+        uint32_t* out = reinterpret_cast<uint32_t*>(bgra + stride * (y0 + r)) + x0;
+        ConvertRow(image, src, count, palette, out);
+    }
+    return true;
+}
+
+/**
+ * @brief Decompresses chunk `index` into `out`. A chunk that runs past the end of the file is
+ *        decoded as far as it goes, and whatever it does not cover is cleared.
+ */
+bool TiffDecoder::Decompress(const Image& image, uint64_t index, uint8_t* out, size_t size, Scratch& scratch) const {
+    const uint64_t offset = Value(image.offsets, index);
+    const uint64_t length = Value(image.counts, index);
+    const uint8_t* in = nullptr;
+    size_t in_size = 0;
+    if (offset < size_) {
+        in = data_ + offset;
+        in_size = static_cast<size_t>(std::min<uint64_t>(length, size_ - offset));
+    }
+
+    size_t written = 0;
+    switch (image.compression) {
+        case kNone:
+            written = std::min(in_size, size);
+            if (written) std::memcpy(out, in, written);
+            break;
+        case kPackBits:
+            written = UnpackBits(in, in_size, out, size);
+            break;
+        case kLzw:
+            if (!UnpackLzw(in, in_size, out, size, written, scratch.lzw)) return false;
+            break;
+        case kDeflate:
+        case kDeflateOld:
+            if (!Inflate(scratch.Stream(), in, in_size, out, size, written)) return false;
+            break;
+        default:
+            return false;
+    }
+    if (written < size) std::memset(out + written, 0, size - written);
+    return true;
+}
+
+void TiffDecoder::ConvertRow(const Image& image, const uint8_t* src, uint32_t count, const uint32_t* palette, uint32_t* out) const {
+    const uint32_t samples = image.samples;
+    const bool straight = image.extra == 2;
+    // Min-is-white greys count down from white.
+    const uint32_t invert = image.photometric == 0 ? 0xFF : 0;
+    switch (image.layout) {
+        case Layout::Gray:
+        case Layout::Palette: {
+            // Packed from the high bit; 1-, 2- and 4-bit levels scale to 8 bits exactly.
+            const uint32_t bits = image.bits;
+            const uint32_t mask = (1u << bits) - 1;
+            const uint32_t scale = 255 / mask;
+            for (uint32_t x = 0; x < count; ++x) {
+                const uint32_t bit = x * bits;
+                const uint32_t v = (src[bit >> 3] >> (8 - bits - (bit & 7))) & mask;
+                if (image.layout == Layout::Palette) {
+                    out[x] = palette[v];
+                } else {
+                    const uint32_t g = (v * scale) ^ invert;
+                    out[x] = Opaque(g, g, g);
+                }
+            }
+            break;
+        }
+        case Layout::Gray8: GrayRow<false>(src, count, samples, image.alpha, straight, invert, out); break;
+        case Layout::Gray16: GrayRow<true>(src, count, samples, image.alpha, straight, invert, out); break;
+        case Layout::Rgb8: RgbRow<false>(src, count, samples, image.alpha, straight, out); break;
+        case Layout::Rgb16: RgbRow<true>(src, count, samples, image.alpha, straight, out); break;
+        case Layout::Cmyk8: CmykRow<false>(src, count, samples, image.alpha, straight, out); break;
+        case Layout::Cmyk16: CmykRow<true>(src, count, samples, image.alpha, straight, out); break;
+        default: std::memset(out, 0, static_cast<size_t>(count) * 4); break;
+    }
+}
+
+void TiffDecoder::SetSimd(bool enabled) {
+    for (size_t s = 0; s < 5; ++s) {
+        predict8_[s] = &PredictRow8;
+        predict16_[s] = &PredictRow16;
+    }
+#ifdef FLY_TIFF_SSE2
+    if (enabled && CpuFeatures::Level() >= SimdLevel::Sse2) {
+        predict8_[1] = &PredictRowSse2<1, false>;
+        predict8_[2] = &PredictRowSse2<2, false>;
+        predict8_[3] = &PredictRowSse2<3, false>;
+        predict8_[4] = &PredictRowSse2<4, false>;
+        predict16_[1] = &PredictRowSse2<2, true>;
+        predict16_[2] = &PredictRowSse2<4, true>;
+        predict16_[3] = &PredictRowSse2<6, true>;
+        predict16_[4] = &PredictRowSse2<8, true>;
+    }
+#else
+    (void)enabled;
+#endif
+}
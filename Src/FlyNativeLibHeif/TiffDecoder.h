@@ -0,0 +1,178 @@
+/**
+ * @file TiffDecoder.h
+ * @brief Declares TiffDecoder, a multi-page TIFF and BigTIFF parser and page decoder.
+ *
+ * A TIFF is a chain of image file directories (IFDs), one per page, each pointing at its pixel
+ * data in strips or tiles anywhere in the file. Open() walks the whole chain once and keeps only
+ * the tags it needs, and the strip and tile offset tables are left in the file and read when a
+ * page is decoded, so indexing a 300-page scan costs a few hundred small reads and turning to
+ * any page costs that page alone.
+ *
+ * Reduced-resolution images, in the main chain after their page or in its SubIFDs (NewSubfileType
+ * bit 0), become the page's extra levels. SelectLevel() picks the smallest one that still covers
+ * a display size, as DdsDecoder::SelectMip() does with mips.
+ *
+ * Decode() turns one level into premultiplied BGRA. Strips and tiles are independent, so they
+ * are shared out to worker threads, each of which decompresses, undoes the predictor and converts
+ * its own. Supported:
+ *
+ * - No compression, PackBits, LZW and Deflate (Adobe and old-style codes).
+ * - The horizontal differencing predictor on 8- and 16-bit samples, with SSE2 kernels that undo
+ *   a whole 16-byte block per step instead of one sample at a time.
+ * - Greyscale (either polarity, 1-16 bits), palette (1-8 bits), RGB and CMYK (8 and 16 bits),
+ *   with associated or unassociated alpha, chunky or planar.
+ *
+ * CCITT, JPEG and other compressions, floating-point samples and YCbCr are not decoded; the
+ * page's can_decode is 0 and the caller falls back to another decoder. Orientation is reported
+ * and not applied. The file data is not copied and must outlive the decoder. Decode() may be
+ * called from several threads at once; Open() and SetSimd() may not.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef TIFF_DECODER_H
+#define TIFF_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief One page, as stored at full resolution. Blittable for P/Invoke.
+struct TiffPageInfo {
+    int32_t width;
+    int32_t height;
+    int32_t bits_per_sample;
+    int32_t samples_per_pixel;
+    int32_t photometric;                ///< TIFF PhotometricInterpretation.
+    int32_t compression;                ///< TIFF Compression.
+    int32_t tiled;
+    int32_t orientation;                ///< 1-8, as in EXIF; 1 if the tag is absent.
+    int32_t has_alpha;
+    int32_t level_count;                ///< The page plus its reduced-resolution images.
+    int32_t can_decode;                 ///< 1 if Decode() handles level 0.
+    int32_t reserved;
+};
+
+/// @brief A level of a page and its size. Blittable for P/Invoke.
+struct TiffLevel {
+    int32_t level;                      ///< 0 for the page itself; higher levels are smaller.
+    int32_t width;
+    int32_t height;
+    int32_t can_decode;
+};
+
+/// @brief Parses a TIFF in memory and decodes its pages.
+class TiffDecoder {
+public:
+    /// Images larger than this many pixels are not decoded.
+    static constexpr int64_t kMaxPixels = 1ll << 28;
+
+    /// Directories past this many are ignored, which also ends a chain that loops.
+    static constexpr int32_t kMaxImages = 1 << 16;
+
+    /// @brief Undoes horizontal differencing on one row of `length` bytes whose samples repeat
+    ///        every `stride` bytes (8-bit) or every `stride` samples (16-bit, little-endian).
+    using PredictRowFn = void (*)(uint8_t* row, size_t length, size_t stride);
+
+    TiffDecoder() { SetSimd(true); }
+
+    /// @brief Reads the header and every directory in the file.
+    /// @return false if the data is not a TIFF or has no page.
+    bool Open(const uint8_t* data, size_t size);
+
+    bool IsBigTiff() const { return big_tiff_; }
+    int32_t PageCount() const { return static_cast<int32_t>(pages_.size()); }
+    TiffPageInfo PageInfo(int32_t page) const;
+
+    /// @brief Level `level` of `page`; level 0 is the page at full resolution.
+    TiffLevel Level(int32_t page, int32_t level) const;
+
+    /// @brief The smallest decodable level of `page` whose longer side is at least
+    ///        `max_dimension`, or the largest decodable one if none is.
+    /// @details 0 or less asks for level 0. The level is -1 if none can be decoded.
+    TiffLevel SelectLevel(int32_t page, int32_t max_dimension) const;
+
+    /// @brief Decodes `level` of `page` into `bgra`, height rows of `stride` bytes.
+    /// @param threads Workers to share the strips or tiles between; 0 for one per core. Small
+    ///        images, and images stored as a single strip, use one.
+    /// @return false if the level is not decodable, an argument is out of range, or its data is corrupt.
+    bool Decode(int32_t page, int32_t level, uint8_t* bgra, size_t stride, unsigned threads = 0) const;
+
+    /// @brief Selects the predictor kernels: SSE2 where the CPU has it, or scalar.
+    void SetSimd(bool enabled);
+
+private:
+    /// The values of a tag, left in the file.
+    struct Array {
+        uint64_t offset = 0;
+        uint64_t count = 0;
+        uint16_t type = 0;
+    };
+
+    enum class Layout : int32_t { None, Gray, Gray8, Gray16, Palette, Rgb8, Rgb16, Cmyk8, Cmyk16 };
+
+    struct Image {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t subfile_type = 0;
+        uint16_t bits = 1;
+        uint16_t samples = 1;
+        uint16_t photometric = 0xFFFF;
+        uint16_t compression = 1;
+        uint16_t predictor = 1;
+        uint16_t planar = 1;
+        uint16_t orientation = 1;
+        uint16_t fill_order = 1;
+        uint16_t sample_format = 1;
+        uint16_t extra = 0;             // ExtraSamples[0]: 1 associated alpha, 2 unassociated.
+        uint32_t rows_per_strip = 0xFFFFFFFFu;
+        uint32_t tile_width = 0;
+        uint32_t tile_height = 0;
+        bool tiled = false;
+        Array offsets;
+        Array counts;
+        Array colormap;
+        Array sub_ifds;
+
+        // Worked out by Validate().
+        Layout layout = Layout::None;
+        int32_t alpha = -1;             // Sample index of the alpha, or -1.
+        bool can_decode = false;
+        uint32_t chunk_width = 0;       // A tile, or the width of a strip.
+        uint32_t chunk_height = 0;
+        uint32_t across = 0;            // Chunks per row of chunks.
+        uint32_t down = 0;
+    };
+
+    struct Page {
+        std::vector<int32_t> levels;    // Indices into images_, largest first.
+    };
+
+    struct Scratch;
+
+    uint16_t U16(const uint8_t* p) const;
+    uint32_t U32(const uint8_t* p) const;
+    uint64_t U64(const uint8_t* p) const;
+
+    bool ReadIfd(uint64_t offset, Image& image, uint64_t& next) const;
+    uint64_t Value(const Array& array, uint64_t index) const;
+    void Validate(Image& image) const;
+
+    bool DecodeChunk(const Image& image, uint32_t chunk, Scratch& scratch, const uint32_t* palette, uint8_t* bgra,
+                     size_t stride) const;
+    bool Decompress(const Image& image, uint64_t index, uint8_t* out, size_t size, Scratch& scratch) const;
+    void ConvertRow(const Image& image, const uint8_t* src, uint32_t count, const uint32_t* palette, uint32_t* out) const;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    bool big_endian_ = false;
+    bool big_tiff_ = false;
+    std::vector<Image> images_;
+    std::vector<Page> pages_;
+
+    PredictRowFn predict8_[5] = {};     // By stride in bytes, 1-4.
+    PredictRowFn predict16_[5] = {};    // By samples per pixel, 1-4.
+};
+
+#endif // TIFF_DECODER_H
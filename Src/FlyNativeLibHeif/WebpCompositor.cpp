@@ -0,0 +1,214 @@
+/**
+ * @file WebpCompositor.cpp
+ * @brief Implements WebpCompositor.
+ */
+
+#include "WebpCompositor.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLY_WEBP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    /// round(c * a / 255) without a division.
+    inline uint32_t Scale(uint32_t c, uint32_t a) {
+        const uint32_t v = c * a + 128;
+        return (v + (v >> 8)) >> 8;
+    }
+
+    inline uint32_t Premultiply(uint32_t px) {
+        const uint32_t a = px >> 24;
+        if (a == 255) return px;
+        if (a == 0) return 0;
+        return (a << 24) | (Scale((px >> 16) & 0xFF, a) << 16) | (Scale((px >> 8) & 0xFF, a) << 8) | Scale(px & 0xFF, a);
+    }
+
+    void CopyRowScalar(const uint32_t* src, int32_t count, uint32_t* dst) {
+        for (int32_t i = 0; i < count; ++i) dst[i] = Premultiply(src[i]);
+    }
+
+    /// Premultiplied source-over: each channel is src + dst * (255 - src alpha) / 255.
+    void OverRowScalar(const uint32_t* src, int32_t count, uint32_t* dst) {
+        for (int32_t i = 0; i < count; ++i) {
+            const uint32_t s = Premultiply(src[i]);
+            const uint32_t alpha = s >> 24;
+            if (alpha == 255) {
+                dst[i] = s;
+            } else if (alpha != 0) {
+                const uint32_t keep = 255 - alpha;
+                const uint32_t d = dst[i];
+                dst[i] = s + ((Scale(d >> 24, keep) << 24) | (Scale((d >> 16) & 0xFF, keep) << 16) |
+                              (Scale((d >> 8) & 0xFF, keep) << 8) | Scale(d & 0xFF, keep));
+            }
+        }
+    }
+
+#ifdef FLY_WEBP_SSE2
+    // Two pixels per register as 16-bit lanes; the same rounding as Scale(), so the kernels
+    // match the scalar ones bit for bit.
+
+    inline __m128i Scale16(__m128i c, __m128i a) {
+        const __m128i v = _mm_add_epi16(_mm_mullo_epi16(c, a), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+    }
+
+    inline __m128i BroadcastAlpha16(__m128i px16) {
+        return _mm_shufflehi_epi16(_mm_shufflelo_epi16(px16, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    /// Colour lanes scaled by alpha, the alpha lane by 255 (which leaves it unchanged).
+    inline __m128i Premultiply16(__m128i px16) {
+        const __m128i colour_lanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+        const __m128i alpha_lane = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+        const __m128i factor = _mm_or_si128(_mm_and_si128(BroadcastAlpha16(px16), colour_lanes), alpha_lane);
+        return Scale16(px16, factor);
+    }
+
+    inline __m128i Over16(__m128i s16, __m128i d16) {
+        const __m128i keep = _mm_sub_epi16(_mm_set1_epi16(255), BroadcastAlpha16(s16));
+        return _mm_add_epi16(s16, Scale16(d16, keep));
+    }
+
+    /// Bit i*4 of the result is set when pixel i's alpha equals `value`'s.
+    inline int AlphaMask(__m128i px, __m128i value) {
+        const __m128i alpha = _mm_and_si128(px, _mm_set1_epi32(static_cast<int>(0xFF000000u)));
+        return _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, value));
+    }
+
+    void CopyRowSse2(const uint32_t* src, int32_t count, uint32_t* dst) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i out = px;
+            if (AlphaMask(px, opaque) != 0xFFFF) {
+                out = _mm_packus_epi16(Premultiply16(_mm_unpacklo_epi8(px, zero)), Premultiply16(_mm_unpackhi_epi8(px, zero)));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+        }
+        CopyRowScalar(src + i, count - i, dst + i);
+    }
+
+    void OverRowSse2(const uint32_t* src, int32_t count, uint32_t* dst) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        int32_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            if (AlphaMask(px, opaque) == 0xFFFF) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), px);
+                continue;
+            }
+            if (AlphaMask(px, zero) == 0xFFFF) continue;
+            const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            const __m128i lo = Over16(Premultiply16(_mm_unpacklo_epi8(px, zero)), _mm_unpacklo_epi8(d, zero));
+            const __m128i hi = Over16(Premultiply16(_mm_unpackhi_epi8(px, zero)), _mm_unpackhi_epi8(d, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+        }
+        OverRowScalar(src + i, count - i, dst + i);
+    }
+#endif
+}
+
+bool WebpCompositor::Open(const uint8_t* data, size_t size) {
+    if (!decoder_.Open(data, size)) return false;
+    canvas_.assign(static_cast<size_t>(Width()) * Height(), 0);
+    if (!copy_) SetSimd(true);
+    current_ = -1;
+    previous_rect_ = FrameRect{};
+    previous_dispose_ = 0;
+    frames_drawn_ = 0;
+    return true;
+}
+
+void WebpCompositor::SetSimd(bool enabled) {
+    copy_ = &CopyRowScalar;
+    over_ = &OverRowScalar;
+#ifdef FLY_WEBP_SSE2
+    if (enabled && CpuFeatures::Level() >= SimdLevel::Sse2) {
+        copy_ = &CopyRowSse2;
+        over_ = &OverRowSse2;
+    }
+#else
+    (void)enabled;
+#endif
+}
+
+void WebpCompositor::Reset() {
+    std::fill(canvas_.begin(), canvas_.end(), 0u);
+    current_ = -1;
+    previous_rect_ = FrameRect{};
+    previous_dispose_ = 0;
+}
+
+/**
+ * @brief Replays from the nearest key frame when that is shorter than carrying on from the
+ *        current frame; a key frame draws the same canvas whatever was there before it.
+ */
+bool WebpCompositor::RenderTo(int32_t index, FrameRect& dirty) {
+    dirty = FrameRect{};
+    if (index < 0 || index >= decoder_.FrameCount()) return false;
+
+    int32_t key = index;
+    while (key > 0 && !decoder_.Frame(key).key_frame) --key;
+    if (index < current_ || key > current_ + 1) {
+        Reset();
+        current_ = key - 1;
+        dirty = FrameRect{0, 0, Width(), Height()};
+    }
+    while (current_ < index) DrawNext(dirty);
+    return true;
+}
+
+/**
+ * @brief The previous frame's disposal is applied first. A frame libwebp cannot decode is
+ *        drawn as transparent, so the frames after it still play.
+ */
+void WebpCompositor::DrawNext(FrameRect& dirty) {
+    const int32_t index = current_ + 1;
+    const WebpFrameInfo& frame = decoder_.Frame(index);
+
+    if (previous_dispose_) {
+        Fill(previous_rect_, 0);
+        dirty.Unite(previous_rect_);
+    }
+
+    frame_.resize(static_cast<size_t>(frame.width) * frame.height);
+    if (!decoder_.DecodeFrame(index, reinterpret_cast<uint8_t*>(frame_.data()))) {
+        std::fill(frame_.begin(), frame_.end(), 0u);
+    }
+    const BlendRowFn blend = frame.blend ? over_ : copy_;
+    for (int32_t y = 0; y < frame.height; ++y) {
+        blend(frame_.data() + static_cast<size_t>(y) * frame.width, frame.width,
+              canvas_.data() + static_cast<size_t>(frame.y + y) * Width() + frame.x);
+    }
+
+    const FrameRect rect{frame.x, frame.y, frame.width, frame.height};
+    dirty.Unite(rect);
+    previous_rect_ = rect;
+    previous_dispose_ = frame.dispose;
+    current_ = index;
+    ++frames_drawn_;
+}
+
+void WebpCompositor::Fill(const FrameRect& rect, uint32_t value) {
+    for (int32_t y = 0; y < rect.height; ++y) {
+        uint32_t* row = canvas_.data() + static_cast<size_t>(rect.y + y) * Width() + rect.x;
+        std::fill(row, row + rect.width, value);
+    }
+}
+
+void WebpCompositor::CopyRect(const FrameRect& rect, uint8_t* out) const {
+    const size_t row_bytes = static_cast<size_t>(rect.width) * 4;
+    for (int32_t y = 0; y < rect.height; ++y) {
+        std::memcpy(out + y * row_bytes, Pixels() + static_cast<size_t>(rect.y + y) * Stride() + static_cast<size_t>(rect.x) * 4,
+                    row_bytes);
+    }
+}
@@ -0,0 +1,90 @@
+/**
+ * @file WebpCompositor.h
+ * @brief Declares WebpCompositor, which plays an animated WebP's frames onto one BGRA canvas.
+ *
+ * WebP frames are patches that either replace the pixels under them or alpha-blend over them,
+ * and may clear their rectangle before the next frame. WebpCompositor keeps the canvas in
+ * memory and applies both on the CPU, independent of the installed WIC codec:
+ *
+ * - RenderTo() draws every frame from the current one up to the requested one and reports
+ *   the union of the rectangles it touched.
+ * - A seek backwards, or forwards past a key frame, clears the canvas and replays from the
+ *   nearest key frame at or before the target instead of from the first frame.
+ * - libwebp decodes to straight alpha; premultiplying and blending happen in one pass per row,
+ *   four pixels per SSE2 step, with runs of opaque or transparent pixels copied or skipped.
+ *
+ * Not thread-safe. This file does not include pch.h and must build without Windows headers
+ * on other platforms.
+ */
+
+#pragma once
+#ifndef WEBP_COMPOSITOR_H
+#define WEBP_COMPOSITOR_H
+
+#include "FrameRect.h"
+#include "WebpDecoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief A WebP decoder and the canvas its frames are composited onto.
+class WebpCompositor {
+public:
+    /// @brief Premultiplies `count` straight-alpha BGRA pixels from `src` onto `dst`, replacing or blending.
+    using BlendRowFn = void (*)(const uint32_t* src, int32_t count, uint32_t* dst);
+
+    /// @brief Parses the WebP and allocates a transparent canvas. `data` must outlive the compositor.
+    bool Open(const uint8_t* data, size_t size);
+
+    const WebpDecoder& Decoder() const { return decoder_; }
+    int32_t Width() const { return decoder_.Info().width; }
+    int32_t Height() const { return decoder_.Info().height; }
+    size_t Stride() const { return static_cast<size_t>(Width()) * 4; }
+
+    /// @brief Premultiplied BGRA pixels of the canvas, `Stride()` bytes per row.
+    const uint8_t* Pixels() const { return reinterpret_cast<const uint8_t*>(canvas_.data()); }
+
+    /// @brief The last frame drawn, or -1 if the canvas is clear.
+    int32_t Current() const { return current_; }
+
+    /// @brief Brings the canvas to the state after frame `index` was drawn.
+    /// @param dirty Receives the union of the rectangles that changed; empty if none did.
+    /// @return false if `index` is out of range.
+    bool RenderTo(int32_t index, FrameRect& dirty);
+
+    /// @brief Clears the canvas, as before the first frame.
+    void Reset();
+
+    /// @brief Copies rectangle `rect` of the canvas into `out`, packed (`rect.width * 4` bytes per row).
+    void CopyRect(const FrameRect& rect, uint8_t* out) const;
+
+    /// @brief Selects the blend kernels: SSE2 where the CPU has it, or scalar.
+    void SetSimd(bool enabled);
+
+    /// @brief True if frame `index` is a key frame; see WebpDecoder.
+    bool IsKeyFrame(int32_t index) const { return decoder_.Frame(index).key_frame != 0; }
+
+    /// @brief Frames drawn since Open(), replays included. Lets callers see what seeks cost.
+    int64_t FramesDrawn() const { return frames_drawn_; }
+
+    /// @brief Bytes held between frames besides the canvas: the frame buffer and the frame table.
+    size_t ScratchBytes() const { return frame_.capacity() * 4 + decoder_.ScratchBytes(); }
+
+private:
+    void DrawNext(FrameRect& dirty);
+    void Fill(const FrameRect& rect, uint32_t value);
+
+    WebpDecoder decoder_;
+    std::vector<uint32_t> canvas_;
+    std::vector<uint32_t> frame_;       // The frame being drawn, straight alpha.
+    BlendRowFn copy_ = nullptr;
+    BlendRowFn over_ = nullptr;
+
+    int32_t current_ = -1;
+    FrameRect previous_rect_{};
+    int32_t previous_dispose_ = 0;
+    int64_t frames_drawn_ = 0;
+};
+
+#endif // WEBP_COMPOSITOR_H
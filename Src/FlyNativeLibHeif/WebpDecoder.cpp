@@ -0,0 +1,170 @@
+/**
+ * @file WebpDecoder.cpp
+ * @brief Implements WebpDecoder.
+ */
+
+#include "WebpDecoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <webp/decode.h>
+
+#ifdef _MSC_VER
+#ifdef _DEBUG
+#pragma comment(lib, "libwebpd.lib")
+#else
+#pragma comment(lib, "libwebp.lib")
+#endif
+#endif
+
+namespace {
+
+    uint32_t Read24(const uint8_t* p) {
+        return p[0] | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16);
+    }
+
+    uint32_t Read32(const uint8_t* p) { return Read24(p) | (static_cast<uint32_t>(p[3]) << 24); }
+
+    bool IsType(const uint8_t* p, const char* type) { return std::memcmp(p, type, 4) == 0; }
+
+    /// Offset of the chunk after the one at `pos`, or 0 if that chunk runs past `end`.
+    size_t NextChunk(const uint8_t* data, size_t pos, size_t end) {
+        if (end - pos < 8) return 0;
+        const size_t length = Read32(data + pos + 4);
+        if (length > end - pos - 8) return 0;
+        return pos + 8 + length + (length & 1);
+    }
+
+    /// The alpha_is_used bit of a VP8L header; `chunk` points at the chunk's FourCC.
+    bool Vp8lHasAlpha(const uint8_t* chunk, size_t available) {
+        return available >= 13 && chunk[8] == 0x2F && ((Read32(chunk + 9) >> 28) & 1) != 0;
+    }
+
+    bool FullCanvas(const WebpFrameInfo& frame, const WebpInfo& info) {
+        return frame.width == info.width && frame.height == info.height;
+    }
+}
+
+/**
+ * @brief An animated file's frames come from its ANMF chunks; a still file is decoded whole
+ *        as one frame, so libwebp sees the VP8X and ALPH chunks as it expects.
+ */
+bool WebpDecoder::Open(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    info_ = WebpInfo{};
+    frames_.clear();
+    if (!data || size < 20 || !IsType(data, "RIFF") || !IsType(data + 8, "WEBP")) return false;
+
+    const size_t end = std::min<size_t>(size, static_cast<size_t>(Read32(data + 4)) + 8);
+    if (end < 20) return false;
+    const uint8_t* first = data + 12;
+    if (IsType(first, "VP8 ") || IsType(first, "VP8L")) {
+        int width = 0, height = 0;
+        if (!WebPGetInfo(data, end, &width, &height) || static_cast<int64_t>(width) * height > kMaxPixels) return false;
+        info_.width = width;
+        info_.height = height;
+        const WebpFrameInfo frame{0, 0, width, height, 100, 0, 0, 0};
+        if (!AddFrame(frame, 0, end)) return false;
+        frames_.back().has_alpha = IsType(first, "VP8L") && Vp8lHasAlpha(first, end - 12);
+        MarkKeyFrames();
+        return true;
+    }
+
+    if (!IsType(first, "VP8X") || end - 12 < 18) return false;
+    const uint8_t flags = first[8];
+    info_.width = static_cast<int32_t>(Read24(first + 12)) + 1;
+    info_.height = static_cast<int32_t>(Read24(first + 15)) + 1;
+    if (static_cast<int64_t>(info_.width) * info_.height > kMaxPixels) return false;
+
+    if (!(flags & 0x02)) {
+        const WebpFrameInfo frame{0, 0, info_.width, info_.height, 100, 0, 0, 0};
+        if (!AddFrame(frame, 0, end)) return false;
+        frames_.back().has_alpha = (flags & 0x10) != 0;
+        MarkKeyFrames();
+        return true;
+    }
+
+    for (size_t pos = 12, next; pos < end && (next = NextChunk(data, pos, end)) != 0; pos = next) {
+        const uint8_t* chunk = data + pos;
+        const uint8_t* payload = chunk + 8;
+        const size_t length = Read32(chunk + 4);
+        if (IsType(chunk, "ANIM") && length >= 6) {
+            info_.loop_count = payload[4] | (payload[5] << 8);
+        } else if (IsType(chunk, "ANMF") && length >= 16) {
+            WebpFrameInfo frame{};
+            frame.x = static_cast<int32_t>(Read24(payload)) * 2;
+            frame.y = static_cast<int32_t>(Read24(payload + 3)) * 2;
+            frame.width = static_cast<int32_t>(Read24(payload + 6)) + 1;
+            frame.height = static_cast<int32_t>(Read24(payload + 9)) + 1;
+            const int32_t duration = static_cast<int32_t>(Read24(payload + 12));
+            frame.delay_ms = duration < 10 ? 100 : duration;
+            frame.dispose = payload[15] & 0x01;
+            frame.blend = (payload[15] & 0x02) ? 0 : 1;
+
+            // Frame data: an optional ALPH chunk and a VP8 or VP8L chunk, possibly among unknown ones.
+            const size_t frame_end = pos + 8 + length;
+            size_t start = 0;
+            bool has_alpha = false;
+            for (size_t sub = pos + 24, sub_next; sub < frame_end && (sub_next = NextChunk(data, sub, frame_end)) != 0;
+                 sub = sub_next) {
+                const uint8_t* subchunk = data + sub;
+                if (IsType(subchunk, "ALPH")) {
+                    if (!start) start = sub;
+                    has_alpha = true;
+                } else if (IsType(subchunk, "VP8 ") || IsType(subchunk, "VP8L")) {
+                    if (!start) start = sub;
+                    if (IsType(subchunk, "VP8L")) has_alpha = Vp8lHasAlpha(subchunk, frame_end - sub);
+                    const size_t image_end = sub + 8 + Read32(subchunk + 4);
+                    if (AddFrame(frame, start, image_end - start)) frames_.back().has_alpha = has_alpha;
+                    break;
+                }
+            }
+        }
+    }
+    if (frames_.empty()) return false;
+    MarkKeyFrames();
+    return true;
+}
+
+/**
+ * @brief Drops frames outside the canvas, and frames whose bitstream is not the size the ANMF
+ *        chunk says, so DecodeFrame() never writes outside the frame buffer.
+ */
+bool WebpDecoder::AddFrame(WebpFrameInfo info, size_t offset, size_t size) {
+    if (info.width <= 0 || info.height <= 0 || info.x + info.width > info_.width || info.y + info.height > info_.height) {
+        return false;
+    }
+    int width = 0, height = 0;
+    if (!WebPGetInfo(data_ + offset, size, &width, &height) || width != info.width || height != info.height) return false;
+
+    frames_.push_back(FrameData{info, offset, size, false});
+    info_.frame_count = static_cast<int32_t>(frames_.size());
+    info_.duration_ms += info.delay_ms;
+    return true;
+}
+
+/**
+ * @brief WebPAnimDecoder's rule: a frame is a key frame if it replaces the whole canvas with no
+ *        see-through pixels, or if the frame before it cleared the whole canvas on disposal.
+ */
+void WebpDecoder::MarkKeyFrames() {
+    for (size_t i = 0; i < frames_.size(); ++i) {
+        WebpFrameInfo& frame = frames_[i].info;
+        if (i == 0) {
+            frame.key_frame = 1;
+            continue;
+        }
+        const WebpFrameInfo& previous = frames_[i - 1].info;
+        const bool covers = FullCanvas(frame, info_) && (!frames_[i].has_alpha || !frame.blend);
+        const bool cleared = previous.dispose && (FullCanvas(previous, info_) || previous.key_frame);
+        frame.key_frame = covers || cleared ? 1 : 0;
+    }
+}
+
+bool WebpDecoder::DecodeFrame(int32_t index, uint8_t* out) const {
+    const FrameData& frame = frames_[index];
+    const size_t stride = static_cast<size_t>(frame.info.width) * 4;
+    return WebPDecodeBGRAInto(data_ + frame.offset, frame.size, out, stride * frame.info.height,
+                              static_cast<int>(stride)) != nullptr;
+}
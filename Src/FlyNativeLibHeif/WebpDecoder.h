@@ -0,0 +1,91 @@
+/**
+ * @file WebpDecoder.h
+ * @brief Declares WebpDecoder, a WebP container parser and frame decoder.
+ *
+ * Open() walks the RIFF chunks once and records, per ANMF frame, its rectangle, duration and
+ * flags, and where its ALPH/VP8/VP8L chunks are in the file; nothing is decoded until a frame
+ * is asked for. DecodeFrame() hands those chunks to libwebp as they are, which decodes them to
+ * straight-alpha BGRA. Compositing frames onto a canvas is WebpCompositor's job.
+ *
+ * Open() also marks key frames as libwebp's WebPAnimDecoder does: frames after which the canvas
+ * no longer depends on anything drawn before them. A seek only has to replay from the nearest
+ * key frame.
+ *
+ * A still WebP (simple format, or VP8X without the animation flag) is one frame covering the
+ * canvas. The file data is not copied and must outlive the decoder. Not thread-safe.
+ *
+ * This file does not include pch.h and must build without Windows headers on other platforms.
+ */
+
+#pragma once
+#ifndef WEBP_DECODER_H
+#define WEBP_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief One frame as described by its ANMF chunk. Blittable for P/Invoke.
+struct WebpFrameInfo {
+    int32_t x;                          ///< Frame rectangle on the canvas; frames outside it are dropped.
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    int32_t delay_ms;                   ///< Frame duration; under 10 ms becomes 100 ms, as browsers do.
+    int32_t dispose;                    ///< 1 to clear the rectangle to transparent before the next frame.
+    int32_t blend;                      ///< 1 to alpha-blend over the canvas, 0 to replace the rectangle.
+    int32_t key_frame;                  ///< 1 if drawing starts afresh here; see the file comment.
+};
+
+/// @brief The animation as a whole. Blittable for P/Invoke.
+struct WebpInfo {
+    int32_t width;                      ///< Canvas size, from VP8X or the still image.
+    int32_t height;
+    int32_t frame_count;
+    int32_t loop_count;                 ///< From ANIM: 0 loops forever.
+    int64_t duration_ms;                ///< Sum of the frame delays.
+};
+
+/// @brief Parses a WebP in memory and decodes its frames through libwebp.
+class WebpDecoder {
+public:
+    /// Canvases larger than this many pixels are rejected.
+    static constexpr int64_t kMaxPixels = 1ll << 28;
+
+    /// @brief Parses `data`. Frames after a truncation, and frames that do not fit the canvas, are dropped.
+    /// @return false if the data is not a WebP this decoder supports or has no frame.
+    bool Open(const uint8_t* data, size_t size);
+
+    const WebpInfo& Info() const { return info_; }
+    int32_t FrameCount() const { return info_.frame_count; }
+    const WebpFrameInfo& Frame(int32_t index) const { return frames_[index].info; }
+
+    /// @brief True if frame `index` may have pixels that are not opaque.
+    bool HasAlpha(int32_t index) const { return frames_[index].has_alpha; }
+
+    /// @brief Decodes frame `index` into `out`, `width * height` straight-alpha BGRA pixels
+    ///        (B in the low byte), packed.
+    /// @return false if libwebp cannot decode the frame.
+    bool DecodeFrame(int32_t index, uint8_t* out) const;
+
+    /// @brief Bytes held between frames: the frame table. libwebp's decode state lives only for one call.
+    size_t ScratchBytes() const { return frames_.capacity() * sizeof(FrameData); }
+
+private:
+    struct FrameData {
+        WebpFrameInfo info;
+        size_t offset;                  // The ALPH, VP8 or VP8L chunk the frame starts with.
+        size_t size;
+        bool has_alpha;
+    };
+
+    bool AddFrame(WebpFrameInfo info, size_t offset, size_t size);
+    void MarkKeyFrames();
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    WebpInfo info_{};
+    std::vector<FrameData> frames_;
+};
+
+#endif // WEBP_DECODER_H
@@ -52,6 +52,12 @@ public partial class App
 
         HandleInstanceManagement();
 
+        // Start reading the launch photo natively while the window and the canvas are being created.
+        // Its store open waits for the lock of a previous instance that is still being killed.
+        _selectedFilePath = GetLaunchFilePath();
+        if (!string.IsNullOrEmpty(_selectedFilePath) && !AppConfig.Settings.OpenExitZoom)
+            DiskCacherNative.BeginStartupPreview(_selectedFilePath, !AppConfig.Volatile.IsSecondaryInstance);
+
         var appliedLanguage = Localizer.ApplyLanguage(AppConfig.Settings.Language);
         if (appliedLanguage != AppConfig.Settings.Language)
         {
@@ -73,10 +79,6 @@ public partial class App
         //return;
 
 
-        _selectedFilePath = PathResolver.IsPackagedApp ? 
-            GetFilePathFromArgsPackaged(AppInstance.GetCurrent().GetActivatedEventArgs().Data as IFileActivatedEventArgs) : 
-            GetFilePathFromCommandLine();
-
         if (string.IsNullOrEmpty(_selectedFilePath))
         {
             var initWindow = new InitWindow();
@@ -136,15 +138,30 @@ public partial class App
         }
     }
 
+    /// <summary>
+    ///     Kills every other FlyPhotos process and waits briefly for each to exit, so the thumbnail
+    ///     store's lock is released before this instance opens the store.
+    /// </summary>
     private static void KillOtherFlys()
     {
+        const int exitWaitMs = 2000;
         var current = Process.GetCurrentProcess();
         foreach (var process in Process.GetProcessesByName(current.ProcessName))
             if (process.Id != current.Id)
-                try { process.Kill(); }
+                try
+                {
+                    process.Kill();
+                    if (!process.WaitForExit(exitWaitMs))
+                        Debug.WriteLine($"Previous instance {process.Id} did not exit within {exitWaitMs} ms");
+                }
                 catch (Exception ex) { Debug.WriteLine($"Failed to kill previous instance {process.Id} {ex.Message}"); }
     }
 
+    private static string GetLaunchFilePath() =>
+        PathResolver.IsPackagedApp ?
+            GetFilePathFromArgsPackaged(AppInstance.GetCurrent().GetActivatedEventArgs().Data as IFileActivatedEventArgs) :
+            GetFilePathFromCommandLine();
+
     private static string GetFilePathFromCommandLine() => 
         Environment.GetCommandLineArgs().Skip(1).FirstOrDefault();
 
@@ -1,5 +1,8 @@
 ﻿using System;
+using System.Threading;
 using Microsoft.Graphics.Canvas;
+using Windows.Graphics.DirectX;
+using FlyPhotos.Display.ImageRendering;
 
 namespace FlyPhotos.Core.Model;
 
@@ -14,7 +17,27 @@ internal abstract partial class DisplayItem(CanvasBitmap bitmap, Origin origin,
     public bool IsErrorOrUndefined() => 
         Origin == Origin.ErrorScreen || Origin == Origin.Undefined;
 
-    public void Dispose()
+    /// <summary>
+    /// Memory this item holds, for the prefetch memory budget. Error and placeholder bitmaps are
+    /// shared, so they count as nothing.
+    /// </summary>
+    public virtual long ResidentBytes
+    {
+        get
+        {
+            if (IsErrorOrUndefined() || Bitmap == null) return 0;
+            var size = Bitmap.SizeInPixels;
+            long pixels = (long)size.Width * size.Height;
+            return Bitmap.Format switch
+            {
+                DirectXPixelFormat.BC1UIntNormalized => pixels / 2,
+                DirectXPixelFormat.BC3UIntNormalized => pixels,
+                _ => pixels * 4
+            };
+        }
+    }
+
+    public virtual void Dispose()
     {
         // We don't dispose bitmaps coming from the error screen as they are reused.
         if (!IsErrorOrUndefined()) 
@@ -25,6 +48,13 @@ internal abstract partial class DisplayItem(CanvasBitmap bitmap, Origin origin,
 internal sealed partial class PreviewDisplayItem(CanvasBitmap bitmap, Origin origin, ImageMetadata metadata = null, int rotation = 0) : DisplayItem(bitmap, origin, rotation)
 {    
     public ImageMetadata Metadata { get; } = metadata;
+
+    /// <summary>
+    /// Thumbnail-strip tile that came with a disk-cache hit, handed to the photo in place of
+    /// one rendered from <see cref="DisplayItem.Bitmap"/>. Not owned or disposed by this item.
+    /// </summary>
+    public Thumbnail CachedThumbnail { get; init; }
+
     private static readonly PreviewDisplayItem _empty = new(null, Origin.Undefined);
     public static PreviewDisplayItem Empty() => _empty;
 }
@@ -40,25 +70,38 @@ internal sealed partial class StaticHqDisplayItem(CanvasBitmap bitmap, Origin or
 internal sealed partial class AnimatedHqDisplayItem(CanvasBitmap firstFrame, Origin origin, byte[] fileAsByteArray) : HqDisplayItem(firstFrame, origin, 0)
 {
     public byte[] FileAsByteArray { get; } = fileAsByteArray;
+
+    public override long ResidentBytes => base.ResidentBytes + (FileAsByteArray?.Length ?? 0);
 }
 
-internal sealed partial class MultiPageHqDisplayItem(CanvasBitmap firstFrame, Origin origin, byte[] fileAsByteArray,
-    int[] pageOrder) : HqDisplayItem(firstFrame, origin, 0)
+internal sealed partial class MultiPageHqDisplayItem(CanvasBitmap firstFrame, Origin origin, IPageSource pages)
+    : HqDisplayItem(firstFrame, origin, 0)
 {
-    public byte[] FileAsByteArray { get; } = fileAsByteArray;
-
     /// <summary>
-    /// Display page -> decoder frame index. TIFF passes identity, ICO passes largest-frame-first. It is
-    /// also the page count, so a count and a map can never disagree.
+    /// Decodes the pages on demand, in display order: TIFF in file order, ICO largest frame first.
+    /// The item owns it; renderers created from the item share it.
     /// </summary>
-    public int[] PageOrder { get; } = pageOrder;
+    public IPageSource Pages { get; } = pages;
+
+    public int PageCount => Pages.PageCount;
+
+    public override long ResidentBytes => base.ResidentBytes + Pages.ResidentBytes;
 
-    public int PageCount => PageOrder.Length;
+    public override void Dispose()
+    {
+        base.Dispose();
+        Pages.Dispose();
+    }
 }
 
-internal sealed partial class Thumbnail(byte[] pixels) : IDisposable
+internal sealed partial class Thumbnail(byte[] pixels, DirectXPixelFormat format = DirectXPixelFormat.B8G8R8A8UIntNormalized)
 {
+    private static long _lastId;
+
+    /// <summary>A ThumbnailPixelBufferSize-square image in <see cref="Format"/>: BGRA pixels, or BC blocks from the disk cache.</summary>
     public byte[] Pixels { get; } = pixels;
-    public CanvasBitmap Bitmap { get; internal set; }
-    public void Dispose() => Bitmap?.Dispose();
+    public DirectXPixelFormat Format { get; } = format;
+
+    /// <summary>Unique per instance; keys the thumbnail-strip atlas, so a replaced thumbnail gets a new slot.</summary>
+    public long Id { get; } = Interlocked.Increment(ref _lastId);
 }
\ No newline at end of file
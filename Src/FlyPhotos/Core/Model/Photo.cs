@@ -2,8 +2,10 @@
 using System;
 using System.Collections.Generic;
 using System.IO;
+using System.Threading;
 using System.Threading.Tasks;
 using FlyPhotos.Display.ImageReading;
+using FlyPhotos.Infra.Interop;
 using FlyPhotos.Services;
 using Microsoft.Graphics.Canvas;
 using Windows.Foundation;
@@ -62,6 +64,7 @@ internal partial class Photo : IDisposable
 
         async Task GetInitialPreview()
         {
+            ProbeSize();
             firstDisplay = await ImageReader.GetFirstPreviewSpecialHandlingAsync(device, FilePath);
         }
     }
@@ -70,7 +73,7 @@ internal partial class Photo : IDisposable
     {
         async Task GetHqImage()
         {
-            Hq = await ImageReader.GetHqImage(device, FilePath);
+            Hq = await ImageReader.GetHqImage(device, FilePath, foreground: true);
         }
         await Task.Run(GetHqImage);
     }
@@ -85,6 +88,7 @@ internal partial class Photo : IDisposable
         if (Preview == null || Preview.Origin == Origin.ErrorScreen ||
             Preview.Origin == Origin.Undefined)
         {
+            ProbeSize();
             Preview = await ImageReader.GetPreview(device, FilePath);
             if (Thumbnail == null && Preview != null && !Preview.IsErrorOrUndefined())
                 GenerateThumbnail(device, Preview);
@@ -116,9 +120,31 @@ internal partial class Photo : IDisposable
             }
             return (Preview.Bitmap.SizeInPixels.Width, Preview.Bitmap.SizeInPixels.Height);
         }
-        return (100, 100);
+
+        // Nothing decoded yet: take the size from the folder index, or from the header the loading
+        // thread read. Neither touches the disk, so this is safe on the UI thread.
+        if (FolderMetadataIndex.Current is { } index && index.TryGetDisplaySize(FilePath, out var w, out var h))
+            return (w, h);
+        long probed = Volatile.Read(ref _probedSize);
+        return probed != 0 ? ((int)(probed >> 32), (int)probed) : (100, 100);
+    }
+
+    /// <summary>
+    /// Reads the size from the file header so layout is right before a preview exists. This reads
+    /// the file, so it runs on the loading threads; GetActualSize only uses the result.
+    /// </summary>
+    private void ProbeSize()
+    {
+        if (Volatile.Read(ref _probedSize) != 0) return;
+        if (FolderMetadataIndex.Current is { } index && index.TryGetDisplaySize(FilePath, out _, out _)) return;
+        if (!NativeImageProbe.TryProbe(FilePath, out var info) || info.Width <= 0 || info.Height <= 0) return;
+        var (w, h) = info.DisplaySize;
+        Volatile.Write(ref _probedSize, ((long)w << 32) | (uint)h);
     }
 
+    // Width in the high 32 bits and height in the low; 0 until ProbeSize() has read the header.
+    private long _probedSize;
+
     public static DisplayItem GetLoadingIndicator() => ImageReader.GetLoadingIndicator();
 
     private static readonly HashSet<string> FormatsSupportingTransparency =
@@ -132,8 +158,10 @@ internal partial class Photo : IDisposable
         ".svg",
         ".apng",
         ".ico",
+        ".cur",
         ".jxl",
-        ".psd"
+        ".psd",
+        ".psb"
     };
 
     public bool IsErrorScreen(DisplayLevel currentDisplayLevel)
@@ -144,6 +172,12 @@ internal partial class Photo : IDisposable
 
     private void GenerateThumbnail(ICanvasResourceCreatorWithDpi device, PreviewDisplayItem preview)
     {
+        // A disk-cache hit brings a ready-made tile; only previews decoded from the file are scaled down here.
+        if (preview.CachedThumbnail != null)
+        {
+            Thumbnail = preview.CachedThumbnail;
+            return;
+        }
         if (preview.Bitmap == null) return;
         try
         {
@@ -175,7 +209,6 @@ internal partial class Photo : IDisposable
     {
         Hq?.Dispose();
         Preview?.Dispose();
-        Thumbnail?.Dispose();
         Thumbnail = null;
     }
 
@@ -189,7 +222,6 @@ internal partial class Photo : IDisposable
     {
         Preview?.Dispose();
         Preview = null;
-        Thumbnail?.Dispose();
         Thumbnail = null;
     }
 }
\ No newline at end of file
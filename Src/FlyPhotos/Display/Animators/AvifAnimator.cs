@@ -1,422 +0,0 @@
-using System;
-using System.Runtime.InteropServices;
-using System.Threading.Tasks;
-using Windows.Foundation;
-using Windows.Graphics.DirectX;
-using FlyPhotos.Infra.Interop;
-using Microsoft.Graphics.Canvas;
-using Microsoft.UI;
-
-namespace FlyPhotos.Display.Animators;
-
-/// <summary>
-///     Real-time animator for animated AVIF/HEIF files, implementing <see cref="IAnimator" />.
-/// </summary>
-/// <remarks>
-///     <para>
-///         <b>Native decode path.</b>
-///         AVIF decoding is performed by a native C++ library accessed through
-///         <see cref="NativeAvifBridge" />. The library maintains a stateful per-file context
-///         (opened via <c>OpenAvifAnimation</c>) that advances through frames sequentially.
-///         This is fundamentally different from the WIC-based animators (GIF, APNG, WebP),
-///         which seek to arbitrary frames by index. The native context must be explicitly
-///         reset (<c>ResetAvifAnimation</c>) to loop back to the beginning.
-///     </para>
-///     <para>
-///         <b>Zero managed allocation on the hot path.</b>
-///         The pixel buffer (<see cref="_pixelBuffer" />) is allocated on the Pinned Object Heap
-///         (no <see cref="GCHandle" />). The native decoder writes directly into it via
-///         <see cref="_pixelBufferPtr" />, and Win2D uploads from it via <c>SetPixelBytes</c>.
-///         <see cref="UpdateAsync" /> returns <c>Task.CompletedTask</c> � no async state machine
-///         is allocated per call. The combination achieves zero managed heap allocation during
-///         steady-state playback.
-///     </para>
-///     <para>
-///         <b>Timing model.</b>
-///         Unlike the index-based animators which map wall-clock time directly to a frame index,
-///         this animator uses a delta-time accumulator. Each <see cref="UpdateAsync" /> call
-///         measures the elapsed time since the previous call and advances through as many frames
-///         as that delta covers. This approach is natural for a stateful native decoder that
-///         cannot seek backwards without a full reset.
-///     </para>
-///     <para>
-///         <b>GPU resource thread requirement.</b>
-///         <see cref="CanvasBitmap" /> and <see cref="CanvasRenderTarget" /> must be created on
-///         the Win2D device thread. The native CPU work (memory allocation, file copy, decoder
-///         open) is offloaded to a threadpool thread in <see cref="CreateAsync" />; GPU resource
-///         creation happens back on the calling thread after the threadpool task completes.
-///     </para>
-/// </remarks>
-public partial class AvifAnimator : IAnimator
-{
-    // -------------------------------------------------------------------------
-    // Private fields
-    // -------------------------------------------------------------------------
-
-    /// <summary>
-    ///     Handle to the native <c>AnimatedAvifReader</c> C++ object.
-    ///     Zero when the animator has been disposed or the native open failed.
-    ///     Zeroed after <c>CloseAvifAnimation</c> to prevent double-close.
-    /// </summary>
-    private IntPtr _nativeHandle;
-
-    /// <summary>
-    ///     Pointer to the unmanaged memory block holding the raw AVIF file bytes.
-    ///     Allocated via <c>Marshal.AllocHGlobal</c> in <see cref="CreateAsync" /> and
-    ///     kept alive for the lifetime of the animator because the native decoder reads
-    ///     from it on every <c>DecodeNextAvifFrame</c> call. Freed in <see cref="Dispose(bool)" />.
-    /// </summary>
-    private IntPtr _unmanagedFileData;
-
-    /// <summary>
-    ///     CPU-side pixel buffer that receives decoded frame data from the native decoder.
-    ///     Sized to <c>PixelWidth � PixelHeight � 4</c> bytes (RGBA8, one byte per channel).
-    ///     Allocated on the Pinned Object Heap (<see cref="GC.AllocateArray{T}(int, bool)" />),
-    ///     so the buffer never moves and its address is stable for the object's lifetime �
-    ///     the native decoder writes into <see cref="_pixelBufferPtr" /> without marshalling,
-    ///     and Win2D's <c>SetPixelBytes</c> uploads without additional pinning. Using the POH
-    ///     avoids a <see cref="GCHandle" /> pinning an object inside the regular heap, which
-    ///     would contribute to heap/LOH fragmentation for buffers of this size.
-    /// </summary>
-    private readonly byte[] _pixelBuffer;
-
-    /// <summary>
-    ///     Raw pointer to the start of the pinned <see cref="_pixelBuffer" />.
-    ///     Passed directly to <c>DecodeNextAvifFrame</c>, eliminating the managed
-    ///     array as an intermediary on the decode path. Stable because the buffer
-    ///     lives on the Pinned Object Heap and the field holds it alive for the
-    ///     object's lifetime.
-    /// </summary>
-    private readonly IntPtr _pixelBufferPtr;
-
-    /// <summary>
-    ///     Off-screen render target where each decoded frame is stamped.
-    ///     Exposed as <see cref="Surface" /> for the Win2D render loop.
-    /// </summary>
-    private readonly CanvasRenderTarget _compositedSurface;
-
-    /// <summary>
-    ///     Reusable GPU texture updated via <c>SetPixelBytes</c> on each frame render.
-    ///     Avoids the D3D texture create/destroy cycle that would occur if a new
-    ///     <c>CanvasBitmap</c> were allocated per frame.
-    /// </summary>
-    private readonly CanvasBitmap _frameBitmap;
-
-    /// <summary>
-    ///     Pre-computed full-canvas <see cref="Rect" />.
-    ///     Passed to <c>DrawImage</c> to guarantee 1:1 pixel mapping, bypassing the
-    ///     DPI-scaling interpolation that Win2D's float-coordinate overload applies.
-    /// </summary>
-    private readonly Rect _canvasRect;
-
-    /// <summary>
-    ///     Timestamp of the most recent <see cref="UpdateAsync" /> call.
-    ///     Used to compute the elapsed delta since the last render tick.
-    /// </summary>
-    private TimeSpan _lastElapsedTime = TimeSpan.Zero;
-
-    /// <summary>
-    ///     Accumulated wall-clock milliseconds not yet consumed by a frame advance.
-    ///     Incremented by the per-tick delta and decremented by each frame's duration
-    ///     as the catch-up loop advances through frames.
-    /// </summary>
-    private double _accumulatedTimeMs;
-
-    /// <summary>
-    ///     Display duration of the currently shown frame in milliseconds, as returned
-    ///     by the most recent successful <c>DecodeNextAvifFrame</c> call.
-    ///     A value of 0 indicates a stalled/error state; the catch-up loop's
-    ///     <c>&amp;&amp; _currentFrameDurationMs &gt; 0</c> guard suppresses further
-    ///     decode attempts until an explicit reset.
-    /// </summary>
-    private int _currentFrameDurationMs;
-
-    /// <summary>
-    ///     <c>true</c> until the very first frame has been decoded and rendered.
-    ///     The first-frame path initialises <see cref="_lastElapsedTime" /> and
-    ///     <see cref="_currentFrameDurationMs" /> before the delta accumulator begins.
-    /// </summary>
-    private bool _isFirstFrame = true;
-
-    /// <summary>Guards against double-disposal.</summary>
-    private bool _isDisposed;
-
-    // -------------------------------------------------------------------------
-    // IAnimator public surface
-    // -------------------------------------------------------------------------
-
-    /// <inheritdoc />
-    public uint PixelWidth { get; }
-
-    /// <inheritdoc />
-    public uint PixelHeight { get; }
-
-    /// <inheritdoc />
-    public ICanvasImage Surface => _compositedSurface;
-
-    // -------------------------------------------------------------------------
-    // Construction
-    // -------------------------------------------------------------------------
-
-    /// <summary>
-    ///     Private constructor. Use <see cref="CreateAsync" /> to instantiate.
-    ///     Performs only GPU resource creation � no native decode work happens here.
-    ///     Must be called on the Win2D device thread (not inside <c>Task.Run</c>).
-    /// </summary>
-    private AvifAnimator(IntPtr handle, IntPtr unmanagedFileData, ICanvasResourceCreatorWithDpi canvas)
-    {
-        _nativeHandle = handle;
-        _unmanagedFileData = unmanagedFileData;
-
-        PixelWidth = (uint)NativeAvifBridge.GetAvifCanvasWidth(handle);
-        PixelHeight = (uint)NativeAvifBridge.GetAvifCanvasHeight(handle);
-        _canvasRect = new Rect(0, 0, PixelWidth, PixelHeight);
-
-        // Pinned Object Heap allocation: zero-initialised (so the _frameBitmap created below
-        // has defined contents before the first decode) and never relocated, giving a stable
-        // pointer without a GCHandle.
-        _pixelBuffer = GC.AllocateArray<byte>((int)(PixelWidth * PixelHeight * 4), pinned: true);
-        _pixelBufferPtr = Marshal.UnsafeAddrOfPinnedArrayElement(_pixelBuffer, 0);
-
-        // GPU resources created here, on the Win2D device thread. Creating them inside
-        // Task.Run (threadpool) would race against the device's dispatcher queue.
-        _frameBitmap = CanvasBitmap.CreateFromBytes(
-            canvas.Device, _pixelBuffer,
-            (int)PixelWidth, (int)PixelHeight,
-            DirectXPixelFormat.R8G8B8A8UIntNormalized); // RGBA passthrough from native decoder
-
-        _compositedSurface = new CanvasRenderTarget(canvas, PixelWidth, PixelHeight, 96);
-        using var ds = _compositedSurface.CreateDrawingSession();
-        ds.Clear(Colors.Transparent);
-    }
-
-    /// <summary>
-    ///     Asynchronously creates a <see cref="AvifAnimator" /> from raw AVIF file bytes.
-    /// </summary>
-    /// <remarks>
-    ///     CPU-bound work (native memory allocation, file data copy, native decoder open) is
-    ///     offloaded to a threadpool thread. GPU resource creation (constructor body) runs on
-    ///     the calling thread after the threadpool task completes, satisfying Win2D's requirement
-    ///     that GPU objects be created on the device thread.
-    /// </remarks>
-    /// <param name="fileData">Complete raw bytes of the AVIF file.</param>
-    /// <param name="canvas">The Win2D <see cref="ICanvasResourceCreatorWithDpi" /> that owns the GPU device.</param>
-    /// <returns>A fully initialised <see cref="AvifAnimator" /> ready for <see cref="UpdateAsync" /> calls.</returns>
-    public static async Task<AvifAnimator> CreateAsync(byte[] fileData, ICanvasResourceCreatorWithDpi canvas)
-    {
-        // Phase 1 (threadpool): native allocation and decoder open � CPU-only work.
-        // The file bytes are copied into unmanaged memory so the native decoder can hold a
-        // raw pointer without pinning the managed array, allowing the GC to compact the heap.
-        var (handle, unmanagedMemory) = await Task.Run(() =>
-        {
-            IntPtr mem = Marshal.AllocHGlobal(fileData.Length);
-            try
-            {
-                Marshal.Copy(fileData, 0, mem, fileData.Length);
-
-                IntPtr h = NativeAvifBridge.OpenAvifAnimation(mem, (nuint)fileData.Length);
-                if (h == IntPtr.Zero)
-                    throw new InvalidOperationException("Failed to open animated AVIF via native decoder.");
-
-                return (h, mem);
-            }
-            catch
-            {
-                Marshal.FreeHGlobal(mem);
-                throw;
-            }
-        });
-
-        // Phase 2 (calling thread): GPU resource creation.
-        // unmanagedMemory is owned by this scope until the constructor takes it.
-        // If the constructor throws, both the native handle and unmanaged memory are
-        // cleaned up here; there is no other scope that holds a copy of the pointer.
-        try
-        {
-            return new AvifAnimator(handle, unmanagedMemory, canvas);
-        }
-        catch
-        {
-            NativeAvifBridge.CloseAvifAnimation(handle);
-            Marshal.FreeHGlobal(unmanagedMemory);
-            throw;
-        }
-    }
-
-    // -------------------------------------------------------------------------
-    // Animation update loop
-    // -------------------------------------------------------------------------
-
-    /// <summary>
-    ///     Advances the animation by the elapsed time since the previous call and renders
-    ///     the resulting frame to <see cref="_compositedSurface" />.
-    ///     Fully synchronous � returns <c>Task.CompletedTask</c> with no async state machine.
-    /// </summary>
-    /// <param name="totalElapsedTime">Total time elapsed since the animator was started.</param>
-    public async Task UpdateAsync(TimeSpan totalElapsedTime)
-    {
-        if (_nativeHandle == IntPtr.Zero) return;
-
-        // First-frame path: initialise timing state and decode frame 0 off the Win2D thread.
-        if (_isFirstFrame)
-        {
-            _isFirstFrame = false;
-            _lastElapsedTime = totalElapsedTime;
-            _currentFrameDurationMs = await Task.Run(
-                () => NativeAvifBridge.DecodeNextAvifFrame(_nativeHandle, _pixelBufferPtr));
-            if (_currentFrameDurationMs > 0)
-                RenderBufferToSurface();
-            return;
-        }
-
-        var delta = totalElapsedTime - _lastElapsedTime;
-        _lastElapsedTime = totalElapsedTime;
-
-        // Negative delta means the caller's clock was reset (e.g. explicit restart).
-        if (delta < TimeSpan.Zero)
-        {
-            int dur = await Task.Run(() =>
-            {
-                NativeAvifBridge.ResetAvifAnimation(_nativeHandle);
-                return NativeAvifBridge.DecodeNextAvifFrame(_nativeHandle, _pixelBufferPtr);
-            });
-            _currentFrameDurationMs = dur > 0 ? dur : 0;
-            if (_currentFrameDurationMs > 0) RenderBufferToSurface();
-            _accumulatedTimeMs = 0;
-            return;
-        }
-
-        // Cap the accumulator to avoid a burst of catch-up decodes after a long stall.
-        // (e.g. app backgrounded) would cause a burst of synchronous native decodes on the
-        // next tick, potentially freezing the render thread for a noticeable duration.
-        // 10 frames of catch-up per tick is enough to stay smooth under moderate frame drops.
-        const int maxCatchUpFrames = 10;
-        if (_currentFrameDurationMs > 0)
-        {
-            double maxAccumulated = _currentFrameDurationMs * maxCatchUpFrames;
-            if (_accumulatedTimeMs > maxAccumulated)
-                _accumulatedTimeMs = maxAccumulated;
-        }
-
-        _accumulatedTimeMs += delta.TotalMilliseconds;
-
-        if (_accumulatedTimeMs < _currentFrameDurationMs || _currentFrameDurationMs <= 0)
-            return;
-
-        // Offload all native decode work for this tick to the ThreadPool.
-        // _animatorLock (in AnimatedImageRenderer) prevents re-entry, so the timing
-        // fields are only accessed from one logical call at a time — no races.
-        bool rendered = await Task.Run(() =>
-        {
-            bool didRender = false;
-            while (_accumulatedTimeMs >= _currentFrameDurationMs && _currentFrameDurationMs > 0)
-            {
-                _accumulatedTimeMs -= _currentFrameDurationMs;
-
-                int nextDurationMs = NativeAvifBridge.DecodeNextAvifFrame(_nativeHandle, _pixelBufferPtr);
-                if (nextDurationMs <= 0)
-                {
-                    NativeAvifBridge.ResetAvifAnimation(_nativeHandle);
-                    _accumulatedTimeMs = 0;
-                    nextDurationMs = NativeAvifBridge.DecodeNextAvifFrame(_nativeHandle, _pixelBufferPtr);
-                    if (nextDurationMs <= 0)
-                    {
-                        _currentFrameDurationMs = 0;
-                        break;
-                    }
-                }
-
-                _currentFrameDurationMs = nextDurationMs;
-                didRender = true;
-            }
-            return didRender;
-        });
-
-        if (rendered)
-            RenderBufferToSurface();
-    }
-
-    // -------------------------------------------------------------------------
-    // Rendering
-    // -------------------------------------------------------------------------
-
-    /// <summary>
-    ///     Uploads the latest decoded pixels from <see cref="_pixelBuffer" /> to
-    ///     <see cref="_frameBitmap" /> and stamps it onto <see cref="_compositedSurface" />.
-    /// </summary>
-    private void RenderBufferToSurface()
-    {
-        if (_nativeHandle == IntPtr.Zero || _compositedSurface.Device == null) return;
-
-        // SetPixelBytes reads from _pixelBuffer. Because the buffer lives on the Pinned
-        // Object Heap, no GC pin/unpin occurs here � zero GC pressure on this call.
-        _frameBitmap.SetPixelBytes(_pixelBuffer);
-
-        using var ds = _compositedSurface.CreateDrawingSession();
-        ds.Blend = CanvasBlend.Copy;
-
-        // Rect overload guarantees 1:1 pixel mapping � bypasses Win2D's DPI-scaling transform.
-        ds.DrawImage(_frameBitmap, _canvasRect);
-    }
-
-    // -------------------------------------------------------------------------
-    // IDisposable / finalizer
-    // -------------------------------------------------------------------------
-
-    /// <inheritdoc />
-    public void Dispose()
-    {
-        Dispose(true);
-        GC.SuppressFinalize(this);
-    }
-
-    /// <summary>
-    ///     Internal disposal logic following the standard IDisposable/finalizer pattern.
-    /// </summary>
-    /// <param name="disposing">
-    ///     <c>true</c> when called from <see cref="Dispose()" /> � safe to release managed resources.<br />
-    ///     <c>false</c> when called from the finalizer � managed objects may already be collected;
-    ///     only unmanaged resources are released.
-    /// </param>
-    protected virtual void Dispose(bool disposing)
-    {
-        if (_isDisposed) return;
-
-        // Unmanaged resources � always safe to release, including from the finalizer thread.
-        if (_nativeHandle != IntPtr.Zero)
-        {
-            NativeAvifBridge.CloseAvifAnimation(_nativeHandle);
-            _nativeHandle = IntPtr.Zero;
-        }
-
-        if (_unmanagedFileData != IntPtr.Zero)
-        {
-            Marshal.FreeHGlobal(_unmanagedFileData);
-            _unmanagedFileData = IntPtr.Zero;
-        }
-
-        // _pixelBuffer lives on the Pinned Object Heap: there is no GCHandle to release,
-        // and it is reclaimed by the GC once this instance becomes unreachable. The native
-        // handle was zeroed above, so the decoder can no longer write into it.
-
-        // Managed Win2D GPU resources � only safe to release when explicitly disposed.
-        // Releasing Win2D objects from a finalizer thread races against the device dispatcher.
-        if (disposing)
-        {
-            _frameBitmap?.Dispose();
-            _compositedSurface?.Dispose();
-        }
-
-        _isDisposed = true;
-    }
-
-    /// <summary>
-    ///     Finalizer backstop ensuring native memory and handles are released even if
-    ///     <see cref="Dispose()" /> is never called. Win2D GPU resources are NOT released
-    ///     from here � see <see cref="Dispose(bool)" />.
-    /// </summary>
-    ~AvifAnimator()
-    {
-        Dispose(false);
-    }
-}
\ No newline at end of file
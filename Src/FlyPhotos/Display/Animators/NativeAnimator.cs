@@ -0,0 +1,432 @@
+using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Runtime.InteropServices.WindowsRuntime;
+using System.Threading;
+using System.Threading.Tasks;
+using Windows.Graphics.DirectX;
+using Windows.Storage.Streams;
+using FlyPhotos.Infra.Interop;
+using Microsoft.Graphics.Canvas;
+
+namespace FlyPhotos.Display.Animators;
+
+/// <summary>
+///     Real-time animator for every natively decoded animated format (GIF, APNG, WebP and
+///     AVIF/HEIF sequences), implementing <see cref="IAnimator" />.
+/// </summary>
+/// <remarks>
+///     <para>
+///         <b>One native interface.</b>
+///         The native <c>IAnimationSource</c> (accessed through <see cref="NativeAnimationBridge" />)
+///         picks the backend from the file signature. Every backend composites onto a
+///         premultiplied BGRA canvas in CPU memory, replays from the nearest key frame on a seek,
+///         and reports the rectangle that changed, so this class has no per-format code. Only the
+///         changed rectangle is uploaded to <see cref="_canvasBitmap" />, which is the surface.
+///     </para>
+///     <para>
+///         <b>Decoding ahead into a ring.</b>
+///         Frames are decoded on the thread pool, up to <see cref="SlotCount" /> - 1 ahead of the
+///         one due, each into its own slot of <see cref="_ringBuffer" />. The animator is itself the
+///         <see cref="IThreadPoolWorkItem" /> that is queued, so a decode pass allocates nothing:
+///         no <c>Task</c>, no closure. <see cref="UpdateAsync" /> only uploads slots that are
+///         already decoded and returns <c>Task.CompletedTask</c>; a slot holds the change from the
+///         slot before it, so slots are uploaded in the order they were decoded.
+///     </para>
+///     <para>
+///         <b>Timeline.</b>
+///         Frames are numbered along the timeline (loop * frame count + index), so "ahead" keeps
+///         its meaning across loop boundaries. When the render loop falls behind, the next decode
+///         goes straight to the frame that is due; the native source draws the frames in between
+///         and reports their union.
+///     </para>
+///     <para>
+///         <b>Loop count.</b>
+///         The file's loop count is read natively but not honoured; the animator always loops
+///         infinitely via <c>totalElapsedTime % _totalAnimationDuration</c>.
+///     </para>
+/// </remarks>
+public partial class NativeAnimator : IAnimator, IThreadPoolWorkItem
+{
+    /// <summary>
+    ///     Slots in the ring: the frame on screen's successor plus one more can be decoded
+    ///     before they are due, and one slot is always free for the decode in progress.
+    /// </summary>
+    private const int SlotCount = 3;
+
+    /// <summary>Largest canvas edge played, Direct2D's bitmap size limit on feature level 11 hardware.</summary>
+    private const int MaxCanvasEdge = 16384;
+
+    // -------------------------------------------------------------------------
+    // IAnimator public surface
+    // -------------------------------------------------------------------------
+
+    /// <inheritdoc />
+    public uint PixelWidth { get; }
+
+    /// <inheritdoc />
+    public uint PixelHeight { get; }
+
+    /// <inheritdoc />
+    public ICanvasImage Surface => _canvasBitmap;
+
+    // -------------------------------------------------------------------------
+    // Private fields
+    // -------------------------------------------------------------------------
+
+    /// <summary>
+    ///     Handle to the native <c>IAnimationSource</c>. Used only under <see cref="_decodeLock" />
+    ///     once the animator is constructed; zeroed after <c>CloseAnimation</c>.
+    /// </summary>
+    private IntPtr _nativeHandle;
+
+    /// <summary>
+    ///     Unmanaged copy of the file bytes, allocated in <see cref="CreateAsync" />. The native
+    ///     source reads frames from it on every decode, so it lives as long as the animator.
+    /// </summary>
+    private IntPtr _unmanagedFileData;
+
+    /// <summary>Container format, for the diagnostics written on disposal.</summary>
+    private readonly ProbedImageFormat _format;
+
+    private readonly int _frameCount;
+
+    /// <summary>Total wall-clock duration of one complete animation loop.</summary>
+    private readonly TimeSpan _totalAnimationDuration;
+
+    /// <summary>
+    ///     Cumulative end-time for each frame: <c>_frameCumulativeTime[i]</c> is the elapsed
+    ///     time at which frame <c>i</c> finishes displaying. Searched with
+    ///     <c>Array.BinarySearch</c> on each tick.
+    /// </summary>
+    private readonly TimeSpan[] _frameCumulativeTime;
+
+    /// <summary>GPU copy of the composited canvas, updated one dirty rectangle at a time.</summary>
+    private readonly CanvasBitmap _canvasBitmap;
+
+    /// <summary>
+    ///     <see cref="SlotCount" /> slots of one full canvas each, the largest rectangle that can
+    ///     change. On the Pinned Object Heap, so <see cref="_ring" /> can point into it without a
+    ///     <see cref="GCHandle" />.
+    /// </summary>
+    private readonly byte[] _ringBuffer;
+
+    /// <summary>Native view of <see cref="_ringBuffer" />, passed to every decode.</summary>
+    private readonly AnimationRing _ring;
+
+    /// <summary>
+    ///     Pre-built <c>IBuffer</c> wrappers, one per slot. The rectangle overload of
+    ///     <c>SetPixelBytes</c> accepts only an <c>IBuffer</c>, read from its start.
+    /// </summary>
+    private readonly IBuffer[] _slotBuffers = new IBuffer[SlotCount];
+
+    /// <summary>Timeline number of the frame each slot holds. Written by the decoder before it publishes the slot.</summary>
+    private readonly long[] _slotFrame = new long[SlotCount];
+
+    /// <summary>Changed rectangle each slot holds, packed at the start of the slot.</summary>
+    private readonly FrameRect[] _slotDirty = new FrameRect[SlotCount];
+
+    /// <summary>Slots decoded so far. Written by the decoder only; slot <c>n % SlotCount</c> holds the n-th.</summary>
+    private long _produced;
+
+    /// <summary>Slots uploaded so far. Written by <see cref="UpdateAsync" /> only.</summary>
+    private long _consumed;
+
+    /// <summary>Timeline number of the frame due now. Written by <see cref="UpdateAsync" />, read by the decoder.</summary>
+    private long _targetFrame;
+
+    /// <summary>Timeline number of the last frame decoded. Decoder only.</summary>
+    private long _lastDecodedFrame;
+
+    /// <summary>Timeline number of the last frame uploaded. <see cref="UpdateAsync" /> only.</summary>
+    private long _shownFrame = -1;
+
+    /// <summary>
+    ///     Frames added to the timeline when the caller's clock goes backwards, so the timeline
+    ///     itself never does. <see cref="UpdateAsync" /> only.
+    /// </summary>
+    private long _timelineOffset;
+
+    /// <summary>1 while a decode pass is queued or running.</summary>
+    private int _decodeQueued;
+
+    /// <summary>Serialises native calls between the decode pass and <see cref="Dispose(bool)" />.</summary>
+    private readonly Lock _decodeLock = new();
+
+    /// <summary>Guards against double-disposal; also stops a running decode pass.</summary>
+    private volatile bool _isDisposed;
+
+    // -------------------------------------------------------------------------
+    // Construction
+    // -------------------------------------------------------------------------
+
+    /// <summary>
+    ///     Private constructor. Use <see cref="CreateAsync" /> to instantiate.
+    ///     Performs only GPU resource creation and must be called on the Win2D device thread.
+    ///     Slot 0 already holds the first frame.
+    /// </summary>
+    private NativeAnimator(IntPtr handle, IntPtr unmanagedFileData, AnimationInfo info, TimeSpan[] frameCumulativeTime,
+        byte[] ringBuffer, FrameRect firstDirty, ICanvasResourceCreatorWithDpi canvas)
+    {
+        _nativeHandle = handle;
+        _unmanagedFileData = unmanagedFileData;
+        _format = info.Format;
+        _frameCount = info.FrameCount;
+        _frameCumulativeTime = frameCumulativeTime;
+        _totalAnimationDuration = frameCumulativeTime[^1];
+
+        PixelWidth = (uint)info.Width;
+        PixelHeight = (uint)info.Height;
+
+        int slotSize = ringBuffer.Length / SlotCount;
+        _ringBuffer = ringBuffer;
+        _ring = new AnimationRing
+        {
+            Slots = Marshal.UnsafeAddrOfPinnedArrayElement(ringBuffer, 0),
+            SlotSize = slotSize,
+            SlotCount = SlotCount
+        };
+        for (int i = 0; i < SlotCount; i++)
+            _slotBuffers[i] = ringBuffer.AsBuffer(i * slotSize, slotSize);
+
+        _slotFrame[0] = 0;
+        _slotDirty[0] = firstDirty;
+        _produced = 1;
+
+        // The last slot is still all zero, so the bitmap starts fully transparent, as the
+        // native canvas does.
+        _canvasBitmap = CanvasBitmap.CreateFromBytes(
+            canvas.Device,
+            _slotBuffers[SlotCount - 1],
+            (int)PixelWidth,
+            (int)PixelHeight,
+            DirectXPixelFormat.B8G8R8A8UIntNormalized); // Premultiplied BGRA from the native source
+    }
+
+    /// <summary>
+    ///     Asynchronously creates a <see cref="NativeAnimator" /> from raw file bytes.
+    /// </summary>
+    /// <remarks>
+    ///     The file copy, the native open, the frame table read and the first frame's decode run on
+    ///     a threadpool thread; GPU resources are created back on the calling thread.
+    /// </remarks>
+    /// <param name="fileData">Complete raw bytes of a GIF, PNG, WebP, AVIF or HEIF file.</param>
+    /// <param name="canvas">The Win2D <see cref="ICanvasResourceCreatorWithDpi" /> that owns the GPU device.</param>
+    /// <returns>A fully initialised <see cref="NativeAnimator" /> ready for <see cref="UpdateAsync" /> calls.</returns>
+    public static async Task<NativeAnimator> CreateAsync(byte[] fileData, ICanvasResourceCreatorWithDpi canvas)
+    {
+        var (handle, unmanagedMemory, info, cumulativeTime, ringBuffer, firstDirty) = await Task.Run(() =>
+        {
+            IntPtr mem = Marshal.AllocHGlobal(fileData.Length);
+            IntPtr h = IntPtr.Zero;
+            try
+            {
+                Marshal.Copy(fileData, 0, mem, fileData.Length);
+
+                h = NativeAnimationBridge.OpenAnimation(mem, (nuint)fileData.Length);
+                if (h == IntPtr.Zero || !NativeAnimationBridge.GetAnimationInfo(h, out var animationInfo) ||
+                    animationInfo.FrameCount == 0)
+                    throw new InvalidOperationException("Failed to open animation via native decoder.");
+
+                // The ring is one managed array addressed with int offsets, so every slot together
+                // must fit in Array.MaxLength. A larger animation keeps showing its static first frame.
+                long slotBytes = animationInfo.Width is > 0 and <= MaxCanvasEdge &&
+                                 animationInfo.Height is > 0 and <= MaxCanvasEdge
+                    ? checked((long)animationInfo.Width * animationInfo.Height * 4)
+                    : 0;
+                if (slotBytes == 0 || checked(slotBytes * SlotCount) > Array.MaxLength)
+                    throw new InvalidOperationException(
+                        $"Animation canvas {animationInfo.Width}x{animationInfo.Height} is too large to play.");
+
+                var cumulative = new TimeSpan[animationInfo.FrameCount];
+                var total = TimeSpan.Zero;
+                for (int i = 0; i < animationInfo.FrameCount; i++)
+                {
+                    NativeAnimationBridge.GetAnimationFrameInfo(h, i, out var frame);
+                    total += TimeSpan.FromMilliseconds(frame.DelayMs);
+                    cumulative[i] = total;
+                }
+
+                // Zero-initialised and never relocated; the first frame goes into slot 0 now so the
+                // first UpdateAsync has something to upload.
+                int slotSize = (int)slotBytes;
+                var ring = GC.AllocateArray<byte>(slotSize * SlotCount, pinned: true);
+                var ringView = new AnimationRing
+                {
+                    Slots = Marshal.UnsafeAddrOfPinnedArrayElement(ring, 0),
+                    SlotSize = slotSize,
+                    SlotCount = SlotCount
+                };
+                if (!NativeAnimationBridge.DecodeAnimationFrame(h, 0, in ringView, 0, out var dirty))
+                    throw new InvalidOperationException("Failed to decode the first animation frame.");
+
+                return (h, mem, animationInfo, cumulative, ring, dirty);
+            }
+            catch
+            {
+                if (h != IntPtr.Zero) NativeAnimationBridge.CloseAnimation(h);
+                Marshal.FreeHGlobal(mem);
+                throw;
+            }
+        });
+
+        try
+        {
+            return new NativeAnimator(handle, unmanagedMemory, info, cumulativeTime, ringBuffer, firstDirty, canvas);
+        }
+        catch
+        {
+            NativeAnimationBridge.CloseAnimation(handle);
+            Marshal.FreeHGlobal(unmanagedMemory);
+            throw;
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    // Animation update loop
+    // -------------------------------------------------------------------------
+
+    /// <summary>
+    ///     Uploads the decoded frames that are due at <paramref name="totalElapsedTime" /> and
+    ///     queues the decoding of the ones after them. Never waits for a decode.
+    /// </summary>
+    /// <param name="totalElapsedTime">
+    ///     Total time elapsed since the animator was started.
+    ///     Mapped to a position within a single loop cycle via modulo.
+    /// </param>
+    public Task UpdateAsync(TimeSpan totalElapsedTime)
+    {
+        if (_isDisposed || _totalAnimationDuration == TimeSpan.Zero) return Task.CompletedTask;
+
+        long loop = totalElapsedTime.Ticks / _totalAnimationDuration.Ticks;
+        var elapsedInLoop = TimeSpan.FromTicks(totalElapsedTime.Ticks % _totalAnimationDuration.Ticks);
+
+        // BinarySearch on the sorted cumulative end-times returns the insertion point (~idx),
+        // which is the index of the frame that should be showing. On an exact boundary, the
+        // next frame is shown so the elapsed one does not stay up for an extra tick.
+        int lastFrame = _frameCumulativeTime.Length - 1;
+        int idx = Array.BinarySearch(_frameCumulativeTime, elapsedInLoop);
+        int frameIndex = idx >= 0 ? Math.Min(idx + 1, lastFrame) : Math.Min(~idx, lastFrame);
+
+        long target = _timelineOffset + loop * _frameCount + frameIndex;
+        if (target < _shownFrame)
+        {
+            // The clock went back (an explicit restart): play the same frame in a later loop.
+            long loops = (_shownFrame - target) / _frameCount + 1;
+            _timelineOffset += loops * _frameCount;
+            target += loops * _frameCount;
+        }
+        Volatile.Write(ref _targetFrame, target);
+
+        UploadDecodedSlots(target);
+
+        if (Interlocked.CompareExchange(ref _decodeQueued, 1, 0) == 0)
+            ThreadPool.UnsafeQueueUserWorkItem(this, preferLocal: false);
+
+        return Task.CompletedTask;
+    }
+
+    /// <summary>
+    ///     Uploads, in decode order, every decoded slot whose frame is due by <paramref name="target" />.
+    /// </summary>
+    private void UploadDecodedSlots(long target)
+    {
+        long produced = Volatile.Read(ref _produced);
+        while (_consumed < produced)
+        {
+            int slot = (int)(_consumed % SlotCount);
+            if (_slotFrame[slot] > target) break;
+
+            var dirty = _slotDirty[slot];
+            if (dirty.Width > 0 && dirty.Height > 0)
+                _canvasBitmap.SetPixelBytes(_slotBuffers[slot], dirty.X, dirty.Y, dirty.Width, dirty.Height);
+
+            _shownFrame = _slotFrame[slot];
+            Volatile.Write(ref _consumed, _consumed + 1);
+        }
+    }
+
+    /// <summary>
+    ///     Decode pass, run on the thread pool: fills free slots with the frames from the one due
+    ///     up to <see cref="SlotCount" /> - 1 after it. A frame that fails to decode is skipped;
+    ///     the native source starts afresh on the next one.
+    /// </summary>
+    void IThreadPoolWorkItem.Execute()
+    {
+        lock (_decodeLock)
+        {
+            while (!_isDisposed)
+            {
+                long produced = _produced;
+                if (produced - Volatile.Read(ref _consumed) >= SlotCount) break;
+
+                long target = Volatile.Read(ref _targetFrame);
+                long next = Math.Max(_lastDecodedFrame + 1, target);
+                if (next >= target + SlotCount) break;
+
+                int slot = (int)(produced % SlotCount);
+                bool decoded = NativeAnimationBridge.DecodeAnimationFrame(_nativeHandle, (int)(next % _frameCount), in _ring,
+                    slot, out var dirty);
+                _lastDecodedFrame = next;
+                if (!decoded) continue;
+
+                _slotFrame[slot] = next;
+                _slotDirty[slot] = dirty;
+                Volatile.Write(ref _produced, produced + 1);
+            }
+            Volatile.Write(ref _decodeQueued, 0);
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    // IDisposable / finalizer
+    // -------------------------------------------------------------------------
+
+    /// <inheritdoc />
+    public void Dispose()
+    {
+        Dispose(true);
+        GC.SuppressFinalize(this);
+    }
+
+    /// <summary>
+    ///     Releases the native source and file copy always, once any decode pass has stopped, and
+    ///     the Win2D bitmap only when called from <see cref="Dispose()" />: Win2D objects must not
+    ///     be released from the finalizer thread.
+    /// </summary>
+    protected virtual void Dispose(bool disposing)
+    {
+        if (_isDisposed) return;
+        _isDisposed = true;
+
+        lock (_decodeLock)
+        {
+            if (_nativeHandle != IntPtr.Zero)
+            {
+                if (NativeAnimationBridge.GetAnimationStats(_nativeHandle, out var stats))
+                    Debug.WriteLine($"Animation ({_format}): {stats.FramesDecoded} frames decoded, " +
+                                    $"{(stats.CanvasBytes + stats.ScratchBytes) / 1024} KB held natively");
+                NativeAnimationBridge.CloseAnimation(_nativeHandle);
+                _nativeHandle = IntPtr.Zero;
+            }
+
+            if (_unmanagedFileData != IntPtr.Zero)
+            {
+                Marshal.FreeHGlobal(_unmanagedFileData);
+                _unmanagedFileData = IntPtr.Zero;
+            }
+        }
+
+        if (disposing)
+            _canvasBitmap?.Dispose();
+    }
+
+    /// <summary>
+    ///     Finalizer backstop ensuring the native source and file copy are released even if
+    ///     <see cref="Dispose()" /> is never called.
+    /// </summary>
+    ~NativeAnimator()
+    {
+        Dispose(false);
+    }
+}
@@ -189,13 +189,8 @@ internal partial class CanvasController : ICanvasController
                     photo.SupportsTransparency, RequestInvalidate, generateMipChain: false),
                 _imageSize, animDispItem.Rotation, ctx, forceThumbNailRedraw: true);
 
-            // Asynchronously create the appropriate animator (GIF, WebP, APNG, or AVIF).
-            var ext = Path.GetExtension(photo.FilePath);
-            IAnimator newAnimator =
-                string.Equals(ext, ".avif", StringComparison.OrdinalIgnoreCase) ? await AvifAnimator.CreateAsync(animDispItem.FileAsByteArray, _d2dCanvas) :
-                string.Equals(ext, ".gif", StringComparison.OrdinalIgnoreCase) ? await GifAnimator.CreateAsync(animDispItem.FileAsByteArray, _d2dCanvas) :
-                string.Equals(ext, ".webp", StringComparison.OrdinalIgnoreCase) ? await WebpAnimator.CreateAsync(animDispItem.FileAsByteArray, _d2dCanvas) :
-                                                                                  await PngAnimator.CreateAsync(animDispItem.FileAsByteArray, _d2dCanvas);
+            // Asynchronously create the animator; the native side tells GIF, WebP, APNG and AVIF apart.
+            IAnimator newAnimator = await NativeAnimator.CreateAsync(animDispItem.FileAsByteArray, _d2dCanvas);
 
             // RACE CONDITION CHECK: If another SetSource call has started while we were creating the
             // animator, this operation is now obsolete. We should discard the result and clean up.
@@ -233,8 +228,8 @@ internal partial class CanvasController : ICanvasController
     private void HandleHqMultiPageDisplayItem(Photo photo, MultiPageHqDisplayItem multiDispItem, PhotoInstallContext ctx)
     {
         InstallRenderer(
-            new MultiPageRenderer(_d2dCanvas, multiDispItem.FileAsByteArray, 0,
-                photo.SupportsTransparency, RequestInvalidate, multiDispItem.PageOrder),
+            new MultiPageRenderer(_d2dCanvas, multiDispItem.Pages, 0,
+                photo.SupportsTransparency, RequestInvalidate),
             _imageSize, multiDispItem.Rotation, ctx, forceThumbNailRedraw: true);
     }
 
@@ -130,6 +130,16 @@ internal partial class PhotoDisplayController
             if (AppConfig.Volatile.IsSecondaryInstance) return;
 
             _cache.Start();
+
+            // Build or refresh the folder's metadata index off the startup path. Until it is
+            // ready, photos are sized from their headers as the prefetch workers load them.
+            _ = Task.Run(() => FolderMetadataIndex.OpenForSession(selectedFilePath), token);
+
+            // Fill the disk cache for the rest of the folder at background priority, so photos
+            // the sliding window has not reached yet open from the cache too.
+            var folder = Path.GetDirectoryName(selectedFilePath);
+            if (AppConfig.Settings.WarmDiskCache && !string.IsNullOrEmpty(folder))
+                DiskCacherNative.Instance.StartWarmUp(folder, _d2dCanvas);
         }
         catch (Exception ex)
         {
@@ -139,7 +149,7 @@ internal partial class PhotoDisplayController
 
     // --- Cache events & display upgrade ---
 
-    // The cache fires these on a ThreadPool thread when a load completes. The controller decides
+    // The cache fires these on a worker thread when a load completes. The controller decides
     // whether the freshly-loaded key is the one on screen and upgrades the display if so. This is the
     // single place that used to be UpgradeImageIfNeeded + the thumbnail redraw inside the loader.
     private void OnPreviewReady(int key)
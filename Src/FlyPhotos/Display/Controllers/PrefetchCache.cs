@@ -1,11 +1,13 @@
 #nullable enable
 using System;
-using System.Collections.Concurrent;
+using System.Buffers;
 using System.Collections.Generic;
-using System.Threading;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
 using System.Threading.Tasks;
 using FlyPhotos.Core.Model;
 using FlyPhotos.Infra.Configuration;
+using FlyPhotos.Infra.Interop;
 using FlyPhotos.Services;
 using Microsoft.Graphics.Canvas;
 using NLog;
@@ -13,13 +15,18 @@ using NLog;
 namespace FlyPhotos.Display.Controllers;
 
 /// <summary>
-/// Owns all background photo loading: the preview, HQ and disk <b>tiers</b> (each a worker thread
-/// with its own queue, in-flight set and completed-keys set), throttling, the sliding <b>window</b>
+/// Owns all background photo loading: the preview, HQ and disk <b>tiers</b>, the sliding <b>window</b>
 /// of neighbours kept loaded around the <b>window centre</b>, and disk write-back.
 ///
 /// Nothing outside this class ever sees a tier. Callers drive it with <see cref="MoveWindow"/> when
 /// navigation moves and ask it questions with <see cref="IsHqLoaded"/> / <see cref="IsPreviewLoaded"/>;
-/// it announces completions through the ready events. See CONTEXT.md for the vocabulary.
+/// it announces completions through the ready events.
+///
+/// The scheduling lives in a native <c>PrefetchScheduler</c>: one queue ordered by distance from the
+/// centre and direction of travel, one worker pool shared by all tiers, and a memory budget instead of
+/// per-tier counts. HQ bitmaps stay resident after leaving the HQ window, under their own byte budget
+/// and the memory the system can spare, until the largest and stalest are evicted to make room. This
+/// class supplies the loads, the HQ size hints and the disposal through its hooks.
 ///
 /// The class does not own the photo list: it resolves keys to photos through a delegate handed in at
 /// construction, and is told the key snapshot + centre on every <see cref="MoveWindow"/> call.
@@ -28,29 +35,17 @@ internal sealed class PrefetchCache : IDisposable
 {
     private static readonly Logger Logger = LogManager.GetCurrentClassLogger();
 
-    /// <summary>One quality track: its work queue, wake signal, in-flight set and completed-keys set.</summary>
-    private sealed class PhotoCacheTier : IDisposable
-    {
-        public readonly ConcurrentStack<int>            Queue    = new();
-        public readonly AutoResetEvent                  Signal   = new(false);
-        public readonly ConcurrentDictionary<int, byte> InFlight = new();
-        public readonly ConcurrentDictionary<int, byte> Done     = new();
-
-        public void Dispose() => Signal.Dispose();
-    }
-
-    private readonly CancellationTokenSource _cts = new();
-    private readonly SemaphoreSlim _previewThrottler   = new(Environment.ProcessorCount);
-    private readonly SemaphoreSlim _hqThrottler        = new(Environment.ProcessorCount);
-    private readonly SemaphoreSlim _diskCacheThrottler = new(Environment.ProcessorCount);
+    /// <summary>Share of the memory available to the process that loaded photos may hold.</summary>
+    private const long MemoryBudgetDivisor = 4;
+    private const long MinMemoryBudget = 512L * 1024 * 1024;
+    private const long MaxMemoryBudget = 8L * 1024 * 1024 * 1024;
 
-    private readonly PhotoCacheTier       _previewTier     = new();
-    private readonly PhotoCacheTier       _hqTier          = new();
-    private readonly ConcurrentStack<int> _diskCacheQueue  = new();
-    private readonly ManualResetEvent     _diskCacheSignal = new(false);
+    private IntPtr _scheduler;
+    private IntPtr _predictor;
+    private GCHandle _self;
 
-    // Reused across SyncCacheTier calls — only touched on the UI/STA thread (inside MoveWindow).
-    private readonly HashSet<int> _syncKeysToKeep = new();
+    // Set by Dispose. Workers still finishing a load after it drop their result and fire no events.
+    private volatile bool _disposed;
 
     // Bumped (on the UI/STA thread) whenever RAW decode settings change so any RAW HQ decode that was
     // already in flight is discarded on completion instead of committing a stale bitmap.
@@ -61,100 +56,161 @@ internal sealed class PrefetchCache : IDisposable
     private readonly Func<int, Photo?> _getPhoto;
     private readonly ICanvasResourceCreatorWithDpi _device;
 
-    // True while the user is holding a navigation key. The HQ worker re-parks while this is set so it
-    // doesn't decode photos being skipped past. Supplied by the controller (IsContinuousKeyPress).
+    // True while the user is holding a navigation key. HQ loads are held while this is set so photos
+    // being skipped past are not decoded. Supplied by the controller (IsContinuousKeyPress).
     private readonly Func<bool> _isBursting;
 
-    // Latest window pushed in by MoveWindow. Replaces the old reach-ins to PhotoSessionState +
-    // _sortedPhotoKeys. _windowKeys is the full sorted key list; _windowCentre is the position in it.
+    // Latest window pushed in by MoveWindow, kept for the progress string and the RAW invalidation.
+    // _windowKeys is the full sorted key list; _windowCentre is the position in it.
     private volatile IReadOnlyList<int> _windowKeys = Array.Empty<int>();
     private volatile int _windowCentre;
 
-    /// <summary>Fired (on a ThreadPool thread) when a preview bitmap has finished loading for a key.</summary>
+    /// <summary>Fired (on a worker thread) when a preview bitmap has finished loading for a key.</summary>
     public event Action<int>? PreviewReady;
 
-    /// <summary>Fired (on a ThreadPool thread) when an HQ bitmap has finished loading for a key.</summary>
+    /// <summary>Fired (on a worker thread) when an HQ bitmap has finished loading for a key.</summary>
     public event Action<int>? HqReady;
 
     /// <summary>Fired with the formatted "left/total &lt; Cache &gt; right/total" status string.</summary>
     public event Action<string>? CacheStatusChanged;
 
-    public PrefetchCache(Func<int, Photo?> getPhoto,
-                         ICanvasResourceCreatorWithDpi device,
-                         Func<bool> isBursting)
+    public unsafe PrefetchCache(Func<int, Photo?> getPhoto,
+                                ICanvasResourceCreatorWithDpi device,
+                                Func<bool> isBursting)
     {
         _getPhoto = getPhoto;
         _device = device;
         _isBursting = isBursting;
+
+        _self = GCHandle.Alloc(this);
+        var hooks = new PrefetchHooks
+        {
+            Load = &LoadHook,
+            Release = &ReleaseHook,
+            Loaded = &LoadedHook,
+            Context = GCHandle.ToIntPtr(_self)
+        };
+        var available = GC.GetGCMemoryInfo().TotalAvailableMemoryBytes;
+        var options = new PrefetchOptions
+        {
+            Threads = Environment.ProcessorCount,
+            MemoryBudget = (ulong)Math.Clamp(available / MemoryBudgetDivisor, MinMemoryBudget, MaxMemoryBudget),
+            HqBudget = (ulong)Math.Max(0, AppConfig.Settings.HqMemoryBudgetMb) * 1024 * 1024
+        };
+        _scheduler = NativePrefetchBridge.CreatePrefetchScheduler(hooks, options);
+        if (_scheduler == IntPtr.Zero)
+            Logger.Error("PrefetchCache: could not create the native prefetch scheduler.");
+        _predictor = NativeNavigationBridge.CreateNavigationPredictor(
+            AppConfig.Settings.CacheSizeOneSidePreviews, AppConfig.Settings.CacheSizeOneSideHqImages);
     }
 
     // -------------------------------------------------------------------------
     // Public API — the only door in
     // -------------------------------------------------------------------------
 
-    /// <summary>Spawns the three worker threads. Not called for secondary instances.</summary>
-    public void Start()
-    {
-        var previewThread = new Thread(() => PreviewCacheBuilderDoWork(_cts.Token))
-            { IsBackground = true, Name = "PreviewCacheBuilder" };
-        previewThread.Start();
-        var hqThread = new Thread(() => HqImageCacheBuilderDoWork(_cts.Token))
-            { IsBackground = true, Priority = ThreadPriority.AboveNormal, Name = "HqCacheBuilder" };
-        hqThread.Start();
-        var diskThread = new Thread(() => PreviewDiskCacherDoWork(_cts.Token))
-            { IsBackground = true, Name = "DiskCacheBuilder" };
-        diskThread.Start();
-    }
+    /// <summary>Starts the shared worker pool. Not called for secondary instances.</summary>
+    public void Start() => NativePrefetchBridge.StartPrefetchScheduler(_scheduler);
 
     /// <summary>
-    /// Re-centre the window. Disposes photos that fall outside it and queues those inside it that are
-    /// not already loaded or in flight. <paramref name="signalHqLoading"/> mirrors the old
-    /// <c>if (triggerHqCaching) _hqTier.Signal.Set()</c> — it decides whether to kick the HQ worker;
-    /// whether the worker then proceeds is decided separately by the burst predicate.
+    /// Re-centre the window. Disposes previews that fall outside it and anything past the memory
+    /// budgets (retained HQ bitmaps first), and queues those inside it that are not already loaded or
+    /// in flight. HQ loads are held while the user is bursting, unless <paramref name="signalHqLoading"/>
+    /// asks for them (jumps to first, last or by a page).
+    /// <para>
+    /// Each move is also a navigation for the native <c>NavigationPredictor</c>, whose plan leans the
+    /// window into the direction of steady browsing and widens the HQ radius after jumps.
+    /// </para>
     /// </summary>
-    public void MoveWindow(int centrePosition, IReadOnlyList<int> keys, bool signalHqLoading)
+    public unsafe void MoveWindow(int centrePosition, IReadOnlyList<int> keys, bool signalHqLoading)
     {
         _windowKeys   = keys;
         _windowCentre = centrePosition;
 
         if (keys.Count == 0)
         {
-            _hqTier.Done.Clear();
-            _previewTier.Done.Clear();
+            NativePrefetchBridge.MovePrefetchWindow(_scheduler, default, null, 0);
+            NativeNavigationBridge.ResetNavigationPredictor(_predictor);
             FireProgress();
             return;
         }
-        if (centrePosition < 0)
+        if (centrePosition < 0 || centrePosition >= keys.Count)
         {
             Logger.Warn($"MoveWindow: centre {centrePosition} out of range. Skipping cache update.");
             return;
         }
 
-        var desiredHqKeys      = FindNeighborKeys(centrePosition, AppConfig.Settings.CacheSizeOneSideHqImages);
-        var desiredPreviewKeys = FindNeighborKeys(centrePosition, AppConfig.Settings.CacheSizeOneSidePreviews);
-        SyncCacheTier(desiredHqKeys,      _hqTier,      p => p.DisposeHqOnly());
-        SyncCacheTier(desiredPreviewKeys, _previewTier, p => p.DisposePreviewOnly());
+        bool bursting = !signalHqLoading && _isBursting();
+        var window = new PrefetchWindow
+        {
+            Centre = centrePosition,
+            PreviewRadius = AppConfig.Settings.CacheSizeOneSidePreviews,
+            HqRadius = AppConfig.Settings.CacheSizeOneSideHqImages,
+            Burst = bursting ? 1 : 0
+        };
+        ApplyNavigationPlan(ref window, signalHqLoading ? NavigationKind.Jump
+            : bursting ? NavigationKind.Repeat : NavigationKind.Step);
+
+        // The plan may lean the window, so each side reaches as far as its widest tier.
+        int ahead = Math.Max(window.PreviewRadius, window.HqRadius);
+        int behind = window.Direction == 0 ? ahead : Math.Max(window.PreviewBehind, window.HqBehind);
+        window.First = Math.Max(0, centrePosition - (window.Direction > 0 ? behind : ahead));
+        int count = Math.Min(keys.Count - 1, centrePosition + (window.Direction < 0 ? behind : ahead)) - window.First + 1;
+
+        var slice = ArrayPool<int>.Shared.Rent(count);
+        try
+        {
+            for (int i = 0; i < count; i++) slice[i] = keys[window.First + i];
+            fixed (int* p = slice)
+                NativePrefetchBridge.MovePrefetchWindow(_scheduler, window, p, count);
+        }
+        finally
+        {
+            ArrayPool<int>.Shared.Return(slice);
+        }
 
         FireProgress();
-        _previewTier.Signal.Set();
-        if (signalHqLoading) _hqTier.Signal.Set();
     }
 
-    /// <summary>Wake the HQ worker (used by Brake once a burst has ended).</summary>
-    public void SignalHqLoading() => _hqTier.Signal.Set();
+    /// <summary>
+    /// Records the move with the predictor and, if predictive prefetch is on, takes the window's radii,
+    /// direction and behind weight from its plan. The navigation is logged at Trace level in the
+    /// format the replay harness in Misc/native_bench reads.
+    /// </summary>
+    private void ApplyNavigationPlan(ref PrefetchWindow window, NavigationKind kind)
+    {
+        var navigation = new NavigationEvent { TimeMs = Environment.TickCount64, Position = window.Centre, Kind = kind };
+        Logger.Trace($"Navigation {navigation.TimeMs} {navigation.Position} {kind.ToString().ToLowerInvariant()}");
+        if (!NativeNavigationBridge.RecordNavigation(_predictor, navigation, window.PreviewRadius, window.HqRadius,
+                out var plan) || !AppConfig.Settings.PredictivePrefetch)
+            return;
 
-    /// <summary>Mark a key as already HQ-loaded so the cache never re-decodes it (e.g. the first photo).</summary>
-    public void SeedHqLoaded(int key) => _hqTier.Done[key] = 0;
+        window.Direction = plan.Direction;
+        window.PreviewRadius = plan.PreviewAhead;
+        window.PreviewBehind = plan.PreviewBehind;
+        window.HqRadius = plan.HqAhead;
+        window.HqBehind = plan.HqBehind;
+        window.BehindWeight = plan.BehindWeight;
+    }
 
-    /// <summary>Drop a deleted key from the tiers. Does not dispose the Photo — the controller owns that.</summary>
-    public void Evict(int key)
+    /// <summary>End the burst so held HQ loads run (used by Brake once a burst has ended).</summary>
+    public void SignalHqLoading() => NativePrefetchBridge.EndPrefetchBurst(_scheduler);
+
+    /// <summary>Mark a key as already HQ-loaded so the cache never re-decodes it (e.g. the first photo).</summary>
+    public void SeedHqLoaded(int key)
     {
-        _hqTier.Done.TryRemove(key, out _);
-        _previewTier.Done.TryRemove(key, out _);
+        var bytes = _getPhoto(key)?.Hq?.ResidentBytes ?? 0;
+        NativePrefetchBridge.MarkPrefetchLoaded(_scheduler, key, PrefetchTier.Hq, (ulong)bytes);
     }
 
-    public bool IsHqLoaded(int key)      => _hqTier.Done.ContainsKey(key);
-    public bool IsPreviewLoaded(int key) => _previewTier.Done.ContainsKey(key);
+    /// <summary>Drop a deleted key from the tiers. Does not dispose the Photo — the controller owns that.</summary>
+    public void Evict(int key) => NativePrefetchBridge.ForgetPrefetchKey(_scheduler, key);
+
+    public bool IsHqLoaded(int key)      => NativePrefetchBridge.IsPrefetchLoaded(_scheduler, key, PrefetchTier.Hq);
+    public bool IsPreviewLoaded(int key) => NativePrefetchBridge.IsPrefetchLoaded(_scheduler, key, PrefetchTier.Preview);
+
+    /// <summary>Live memory accounting, including the resident HQ bitmaps against their budget.</summary>
+    public PrefetchStats? GetMemoryStats() =>
+        NativePrefetchBridge.GetPrefetchStats(_scheduler, out var stats) ? stats : null;
 
     /// <summary>
     /// Drop every cached RAW-file HQ bitmap so the new decoder settings take effect, and bump the
@@ -165,236 +221,144 @@ internal sealed class PrefetchCache : IDisposable
     {
         _hqGeneration++;
 
-        foreach (int key in _hqTier.Done.Keys)
-            if (_getPhoto(key) is { IsRaw: true } photo)
+        // HQ bitmaps can stay resident anywhere in the list, not only in the HQ window.
+        foreach (int key in _windowKeys)
+        {
+            if (IsHqLoaded(key) && _getPhoto(key) is { IsRaw: true } photo)
             {
                 photo.DisposeHqOnly();
-                _hqTier.Done.TryRemove(key, out _);
+                NativePrefetchBridge.UnloadPrefetch(_scheduler, key, PrefetchTier.Hq);
             }
+        }
 
         // Reuse the window sync to requeue the in-window keys we just dropped.
         MoveWindow(_windowCentre, _windowKeys, signalHqLoading: true);
     }
 
     // -------------------------------------------------------------------------
-    // Worker threads
+    // Scheduler hooks
     // -------------------------------------------------------------------------
 
-    private void PreviewCacheBuilderDoWork(CancellationToken token)
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static long LoadHook(IntPtr context, int key, int tier)
     {
         try
         {
-            while (!token.IsCancellationRequested)
+            if (GCHandle.FromIntPtr(context).Target is not PrefetchCache { _disposed: false } cache)
+                return NativePrefetchBridge.LoadDropped;
+            // The worker thread blocks on the load; it has no synchronisation context to deadlock on.
+            return (PrefetchTier)tier switch
             {
-                if (_previewTier.Queue.IsEmpty)
-                {
-                    // Preview queue is empty — hand off to the disk-cache thread, which writes
-                    // the just-loaded previews (Origin.Disk) to the SQLite thumbnail store.
-                    _diskCacheSignal.Set();
-                    WaitHandle.WaitAny([_previewTier.Signal, token.WaitHandle]);
-                    if (token.IsCancellationRequested) break;
-                    _diskCacheSignal.Reset();
-                }
-
-                if (!_previewTier.Queue.TryPop(out var item)) continue;
-
-                _previewThrottler.Wait(token);
-
-                _ = Task.Run(() => LoadPreviewAsync(item), token);
-            }
+                PrefetchTier.Preview => cache.LoadPreviewAsync(key).GetAwaiter().GetResult(),
+                PrefetchTier.Hq => cache.LoadHqAsync(key).GetAwaiter().GetResult(),
+                _ => cache.DiskCachePreviewAsync(key).GetAwaiter().GetResult()
+            };
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex);
+            return NativePrefetchBridge.LoadDropped;
         }
-        catch (OperationCanceledException) { } // Expected on shutdown.
     }
 
-    private void HqImageCacheBuilderDoWork(CancellationToken token)
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static void ReleaseHook(IntPtr context, int key, int tier)
     {
         try
         {
-            while (!token.IsCancellationRequested)
-            {
-                if (_hqTier.Queue.IsEmpty || _isBursting())
-                {
-                    WaitHandle.WaitAny([_hqTier.Signal, token.WaitHandle]);
-                    if (token.IsCancellationRequested) break;
-                }
-
-                if (!_hqTier.Queue.TryPop(out var item)) continue;
-
-                _hqThrottler.Wait(token);
-
-                _ = Task.Run(() => LoadHqAsync(item), token);
-            }
+            if (GCHandle.FromIntPtr(context).Target is not PrefetchCache cache || cache._getPhoto(key) is not { } photo)
+                return;
+            if ((PrefetchTier)tier == PrefetchTier.Hq) photo.DisposeHqOnly();
+            else photo.DisposePreviewOnly();
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex);
         }
-        catch (OperationCanceledException) { } // Expected on shutdown.
     }
 
-    private void PreviewDiskCacherDoWork(CancellationToken token)
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static void LoadedHook(IntPtr context, int key, int tier)
     {
         try
         {
-            while (!token.IsCancellationRequested)
+            if (GCHandle.FromIntPtr(context).Target is not PrefetchCache { _disposed: false } cache) return;
+            if ((PrefetchTier)tier == PrefetchTier.Hq)
             {
-                WaitHandle.WaitAny([_diskCacheSignal, token.WaitHandle]);
-                if (token.IsCancellationRequested) break;
-
-                if (_diskCacheQueue.IsEmpty)
-                {
-                    _diskCacheSignal.Reset();
-                    continue;
-                }
-
-                if (!_diskCacheQueue.TryPop(out var key)) continue;
-
-                _diskCacheThrottler.Wait(token);
-
-                _ = Task.Run(() => DiskCachePreviewAsync(key), token);
+                cache.HqReady?.Invoke(key);
+                return;
             }
+            cache.PreviewReady?.Invoke(key);
+            cache.FireProgress();
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex);
         }
-        catch (OperationCanceledException) { } // Expected on shutdown.
     }
 
     // -------------------------------------------------------------------------
     // Per-key loaders
     // -------------------------------------------------------------------------
 
-    private async Task LoadPreviewAsync(int key)
+    private async Task<long> LoadPreviewAsync(int key)
     {
-        try
-        {
-            _previewTier.InFlight[key] = 0;
-            if (_getPhoto(key) is not { } photo) return;
-            await photo.LoadPreview(_device);
-            _previewTier.Done[key] = 0;
-            _previewTier.InFlight.Remove(key, out _);
-            if (photo.Preview?.Origin == Origin.Disk) _diskCacheQueue.Push(key);
-            PreviewReady?.Invoke(key);
-            FireProgress();
-        }
-        finally { _previewThrottler.Release(); }
+        if (_getPhoto(key) is not { } photo) return NativePrefetchBridge.LoadDropped;
+        await photo.LoadPreview(_device);
+        // The full size lets the scheduler make room for a large HQ bitmap before decoding it.
+        if (photo.Preview?.Metadata is { FullWidth: > 0, FullHeight: > 0 } metadata)
+            NativePrefetchBridge.SetPrefetchHqSizeHint(_scheduler, key, (ulong)(metadata.FullWidth * metadata.FullHeight * 4));
+        if (photo.Preview?.Origin == Origin.Disk) NativePrefetchBridge.QueuePrefetchDiskWrite(_scheduler, key);
+        return photo.Preview?.ResidentBytes ?? 0;
     }
 
-    private async Task LoadHqAsync(int key)
+    private async Task<long> LoadHqAsync(int key)
     {
-        try
-        {
-            _hqTier.InFlight[key] = 0;
-            int gen = _hqGeneration;
-            if (_getPhoto(key) is not { } photo) return;
-            await photo.LoadHq(_device);
-            if (DiscardedStaleRawDecode(key, photo, gen)) return;
-            _hqTier.Done[key] = 0;
-            _hqTier.InFlight.Remove(key, out _);
-            HqReady?.Invoke(key);
-        }
-        finally { _hqThrottler.Release(); }
+        int gen = _hqGeneration;
+        if (_getPhoto(key) is not { } photo) return NativePrefetchBridge.LoadDropped;
+        await photo.LoadHq(_device);
+        if (DiscardedStaleRawDecode(photo, gen)) return NativePrefetchBridge.LoadRetry;
+        return photo.Hq?.ResidentBytes ?? 0;
     }
 
     /// <summary>
     /// If RAW decode settings changed while this RAW HQ decode was in flight, the bitmap used the old
-    /// settings. Discards it (and requeues the key if still in the HQ window) and returns true, so the
-    /// caller skips committing the stale result. Returns false for the normal case.
+    /// settings. Discards it and returns true, so the scheduler loads the key again if it is still in
+    /// the HQ window. Returns false for the normal case.
     /// </summary>
-    private bool DiscardedStaleRawDecode(int key, Photo photo, int gen)
+    private bool DiscardedStaleRawDecode(Photo photo, int gen)
     {
         if (gen == _hqGeneration || !photo.IsRaw) return false;
-
         photo.DisposeHqOnly();
-        _hqTier.InFlight.Remove(key, out _);
-        if (IsInDesiredHqWindow(key))
-        {
-            _hqTier.Queue.Push(key);
-            _hqTier.Signal.Set();
-        }
         return true;
     }
 
-    private async Task DiskCachePreviewAsync(int key)
+    private async Task<long> DiskCachePreviewAsync(int key)
     {
-        try
+        if (IsPreviewLoaded(key) &&
+            _getPhoto(key) is { Preview.Origin: Origin.Disk } image)
         {
-            if (_previewTier.Done.ContainsKey(key) &&
-                _getPhoto(key) is { Preview.Origin: Origin.Disk } image)
-            {
-                var (actualWidth, actualHeight) = image.GetActualSize();
-                await DiskCacherWithSqlite.Instance.PutInCache(image.FilePath, image.Preview.Bitmap,
-                    (int)Math.Round(actualWidth), (int)Math.Round(actualHeight), image.Preview.Rotation);
-            }
+            var (actualWidth, actualHeight) = image.GetActualSize();
+            await DiskCacherNative.Instance.PutInCache(image.FilePath, image.Preview.Bitmap,
+                (int)Math.Round(actualWidth), (int)Math.Round(actualHeight), image.Preview.Rotation);
         }
-        finally { _diskCacheThrottler.Release(); }
+        return 0;
     }
 
     // -------------------------------------------------------------------------
-    // Window maintenance
+    // Progress
     // -------------------------------------------------------------------------
 
-    private void SyncCacheTier(List<int> desiredKeys, PhotoCacheTier tier, Action<Photo> disposeAction)
-    {
-        _syncKeysToKeep.Clear();
-        _syncKeysToKeep.UnionWith(desiredKeys);
-
-        foreach (int key in tier.Done.Keys)
-            if (!_syncKeysToKeep.Contains(key))
-            {
-                if (_getPhoto(key) is { } photo)
-                    disposeAction(photo);
-                tier.Done.TryRemove(key, out _);
-            }
-
-        tier.Queue.Clear();
-        foreach (int key in desiredKeys)
-            if (!tier.Done.ContainsKey(key) && !tier.InFlight.ContainsKey(key))
-                tier.Queue.Push(key);
-    }
-
-    // Membership test for the HQ window. Called from a ThreadPool thread (the stale-RAW-decode discard
-    // path), so it snapshots the copy-on-write key list and centre once and scans only that snapshot —
-    // never re-reading the shared fields or indexing a list that may have been swapped underneath it.
-    private bool IsInDesiredHqWindow(int key)
-    {
-        var keys = _windowKeys;
-        int centre = _windowCentre;
-        if (centre < 0 || centre >= keys.Count) return false;
-        int side = AppConfig.Settings.CacheSizeOneSideHqImages;
-        int lo = Math.Max(0, centre - side);
-        int hi = Math.Min(keys.Count - 1, centre + side);
-        for (int pos = lo; pos <= hi; pos++)
-            if (keys[pos] == key) return true;
-        return false;
-    }
-
-    private List<int> FindNeighborKeys(int currentPosition, int cacheSizeOneSide)
-    {
-        var keys = _windowKeys;
-        var desiredKeys = new List<int>(cacheSizeOneSide * 2 + 1);
-        for (int i = cacheSizeOneSide; i >= 1; i--)
-        {
-            int nextPos = currentPosition + i;
-            if (nextPos < keys.Count)
-                desiredKeys.Add(keys[nextPos]);
-
-            int prevPos = currentPosition - i;
-            if (prevPos >= 0)
-                desiredKeys.Add(keys[prevPos]);
-        }
-        desiredKeys.Add(keys[currentPosition]);
-        return desiredKeys;
-    }
-
     private void FireProgress()
     {
         var keys = _windowKeys;
         int centre = _windowCentre;
-        if (centre < 0 || keys.Count == 0) return;
+        if (centre < 0 || centre >= keys.Count) return;
         int currentKey = keys[centre];
         int noOfFilesOnLeft = centre;
         int noOfFilesOnRight = keys.Count - 1 - centre;
-        int noOfCachedItemsOnLeft = 0;
-        int noOfCachedItemsOnRight = 0;
-        foreach (int key in _previewTier.Done.Keys)
-        {
-            if (key < currentKey) noOfCachedItemsOnLeft++;
-            else if (key > currentKey) noOfCachedItemsOnRight++;
-        }
+        NativePrefetchBridge.CountPrefetchLoaded(_scheduler, PrefetchTier.Preview, currentKey,
+            out int noOfCachedItemsOnLeft, out int noOfCachedItemsOnRight);
         CacheStatusChanged?.Invoke($"{noOfCachedItemsOnLeft}/{noOfFilesOnLeft} < Cache > {noOfCachedItemsOnRight}/{noOfFilesOnRight}");
     }
 
@@ -404,18 +368,33 @@ internal sealed class PrefetchCache : IDisposable
 
     public void Dispose()
     {
-        _cts.Cancel();
-        _previewTier.Signal.Set();
-        _hqTier.Signal.Set();
-        _diskCacheSignal.Set();
-
-        _cts.Dispose();
-        _previewThrottler.Dispose();
-        _hqThrottler.Dispose();
-        _diskCacheThrottler.Dispose();
-
-        _previewTier.Dispose();
-        _hqTier.Dispose();
-        _diskCacheSignal.Dispose();
+        if (_disposed) return;
+        _disposed = true;
+
+        // Called on the UI thread at window close, where a worker may be blocked in a long decode.
+        // Queued loads are cancelled here; joining the workers and freeing the scheduler happen on
+        // the thread pool, and the GCHandle the hooks resolve stays allocated until they have exited.
+        var scheduler = _scheduler;
+        var self = _self;
+        _scheduler = IntPtr.Zero;
+        _self = default;
+        if (scheduler != IntPtr.Zero)
+        {
+            NativePrefetchBridge.CancelPrefetchScheduler(scheduler);
+            Task.Run(() =>
+            {
+                NativePrefetchBridge.DestroyPrefetchScheduler(scheduler);
+                if (self.IsAllocated) self.Free();
+            });
+        }
+        else if (self.IsAllocated)
+        {
+            self.Free();
+        }
+        if (_predictor != IntPtr.Zero)
+        {
+            NativeNavigationBridge.DestroyNavigationPredictor(_predictor);
+            _predictor = IntPtr.Zero;
+        }
     }
 }
@@ -1,8 +1,8 @@
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.Threading;
 using Windows.Foundation;
-using Windows.Graphics.DirectX;
 using Windows.UI;
 using FlyPhotos.Core;
 using FlyPhotos.Core.Model;
@@ -48,6 +48,8 @@ internal partial class ThumbNailController : IThumbnailController
     // W2D-owned: created/used/disposed only on the W2D thread (build + draw + CreateResources).
     private CanvasRenderTarget _thumbnailOffscreen;
     private CanvasBitmap _loadingIndicatorBitmap;
+    private ThumbnailAtlas _atlas;
+    private Rect?[] _slotSources = [];
 
     private static readonly TimeSpan ThrottleInterval = TimeSpan.FromMilliseconds(150);
     private readonly DispatcherTimer _throttledRedrawTimer = new() { Interval = ThrottleInterval };
@@ -108,9 +110,8 @@ internal partial class ThumbNailController : IThumbnailController
         RequestRebuild();
     }
 
-    // Device (re)created (first load or device loss). Drop the device-bound surfaces so they rebuild.
-    // Cached photo.Thumbnail.Bitmap objects belong to the old device and are NOT cleared here — the same
-    // accepted device-loss risk the main canvas carries. Runs on the W2D thread.
+    // Device (re)created (first load or device loss). Drop the device-bound surfaces so they rebuild;
+    // the atlas goes too, since its texture belongs to the old device. Runs on the W2D thread.
     private void D2dCanvasThumbNail_CreateResources(CanvasAnimatedControl sender,
         Microsoft.Graphics.Canvas.UI.CanvasCreateResourcesEventArgs args)
     {
@@ -118,6 +119,8 @@ internal partial class ThumbNailController : IThumbnailController
         _thumbnailOffscreen = null;
         _loadingIndicatorBitmap?.Dispose();
         _loadingIndicatorBitmap = null;
+        _atlas?.Dispose();
+        _atlas = null;
         RequestRebuild();
     }
 
@@ -381,6 +384,10 @@ internal partial class ThumbNailController : IThumbnailController
             _thumbnailOffscreen = new CanvasRenderTarget(sender, offscreenWidth, _thumbnailBoxSize);
         }
 
+        // Render the visible boxes plus the slide margin on each side so a lagging slide shows no gap.
+        var renderHalfCount = _numOfThumbNailsInOneDirection + Constants.ThumbnailSlideMarginBoxes;
+        var atlasTexture = UpdateAtlas(sender, keys, currentPosition, renderHalfCount);
+
         using (var dsThumbNail = _thumbnailOffscreen.CreateDrawingSession())
         {
             dsThumbNail.Clear(Colors.Transparent);
@@ -388,12 +395,10 @@ internal partial class ThumbNailController : IThumbnailController
             // Center thumbnail sits at the canvas center, offset by the margin baked into the wider surface.
             var startX = _offscreenMarginPx + (int)canvasWidth / 2 - _thumbnailBoxSize / 2;
 
-            // Render the visible boxes plus the slide margin on each side so a lagging slide shows no gap.
             // The selection border is NOT baked here — it is drawn as a fixed frame in D2dCanvasThumbNail_Draw,
             // so it stays put while the strip slides beneath it.
-            var renderHalfCount = _numOfThumbNailsInOneDirection + Constants.ThumbnailSlideMarginBoxes;
             for (var i = -renderHalfCount; i <= renderHalfCount; i++)
-                DrawThumbnailSlot(dsThumbNail, sender, startX, i, keys, currentPosition);
+                DrawThumbnailSlot(dsThumbNail, sender, atlasTexture, startX, i, keys, currentPosition);
         }
 
         // The strip is now centered on currentPosition. If the position changed since the last render,
@@ -428,31 +433,62 @@ internal partial class ThumbNailController : IThumbnailController
         return _loadingIndicatorBitmap;
     }
 
-    private static CanvasBitmap EnsureThumbnailBitmap(Photo photo, ICanvasResourceCreator creator)
+    /// <summary>
+    /// Makes sure every photo in the rendered range has an atlas slot, recording each slot's source
+    /// rectangle in <see cref="_slotSources"/>, then uploads the slots that changed. Thumbnails already
+    /// in the atlas cost a lookup; only new arrivals are scaled and uploaded. Runs before the drawing
+    /// session opens so the texture is not written while it is being drawn from. W2D thread.
+    /// </summary>
+    private CanvasBitmap UpdateAtlas(ICanvasResourceCreatorWithDpi creator, IReadOnlyList<int> keys, int currentPosition,
+        int renderHalfCount)
     {
-        if (photo.Thumbnail == null) return null;
-        if (photo.Thumbnail.Bitmap != null) return photo.Thumbnail.Bitmap;
+        // Slots hold the box in physical pixels (its DIP size times the display scale) so they are not
+        // magnified when drawn; the atlas is rebuilt when the box size or the DPI changes. Twice the
+        // rendered range leaves room for photos that just scrolled out to come back without being rescaled.
+        var slotSize = creator.ConvertDipsToPixels(_thumbnailBoxSize - 2 * Constants.ThumbnailPadding,
+            CanvasDpiRounding.Round);
+        var slotCount = 2 * renderHalfCount + 1;
+        if (_atlas == null || _atlas.SlotSize != slotSize || _atlas.Capacity < 2 * slotCount)
+        {
+            _atlas?.Dispose();
+            _atlas = ThumbnailAtlas.Create(slotSize, 2 * slotCount);
+        }
+
+        if (_slotSources.Length != slotCount) _slotSources = new Rect?[slotCount];
+        for (var i = -renderHalfCount; i <= renderHalfCount; i++)
+        {
+            Rect? source = null;
+            var position = currentPosition + i;
+            if (_atlas != null && position >= 0 && position < keys.Count)
+            {
+                var key = keys[position];
+                var photo = _isPreviewLoaded?.Invoke(key) == true ? _provider?.GetPhoto(key) : null;
+                if (photo?.Thumbnail is { } thumbnail && _atlas.TryGetSlot(thumbnail, out var rect))
+                    source = rect;
+            }
+            _slotSources[i + renderHalfCount] = source;
+        }
+
         try
         {
-            int s = Constants.ThumbnailPixelBufferSize;
-            photo.Thumbnail.Bitmap = CanvasBitmap.CreateFromBytes(creator,
-                photo.Thumbnail.Pixels, s, s, DirectXPixelFormat.B8G8R8A8UIntNormalized);
+            return _atlas?.Upload(creator);
+        }
+        catch (Exception ex)
+        {
+            Debug.WriteLine($"[ATLAS-ERROR] Thumbnail atlas upload failed: {ex.Message}");
+            return null;
         }
-        catch { }
-        return photo.Thumbnail.Bitmap;
     }
 
-    private void DrawThumbnailSlot(CanvasDrawingSession ds, ICanvasResourceCreator creator,
+    private void DrawThumbnailSlot(CanvasDrawingSession ds, ICanvasResourceCreator creator, CanvasBitmap atlasTexture,
         int startX, int slotIndex, IReadOnlyList<int> keys, int currentPosition)
     {
         var thumbnailPosition = currentPosition + slotIndex;
         if (thumbnailPosition < 0 || thumbnailPosition >= keys.Count) return;
 
-        var key = keys[thumbnailPosition];
-        var photo = _isPreviewLoaded?.Invoke(key) == true ? _provider?.GetPhoto(key) : null;
-
-        var bitmap = (photo != null ? EnsureThumbnailBitmap(photo, creator) : null)
-                     ?? GetOrCreateLoadingIndicatorBitmap(creator);
+        // Photos without a thumbnail yet (or no atlas) show the loading indicator.
+        var source = atlasTexture != null ? _slotSources[slotIndex + _slotSources.Length / 2] : null;
+        var bitmap = source != null ? atlasTexture : GetOrCreateLoadingIndicatorBitmap(creator);
         if (bitmap == null) return;
 
         var destX = startX + slotIndex * _thumbnailBoxSize;
@@ -461,12 +497,15 @@ internal partial class ThumbNailController : IThumbnailController
             Constants.ThumbnailPadding,
             _thumbnailBoxSize - (Constants.ThumbnailPadding * 2),
             _thumbnailBoxSize - (Constants.ThumbnailPadding * 2));
-        var srcRect = new Rect(0, 0, bitmap.SizeInPixels.Width, bitmap.SizeInPixels.Height);
+        var srcRect = source ?? new Rect(0, 0, bitmap.SizeInPixels.Width, bitmap.SizeInPixels.Height);
 
         using var clip = CanvasGeometry.CreateRoundedRectangle(ds, destRect,
             Constants.ThumbnailCornerRadius, Constants.ThumbnailCornerRadius);
         using var layer = ds.CreateLayer(1.0f, clip);
-        ds.DrawImage(bitmap, destRect, srcRect, 1f, CanvasImageInterpolation.HighQualityCubic);
+        // Atlas slots are already the box's size in pixels, so Linear only absorbs the rounding of the
+        // slot size and any sub-pixel offset of the box at fractional scales.
+        ds.DrawImage(bitmap, destRect, srcRect, 1f,
+            source != null ? CanvasImageInterpolation.Linear : CanvasImageInterpolation.HighQualityCubic);
     }
 
     // --- Threading helpers ---
@@ -512,6 +551,8 @@ internal partial class ThumbNailController : IThumbnailController
         _thumbnailOffscreen = null;
         _loadingIndicatorBitmap?.Dispose();
         _loadingIndicatorBitmap = null;
+        _atlas?.Dispose();
+        _atlas = null;
         ThumbnailClicked = null;
         _provider = null;
         _isPreviewLoaded = null;
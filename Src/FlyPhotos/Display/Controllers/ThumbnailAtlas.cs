@@ -0,0 +1,160 @@
+#nullable enable
+using System;
+using System.Buffers;
+using System.Diagnostics;
+using System.Runtime.InteropServices.WindowsRuntime;
+using FlyPhotos.Core;
+using FlyPhotos.Core.Model;
+using FlyPhotos.Infra.Interop;
+using Microsoft.Graphics.Canvas;
+using Windows.Foundation;
+using Windows.Graphics.DirectX;
+
+namespace FlyPhotos.Display.Controllers;
+
+/// <summary>
+/// The thumbnail strip's texture atlas: every visible thumbnail, already scaled to the size it
+/// is drawn at, in one <see cref="CanvasBitmap" />. The pixels and the slot bookkeeping live in a
+/// native <c>ThumbnailAtlas</c>; this class mirrors them into the texture.
+/// <para>
+/// A thumbnail is scaled once, when it first needs a slot. Slots are reused least recently used
+/// first, so sliding through a large folder recycles the slots of photos that scrolled away, and
+/// <see cref="Upload" /> sends only the slots that changed since the last upload instead of the
+/// whole strip.
+/// </para>
+/// <para>W2D thread only, like everything else the strip renders with.</para>
+/// </summary>
+internal sealed partial class ThumbnailAtlas : IDisposable
+{
+    /// <summary>Slots per atlas row.</summary>
+    private const int Columns = 16;
+
+    /// <summary>Dirty rectangles fetched per upload; more than this uploads the whole atlas.</summary>
+    private const int MaxDirtyRects = 64;
+
+    private IntPtr _handle;
+    private CanvasBitmap? _texture;
+
+    /// <summary>Edge of a slot in pixels.</summary>
+    public int SlotSize { get; }
+
+    /// <summary>Number of slots.</summary>
+    public int Capacity { get; }
+
+    private ThumbnailAtlas(IntPtr handle, int slotSize, int capacity)
+    {
+        _handle = handle;
+        SlotSize = slotSize;
+        Capacity = capacity;
+    }
+
+    /// <summary>
+    /// Creates an atlas of at least <paramref name="capacity" /> slots of <paramref name="slotSize" />
+    /// pixels, or returns null if the native atlas cannot be created.
+    /// </summary>
+    public static ThumbnailAtlas? Create(int slotSize, int capacity)
+    {
+        var rows = (capacity + Columns - 1) / Columns;
+        var handle = NativeThumbnailAtlasBridge.CreateThumbnailAtlas(slotSize, Columns, rows);
+        if (handle == IntPtr.Zero)
+        {
+            Debug.WriteLine($"[ATLAS-ERROR] Could not create a {Columns}x{rows} atlas of {slotSize} px slots.");
+            return null;
+        }
+        return new ThumbnailAtlas(handle, slotSize, Columns * rows);
+    }
+
+    /// <summary>
+    /// Finds the slot of <paramref name="thumbnail" />, inserting it (scaled to <see cref="SlotSize" />)
+    /// if it is not in the atlas yet.
+    /// </summary>
+    /// <param name="thumbnail">The photo's thumbnail: BGRA pixels, or BC blocks from the disk cache.</param>
+    /// <param name="source">Receives the slot's rectangle in the texture.</param>
+    /// <returns>False if the thumbnail could not be inserted.</returns>
+    public unsafe bool TryGetSlot(Thumbnail thumbnail, out Rect source)
+    {
+        source = default;
+        var key = (ulong)thumbnail.Id;
+        var slot = NativeThumbnailAtlasBridge.FindAtlasSlot(_handle, key);
+        if (slot < 0)
+        {
+            var size = Constants.ThumbnailPixelBufferSize;
+            fixed (byte* p = thumbnail.Pixels)
+            {
+                slot = thumbnail.Format switch
+                {
+                    DirectXPixelFormat.BC1UIntNormalized => NativeThumbnailAtlasBridge.InsertAtlasBlocks(_handle, key,
+                        BlockPreviewHeader.FormatBc1, p, (uint)thumbnail.Pixels.Length, size, size),
+                    DirectXPixelFormat.BC3UIntNormalized => NativeThumbnailAtlasBridge.InsertAtlasBlocks(_handle, key,
+                        BlockPreviewHeader.FormatBc3, p, (uint)thumbnail.Pixels.Length, size, size),
+                    _ => NativeThumbnailAtlasBridge.InsertAtlasPixels(_handle, key, p, size, size, size * 4)
+                };
+            }
+            if (slot < 0) return false;
+        }
+        if (!NativeThumbnailAtlasBridge.GetAtlasSlotRect(_handle, slot, out var rect)) return false;
+        source = new Rect(rect.X, rect.Y, rect.Width, rect.Height);
+        return true;
+    }
+
+    /// <summary>
+    /// Brings the texture up to date with the native pixels and returns it. The first call
+    /// creates the texture from the whole atlas; later calls upload only the changed rectangles.
+    /// </summary>
+    public unsafe CanvasBitmap Upload(ICanvasResourceCreator resourceCreator)
+    {
+        var rects = stackalloc AtlasRect[MaxDirtyRects];
+        var count = NativeThumbnailAtlasBridge.TakeAtlasDirtyRects(_handle, rects, MaxDirtyRects);
+
+        if (_texture == null)
+        {
+            var full = new AtlasRect { X = 0, Y = 0, Width = Columns * SlotSize, Height = Capacity / Columns * SlotSize };
+            var pixels = CopyRect(full, out var size);
+            try
+            {
+                _texture = CanvasBitmap.CreateFromBytes(resourceCreator, pixels.AsBuffer(0, size),
+                    full.Width, full.Height, DirectXPixelFormat.B8G8R8A8UIntNormalized);
+            }
+            finally
+            {
+                ArrayPool<byte>.Shared.Return(pixels);
+            }
+            return _texture;
+        }
+
+        for (var i = 0; i < count; i++)
+        {
+            var pixels = CopyRect(rects[i], out var size);
+            try
+            {
+                _texture.SetPixelBytes(pixels.AsBuffer(0, size), rects[i].X, rects[i].Y, rects[i].Width, rects[i].Height);
+            }
+            finally
+            {
+                ArrayPool<byte>.Shared.Return(pixels);
+            }
+        }
+        return _texture;
+    }
+
+    /// <summary>Copies a rectangle of the native atlas into a pooled buffer the caller must return.</summary>
+    private unsafe byte[] CopyRect(in AtlasRect rect, out int size)
+    {
+        size = rect.Width * rect.Height * 4;
+        var buffer = ArrayPool<byte>.Shared.Rent(size);
+        fixed (byte* p = buffer)
+        {
+            NativeThumbnailAtlasBridge.CopyAtlasRect(_handle, rect, p, (uint)size);
+        }
+        return buffer;
+    }
+
+    public void Dispose()
+    {
+        _texture?.Dispose();
+        _texture = null;
+        if (_handle == IntPtr.Zero) return;
+        NativeThumbnailAtlasBridge.DestroyThumbnailAtlas(_handle);
+        _handle = IntPtr.Zero;
+    }
+}
@@ -3,7 +3,10 @@ using System;
 using System.Linq;
 using System.Threading.Tasks;
 using Windows.Graphics.Imaging;
+using Windows.Graphics.DirectX;
 using FlyPhotos.Core.Model;
+using FlyPhotos.Display.ImageRendering;
+using FlyPhotos.Infra.Interop;
 using Microsoft.Graphics.Canvas;
 using NLog;
 using FlyPhotos.Services;
@@ -12,19 +15,30 @@ using FlyPhotos.Services;
 namespace FlyPhotos.Display.ImageReading;
 
 /// <summary>
-/// A reader specifically for .ICO files to correctly handle their multi-frame nature.
+/// A reader specifically for .ICO and .CUR files to correctly handle their multi-frame nature.
 /// A multi-frame icon is presented like a multi-page TIFF, with the frames ordered by decreasing
 /// resolution, so the highest-resolution frame is what shows first. Previews stay single-frame.
+/// <para>
+/// The native parser in FlyNativeLibHeif (see <see cref="NativeIcoBridge" />) reads the directory
+/// and the entry headers only, picks the entry to show and decodes just that one, DIB or PNG; the
+/// other pages are decoded when they are paged to. Icons with an entry it cannot decode go through
+/// WIC, which decodes every frame up front to sort them.
+/// </para>
 /// </summary>
 internal static class IcoReader
 {
     private static readonly Logger Logger = LogManager.GetCurrentClassLogger();
 
+    /// <summary>Longer side the preview entry should cover; matches <see cref="WicReader" />'s resized previews.</summary>
+    private const int PreviewDimension = 800;
+
     /// <summary>
-    /// Gets the highest-resolution image from an ICO file for preview purposes.
+    /// Gets a preview from an ICO file: the smallest entry that covers the preview size, or the
+    /// largest if none does.
     /// </summary>
     public static async Task<(bool, PreviewDisplayItem)> GetPreview(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
     {
+        if (await GetPreviewNative(ctrl, inputPath) is (true, { } preview)) return (true, preview);
         try
         {
             using var stream = await StorageOps.GetWin2DPerformantStream(inputPath);
@@ -48,6 +62,7 @@ internal static class IcoReader
     /// </summary>
     public static async Task<(bool, HqDisplayItem)> GetHq(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
     {
+        if (await GetHqNative(ctrl, inputPath) is (true, { } hq)) return (true, hq);
         try
         {
             using var stream = await StorageOps.GetWin2DPerformantStream(inputPath);
@@ -63,7 +78,7 @@ internal static class IcoReader
             // remaining frames on demand from them.
             stream.Seek(0);
             var bytes = await StorageOps.GetInMemByteArray(stream);
-            return (true, new MultiPageHqDisplayItem(bitmap, Origin.Disk, bytes, order));
+            return (true, new MultiPageHqDisplayItem(bitmap, Origin.Disk, new WicPageSource(bytes, order)));
         }
         catch (Exception ex)
         {
@@ -72,6 +87,90 @@ internal static class IcoReader
         }
     }
 
+    private static async Task<(bool, PreviewDisplayItem)> GetPreviewNative(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
+    {
+        try
+        {
+            // The first entry is the largest, which gives the size the HQ image will have.
+            var entries = ReadEntries(inputPath, PreviewDimension, 1, out var info);
+            if (entries == null)
+                return (false, PreviewDisplayItem.Empty());
+
+            var bitmap = await DecodeEntryAsync(ctrl, inputPath, info.Selected, info.Width, info.Height);
+            if (bitmap == null)
+                return (false, PreviewDisplayItem.Empty());
+            var metadata = new ImageMetadata(entries[0].Width, entries[0].Height);
+            return (true, new PreviewDisplayItem(bitmap, Origin.Disk, metadata));
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, "IcoReader - native GetPreview failed for {0}", inputPath);
+            return (false, PreviewDisplayItem.Empty());
+        }
+    }
+
+    private static async Task<(bool, HqDisplayItem)> GetHqNative(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
+    {
+        try
+        {
+            var entries = ReadEntries(inputPath, 0, int.MaxValue, out _);
+            if (entries == null || Array.Exists(entries, e => e.CanDecode == 0))
+                return (false, HqDisplayItem.Empty());
+
+            var bitmap = await DecodeEntryAsync(ctrl, inputPath, entries[0].Index, entries[0].Width, entries[0].Height);
+            if (bitmap == null)
+                return (false, HqDisplayItem.Empty());
+
+            if (entries.Length <= 1) return (true, new StaticHqDisplayItem(bitmap, Origin.Disk));
+            return (true, new MultiPageHqDisplayItem(bitmap, Origin.Disk, new NativeIcoPageSource(inputPath, entries)));
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, "IcoReader - native GetHq failed for {0}", inputPath);
+            return (false, HqDisplayItem.Empty());
+        }
+    }
+
+    /// <summary>
+    /// Up to <paramref name="maxEntries" /> directory entries, largest first, or null if the file is
+    /// not an icon the native parser can read.
+    /// </summary>
+    private static unsafe IcoEntry[]? ReadEntries(string path, int size, int maxEntries, out IcoInfo info)
+    {
+        var entries = new IcoEntry[Math.Min(maxEntries, 16)];
+        fixed (IcoEntry* p = entries)
+            if (!NativeIcoBridge.ReadIcoInfo(path, size, out info, p, entries.Length))
+                return null;
+        if (info.EntryCount <= entries.Length || entries.Length == maxEntries)
+            return entries.AsSpan(0, Math.Min(info.EntryCount, entries.Length)).ToArray();
+
+        // More entries than the first guess; the directory is read again, which is a few pages.
+        entries = new IcoEntry[Math.Min(maxEntries, info.EntryCount)];
+        fixed (IcoEntry* p = entries)
+            if (!NativeIcoBridge.ReadIcoInfo(path, size, out info, p, entries.Length))
+                return null;
+        return entries;
+    }
+
+    private static async Task<CanvasBitmap?> DecodeEntryAsync(ICanvasResourceCreatorWithDpi ctrl, string path, int index, int width, int height)
+    {
+        var pixels = GC.AllocateUninitializedArray<byte>(width * height * 4);
+        var result = await Task.Run(() => Decode(path, index, pixels));
+        if (result != HeifError.Ok)
+        {
+            Logger.Warn($"Native ICO decode of entry {index} failed with {result}: {path}");
+            return null;
+        }
+        return CanvasBitmap.CreateFromBytes(ctrl, pixels, width, height,
+            DirectXPixelFormat.B8G8R8A8UIntNormalized); // Premultiplied BGRA from the native decoder
+    }
+
+    private static unsafe HeifError Decode(string path, int index, byte[] pixels)
+    {
+        fixed (byte* p = pixels)
+            return NativeIcoBridge.DecodeIcoEntry(path, index, p, (ulong)pixels.Length);
+    }
+
     /// <summary>
     /// Frame indices sorted by decreasing pixel area. Well-formed icons are already stored largest-first,
     /// so this is usually a no-op; it earns its place on icons built by merging two icon groups, whose
@@ -107,7 +206,7 @@ internal static class IcoReader
             pixelProvider.DetachPixelData(),
             (int)frame.PixelWidth,
             (int)frame.PixelHeight,
-            Windows.Graphics.DirectX.DirectXPixelFormat.B8G8R8A8UIntNormalized);
+            DirectXPixelFormat.B8G8R8A8UIntNormalized);
 
         return (canvasBitmap, (int)frame.PixelWidth, (int)frame.PixelHeight);
     }
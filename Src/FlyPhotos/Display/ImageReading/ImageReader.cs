@@ -1,11 +1,14 @@
 using System;
 using System.IO;
+using System.Runtime.InteropServices;
 using System.Threading.Tasks;
 using FlyPhotos.Core.Model;
 using FlyPhotos.Infra.Configuration;
+using FlyPhotos.Infra.Interop;
 using FlyPhotos.Services;
 using Microsoft.Graphics.Canvas;
 using NLog;
+using Windows.Graphics.DirectX;
 
 namespace FlyPhotos.Display.ImageReading;
 
@@ -24,8 +27,15 @@ internal static class ImageReader
     public static void Initialize(ICanvasResourceCreatorWithDpi d2dCanvas)
     {
         _indicators = new IndicatorFactory(d2dCanvas);
+        NativeHeifApi.Initialize();
     }
 
+    /// <summary>
+    /// How long the first preview waits for the native startup load to finish before loading the
+    /// photo itself. The load started before the window was created, so it is usually done.
+    /// </summary>
+    private const uint StartupPreviewTimeoutMs = 1000;
+
     /// <summary>
     /// Loads the best available display item for the first frame of an image, using format-specific
     /// fast paths (embedded thumbnails, native decoders) before falling back to heavier decoders. 
@@ -35,16 +45,19 @@ internal static class ImageReader
     {
         try
         {
+            if (await GetStartupPreviewAsync(d2dCanvas, path) is { } startupPreview)
+                return startupPreview;
+
             if (!File.Exists(path))
                 return new StaticHqDisplayItem(_indicators.FileNotFound, Origin.ErrorScreen);
 
             if (!AppConfig.Settings.OpenExitZoom)
             {
-                var (cachedBmp, actualWidth, actualHeight) = await DiskCacherWithSqlite.Instance.ReturnFromCache(d2dCanvas, path);
+                var (cachedBmp, actualWidth, actualHeight, cachedThumbnail) = await DiskCacherNative.Instance.ReturnFromCache(d2dCanvas, path);
                 if (null != cachedBmp)
                 {
                     var metadata = new ImageMetadata(actualWidth, actualHeight);
-                    return new PreviewDisplayItem(cachedBmp, Origin.DiskCache, metadata);
+                    return new PreviewDisplayItem(cachedBmp, Origin.DiskCache, metadata) { CachedThumbnail = cachedThumbnail };
                 }
             }
 
@@ -55,9 +68,12 @@ internal static class ImageReader
                 case ".HEIF":
                 case ".HIF":
                     {
-                        if (!AppConfig.Settings.OpenExitZoom)
-                            if (NativeHeifReader.GetEmbedded(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
-                        if (NativeHeifReader.GetHq(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
+                        if (NativeHeifApi.CanDecode(extension))
+                        {
+                            if (!AppConfig.Settings.OpenExitZoom)
+                                if (NativeHeifReader.GetEmbedded(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                            if (NativeHeifReader.GetHq(d2dCanvas, path, foreground: true) is (true, { } retBmp2)) return retBmp2;
+                        }
                         if (CodecDiscovery.IsWicSupported(extension))
                             if (await WicReader.GetHq(d2dCanvas, path) is (true, { } retBmp3)) return retBmp3;
                         if (CodecDiscovery.IsMagickSupported(extension))
@@ -66,9 +82,12 @@ internal static class ImageReader
                     }
                 case ".AVIF":
                     {
-                        if (!AppConfig.Settings.OpenExitZoom)
-                            if (NativeHeifReader.GetEmbedded(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
-                        if (await NativeAvifReader.GetHq(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
+                        if (NativeHeifApi.CanDecode(extension))
+                        {
+                            if (!AppConfig.Settings.OpenExitZoom)
+                                if (NativeHeifReader.GetEmbedded(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                            if (await NativeAvifReader.GetHq(d2dCanvas, path, foreground: true) is (true, { } retBmp2)) return retBmp2;
+                        }
                         if (CodecDiscovery.IsWicSupported(extension))
                             if (await WicReader.GetHq(d2dCanvas, path) is (true, { } retBmp3)) return retBmp3;
                         if (CodecDiscovery.IsMagickSupported(extension))
@@ -76,9 +95,35 @@ internal static class ImageReader
                         return new StaticHqDisplayItem(_indicators.HqFailed, Origin.ErrorScreen);
                     }
                 case ".PSD":
+                case ".PSB":
                     {
                         if (await PsdReader.GetEmbedded(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
-                        if (await MagickNetWrap.GetHq(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
+                        if (await PsdReader.GetHq(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
+                        if (await MagickNetWrap.GetHq(d2dCanvas, path) is (true, { } retBmp3)) return retBmp3;
+                        return new StaticHqDisplayItem(_indicators.HqFailed, Origin.ErrorScreen);
+                    }
+                case ".DDS":
+                    {
+                        if (!AppConfig.Settings.OpenExitZoom)
+                            if (await NativeDdsReader.GetPreview(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                        if (await NativeDdsReader.GetHq(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
+                        if (CodecDiscovery.IsWicSupported(extension))
+                            if (await WicReader.GetHq(d2dCanvas, path) is (true, { } retBmp3)) return retBmp3;
+                        if (CodecDiscovery.IsMagickSupported(extension))
+                            if (await MagickNetWrap.GetHq(d2dCanvas, path) is (true, { } retBmp4)) return retBmp4;
+                        return new StaticHqDisplayItem(_indicators.HqFailed, Origin.ErrorScreen);
+                    }
+                case ".JPG":
+                case ".JPEG":
+                case ".JPE":
+                case ".JFIF":
+                    {
+                        if (!AppConfig.Settings.OpenExitZoom)
+                            if (await NativeJpegReader.GetPreview(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                        if (await NativeJpegReader.GetHq(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
+                        if (await WicReader.GetHq(d2dCanvas, path) is (true, { } retBmp3)) return retBmp3;
+                        if (CodecDiscovery.IsMagickSupported(extension))
+                            if (await MagickNetWrap.GetHq(d2dCanvas, path) is (true, { } retBmp4)) return retBmp4;
                         return new StaticHqDisplayItem(_indicators.HqFailed, Origin.ErrorScreen);
                     }
                 case ".SVG":
@@ -103,6 +148,7 @@ internal static class ImageReader
                     }
                 case ".ICO":
                 case ".ICON":
+                case ".CUR":
                     {
                         if (await IcoReader.GetHq(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
                         return new StaticHqDisplayItem(_indicators.HqFailed, Origin.ErrorScreen);
@@ -152,11 +198,11 @@ internal static class ImageReader
 
         try
         {
-            var (cachedBmp, actualWidth, actualHeight) = await DiskCacherWithSqlite.Instance.ReturnFromCache(d2dCanvas, path);
+            var (cachedBmp, actualWidth, actualHeight, cachedThumbnail) = await DiskCacherNative.Instance.ReturnFromCache(d2dCanvas, path);
             if (null != cachedBmp)
             {
                 var metadata = new ImageMetadata(actualWidth, actualHeight);
-                return new PreviewDisplayItem(cachedBmp, Origin.DiskCache, metadata);
+                return new PreviewDisplayItem(cachedBmp, Origin.DiskCache, metadata) { CachedThumbnail = cachedThumbnail };
             }
 
             var extension = Path.GetExtension(path).ToUpperInvariant();
@@ -167,16 +213,39 @@ internal static class ImageReader
                 case ".HIF":
                 case ".AVIF":
                     {
-                        if (NativeHeifReader.GetEmbedded(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                        if (NativeHeifApi.CanDecode(extension))
+                            if (NativeHeifReader.GetEmbedded(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
                         if (CodecDiscovery.IsMagickSupported(extension))
                             if (await MagickNetWrap.GetResized(d2dCanvas, path) is (true, { } retBmp3)) return retBmp3;
                         return new PreviewDisplayItem(_indicators.PreviewFailed, Origin.ErrorScreen);
                     }
                 case ".PSD":
+                case ".PSB":
                     {
                         if (await PsdReader.GetEmbedded(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
                         return new PreviewDisplayItem(_indicators.PreviewFailed, Origin.ErrorScreen);
                     }
+                case ".DDS":
+                    {
+                        if (await NativeDdsReader.GetPreview(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                        if (CodecDiscovery.IsWicSupported(extension))
+                            if (await MagicScalerWrap.GetResized(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
+                        if (CodecDiscovery.IsMagickSupported(extension))
+                            if (await MagickNetWrap.GetResized(d2dCanvas, path) is (true, { } retBmp3)) return retBmp3;
+                        return new PreviewDisplayItem(_indicators.PreviewFailed, Origin.ErrorScreen);
+                    }
+                case ".JPG":
+                case ".JPEG":
+                case ".JPE":
+                case ".JFIF":
+                    {
+                        if (await NativeJpegReader.GetPreview(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                        if (await WicReader.GetEmbedded(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
+                        if (await MagicScalerWrap.GetResized(d2dCanvas, path) is (true, { } retBmp3)) return retBmp3;
+                        if (CodecDiscovery.IsMagickSupported(extension))
+                            if (await MagickNetWrap.GetResized(d2dCanvas, path) is (true, { } retBmp4)) return retBmp4;
+                        return new PreviewDisplayItem(_indicators.PreviewFailed, Origin.ErrorScreen);
+                    }
                 case ".SVG":
                     {
                         if (ResvgWrap.GetResized(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
@@ -192,6 +261,7 @@ internal static class ImageReader
                     }
                 case ".ICO":
                 case ".ICON":
+                case ".CUR":
                     {
                         if (await IcoReader.GetPreview(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
                         return new PreviewDisplayItem(_indicators.HqFailed, Origin.ErrorScreen);
@@ -199,6 +269,7 @@ internal static class ImageReader
                 case ".TIF":
                 case ".TIFF":
                     {
+                        if (await TiffReader.GetPreview(d2dCanvas, path) is (true, { } retBmp0)) return retBmp0;
                         if (await WicReader.GetEmbedded(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
                         if (await WicReader.GetResized(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
                         return new PreviewDisplayItem(_indicators.PreviewFailed, Origin.ErrorScreen);
@@ -226,9 +297,11 @@ internal static class ImageReader
 
     /// <summary>
     /// Loads the full high-quality image for display in the main viewer.
-    /// Uses format-specific decoders in priority order.
+    /// Uses format-specific decoders in priority order. <paramref name="foreground"/> is set for the
+    /// first photo's decode, which runs before the prefetch workers start and may use every core.
     /// </summary>
-    public static async Task<HqDisplayItem> GetHqImage(ICanvasResourceCreatorWithDpi d2dCanvas, string path)
+    public static async Task<HqDisplayItem> GetHqImage(ICanvasResourceCreatorWithDpi d2dCanvas, string path,
+        bool foreground = false)
     {
         if (!File.Exists(path))
             return new StaticHqDisplayItem(_indicators.FileNotFound, Origin.ErrorScreen);
@@ -245,7 +318,8 @@ internal static class ImageReader
                 case ".HEIF":
                 case ".HIF":
                     {
-                        if (NativeHeifReader.GetHq(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                        if (NativeHeifApi.CanDecode(extension))
+                            if (NativeHeifReader.GetHq(d2dCanvas, path, foreground) is (true, { } retBmp)) return retBmp;
                         if (CodecDiscovery.IsWicSupported(extension))
                             if (await WicReader.GetHq(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
                         if (CodecDiscovery.IsMagickSupported(extension))
@@ -254,7 +328,8 @@ internal static class ImageReader
                     }
                 case ".AVIF":
                     {
-                        if (await NativeAvifReader.GetHq(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                        if (NativeHeifApi.CanDecode(extension))
+                            if (await NativeAvifReader.GetHq(d2dCanvas, path, foreground) is (true, { } retBmp)) return retBmp;
                         if (CodecDiscovery.IsWicSupported(extension))
                             if (await WicReader.GetHq(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
                         if (CodecDiscovery.IsMagickSupported(extension))
@@ -262,8 +337,30 @@ internal static class ImageReader
                         return new StaticHqDisplayItem(_indicators.HqFailed, Origin.ErrorScreen);
                     }
                 case ".PSD":
+                case ".PSB":
+                    {
+                        if (await PsdReader.GetHq(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                        if (await MagickNetWrap.GetHq(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
+                        return new StaticHqDisplayItem(_indicators.HqFailed, Origin.ErrorScreen);
+                    }
+                case ".DDS":
                     {
-                        if (await MagickNetWrap.GetHq(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                        if (await NativeDdsReader.GetHq(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                        if (CodecDiscovery.IsWicSupported(extension))
+                            if (await WicReader.GetHq(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
+                        if (CodecDiscovery.IsMagickSupported(extension))
+                            if (await MagickNetWrap.GetHq(d2dCanvas, path) is (true, { } retBmp3)) return retBmp3;
+                        return new StaticHqDisplayItem(_indicators.HqFailed, Origin.ErrorScreen);
+                    }
+                case ".JPG":
+                case ".JPEG":
+                case ".JPE":
+                case ".JFIF":
+                    {
+                        if (await NativeJpegReader.GetHq(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
+                        if (await WicReader.GetHq(d2dCanvas, path) is (true, { } retBmp2)) return retBmp2;
+                        if (CodecDiscovery.IsMagickSupported(extension))
+                            if (await MagickNetWrap.GetHq(d2dCanvas, path) is (true, { } retBmp3)) return retBmp3;
                         return new StaticHqDisplayItem(_indicators.HqFailed, Origin.ErrorScreen);
                     }
                 case ".SVG":
@@ -288,6 +385,7 @@ internal static class ImageReader
                     }
                 case ".ICO":
                 case ".ICON":
+                case ".CUR":
                     {
                         if (await IcoReader.GetHq(d2dCanvas, path) is (true, { } retBmp)) return retBmp;
                         return new StaticHqDisplayItem(_indicators.HqFailed, Origin.ErrorScreen);
@@ -353,4 +451,60 @@ internal static class ImageReader
         }
         return (false, HqDisplayItem.Empty());
     }
+
+    /// <summary>
+    /// Takes the preview the native startup load made of the launch photo while the window was
+    /// being created: a thumbnail store entry, or a decoded embedded thumbnail. Returns null if
+    /// there is none for <paramref name="path"/>, and the caller loads the photo as usual.
+    /// Whatever the outcome, the startup load is ended after the first call.
+    /// </summary>
+    private static async Task<PreviewDisplayItem> GetStartupPreviewAsync(ICanvasResourceCreatorWithDpi d2dCanvas, string path)
+    {
+        if (!DiskCacherNative.StartupPreviewBegun) return null;
+
+        // A cached view is only handed over once the cache has adopted the startup store.
+        var cache = DiskCacherNative.Instance;
+        if (!NativeStartupPreviewBridge.ClaimStartupPreview(path, StartupPreviewTimeoutMs, out var result))
+        {
+            NativeStartupPreviewBridge.EndStartupPreview();
+            return null;
+        }
+
+        try
+        {
+            Logger.Debug("Startup preview {0} ready after {1} ms, waited {2} ms for {3}",
+                result.Kind, result.ReadyMs, result.WaitedMs, path);
+            switch (result.Kind)
+            {
+                case StartupPreviewKind.Cached:
+                    {
+                        var (cachedBmp, actualWidth, actualHeight, cachedThumbnail) = await cache.ReturnFromView(d2dCanvas, result.View);
+                        if (cachedBmp == null) return null;
+                        var metadata = new ImageMetadata(actualWidth, actualHeight);
+                        return new PreviewDisplayItem(cachedBmp, Origin.DiskCache, metadata) { CachedThumbnail = cachedThumbnail };
+                    }
+                case StartupPreviewKind.Pixels:
+                    {
+                        var pixels = new byte[result.Pixels.Size];
+                        Marshal.Copy(result.Pixels.Data, pixels, 0, pixels.Length);
+                        var canvasBitmap = CanvasBitmap.CreateFromBytes(d2dCanvas, pixels, result.Pixels.Width,
+                            result.Pixels.Height, DirectXPixelFormat.R8G8B8A8UIntNormalized);
+                        var metadata = new ImageMetadata(result.Pixels.FullWidth, result.Pixels.FullHeight);
+                        return new PreviewDisplayItem(canvasBitmap, Origin.Disk, metadata);
+                    }
+                default:
+                    return null;
+            }
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, $"Failed to use the startup preview of: {path}");
+            return null;
+        }
+        finally
+        {
+            NativeStartupPreviewBridge.FreeStartupPreview(ref result);
+            NativeStartupPreviewBridge.EndStartupPreview();
+        }
+    }
 }
\ No newline at end of file
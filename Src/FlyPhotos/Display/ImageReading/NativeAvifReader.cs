@@ -26,14 +26,17 @@ internal static class NativeAvifReader
     /// </summary>
     /// <param name="canvas">The ICanvasResourceCreatorWithDpi surface context used for creating Win2D bitmaps.</param>
     /// <param name="inputPath">The absolute path to the .avif or .heic file.</param>
+    /// <param name="foreground">True when this is the only decode running, so libheif may use every core.</param>
     /// <returns>A tuple of (success, HqDisplayItem).</returns>
-    public static async Task<(bool, HqDisplayItem)> GetHq(ICanvasResourceCreatorWithDpi canvas, string inputPath)
+    public static async Task<(bool, HqDisplayItem)> GetHq(ICanvasResourceCreatorWithDpi canvas, string inputPath,
+        bool foreground = false)
     {
         try
         {
             byte[] fileData = await File.ReadAllBytesAsync(inputPath);
 
-            var heifImage = NativeHeifWrapper.DecodePrimaryImageFromMemory(fileData, out bool isAnimated);
+            var heifImage = NativeHeifWrapper.DecodePrimaryImageFromMemory(fileData, out bool isAnimated,
+                foreground ? NativeHeifApi.PreferredThreadCount : 0);
 
             if (heifImage == null || heifImage.Pixels == null || heifImage.Pixels.Length == 0)
             {
@@ -0,0 +1,94 @@
+using System;
+using System.Threading.Tasks;
+using Windows.Graphics.DirectX;
+using FlyPhotos.Core.Model;
+using FlyPhotos.Infra.Interop;
+using Microsoft.Graphics.Canvas;
+using NLog;
+
+namespace FlyPhotos.Display.ImageReading;
+
+/// <summary>
+/// Reads DirectDraw Surface textures through the native decoder in FlyNativeLibHeif
+/// (see <see cref="NativeDdsBridge" />). A DDS stores its mip chain next to the full image, so the
+/// preview is decoded from the smallest level that still covers the preview size instead of
+/// being scaled down from the top level. Only the first array element or cube face is shown.
+/// Formats the decoder does not handle fall back to WIC and ImageMagick in <see cref="ImageReader" />.
+/// </summary>
+internal static class NativeDdsReader
+{
+    private static readonly Logger Logger = LogManager.GetCurrentClassLogger();
+
+    /// <summary>Longer side the preview must cover; matches <see cref="WicReader" />'s resized previews.</summary>
+    private const int PreviewDimension = 800;
+
+    /// <summary>
+    /// Decodes the mip level nearest the preview size. The metadata carries the full size, so the
+    /// preview is laid out as the full image.
+    /// </summary>
+    public static async Task<(bool, PreviewDisplayItem)> GetPreview(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
+    {
+        try
+        {
+            if (!NativeDdsBridge.ReadDdsInfo(inputPath, PreviewDimension, out var info, out var mip) || info.CanDecode == 0)
+                return (false, PreviewDisplayItem.Empty());
+
+            var bitmap = await DecodeLevel(ctrl, inputPath, mip.Level, mip.Width, mip.Height);
+            if (bitmap == null)
+                return (false, PreviewDisplayItem.Empty());
+            return (true, new PreviewDisplayItem(bitmap, Origin.Disk, new ImageMetadata(info.Width, info.Height)));
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, $"Failed to decode DDS preview from: {inputPath}");
+            return (false, PreviewDisplayItem.Empty());
+        }
+    }
+
+    /// <summary>
+    /// Decodes the top mip level natively, straight into the array the bitmap is created from.
+    /// </summary>
+    /// <returns>False if the file is not a DDS or its pixel format is one the native decoder does not handle.</returns>
+    public static async Task<(bool, HqDisplayItem)> GetHq(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
+    {
+        try
+        {
+            if (!NativeDdsBridge.ReadDdsInfo(inputPath, 0, out var info, out _) || info.CanDecode == 0)
+                return (false, HqDisplayItem.Empty());
+
+            var bitmap = await DecodeLevel(ctrl, inputPath, 0, info.Width, info.Height);
+            if (bitmap == null)
+                return (false, HqDisplayItem.Empty());
+            return (true, new StaticHqDisplayItem(bitmap, Origin.Disk));
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, $"Failed to decode DDS texture from: {inputPath}");
+            return (false, HqDisplayItem.Empty());
+        }
+    }
+
+    private static async Task<CanvasBitmap> DecodeLevel(ICanvasResourceCreatorWithDpi ctrl, string path, int level, int width, int height)
+    {
+        long size = (long)width * height * 4;
+        if (size > Array.MaxLength)
+            return null;
+
+        var pixels = GC.AllocateUninitializedArray<byte>((int)size);
+        var result = await Task.Run(() => Decode(path, level, pixels));
+        if (result != HeifError.Ok)
+        {
+            Logger.Warn($"Native DDS decode of level {level} failed with {result}: {path}");
+            return null;
+        }
+
+        return CanvasBitmap.CreateFromBytes(ctrl, pixels, width, height,
+            DirectXPixelFormat.B8G8R8A8UIntNormalized); // Premultiplied BGRA from the native decoder
+    }
+
+    private static unsafe HeifError Decode(string path, int level, byte[] pixels)
+    {
+        fixed (byte* p = pixels)
+            return NativeDdsBridge.DecodeDdsMip(path, 0, level, p, (ulong)pixels.Length);
+    }
+}
@@ -55,13 +55,15 @@ internal static class NativeHeifReader
 
     /// <summary>
     /// Gets the high-quality primary image using the high-performance native HeifDecoder.
+    /// A <paramref name="foreground"/> decode is the only one running, so it may use every core.
     /// </summary>
-    public static (bool, HqDisplayItem) GetHq(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
+    public static (bool, HqDisplayItem) GetHq(ICanvasResourceCreatorWithDpi ctrl, string inputPath, bool foreground = false)
     {
         try
         {
             // 1. Call our new native decoder to get the primary image's pixel data.
-            var heifImage = NativeHeifWrapper.DecodePrimaryImage(inputPath);
+            var heifImage = NativeHeifWrapper.DecodePrimaryImage(inputPath,
+                foreground ? NativeHeifApi.PreferredThreadCount : 0);
 
             // 2. Check if a valid image was returned.
             if (heifImage == null || heifImage.Pixels == null || heifImage.Pixels.Length == 0)
@@ -0,0 +1,95 @@
+using System;
+using System.Threading.Tasks;
+using Windows.Graphics.DirectX;
+using FlyPhotos.Core.Model;
+using FlyPhotos.Infra.Interop;
+using Microsoft.Graphics.Canvas;
+using NLog;
+
+namespace FlyPhotos.Display.ImageReading;
+
+/// <summary>
+/// Reads JPEGs through the libjpeg-turbo decoder in FlyNativeLibHeif (see <see cref="NativeJpegBridge" />).
+/// Previews are decoded at the reduced IDCT scale (1/2, 1/4 or 1/8) nearest the preview size, or
+/// taken from the EXIF thumbnail when it is large enough, so nothing is decoded at full size and
+/// resized. Full-size decodes are split across the cores at restart markers when the file has them.
+/// The EXIF orientation is applied natively. CMYK, 12-bit and arithmetic-coded files fall back to
+/// WIC in <see cref="ImageReader" />.
+/// </summary>
+internal static class NativeJpegReader
+{
+    private static readonly Logger Logger = LogManager.GetCurrentClassLogger();
+
+    /// <summary>Longer side the preview must cover; matches <see cref="WicReader" />'s resized previews.</summary>
+    private const int PreviewDimension = 800;
+
+    /// <summary>
+    /// Decodes the thumbnail or IDCT scale nearest the preview size. The metadata carries the full
+    /// size, so the preview is laid out as the full image.
+    /// </summary>
+    public static async Task<(bool, PreviewDisplayItem)> GetPreview(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
+    {
+        try
+        {
+            if (!NativeJpegBridge.ReadJpegInfo(inputPath, PreviewDimension, out var info, out var scale) || scale.Width == 0)
+                return (false, PreviewDisplayItem.Empty());
+
+            var bitmap = await DecodeScale(ctrl, inputPath, scale);
+            if (bitmap == null)
+                return (false, PreviewDisplayItem.Empty());
+            return (true, new PreviewDisplayItem(bitmap, Origin.Disk, new ImageMetadata(info.Width, info.Height)));
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, $"Failed to decode JPEG preview from: {inputPath}");
+            return (false, PreviewDisplayItem.Empty());
+        }
+    }
+
+    /// <summary>
+    /// Decodes the full image natively, straight into the array the bitmap is created from.
+    /// </summary>
+    /// <returns>False if the file is not a JPEG or is one the native decoder does not handle.</returns>
+    public static async Task<(bool, HqDisplayItem)> GetHq(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
+    {
+        try
+        {
+            if (!NativeJpegBridge.ReadJpegInfo(inputPath, 0, out var info, out var scale) || info.CanDecode == 0)
+                return (false, HqDisplayItem.Empty());
+
+            var bitmap = await DecodeScale(ctrl, inputPath, scale);
+            if (bitmap == null)
+                return (false, HqDisplayItem.Empty());
+            return (true, new StaticHqDisplayItem(bitmap, Origin.Disk));
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, $"Failed to decode JPEG from: {inputPath}");
+            return (false, HqDisplayItem.Empty());
+        }
+    }
+
+    private static async Task<CanvasBitmap> DecodeScale(ICanvasResourceCreatorWithDpi ctrl, string path, JpegScale scale)
+    {
+        long size = (long)scale.Width * scale.Height * 4;
+        if (size > Array.MaxLength)
+            return null;
+
+        var pixels = GC.AllocateUninitializedArray<byte>((int)size);
+        var result = await Task.Run(() => Decode(path, scale, pixels));
+        if (result != HeifError.Ok)
+        {
+            Logger.Warn($"Native JPEG decode at 1/{scale.Denominator} (thumbnail: {scale.Thumbnail}) failed with {result}: {path}");
+            return null;
+        }
+
+        return CanvasBitmap.CreateFromBytes(ctrl, pixels, scale.Width, scale.Height,
+            DirectXPixelFormat.B8G8R8A8UIntNormalized); // Opaque BGRA from the native decoder
+    }
+
+    private static unsafe HeifError Decode(string path, JpegScale scale, byte[] pixels)
+    {
+        fixed (byte* p = pixels)
+            return NativeJpegBridge.DecodeJpeg(path, scale.Thumbnail, scale.Denominator, p, (ulong)pixels.Length);
+    }
+}
@@ -19,7 +19,7 @@ namespace FlyPhotos.Display.ImageReading;
 ///     <see cref="CanvasBitmap" /> decoded by Win2D's built-in PNG loader.
 ///     For animated PNG (APNG), an <see cref="AnimatedHqDisplayItem" /> is returned, carrying
 ///     both the first decoded frame (for immediate display before animation begins) and the raw
-///     file bytes (consumed by <see cref="FlyPhotos.Display.Animators.PngAnimator" /> for
+///     file bytes (consumed by <see cref="FlyPhotos.Display.Animators.NativeAnimator" /> for
 ///     frame-accurate playback).
 ///     Animation detection is performed by <see cref="IsAnimatedPngAsync" />, which scans only
 ///     the first 4 KB of the file for the APNG <c>acTL</c> chunk rather than performing a
@@ -4,6 +4,7 @@ using System.IO;
 using System.Threading.Tasks;
 using FlyPhotos.Core.Model;
 using FlyPhotos.Infra.Configuration;
+using FlyPhotos.Infra.Interop;
 using FlyPhotos.Services;
 using Microsoft.Graphics.Canvas;
 using NLog;
@@ -12,12 +13,14 @@ namespace FlyPhotos.Display.ImageReading;
 
 // ponytail: instrumented mirror of ImageReader routing; keep in sync if ImageReader's chains change.
 // Reports which reader won, whether it fell back through more than one reader, and how long it took.
+// For the native HEIF/AVIF readers it also reports the per-stage breakdown of the native decode.
 // Disk cache is intentionally bypassed so timings reflect real decode cost.
 internal static class ProfilingImageReader
 {
     private static readonly Logger Logger = LogManager.GetCurrentClassLogger();
 
-    internal readonly record struct ProbeResult(bool Success, long ElapsedMs, string FunctionUsed, bool Fallback, bool? Locked = null);
+    internal readonly record struct ProbeResult(bool Success, long ElapsedMs, string FunctionUsed, bool Fallback,
+        bool? Locked = null, string NativeStages = "");
 
     private sealed class Attempt
     {
@@ -39,6 +42,7 @@ internal static class ProfilingImageReader
     public static async Task<ProbeResult> ProbeHq(ICanvasResourceCreatorWithDpi d, string path, bool checkLock = false)
     {
         var a = new Attempt();
+        using var reports = NativeHeifApi.BeginReportCapture();
         var sw = Stopwatch.StartNew();
         bool ok;
         try { ok = await RunHq(a, d, path); }
@@ -50,19 +54,22 @@ internal static class ProfilingImageReader
             locked = IsFileLocked(path); // performed while the HQ item is still alive
 
         a.WinningItem?.Dispose();
-        return new ProbeResult(ok, sw.ElapsedMilliseconds, a.LastName, a.Count > 1, locked);
+        return new ProbeResult(ok, sw.ElapsedMilliseconds, a.LastName, a.Count > 1, locked,
+            reports.Last?.ToString() ?? "");
     }
 
     public static async Task<ProbeResult> ProbePreview(ICanvasResourceCreatorWithDpi d, string path)
     {
         var a = new Attempt();
+        using var reports = NativeHeifApi.BeginReportCapture();
         var sw = Stopwatch.StartNew();
         bool ok;
         try { ok = await RunPreview(a, d, path); }
         catch (Exception ex) { Logger.Error(ex); ok = false; }
         sw.Stop();
         a.WinningItem?.Dispose();
-        return new ProbeResult(ok, sw.ElapsedMilliseconds, a.LastName, a.Count > 1);
+        return new ProbeResult(ok, sw.ElapsedMilliseconds, a.LastName, a.Count > 1,
+            NativeStages: reports.Last?.ToString() ?? "");
     }
 
     // Renames the file to ren_<name> and back while the decoded item is still held.
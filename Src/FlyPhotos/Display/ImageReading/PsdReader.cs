@@ -1,12 +1,21 @@
 using System;
-using System.Buffers.Binary;
 using System.IO;
 using System.Threading.Tasks;
+using Windows.Graphics.DirectX;
 using FlyPhotos.Core.Model;
+using FlyPhotos.Infra.Interop;
 using Microsoft.Graphics.Canvas;
 using NLog;
 
 namespace FlyPhotos.Display.ImageReading;
+
+/// <summary>
+/// Reads Photoshop PSD and PSB files through the native parser in FlyNativeLibHeif
+/// (see <see cref="NativePsdBridge" />). The parser walks the file's sections by their lengths,
+/// so the embedded thumbnail is found after reading a few pages even in a file of hundreds of
+/// megabytes. The merged composite is decoded natively as well; documents it cannot handle
+/// (ZIP-compressed, 32-bit, Lab, indexed...) fall back to ImageMagick in <see cref="ImageReader" />.
+/// </summary>
 internal static class PsdReader
 {
     private static readonly Logger Logger = LogManager.GetCurrentClassLogger();
@@ -14,152 +23,68 @@ internal static class PsdReader
     // Get preview as a CanvasBitmap for WinUI
     public static async Task<(bool, PreviewDisplayItem)> GetEmbedded(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
     {
-        if (GetPsdInfo(inputPath, out int width, out var height, out var thumbnailData))
+        try
         {
-            try
-            {
-                using var stream = new MemoryStream(thumbnailData);
-                CanvasBitmap bitmap = await CanvasBitmap.LoadAsync(ctrl, stream.AsRandomAccessStream());
-                var metaData = new ImageMetadata(width, height);
-                return (true, new PreviewDisplayItem(bitmap, Origin.Disk, metaData));
-            }
-            catch (Exception ex)
-            {
-                Logger.Error(ex);
+            if (!NativePsdBridge.ReadPsdInfo(inputPath, out var info) || info.ThumbnailSize <= 0)
                 return (false, PreviewDisplayItem.Empty());
+
+            // Only the thumbnail's own bytes are read; the parser reported where they are.
+            var thumbnailData = GC.AllocateUninitializedArray<byte>((int)info.ThumbnailSize);
+            using (var handle = File.OpenHandle(inputPath))
+            {
+                if (RandomAccess.Read(handle, thumbnailData, info.ThumbnailOffset) != thumbnailData.Length)
+                    return (false, PreviewDisplayItem.Empty());
             }
+
+            using var stream = new MemoryStream(thumbnailData);
+            CanvasBitmap bitmap = await CanvasBitmap.LoadAsync(ctrl, stream.AsRandomAccessStream());
+            var metaData = new ImageMetadata(info.Width, info.Height);
+            return (true, new PreviewDisplayItem(bitmap, Origin.Disk, metaData));
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex);
+            return (false, PreviewDisplayItem.Empty());
         }
-        return (false, PreviewDisplayItem.Empty());
     }
 
     /// <summary>
-    /// Efficiently extracts the main image dimensions (width, height) and the embedded
-    /// JPEG thumbnail from a Photoshop (PSD) file.
+    /// Decodes the merged composite natively, straight into the array the bitmap is created from.
     /// </summary>
-    /// <param name="inputFilePath">The path to the PSD file.</param>
-    /// <param name="width">The width of the main image.</param>
-    /// <param name="height">The height of the main image.</param>
-    /// <param name="thumbnailData">The byte array of the embedded JPEG thumbnail, or null if not found.</param>
-    /// <returns>True if the header was read successfully; false otherwise. The thumbnail may still be null.</returns>
-    private static bool GetPsdInfo(string inputFilePath, out int width, out int height, out byte[] thumbnailData)
+    /// <returns>False if the file is not a PSD/PSB or its composite is in a form the native decoder does not handle.</returns>
+    public static async Task<(bool, HqDisplayItem)> GetHq(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
     {
-        // Initialize out parameters
-        width = 0;
-        height = 0;
-        thumbnailData = null;
-
         try
         {
-            using var fileStream = new FileStream(inputFilePath, FileMode.Open, FileAccess.Read, FileShare.Read);
-            // The file must be at least 26 bytes to contain the full header
-            if (fileStream.Length < 26)
-            {
-                return false;
-            }
+            if (!NativePsdBridge.ReadPsdInfo(inputPath, out var info) || info.CanDecode == 0)
+                return (false, HqDisplayItem.Empty());
 
-            using var reader = new BinaryReader(fileStream);
+            long size = (long)info.Width * info.Height * 4;
+            if (size > Array.MaxLength)
+                return (false, HqDisplayItem.Empty());
 
-            // --- Read Header for Signature, Width, and Height ---
-            var signature = reader.ReadBytes(4);
-            // PSD header must be '8BPS'
-            if (signature[0] != '8' || signature[1] != 'B' || signature[2] != 'P' || signature[3] != 'S')
+            var pixels = GC.AllocateUninitializedArray<byte>((int)size);
+            var result = await Task.Run(() => Decode(inputPath, pixels));
+            if (result != HeifError.Ok)
             {
-                return false;
+                Logger.Warn($"Native PSD decode failed with {result}: {inputPath}");
+                return (false, HqDisplayItem.Empty());
             }
 
-            // The header is fixed. We can jump directly to the dimensions.
-            // Offset 14 for Height, Offset 18 for Width.
-            fileStream.Seek(14, SeekOrigin.Begin);
-
-            // NEW: Read the height and width from the header
-            height = (int)ReadBigEndianUInt32(reader);
-            width = (int)ReadBigEndianUInt32(reader);
-
-
-            // --- Efficient Search for Thumbnail Resource ---
-            // The rest of your proven thumbnail logic can now run.
-            // The resource marker we are looking for is '8BIM' followed by resource ID 1033 or 1036
-            byte[] searchPatternV5 = [(byte)'8', (byte)'B', (byte)'I', (byte)'M', 0x04, 0x0C]; // 1036 for PS 5.0+
-            byte[] searchPatternV4 = [(byte)'8', (byte)'B', (byte)'I', (byte)'M', 0x04, 0x09]; // 1033 for PS 4.0
-
-            long position = FindBytePattern(fileStream, searchPatternV5);
-            if (position == -1)
-                position = FindBytePattern(fileStream, searchPatternV4);
-
-            if (position == -1) 
-                return false;
-
-            // We found the marker. Position the stream right after it.
-            fileStream.Position = position + searchPatternV5.Length;
-
-            // Skip Pascal string for the name (1 byte length + name + padding)
-            byte nameLength = reader.ReadByte();
-            // Seek past the name string and its padding to make the total length even.
-            // (1 byte for length + nameLength + padding) must be an even number.
-            int nameBlockLength = 1 + nameLength;
-            int namePadding = nameBlockLength % 2 == 0 ? 0 : 1;
-            fileStream.Seek(nameLength + namePadding, SeekOrigin.Current);
-
-            // --- Read Thumbnail Data ---
-            uint dataSize = ReadBigEndianUInt32(reader);
-            if (dataSize <= 28) return false;
-
-            // Skip the 28-byte thumbnail header to get to the raw JPEG data
-            fileStream.Seek(28, SeekOrigin.Current);
-
-            // The actual JPEG data size is the total size minus the header
-            int jpegDataSize = (int)(dataSize - 28);
-            thumbnailData = reader.ReadBytes(jpegDataSize);
-            return thumbnailData.Length == jpegDataSize;
+            var bitmap = CanvasBitmap.CreateFromBytes(ctrl, pixels, info.Width, info.Height,
+                DirectXPixelFormat.B8G8R8A8UIntNormalized); // Premultiplied BGRA from the native decoder
+            return (true, new StaticHqDisplayItem(bitmap, Origin.Disk));
         }
         catch (Exception ex)
         {
-            Logger.Error(ex);
-            return false;
+            Logger.Error(ex, $"Failed to decode PSD composite from: {inputPath}");
+            return (false, HqDisplayItem.Empty());
         }
     }
 
-    // Helper function to efficiently find a byte pattern in a stream
-    private static long FindBytePattern(FileStream stream, byte[] pattern)
+    private static unsafe HeifError Decode(string path, byte[] pixels)
     {
-        stream.Position = 0; // Start search from the beginning
-        const int bufferSize = 4096;
-        var buffer = new byte[bufferSize];
-        int bytesRead;
-
-        while ((bytesRead = stream.Read(buffer, 0, buffer.Length)) > 0)
-        {
-            for (int i = 0; i <= bytesRead - pattern.Length; i++)
-            {
-                bool found = true;
-                for (int j = 0; j < pattern.Length; j++)
-                {
-                    if (buffer[i + j] != pattern[j])
-                    {
-                        found = false;
-                        break;
-                    }
-                }
-                if (found)
-                {
-                    return stream.Position - bytesRead + i;
-                }
-            }
-            // Important: If the pattern could span across buffer boundaries, more complex logic is needed.
-            // For this specific use case, it's highly unlikely, so we keep it simple.
-            // We reposition the stream back slightly to handle edge cases.
-            stream.Seek(-(pattern.Length - 1), SeekOrigin.Current);
-        }
-        return -1; // Pattern not found
+        fixed (byte* p = pixels)
+            return NativePsdBridge.DecodePsdComposite(path, p, (ulong)pixels.Length);
     }
-
-    // Reads a big-endian uint32 using a stack-allocated buffer  no heap allocation per call.
-    private static uint ReadBigEndianUInt32(BinaryReader reader)
-    {
-        Span<byte> buf = stackalloc byte[4];
-        if (reader.Read(buf) < 4)
-            throw new EndOfStreamException("Unexpected end of stream reading PSD uint32.");
-        return BinaryPrimitives.ReadUInt32BigEndian(buf);
-    }
-
 }
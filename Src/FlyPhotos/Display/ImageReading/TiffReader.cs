@@ -3,6 +3,8 @@ using System.Linq;
 using System.Threading.Tasks;
 using Windows.Graphics.Imaging;
 using FlyPhotos.Core.Model;
+using FlyPhotos.Display.ImageRendering;
+using FlyPhotos.Infra.Interop;
 using Microsoft.Graphics.Canvas;
 using NLog;
 using FlyPhotos.Services;
@@ -12,13 +14,49 @@ namespace FlyPhotos.Display.ImageReading;
 
 /// <summary>
 /// Reads TIFF files and supports multi-page TIFFs. For single-page TIFFs it returns a static HQ display item.
-/// For multi-page TIFFs it returns a MultiPageHqDisplayItem containing the original file bytes and
-/// a first-frame CanvasBitmap for immediate display.
+/// For multi-page TIFFs it returns a MultiPageHqDisplayItem whose pages are decoded as they are shown,
+/// with a first-frame CanvasBitmap for immediate display.
+/// <para>
+/// The native decoder in FlyNativeLibHeif (see <see cref="NativeTiffBridge" />) maps the file, indexes
+/// every page up front and decodes only the page asked for, its strips or tiles in parallel. Previews
+/// come from a reduced-resolution image when the file has one. Files with a page it cannot decode
+/// (CCITT, JPEG and other compressions), or whose first page is rotated or mirrored, go through WIC.
+/// </para>
 /// </summary>
 internal static class TiffReader
 {
     private static readonly Logger Logger = LogManager.GetCurrentClassLogger();
 
+    /// <summary>Longer side the preview must cover; matches <see cref="WicReader" />'s resized previews.</summary>
+    private const int PreviewDimension = 800;
+
+    /// <summary>
+    /// Decodes the first page's smallest reduced-resolution image that covers the preview size. The
+    /// metadata carries the page's full size, so the preview is laid out as the full image.
+    /// </summary>
+    /// <returns>False if the file has no such image; the caller falls back to WIC.</returns>
+    public static async Task<(bool, PreviewDisplayItem)> GetPreview(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
+    {
+        try
+        {
+            using var handle = NativeTiffBridge.OpenTiff(inputPath);
+            if (handle.IsInvalid ||
+                !NativeTiffBridge.GetTiffPageInfo(handle, 0, PreviewDimension, out var page, out var level) ||
+                level.Level <= 0 || page.Orientation != 1)
+                return (false, PreviewDisplayItem.Empty());
+
+            var bitmap = await DecodeLevelAsync(ctrl, handle, 0, level);
+            if (bitmap == null)
+                return (false, PreviewDisplayItem.Empty());
+            return (true, new PreviewDisplayItem(bitmap, Origin.Disk, new ImageMetadata(page.Width, page.Height)));
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, "TiffReader - native GetPreview failed for {0}", inputPath);
+            return (false, PreviewDisplayItem.Empty());
+        }
+    }
+
     public static async Task<(bool, PreviewDisplayItem)> GetFirstFrameFullSize(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
     {
         try
@@ -37,6 +75,7 @@ internal static class TiffReader
 
     public static async Task<(bool, HqDisplayItem)> GetHq(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
     {
+        if (await GetHqNative(ctrl, inputPath) is (true, { } hq)) return (true, hq);
         try
         {
             using var stream = await StorageOps.GetWin2DPerformantStream(inputPath);
@@ -69,7 +108,7 @@ internal static class TiffReader
                 var bytes = await StorageOps.GetInMemByteArray(stream);
                 // Pages are the frames, in file order.
                 var pageOrder = Enumerable.Range(0, (int)decoder.FrameCount).ToArray();
-                return (true, new MultiPageHqDisplayItem(firstFrame, Origin.Disk, bytes, pageOrder));
+                return (true, new MultiPageHqDisplayItem(firstFrame, Origin.Disk, new WicPageSource(bytes, pageOrder)));
             }
 
             return (true, new StaticHqDisplayItem(firstFrame, Origin.Disk));
@@ -80,4 +119,59 @@ internal static class TiffReader
             return (false, HqDisplayItem.Empty());
         }
     }
+
+    private static async Task<(bool, HqDisplayItem)> GetHqNative(ICanvasResourceCreatorWithDpi ctrl, string inputPath)
+    {
+        using var handle = NativeTiffBridge.OpenTiff(inputPath);
+        try
+        {
+            if (handle.IsInvalid)
+                return (false, HqDisplayItem.Empty());
+
+            var pages = new TiffPageInfo[NativeTiffBridge.GetTiffPageCount(handle)];
+            for (var i = 0; i < pages.Length; i++)
+                if (!NativeTiffBridge.GetTiffPageInfo(handle, i, 0, out pages[i], out _) || pages[i].CanDecode == 0)
+                    return (false, HqDisplayItem.Empty());
+            // WIC shows the first page oriented; the later pages it shows as stored, as these are.
+            if (pages.Length == 0 || pages[0].Orientation != 1)
+                return (false, HqDisplayItem.Empty());
+
+            var first = new TiffLevel { Level = 0, Width = pages[0].Width, Height = pages[0].Height, CanDecode = 1 };
+            var bitmap = await DecodeLevelAsync(ctrl, handle, 0, first);
+            if (bitmap == null)
+                return (false, HqDisplayItem.Empty());
+
+            if (pages.Length == 1)
+                return (true, new StaticHqDisplayItem(bitmap, Origin.Disk));
+            // The page source reopens the file for each page, so it is not held open while the item is resident.
+            return (true, new MultiPageHqDisplayItem(bitmap, Origin.Disk, new NativeTiffPageSource(inputPath, pages)));
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, "TiffReader - native GetHq failed for {0}", inputPath);
+            return (false, HqDisplayItem.Empty());
+        }
+    }
+
+    private static async Task<CanvasBitmap> DecodeLevelAsync(ICanvasResourceCreatorWithDpi ctrl, TiffHandle handle, int page, TiffLevel level)
+    {
+        long size = (long)level.Width * level.Height * 4;
+        if (size > Array.MaxLength)
+            return null;
+
+        var pixels = GC.AllocateUninitializedArray<byte>((int)size);
+        var result = await Task.Run(() => Decode(handle, page, level.Level, pixels));
+        if (result != HeifError.Ok)
+        {
+            Logger.Warn("TiffReader - native decode of page {0} level {1} failed with {2}", page, level.Level, result);
+            return null;
+        }
+        return CanvasBitmap.CreateFromBytes(ctrl, pixels, level.Width, level.Height, DirectXPixelFormat.B8G8R8A8UIntNormalized);
+    }
+
+    private static unsafe HeifError Decode(TiffHandle handle, int page, int level, byte[] pixels)
+    {
+        fixed (byte* p = pixels)
+            return NativeTiffBridge.DecodeTiffPage(handle, page, level, p, (ulong)pixels.Length);
+    }
 }
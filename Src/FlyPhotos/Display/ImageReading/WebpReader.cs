@@ -20,7 +20,7 @@ namespace FlyPhotos.Display.ImageReading;
 /// For animated WebP (<see cref="BitmapDecoder.FrameCount"/> &gt; 1), an
 /// <see cref="AnimatedHqDisplayItem"/> is returned, carrying both the first-frame bitmap
 /// (for immediate display before animation begins) and the raw file bytes (consumed by
-/// <see cref="FlyPhotos.Display.Animators.WebpAnimator"/> for frame-accurate playback).
+/// <see cref="FlyPhotos.Display.Animators.NativeAnimator"/> for frame-accurate playback).
 /// </remarks>
 internal static class WebpReader
 {
@@ -0,0 +1,26 @@
+using System;
+using System.Threading.Tasks;
+
+namespace FlyPhotos.Display.ImageRendering;
+
+/// <summary>One decoded page: premultiplied BGRA, packed.</summary>
+internal readonly record struct PagePixels(byte[] Pixels, int Width, int Height);
+
+/// <summary>
+/// The pages of a multi-page image, decoded one at a time as <see cref="MultiPageRenderer" /> asks
+/// for them. A source belongs to its <c>MultiPageHqDisplayItem</c> and may serve several renderers
+/// over the item's life, so it must not hold per-renderer state.
+/// </summary>
+internal interface IPageSource : IDisposable
+{
+    int PageCount { get; }
+
+    /// <summary>Memory the source holds between page loads, for the prefetch memory budget.</summary>
+    long ResidentBytes { get; }
+
+    /// <summary>
+    /// Decodes display page <paramref name="pageIndex" />. May be called again before an earlier
+    /// call has finished. Throws if the page cannot be decoded.
+    /// </summary>
+    Task<PagePixels> DecodePageAsync(int pageIndex);
+}
@@ -2,8 +2,6 @@ using System;
 using System.Threading;
 using System.Threading.Tasks;
 using Windows.Graphics.DirectX;
-using Windows.Graphics.Imaging;
-using Windows.Storage.Streams;
 using FlyPhotos.Core.Model;
 using FlyPhotos.Display.State;
 using FlyPhotos.Infra.Configuration;
@@ -16,9 +14,9 @@ namespace FlyPhotos.Display.ImageRendering;
 
 /// <summary>
 /// Renderer for multi-page images (e.g., multipage TIFF, multi-frame ICO). It decodes pages on demand
-/// from the provided byte array and renders the currently selected page. Page index can be changed to
-/// navigate through pages. A <c>pageOrder</c> map lets a caller present the frames in an order other
-/// than the file's own (ICO shows them largest first).
+/// through an <see cref="IPageSource" /> and renders the currently selected page. Page index can be
+/// changed to navigate through pages; only the page being shown is decoded. The source decides the
+/// page order (ICO shows its frames largest first) and is owned by the display item, not the renderer.
 /// </summary>
 internal partial class MultiPageRenderer : IRenderer
 {
@@ -32,47 +30,24 @@ internal partial class MultiPageRenderer : IRenderer
     // Guards the _currentBitmap swap (LoadPageAsync completes on a ThreadPool continuation) against
     // the Draw read on the W2D thread.
     private readonly Lock _bitmapLock = new();
-    private byte[] _fileBytes;
+    private readonly IPageSource _pages;
     private int _currentPageIndex;
     private readonly bool _supportsTransparency;
     private volatile bool _isDisposed;
     private int _latestPageLoadId;
 
-    // The stream and decoder are created once and reused for all page loads.
-    private readonly InMemoryRandomAccessStream _fileStream = new();
-    private readonly Task<BitmapDecoder> _decoderTask;
-
-    // Display page -> decoder frame index. Identity for TIFF, largest-frame-first for ICO.
-    private readonly int[] _pageOrder;
-
-    public MultiPageRenderer(CanvasAnimatedControl canvas, byte[] fileBytes, int initialPageIndex,
-        bool supportsTransparency, Action invalidate, int[] pageOrder)
+    public MultiPageRenderer(CanvasAnimatedControl canvas, IPageSource pages, int initialPageIndex,
+        bool supportsTransparency, Action invalidate)
     {
         _canvas = canvas;
         _supportsTransparency = supportsTransparency;
-        _fileBytes = fileBytes;
+        _pages = pages;
         _currentPageIndex = initialPageIndex;
         _invalidate = invalidate;
-        _pageOrder = pageOrder;
 
-        _decoderTask = InitDecoderAsync();
         _ = LoadPageAsync(_currentPageIndex);
     }
 
-    private async Task<BitmapDecoder> InitDecoderAsync()
-    {
-        using (var outStream = _fileStream.GetOutputStreamAt(0))
-        using (var writer = new DataWriter(outStream))
-        {
-            writer.WriteBytes(_fileBytes);
-            await writer.StoreAsync();
-            await outStream.FlushAsync();
-        }
-        _fileBytes = null; // bytes are now in _fileStream; release the array
-        _fileStream.Seek(0);
-        return await BitmapDecoder.CreateAsync(_fileStream);
-    }
-
     public void Draw(CanvasDrawingSession session, CanvasViewState viewState, CanvasImageInterpolation quality, bool isAnimating)
     {
         session.Units = CanvasUnits.Pixels;
@@ -106,7 +81,6 @@ internal partial class MultiPageRenderer : IRenderer
             _currentBitmap?.Dispose();
             _currentBitmap = null;
         }
-        _fileStream.Dispose();
     }
 
     /// <summary>
@@ -119,16 +93,7 @@ internal partial class MultiPageRenderer : IRenderer
         var operationId = Interlocked.Increment(ref _latestPageLoadId);
         try
         {
-            var decoder = await _decoderTask;
-
-            var frame = await decoder.GetFrameAsync((uint)_pageOrder[pageIndex]);
-            var pixelData = await frame.GetPixelDataAsync(
-                BitmapPixelFormat.Bgra8,
-                BitmapAlphaMode.Premultiplied,
-                new BitmapTransform(),
-                ExifOrientationMode.IgnoreExifOrientation,
-                ColorManagementMode.DoNotColorManage);
-            var pixelBytes = pixelData.DetachPixelData();
+            var page = await _pages.DecodePageAsync(pageIndex);
 
             // All the heavy decoding is done. Before touching shared state, check if this
             // operation is still the latest, and that the renderer hasn't been disposed.
@@ -137,7 +102,7 @@ internal partial class MultiPageRenderer : IRenderer
             // CreateFromBytes is synchronous and uploads directly to the GPU — no PNG round-trip.
             // 96f DPI matches the original LoadAsync-from-PNG behaviour (PNG default DPI = 96).
             var newBitmap = CanvasBitmap.CreateFromBytes(
-                _canvas, pixelBytes, (int)frame.PixelWidth, (int)frame.PixelHeight,
+                _canvas, page.Pixels, page.Width, page.Height,
                 DirectXPixelFormat.B8G8R8A8UIntNormalized, 96f);
 
             // Re-check and swap under the lock — another page load or disposal may have raced in
@@ -155,7 +120,7 @@ internal partial class MultiPageRenderer : IRenderer
                 _currentPageIndex = pageIndex;
             }
             _invalidate();
-            return new Size(frame.PixelWidth, frame.PixelHeight);
+            return new Size(page.Width, page.Height);
         }
         catch (Exception ex)
         {
@@ -166,5 +131,5 @@ internal partial class MultiPageRenderer : IRenderer
 
     public int CurrentPageIndex => _currentPageIndex;
 
-    public int PageCount => _pageOrder.Length;
+    public int PageCount => _pages.PageCount;
 }
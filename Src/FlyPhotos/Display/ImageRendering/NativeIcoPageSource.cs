@@ -0,0 +1,37 @@
+using System;
+using System.Threading.Tasks;
+using FlyPhotos.Infra.Interop;
+
+namespace FlyPhotos.Display.ImageRendering;
+
+/// <summary>
+/// The entries of an ICO or CUR file as pages, largest first, each decoded natively from the file
+/// when it is shown (see <see cref="NativeIcoBridge" />). Nothing is held between page loads.
+/// </summary>
+internal sealed partial class NativeIcoPageSource(string path, IcoEntry[] entries) : IPageSource
+{
+    public int PageCount => entries.Length;
+
+    public long ResidentBytes => 0;
+
+    public Task<PagePixels> DecodePageAsync(int pageIndex)
+    {
+        var entry = entries[pageIndex];
+        return Task.Run(() =>
+        {
+            var pixels = GC.AllocateUninitializedArray<byte>(entry.Width * entry.Height * 4);
+            var result = Decode(entry.Index, pixels);
+            if (result != HeifError.Ok)
+                throw new InvalidOperationException($"Native ICO decode of entry {entry.Index} failed with {result}: {path}");
+            return new PagePixels(pixels, entry.Width, entry.Height);
+        });
+    }
+
+    private unsafe HeifError Decode(int index, byte[] pixels)
+    {
+        fixed (byte* p = pixels)
+            return NativeIcoBridge.DecodeIcoEntry(path, index, p, (ulong)pixels.Length);
+    }
+
+    public void Dispose() { }
+}
@@ -0,0 +1,46 @@
+using System;
+using System.Threading.Tasks;
+using FlyPhotos.Infra.Interop;
+
+namespace FlyPhotos.Display.ImageRendering;
+
+/// <summary>
+/// The pages of a TIFF, each decoded natively from the file when it is shown (see
+/// <see cref="NativeTiffBridge" />). The file is reopened for every page, so it is not held mapped
+/// while the item stays resident: Windows refuses to delete or replace a mapped file. Indexing the
+/// pages again costs a fraction of a millisecond. Nothing is held between page loads.
+/// </summary>
+internal sealed partial class NativeTiffPageSource(string path, TiffPageInfo[] pages) : IPageSource
+{
+    public int PageCount => pages.Length;
+
+    public long ResidentBytes => 0;
+
+    public Task<PagePixels> DecodePageAsync(int pageIndex)
+    {
+        var page = pages[pageIndex];
+        return Task.Run(() =>
+        {
+            using var handle = NativeTiffBridge.OpenTiff(path);
+            // The file may have been replaced since it was indexed; decode only the page that was listed.
+            if (handle.IsInvalid || NativeTiffBridge.GetTiffPageCount(handle) != pages.Length ||
+                !NativeTiffBridge.GetTiffPageInfo(handle, pageIndex, 0, out var info, out _) ||
+                info.Width != page.Width || info.Height != page.Height || info.CanDecode == 0)
+                throw new InvalidOperationException($"Native TIFF page {pageIndex} changed or could not be reopened: {path}");
+
+            var pixels = GC.AllocateUninitializedArray<byte>(page.Width * page.Height * 4);
+            var result = Decode(handle, pageIndex, pixels);
+            if (result != HeifError.Ok)
+                throw new InvalidOperationException($"Native TIFF decode of page {pageIndex} failed with {result}: {path}");
+            return new PagePixels(pixels, page.Width, page.Height);
+        });
+    }
+
+    private static unsafe HeifError Decode(TiffHandle handle, int pageIndex, byte[] pixels)
+    {
+        fixed (byte* p = pixels)
+            return NativeTiffBridge.DecodeTiffPage(handle, pageIndex, 0, p, (ulong)pixels.Length);
+    }
+
+    public void Dispose() { }
+}
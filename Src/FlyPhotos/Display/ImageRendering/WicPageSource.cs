@@ -0,0 +1,63 @@
+using System;
+using System.Threading;
+using System.Threading.Tasks;
+using Windows.Graphics.Imaging;
+using Windows.Storage.Streams;
+
+namespace FlyPhotos.Display.ImageRendering;
+
+/// <summary>
+/// Pages decoded by WIC from the whole file held in memory. The stream and decoder are created on
+/// the first page load and reused for every page after it.
+/// </summary>
+internal sealed partial class WicPageSource : IPageSource
+{
+    private byte[] _fileBytes;
+    private readonly long _fileLength;
+    private readonly InMemoryRandomAccessStream _fileStream = new();
+    private readonly Lazy<Task<BitmapDecoder>> _decoderTask;
+
+    // Display page -> decoder frame index. Identity for TIFF, largest-frame-first for ICO.
+    private readonly int[] _pageOrder;
+
+    public WicPageSource(byte[] fileBytes, int[] pageOrder)
+    {
+        _fileBytes = fileBytes;
+        _fileLength = fileBytes.Length;
+        _pageOrder = pageOrder;
+        _decoderTask = new Lazy<Task<BitmapDecoder>>(InitDecoderAsync, LazyThreadSafetyMode.ExecutionAndPublication);
+    }
+
+    public int PageCount => _pageOrder.Length;
+
+    public long ResidentBytes => _fileLength;
+
+    private async Task<BitmapDecoder> InitDecoderAsync()
+    {
+        using (var outStream = _fileStream.GetOutputStreamAt(0))
+        using (var writer = new DataWriter(outStream))
+        {
+            writer.WriteBytes(_fileBytes);
+            await writer.StoreAsync();
+            await outStream.FlushAsync();
+        }
+        _fileBytes = null; // bytes are now in _fileStream; release the array
+        _fileStream.Seek(0);
+        return await BitmapDecoder.CreateAsync(_fileStream);
+    }
+
+    public async Task<PagePixels> DecodePageAsync(int pageIndex)
+    {
+        var decoder = await _decoderTask.Value;
+        var frame = await decoder.GetFrameAsync((uint)_pageOrder[pageIndex]);
+        var pixelData = await frame.GetPixelDataAsync(
+            BitmapPixelFormat.Bgra8,
+            BitmapAlphaMode.Premultiplied,
+            new BitmapTransform(),
+            ExifOrientationMode.IgnoreExifOrientation,
+            ColorManagementMode.DoNotColorManage);
+        return new PagePixels(pixelData.DetachPixelData(), (int)frame.PixelWidth, (int)frame.PixelHeight);
+    }
+
+    public void Dispose() => _fileStream.Dispose();
+}
@@ -0,0 +1,124 @@
+using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ FrameRect struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct FrameRect
+{
+    public int X;
+    public int Y;
+    public int Width;
+    public int Height;
+}
+
+/// <summary>
+/// C# equivalent of the C++ AnimationInfo struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct AnimationInfo
+{
+    public int Width;
+    public int Height;
+    public int FrameCount;
+    /// <summary>As the file stores it: 0 loops forever; a GIF without a loop extension is -1.</summary>
+    public int LoopCount;
+    public long DurationMs;
+    /// <summary>The container the frames came from.</summary>
+    public ProbedImageFormat Format;
+    private int _reserved;
+}
+
+/// <summary>
+/// C# equivalent of the C++ AnimationFrameInfo struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct AnimationFrameInfo
+{
+    /// <summary>The rectangle the frame draws, clipped to the canvas.</summary>
+    public int X;
+    public int Y;
+    public int Width;
+    public int Height;
+    /// <summary>Display time, with each format's minimum already applied.</summary>
+    public int DelayMs;
+    /// <summary>1 if a seek to this frame or later need not replay the frames before it.</summary>
+    public int KeyFrame;
+}
+
+/// <summary>
+/// C# equivalent of the C++ AnimationRing struct: the caller's slots that changed rectangles are written into.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct AnimationRing
+{
+    public IntPtr Slots;
+    /// <summary>At least the canvas, <c>Width * Height * 4</c> bytes.</summary>
+    public long SlotSize;
+    public int SlotCount;
+    private int _reserved;
+}
+
+/// <summary>
+/// C# equivalent of the C++ AnimationStats struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct AnimationStats
+{
+    /// <summary>The file data the source reads from, owned by the caller.</summary>
+    public long SourceBytes;
+    public long CanvasBytes;
+    /// <summary>Frame table and buffers kept between frames, besides the canvas.</summary>
+    public long ScratchBytes;
+    /// <summary>Frames decoded since opening, replays after a seek included.</summary>
+    public long FramesDecoded;
+}
+
+/// <summary>
+/// P/Invoke declarations for the native animation sources (GIF, APNG, WebP, AVIF/HEIF) in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeAnimationBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>
+    /// Opens an animation held in unmanaged memory, picking the backend from its signature. The
+    /// memory is read on every decode and must stay valid until <see cref="CloseAnimation" />.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "OpenAnimation")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial IntPtr OpenAnimation(IntPtr data, nuint size);
+
+    [LibraryImport(DllName, EntryPoint = "GetAnimationInfo")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool GetAnimationInfo(IntPtr handle, out AnimationInfo info);
+
+    [LibraryImport(DllName, EntryPoint = "GetAnimationFrameInfo")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool GetAnimationFrameInfo(IntPtr handle, int index, out AnimationFrameInfo info);
+
+    /// <summary>
+    /// Brings the canvas to frame <paramref name="index" /> and writes the rectangle that changed,
+    /// packed, to slot <paramref name="slot" /> of <paramref name="ring" />. A seek backwards, or
+    /// past a key frame, replays from the nearest key frame.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "DecodeAnimationFrame")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool DecodeAnimationFrame(IntPtr handle, int index, in AnimationRing ring, int slot, out FrameRect dirty);
+
+    [LibraryImport(DllName, EntryPoint = "GetAnimationStats")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool GetAnimationStats(IntPtr handle, out AnimationStats stats);
+
+    [LibraryImport(DllName, EntryPoint = "CloseAnimation")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void CloseAnimation(IntPtr handle);
+}
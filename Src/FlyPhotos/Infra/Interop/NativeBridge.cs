@@ -111,6 +111,35 @@ internal static partial class NativeBridge
     [LibraryImport(DllName, StringMarshalling = StringMarshalling.Utf16)]
     [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
     public static partial int GetUwpAppIcon(string aumid, SingleIconCallback callback);
+
+    /// <summary>
+    /// C# equivalent of the C++ PackedFileList struct returned by <see cref="EnumerateImageFiles"/>.
+    /// Path i is Chars[Offsets[i] .. Offsets[i + 1]); Offsets has Count + 1 entries.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct PackedFileList
+    {
+        public IntPtr Chars;
+        public IntPtr Offsets;
+        public int Count;
+        public int CharCount;
+    }
+
+    /// <summary>
+    /// Enumerates a folder natively, keeps files whose extension is in the comma-separated
+    /// <paramref name="extensions"/> list and returns their full paths in Explorer's natural order.
+    /// The result must be released with <see cref="FreePackedFileList"/>.
+    /// </summary>
+    [LibraryImport(DllName, StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial int EnumerateImageFiles(string directory, string extensions, out PackedFileList outList);
+
+    /// <summary>
+    /// Frees the native buffers of a <see cref="PackedFileList"/>.
+    /// </summary>
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void FreePackedFileList(ref PackedFileList list);
 }
 
 #endregion
@@ -269,6 +298,44 @@ public static class NativeWrapper
         }
     }
 
+    /// <summary>
+    /// Lists the files of <paramref name="directory"/> with one of the given extensions, already
+    /// sorted in Explorer's natural order. Enumeration, filtering and sorting all happen natively.
+    /// </summary>
+    /// <param name="directory">The folder to list (not recursive).</param>
+    /// <param name="extensions">Extensions including the dot, matched case-insensitively.</param>
+    /// <returns>The sorted full paths, or null if the native call failed.</returns>
+    public static unsafe List<string>? EnumerateImageFiles(string directory, IEnumerable<string> extensions)
+    {
+        NativeBridge.PackedFileList list = default;
+        try
+        {
+            var hresult = NativeBridge.EnumerateImageFiles(directory, string.Join(",", extensions), out list);
+            if (hresult < 0)
+            {
+                Logger.Error($"EnumerateImageFiles failed with HRESULT 0x{hresult:X8}");
+                return null;
+            }
+
+            var chars = (char*)list.Chars;
+            var offsets = (int*)list.Offsets;
+            var files = new List<string>(list.Count);
+            for (var i = 0; i < list.Count; i++)
+                files.Add(new string(chars, offsets[i], offsets[i + 1] - offsets[i]));
+            return files;
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, "NativeBridge - EnumerateImageFiles failed");
+            return null;
+        }
+        finally
+        {
+            if (list.Chars != IntPtr.Zero || list.Offsets != IntPtr.Zero)
+                NativeBridge.FreePackedFileList(ref list);
+        }
+    }
+
     /// <summary>
     /// Extracts the raw BGRA icon for a single UWP app via its AUMID, matching the scan quality.
     /// </summary>
@@ -0,0 +1,125 @@
+using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ CacheWarmState enum.
+/// </summary>
+public enum CacheWarmState
+{
+    Idle = 0,
+    Running = 1,
+    /// <summary>Held by <see cref="NativeCacheWarmerBridge.PauseCacheWarmer"/>.</summary>
+    Paused = 2,
+    /// <summary>Held because the power hook said warming may not run now.</summary>
+    PowerHold = 3,
+    /// <summary>The walk completed, or the generation limit was reached.</summary>
+    Finished = 4,
+    /// <summary>Stopped before the walk completed; the checkpoint lets a later run resume.</summary>
+    Stopped = 5,
+}
+
+/// <summary>
+/// C# equivalent of the C++ CacheWarmHooks struct. The callbacks run on the warmer's
+/// background threads.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal unsafe struct CacheWarmHooks
+{
+    /// <summary>Generates and stores the preview of a UTF-16 path; returns 1 if it was stored.</summary>
+    public delegate* unmanaged[Cdecl]<IntPtr, char*, byte> Generate;
+    /// <summary>Returns 1 if warming may run now. Optional.</summary>
+    public delegate* unmanaged[Cdecl]<IntPtr, byte> CanRun;
+    public IntPtr Context;
+}
+
+/// <summary>
+/// C# equivalent of the C++ CacheWarmOptions struct. Zero fields take the native defaults.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct CacheWarmOptions
+{
+    /// <summary>Worker threads; 0 for half the hardware threads.</summary>
+    public int Threads;
+    /// <summary>Non-zero to walk subdirectories too.</summary>
+    public int Recursive;
+    /// <summary>Source bytes per second handed to the generate hook; 0 for no limit.</summary>
+    public ulong MaxBytesPerSecond;
+    /// <summary>Stop after this many previews were generated; 0 for no limit.</summary>
+    public uint MaxGenerated;
+    /// <summary>Minimum time between checkpoint writes; 0 for 5 seconds.</summary>
+    public uint CheckpointIntervalMs;
+}
+
+/// <summary>
+/// C# equivalent of the C++ CacheWarmProgress struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct CacheWarmProgress
+{
+    /// <summary>Matching files listed so far (after the checkpoint, if resuming).</summary>
+    public ulong Discovered;
+    /// <summary>Files the store already held; skipped without a decode.</summary>
+    public ulong Cached;
+    public ulong Generated;
+    public ulong Failed;
+    /// <summary>Source bytes handed to the generate hook.</summary>
+    public ulong Bytes;
+    public CacheWarmState State;
+    /// <summary>1 once every directory has been listed, so <see cref="Discovered"/> is the total.</summary>
+    public int WalkComplete;
+}
+
+/// <summary>
+/// P/Invoke declarations for the native cache warmer in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeCacheWarmerBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>
+    /// Creates a warmer over a store from <see cref="NativeThumbnailStoreBridge.OpenThumbnailStore"/>,
+    /// which must stay open until the warmer is destroyed. Returns IntPtr.Zero on invalid input.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "CreateCacheWarmer")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial IntPtr CreateCacheWarmer(IntPtr store, in CacheWarmHooks hooks);
+
+    /// <summary>
+    /// Starts walking <paramref name="root"/>, ending any previous run first.
+    /// <paramref name="extensions"/> points to an array of UTF-16 string pointers.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "StartCacheWarmer", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static unsafe partial bool StartCacheWarmer(IntPtr handle, string root, IntPtr* extensions, int extensionCount,
+        string checkpointFile, in CacheWarmOptions options);
+
+    /// <summary>Holds the warmer after the files in progress.</summary>
+    [LibraryImport(DllName, EntryPoint = "PauseCacheWarmer")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void PauseCacheWarmer(IntPtr handle);
+
+    /// <summary>Lets a paused warmer continue.</summary>
+    [LibraryImport(DllName, EntryPoint = "ResumeCacheWarmer")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void ResumeCacheWarmer(IntPtr handle);
+
+    /// <summary>Ends the run and waits for the files in progress. Never call it from a hook.</summary>
+    [LibraryImport(DllName, EntryPoint = "StopCacheWarmer")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void StopCacheWarmer(IntPtr handle);
+
+    /// <summary>Gets the counters and state of the current or last run.</summary>
+    [LibraryImport(DllName, EntryPoint = "GetCacheWarmerProgress")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool GetCacheWarmerProgress(IntPtr handle, out CacheWarmProgress outProgress);
+
+    /// <summary>Stops the warmer and frees it.</summary>
+    [LibraryImport(DllName, EntryPoint = "DestroyCacheWarmer")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void DestroyCacheWarmer(IntPtr handle);
+}
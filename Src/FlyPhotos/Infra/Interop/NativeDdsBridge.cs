@@ -0,0 +1,64 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ DdsInfo struct. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct DdsInfo
+{
+    /// <summary>Of the top mip level.</summary>
+    public int Width;
+    public int Height;
+    /// <summary>Slices of a volume texture; 1 otherwise.</summary>
+    public int Depth;
+    public int MipCount;
+    /// <summary>Images in the file: array elements, times 6 for a cubemap.</summary>
+    public int ArraySize;
+    public int IsCubemap;
+    /// <summary>Legacy headers mapped to DXGI; 0 for other legacy bit masks.</summary>
+    public int DxgiFormat;
+    public int HasAlpha;
+    /// <summary>1 if <see cref="NativeDdsBridge.DecodeDdsMip" /> handles the pixel format.</summary>
+    public int CanDecode;
+    private int _reserved;
+}
+
+/// <summary>
+/// C# equivalent of the C++ DdsMip struct. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct DdsMip
+{
+    public int Level;
+    public int Width;
+    public int Height;
+    private int _reserved;
+}
+
+/// <summary>
+/// P/Invoke declarations for the native DDS texture decoder in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeDdsBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>
+    /// Reads a DDS header and picks the smallest mip level whose longer side is at least
+    /// <paramref name="maxDimension" />; 0 picks the top level.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "ReadDdsInfo", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool ReadDdsInfo(string path, int maxDimension, out DdsInfo info, out DdsMip mip);
+
+    /// <summary>
+    /// Decodes mip <paramref name="level" /> of image <paramref name="item" /> into <paramref name="bgra" />
+    /// as premultiplied BGRA. The buffer must be exactly the level's <c>Width * Height * 4</c> bytes.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "DecodeDdsMip", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static unsafe partial HeifError DecodeDdsMip(string path, int item, int level, byte* bgra, ulong size);
+}
@@ -0,0 +1,90 @@
+using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using Microsoft.Win32.SafeHandles;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ FolderIndexEntry struct. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct FolderIndexEntry
+{
+    /// <summary>File size in bytes.</summary>
+    public ulong FileSize;
+    /// <summary>Last write time as a Windows FILETIME (100 ns ticks since 1601, UTC).</summary>
+    public long LastWriteFileTime;
+    /// <summary>EXIF capture time in seconds since 1970 (camera local time, no zone). 0 if unknown.</summary>
+    public long CaptureTimeSeconds;
+    /// <summary>Stored pixel width, 0 if the format is not probed natively.</summary>
+    public int Width;
+    /// <summary>Stored pixel height, 0 if the format is not probed natively.</summary>
+    public int Height;
+    /// <summary>The detected container format.</summary>
+    public ProbedImageFormat Format;
+    /// <summary>EXIF-style orientation (1..8), 0 if unknown.</summary>
+    public int Orientation;
+}
+
+/// <summary>
+/// C# equivalent of the C++ FolderIndexRefreshStats struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct FolderIndexRefreshStats
+{
+    public int Total;
+    public int Reused;
+    public int Probed;
+    public int Removed;
+}
+
+/// <summary>
+/// An open folder index: the index file stays mapped until the handle is released. Lookups made
+/// through the handle keep it alive, so replacing the session's index while a prefetch worker is
+/// still reading it frees the old one only once that lookup returns.
+/// </summary>
+internal sealed class FolderIndexHandle : SafeHandleZeroOrMinusOneIsInvalid
+{
+    public FolderIndexHandle() : base(true) { }
+
+    protected override bool ReleaseHandle()
+    {
+        NativeFolderIndexBridge.CloseFolderIndex(handle);
+        return true;
+    }
+}
+
+/// <summary>
+/// P/Invoke declarations for the native per-folder metadata index in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeFolderIndexBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>
+    /// Refreshes the index of <paramref name="folder"/> stored at <paramref name="indexFile"/> and maps it.
+    /// <paramref name="extensions"/> points to an array of UTF-16 string pointers.
+    /// The handle is invalid on failure.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "OpenFolderIndex", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static unsafe partial FolderIndexHandle OpenFolderIndex(string folder, string indexFile, IntPtr* extensions,
+        int extensionCount, out FolderIndexRefreshStats outStats);
+
+    /// <summary>Gets the number of files in the index.</summary>
+    [LibraryImport(DllName, EntryPoint = "GetFolderIndexCount")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial int GetFolderIndexCount(FolderIndexHandle handle);
+
+    /// <summary>Looks up a file name (without directory) in the index.</summary>
+    [LibraryImport(DllName, EntryPoint = "LookupFolderIndexEntry", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool LookupFolderIndexEntry(FolderIndexHandle handle, string fileName, out FolderIndexEntry outEntry);
+
+    /// <summary>Unmaps the index and frees the native `FolderIndex`. Called by <see cref="FolderIndexHandle"/>.</summary>
+    [LibraryImport(DllName, EntryPoint = "CloseFolderIndex")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void CloseFolderIndex(IntPtr handle);
+}
@@ -0,0 +1,350 @@
+using System;
+using System.Collections.Generic;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Threading;
+using NLog;
+
+namespace FlyPhotos.Infra.Interop;
+
+#region P/Invoke Declarations
+
+/// <summary>
+/// C# equivalent of the C++ FlyHeifCapability flags reported by <c>GetFlyHeifApi</c>.
+/// </summary>
+[Flags]
+public enum FlyHeifCapabilities : uint
+{
+    None = 0,
+    /// <summary>A HEVC decoder is compiled in: .heic/.heif/.hif decode natively.</summary>
+    HevcDecoder = 1u << 0,
+    /// <summary>An AV1 decoder is compiled in: .avif decodes natively.</summary>
+    Av1Decoder = 1u << 1,
+    /// <summary>Animated AVIF/HEIF sequences can be played.</summary>
+    Sequences = 1u << 2,
+    /// <summary><see cref="FlyHeifDecodeOptions.ThreadCount"/> is honoured.</summary>
+    Threads = 1u << 3,
+    /// <summary><see cref="FlyHeifDecodeOptions.MaxWidth"/>/<see cref="FlyHeifDecodeOptions.MaxHeight"/> are honoured.</summary>
+    ScaledDecode = 1u << 4,
+    /// <summary>Reserved: high bit depth output.</summary>
+    HdrOutput = 1u << 5,
+    /// <summary>Reserved: sub-rectangle decode.</summary>
+    RegionDecode = 1u << 6
+}
+
+/// <summary>
+/// C# equivalent of the C++ SimdLevel enum.
+/// </summary>
+public enum SimdLevel
+{
+    Scalar = 0,
+    Sse2,
+    Sse41,
+    Avx2,
+    Neon
+}
+
+/// <summary>
+/// C# equivalent of the C++ FlyHeifDecodeOptions struct. Size-prefixed: always create it with
+/// <see cref="Create"/> so <see cref="StructSize"/> is set.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct FlyHeifDecodeOptions
+{
+    /// <summary>Decode the embedded thumbnail instead of the primary image when there is one.</summary>
+    public const uint FlagPreferThumbnail = 1u << 0;
+
+    public uint StructSize;
+    public uint Flags;
+    /// <summary>The output is scaled down to fit MaxWidth x MaxHeight. 0 = no limit.</summary>
+    public int MaxWidth;
+    /// <summary>See <see cref="MaxWidth"/>.</summary>
+    public int MaxHeight;
+    /// <summary>Decoder threads for this image. 0 = library default.</summary>
+    public int ThreadCount;
+
+    public static unsafe FlyHeifDecodeOptions Create() => new() { StructSize = (uint)sizeof(FlyHeifDecodeOptions) };
+}
+
+/// <summary>
+/// C# equivalent of the C++ DecodeReport struct: where one native decode spent its time and,
+/// on failure, the raw libheif error. Size-prefixed: create it with <see cref="Create"/>.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct DecodeReport
+{
+    public const uint FlagUsedThumbnail = 1u << 0;
+    public const uint FlagScaled = 1u << 1;
+    public const uint FlagAnimated = 1u << 2;
+
+    public uint StructSize;
+    /// <summary>The <see cref="HeifError"/> the export returned.</summary>
+    public HeifError Result;
+    /// <summary>libheif heif_error_code of the first failing call, 0 if none failed.</summary>
+    public int HeifErrorCode;
+    /// <summary>libheif heif_suberror_code of that call.</summary>
+    public int HeifErrorSubcode;
+    /// <summary>Reading the file and parsing the container.</summary>
+    public long OpenNs;
+    /// <summary>heif_decode_image, including libheif's own YCbCr to RGB conversion.</summary>
+    public long DecodeNs;
+    /// <summary>Conversions outside libheif (RGB expanded to RGBA).</summary>
+    public long ColorConvertNs;
+    public long ScaleNs;
+    /// <summary>Allocating and filling the output buffer.</summary>
+    public long CopyNs;
+    public long TotalNs;
+    /// <summary>Largest total of pixel buffers held at once; excludes decoder-internal memory.</summary>
+    public ulong PeakBytes;
+    /// <summary>Decoder threads requested; 0 = libheif default.</summary>
+    public int ThreadCount;
+    public int Width;
+    public int Height;
+    public uint Flags;
+
+    public static unsafe DecodeReport Create() => new() { StructSize = (uint)sizeof(DecodeReport) };
+
+    /// <summary>The name of the stage that took the longest.</summary>
+    public readonly string DominantStage
+    {
+        get
+        {
+            (string Name, long Ns)[] stages =
+                [("open", OpenNs), ("decode", DecodeNs), ("convert", ColorConvertNs), ("scale", ScaleNs), ("copy", CopyNs)];
+            var max = stages[0];
+            foreach (var stage in stages)
+                if (stage.Ns > max.Ns) max = stage;
+            return max.Name;
+        }
+    }
+
+    /// <summary>
+    /// A one-line summary for logs and the profiler CSV, e.g.
+    /// "decode 182.4ms (91%); open 3.1ms; convert 0.0ms; scale 0.0ms; copy 9.0ms; peak 191.3MB; threads 16".
+    /// </summary>
+    public readonly override string ToString()
+    {
+        static string Ms(long ns) => (ns / 1_000_000.0).ToString("0.0", System.Globalization.CultureInfo.InvariantCulture) + "ms";
+
+        var dominantNs = DominantStage switch
+        {
+            "open" => OpenNs, "decode" => DecodeNs, "convert" => ColorConvertNs, "scale" => ScaleNs, _ => CopyNs
+        };
+        var share = TotalNs > 0 ? dominantNs * 100 / TotalNs : 0;
+        var text = $"{DominantStage} {Ms(dominantNs)} ({share}%); open {Ms(OpenNs)}; decode {Ms(DecodeNs)}; " +
+                   $"convert {Ms(ColorConvertNs)}; scale {Ms(ScaleNs)}; copy {Ms(CopyNs)}; total {Ms(TotalNs)}; " +
+                   $"peak {PeakBytes / (1024.0 * 1024.0):0.0}MB; threads {ThreadCount}; {Width}x{Height}";
+        if ((Flags & FlagUsedThumbnail) != 0) text += "; thumbnail";
+        if (Result != HeifError.Ok)
+            text += $"; {Result} (libheif {HeifErrorCode}/{HeifErrorSubcode})";
+        return text;
+    }
+}
+
+/// <summary>
+/// C# equivalent of the C++ FlyHeifApi function table. Must match the native layout exactly;
+/// only ever read through a pointer to the native static instance.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal unsafe struct FlyHeifApiTable
+{
+    public uint StructSize;
+    public uint Version;
+    public FlyHeifCapabilities Capabilities;
+    public SimdLevel SimdLevel;
+    public int MaxThreads;
+    public uint LibheifVersion;
+
+    public delegate* unmanaged[Cdecl]<char*, FlyHeifDecodeOptions*, NativeHeifBridge.PixelBuffer*, HeifError> DecodeFile;
+    public delegate* unmanaged[Cdecl]<byte*, nuint, FlyHeifDecodeOptions*, NativeHeifBridge.PixelBuffer*, byte*, HeifError> DecodeMemory;
+    public delegate* unmanaged[Cdecl]<NativeHeifBridge.PixelBuffer*, void> FreePixelBuffer;
+    public delegate* unmanaged[Cdecl]<char*, ImageProbeInfo*, byte> ProbeImage;
+    public delegate* unmanaged[Cdecl]<DecodeReport*, byte> GetLastReport;
+}
+
+/// <summary>
+/// P/Invoke declaration for the versioned API entry point of FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeHeifApiBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>The table version this app was built against.</summary>
+    public const uint ApiVersion = 1;
+
+    /// <summary>
+    /// Returns a pointer to the static function table for <paramref name="version"/>,
+    /// or IntPtr.Zero if the DLL does not support that version.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "GetFlyHeifApi")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial IntPtr GetFlyHeifApi(uint version);
+}
+
+#endregion
+
+/// <summary>
+/// Capabilities and decode entry points of FlyNativeLibHeif, resolved once per process.
+/// Readers consult this to choose a decode path up front instead of trying the native
+/// decoder and falling back when it fails.
+/// </summary>
+internal static unsafe class NativeHeifApi
+{
+    private static readonly Logger Logger = LogManager.GetCurrentClassLogger();
+
+    private static readonly FlyHeifApiTable* Table = Resolve();
+
+    private static readonly AsyncLocal<DecodeReportCapture> ActiveCapture = new();
+
+    /// <summary>True if the DLL exposes the versioned table. False for an older DLL.</summary>
+    public static bool IsAvailable => Table != null;
+
+    /// <summary>
+    /// The capabilities reported by the DLL. An older DLL without the table is assumed to
+    /// have both decoders, which is how it was always shipped.
+    /// </summary>
+    public static FlyHeifCapabilities Capabilities => Table != null
+        ? Table->Capabilities
+        : FlyHeifCapabilities.HevcDecoder | FlyHeifCapabilities.Av1Decoder | FlyHeifCapabilities.Sequences;
+
+    public static SimdLevel SimdLevel => Table != null ? Table->SimdLevel : SimdLevel.Scalar;
+
+    /// <summary>
+    /// The thread count to request for a full-resolution decode that runs on its own, such as the
+    /// first photo's. Prefetch decodes already run in parallel and leave libheif at its default.
+    /// </summary>
+    public static int PreferredThreadCount => Table != null && Capabilities.HasFlag(FlyHeifCapabilities.Threads)
+        ? Table->MaxThreads
+        : 0;
+
+    /// <summary>
+    /// Whether the native decoder can handle a file with the given extension (".AVIF" needs
+    /// AV1, the HEIF family needs HEVC).
+    /// </summary>
+    public static bool CanDecode(string extension)
+    {
+        var needed = string.Equals(extension, ".AVIF", StringComparison.OrdinalIgnoreCase)
+            ? FlyHeifCapabilities.Av1Decoder
+            : FlyHeifCapabilities.HevcDecoder;
+        return Capabilities.HasFlag(needed);
+    }
+
+    /// <summary>
+    /// Forces the table to be resolved and logs what was found. Called once at startup so the
+    /// first decode does not pay for it.
+    /// </summary>
+    public static void Initialize()
+    {
+        if (Table == null) return;
+        var v = Table->LibheifVersion;
+        Logger.Info($"FlyNativeLibHeif API v{Table->Version}: {Table->Capabilities}, SIMD {Table->SimdLevel}, " +
+                    $"{Table->MaxThreads} threads, libheif {v >> 24}.{(v >> 16) & 0xFF}.{(v >> 8) & 0xFF}");
+    }
+
+    /// <summary>Decodes a file through the table. Only valid when <see cref="IsAvailable"/>.</summary>
+    public static HeifError DecodeFile(string path, FlyHeifDecodeOptions options, out NativeHeifBridge.PixelBuffer buffer)
+    {
+        buffer = default;
+        fixed (char* pathPtr = path)
+        fixed (NativeHeifBridge.PixelBuffer* bufferPtr = &buffer)
+        {
+            var result = Table->DecodeFile(pathPtr, &options, bufferPtr);
+            CollectReport();
+            return result;
+        }
+    }
+
+    /// <summary>Decodes in-memory file data through the table. Only valid when <see cref="IsAvailable"/>.</summary>
+    public static HeifError DecodeMemory(byte[] data, FlyHeifDecodeOptions options,
+        out NativeHeifBridge.PixelBuffer buffer, out bool isAnimated)
+    {
+        buffer = default;
+        byte animated = 0;
+        HeifError result;
+        fixed (byte* dataPtr = data)
+        fixed (NativeHeifBridge.PixelBuffer* bufferPtr = &buffer)
+        {
+            result = Table->DecodeMemory(dataPtr, (nuint)data.Length, &options, bufferPtr, &animated);
+            CollectReport();
+        }
+        isAnimated = animated != 0;
+        return result;
+    }
+
+    /// <summary>Frees a buffer returned by <see cref="DecodeFile"/> or <see cref="DecodeMemory"/>.</summary>
+    public static void FreePixelBuffer(ref NativeHeifBridge.PixelBuffer buffer)
+    {
+        fixed (NativeHeifBridge.PixelBuffer* bufferPtr = &buffer)
+            Table->FreePixelBuffer(bufferPtr);
+    }
+
+    /// <summary>
+    /// Starts collecting the native <see cref="DecodeReport"/> of every decode made through this
+    /// class by the current async flow, until the returned capture is disposed. Used by the profiler;
+    /// concurrent decodes on other flows are not collected.
+    /// </summary>
+    public static DecodeReportCapture BeginReportCapture()
+    {
+        var capture = new DecodeReportCapture(ActiveCapture.Value);
+        ActiveCapture.Value = capture;
+        return capture;
+    }
+
+    // The native report is per thread, so it must be read right after the call, before any await.
+    private static void CollectReport()
+    {
+        var capture = ActiveCapture.Value;
+        if (capture == null || !TableHas(&Table->GetLastReport) || Table->GetLastReport == null) return;
+        var report = DecodeReport.Create();
+        if (Table->GetLastReport(&report) != 0)
+            capture.Reports.Add(report);
+    }
+
+    /// <summary>
+    /// The reports collected between <see cref="BeginReportCapture"/> and <see cref="Dispose"/>.
+    /// </summary>
+    public sealed class DecodeReportCapture : IDisposable
+    {
+        private readonly DecodeReportCapture _previous;
+
+        internal DecodeReportCapture(DecodeReportCapture previous) => _previous = previous;
+
+        public List<DecodeReport> Reports { get; } = [];
+
+        /// <summary>The last report, or null if no native decode ran.</summary>
+        public DecodeReport? Last => Reports.Count > 0 ? Reports[^1] : null;
+
+        public void Dispose() => ActiveCapture.Value = _previous;
+    }
+
+    // Members after ProbeImage were appended to the version 1 table later, so an older DLL's table
+    // ends before them. Check with this before reading one.
+    private static bool TableHas(void* member) => (byte*)member + sizeof(nint) <= (byte*)Table + Table->StructSize;
+
+    private static FlyHeifApiTable* Resolve()
+    {
+        try
+        {
+            var table = (FlyHeifApiTable*)NativeHeifApiBridge.GetFlyHeifApi(NativeHeifApiBridge.ApiVersion);
+            // The table only grows at the end, so any version 1 DLL reaches at least ProbeImage.
+            FlyHeifApiTable layout = default;
+            var v1Size = (uint)((byte*)&layout.GetLastReport - (byte*)&layout);
+            if (table == null || table->StructSize < v1Size)
+            {
+                Logger.Warn("FlyNativeLibHeif does not provide API version {0}", NativeHeifApiBridge.ApiVersion);
+                return null;
+            }
+            return table;
+        }
+        catch (EntryPointNotFoundException)
+        {
+            // An older DLL: keep using the individual exports.
+            return null;
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, "Failed to resolve the FlyNativeLibHeif API table");
+            return null;
+        }
+    }
+}
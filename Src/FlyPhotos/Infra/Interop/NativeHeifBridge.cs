@@ -193,11 +193,19 @@ public static class NativeHeifWrapper
     /// Handles calling the native DLL, copying data to managed memory, and freeing native resources.
     /// </summary>
     /// <param name="filePath">The full path to the .heic, .heif or .hif file.</param>
+    /// <param name="threadCount">Threads libheif may use for the tiles of a grid image; 0 for its default.</param>
     /// <returns>A <see cref="HeifImage"/> object containing the decoded RGBA pixel data and dimensions, or null if the image data is empty.</returns>
     /// <exception cref="Exception">Thrown if the native DLL returns an error code during decoding,
     /// indicating issues like file not found, decoding errors, or no primary image.</exception>
-    public static HeifImage DecodePrimaryImage(string filePath)
+    public static HeifImage DecodePrimaryImage(string filePath, int threadCount = 0)
     {
+        if (NativeHeifApi.IsAvailable)
+        {
+            var options = FlyHeifDecodeOptions.Create();
+            options.ThreadCount = threadCount;
+            return DecodeWithOptions(filePath, options, "primary image");
+        }
+
         HeifError result = NativeHeifBridge.ExtractPrimaryImage(filePath, out NativeHeifBridge.PixelBuffer buffer);
 
         if (result != HeifError.Ok)
@@ -238,6 +246,16 @@ public static class NativeHeifWrapper
     /// indicating issues like file not found, decoding errors, or no thumbnail found.</exception>
     public static HeifImage DecodeThumbnail(string filePath)
     {
+        if (NativeHeifApi.IsAvailable)
+        {
+            // Same contract as ExtractThumbnail: the embedded thumbnail if present, otherwise
+            // the primary image scaled to fit 800 x 800.
+            var options = FlyHeifDecodeOptions.Create();
+            options.Flags = FlyHeifDecodeOptions.FlagPreferThumbnail;
+            options.MaxWidth = options.MaxHeight = ThumbnailMaxSide;
+            return DecodeWithOptions(filePath, options, "thumbnail");
+        }
+
         HeifError result = NativeHeifBridge.ExtractThumbnail(filePath, out NativeHeifBridge.PixelBuffer buffer);
 
         if (result != HeifError.Ok)
@@ -274,12 +292,23 @@ public static class NativeHeifWrapper
     /// </summary>
     /// <param name="fileData">The raw byte array containing the entire file.</param>
     /// <param name="isAnimated">Output parameter indicating whether the sequence has animation tracks.</param>
+    /// <param name="threadCount">Threads libheif may use for the tiles of a grid image; 0 for its default.</param>
     /// <returns>A <see cref="HeifImage"/> object containing the decoded RGBA pixel data and dimensions, or null if empty.</returns>
-    public static HeifImage DecodePrimaryImageFromMemory(byte[] fileData, out bool isAnimated)
+    public static HeifImage DecodePrimaryImageFromMemory(byte[] fileData, out bool isAnimated, int threadCount = 0)
     {
         isAnimated = false;
         if (fileData == null || fileData.Length == 0) return null;
 
+        if (NativeHeifApi.IsAvailable)
+        {
+            var options = FlyHeifDecodeOptions.Create();
+            options.ThreadCount = threadCount;
+            HeifError apiResult = NativeHeifApi.DecodeMemory(fileData, options,
+                out NativeHeifBridge.PixelBuffer apiBuffer, out isAnimated);
+            // Soft fail, as below: the caller deals with null.
+            return apiResult == HeifError.Ok ? CopyAndFree(ref apiBuffer) : null;
+        }
+
         // Briefly pin the byte array so we can pass its pointer to C++
         GCHandle pinnedData = GCHandle.Alloc(fileData, GCHandleType.Pinned);
         try
@@ -330,4 +359,48 @@ public static class NativeHeifWrapper
                 pinnedData.Free();
         }
     }
-}
\ No newline at end of file
+
+    /// <summary>Longest side of a generated thumbnail, matching the native ExtractThumbnail.</summary>
+    private const int ThumbnailMaxSide = 800;
+
+    /// <summary>
+    /// Decodes through the versioned native API table with the given options.
+    /// </summary>
+    /// <exception cref="Exception">Thrown if the native decoder returns an error code.</exception>
+    private static HeifImage DecodeWithOptions(string filePath, FlyHeifDecodeOptions options, string what)
+    {
+        HeifError result = NativeHeifApi.DecodeFile(filePath, options, out NativeHeifBridge.PixelBuffer buffer);
+
+        if (result != HeifError.Ok)
+            throw new Exception($"Native HEIF decoder failed to decode {what}. Error: {result}");
+
+        return CopyAndFree(ref buffer);
+    }
+
+    /// <summary>
+    /// Copies a native buffer returned through the API table into a <see cref="HeifImage"/> and frees it.
+    /// </summary>
+    private static HeifImage CopyAndFree(ref NativeHeifBridge.PixelBuffer buffer)
+    {
+        try
+        {
+            if (buffer.data == IntPtr.Zero || buffer.dataSize == 0)
+                return null;
+
+            byte[] managedPixels = GC.AllocateUninitializedArray<byte>(buffer.dataSize);
+            Marshal.Copy(buffer.data, managedPixels, 0, buffer.dataSize);
+            return new HeifImage
+            {
+                Pixels = managedPixels,
+                Width = buffer.width,
+                Height = buffer.height,
+                PrimaryImageWidth = buffer.primaryImageWidth,
+                PrimaryImageHeight = buffer.primaryImageHeight
+            };
+        }
+        finally
+        {
+            NativeHeifApi.FreePixelBuffer(ref buffer);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ IcoEntry struct. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct IcoEntry
+{
+    /// <summary>Position in the directory; what <see cref="NativeIcoBridge.DecodeIcoEntry" /> takes.</summary>
+    public int Index;
+    /// <summary>From the DIB or PNG header, not the directory.</summary>
+    public int Width;
+    public int Height;
+    /// <summary>Bits per pixel; for PNG, bit depth times channels.</summary>
+    public int BitCount;
+    public int IsPng;
+    /// <summary>Cursors only; 0 for icons.</summary>
+    public int HotspotX;
+    public int HotspotY;
+    /// <summary>1 if <see cref="NativeIcoBridge.DecodeIcoEntry" /> handles the entry.</summary>
+    public int CanDecode;
+}
+
+/// <summary>
+/// C# equivalent of the C++ IcoInfo struct. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct IcoInfo
+{
+    /// <summary>1 for an icon, 2 for a cursor.</summary>
+    public int Type;
+    public int EntryCount;
+    /// <summary>Directory index of the entry picked for the requested size.</summary>
+    public int Selected;
+    public int Width;
+    public int Height;
+    private int _reserved;
+}
+
+/// <summary>
+/// P/Invoke declarations for the native ICO/CUR decoder in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeIcoBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>
+    /// Reads the directory and picks the entry to show at <paramref name="size" /> pixels (0 for the
+    /// largest) without decoding any entry. Up to <paramref name="capacity" /> entries are written to
+    /// <paramref name="entries" />, largest first.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "ReadIcoInfo", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static unsafe partial bool ReadIcoInfo(string path, int size, out IcoInfo info, IcoEntry* entries, int capacity);
+
+    /// <summary>
+    /// Decodes entry <paramref name="index" /> into <paramref name="bgra" /> as premultiplied BGRA. The
+    /// buffer must be exactly the entry's <c>Width * Height * 4</c> bytes.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "DecodeIcoEntry", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static unsafe partial HeifError DecodeIcoEntry(string path, int index, byte* bgra, ulong size);
+}
@@ -0,0 +1,68 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ JpegInfo struct. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct JpegInfo
+{
+    /// <summary>As displayed, after the EXIF orientation.</summary>
+    public int Width;
+    public int Height;
+    /// <summary>1-8, as in EXIF. Applied by <see cref="NativeJpegBridge.DecodeJpeg" />.</summary>
+    public int Orientation;
+    public int Components;
+    public int Progressive;
+    /// <summary>MCUs between restart markers; 0 if there are none.</summary>
+    public int RestartInterval;
+    /// <summary>Of the EXIF thumbnail as displayed; 0 if there is none.</summary>
+    public int ThumbnailWidth;
+    public int ThumbnailHeight;
+    /// <summary>1 if <see cref="NativeJpegBridge.DecodeJpeg" /> handles the main image.</summary>
+    public int CanDecode;
+    private int _reserved;
+}
+
+/// <summary>
+/// C# equivalent of the C++ JpegScale struct. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct JpegScale
+{
+    /// <summary>1 for the EXIF thumbnail, 0 for the main image.</summary>
+    public int Thumbnail;
+    /// <summary>IDCT scale of the main image: 1, 2, 4 or 8.</summary>
+    public int Denominator;
+    /// <summary>Of the output, as displayed; 0 if there is nothing to decode.</summary>
+    public int Width;
+    public int Height;
+}
+
+/// <summary>
+/// P/Invoke declarations for the native JPEG decoder in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeJpegBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>
+    /// Reads a JPEG's headers and picks the cheapest source whose longer side is at least
+    /// <paramref name="maxDimension" />: the EXIF thumbnail or a reduced IDCT scale. 0 picks the full image.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "ReadJpegInfo", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool ReadJpegInfo(string path, int maxDimension, out JpegInfo info, out JpegScale scale);
+
+    /// <summary>
+    /// Decodes the source <paramref name="thumbnail" /> and <paramref name="denominator" /> name into
+    /// <paramref name="bgra" /> as opaque BGRA, oriented. The buffer must be exactly the scale's
+    /// <c>Width * Height * 4</c> bytes.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "DecodeJpeg", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static unsafe partial HeifError DecodeJpeg(string path, int thumbnail, int denominator, byte* bgra, ulong size);
+}
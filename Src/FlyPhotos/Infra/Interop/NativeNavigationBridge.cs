@@ -0,0 +1,85 @@
+using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ NavigationKind enum.
+/// </summary>
+internal enum NavigationKind
+{
+    /// <summary>A single step: arrow key, wheel, button.</summary>
+    Step = 0,
+    /// <summary>A step while a navigation key is held.</summary>
+    Repeat = 1,
+    /// <summary>Thumbnail click, first/last, page, or opening the folder.</summary>
+    Jump = 2,
+}
+
+/// <summary>
+/// C# equivalent of the C++ NavigationMode enum.
+/// </summary>
+internal enum NavigationMode
+{
+    Balanced = 0,
+    Sequential = 1,
+    Burst = 2,
+    Random = 3,
+}
+
+/// <summary>
+/// C# equivalent of the C++ NavigationEvent struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct NavigationEvent
+{
+    public long TimeMs;
+    public int Position;
+    public NavigationKind Kind;
+}
+
+/// <summary>
+/// C# equivalent of the C++ PrefetchPlan struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct PrefetchPlan
+{
+    /// <summary>-1 or 1 to lean the window that way; 0 for symmetric.</summary>
+    public int Direction;
+    public NavigationMode Mode;
+    public int PreviewAhead;
+    public int PreviewBehind;
+    public int HqAhead;
+    public int HqBehind;
+    public int BehindWeight;
+    /// <summary>0-100: how steady the sequential browsing is.</summary>
+    public int Confidence;
+}
+
+/// <summary>
+/// P/Invoke declarations for the native navigation predictor in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeNavigationBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    [LibraryImport(DllName, EntryPoint = "CreateNavigationPredictor")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial IntPtr CreateNavigationPredictor(int previewRadius, int hqRadius);
+
+    /// <summary>Records a navigation and returns the plan for the window around its position.</summary>
+    [LibraryImport(DllName, EntryPoint = "RecordNavigation")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool RecordNavigation(IntPtr handle, in NavigationEvent navigation, int previewRadius,
+        int hqRadius, out PrefetchPlan plan);
+
+    [LibraryImport(DllName, EntryPoint = "ResetNavigationPredictor")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void ResetNavigationPredictor(IntPtr handle);
+
+    [LibraryImport(DllName, EntryPoint = "DestroyNavigationPredictor")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void DestroyNavigationPredictor(IntPtr handle);
+}
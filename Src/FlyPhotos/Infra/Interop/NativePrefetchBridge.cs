@@ -0,0 +1,183 @@
+using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ PrefetchTier enum.
+/// </summary>
+internal enum PrefetchTier
+{
+    Preview = 0,
+    Hq = 1,
+    /// <summary>Writes a decoded preview to the disk cache; holds no memory.</summary>
+    DiskWrite = 2,
+}
+
+/// <summary>
+/// C# equivalent of the C++ PrefetchHooks struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal unsafe struct PrefetchHooks
+{
+    /// <summary>Loads a key for a tier on a worker thread; returns the bytes held, or a load code.</summary>
+    public delegate* unmanaged[Cdecl]<IntPtr, int, int, long> Load;
+    /// <summary>Frees a result that left the window, on the thread that moved the window.</summary>
+    public delegate* unmanaged[Cdecl]<IntPtr, int, int, void> Release;
+    /// <summary>Reports a recorded result on the worker thread. Optional.</summary>
+    public delegate* unmanaged[Cdecl]<IntPtr, int, int, void> Loaded;
+    public IntPtr Context;
+}
+
+/// <summary>
+/// C# equivalent of the C++ PrefetchOptions struct. Zero fields take the native defaults.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct PrefetchOptions
+{
+    public int Threads;
+    public uint Reserved;
+    public ulong MemoryBudget;
+    public ulong PreviewEstimate;
+    public ulong HqEstimate;
+    /// <summary>Bytes HQ bitmaps may hold, at most <see cref="MemoryBudget"/>; 0 for all of it.</summary>
+    public ulong HqBudget;
+    /// <summary>Physical memory HQ bitmaps leave available; 0 for a tenth of it, at least 512 MB.</summary>
+    public ulong SystemReserve;
+}
+
+/// <summary>
+/// C# equivalent of the C++ PrefetchWindow struct. With <see cref="Direction"/> 0 the radii apply to
+/// both sides; otherwise they are the radii ahead and the <c>Behind</c> fields those behind.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct PrefetchWindow
+{
+    public int Centre;
+    /// <summary>Position of the first key passed with the window.</summary>
+    public int First;
+    public int PreviewRadius;
+    public int HqRadius;
+    public int Burst;
+    /// <summary>-1 or 1 from a <see cref="PrefetchPlan"/>, or 0 to derive it from successive centres.</summary>
+    public int Direction;
+    public int PreviewBehind;
+    public int HqBehind;
+    /// <summary>Rank multiplier for photos behind; 0 for the scheduler's default.</summary>
+    public int BehindWeight;
+}
+
+/// <summary>
+/// C# equivalent of the C++ ResidencyStats struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct ResidencyStats
+{
+    public ulong ResidentBytes;
+    public ulong Budget;
+    /// <summary>The budget after the available-memory cap.</summary>
+    public ulong EffectiveBudget;
+    public ulong AvailablePhysical;
+    public ulong EvictedBytes;
+    public uint ResidentCount;
+    public uint Evictions;
+}
+
+/// <summary>
+/// C# equivalent of the C++ PrefetchStats struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct PrefetchStats
+{
+    public ulong ResidentBytes;
+    public ulong InFlightBytes;
+    public ulong MemoryBudget;
+    public int Pending;
+    public int Running;
+    public int Direction;
+    public int HeldByMemory;
+    public ResidencyStats Hq;
+}
+
+/// <summary>
+/// P/Invoke declarations for the native prefetch scheduler in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativePrefetchBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>Return value of the load hook: nothing was loaded; tried again after the window moves.</summary>
+    public const long LoadDropped = -1;
+
+    /// <summary>Return value of the load hook: the result was stale; loaded again if still in the window.</summary>
+    public const long LoadRetry = -2;
+
+    /// <summary>Creates a scheduler whose workers are not started yet. Returns IntPtr.Zero on invalid hooks.</summary>
+    [LibraryImport(DllName, EntryPoint = "CreatePrefetchScheduler")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial IntPtr CreatePrefetchScheduler(in PrefetchHooks hooks, in PrefetchOptions options);
+
+    [LibraryImport(DllName, EntryPoint = "StartPrefetchScheduler")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void StartPrefetchScheduler(IntPtr handle);
+
+    /// <summary>
+    /// Re-centres the window on <paramref name="count"/> keys starting at position
+    /// <see cref="PrefetchWindow.First"/>. Calls the release hook before returning.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "MovePrefetchWindow")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static unsafe partial void MovePrefetchWindow(IntPtr handle, in PrefetchWindow window, int* keys, int count);
+
+    /// <summary>Ends a burst so held HQ loads run. May call the release hook before returning.</summary>
+    [LibraryImport(DllName, EntryPoint = "EndPrefetchBurst")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void EndPrefetchBurst(IntPtr handle);
+
+    [LibraryImport(DllName, EntryPoint = "QueuePrefetchDiskWrite")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void QueuePrefetchDiskWrite(IntPtr handle, int key);
+
+    [LibraryImport(DllName, EntryPoint = "MarkPrefetchLoaded")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void MarkPrefetchLoaded(IntPtr handle, int key, PrefetchTier tier, ulong bytes);
+
+    [LibraryImport(DllName, EntryPoint = "UnloadPrefetch")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void UnloadPrefetch(IntPtr handle, int key, PrefetchTier tier);
+
+    /// <summary>Tells the scheduler how many bytes the key's HQ bitmap will hold.</summary>
+    [LibraryImport(DllName, EntryPoint = "SetPrefetchHqSizeHint")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void SetPrefetchHqSizeHint(IntPtr handle, int key, ulong bytes);
+
+    [LibraryImport(DllName, EntryPoint = "ForgetPrefetchKey")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void ForgetPrefetchKey(IntPtr handle, int key);
+
+    [LibraryImport(DllName, EntryPoint = "IsPrefetchLoaded")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool IsPrefetchLoaded(IntPtr handle, int key, PrefetchTier tier);
+
+    [LibraryImport(DllName, EntryPoint = "CountPrefetchLoaded")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool CountPrefetchLoaded(IntPtr handle, PrefetchTier tier, int pivot, out int below, out int above);
+
+    [LibraryImport(DllName, EntryPoint = "GetPrefetchStats")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool GetPrefetchStats(IntPtr handle, out PrefetchStats stats);
+
+    /// <summary>Keeps queued loads from starting and returns without waiting for the loads in progress.</summary>
+    [LibraryImport(DllName, EntryPoint = "CancelPrefetchScheduler")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void CancelPrefetchScheduler(IntPtr handle);
+
+    /// <summary>Stops the workers after the loads in progress and frees the scheduler. Never call it from a hook.</summary>
+    [LibraryImport(DllName, EntryPoint = "DestroyPrefetchScheduler")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void DestroyPrefetchScheduler(IntPtr handle);
+}
@@ -0,0 +1,99 @@
+using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using NLog;
+
+namespace FlyPhotos.Infra.Interop;
+
+#region P/Invoke Declarations
+
+/// <summary>
+/// C# equivalent of the C++ ImageFormat enum reported by the native header probe.
+/// </summary>
+public enum ProbedImageFormat
+{
+    Unknown = 0,
+    Jpeg,
+    Png,
+    Gif,
+    WebP,
+    Heif,
+    Avif,
+    Psd,
+    Dds,
+    Ico,
+    Bmp
+}
+
+/// <summary>
+/// C# equivalent of the C++ ImageProbeInfo struct. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct ImageProbeInfo
+{
+    /// <summary>The detected container format.</summary>
+    public ProbedImageFormat Format;
+    /// <summary>Stored pixel width, before orientation is applied.</summary>
+    public int Width;
+    /// <summary>Stored pixel height, before orientation is applied.</summary>
+    public int Height;
+    /// <summary>EXIF-style orientation (1..8). HEIF irot/imir transforms are mapped onto it.</summary>
+    public int Orientation;
+
+    /// <summary>
+    /// True when the orientation swaps the axes (EXIF 5..8), i.e. the image is displayed
+    /// with width and height exchanged.
+    /// </summary>
+    public readonly bool SwapsAxes => Orientation >= 5 && Orientation <= 8;
+
+    /// <summary>The size of the image as displayed, with orientation applied.</summary>
+    public readonly (int Width, int Height) DisplaySize => SwapsAxes ? (Height, Width) : (Width, Height);
+}
+
+/// <summary>
+/// P/Invoke declarations for the header-only image probe in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeProbeBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>
+    /// Reads an image's dimensions and orientation from its header without decoding any pixels.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "ProbeImage", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool ProbeImage(string path, out ImageProbeInfo outInfo);
+}
+
+#endregion
+
+/// <summary>
+/// Managed wrapper over the native header probe. Used to size and orient photos for layout
+/// before any preview has been decoded.
+/// </summary>
+public static class NativeImageProbe
+{
+    private static readonly Logger Logger = LogManager.GetCurrentClassLogger();
+
+    /// <summary>
+    /// Probes a single file.
+    /// </summary>
+    /// <param name="filePath">Full path to the image.</param>
+    /// <param name="info">The probe result, or default when the file could not be probed.</param>
+    /// <returns>True if the format was recognised and the dimensions were read.</returns>
+    public static bool TryProbe(string filePath, out ImageProbeInfo info)
+    {
+        info = default;
+        if (string.IsNullOrEmpty(filePath)) return false;
+        try
+        {
+            return NativeProbeBridge.ProbeImage(filePath, out info);
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, "NativeImageProbe.TryProbe failed for {0}", filePath);
+            return false;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ PsdInfo struct. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct PsdInfo
+{
+    public int Width;
+    public int Height;
+    public int Channels;
+    /// <summary>Bits per channel: 1, 8, 16 or 32.</summary>
+    public int Depth;
+    /// <summary>As the header stores it: 1 grayscale, 3 RGB, 4 CMYK, 8 duotone...</summary>
+    public int ColorMode;
+    /// <summary>1 for PSD, 2 for PSB.</summary>
+    public int Version;
+    /// <summary>Of the composite: 0 raw, 1 RLE, 2 and 3 ZIP.</summary>
+    public int Compression;
+    /// <summary>1 if the composite carries its transparency.</summary>
+    public int HasAlpha;
+    /// <summary>1 if <see cref="NativePsdBridge.DecodePsdComposite" /> handles the composite.</summary>
+    public int CanDecode;
+    public int ThumbnailWidth;
+    public int ThumbnailHeight;
+    private int _reserved;
+    /// <summary>File offset of the thumbnail's JPEG data.</summary>
+    public long ThumbnailOffset;
+    /// <summary>Bytes of JPEG data; 0 if there is none.</summary>
+    public long ThumbnailSize;
+}
+
+/// <summary>
+/// P/Invoke declarations for the native PSD/PSB parser in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativePsdBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>
+    /// Reads a PSD or PSB's header and finds its JPEG thumbnail by walking the file's sections.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "ReadPsdInfo", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool ReadPsdInfo(string path, out PsdInfo info);
+
+    /// <summary>
+    /// Decodes the merged composite into <paramref name="bgra" /> as premultiplied BGRA. The buffer
+    /// must be exactly <c>Width * Height * 4</c> bytes, as reported by <see cref="ReadPsdInfo" />.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "DecodePsdComposite", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static unsafe partial HeifError DecodePsdComposite(string path, byte* bgra, ulong size);
+}
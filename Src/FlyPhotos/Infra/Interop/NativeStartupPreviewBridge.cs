@@ -0,0 +1,121 @@
+#nullable enable
+using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ StartupPreviewFlags enum.
+/// </summary>
+[Flags]
+internal enum StartupPreviewFlags : uint
+{
+    None = 0,
+    /// <summary>Open the thumbnail store and look the file up.</summary>
+    UseCache = 1 << 0,
+    /// <summary>Decode a preview natively on a cache miss (HEIF and AVIF embedded thumbnails).</summary>
+    UseEmbedded = 1 << 1,
+}
+
+/// <summary>
+/// C# equivalent of the C++ StartupPreviewKind enum.
+/// </summary>
+internal enum StartupPreviewKind
+{
+    /// <summary>Only the probe; the managed readers load the preview.</summary>
+    None = 0,
+    /// <summary>A pinned thumbnail store entry.</summary>
+    Cached = 1,
+    /// <summary>A decoded RGBA preview.</summary>
+    Pixels = 2,
+}
+
+/// <summary>
+/// C# equivalent of the C++ StartupPreviewOptions struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct StartupPreviewOptions
+{
+    public StartupPreviewFlags Flags;
+    public uint StoreMaxEntries;
+    public ulong StoreMaxBytes;
+}
+
+/// <summary>
+/// C# equivalent of the C++ StartupPixels struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct StartupPixels
+{
+    public IntPtr Data;
+    public int Size;
+    public int Width;
+    public int Height;
+    /// <summary>Size of the full image the preview was made from.</summary>
+    public int FullWidth;
+    public int FullHeight;
+}
+
+/// <summary>
+/// C# equivalent of the C++ StartupPreviewResult struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct StartupPreviewResult
+{
+    public StartupPreviewKind Kind;
+    /// <summary>1 if <see cref="Probe"/> is valid.</summary>
+    public int Probed;
+    public ImageProbeInfo Probe;
+    public long Mtime;
+    /// <summary>For <see cref="StartupPreviewKind.Cached"/>: release through the claimed store.</summary>
+    public ThumbnailView View;
+    /// <summary>For <see cref="StartupPreviewKind.Pixels"/>: freed by FreeStartupPreview.</summary>
+    public StartupPixels Pixels;
+    /// <summary>Time from BeginStartupPreview until the result was parked.</summary>
+    public uint ReadyMs;
+    /// <summary>Time ClaimStartupPreview waited for it.</summary>
+    public uint WaitedMs;
+}
+
+/// <summary>
+/// P/Invoke declarations for the speculative startup load in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeStartupPreviewBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>Starts the load of the launch photo on a native thread.</summary>
+    /// <param name="storeFolder">The thumbnail store's folder, or null to skip the cache.</param>
+    [LibraryImport(DllName, EntryPoint = "BeginStartupPreview", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool BeginStartupPreview(string path, string? storeFolder, in StartupPreviewOptions options);
+
+    /// <summary>
+    /// Takes over the thumbnail store the startup load opened, waiting for the open to finish. The
+    /// handle is used and closed like one from <see cref="NativeThumbnailStoreBridge.OpenThumbnailStore"/>;
+    /// zero if there is none.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "ClaimStartupThumbnailStore")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial IntPtr ClaimStartupThumbnailStore();
+
+    /// <summary>
+    /// Takes the result of the startup load of <paramref name="path"/>. A cached view MUST be released
+    /// through the claimed store, and the result then passed to <see cref="FreeStartupPreview"/>.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "ClaimStartupPreview", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool ClaimStartupPreview(string path, uint timeoutMs, out StartupPreviewResult result);
+
+    [LibraryImport(DllName, EntryPoint = "FreeStartupPreview")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void FreeStartupPreview(ref StartupPreviewResult result);
+
+    /// <summary>Gives up on whatever of the startup load was not claimed.</summary>
+    [LibraryImport(DllName, EntryPoint = "EndStartupPreview")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void EndStartupPreview();
+}
@@ -0,0 +1,83 @@
+using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ AtlasRect struct: a pixel rectangle of a thumbnail atlas.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct AtlasRect
+{
+    public int X;
+    public int Y;
+    public int Width;
+    public int Height;
+}
+
+/// <summary>
+/// P/Invoke declarations for the native thumbnail-strip atlas in FlyNativeLibHeif.dll.
+/// An atlas handle is not thread-safe; it belongs to the thread that renders the strip.
+/// </summary>
+internal static partial class NativeThumbnailAtlasBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>
+    /// Creates an atlas of <paramref name="columns"/> x <paramref name="rows"/> square slots of
+    /// <paramref name="slotSize"/> pixels. Returns IntPtr.Zero if the arguments are invalid.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "CreateThumbnailAtlas")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial IntPtr CreateThumbnailAtlas(int slotSize, int columns, int rows);
+
+    /// <summary>Returns the slot holding <paramref name="key"/> and marks it recently used, or -1.</summary>
+    [LibraryImport(DllName, EntryPoint = "FindAtlasSlot")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial int FindAtlasSlot(IntPtr handle, ulong key);
+
+    /// <summary>Scales premultiplied BGRA pixels into the least recently used slot. Returns the slot, or -1.</summary>
+    [LibraryImport(DllName, EntryPoint = "InsertAtlasPixels")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static unsafe partial int InsertAtlasPixels(IntPtr handle, ulong key, byte* bgra, int width, int height, int stride);
+
+    /// <summary>
+    /// Decodes BC1/BC3 blocks (<see cref="BlockPreviewHeader.FormatBc1"/> or <see cref="BlockPreviewHeader.FormatBc3"/>)
+    /// into the least recently used slot. Returns the slot, or -1.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "InsertAtlasBlocks")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static unsafe partial int InsertAtlasBlocks(IntPtr handle, ulong key, int format, byte* blocks, uint size,
+        int width, int height);
+
+    /// <summary>Gets the pixel rectangle of a slot.</summary>
+    [LibraryImport(DllName, EntryPoint = "GetAtlasSlotRect")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool GetAtlasSlotRect(IntPtr handle, int slot, out AtlasRect outRect);
+
+    /// <summary>
+    /// Fills <paramref name="outRects"/> with the areas changed since the last call and returns
+    /// their count. If more changed than fit, a single rectangle covering the atlas is returned.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "TakeAtlasDirtyRects")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static unsafe partial int TakeAtlasDirtyRects(IntPtr handle, AtlasRect* outRects, int maxRects);
+
+    /// <summary>Copies a rectangle of the atlas into tightly packed BGRA rows.</summary>
+    [LibraryImport(DllName, EntryPoint = "CopyAtlasRect")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static unsafe partial bool CopyAtlasRect(IntPtr handle, in AtlasRect rect, byte* dst, uint dstSize);
+
+    /// <summary>Forgets every thumbnail; the whole atlas becomes dirty.</summary>
+    [LibraryImport(DllName, EntryPoint = "ClearThumbnailAtlas")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void ClearThumbnailAtlas(IntPtr handle);
+
+    /// <summary>Frees the atlas.</summary>
+    [LibraryImport(DllName, EntryPoint = "DestroyThumbnailAtlas")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void DestroyThumbnailAtlas(IntPtr handle);
+}
@@ -0,0 +1,188 @@
+using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ ThumbnailView struct: a pinned, read-only view into the native
+/// store's memory mapping. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct ThumbnailView
+{
+    /// <summary>First byte of the stored blob. Valid until the view is released.</summary>
+    public IntPtr Data;
+    /// <summary>Blob size in bytes.</summary>
+    public uint Size;
+    /// <summary>The width stored with the entry (the original image width).</summary>
+    public int Width;
+    /// <summary>The height stored with the entry (the original image height).</summary>
+    public int Height;
+    /// <summary>The pinned segment; only meaningful to the native side.</summary>
+    public uint Segment;
+}
+
+/// <summary>
+/// C# equivalent of the C++ BlockPreviewHeader struct, found at the start of blobs written by
+/// <see cref="NativeThumbnailStoreBridge.PutCompressedThumbnail"/>. A table of
+/// <see cref="BlockPreviewLevel"/> entries and the BC blocks of each level follow it.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct BlockPreviewHeader
+{
+    /// <summary>"FBCP" in little-endian byte order.</summary>
+    public const uint ExpectedMagic = 0x50434246;
+    public const ushort FormatBc1 = 1;
+    public const ushort FormatBc3 = 3;
+
+    public uint Magic;
+    public ushort Version;
+    /// <summary><see cref="FormatBc1"/> or <see cref="FormatBc3"/>, shared by every level.</summary>
+    public ushort Format;
+    /// <summary>Texture width of level 0 in pixels; a multiple of 4.</summary>
+    public uint Width;
+    /// <summary>Texture height of level 0 in pixels; a multiple of 4.</summary>
+    public uint Height;
+    /// <summary>Bytes after the header: level table and blocks.</summary>
+    public uint DataSize;
+    /// <summary>Entries in the level table (0 for single-level blobs of version 1).</summary>
+    public uint LevelCount;
+}
+
+/// <summary>
+/// C# equivalent of the C++ BlockPreviewLevel struct: one level of a block-compressed
+/// thumbnail, as returned by <see cref="NativeThumbnailStoreBridge.FindThumbnailLevel"/>.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct BlockPreviewLevel
+{
+    public const uint KindMip = 0;
+    public const uint KindTile = 1;
+
+    /// <summary>Texture width in pixels; a multiple of 4.</summary>
+    public uint Width;
+    /// <summary>Texture height in pixels; a multiple of 4.</summary>
+    public uint Height;
+    /// <summary>Offset of the level's blocks from the start of the blob.</summary>
+    public uint Offset;
+    /// <summary>Bytes of block data.</summary>
+    public uint Size;
+    /// <summary><see cref="KindMip"/> or <see cref="KindTile"/>.</summary>
+    public uint Kind;
+}
+
+/// <summary>
+/// C# equivalent of the C++ ThumbnailStoreStats struct.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct ThumbnailStoreStats
+{
+    public ulong Entries;
+    public ulong LiveBytes;
+    public ulong FileBytes;
+    public ulong Hits;
+    public ulong Misses;
+    public ulong ContentHits;
+    public ulong Puts;
+    public ulong Dropped;
+    public ulong Evicted;
+    public ulong Commits;
+    public uint Segments;
+    public uint Compactions;
+
+    public override readonly string ToString() =>
+        $"{Entries} entries, {LiveBytes / (1024 * 1024)} MB live / {FileBytes / (1024 * 1024)} MB on disk in {Segments} segments, " +
+        $"{Hits} hits, {Misses} misses, {ContentHits} content hits, {Puts} puts in {Commits} commits, {Dropped} dropped, {Evicted} evicted, {Compactions} compactions";
+}
+
+/// <summary>
+/// P/Invoke declarations for the native append-only thumbnail store in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeThumbnailStoreBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>
+    /// Opens or creates the store in <paramref name="folder"/>. Returns an opaque handle, or
+    /// IntPtr.Zero if the folder cannot be used or another process has the store open.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "OpenThumbnailStore", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial IntPtr OpenThumbnailStore(string folder, ulong maxBytes, uint maxEntries);
+
+    /// <summary>
+    /// Looks up the thumbnail of <paramref name="path"/> stored with <paramref name="mtime"/>.
+    /// On a hit the view MUST be passed to <see cref="ReleaseThumbnailView"/>.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "GetThumbnail", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool GetThumbnail(IntPtr handle, string path, long mtime, out ThumbnailView outView);
+
+    /// <summary>
+    /// Looks up the thumbnail of <paramref name="path"/> by the content fingerprint of the file
+    /// and <paramref name="mtime"/>, which both survive moves and renames. Reads about 128 KB of
+    /// the file. On a hit the path is aliased to the entry, and the view MUST be passed to
+    /// <see cref="ReleaseThumbnailView"/>.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "GetThumbnailByContent", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool GetThumbnailByContent(IntPtr handle, string path, long mtime, out ThumbnailView outView);
+
+    /// <summary>Releases a view returned by <see cref="GetThumbnail"/> or <see cref="GetThumbnailByContent"/>.</summary>
+    [LibraryImport(DllName, EntryPoint = "ReleaseThumbnailView")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void ReleaseThumbnailView(IntPtr handle, in ThumbnailView view);
+
+    /// <summary>Queues a thumbnail for writing. The bytes are copied before the call returns.</summary>
+    [LibraryImport(DllName, EntryPoint = "PutThumbnail", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static unsafe partial bool PutThumbnail(IntPtr handle, string path, long mtime, byte* data, uint size,
+        int width, int height);
+
+    /// <summary>
+    /// Block-compresses premultiplied BGRA pixels (BC1, or BC3 if any pixel is translucent)
+    /// on the calling thread, together with its halvings and a square tile of
+    /// <paramref name="tileSize"/> pixels, and queues the result for writing.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "PutCompressedThumbnail", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static unsafe partial bool PutCompressedThumbnail(IntPtr handle, string path, long mtime, byte* bgra,
+        int previewWidth, int previewHeight, int stride, int tileSize, int width, int height);
+
+    /// <summary>
+    /// Picks the level of a block-compressed view to draw at <paramref name="edge"/> pixels on
+    /// the longest side, or its thumbnail-strip tile if <paramref name="tile"/> is set. Returns
+    /// false for legacy JPEG blobs and, with <paramref name="tile"/>, for blobs without a tile.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "FindThumbnailLevel")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool FindThumbnailLevel(in ThumbnailView view, int edge,
+        [MarshalAs(UnmanagedType.I1)] bool tile, out BlockPreviewLevel outLevel);
+
+    /// <summary>Blocks until every queued write is committed.</summary>
+    [LibraryImport(DllName, EntryPoint = "FlushThumbnailStore")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void FlushThumbnailStore(IntPtr handle);
+
+    /// <summary>Removes every entry and deletes the segment files.</summary>
+    [LibraryImport(DllName, EntryPoint = "ClearThumbnailStore")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void ClearThumbnailStore(IntPtr handle);
+
+    /// <summary>Retrieves the store's counters.</summary>
+    [LibraryImport(DllName, EntryPoint = "GetThumbnailStoreStats")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool GetThumbnailStoreStats(IntPtr handle, out ThumbnailStoreStats outStats);
+
+    /// <summary>Commits pending writes and closes the store.</summary>
+    [LibraryImport(DllName, EntryPoint = "CloseThumbnailStore")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void CloseThumbnailStore(IntPtr handle);
+}
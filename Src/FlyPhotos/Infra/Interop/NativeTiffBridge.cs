@@ -0,0 +1,102 @@
+using System;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using Microsoft.Win32.SafeHandles;
+
+namespace FlyPhotos.Infra.Interop;
+
+/// <summary>
+/// C# equivalent of the C++ TiffPageInfo struct. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct TiffPageInfo
+{
+    /// <summary>Of the page at full resolution.</summary>
+    public int Width;
+    public int Height;
+    public int BitsPerSample;
+    public int SamplesPerPixel;
+    /// <summary>TIFF PhotometricInterpretation.</summary>
+    public int Photometric;
+    /// <summary>TIFF Compression.</summary>
+    public int Compression;
+    public int Tiled;
+    /// <summary>1-8, as in EXIF. Not applied by <see cref="NativeTiffBridge.DecodeTiffPage" />.</summary>
+    public int Orientation;
+    public int HasAlpha;
+    /// <summary>The page plus its reduced-resolution images.</summary>
+    public int LevelCount;
+    /// <summary>1 if <see cref="NativeTiffBridge.DecodeTiffPage" /> handles level 0.</summary>
+    public int CanDecode;
+    private int _reserved;
+}
+
+/// <summary>
+/// C# equivalent of the C++ TiffLevel struct. Must match the native layout exactly.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+internal struct TiffLevel
+{
+    /// <summary>0 for the page itself; -1 if no level can be decoded.</summary>
+    public int Level;
+    public int Width;
+    public int Height;
+    public int CanDecode;
+}
+
+/// <summary>
+/// An open TIFF: the file stays mapped, and its page index in memory, until the handle is
+/// released. Calls made through the handle keep it alive, so disposing it while a page is still
+/// decoding closes it only once the decode returns.
+/// </summary>
+internal sealed class TiffHandle : SafeHandleZeroOrMinusOneIsInvalid
+{
+    public TiffHandle() : base(true) { }
+
+    protected override bool ReleaseHandle()
+    {
+        NativeTiffBridge.CloseTiff(handle);
+        return true;
+    }
+}
+
+/// <summary>
+/// P/Invoke declarations for the native TIFF decoder in FlyNativeLibHeif.dll.
+/// </summary>
+internal static partial class NativeTiffBridge
+{
+    private const string DllName = "FlyNativeLibHeif.dll";
+
+    /// <summary>
+    /// Maps the file and indexes every page and reduced-resolution image; no pixels are read.
+    /// The handle is invalid if the file is not a TIFF.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "OpenTiff", StringMarshalling = StringMarshalling.Utf16)]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial TiffHandle OpenTiff(string path);
+
+    [LibraryImport(DllName, EntryPoint = "GetTiffPageCount")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial int GetTiffPageCount(TiffHandle handle);
+
+    /// <summary>
+    /// Describes page <paramref name="page" /> and picks the smallest level that covers
+    /// <paramref name="maxDimension" /> pixels (0 for the page itself).
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "GetTiffPageInfo")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    [return: MarshalAs(UnmanagedType.I1)]
+    public static partial bool GetTiffPageInfo(TiffHandle handle, int page, int maxDimension, out TiffPageInfo info, out TiffLevel level);
+
+    /// <summary>
+    /// Decodes <paramref name="level" /> of <paramref name="page" /> into <paramref name="bgra" /> as
+    /// premultiplied BGRA. The buffer must be exactly the level's <c>Width * Height * 4</c> bytes.
+    /// </summary>
+    [LibraryImport(DllName, EntryPoint = "DecodeTiffPage")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static unsafe partial HeifError DecodeTiffPage(TiffHandle handle, int page, int level, byte* bgra, ulong size);
+
+    [LibraryImport(DllName, EntryPoint = "CloseTiff")]
+    [UnmanagedCallConv(CallConvs = [typeof(CallConvCdecl)])]
+    public static partial void CloseTiff(IntPtr handle);
+}
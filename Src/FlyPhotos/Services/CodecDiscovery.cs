@@ -47,7 +47,7 @@ internal static class CodecDiscovery
         // New lightweight formats (added)
         ".qoi",".ff",
         // Fly-specific
-        ".psd",".svg"
+        ".psd",".psb",".svg"
     ];
 
     private static readonly string[] ProbableImageMagickRawExtensions =
@@ -149,7 +149,7 @@ internal static class CodecDiscovery
     {
         var list = new List<CodecInfo>
         {
-            new() { FriendlyName = "PSD Decoder", Type = "Fly", FileExtensions = [".psd"] },
+            new() { FriendlyName = "PSD Decoder", Type = "Fly", FileExtensions = [".psd", ".psb"] },
             new() { FriendlyName = "SVG Decoder", Type = "Fly", FileExtensions = [".svg"] },
             new() { FriendlyName = "HEIC Decoder", Type = "Fly", FileExtensions = [".heic", ".heif", ".hif", ".avif"] }
         };
@@ -0,0 +1,916 @@
+#nullable enable
+using FlyPhotos.Core;
+using FlyPhotos.Core.Model;
+using FlyPhotos.Display.ImageReading;
+using FlyPhotos.Infra.Interop;
+using Microsoft.Graphics.Canvas;
+using Microsoft.Graphics.Canvas.UI.Xaml;
+using Microsoft.UI;
+using Microsoft.Windows.System.Power;
+using System;
+using System.Buffers;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Numerics;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Runtime.InteropServices.WindowsRuntime;
+using System.Security.Cryptography;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using Windows.Foundation;
+using Windows.Graphics.DirectX;
+
+namespace FlyPhotos.Services;
+
+/// <summary>
+/// A persistent, LRU-evicting disk cache for photo thumbnails, backed by the native
+/// append-only thumbnail store in FlyNativeLibHeif.
+/// Thumbnails are stored as BC1/BC3 block-compressed textures alongside their source
+/// file's last-write time so stale entries are detected and replaced automatically.
+/// <para>
+/// Reads never lock: the native store hands out a view straight into its memory-mapped
+/// segment files, whose blocks are copied out and uploaded to the GPU as they are — there
+/// is no image decode on a hit. Writes are queued and committed in batches by a native
+/// writer thread, so <see cref="PutInCache" /> returns as soon as the blocks are encoded.
+/// </para>
+/// <para>
+/// Each entry holds a chain of levels encoded natively in one pass: the preview, its
+/// halvings, and a square tile of <see cref="Constants.ThumbnailPixelBufferSize" /> pixels.
+/// Callers ask for the level nearest the size they draw at, and the thumbnail strip takes
+/// the tile as it is rather than scaling the preview down itself.
+/// </para>
+/// <para>
+/// Entries are also keyed by a content fingerprint of the source file. When the path lookup
+/// misses — the file was moved, renamed or its folder reorganised — the fingerprint finds
+/// the entry, and the new path is aliased to it so the next lookup hits directly.
+/// </para>
+/// <para>
+/// Entries written by earlier versions hold JPEG blobs; they are still read through
+/// <see cref="CanvasBitmap.LoadAsync(ICanvasResourceCreator, Windows.Storage.Streams.IRandomAccessStream)" />
+/// until they are replaced or evicted.
+/// </para>
+/// <para>
+/// Callers are responsible for disposing any <see cref="CanvasBitmap" /> returned
+/// by <see cref="ReturnFromCache" />. Failure to do so will leak GPU memory.
+/// </para>
+/// </summary>
+public sealed partial class DiskCacherNative : IDisposable
+{
+    // -------------------------------------------------------------------------
+    // Constants
+    // -------------------------------------------------------------------------
+
+    /// <summary>
+    /// Maximum number of thumbnail entries kept before LRU eviction is triggered.
+    /// The native store then drops the least recently read quarter.
+    /// </summary>
+    private const int MaxItemCount = 20_000;
+
+    /// <summary>
+    /// Live bytes above which LRU eviction is triggered regardless of the entry count.
+    /// An opaque 800 x 600 thumbnail takes 316 KB as BC1 with its smaller levels and tile
+    /// (twice that as BC3), so 20,000 typical thumbnails fit.
+    /// </summary>
+    private const ulong MaxCacheBytes = 6UL * 1024 * 1024 * 1024;
+
+    /// <summary>
+    /// The longest edge (in pixels) that a stored thumbnail may have.
+    /// Images smaller than this on both axes are stored at their original size.
+    /// </summary>
+    private const int ThumbMaxSize = 800;
+
+    /// <summary>
+    /// How long <see cref="Shutdown" /> waits for in-flight reads to release their views
+    /// before it closes the store.
+    /// </summary>
+    private const int ShutdownWaitMs = 2000;
+
+    /// <summary>
+    /// Delay before the first retry of a store that could not be opened; it doubles after every
+    /// failed retry, up to <see cref="MaxOpenRetryMs" />. The usual cause is the previous instance,
+    /// killed on relaunch, still holding the store's lock.
+    /// </summary>
+    private const long MinOpenRetryMs = 5_000;
+
+    private const long MaxOpenRetryMs = 5 * 60_000;
+
+    /// <summary>
+    /// Source bytes per second a warm-up hands to the decoders, so walking a library on a
+    /// spinning or network drive leaves bandwidth for the photo on screen.
+    /// </summary>
+    private const ulong WarmUpBytesPerSecond = 48UL * 1024 * 1024;
+
+    /// <summary>
+    /// Previews one warm-up generates at most. Half the entry limit, so warming a huge folder
+    /// never evicts everything the user viewed recently.
+    /// </summary>
+    private const uint MaxWarmUpPreviews = MaxItemCount / 2;
+
+    // -------------------------------------------------------------------------
+    // Singleton
+    // -------------------------------------------------------------------------
+
+    /// <summary>
+    /// Lazily initialised singleton holder. <see cref="Lazy{T}" /> guarantees
+    /// thread-safe construction without an explicit lock.
+    /// </summary>
+    private static readonly Lazy<DiskCacherNative> _instance =
+        new(() => new DiskCacherNative());
+
+    /// <summary>
+    /// Gets the singleton instance of <see cref="DiskCacherNative" />.
+    /// The instance is created on first access.
+    /// </summary>
+    public static DiskCacherNative Instance => _instance.Value;
+
+    // -------------------------------------------------------------------------
+    // Infrastructure
+    // -------------------------------------------------------------------------
+
+    /// <summary>
+    /// Handle of the native store, or <see cref="IntPtr.Zero" /> while it is not open (for
+    /// example because another FlyPhotos instance owns it). Every operation is then a no-op,
+    /// thumbnails are regenerated from the source files, and the open is retried in the
+    /// background by <see cref="RetryOpenIfDue" />. Set under <see cref="_openLock" />.
+    /// </summary>
+    private IntPtr _handle;
+
+    /// <summary>
+    /// Guards <see cref="_handle" /> while the store is not open, and the retry state below.
+    /// </summary>
+    private readonly Lock _openLock = new();
+
+    /// <summary>True while a background open is running.</summary>
+    private bool _opening;
+
+    /// <summary><see cref="Environment.TickCount64" /> at which the next open may be tried.</summary>
+    private long _nextOpenAttempt;
+
+    private long _openRetryDelayMs = MinOpenRetryMs;
+
+    /// <summary>
+    /// Number of calls currently using <see cref="_handle" />. Disposal waits for it to drop
+    /// to zero so no view into the mapping is outstanding when the store is closed.
+    /// </summary>
+    private int _activeCalls;
+
+    /// <summary>
+    /// Disposal flag. Set atomically via <see cref="Interlocked.Exchange(ref int, int)" /> to
+    /// prevent double-disposal races on the singleton.
+    /// 0 = live, 1 = disposed.
+    /// </summary>
+    private int _disposedFlag;
+
+    /// <summary>
+    /// Handle of the native cache warmer, created by the first <see cref="StartWarmUp" />.
+    /// Guarded by <see cref="_warmUpLock" />.
+    /// </summary>
+    private IntPtr _warmer;
+
+    /// <summary>
+    /// Pins the resource creator the warm-up decodes with; handed to the native hooks as their context.
+    /// </summary>
+    private GCHandle _warmUpDevice;
+
+    private readonly Lock _warmUpLock = new();
+
+    /// <summary>
+    /// A warm-up requested while the store was not open; started once a retried open succeeds.
+    /// Guarded by <see cref="_warmUpLock" />.
+    /// </summary>
+    private (string folder, ICanvasResourceCreatorWithDpi device, bool recursive)? _pendingWarmUp;
+
+    /// <summary>
+    /// Set once <see cref="BeginStartupPreview" /> has started the native startup load.
+    /// </summary>
+    private static bool _startupPreviewBegun;
+
+    // -------------------------------------------------------------------------
+    // Constructor
+    // -------------------------------------------------------------------------
+
+    /// <summary>
+    /// Adopts the store opened by the startup load, or opens the native store, and removes the
+    /// database of the former SQLite cache, whose entries are not migrated.
+    /// Private — use <see cref="Instance" /> to obtain the singleton.
+    /// </summary>
+    private DiskCacherNative()
+    {
+        var folder = StoreFolder;
+        if (_startupPreviewBegun)
+            // Waits for the startup load's open rather than timing out: that load holds the store's
+            // lock, so opening it here instead would fail and leave the session without a disk cache.
+            _handle = NativeStartupPreviewBridge.ClaimStartupThumbnailStore();
+        if (_handle == IntPtr.Zero)
+            _handle = NativeThumbnailStoreBridge.OpenThumbnailStore(folder, MaxCacheBytes, MaxItemCount);
+        if (_handle == IntPtr.Zero)
+        {
+            _nextOpenAttempt = Environment.TickCount64 + _openRetryDelayMs;
+            Debug.WriteLine($"[CACHE-ERROR] Thumbnail store at '{folder}' could not be opened; retrying later.");
+        }
+
+        DeleteLegacyDatabase();
+    }
+
+    // -------------------------------------------------------------------------
+    // Public API
+    // -------------------------------------------------------------------------
+
+    /// <summary>
+    /// Starts the native load of the launch photo, which opens the store and looks the photo up
+    /// (or decodes its embedded preview) while the window is still being created. Call it once,
+    /// from the application constructor; the store is adopted when <see cref="Instance" /> is
+    /// first used, and the result is taken by <see cref="ImageReader" /> for the first preview.
+    /// </summary>
+    /// <param name="filePath">Absolute path of the launch photo.</param>
+    /// <param name="useCache">False if the store must not be opened, e.g. in a secondary instance.</param>
+    public static void BeginStartupPreview(string filePath, bool useCache)
+    {
+        var options = new StartupPreviewOptions
+        {
+            Flags = StartupPreviewFlags.UseEmbedded | (useCache ? StartupPreviewFlags.UseCache : StartupPreviewFlags.None),
+            StoreMaxEntries = MaxItemCount,
+            StoreMaxBytes = MaxCacheBytes
+        };
+        _startupPreviewBegun = NativeStartupPreviewBridge.BeginStartupPreview(filePath, useCache ? StoreFolder : null, in options);
+    }
+
+    /// <summary>
+    /// True if <see cref="BeginStartupPreview" /> started the native startup load.
+    /// </summary>
+    internal static bool StartupPreviewBegun => _startupPreviewBegun;
+
+    /// <summary>
+    /// Safely disposes the singleton ONLY if it has already been instantiated.
+    /// Call this on application shutdown. Accessing <see cref="Instance" /> directly
+    /// to dispose would force creation of the singleton if it does not yet exist.
+    /// </summary>
+    public static void Shutdown()
+    {
+        if (_instance.IsValueCreated)
+            ((IDisposable)_instance.Value).Dispose();
+    }
+
+    /// <summary>
+    /// Attempts to retrieve a cached thumbnail for <paramref name="filePath" />.
+    /// Returns the decoded bitmap and the original image dimensions on a cache hit,
+    /// or <c>(null, 0, 0)</c> on a miss, a stale entry, or any internal error.
+    /// <para>
+    /// Freshness is determined by comparing the file's current last-write time
+    /// against the value stored when the thumbnail was cached. When that misses, the
+    /// file's content fingerprint is looked up instead, which finds entries of files
+    /// that were moved or renamed. That lookup also requires the stored last-write time:
+    /// the fingerprint samples only the start and end of the file, so a same-size edit to
+    /// an uncompressed image can leave it unchanged, but the edit always changes the
+    /// last-write time. An edited file stays a miss until the next <see cref="PutInCache" />
+    /// call replaces it.
+    /// </para>
+    /// <para>
+    /// <b>Important:</b> the caller owns the returned <see cref="CanvasBitmap" />
+    /// and must dispose it when it is no longer needed to release GPU memory.
+    /// </para>
+    /// </summary>
+    /// <param name="canvasControl">
+    /// The <see cref="CanvasControl" /> used as the device context for creating
+    /// the GPU-resident bitmap.
+    /// </param>
+    /// <param name="filePath">Absolute path of the source photo file.</param>
+    /// <param name="edge">
+    /// Longest edge, in pixels, the bitmap will be drawn at. The smallest cached level at
+    /// least this large is returned; the default returns the largest.
+    /// </param>
+    /// <returns>
+    /// A tuple of <c>(bitmap, actualWidth, actualHeight, thumbnail)</c> where
+    /// <c>actualWidth</c> and <c>actualHeight</c> are the dimensions of the
+    /// original (un-resized) image and <c>thumbnail</c> is the cached thumbnail-strip tile,
+    /// or null for entries written without one. Returns <c>(null, 0, 0, null)</c> on miss or error.
+    /// </returns>
+    internal async Task<(CanvasBitmap? bitmap, int actualWidth, int actualHeight, Thumbnail? thumbnail)> ReturnFromCache(
+        ICanvasResourceCreatorWithDpi canvasControl, string filePath, int edge = int.MaxValue)
+    {
+        if (!TryEnter()) return (null, 0, 0, null);
+        try
+        {
+            var mtime = FileMtime(filePath);
+            if (!NativeThumbnailStoreBridge.GetThumbnail(_handle, filePath, mtime, out var view) &&
+                !NativeThumbnailStoreBridge.GetThumbnailByContent(_handle, filePath, mtime, out view))
+                return (null, 0, 0, null);
+
+            try
+            {
+                return await ReadViewAsync(canvasControl, view, edge);
+            }
+            finally
+            {
+                NativeThumbnailStoreBridge.ReleaseThumbnailView(_handle, in view);
+            }
+        }
+        catch (Exception ex)
+        {
+            // Cache failures must never crash the app — the caller will simply
+            // regenerate the thumbnail from the source file.
+            Debug.WriteLine(
+                $"[CACHE-ERROR] Failed to read '{filePath}' from cache: {ex.Message}");
+            return (null, 0, 0, null);
+        }
+        finally
+        {
+            Exit();
+        }
+    }
+
+    /// <summary>
+    /// Like <see cref="ReturnFromCache" />, for a view the startup load already looked up in the
+    /// store this instance adopted. The view is released whatever the outcome.
+    /// </summary>
+    /// <param name="canvasControl">The device context for creating the bitmap.</param>
+    /// <param name="view">A view claimed with the startup preview.</param>
+    /// <param name="edge">Longest edge, in pixels, the bitmap will be drawn at.</param>
+    internal async Task<(CanvasBitmap? bitmap, int actualWidth, int actualHeight, Thumbnail? thumbnail)> ReturnFromView(
+        ICanvasResourceCreatorWithDpi canvasControl, ThumbnailView view, int edge = int.MaxValue)
+    {
+        if (!TryEnter()) return (null, 0, 0, null);
+        try
+        {
+            return await ReadViewAsync(canvasControl, view, edge);
+        }
+        catch (Exception ex)
+        {
+            Debug.WriteLine($"[CACHE-ERROR] Failed to read the startup preview from cache: {ex.Message}");
+            return (null, 0, 0, null);
+        }
+        finally
+        {
+            NativeThumbnailStoreBridge.ReleaseThumbnailView(_handle, in view);
+            Exit();
+        }
+    }
+
+    /// <summary>
+    /// Stores a block-compressed thumbnail for <paramref name="filePath" /> in the
+    /// cache. If an entry for the same path already exists it is replaced.
+    /// <para>
+    /// The bitmap is drawn into a render target no larger than <see cref="ThumbMaxSize" />
+    /// pixels on its longest edge, with the rotation baked in. Its pixels are then reduced
+    /// and encoded natively as BC1 (or BC3 if the image has transparency), level by level.
+    /// </para>
+    /// <para>
+    /// The native store takes the encoded blocks into its write queue and commits them on
+    /// its own thread, evicting the least recently read entries when it is full.
+    /// </para>
+    /// </summary>
+    /// <param name="filePath">Absolute path of the source photo file.</param>
+    /// <param name="bitmap">
+    /// The full-resolution (or already-decoded) bitmap to thumbnail and store.
+    /// The bitmap is not disposed by this method — the caller retains ownership.
+    /// </param>
+    /// <param name="actualWidth">Width of the original image in pixels.</param>
+    /// <param name="actualHeight">Height of the original image in pixels.</param>
+    /// <param name="rotation">Clockwise rotation in degrees (0, 90, 180, 270) to apply before caching.
+    /// Pass 0 (default) to store without rotation.</param>
+    public async Task PutInCache(string filePath, CanvasBitmap bitmap, int actualWidth, int actualHeight, int rotation = 0)
+    {
+        if (_handle == IntPtr.Zero)
+        {
+            RetryOpenIfDue();
+            return;
+        }
+        try
+        {
+            await Task.Run(() =>
+            {
+                var (pixels, width, height) = RenderPreview(bitmap, ThumbMaxSize, rotation);
+                if (!TryEnter()) return;
+                try
+                {
+                    if (!Enqueue(filePath, FileMtime(filePath), pixels, width, height, actualWidth, actualHeight))
+                        Debug.WriteLine($"[CACHE-ERROR] Thumbnail store rejected '{filePath}' ({width}x{height}).");
+                }
+                finally
+                {
+                    Exit();
+                }
+            }).ConfigureAwait(false);
+        }
+        catch (Exception ex)
+        {
+            // Cache write failures are non-fatal — the thumbnail will simply be
+            // regenerated on the next session.
+            Debug.WriteLine(
+                $"[CACHE-ERROR] Failed to put '{filePath}' in cache: {ex.Message}");
+        }
+    }
+
+    /// <summary>
+    /// Removes every entry from the disk cache and deletes its segment files.
+    /// Safe to call at any time; any error is swallowed and logged so the caller
+    /// is never disrupted.
+    /// </summary>
+    public async Task ClearAllAsync()
+    {
+        if (!TryEnter()) return;
+        try
+        {
+            // Clearing waits for the native writer thread; keep it off the UI thread.
+            await Task.Run(() => NativeThumbnailStoreBridge.ClearThumbnailStore(_handle)).ConfigureAwait(false);
+        }
+        catch (Exception ex)
+        {
+            Debug.WriteLine($"[CACHE-ERROR] Failed to clear all cache entries: {ex.Message}");
+        }
+        finally
+        {
+            Exit();
+        }
+    }
+
+    /// <summary>
+    /// Returns the native store's counters, or null if the store is not open.
+    /// </summary>
+    public ThumbnailStoreStats? GetStats()
+    {
+        if (!TryEnter()) return null;
+        try
+        {
+            return NativeThumbnailStoreBridge.GetThumbnailStoreStats(_handle, out var stats) ? stats : null;
+        }
+        finally
+        {
+            Exit();
+        }
+    }
+
+    /// <summary>
+    /// Starts generating, in the background, the cached preview of every photo in
+    /// <paramref name="folder" /> that the cache does not hold yet, so opening any of them later
+    /// is a cache hit. Any previous warm-up is stopped first.
+    /// <para>
+    /// The walk and the scheduling are native: background-priority threads (CPU and I/O), a
+    /// throttle on the source bytes read, and a checkpoint file so a warm-up interrupted by
+    /// shutdown resumes where it left off. Each missing photo goes through the same preview
+    /// readers and <see cref="PutInCache" /> as the viewer's own write-back. Warming holds while
+    /// the machine runs on battery or in energy saver.
+    /// </para>
+    /// </summary>
+    /// <param name="folder">The folder (or library root) to warm.</param>
+    /// <param name="device">The resource creator the previews are decoded with.</param>
+    /// <param name="recursive">True to warm every subfolder too.</param>
+    /// <returns>
+    /// False if the store is not open or the folder cannot be walked. A warm-up requested while
+    /// the store is not open starts once a retried open succeeds.
+    /// </returns>
+    public unsafe bool StartWarmUp(string folder, ICanvasResourceCreatorWithDpi device, bool recursive = false)
+    {
+        if (!TryEnter())
+        {
+            lock (_warmUpLock)
+                _pendingWarmUp = Volatile.Read(ref _disposedFlag) == 0 ? (folder, device, recursive) : null;
+            // An open that finished in the meantime has already looked for a pending warm-up.
+            if (_handle == IntPtr.Zero || !TryEnter()) return false;
+            lock (_warmUpLock)
+                _pendingWarmUp = null;
+        }
+        try
+        {
+            var extensions = new List<string>(CodecDiscovery.SupportedExtensions);
+            if (extensions.Count == 0) return false;
+
+            lock (_warmUpLock)
+            {
+                if (_warmer == IntPtr.Zero)
+                {
+                    _warmUpDevice = GCHandle.Alloc(device);
+                    var hooks = new CacheWarmHooks
+                    {
+                        Generate = &GenerateWarmUpPreview,
+                        CanRun = &CanWarmUp,
+                        Context = GCHandle.ToIntPtr(_warmUpDevice)
+                    };
+                    _warmer = NativeCacheWarmerBridge.CreateCacheWarmer(_handle, hooks);
+                    if (_warmer == IntPtr.Zero)
+                    {
+                        _warmUpDevice.Free();
+                        return false;
+                    }
+                }
+                else
+                {
+                    // The hooks keep their context; stop the run before swapping the device under it.
+                    NativeCacheWarmerBridge.StopCacheWarmer(_warmer);
+                    _warmUpDevice.Target = device;
+                }
+
+                var options = new CacheWarmOptions
+                {
+                    Recursive = recursive ? 1 : 0,
+                    MaxBytesPerSecond = WarmUpBytesPerSecond,
+                    MaxGenerated = MaxWarmUpPreviews
+                };
+                var pins = new GCHandle[extensions.Count];
+                var pointers = new IntPtr[extensions.Count];
+                try
+                {
+                    for (var i = 0; i < extensions.Count; i++)
+                    {
+                        pins[i] = GCHandle.Alloc(extensions[i], GCHandleType.Pinned);
+                        pointers[i] = pins[i].AddrOfPinnedObject();
+                    }
+                    fixed (IntPtr* extensionArray = pointers)
+                    {
+                        return NativeCacheWarmerBridge.StartCacheWarmer(_warmer, folder, extensionArray, extensions.Count,
+                            GetWarmUpCheckpointPath(folder, recursive), options);
+                    }
+                }
+                finally
+                {
+                    foreach (var pin in pins)
+                        if (pin.IsAllocated) pin.Free();
+                }
+            }
+        }
+        catch (Exception ex)
+        {
+            Debug.WriteLine($"[CACHE-ERROR] Failed to start warming '{folder}': {ex.Message}");
+            return false;
+        }
+        finally
+        {
+            Exit();
+        }
+    }
+
+    /// <summary>
+    /// Stops the running warm-up, if any, after the previews in progress. Its checkpoint is
+    /// kept, so warming the same folder again resumes where this one stopped.
+    /// </summary>
+    public void StopWarmUp()
+    {
+        lock (_warmUpLock)
+        {
+            _pendingWarmUp = null;
+            if (_warmer != IntPtr.Zero) NativeCacheWarmerBridge.StopCacheWarmer(_warmer);
+        }
+    }
+
+    /// <summary>
+    /// Returns the counters and state of the current or last warm-up, or null if none was started.
+    /// </summary>
+    public CacheWarmProgress? GetWarmUpProgress()
+    {
+        lock (_warmUpLock)
+        {
+            if (_warmer == IntPtr.Zero) return null;
+            return NativeCacheWarmerBridge.GetCacheWarmerProgress(_warmer, out var progress) ? progress : null;
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    // IDisposable
+    // -------------------------------------------------------------------------
+
+    /// <summary>
+    /// Closes the native store after in-flight calls have released their views. The
+    /// store commits its pending writes and marks its index clean, so the next session
+    /// opens it without a rebuild.
+    /// <para>
+    /// Use <see cref="Shutdown" /> rather than calling this directly on the
+    /// singleton, to avoid accidentally instantiating it during teardown.
+    /// </para>
+    /// </summary>
+    void IDisposable.Dispose()
+    {
+        if (Interlocked.Exchange(ref _disposedFlag, 1) != 0) return;
+
+        // Taking the lock orders this against a background open: either it has set the handle,
+        // or it will see the disposed flag and close what it opened.
+        IntPtr handle;
+        lock (_openLock) handle = _handle;
+        if (handle == IntPtr.Zero) return;
+
+        // The warmer writes into the store; it must be gone first. Its hooks see the disposed
+        // flag and return at once, so this only waits for the decodes already running.
+        lock (_warmUpLock)
+        {
+            if (_warmer != IntPtr.Zero)
+            {
+                NativeCacheWarmerBridge.DestroyCacheWarmer(_warmer);
+                _warmer = IntPtr.Zero;
+                _warmUpDevice.Free();
+            }
+        }
+
+        // A view still being decoded points into the mapping; closing now would unmap it
+        // under the decoder. If a call is stuck, leak the handle instead — the process is
+        // exiting and the next session rebuilds the index.
+        if (!SpinWait.SpinUntil(() => Volatile.Read(ref _activeCalls) == 0, ShutdownWaitMs))
+        {
+            Debug.WriteLine("[CACHE-ERROR] Thumbnail store still in use at shutdown; not closed.");
+            return;
+        }
+        _handle = IntPtr.Zero;
+        NativeThumbnailStoreBridge.CloseThumbnailStore(handle);
+    }
+
+    // -------------------------------------------------------------------------
+    // Private helpers
+    // -------------------------------------------------------------------------
+
+    /// <summary>
+    /// Registers a call that uses the native handle. Fails once disposal has started;
+    /// the increment comes first so disposal either sees the call or the call sees the flag.
+    /// </summary>
+    private bool TryEnter()
+    {
+        if (_handle == IntPtr.Zero)
+        {
+            RetryOpenIfDue();
+            return false;
+        }
+        Interlocked.Increment(ref _activeCalls);
+        if (Volatile.Read(ref _disposedFlag) == 0) return true;
+        Interlocked.Decrement(ref _activeCalls);
+        return false;
+    }
+
+    private void Exit() => Interlocked.Decrement(ref _activeCalls);
+
+    /// <summary>
+    /// Starts opening the store on a worker thread if it is not open and the retry delay has
+    /// passed. The calling operation still misses; later ones use the store once it is open.
+    /// </summary>
+    private void RetryOpenIfDue()
+    {
+        lock (_openLock)
+        {
+            if (_handle != IntPtr.Zero || _opening || Volatile.Read(ref _disposedFlag) != 0 ||
+                Environment.TickCount64 < _nextOpenAttempt)
+                return;
+            _opening = true;
+        }
+
+        Task.Run(() =>
+        {
+            var handle = NativeThumbnailStoreBridge.OpenThumbnailStore(StoreFolder, MaxCacheBytes, MaxItemCount);
+            lock (_openLock)
+            {
+                _opening = false;
+                if (handle == IntPtr.Zero || Volatile.Read(ref _disposedFlag) != 0)
+                {
+                    _openRetryDelayMs = Math.Min(_openRetryDelayMs * 2, MaxOpenRetryMs);
+                    _nextOpenAttempt = Environment.TickCount64 + _openRetryDelayMs;
+                }
+                else
+                {
+                    _handle = handle;
+                    handle = IntPtr.Zero;
+                }
+            }
+            if (handle != IntPtr.Zero)
+            {
+                NativeThumbnailStoreBridge.CloseThumbnailStore(handle);
+                return;
+            }
+            if (_handle == IntPtr.Zero)
+            {
+                Debug.WriteLine($"[CACHE-ERROR] Thumbnail store still could not be opened; retrying in {_openRetryDelayMs} ms.");
+                return;
+            }
+
+            (string folder, ICanvasResourceCreatorWithDpi device, bool recursive)? pending;
+            lock (_warmUpLock)
+            {
+                pending = _pendingWarmUp;
+                _pendingWarmUp = null;
+            }
+            if (pending is { } warmUp)
+                StartWarmUp(warmUp.folder, warmUp.device, warmUp.recursive);
+        });
+    }
+
+    /// <summary>
+    /// Creates the bitmap for a pinned view, and the thumbnail-strip tile if the entry has one.
+    /// The caller releases the view after the returned task has completed.
+    /// </summary>
+    private static async Task<(CanvasBitmap? bitmap, int actualWidth, int actualHeight, Thumbnail? thumbnail)> ReadViewAsync(
+        ICanvasResourceCreatorWithDpi canvasControl, ThumbnailView view, int edge)
+    {
+        if (NativeThumbnailStoreBridge.FindThumbnailLevel(view, edge, false, out var level))
+        {
+            var format = BlockFormatOf(view);
+            var tile = NativeThumbnailStoreBridge.FindThumbnailLevel(view, 0, true, out var tileLevel)
+                ? new Thumbnail(CopyLevel(view, tileLevel), format)
+                : null;
+            return (CreateBlockBitmap(canvasControl, view, level, format), view.Width, view.Height, tile);
+        }
+
+        // Legacy JPEG entry. The stream reads straight from the store's mapping; the
+        // view stays pinned until LoadAsync has finished decoding it.
+        using var stream = OpenView(view);
+        var bitmap = await CanvasBitmap.LoadAsync(canvasControl, stream.AsRandomAccessStream());
+        return (bitmap, view.Width, view.Height, null);
+    }
+
+    /// <summary>
+    /// Wraps a native view in a read-only stream without copying.
+    /// </summary>
+    private static unsafe UnmanagedMemoryStream OpenView(in ThumbnailView view) =>
+        new((byte*)view.Data, view.Size);
+
+    /// <summary>
+    /// Hands the preview pixels to the native store, which reduces and block-compresses them
+    /// on this thread and queues the result.
+    /// </summary>
+    private unsafe bool Enqueue(string filePath, long mtime, byte[] pixels, int width, int height,
+        int actualWidth, int actualHeight)
+    {
+        fixed (byte* p = pixels)
+        {
+            return NativeThumbnailStoreBridge.PutCompressedThumbnail(_handle, filePath, mtime, p,
+                width, height, width * 4, Constants.ThumbnailPixelBufferSize, actualWidth, actualHeight);
+        }
+    }
+
+    /// <summary>
+    /// Returns the pixel format of a view that <see cref="NativeThumbnailStoreBridge.FindThumbnailLevel" />
+    /// has validated; every level of a blob shares it.
+    /// </summary>
+    private static unsafe DirectXPixelFormat BlockFormatOf(in ThumbnailView view) =>
+        ((BlockPreviewHeader*)view.Data)->Format == BlockPreviewHeader.FormatBc3
+            ? DirectXPixelFormat.BC3UIntNormalized
+            : DirectXPixelFormat.BC1UIntNormalized;
+
+    /// <summary>
+    /// Copies the blocks of one level out of the mapping.
+    /// </summary>
+    private static byte[] CopyLevel(in ThumbnailView view, in BlockPreviewLevel level)
+    {
+        var blocks = new byte[level.Size];
+        Marshal.Copy(view.Data + (int)level.Offset, blocks, 0, blocks.Length);
+        return blocks;
+    }
+
+    /// <summary>
+    /// Copies the blocks of one level out of the mapping and creates a bitmap in the matching
+    /// block-compressed format; the GPU samples it without any further decoding.
+    /// </summary>
+    private static CanvasBitmap CreateBlockBitmap(ICanvasResourceCreator resourceCreator,
+        in ThumbnailView view, in BlockPreviewLevel level, DirectXPixelFormat format)
+    {
+        var size = (int)level.Size;
+        var rented = ArrayPool<byte>.Shared.Rent(size);
+        try
+        {
+            Marshal.Copy(view.Data + (int)level.Offset, rented, 0, size);
+            return CanvasBitmap.CreateFromBytes(resourceCreator, rented.AsBuffer(0, size),
+                (int)level.Width, (int)level.Height, format);
+        }
+        finally
+        {
+            ArrayPool<byte>.Shared.Return(rented);
+        }
+    }
+
+    /// <summary>
+    /// Warm-up hook: generates the preview of one file through the viewer's own pipeline and
+    /// stores it. Runs on a native background-priority thread, so it may block.
+    /// </summary>
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static unsafe byte GenerateWarmUpPreview(IntPtr context, char* path)
+    {
+        var filePath = new string(path);
+        try
+        {
+            if (GCHandle.FromIntPtr(context).Target is not ICanvasResourceCreatorWithDpi device) return 0;
+            return Instance.WarmUpPreviewAsync(device, filePath).GetAwaiter().GetResult() ? (byte)1 : (byte)0;
+        }
+        catch (Exception ex)
+        {
+            Debug.WriteLine($"[CACHE-ERROR] Failed to warm '{filePath}': {ex.Message}");
+            return 0;
+        }
+    }
+
+    /// <summary>
+    /// Warm-up hook: warming runs only on mains power with energy saver off.
+    /// </summary>
+    [UnmanagedCallersOnly(CallConvs = [typeof(CallConvCdecl)])]
+    private static byte CanWarmUp(IntPtr context)
+    {
+        try
+        {
+            return PowerManager.PowerSupplyStatus != PowerSupplyStatus.NotPresent &&
+                   PowerManager.EnergySaverStatus != EnergySaverStatus.On ? (byte)1 : (byte)0;
+        }
+        catch (Exception)
+        {
+            return 1;
+        }
+    }
+
+    /// <summary>
+    /// Loads the preview of <paramref name="filePath" /> the way the sliding window does and
+    /// stores it. Returns false if the preview could not be decoded.
+    /// </summary>
+    private async Task<bool> WarmUpPreviewAsync(ICanvasResourceCreatorWithDpi device, string filePath)
+    {
+        if (Volatile.Read(ref _disposedFlag) != 0) return false;
+        using var preview = await ImageReader.GetPreview(device, filePath);
+        if (preview.Origin != Origin.Disk) return preview.Origin == Origin.DiskCache;
+
+        var (width, height) = preview.Metadata is { FullWidth: > 0, FullHeight: > 0 } metadata
+            ? (metadata.FullWidth, metadata.FullHeight)
+            : (preview.Bitmap.SizeInPixels.Width, preview.Bitmap.SizeInPixels.Height);
+        await PutInCache(filePath, preview.Bitmap, (int)Math.Round(width), (int)Math.Round(height), preview.Rotation);
+        return true;
+    }
+
+    /// <summary>
+    /// One checkpoint per warmed folder, named by a hash of its normalised path and the recursion mode.
+    /// </summary>
+    private static string GetWarmUpCheckpointPath(string folder, bool recursive)
+    {
+        var normalized = Path.TrimEndingDirectorySeparator(Path.GetFullPath(folder)).ToUpperInvariant();
+        var hash = Convert.ToHexString(SHA256.HashData(Encoding.UTF8.GetBytes(normalized)), 0, 16);
+        return Path.Combine(PathResolver.GetDbFolderPath(), "ThumbnailStore", "warmup", hash + (recursive ? ".tree" : ".dir"));
+    }
+
+    /// <summary>
+    /// Returns the last-write time of <paramref name="path" /> as a UTC FILETIME.
+    /// <para>
+    /// This value is stored with each cached thumbnail and compared on every
+    /// cache read to detect whether the source file has been modified since the
+    /// thumbnail was generated.
+    /// </para>
+    /// </summary>
+    /// <param name="path">Absolute path of the file to inspect.</param>
+    private static long FileMtime(string path) =>
+        File.GetLastWriteTimeUtc(path).ToFileTimeUtc();
+
+    /// <summary>
+    /// Folder of the native store's index and segment files.
+    /// </summary>
+    private static string StoreFolder => Path.Combine(PathResolver.GetDbFolderPath(), "ThumbnailStore");
+
+    /// <summary>
+    /// Best-effort removal of the SQLite database used by earlier versions.
+    /// </summary>
+    private static void DeleteLegacyDatabase()
+    {
+        var dbPath = Path.Combine(PathResolver.GetDbFolderPath(), "FlyPhotosCache_sqlite_2.db");
+        foreach (var path in new[] { dbPath, dbPath + "-wal", dbPath + "-shm" })
+        {
+            try
+            {
+                if (File.Exists(path)) File.Delete(path);
+            }
+            catch (Exception ex)
+            {
+                Debug.WriteLine($"[CACHE-ERROR] Failed to delete legacy cache '{path}': {ex.Message}");
+            }
+        }
+    }
+
+    /// <summary>
+    /// Draws <paramref name="bitmap" /> scaled to fit <paramref name="maxSize" /> and rotated,
+    /// and reads back its premultiplied BGRA pixels.
+    /// </summary>
+    /// <remarks>
+    /// Both output dimensions are rounded to a multiple of 4, the block size of the
+    /// compressed formats, so the cached texture has no padding; the aspect ratio changes
+    /// by well under a percent. Rotation is baked into the pixels the same way the viewer
+    /// composes it: centre on the origin, rotate, then move to the centre of the target.
+    /// </remarks>
+    /// <param name="bitmap">The source Win2D bitmap to process.</param>
+    /// <param name="maxSize">The maximum length (in pixels) allowed for the longest edge.</param>
+    /// <param name="rotation">The rotation to apply in degrees. Supports 0, 90, 180, and 270.</param>
+    /// <returns>The pixels (tightly packed rows) and the preview dimensions.</returns>
+    private static (byte[] pixels, int width, int height) RenderPreview(CanvasBitmap bitmap, int maxSize, int rotation)
+    {
+        var sourceWidth = (float)bitmap.SizeInPixels.Width;
+        var sourceHeight = (float)bitmap.SizeInPixels.Height;
+        var scale = Math.Min(1f, maxSize / Math.Max(sourceWidth, sourceHeight));
+        var swap = rotation is 90 or 270;
+
+        var scaledWidth = sourceWidth * scale;
+        var scaledHeight = sourceHeight * scale;
+        var width = RoundToBlock(swap ? scaledHeight : scaledWidth);
+        var height = RoundToBlock(swap ? scaledWidth : scaledHeight);
+
+        using var target = new CanvasRenderTarget(bitmap.Device, width, height, 96);
+        using (var ds = target.CreateDrawingSession())
+        {
+            ds.Clear(Colors.Transparent);
+            ds.Transform = Matrix3x2.CreateTranslation(-scaledWidth * 0.5f, -scaledHeight * 0.5f) *
+                           Matrix3x2.CreateRotation((float)(Math.PI * rotation / 180f)) *
+                           Matrix3x2.CreateTranslation(width * 0.5f, height * 0.5f);
+            ds.DrawImage(bitmap, new Rect(0, 0, scaledWidth, scaledHeight), bitmap.Bounds, 1f,
+                CanvasImageInterpolation.HighQualityCubic);
+        }
+        return (target.GetPixelBytes(), width, height);
+    }
+
+    private static int RoundToBlock(float length) => Math.Max(4, (int)MathF.Round(length / 4f) * 4);
+}
\ No newline at end of file
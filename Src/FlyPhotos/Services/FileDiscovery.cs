@@ -51,26 +51,33 @@ internal static partial class FileDiscovery
 
     private static IReadOnlyList<string> ListFiles(string selectedFilePath, bool flyLaunchedExternally)
     {
-        
-        IReadOnlyList<string> files = Array.Empty<string>();
-
         // 1. If fly launched externally, Attempt to get files from the active Explorer window.
         // Most probably Fly would have been launched from an explorer window
         if (flyLaunchedExternally)
-            files = FindAllFilesFromExplorerWindowNative();
-
-        // 2. If explorer gives no files, fall back to reading from the directory.
-        if (files.Count == 0)
         {
-            // Path.GetDirectoryName can return null if the path is a root directory.
-            string? directory = Path.GetDirectoryName(selectedFilePath);
-            if (directory != null)
-            {
-                files = FindAllFilesFromDirectory(directory);
-            }
+            var explorerFiles = FindAllFilesFromExplorerWindowNative();
+            if (explorerFiles.Count > 0)
+                return FilterSupportedFiles(explorerFiles, selectedFilePath);
         }
 
-        // 3. Filter for supported extensions, always including the selected file, while preserving order.
+        // 2. If explorer gives no files, fall back to reading from the directory. That listing
+        //    comes back already filtered to supported extensions and in natural order.
+        // Path.GetDirectoryName can return null if the path is a root directory.
+        string? directory = Path.GetDirectoryName(selectedFilePath);
+        List<string> files = directory != null ? FindSupportedFilesFromDirectory(directory, selectedFilePath) : [];
+
+        // 3. If the list is still empty, add the selected file to ensure we have at least one item.
+        if (files.Count == 0)
+            files.Add(selectedFilePath);
+
+        return files;
+    }
+
+    /// <summary>
+    /// Filters for supported extensions, always including the selected file, while preserving order.
+    /// </summary>
+    private static List<string> FilterSupportedFiles(IReadOnlyList<string> files, string selectedFilePath)
+    {
         var filteredFiles = new List<string>(files.Count);
 
         foreach (var file in files)
@@ -83,9 +90,6 @@ internal static partial class FileDiscovery
                 filteredFiles.Add(file);
         }
 
-        // 4. If, after all fallbacks and filters, the list is empty (which can happen
-        //    if the initial 'files' list was empty or didn't contain the selected file),
-        //    add the selected file to ensure we have at least one item.
         if (filteredFiles.Count == 0)
             filteredFiles.Add(selectedFilePath);
 
@@ -98,6 +102,26 @@ internal static partial class FileDiscovery
         return fileList;
     }
 
+    private static List<string> FindSupportedFilesFromDirectory(string dirPath, string selectedFilePath)
+    {
+        if (!Directory.Exists(dirPath)) return [];
+
+        // Native path: one call enumerates, filters and natural-sorts the folder. Sorting here
+        // used to cost one StrCmpLogicalW P/Invoke per comparison (~1M for a 50k-file folder).
+        var files = NativeWrapper.EnumerateImageFiles(dirPath, CodecDiscovery.SupportedExtensions)
+                    ?? FilterSupportedFiles(FindAllFilesFromDirectory(dirPath), selectedFilePath);
+
+        // The selected file is always shown, even with an extension outside the supported set.
+        // Insert it where Explorer would list it.
+        if (files.FindIndex(f => string.Equals(f, selectedFilePath, StringComparison.OrdinalIgnoreCase)) < 0 &&
+            File.Exists(selectedFilePath))
+        {
+            var index = files.BinarySearch(selectedFilePath, NaturalComparer.Instance);
+            files.Insert(index < 0 ? ~index : index, selectedFilePath);
+        }
+        return files;
+    }
+
     private static IReadOnlyList<string> FindAllFilesFromDirectory(string dirPath)
     {
         if (!Directory.Exists(dirPath)) return Array.Empty<string>();
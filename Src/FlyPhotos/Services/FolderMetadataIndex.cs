@@ -0,0 +1,167 @@
+#nullable enable
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Security.Cryptography;
+using System.Text;
+using System.Threading;
+using FlyPhotos.Infra.Interop;
+using NLog;
+
+namespace FlyPhotos.Services;
+
+/// <summary>
+/// Native, memory-mapped metadata index for the folder being browsed: size, mtime, dimensions,
+/// orientation, capture time and format of every supported file. Built on first visit and
+/// refreshed incrementally (only new or changed files are opened) on later visits.
+/// </summary>
+internal sealed class FolderMetadataIndex : IDisposable
+{
+    private static readonly Logger Logger = LogManager.GetCurrentClassLogger();
+
+    private static FolderMetadataIndex? _current;
+
+    /// <summary>
+    /// The index for the folder of the current session, or null until it has been opened.
+    /// </summary>
+    public static FolderMetadataIndex? Current => Volatile.Read(ref _current);
+
+    // A SafeHandle, so a lookup in flight on a prefetch worker keeps the native index alive
+    // when OpenForSession replaces and disposes this instance on another thread.
+    private readonly FolderIndexHandle _handle;
+
+    public string FolderPath { get; }
+
+    public int Count
+    {
+        get
+        {
+            try
+            {
+                return _handle.IsClosed ? 0 : NativeFolderIndexBridge.GetFolderIndexCount(_handle);
+            }
+            catch (ObjectDisposedException)
+            {
+                return 0;
+            }
+        }
+    }
+
+    private FolderMetadataIndex(string folderPath, FolderIndexHandle handle)
+    {
+        FolderPath = folderPath;
+        _handle = handle;
+    }
+
+    /// <summary>
+    /// Opens (building or refreshing as needed) the index for the folder containing
+    /// <paramref name="selectedFilePath"/> and publishes it as <see cref="Current"/>.
+    /// Runs synchronously; call from a background thread.
+    /// </summary>
+    public static void OpenForSession(string selectedFilePath)
+    {
+        var folder = Path.GetDirectoryName(selectedFilePath);
+        if (string.IsNullOrEmpty(folder)) return;
+
+        var index = Open(folder);
+        if (index == null) return;
+        Interlocked.Exchange(ref _current, index)?.Dispose();
+    }
+
+    /// <summary>
+    /// Opens the index for <paramref name="folder"/>, refreshing it against the directory first.
+    /// </summary>
+    /// <returns>The opened index, or null if the folder could not be indexed.</returns>
+    public static unsafe FolderMetadataIndex? Open(string folder)
+    {
+        try
+        {
+            var extensions = new List<string>(CodecDiscovery.SupportedExtensions);
+            if (extensions.Count == 0) return null;
+
+            var sw = System.Diagnostics.Stopwatch.StartNew();
+            var pins = new GCHandle[extensions.Count];
+            var pointers = new IntPtr[extensions.Count];
+            FolderIndexHandle handle;
+            FolderIndexRefreshStats stats;
+            try
+            {
+                for (var i = 0; i < extensions.Count; i++)
+                {
+                    pins[i] = GCHandle.Alloc(extensions[i], GCHandleType.Pinned);
+                    pointers[i] = pins[i].AddrOfPinnedObject();
+                }
+                fixed (IntPtr* extensionArray = pointers)
+                {
+                    handle = NativeFolderIndexBridge.OpenFolderIndex(folder, GetIndexFilePath(folder),
+                        extensionArray, extensions.Count, out stats);
+                }
+            }
+            finally
+            {
+                foreach (var pin in pins)
+                    if (pin.IsAllocated) pin.Free();
+            }
+
+            sw.Stop();
+            if (handle.IsInvalid)
+            {
+                handle.Dispose();
+                Logger.Warn($"Folder index could not be opened for {folder}");
+                return null;
+            }
+            Logger.Trace($"Folder index: {stats.Total} files ({stats.Reused} reused, {stats.Probed} probed, " +
+                         $"{stats.Removed} removed) in {sw.ElapsedMilliseconds} ms");
+            return new FolderMetadataIndex(folder, handle);
+        }
+        catch (Exception ex)
+        {
+            Logger.Error(ex, "FolderMetadataIndex.Open failed for {0}", folder);
+            return null;
+        }
+    }
+
+    /// <summary>
+    /// Looks up a file of this folder. Reads directly from the mapped index; no file is opened.
+    /// </summary>
+    public bool TryGet(string filePath, out FolderIndexEntry entry)
+    {
+        entry = default;
+        if (_handle.IsClosed ||
+            !string.Equals(Path.GetDirectoryName(filePath), FolderPath, StringComparison.OrdinalIgnoreCase))
+            return false;
+        try
+        {
+            return NativeFolderIndexBridge.LookupFolderIndexEntry(_handle, Path.GetFileName(filePath), out entry);
+        }
+        catch (ObjectDisposedException)
+        {
+            // Replaced by the next session's index between the check above and the call.
+            return false;
+        }
+    }
+
+    /// <summary>
+    /// Gets the displayed size (orientation applied) of a file, if the index knows it.
+    /// </summary>
+    public bool TryGetDisplaySize(string filePath, out int width, out int height)
+    {
+        width = height = 0;
+        if (!TryGet(filePath, out var entry) || entry.Width <= 0 || entry.Height <= 0) return false;
+        var swap = entry.Orientation >= 5 && entry.Orientation <= 8;
+        (width, height) = swap ? (entry.Height, entry.Width) : (entry.Width, entry.Height);
+        return true;
+    }
+
+    // One index file per folder, named by a hash of the normalised folder path so any
+    // folder (including ones on read-only media) can be indexed without writing into it.
+    private static string GetIndexFilePath(string folder)
+    {
+        var normalized = Path.TrimEndingDirectorySeparator(Path.GetFullPath(folder)).ToUpperInvariant();
+        var hash = Convert.ToHexString(SHA256.HashData(Encoding.UTF8.GetBytes(normalized)), 0, 16);
+        return Path.Combine(PathResolver.GetDbFolderPath(), "FolderIndex", hash + ".idx");
+    }
+
+    public void Dispose() => _handle.Dispose();
+}
@@ -71,8 +71,8 @@ public sealed partial class FlyProfilerWindow : Window
 
             var outLines = new List<string>
             {
-                "fileName,gethq status,time taken gethq (ms),gethq function used,gethq fallback,FileLocked," +
-                "getpreview status,getpreview (ms),getpreview function used,getpreview fallback"
+                "fileName,gethq status,time taken gethq (ms),gethq function used,gethq fallback,FileLocked,gethq native stages," +
+                "getpreview status,getpreview (ms),getpreview function used,getpreview fallback,getpreview native stages"
             };
 
             await Task.Run(async () =>
@@ -81,7 +81,7 @@ public sealed partial class FlyProfilerWindow : Window
                 {
                     var file = files[i];
 
-                    string hqStatus = "", hqMs = "", hqFunc = "", hqFallback = "", fileLocked = "";
+                    string hqStatus = "", hqMs = "", hqFunc = "", hqFallback = "", fileLocked = "", hqStages = "";
                     if (runHq)
                     {
                         var hq = await ProfilingImageReader.ProbeHq(TestCanvas, file, checkLock);
@@ -90,9 +90,10 @@ public sealed partial class FlyProfilerWindow : Window
                         hqFunc = hq.FunctionUsed;
                         hqFallback = hq.Fallback.ToString();
                         fileLocked = hq.Locked?.ToString() ?? "";
+                        hqStages = hq.NativeStages;
                     }
 
-                    string pvStatus = "", pvMs = "", pvFunc = "", pvFallback = "";
+                    string pvStatus = "", pvMs = "", pvFunc = "", pvFallback = "", pvStages = "";
                     if (runPreview)
                     {
                         var pv = await ProfilingImageReader.ProbePreview(TestCanvas, file);
@@ -100,12 +101,13 @@ public sealed partial class FlyProfilerWindow : Window
                         pvMs = pv.ElapsedMs.ToString();
                         pvFunc = pv.FunctionUsed;
                         pvFallback = pv.Fallback.ToString();
+                        pvStages = pv.NativeStages;
                     }
 
                     outLines.Add(string.Join(",",
                         CsvEscape(file),
-                        hqStatus, hqMs, hqFunc, hqFallback, fileLocked,
-                        pvStatus, pvMs, pvFunc, pvFallback));
+                        hqStatus, hqMs, hqFunc, hqFallback, fileLocked, CsvEscape(hqStages),
+                        pvStatus, pvMs, pvFunc, pvFallback, CsvEscape(pvStages)));
 
                     var done = i + 1;
                     DispatcherQueue.TryEnqueue(() =>
@@ -327,7 +327,7 @@ public sealed partial class PhotoDisplayWindow
         _inactivityFader.Dispose();
         _mouseAutoHider.Dispose();
         _ctrlDragWindowMover.Dispose();
-        DiskCacherWithSqlite.Shutdown();
+        DiskCacherNative.Shutdown();
 
         _windAppearanceManager.Dispose();
         _windPlacementManager.Dispose();
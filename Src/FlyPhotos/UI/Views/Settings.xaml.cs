@@ -432,7 +432,7 @@ internal sealed partial class Settings
     private async void ButtonClearDiskCache_OnClick(object sender, RoutedEventArgs e)
     {
         ButtonClearDiskCache.IsEnabled = false;
-        await DiskCacherWithSqlite.Instance.ClearAllAsync();
+        await DiskCacherNative.Instance.ClearAllAsync();
         ButtonClearDiskCache.IsEnabled = true;
     }
 